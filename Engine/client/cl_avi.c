@@ -69,6 +69,71 @@ typedef struct aviFileData_s
 
 static aviFileData_t afd;
 
+#define PCM_BUFFER_SIZE 44100
+
+#define AVI_MAX_FRAMES  8
+#define AVI_MAX_CHUNKS  64
+
+typedef enum
+{
+  AVI_FRAME_FREE,
+  AVI_FRAME_CAPTURING,    // handed to the renderer
+  AVI_FRAME_ENCODING,     // on a job
+  AVI_FRAME_READY         // for the writer
+} aviFrameState_t;
+
+typedef struct aviFrame_s
+{
+  volatile aviFrameState_t state;
+  int           take;           // CL_TakeVideoFrame call it was captured in
+  byte          *raw;           // bottom up BGR lines, padded to AVI_LINE_PADDING
+  byte          *encoded;       // motion jpeg only
+  const byte    *data;
+  int           size;           // -1 when the renderer never delivered
+} aviFrame_t;
+
+typedef struct aviChunk_s
+{
+  aviFrame_t    *frame;         // NULL for audio
+  byte          *pcm;
+  int           size;
+} aviChunk_t;
+
+// The queued capture path.  The renderer fills raw frames, motion jpeg
+// frames are encoded on jobs and a writer thread puts the chunks in the
+// file in the order they were queued.  This outlives afd across the
+// reopen at the 2Gb limit
+typedef struct aviQueue_s
+{
+  qboolean      active;
+  int           width, height;
+  qboolean      motionJpeg;
+  int           quality;
+  int           rawSize, encodedSize;
+
+  byte          *memory;
+  byte          *cBuffer;
+  aviFrame_t    frames[ AVI_MAX_FRAMES ];
+  int           numFrames;
+  int           nextFrame;
+  int           takes;
+  jobCounter_t  encoding;
+
+  aviChunk_t    chunks[ AVI_MAX_CHUNKS ];
+  volatile unsigned int head;   // queued by the main thread
+  volatile unsigned int tail;   // written
+
+  void          *thread;
+  volatile qboolean quit;
+  volatile qboolean full;       // the writer waits on the next file
+  volatile qboolean failed;     // the writer drops what is left
+} aviQueue_t;
+
+static aviQueue_t aviQueue;
+
+static byte pcmCaptureBuffer[ PCM_BUFFER_SIZE ];
+static int  bytesInBuffer;
+
 #define MAX_AVI_BUFFER 2048
 
 static byte buffer[ MAX_AVI_BUFFER ];
@@ -324,15 +389,17 @@ void CL_WriteAVIHeader( void )
   }
 }
 
+
 /*
 ===============
-CL_OpenAVIForWriting
+CL_OpenAVIFile
 
 Creates an AVI file and gets it into a state where
 writing the actual data can begin
 ===============
 */
-qboolean CL_OpenAVIForWriting( const char *fileName )
+static qboolean CL_OpenAVIFile( const char *fileName, int width, int height,
+    qboolean motionJpeg )
 {
   if( afd.fileOpen )
     return qfalse;
@@ -360,21 +427,21 @@ qboolean CL_OpenAVIForWriting( const char *fileName )
 
   afd.frameRate = cl_aviFrameRate->integer;
   afd.framePeriod = (int)( 1000000.0f / afd.frameRate );
-  afd.width = cls.glconfig.vidWidth;
-  afd.height = cls.glconfig.vidHeight;
-
-  if( cl_aviMotionJpeg->integer )
-    afd.motionJpeg = qtrue;
-  else
-    afd.motionJpeg = qfalse;
+  afd.width = width;
+  afd.height = height;
+  afd.motionJpeg = motionJpeg;
 
-  // Buffers only need to store RGB pixels.
-  // Allocate a bit more space for the capture buffer to account for possible
-  // padding at the end of pixel lines, and padding for alignment
-  #define MAX_PACK_LEN 16
-  afd.cBuffer = Z_Malloc((afd.width * 3 + MAX_PACK_LEN - 1) * afd.height + MAX_PACK_LEN - 1);
-  // raw avi files have pixel lines start on 4-byte boundaries
-  afd.eBuffer = Z_Malloc(PAD(afd.width * 3, AVI_LINE_PADDING) * afd.height);
+  // The queued path brings its own frames
+  if( !aviQueue.active )
+  {
+    // Buffers only need to store RGB pixels.
+    // Allocate a bit more space for the capture buffer to account for possible
+    // padding at the end of pixel lines, and padding for alignment
+    #define MAX_PACK_LEN 16
+    afd.cBuffer = Z_Malloc((afd.width * 3 + MAX_PACK_LEN - 1) * afd.height + MAX_PACK_LEN - 1);
+    // raw avi files have pixel lines start on 4-byte boundaries
+    afd.eBuffer = Z_Malloc(PAD(afd.width * 3, AVI_LINE_PADDING) * afd.height);
+  }
 
   afd.a.rate = dma.speed;
   afd.a.format = WAV_FORMAT_PCM;
@@ -434,10 +501,86 @@ qboolean CL_OpenAVIForWriting( const char *fileName )
 
 /*
 ===============
-CL_CheckFileSize
+CL_CloseAVIFile
+
+Closes the AVI file and writes an index chunk
 ===============
 */
-static qboolean CL_CheckFileSize( int bytesToAdd )
+static qboolean CL_CloseAVIFile( void )
+{
+  int indexRemainder;
+  int indexSize = afd.numIndices * 16;
+  const char *idxFileName = va( "%s" INDEX_FILE_EXTENSION, afd.fileName );
+
+  // AVI file isn't open
+  if( !afd.fileOpen )
+    return qfalse;
+
+  afd.fileOpen = qfalse;
+
+  FS_Seek( afd.idxF, 4, FS_SEEK_SET );
+  bufIndex = 0;
+  WRITE_4BYTES( indexSize );
+  SafeFS_Write( buffer, bufIndex, afd.idxF );
+  FS_FCloseFile( afd.idxF );
+
+  // Write index
+
+  // Open the temp index file
+  if( ( indexSize = FS_FOpenFileRead( idxFileName,
+          &afd.idxF, qtrue ) ) <= 0 )
+  {
+    FS_FCloseFile( afd.f );
+    return qfalse;
+  }
+
+  indexRemainder = indexSize;
+
+  // Append index to end of avi file
+  while( indexRemainder > MAX_AVI_BUFFER )
+  {
+    FS_Read( buffer, MAX_AVI_BUFFER, afd.idxF );
+    SafeFS_Write( buffer, MAX_AVI_BUFFER, afd.f );
+    afd.fileSize += MAX_AVI_BUFFER;
+    indexRemainder -= MAX_AVI_BUFFER;
+  }
+  FS_Read( buffer, indexRemainder, afd.idxF );
+  SafeFS_Write( buffer, indexRemainder, afd.f );
+  afd.fileSize += indexRemainder;
+  FS_FCloseFile( afd.idxF );
+
+  // Remove temp index file
+  FS_HomeRemove( idxFileName );
+
+  // Write the real header
+  FS_Seek( afd.f, 0, FS_SEEK_SET );
+  CL_WriteAVIHeader( );
+
+  bufIndex = 4;
+  WRITE_4BYTES( afd.fileSize - 8 ); // "RIFF" size
+
+  bufIndex = afd.moviOffset + 4;    // Skip "LIST"
+  WRITE_4BYTES( afd.moviSize );
+
+  SafeFS_Write( buffer, bufIndex, afd.f );
+
+  if( afd.cBuffer )
+    Z_Free( afd.cBuffer );
+  if( afd.eBuffer )
+    Z_Free( afd.eBuffer );
+  FS_FCloseFile( afd.f );
+
+  Com_Printf( "Wrote %d:%d frames to %s\n", afd.numVideoFrames, afd.numAudioFrames, afd.fileName );
+
+  return qtrue;
+}
+
+/*
+===============
+CL_AVIFileFull
+===============
+*/
+static qboolean CL_AVIFileFull( int bytesToAdd )
 {
   unsigned int newFileSize;
 
@@ -449,13 +592,26 @@ static qboolean CL_CheckFileSize( int bytesToAdd )
 
   // I assume all the operating systems
   // we target can handle a 2Gb file
-  if( newFileSize > INT_MAX )
+  return newFileSize > INT_MAX;
+}
+
+/*
+===============
+CL_CheckFileSize
+===============
+*/
+static qboolean CL_CheckFileSize( int bytesToAdd )
+{
+  if( CL_AVIFileFull( bytesToAdd ) )
   {
+    int   width = afd.width, height = afd.height;
+    qboolean motionJpeg = afd.motionJpeg;
+
     // Close the current file...
-    CL_CloseAVI( );
+    CL_CloseAVIFile( );
 
     // ...And open a new one
-    CL_OpenAVIForWriting( va( "%s_", afd.fileName ) );
+    CL_OpenAVIFile( va( "%s_", afd.fileName ), width, height, motionJpeg );
 
     return qtrue;
   }
@@ -465,212 +621,953 @@ static qboolean CL_CheckFileSize( int bytesToAdd )
 
 /*
 ===============
-CL_WriteAVIVideoFrame
+CL_WriteAVIChunk
+
+Adds a chunk to the movi list and its entry to the index, qfalse
+if the file couldn't be written
 ===============
 */
-void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size )
+static qboolean CL_WriteAVIChunk( const char *tag, int flags,
+    const byte *data, int size )
 {
   int   chunkOffset = afd.fileSize - afd.moviOffset - 8;
   int   chunkSize = 8 + size;
   int   paddingSize = PADLEN(size, 2);
   byte  padding[ 4 ] = { 0 };
 
-  if( !afd.fileOpen )
-    return;
-
   // Chunk header + contents + padding
-  if( CL_CheckFileSize( 8 + size + 2 ) )
-    return;
-
   bufIndex = 0;
-  WRITE_STRING( "00dc" );
+  WRITE_STRING( tag );
   WRITE_4BYTES( size );
 
-  SafeFS_Write( buffer, 8, afd.f );
-  SafeFS_Write( imageBuffer, size, afd.f );
-  SafeFS_Write( padding, paddingSize, afd.f );
+  if( FS_Write( buffer, 8, afd.f ) < 8 ||
+      FS_Write( data, size, afd.f ) < size ||
+      FS_Write( padding, paddingSize, afd.f ) < paddingSize )
+    return qfalse;
   afd.fileSize += ( chunkSize + paddingSize );
-
-  afd.numVideoFrames++;
   afd.moviSize += ( chunkSize + paddingSize );
 
-  if( size > afd.maxRecordSize )
-    afd.maxRecordSize = size;
-
   // Index
   bufIndex = 0;
-  WRITE_STRING( "00dc" );           //dwIdentifier
-  WRITE_4BYTES( 0x00000010 );       //dwFlags (all frames are KeyFrames)
+  WRITE_STRING( tag );              //dwIdentifier
+  WRITE_4BYTES( flags );            //dwFlags
   WRITE_4BYTES( chunkOffset );      //dwOffset
   WRITE_4BYTES( size );             //dwLength
-  SafeFS_Write( buffer, 16, afd.idxF );
+  if( FS_Write( buffer, 16, afd.idxF ) < 16 )
+    return qfalse;
 
   afd.numIndices++;
-}
 
-#define PCM_BUFFER_SIZE 44100
+  return qtrue;
+}
 
 /*
 ===============
-CL_WriteAVIAudioFrame
+CL_WriteQueuedAVIChunks
+
+Writes the queued chunks in order, up to the first frame that isn't
+ready.  Runs on the writer thread, or on the main thread when there is
+none.  Returns qtrue if anything came off the queue
 ===============
 */
-void CL_WriteAVIAudioFrame( const byte *pcmBuffer, int size )
+static qboolean CL_WriteQueuedAVIChunks( void )
 {
-  static byte pcmCaptureBuffer[ PCM_BUFFER_SIZE ] = { 0 };
-  static int  bytesInBuffer = 0;
-
-  if( !afd.audio )
-    return;
-
-  if( !afd.fileOpen )
-    return;
-
-  // Chunk header + contents + padding
-  if( CL_CheckFileSize( 8 + bytesInBuffer + size + 2 ) )
-    return;
-
-  if( bytesInBuffer + size > PCM_BUFFER_SIZE )
-  {
-    Com_Printf( S_COLOR_YELLOW
-        "WARNING: Audio capture buffer overflow -- truncating\n" );
-    size = PCM_BUFFER_SIZE - bytesInBuffer;
-  }
-
-  Com_Memcpy( &pcmCaptureBuffer[ bytesInBuffer ], pcmBuffer, size );
-  bytesInBuffer += size;
+  aviChunk_t  *chunk;
+  aviFrame_t  *frame;
+  const byte  *data;
+  int         size;
+  qboolean    written = qfalse;
 
-  // Only write if we have a frame's worth of audio
-  if( bytesInBuffer >= (int)ceil( (float)afd.a.rate / (float)afd.frameRate ) *
-        afd.a.sampleSize )
+  while( aviQueue.tail != aviQueue.head && !aviQueue.full )
   {
-    int   chunkOffset = afd.fileSize - afd.moviOffset - 8;
-    int   chunkSize = 8 + bytesInBuffer;
-    int   paddingSize = PADLEN(bytesInBuffer, 2);
-    byte  padding[ 4 ] = { 0 };
+    Job_MemoryBarrier( );
+    chunk = &aviQueue.chunks[ aviQueue.tail % AVI_MAX_CHUNKS ];
+    frame = chunk->frame;
 
-    bufIndex = 0;
-    WRITE_STRING( "01wb" );
-    WRITE_4BYTES( bytesInBuffer );
+    if( frame )
+    {
+      if( frame->state != AVI_FRAME_READY )
+        break;
+      Job_MemoryBarrier( );
+      data = frame->data;
+      size = frame->size;
+    }
+    else
+    {
+      data = chunk->pcm;
+      size = chunk->size;
+    }
 
-    SafeFS_Write( buffer, 8, afd.f );
-    SafeFS_Write( pcmCaptureBuffer, bytesInBuffer, afd.f );
-    SafeFS_Write( padding, paddingSize, afd.f );
-    afd.fileSize += ( chunkSize + paddingSize );
+    if( size >= 0 && !aviQueue.failed )
+    {
+      // Chunk header + contents + padding, the main thread
+      // opens the next file
+      if( CL_AVIFileFull( 8 + size + 2 ) )
+      {
+        aviQueue.full = qtrue;
+        break;
+      }
 
-    afd.numAudioFrames++;
-    afd.moviSize += ( chunkSize + paddingSize );
-    afd.a.totalBytes += bytesInBuffer;
+      if( frame )
+      {
+        // all frames are KeyFrames
+        if( !CL_WriteAVIChunk( "00dc", 0x00000010, data, size ) )
+          aviQueue.failed = qtrue;
 
-    // Index
-    bufIndex = 0;
-    WRITE_STRING( "01wb" );           //dwIdentifier
-    WRITE_4BYTES( 0 );                //dwFlags
-    WRITE_4BYTES( chunkOffset );      //dwOffset
-    WRITE_4BYTES( bytesInBuffer );    //dwLength
-    SafeFS_Write( buffer, 16, afd.idxF );
+        afd.numVideoFrames++;
+        if( size > afd.maxRecordSize )
+          afd.maxRecordSize = size;
+      }
+      else
+      {
+        if( !CL_WriteAVIChunk( "01wb", 0, data, size ) )
+          aviQueue.failed = qtrue;
 
-    afd.numIndices++;
+        afd.numAudioFrames++;
+        afd.a.totalBytes += size;
+      }
+    }
 
-    bytesInBuffer = 0;
+    // done with the buffers
+    Job_MemoryBarrier( );
+    if( frame )
+      frame->state = AVI_FRAME_FREE;
+    aviQueue.tail++;
+    written = qtrue;
   }
+
+  return written;
 }
 
 /*
 ===============
-CL_TakeVideoFrame
+CL_AVIWriterThread
 ===============
 */
-void CL_TakeVideoFrame( void )
+static void CL_AVIWriterThread( void *arg )
 {
-  // AVI file isn't open
-  if( !afd.fileOpen )
-    return;
-
-  re.TakeVideoFrame( afd.width, afd.height,
-      afd.cBuffer, afd.eBuffer, afd.motionJpeg );
+  while( !aviQueue.quit )
+  {
+    if( !CL_WriteQueuedAVIChunks( ) )
+      Sys_Sleep( 1 );
+  }
 }
 
 /*
 ===============
-CL_CloseAVI
+CL_EncodeAVIFrame
 
-Closes the AVI file and writes an index chunk
+Motion jpeg job, one per frame
 ===============
 */
-qboolean CL_CloseAVI( void )
+static void CL_EncodeAVIFrame( void *data, int index )
 {
-  int indexRemainder;
-  int indexSize = afd.numIndices * 16;
-  const char *idxFileName = va( "%s" INDEX_FILE_EXTENSION, afd.fileName );
+  aviFrame_t  *frame = &aviQueue.frames[ index ];
+  int         lineLen = aviQueue.width * 3;
+  int         padWidth = PAD( lineLen, AVI_LINE_PADDING );
+  byte        *line, *lineEnd, t;
+  int         y;
+
+  // the renderer hands over BGR, libjpeg wants RGB
+  for( y = 0; y < aviQueue.height; y++ )
+  {
+    line = frame->raw + y * padWidth;
+    for( lineEnd = line + lineLen; line < lineEnd; line += 3 )
+    {
+      t = line[ 0 ];
+      line[ 0 ] = line[ 2 ];
+      line[ 2 ] = t;
+    }
+  }
 
-  // AVI file isn't open
-  if( !afd.fileOpen )
-    return qfalse;
+  frame->size = re.SaveJPGToBuffer( frame->encoded, aviQueue.encodedSize,
+      aviQueue.quality, aviQueue.width, aviQueue.height, frame->raw,
+      padWidth - lineLen );
+  frame->data = frame->encoded;
 
-  afd.fileOpen = qfalse;
+  Job_MemoryBarrier( );
+  frame->state = AVI_FRAME_READY;
+}
 
-  FS_Seek( afd.idxF, 4, FS_SEEK_SET );
-  bufIndex = 0;
-  WRITE_4BYTES( indexSize );
-  SafeFS_Write( buffer, bufIndex, afd.idxF );
-  FS_FCloseFile( afd.idxF );
+/*
+===============
+CL_SplitAVI
 
-  // Write index
+The writer stops short of the 2Gb limit and leaves the rest
+of the queue for the next file, which only the main thread
+can open
+===============
+*/
+static void CL_SplitAVI( void )
+{
+  char  fileName[ MAX_QPATH ];
 
-  // Open the temp index file
-  if( ( indexSize = FS_FOpenFileRead( idxFileName,
-          &afd.idxF, qtrue ) ) <= 0 )
+  Q_strncpyz( fileName, va( "%s_", afd.fileName ), sizeof( fileName ) );
+
+  CL_CloseAVIFile( );
+  if( !CL_OpenAVIFile( fileName, aviQueue.width, aviQueue.height,
+        aviQueue.motionJpeg ) )
   {
-    FS_FCloseFile( afd.f );
-    return qfalse;
+    Com_Printf( S_COLOR_YELLOW "WARNING: couldn't open %s, the "
+        "capture stops here\n", fileName );
+    aviQueue.failed = qtrue;
   }
 
-  indexRemainder = indexSize;
+  Job_MemoryBarrier( );
+  aviQueue.full = qfalse;
+}
 
-  // Append index to end of avi file
-  while( indexRemainder > MAX_AVI_BUFFER )
+/*
+===============
+CL_ServiceAVIQueue
+
+Called by the main thread while it waits on the writer
+===============
+*/
+static void CL_ServiceAVIQueue( void )
+{
+  if( aviQueue.full )
   {
-    FS_Read( buffer, MAX_AVI_BUFFER, afd.idxF );
-    SafeFS_Write( buffer, MAX_AVI_BUFFER, afd.f );
-    afd.fileSize += MAX_AVI_BUFFER;
-    indexRemainder -= MAX_AVI_BUFFER;
+    CL_SplitAVI( );
+    return;
   }
-  FS_Read( buffer, indexRemainder, afd.idxF );
-  SafeFS_Write( buffer, indexRemainder, afd.f );
-  afd.fileSize += indexRemainder;
-  FS_FCloseFile( afd.idxF );
 
-  // Remove temp index file
-  FS_HomeRemove( idxFileName );
+  if( !aviQueue.thread )
+  {
+    if( CL_WriteQueuedAVIChunks( ) )
+      return;
 
-  // Write the real header
-  FS_Seek( afd.f, 0, FS_SEEK_SET );
-  CL_WriteAVIHeader( );
+    Job_Wait( &aviQueue.encoding );
 
-  bufIndex = 4;
-  WRITE_4BYTES( afd.fileSize - 8 ); // "RIFF" size
+    if( CL_WriteQueuedAVIChunks( ) )
+      return;
+  }
 
-  bufIndex = afd.moviOffset + 4;    // Skip "LIST"
-  WRITE_4BYTES( afd.moviSize );
+  Sys_Sleep( 1 );
+}
 
-  SafeFS_Write( buffer, bufIndex, afd.f );
+/*
+===============
+CL_AbandonAVIFrames
 
-  Z_Free( afd.cBuffer );
-  Z_Free( afd.eBuffer );
-  FS_FCloseFile( afd.f );
+The renderer drops the capture when it has no room for the
+command, so frames taken before the given take are not coming
+===============
+*/
+static void CL_AbandonAVIFrames( int take )
+{
+  aviFrame_t  *frame;
+  int         i;
 
-  Com_Printf( "Wrote %d:%d frames to %s\n", afd.numVideoFrames, afd.numAudioFrames, afd.fileName );
+  for( i = 0; i < aviQueue.numFrames; i++ )
+  {
+    frame = &aviQueue.frames[ i ];
 
-  return qtrue;
+    if( frame->state == AVI_FRAME_CAPTURING && frame->take < take )
+    {
+      frame->size = -1;
+      Job_MemoryBarrier( );
+      frame->state = AVI_FRAME_READY;
+    }
+  }
 }
 
 /*
 ===============
-CL_VideoRecording
+CL_NextAVIChunk
 ===============
 */
-qboolean CL_VideoRecording( void )
+static aviChunk_t *CL_NextAVIChunk( void )
 {
-  return afd.fileOpen;
+  while( aviQueue.head - aviQueue.tail >= AVI_MAX_CHUNKS )
+    CL_ServiceAVIQueue( );
+
+  return &aviQueue.chunks[ aviQueue.head % AVI_MAX_CHUNKS ];
+}
+
+/*
+===============
+CL_PublishAVIChunk
+===============
+*/
+static void CL_PublishAVIChunk( void )
+{
+  Job_MemoryBarrier( );
+  aviQueue.head++;
+}
+
+/*
+===============
+CL_QueueAVIFrame
+
+Returns the buffer the renderer captures into, NULL if the
+capture stopped
+===============
+*/
+static byte *CL_QueueAVIFrame( void )
+{
+  aviFrame_t  *frame;
+  aviChunk_t  *chunk;
+
+  if( aviQueue.failed && afd.fileOpen )
+    Com_Error( ERR_DROP, "Failed to write avi file" );
+
+  // with r_smp the previous frame can still be in flight
+  CL_AbandonAVIFrames( aviQueue.takes - ( cls.glconfig.smpActive ? 1 : 0 ) );
+
+  frame = &aviQueue.frames[ aviQueue.nextFrame ];
+  while( frame->state != AVI_FRAME_FREE )
+    CL_ServiceAVIQueue( );
+
+  chunk = CL_NextAVIChunk( );
+
+  if( !afd.fileOpen )
+    return NULL;
+
+  aviQueue.nextFrame = ( aviQueue.nextFrame + 1 ) % aviQueue.numFrames;
+
+  frame->take = aviQueue.takes++;
+  frame->state = AVI_FRAME_CAPTURING;
+  chunk->frame = frame;
+  CL_PublishAVIChunk( );
+
+  return frame->raw;
+}
+
+/*
+===============
+CL_StartAVIQueue
+===============
+*/
+static qboolean CL_StartAVIQueue( int width, int height, qboolean motionJpeg )
+{
+  byte  *p;
+  int   frameSize, i;
+
+  Com_Memset( &aviQueue, 0, sizeof( aviQueue ) );
+
+  aviQueue.width = width;
+  aviQueue.height = height;
+  aviQueue.motionJpeg = motionJpeg;
+  aviQueue.quality = Cvar_VariableIntegerValue( "r_aviMotionJpegQuality" );
+
+  // raw avi files have pixel lines start on 4-byte boundaries
+  aviQueue.rawSize = PAD( width * 3, AVI_LINE_PADDING ) * height;
+  aviQueue.encodedSize = motionJpeg ? width * height * 3 : 0;
+
+  // one for each encoder, and some slack for the renderer and the writer
+  aviQueue.numFrames = Job_NumThreads( ) + 3;
+  if( aviQueue.numFrames > AVI_MAX_FRAMES )
+    aviQueue.numFrames = AVI_MAX_FRAMES;
+
+  frameSize = PAD( aviQueue.rawSize, 16 ) + PAD( aviQueue.encodedSize, 16 );
+  aviQueue.memory = malloc( aviQueue.numFrames * frameSize +
+      AVI_MAX_CHUNKS * PCM_BUFFER_SIZE +
+      ( width * 3 + MAX_PACK_LEN - 1 ) * height + MAX_PACK_LEN - 1 + 16 );
+  if( !aviQueue.memory )
+  {
+    Com_Printf( S_COLOR_YELLOW "WARNING: couldn't allocate the capture "
+        "queue, writing frames as they come\n" );
+    return qfalse;
+  }
+
+  p = PADP( aviQueue.memory, 16 );
+  for( i = 0; i < aviQueue.numFrames; i++ )
+  {
+    aviQueue.frames[ i ].raw = p;
+    aviQueue.frames[ i ].encoded = p + PAD( aviQueue.rawSize, 16 );
+    p += frameSize;
+  }
+  for( i = 0; i < AVI_MAX_CHUNKS; i++ )
+  {
+    aviQueue.chunks[ i ].pcm = p;
+    p += PCM_BUFFER_SIZE;
+  }
+  aviQueue.cBuffer = p;
+
+  aviQueue.active = qtrue;
+
+  return qtrue;
+}
+
+/*
+===============
+CL_StopAVIQueue
+
+Writes out whatever is still queued
+===============
+*/
+static void CL_StopAVIQueue( void )
+{
+  if( aviQueue.thread )
+  {
+    aviQueue.quit = qtrue;
+    Sys_JoinThread( aviQueue.thread );
+    aviQueue.thread = NULL;
+  }
+
+  // whatever the renderer hasn't delivered by now isn't coming
+  CL_AbandonAVIFrames( aviQueue.takes );
+
+  while( aviQueue.tail != aviQueue.head )
+  {
+    Job_Wait( &aviQueue.encoding );
+
+    if( aviQueue.full )
+      CL_SplitAVI( );
+    else
+      CL_WriteQueuedAVIChunks( );
+  }
+
+  free( aviQueue.memory );
+  aviQueue.memory = NULL;
+  aviQueue.active = qfalse;
+}
+
+/*
+===============
+CL_StartAVI
+===============
+*/
+static qboolean CL_StartAVI( const char *fileName, int width, int height,
+    qboolean motionJpeg, qboolean queued )
+{
+  if( afd.fileOpen )
+    return qfalse;
+
+  // the reopen at the 2Gb limit failed
+  if( aviQueue.active )
+    CL_StopAVIQueue( );
+
+  // Audio left over from the last capture doesn't belong in this one
+  bytesInBuffer = 0;
+
+  if( queued && !CL_StartAVIQueue( width, height, motionJpeg ) )
+    queued = qfalse;
+
+  if( !CL_OpenAVIFile( fileName, width, height, motionJpeg ) )
+  {
+    if( queued )
+      CL_StopAVIQueue( );
+    return qfalse;
+  }
+
+  // Without a writer thread the main thread
+  // writes whatever is ready as it queues more
+  if( queued )
+  {
+    aviQueue.thread = Sys_CreateThread( CL_AVIWriterThread, NULL );
+    if( !aviQueue.thread )
+      Com_Printf( S_COLOR_YELLOW "WARNING: couldn't start the avi writer thread\n" );
+  }
+
+  return qtrue;
+}
+
+/*
+===============
+CL_OpenAVIForWriting
+
+Creates an AVI file and gets it into a state where
+writing the actual data can begin
+===============
+*/
+qboolean CL_OpenAVIForWriting( const char *fileName )
+{
+  return CL_StartAVI( fileName,
+      cls.glconfig.vidWidth, cls.glconfig.vidHeight,
+      cl_aviMotionJpeg->integer ? qtrue : qfalse,
+      cl_aviAsync->integer ? qtrue : qfalse );
+}
+
+/*
+===============
+CL_WriteAVIVideoFrame
+
+With the capture queue this marks the frame captured, and may
+be called from the render thread
+===============
+*/
+void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size )
+{
+  if( aviQueue.active )
+  {
+    aviFrame_t  *frame;
+    int         i;
+
+    for( i = 0; i < aviQueue.numFrames; i++ )
+    {
+      if( aviQueue.frames[ i ].raw == imageBuffer )
+        break;
+    }
+
+    if( i == aviQueue.numFrames )
+      return;
+
+    frame = &aviQueue.frames[ i ];
+    if( frame->state != AVI_FRAME_CAPTURING )
+      return;
+
+    if( aviQueue.motionJpeg )
+    {
+      frame->state = AVI_FRAME_ENCODING;
+      Job_Add( CL_EncodeAVIFrame, NULL, i, &aviQueue.encoding, NULL );
+    }
+    else
+    {
+      frame->data = frame->raw;
+      frame->size = size;
+      Job_MemoryBarrier( );
+      frame->state = AVI_FRAME_READY;
+    }
+    return;
+  }
+
+  if( !afd.fileOpen )
+    return;
+
+  // Chunk header + contents + padding
+  if( CL_CheckFileSize( 8 + size + 2 ) )
+    return;
+
+  // all frames are KeyFrames
+  if( !CL_WriteAVIChunk( "00dc", 0x00000010, imageBuffer, size ) )
+    Com_Error( ERR_DROP, "Failed to write avi file" );
+
+  afd.numVideoFrames++;
+
+  if( size > afd.maxRecordSize )
+    afd.maxRecordSize = size;
+}
+
+/*
+===============
+CL_WriteAVIAudioFrame
+===============
+*/
+void CL_WriteAVIAudioFrame( const byte *pcmBuffer, int size )
+{
+  if( !afd.audio )
+    return;
+
+  if( !afd.fileOpen )
+    return;
+
+  // Chunk header + contents + padding
+  if( !aviQueue.active && CL_CheckFileSize( 8 + bytesInBuffer + size + 2 ) )
+    return;
+
+  if( bytesInBuffer + size > PCM_BUFFER_SIZE )
+  {
+    Com_Printf( S_COLOR_YELLOW
+        "WARNING: Audio capture buffer overflow -- truncating\n" );
+    size = PCM_BUFFER_SIZE - bytesInBuffer;
+  }
+
+  Com_Memcpy( &pcmCaptureBuffer[ bytesInBuffer ], pcmBuffer, size );
+  bytesInBuffer += size;
+
+  // Only write if we have a frame's worth of audio
+  if( bytesInBuffer >= (int)ceil( (float)afd.a.rate / (float)afd.frameRate ) *
+        afd.a.sampleSize )
+  {
+    if( aviQueue.active )
+    {
+      aviChunk_t  *chunk = CL_NextAVIChunk( );
+
+      chunk->frame = NULL;
+      chunk->size = bytesInBuffer;
+      Com_Memcpy( chunk->pcm, pcmCaptureBuffer, bytesInBuffer );
+      CL_PublishAVIChunk( );
+    }
+    else
+    {
+      if( !CL_WriteAVIChunk( "01wb", 0, pcmCaptureBuffer, bytesInBuffer ) )
+        Com_Error( ERR_DROP, "Failed to write avi file" );
+
+      afd.numAudioFrames++;
+      afd.a.totalBytes += bytesInBuffer;
+    }
+
+    bytesInBuffer = 0;
+  }
+}
+
+/*
+===============
+CL_TakeVideoFrame
+===============
+*/
+void CL_TakeVideoFrame( void )
+{
+  byte  *encodeBuffer;
+
+  // the reopen at the 2Gb limit failed
+  if( aviQueue.active && !afd.fileOpen )
+    CL_StopAVIQueue( );
+
+  // AVI file isn't open
+  if( !afd.fileOpen )
+    return;
+
+  if( aviQueue.active )
+  {
+    // always raw, the jobs do the encoding
+    if( ( encodeBuffer = CL_QueueAVIFrame( ) ) != NULL )
+      re.TakeVideoFrame( aviQueue.width, aviQueue.height,
+          aviQueue.cBuffer, encodeBuffer, qfalse );
+    return;
+  }
+
+  re.TakeVideoFrame( afd.width, afd.height,
+      afd.cBuffer, afd.eBuffer, afd.motionJpeg );
+}
+
+/*
+===============
+CL_CloseAVI
+
+Closes the AVI file and writes an index chunk
+===============
+*/
+qboolean CL_CloseAVI( void )
+{
+  if( aviQueue.active )
+    CL_StopAVIQueue( );
+
+  return CL_CloseAVIFile( );
+}
+
+/*
+===============
+CL_VideoRecording
+===============
+*/
+qboolean CL_VideoRecording( void )
+{
+  return afd.fileOpen;
+}
+
+/*
+===============
+CL_AVITestPixels
+
+A pattern that moves from frame to frame
+===============
+*/
+static void CL_AVITestPixels( byte *out, int width, int height,
+    int frameNum, qboolean bgr )
+{
+  int   lineLen = width * 3;
+  int   padWidth = PAD( lineLen, AVI_LINE_PADDING );
+  int   x, y;
+  byte  *p;
+
+  for( y = 0; y < height; y++ )
+  {
+    p = out + y * padWidth;
+    for( x = 0; x < width; x++, p += 3 )
+    {
+      p[ bgr ? 2 : 0 ] = ( x + frameNum * 4 ) & 0xFF;
+      p[ 1 ] = ( y * 2 + frameNum ) & 0xFF;
+      p[ bgr ? 0 : 2 ] = ( ( x ^ y ) + frameNum * 8 ) & 0xFF;
+    }
+    Com_Memset( p, 0, padWidth - lineLen );
+  }
+}
+
+/*
+===============
+CL_AVITestFrame
+
+Stands in for the renderer
+===============
+*/
+static void CL_AVITestFrame( int frameNum )
+{
+  int   lineLen = afd.width * 3;
+  int   padWidth = PAD( lineLen, AVI_LINE_PADDING );
+  byte  *encodeBuffer;
+  int   size;
+
+  if( aviQueue.active )
+  {
+    if( ( encodeBuffer = CL_QueueAVIFrame( ) ) == NULL )
+      return;
+
+    CL_AVITestPixels( encodeBuffer, afd.width, afd.height, frameNum, qtrue );
+    CL_WriteAVIVideoFrame( encodeBuffer, padWidth * afd.height );
+  }
+  else if( afd.motionJpeg )
+  {
+    CL_AVITestPixels( afd.cBuffer, afd.width, afd.height, frameNum, qfalse );
+    size = re.SaveJPGToBuffer( afd.eBuffer, lineLen * afd.height,
+        Cvar_VariableIntegerValue( "r_aviMotionJpegQuality" ),
+        afd.width, afd.height, afd.cBuffer, padWidth - lineLen );
+    CL_WriteAVIVideoFrame( afd.eBuffer, size );
+  }
+  else
+  {
+    CL_AVITestPixels( afd.eBuffer, afd.width, afd.height, frameNum, qtrue );
+    CL_WriteAVIVideoFrame( afd.eBuffer, padWidth * afd.height );
+  }
+}
+
+/*
+===============
+CL_AVITestAudio
+
+Exactly one chunk's worth, so every path splits it the same way
+===============
+*/
+static int CL_AVITestAudio( int frameNum )
+{
+  static short  pcm[ PCM_BUFFER_SIZE / 2 ];
+  int           size, i;
+
+  if( !afd.audio )
+    return 0;
+
+  size = (int)ceil( (float)afd.a.rate / (float)afd.frameRate ) * afd.a.sampleSize;
+  if( size > PCM_BUFFER_SIZE )
+    return 0;
+
+  for( i = 0; i < size / 2; i++ )
+    pcm[ i ] = (short)( ( ( frameNum * size / 2 + i ) * 97 ) & 0x7FFF ) - 0x4000;
+
+  CL_WriteAVIAudioFrame( (byte *)pcm, size );
+
+  return 1;
+}
+
+/*
+===============
+CL_AVIRead4
+===============
+*/
+static int CL_AVIRead4( const byte *p )
+{
+  return p[ 0 ] | ( p[ 1 ] << 8 ) | ( p[ 2 ] << 16 ) | ( p[ 3 ] << 24 );
+}
+
+/*
+===============
+CL_CheckAVIFile
+
+Walks the RIFF structure and follows every index entry into the movi
+list.  Returns NULL if the file is well formed, or what is wrong
+===============
+*/
+static const char *CL_CheckAVIFile( const byte *data, int len, int numFrames,
+    int numAudioChunks, qboolean motionJpeg, int width, int height )
+{
+  const byte  *p, *end;
+  const byte  *movi = NULL, *moviEnd = NULL, *chunk;
+  int         size, i, entries, length;
+  int         videoChunks = 0, audioChunks = 0, videoEntries = 0, audioEntries = 0;
+  qboolean    hdrl = qfalse, idx1 = qfalse;
+
+  if( len < 12 || memcmp( data, "RIFF", 4 ) || memcmp( data + 8, "AVI ", 4 ) )
+    return "no RIFF AVI header";
+  if( CL_AVIRead4( data + 4 ) != len - 8 )
+    return "RIFF size doesn't match the file";
+
+  end = data + len;
+  for( p = data + 12; p + 8 <= end; p += 8 + PAD( size, 2 ) )
+  {
+    size = CL_AVIRead4( p + 4 );
+    if( size < 0 || p + 8 + size > end )
+      return "chunk runs past the end of the file";
+
+    if( !memcmp( p, "LIST", 4 ) && !memcmp( p + 8, "hdrl", 4 ) )
+    {
+      if( memcmp( p + 12, "avih", 4 ) )
+        return "hdrl doesn't start with avih";
+      if( CL_AVIRead4( p + 20 + 16 ) != numFrames )
+        return "avih frame count is wrong";
+      if( CL_AVIRead4( p + 20 + 32 ) != width || CL_AVIRead4( p + 20 + 36 ) != height )
+        return "avih frame size is wrong";
+      hdrl = qtrue;
+    }
+    else if( !memcmp( p, "LIST", 4 ) && !memcmp( p + 8, "movi", 4 ) )
+    {
+      movi = p + 8;
+      moviEnd = movi + size;
+
+      for( chunk = movi + 4; chunk + 8 <= moviEnd; chunk += 8 + PAD( length, 2 ) )
+      {
+        length = CL_AVIRead4( chunk + 4 );
+        if( length < 0 || chunk + 8 + length > moviEnd )
+          return "movi chunk runs past the list";
+
+        if( !memcmp( chunk, "00dc", 4 ) )
+          videoChunks++;
+        else if( !memcmp( chunk, "01wb", 4 ) )
+          audioChunks++;
+        else
+          return "unknown chunk in movi";
+      }
+      if( chunk != moviEnd )
+        return "movi size doesn't match its chunks";
+    }
+    else if( !memcmp( p, "idx1", 4 ) )
+    {
+      if( !movi )
+        return "idx1 before movi";
+
+      entries = size / 16;
+      for( i = 0; i < entries; i++ )
+      {
+        const byte  *entry = p + 8 + i * 16;
+        int         offset = CL_AVIRead4( entry + 8 );
+
+        length = CL_AVIRead4( entry + 12 );
+        chunk = movi + offset;
+        if( offset < 4 || chunk + 8 + length > moviEnd )
+          return "index entry points outside movi";
+        if( memcmp( chunk, entry, 4 ) || CL_AVIRead4( chunk + 4 ) != length )
+          return "index entry doesn't match its chunk";
+
+        if( !memcmp( entry, "00dc", 4 ) )
+        {
+          chunk += 8;
+          if( motionJpeg )
+          {
+            if( length < 4 || chunk[ 0 ] != 0xFF || chunk[ 1 ] != 0xD8 ||
+                chunk[ length - 2 ] != 0xFF || chunk[ length - 1 ] != 0xD9 )
+              return "frame isn't a jpeg";
+          }
+          else if( length != PAD( width * 3, AVI_LINE_PADDING ) * height )
+            return "raw frame is the wrong size";
+          videoEntries++;
+        }
+        else
+          audioEntries++;
+      }
+      idx1 = qtrue;
+    }
+  }
+
+  if( !hdrl || !movi || !idx1 )
+    return "missing hdrl, movi or idx1";
+  if( videoChunks != numFrames || videoEntries != numFrames )
+    return "wrong number of frames";
+  if( audioChunks != numAudioChunks || audioEntries != numAudioChunks )
+    return "wrong number of audio chunks";
+
+  return NULL;
+}
+
+/*
+===============
+CL_AVITest_f
+
+Records synthetic frames through each capture path, checks the files
+are well formed and that the queued paths write the same bytes as the
+synchronous ones
+===============
+*/
+void CL_AVITest_f( void )
+{
+  static const struct
+  {
+    const char  *name;
+    qboolean    motionJpeg;
+    qboolean    queued;
+  } tests[ ] =
+  {
+    { "raw",          qfalse, qfalse },
+    { "raw queued",   qfalse, qtrue },
+    { "mjpeg",        qtrue,  qfalse },
+    { "mjpeg queued", qtrue,  qtrue }
+  };
+  const int   numTests = sizeof( tests ) / sizeof( tests[ 0 ] );
+  const int   width = 320, height = 240;
+  char        fileName[ MAX_QPATH ];
+  void        *data, *prevData = NULL;
+  int         len, prevLen = 0;
+  int         numFrames, numAudioChunks;
+  int         i, j, start, msec;
+  const char  *error;
+  qboolean    passed = qtrue;
+
+  if( CL_VideoRecording( ) )
+  {
+    Com_Printf( "Stop the video recording first\n" );
+    return;
+  }
+
+  numFrames = Cmd_Argc( ) > 1 ? atoi( Cmd_Argv( 1 ) ) : 25;
+  if( numFrames < 1 )
+    numFrames = 1;
+
+  for( i = 0; i < numTests; i++ )
+  {
+    Com_sprintf( fileName, sizeof( fileName ), "videos/avitest%d.avi", i );
+
+    if( !CL_StartAVI( fileName, width, height,
+          tests[ i ].motionJpeg, tests[ i ].queued ) )
+    {
+      Com_Printf( S_COLOR_RED "avitest: couldn't open %s\n", fileName );
+      passed = qfalse;
+      break;
+    }
+
+    start = Sys_Milliseconds( );
+    for( j = numAudioChunks = 0; j < numFrames; j++ )
+    {
+      CL_AVITestFrame( j );
+      numAudioChunks += CL_AVITestAudio( j );
+    }
+    CL_CloseAVI( );
+    msec = Sys_Milliseconds( ) - start;
+
+    len = FS_ReadFile( fileName, &data );
+    FS_HomeRemove( fileName );
+    if( len <= 0 )
+    {
+      Com_Printf( S_COLOR_RED "avitest: couldn't read %s back\n", fileName );
+      passed = qfalse;
+      break;
+    }
+
+    error = CL_CheckAVIFile( data, len, numFrames, numAudioChunks,
+        tests[ i ].motionJpeg, width, height );
+    if( error )
+    {
+      Com_Printf( S_COLOR_RED "avitest: %s: %s\n", tests[ i ].name, error );
+      passed = qfalse;
+    }
+    else
+    {
+      Com_Printf( "avitest: %s: %d frames, %d audio chunks, %d bytes, %d msec\n",
+          tests[ i ].name, numFrames, numAudioChunks, len, msec );
+    }
+
+    // every other test queues what the one before wrote directly,
+    // freed in the order the hunk wants them back
+    if( !tests[ i ].queued )
+    {
+      prevData = data;
+      prevLen = len;
+      continue;
+    }
+
+    if( prevData && ( len != prevLen || memcmp( data, prevData, len ) ) )
+    {
+      Com_Printf( S_COLOR_RED "avitest: %s doesn't match %s\n",
+          tests[ i ].name, tests[ i - 1 ].name );
+      passed = qfalse;
+    }
+
+    FS_FreeFile( data );
+    if( prevData )
+      FS_FreeFile( prevData );
+    prevData = NULL;
+  }
+
+  if( prevData )
+    FS_FreeFile( prevData );
+
+  Com_Printf( "avitest: %s\n", passed ? "passed" : S_COLOR_RED "FAILED" );
 }
@@ -590,6 +590,16 @@ intptr_t CL_CgameSystemCalls( intptr_t *args ) {
 		return 0;
 	case CG_R_LERPTAG:
 		return re.LerpTag( VMA(1), args[2], args[3], args[4], VMF(5), VMA(6) );
+	case CG_R_REGISTERTAG:
+		return re.RegisterTag( args[1], VMA(2) );
+	case CG_R_LERPTAGINDEX:
+		return re.LerpTagIndex( VMA(1), args[2], args[3], args[4], VMF(5), args[6] );
+	case CG_PARALLELFOR:
+		if ( !VM_IsNative( cgvm ) ) {
+			return qfalse;
+		}
+		Job_ParallelFor( (jobFunc_t)args[1], VMA(2), args[3], args[4] );
+		return qtrue;
 	case CG_GETGLCONFIG:
 		CL_GetGlconfig( VMA(1) );
 		return 0;
@@ -727,6 +737,9 @@ void CL_InitCGame( void ) {
 	mapname = Info_ValueForKey( info, "mapname" );
 	Com_sprintf( cl.mapname, sizeof( cl.mapname ), "maps/%s.bsp", mapname );
 
+	// decode the images this map used last time while nothing else runs
+	re.PrefetchImages( cl.mapname );
+
 	// load the dll or bytecode
 	interpret = Cvar_VariableValue("vm_cgame");
 	if(cl_connectedToPureServer)
@@ -34,6 +34,13 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "client.h"
 #include "snd_local.h"
 
+#if idx64 || ( id386 && defined( __SSE2__ ))
+#include <emmintrin.h>
+#define CIN_SSE2			1
+#else
+#define CIN_SSE2			0
+#endif
+
 #define MAXSIZE				8
 #define MINSIZE				4
 
@@ -52,6 +59,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #define MAX_VIDEO_HANDLES	16
 
+#define CIN_QUEUE_FRAMES	4				// decoded frames waiting to be shown
+#define CIN_FRAME_SOUND		(65536*2)		// shorts, enough for the largest chunk
+#define CIN_READ_AHEAD		0x100000		// bytes of the file kept ahead of the decoder
+
 
 static void RoQ_init( void );
 
@@ -85,8 +96,26 @@ typedef struct {
 	long				oldXOff, oldYOff, oldysize, oldxsize;
 
 	int					currentHandle;
+
+	// the decoder runs ahead of the handle's numQuads and status,
+	// which only move when the main thread shows one of its frames
+	long				numQuads;
+	e_status			status;
+	byte				*frame;			// linbuf half with the last decoded frame
+	qboolean			newFrame, resetClock, resyncSound, approximated;
+	short				sbuf[CIN_FRAME_SOUND];
 } cinematics_t;
 
+typedef struct {
+	long				numQuads;
+	e_status			status;
+	qboolean			newFrame, resetClock, resyncSound, approximated;
+	int					soundSamples;
+	int					soundChannels;
+	short				sound[CIN_FRAME_SOUND];
+	byte				*pixels;		// swapped with the shown frame's
+} cinFrame_t;
+
 typedef struct {
 	char				fileName[MAX_OSPATH];
 	int					CIN_WIDTH, CIN_HEIGHT;
@@ -125,6 +154,10 @@ typedef struct {
 	int					playonwalls;
 	byte*				buf;
 	long				drawX, drawY;
+
+	byte				*data;			// whole file when cl_cinDecodeAhead is set
+	volatile int		dataFilled;		// read in by the main thread
+	int					dataPos;		// decoder position
 } cin_cache;
 
 static cinematics_t		cin;
@@ -132,6 +165,20 @@ static cin_cache		cinTable[MAX_VIDEO_HANDLES];
 static int				currentHandle = -1;
 static int				CL_handle = -1;
 
+// frames decoded ahead for the playing handle, the decoder fills them
+// up to read + CIN_QUEUE_FRAMES and the main thread shows them in order
+static struct {
+	cinFrame_t			frames[CIN_QUEUE_FRAMES];
+	volatile int		read;
+	volatile int		write;
+	byte				*shown;			// pixels of the frame in cinTable's buf
+	jobCounter_t		decoding;
+} cinQueue;
+
+static byte				cinPixels[CIN_QUEUE_FRAMES+1][DEFAULT_CIN_WIDTH*DEFAULT_CIN_HEIGHT*4];
+
+static qboolean			cin_forceScalar;	// cinbench timing the plain C kernels
+
 extern int				s_soundtime;		// sample PAIRS
 
 
@@ -604,6 +651,83 @@ static unsigned int yuv_to_rgb24( long y, long u, long v )
 	return LittleLong ((r)|(g<<8)|(b<<16)|(255<<24));
 }
 
+/******************************************************************************
+*
+* Function:		yuv4_to_rgb24
+*
+* Description:	the four pixels of a codebook cell, which share their
+*				chroma, the saturating packs doing the clamping with SSE2
+*
+******************************************************************************/
+static void yuv4_to_rgb24( long y0, long y1, long y2, long y3, long u, long v, unsigned int *out )
+{
+#if CIN_SSE2
+	__m128i	yy, r, g, b, x;
+
+	if ( com_haveSSE2 && !cin_forceScalar ) {
+		yy = _mm_setr_epi32( ROQ_YY_tab[y0], ROQ_YY_tab[y1], ROQ_YY_tab[y2], ROQ_YY_tab[y3] );
+		r = _mm_srai_epi32( _mm_add_epi32( yy, _mm_set1_epi32( ROQ_VR_tab[v] ) ), 6 );
+		g = _mm_srai_epi32( _mm_add_epi32( yy, _mm_set1_epi32( ROQ_UG_tab[u] + ROQ_VG_tab[v] ) ), 6 );
+		b = _mm_srai_epi32( _mm_add_epi32( yy, _mm_set1_epi32( ROQ_UB_tab[u] ) ), 6 );
+
+		// rrrr gggg bbbb aaaa, then transposed to rgba
+		x = _mm_packus_epi16( _mm_packs_epi32( r, g ), _mm_packs_epi32( b, _mm_set1_epi32( 255 ) ) );
+		x = _mm_unpacklo_epi8( x, _mm_srli_si128( x, 8 ) );
+		x = _mm_unpacklo_epi8( x, _mm_srli_si128( x, 8 ) );
+		_mm_storeu_si128( (__m128i *)out, x );
+		return;
+	}
+#endif
+	out[0] = yuv_to_rgb24( y0, u, v );
+	out[1] = yuv_to_rgb24( y1, u, v );
+	out[2] = yuv_to_rgb24( y2, u, v );
+	out[3] = yuv_to_rgb24( y3, u, v );
+}
+
+/******************************************************************************
+*
+* Function:		expandCodeBook32
+*
+* Description:	builds the 32 bit vq4 and vq8 cells from pairs of vq2
+*				cells of cell pixels each
+*
+******************************************************************************/
+static void expandCodeBook32( byte *input, long four, long cell )
+{
+	unsigned int	*a, *b, *c, *d;
+	long			i, j;
+#if CIN_SSE2
+	__m128i			qa, qb, da, db;
+	qboolean		sse2 = com_haveSSE2 && !cin_forceScalar;
+#endif
+
+	c = (unsigned int *)vq4;
+	d = (unsigned int *)vq8;
+
+	for(i=0;i<four;i++) {
+		a = (unsigned int *)vq2 + (*input++)*cell;
+		b = (unsigned int *)vq2 + (*input++)*cell;
+		for(j=0;j<cell/2;j++) {
+#if CIN_SSE2
+			if ( sse2 ) {
+				qa = _mm_loadl_epi64( (const __m128i *)a );
+				qb = _mm_loadl_epi64( (const __m128i *)b );
+				da = _mm_unpacklo_epi32( qa, qa );
+				db = _mm_unpacklo_epi32( qb, qb );
+				_mm_storeu_si128( (__m128i *)c, _mm_unpacklo_epi64( qa, qb ) );
+				_mm_storeu_si128( (__m128i *)d, da );
+				_mm_storeu_si128( (__m128i *)( d + 4 ), db );
+				_mm_storeu_si128( (__m128i *)( d + 8 ), da );
+				_mm_storeu_si128( (__m128i *)( d + 12 ), db );
+				a += 2; b += 2; c += 4; d += 16;
+				continue;
+			}
+#endif
+			VQ2TO4( a, b, c, d );
+		}
+	}
+}
+
 /******************************************************************************
 *
 * Function:		
@@ -672,23 +796,11 @@ static void decodeCodeBook( byte *input, unsigned short roq_flags )
 					y3 = (long)*input++;
 					cr = (long)*input++;
 					cb = (long)*input++;
-					*ibptr.i++ = yuv_to_rgb24( y0, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( y1, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( y2, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( y3, cr, cb );
+					yuv4_to_rgb24( y0, y1, y2, y3, cr, cb, ibptr.i );
+					ibptr.i += 4;
 				}
 
-				icptr.s = vq4;
-				idptr.s = vq8;
-	
-				for(i=0;i<four;i++) {
-					iaptr.s = vq2;
-					iaptr.i += (*input++)*4;
-					ibptr.s = vq2;
-					ibptr.i += (*input++)*4;
-					for(j=0;j<2;j++) 
-						VQ2TO4(iaptr.i, ibptr.i, icptr.i, idptr.i);
-				}
+				expandCodeBook32( input, four, 4 );
 			} else if (cinTable[currentHandle].samplesPerPixel==1) {
 				bbptr = (byte *)bptr;
 				for(i=0;i<two;i++) {
@@ -750,29 +862,12 @@ static void decodeCodeBook( byte *input, unsigned short roq_flags )
 					y3 = (long)*input++;
 					cr = (long)*input++;
 					cb = (long)*input++;
-					*ibptr.i++ = yuv_to_rgb24( y0, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( y1, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( ((y0*3)+y2)/4, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( ((y1*3)+y3)/4, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( (y0+(y2*3))/4, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( (y1+(y3*3))/4, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( y2, cr, cb );
-					*ibptr.i++ = yuv_to_rgb24( y3, cr, cb );
+					yuv4_to_rgb24( y0, y1, ((y0*3)+y2)/4, ((y1*3)+y3)/4, cr, cb, ibptr.i );
+					yuv4_to_rgb24( (y0+(y2*3))/4, (y1+(y3*3))/4, y2, y3, cr, cb, ibptr.i + 4 );
+					ibptr.i += 8;
 				}
 
-				icptr.s = vq4;
-				idptr.s = vq8;
-	
-				for(i=0;i<four;i++) {
-					iaptr.s = vq2;
-					iaptr.i += (*input++)*8;
-					ibptr.s = vq2;
-					ibptr.i += (*input++)*8;
-					for(j=0;j<2;j++) {
-						VQ2TO4(iaptr.i, ibptr.i, icptr.i, idptr.i);
-						VQ2TO4(iaptr.i, ibptr.i, icptr.i, idptr.i);
-					}
-				}
+				expandCodeBook32( input, four, 8 );
 			} else if (cinTable[currentHandle].samplesPerPixel==1) {
 				bbptr = (byte *)bptr;
 				for(i=0;i<two;i++) {
@@ -997,7 +1092,7 @@ static void readQuadInfo( byte *qData )
                         cinTable[currentHandle].drawY = 256;
                 }
 		if (cinTable[currentHandle].CIN_WIDTH != 256 || cinTable[currentHandle].CIN_HEIGHT != 256) {
-			Com_Printf("HACK: approxmimating cinematic for Rage Pro or Voodoo\n");
+			cin.approximated = qtrue;		// printed once the frame is shown
 		}
 	}
 }
@@ -1068,16 +1163,68 @@ static byte* RoQFetchInterlaced( byte *source ) {
 	return cinTable[currentHandle].buf2;
 }
 */
+
+/*
+==================
+CIN_ReadRoQ
+
+From the buffered file when there is one, where the main
+thread has already read in the chunk
+==================
+*/
+static void CIN_ReadRoQ( byte *dest, int len ) {
+	cin_cache	*c = &cinTable[currentHandle];
+
+	if ( !c->data ) {
+		FS_Read( dest, len, c->iFile );
+		return;
+	}
+	if ( len > c->dataFilled - c->dataPos ) {
+		len = c->dataFilled - c->dataPos;
+	}
+	if ( len > 0 ) {
+		Com_Memcpy( dest, c->data + c->dataPos, len );
+		c->dataPos += len;
+	}
+}
+
+/*
+==================
+CIN_QueueSound
+
+Samples of cin.sbuf to go out with the frame
+==================
+*/
+static void CIN_QueueSound( cinFrame_t *f, int samples, int channels ) {
+	int		used;
+
+	if ( f->soundSamples && f->soundChannels != channels ) {
+		return;
+	}
+	used = f->soundSamples * channels;
+	if ( used + samples * channels > CIN_FRAME_SOUND ) {
+		return;
+	}
+	Com_Memcpy( f->sound + used, cin.sbuf, samples * channels * sizeof( short ) );
+	f->soundSamples += samples;
+	f->soundChannels = channels;
+}
+
 static void RoQReset( void ) {
 	
 	if (currentHandle < 0) return;
 
-	FS_FCloseFile( cinTable[currentHandle].iFile );
-	FS_FOpenFileRead (cinTable[currentHandle].fileName, &cinTable[currentHandle].iFile, qtrue);
+	if (cinTable[currentHandle].data) {
+		// the file stays buffered, just go back to its start
+		cinTable[currentHandle].dataPos = 0;
+	} else {
+		FS_FCloseFile( cinTable[currentHandle].iFile );
+		FS_FOpenFileRead (cinTable[currentHandle].fileName, &cinTable[currentHandle].iFile, qtrue);
+	}
 	// let the background thread start reading ahead
-	FS_Read (cin.file, 16, cinTable[currentHandle].iFile);
+	CIN_ReadRoQ (cin.file, 16);
 	RoQ_init();
-	cinTable[currentHandle].status = FMV_LOOPED;
+	cin.status = FMV_LOOPED;
 }
 
 /******************************************************************************
@@ -1088,24 +1235,23 @@ static void RoQReset( void ) {
 *
 ******************************************************************************/
 
-static void RoQInterrupt(void)
+static void RoQInterrupt( cinFrame_t *f )
 {
 	byte				*framedata;
-        short		sbuf[32768];
         int		ssize;
         
 	if (currentHandle < 0) return;
 
-	FS_Read( cin.file, cinTable[currentHandle].RoQFrameSize+8, cinTable[currentHandle].iFile );
+	CIN_ReadRoQ( cin.file, cinTable[currentHandle].RoQFrameSize+8 );
 	if ( cinTable[currentHandle].RoQPlayed >= cinTable[currentHandle].ROQSize ) { 
 		if (cinTable[currentHandle].holdAtEnd==qfalse) {
 			if (cinTable[currentHandle].looping) {
 				RoQReset();
 			} else {
-				cinTable[currentHandle].status = FMV_EOF;
+				cin.status = FMV_EOF;
 			}
 		} else {
-			cinTable[currentHandle].status = FMV_IDLE;
+			cin.status = FMV_IDLE;
 		}
 		return; 
 	}
@@ -1118,50 +1264,48 @@ redump:
 	switch(cinTable[currentHandle].roq_id) 
 	{
 		case	ROQ_QUAD_VQ:
-			if ((cinTable[currentHandle].numQuads&1)) {
+			if ((cin.numQuads&1)) {
 				cinTable[currentHandle].normalBuffer0 = cinTable[currentHandle].t[1];
 				RoQPrepMcomp( cinTable[currentHandle].roqF0, cinTable[currentHandle].roqF1 );
 				cinTable[currentHandle].VQ1( (byte *)cin.qStatus[1], framedata);
-				cinTable[currentHandle].buf = 	cin.linbuf + cinTable[currentHandle].screenDelta;
+				cin.frame = 	cin.linbuf + cinTable[currentHandle].screenDelta;
 			} else {
 				cinTable[currentHandle].normalBuffer0 = cinTable[currentHandle].t[0];
 				RoQPrepMcomp( cinTable[currentHandle].roqF0, cinTable[currentHandle].roqF1 );
 				cinTable[currentHandle].VQ0( (byte *)cin.qStatus[0], framedata );
-				cinTable[currentHandle].buf = 	cin.linbuf;
+				cin.frame = 	cin.linbuf;
 			}
-			if (cinTable[currentHandle].numQuads == 0) {		// first frame
+			if (cin.numQuads == 0) {		// first frame
 				Com_Memcpy(cin.linbuf+cinTable[currentHandle].screenDelta, cin.linbuf, cinTable[currentHandle].samplesPerLine*cinTable[currentHandle].ysize);
 			}
-			cinTable[currentHandle].numQuads++;
-			cinTable[currentHandle].dirty = qtrue;
+			cin.numQuads++;
+			cin.newFrame = qtrue;
 			break;
 		case	ROQ_CODEBOOK:
 			decodeCodeBook( framedata, (unsigned short)cinTable[currentHandle].roq_flags );
 			break;
 		case	ZA_SOUND_MONO:
 			if (!cinTable[currentHandle].silent) {
-				ssize = RllDecodeMonoToStereo( framedata, sbuf, cinTable[currentHandle].RoQFrameSize, 0, (unsigned short)cinTable[currentHandle].roq_flags);
-                                S_RawSamples(0, ssize, 22050, 2, 1, (byte *)sbuf, 1.0f, -1);
+				ssize = RllDecodeMonoToStereo( framedata, cin.sbuf, cinTable[currentHandle].RoQFrameSize, 0, (unsigned short)cinTable[currentHandle].roq_flags);
+				CIN_QueueSound( f, ssize, 1 );
 			}
 			break;
 		case	ZA_SOUND_STEREO:
 			if (!cinTable[currentHandle].silent) {
-				if (cinTable[currentHandle].numQuads == -1) {
-					S_Update();
-					s_rawend[0] = s_soundtime;
+				if (cin.numQuads == -1) {
+					f->resyncSound = qtrue;
 				}
-				ssize = RllDecodeStereoToStereo( framedata, sbuf, cinTable[currentHandle].RoQFrameSize, 0, (unsigned short)cinTable[currentHandle].roq_flags);
-                                S_RawSamples(0, ssize, 22050, 2, 2, (byte *)sbuf, 1.0f, -1);
+				ssize = RllDecodeStereoToStereo( framedata, cin.sbuf, cinTable[currentHandle].RoQFrameSize, 0, (unsigned short)cinTable[currentHandle].roq_flags);
+				CIN_QueueSound( f, ssize, 2 );
 			}
 			break;
 		case	ROQ_QUAD_INFO:
-			if (cinTable[currentHandle].numQuads == -1) {
+			if (cin.numQuads == -1) {
 				readQuadInfo( framedata );
 				setupQuad( 0, 0 );
-				// we need to use CL_ScaledMilliseconds because of the smp mode calls from the renderer
-				cinTable[currentHandle].startTime = cinTable[currentHandle].lastTime = CL_ScaledMilliseconds()*com_timescale->value;
+				cin.resetClock = qtrue;
 			}
-			if (cinTable[currentHandle].numQuads != 1) cinTable[currentHandle].numQuads = 0;
+			if (cin.numQuads != 1) cin.numQuads = 0;
 			break;
 		case	ROQ_PACKET:
 			cinTable[currentHandle].inMemory = cinTable[currentHandle].roq_flags;
@@ -1173,7 +1317,7 @@ redump:
 		case	ROQ_QUAD_JPEG:
 			break;
 		default:
-			cinTable[currentHandle].status = FMV_EOF;
+			cin.status = FMV_EOF;
 			break;
 	}	
 //
@@ -1184,10 +1328,10 @@ redump:
 			if (cinTable[currentHandle].looping) {
 				RoQReset();
 			} else {
-				cinTable[currentHandle].status = FMV_EOF;
+				cin.status = FMV_EOF;
 			}
 		} else {
-			cinTable[currentHandle].status = FMV_IDLE;
+			cin.status = FMV_IDLE;
 		}
 		return; 
 	}
@@ -1201,13 +1345,13 @@ redump:
 
 	if (cinTable[currentHandle].RoQFrameSize>65536||cinTable[currentHandle].roq_id==0x1084) {
 		Com_DPrintf("roq_size>65536||roq_id==0x1084\n");
-		cinTable[currentHandle].status = FMV_EOF;
+		cin.status = FMV_EOF;
 		if (cinTable[currentHandle].looping) {
 			RoQReset();
 		}
 		return;
 	}
-	if (cinTable[currentHandle].inMemory && (cinTable[currentHandle].status != FMV_EOF)) { cinTable[currentHandle].inMemory--; framedata += 8; goto redump; }
+	if (cinTable[currentHandle].inMemory && (cin.status != FMV_EOF)) { cinTable[currentHandle].inMemory--; framedata += 8; goto redump; }
 //
 // one more frame hits the dust
 //
@@ -1226,8 +1370,8 @@ redump:
 
 static void RoQ_init( void )
 {
-	// we need to use CL_ScaledMilliseconds because of the smp mode calls from the renderer
-	cinTable[currentHandle].startTime = cinTable[currentHandle].lastTime = CL_ScaledMilliseconds()*com_timescale->value;
+	// the clock restarts when the main thread gets to this point
+	cin.resetClock = qtrue;
 
 	cinTable[currentHandle].RoQPlayed = 24;
 
@@ -1236,7 +1380,7 @@ static void RoQ_init( void )
 	
 	if (!cinTable[currentHandle].roqFPS) cinTable[currentHandle].roqFPS = 30;
 
-	cinTable[currentHandle].numQuads = -1;
+	cin.numQuads = -1;
 
 	cinTable[currentHandle].roq_id		= cin.file[ 8] + cin.file[ 9]*256;
 	cinTable[currentHandle].RoQFrameSize	= cin.file[10] + cin.file[11]*256 + cin.file[12]*65536;
@@ -1248,6 +1392,319 @@ static void RoQ_init( void )
 
 }
 
+/*
+==================
+CIN_ReadAhead
+
+Keeps the buffered file read in ahead bytes past the decoder,
+only the main thread touches the file system
+==================
+*/
+static void CIN_ReadAhead( int ahead ) {
+	cin_cache	*c = &cinTable[currentHandle];
+	int			len, r;
+
+	if ( !c->data || c->dataFilled >= c->ROQSize ) {
+		return;
+	}
+	len = c->dataPos + ahead - c->dataFilled;
+	if ( len > c->ROQSize - c->dataFilled ) {
+		len = c->ROQSize - c->dataFilled;
+	}
+	if ( len <= 0 ) {
+		return;
+	}
+
+	r = FS_Read( c->data + c->dataFilled, len, c->iFile );
+	if ( r < 0 ) {
+		r = 0;
+	}
+	if ( r < len ) {
+		// a short read ends the file there
+		c->ROQSize = c->dataFilled + r;
+	}
+	Job_MemoryBarrier();
+	c->dataFilled += r;
+}
+
+/*
+==================
+CIN_ChunkReady
+==================
+*/
+static qboolean CIN_ChunkReady( void ) {
+	cin_cache	*c = &cinTable[currentHandle];
+	int			filled;
+
+	if ( !c->data ) {
+		return qtrue;
+	}
+	filled = c->dataFilled;
+	Job_MemoryBarrier();
+	return filled >= c->ROQSize || filled - c->dataPos >= (int)c->RoQFrameSize + 8;
+}
+
+/*
+==================
+CIN_DecodeFrame
+
+Runs the chunks up to the next frame into f, stopping short when
+the sound would not fit or the file isn't read in that far
+==================
+*/
+static qboolean CIN_DecodeFrame( cinFrame_t *f ) {
+	cin_cache	*c = &cinTable[currentHandle];
+	long		numQuads;
+	int			chunks, channels;
+
+	numQuads = cin.numQuads;
+	cin.newFrame = cin.resetClock = cin.approximated = qfalse;
+	f->resyncSound = qfalse;
+	f->soundSamples = 0;
+
+	for ( chunks = 0 ; cin.status == FMV_PLAY ; chunks++ ) {
+		if ( !CIN_ChunkReady() ) {
+			break;
+		}
+		if ( f->soundSamples ) {
+			channels = 0;
+			if ( c->roq_id == ZA_SOUND_MONO ) {
+				channels = 1;
+			} else if ( c->roq_id == ZA_SOUND_STEREO ) {
+				channels = 2;
+			}
+			if ( channels && channels != f->soundChannels ) {
+				break;
+			}
+			if ( ( channels || c->roq_id == ROQ_PACKET ) &&
+				f->soundSamples * f->soundChannels + (int)c->RoQFrameSize * 2 > CIN_FRAME_SOUND ) {
+				break;
+			}
+		}
+		RoQInterrupt( f );
+		if ( cin.numQuads != numQuads ) {
+			chunks++;
+			break;
+		}
+	}
+	if ( !chunks ) {
+		return qfalse;
+	}
+
+	if ( cin.newFrame ) {
+		if ( !f->pixels ) {
+			f->pixels = cinPixels[f - cinQueue.frames];
+		}
+		Com_Memcpy( f->pixels, cin.frame, MIN( c->screenDelta, (long)sizeof( cinPixels[0] ) ) );
+	}
+	f->newFrame = cin.newFrame;
+	f->resetClock = cin.resetClock;
+	f->approximated = cin.approximated;
+	f->numQuads = cin.numQuads;
+	f->status = cin.status;
+
+	// the main thread sees the loop, the decoder carries on
+	if ( cin.status == FMV_LOOPED ) {
+		cin.status = FMV_PLAY;
+	}
+	return qtrue;
+}
+
+/*
+==================
+CIN_DecodeJob
+
+Decodes ahead until the queue is full
+==================
+*/
+static void CIN_DecodeJob( void *data, int index ) {
+	while ( cin.status == FMV_PLAY && cinQueue.write - cinQueue.read < CIN_QUEUE_FRAMES ) {
+		Job_MemoryBarrier();
+		if ( !CIN_DecodeFrame( &cinQueue.frames[cinQueue.write % CIN_QUEUE_FRAMES] ) ) {
+			break;
+		}
+		Job_MemoryBarrier();
+		cinQueue.write++;
+	}
+}
+
+/*
+==================
+CIN_FinishDecode
+==================
+*/
+static void CIN_FinishDecode( void ) {
+	Job_Wait( &cinQueue.decoding );
+}
+
+/*
+==================
+CIN_FlushQueue
+
+Drops the frames decoded ahead, for when the decoder is reset
+==================
+*/
+static void CIN_FlushQueue( void ) {
+	CIN_FinishDecode();
+	cinQueue.write = cinQueue.read;
+}
+
+/*
+==================
+CIN_StartDecode
+
+Without a buffered file or job threads the frames are
+decoded when they are due instead
+==================
+*/
+static void CIN_StartDecode( void ) {
+	if ( !cinTable[currentHandle].data || !Job_NumThreads() ) {
+		return;
+	}
+	if ( cinQueue.decoding.value > 0 ) {
+		return;
+	}
+	Job_MemoryBarrier();
+	if ( cin.status != FMV_PLAY || cinQueue.write - cinQueue.read >= CIN_QUEUE_FRAMES ) {
+		return;
+	}
+	Job_Add( CIN_DecodeJob, NULL, 0, &cinQueue.decoding, NULL );
+}
+
+/*
+==================
+CIN_NextFrame
+
+The frame to show next, decoded here if the decoder hasn't got to it
+==================
+*/
+static cinFrame_t *CIN_NextFrame( void ) {
+	cinFrame_t	*f;
+
+	if ( cinQueue.read == cinQueue.write ) {
+		CIN_FinishDecode();
+	}
+	if ( cinQueue.read == cinQueue.write ) {
+		f = &cinQueue.frames[cinQueue.write % CIN_QUEUE_FRAMES];
+		if ( !CIN_DecodeFrame( f ) ) {
+			CIN_ReadAhead( CIN_READ_AHEAD );
+			if ( !CIN_DecodeFrame( f ) ) {
+				return NULL;
+			}
+		}
+		cinQueue.write++;
+	}
+	Job_MemoryBarrier();
+	return &cinQueue.frames[cinQueue.read % CIN_QUEUE_FRAMES];
+}
+
+/*
+==================
+CIN_ShowFrame
+
+Hands the frame's sound to the mixer and its pixels to cinTable
+==================
+*/
+static void CIN_ShowFrame( cinFrame_t *f ) {
+	cin_cache	*c = &cinTable[currentHandle];
+	byte		*pixels;
+
+	if ( f->resyncSound ) {
+		S_Update();
+		s_rawend[0] = s_soundtime;
+	}
+	if ( f->soundSamples ) {
+		S_RawSamples( 0, f->soundSamples, 22050, 2, f->soundChannels, (byte *)f->sound, 1.0f, -1 );
+	}
+	if ( f->resetClock ) {
+		// we need to use CL_ScaledMilliseconds because of the smp mode calls from the renderer
+		c->startTime = c->lastTime = CL_ScaledMilliseconds()*com_timescale->value;
+	}
+	if ( f->approximated ) {
+		Com_Printf("HACK: approxmimating cinematic for Rage Pro or Voodoo\n");
+	}
+	if ( f->newFrame ) {
+		// the decoder gets the old frame's pixels to fill
+		if ( !cinQueue.shown ) {
+			cinQueue.shown = cinPixels[CIN_QUEUE_FRAMES];
+		}
+		pixels = cinQueue.shown;
+		cinQueue.shown = f->pixels;
+		f->pixels = pixels;
+		c->buf = cinQueue.shown;
+		c->dirty = qtrue;
+	}
+	c->numQuads = f->numQuads;
+	c->status = f->status;
+
+	Job_MemoryBarrier();
+	cinQueue.read++;
+}
+
+/*
+==================
+CIN_Restart
+
+Back to the start of the file from the main thread
+==================
+*/
+static void CIN_Restart( void ) {
+	cin_cache	*c = &cinTable[currentHandle];
+
+	CIN_FlushQueue();
+	RoQReset();
+
+	c->status = cin.status;
+	c->numQuads = cin.numQuads;
+	if ( cin.status == FMV_LOOPED ) {
+		cin.status = FMV_PLAY;
+	}
+	// we need to use CL_ScaledMilliseconds because of the smp mode calls from the renderer
+	c->startTime = c->lastTime = CL_ScaledMilliseconds()*com_timescale->value;
+}
+
+/*
+==================
+CIN_CloseFile
+==================
+*/
+static void CIN_CloseFile( cin_cache *c ) {
+	CIN_FinishDecode();
+
+	if (c->iFile) {
+		FS_FCloseFile( c->iFile );
+		c->iFile = 0;
+	}
+	if (c->data) {
+		free( c->data );
+		c->data = NULL;
+	}
+}
+
+/*
+==================
+CIN_BufferFile
+
+Reads the file into memory a bit at a time as the decoder
+gets through it, so it can run on a job thread
+==================
+*/
+static void CIN_BufferFile( void ) {
+	cin_cache	*c = &cinTable[currentHandle];
+
+	if ( c->ROQSize < 16 ) {
+		return;
+	}
+	c->data = malloc( c->ROQSize );
+	if ( !c->data ) {
+		Com_DPrintf( "CIN_BufferFile: couldn't allocate %li bytes\n", c->ROQSize );
+		return;
+	}
+	Com_Memcpy( c->data, cin.file, 16 );
+	c->dataFilled = c->dataPos = 16;
+	CIN_ReadAhead( CIN_READ_AHEAD );
+}
+
 /******************************************************************************
 *
 * Function:		
@@ -1269,10 +1726,7 @@ static void RoQShutdown( void ) {
 	Com_DPrintf("finished cinematic\n");
 	cinTable[currentHandle].status = FMV_IDLE;
 
-	if (cinTable[currentHandle].iFile) {
-		FS_FCloseFile( cinTable[currentHandle].iFile );
-		cinTable[currentHandle].iFile = 0;
-	}
+	CIN_CloseFile( &cinTable[currentHandle] );
 
 	if (cinTable[currentHandle].alterGameState) {
 		clc.state = CA_DISCONNECTED;
@@ -1299,6 +1753,7 @@ CIN_StopCinematic
 e_status CIN_StopCinematic(int handle) {
 	
 	if (handle < 0 || handle>= MAX_VIDEO_HANDLES || cinTable[handle].status == FMV_EOF) return FMV_EOF;
+	CIN_FinishDecode();
 	currentHandle = handle;
 
 	Com_DPrintf("trFMV::stop(), closing %s\n", cinTable[currentHandle].fileName);
@@ -1331,14 +1786,16 @@ e_status CIN_RunCinematic (int handle)
 {
 	int	start = 0;
 	int     thisTime = 0;
+	cinFrame_t	*f;
 
 	if (handle < 0 || handle>= MAX_VIDEO_HANDLES || cinTable[handle].status == FMV_EOF) return FMV_EOF;
 
 	if (cin.currentHandle != handle) {
+		CIN_FinishDecode();
 		currentHandle = handle;
 		cin.currentHandle = currentHandle;
 		cinTable[currentHandle].status = FMV_EOF;
-		RoQReset();
+		CIN_Restart();
 	}
 
 	if (cinTable[handle].playonwalls < -1)
@@ -1370,7 +1827,11 @@ e_status CIN_RunCinematic (int handle)
 	while(  (cinTable[currentHandle].tfps != cinTable[currentHandle].numQuads)
 		&& (cinTable[currentHandle].status == FMV_PLAY) ) 
 	{
-		RoQInterrupt();
+		f = CIN_NextFrame();
+		if (!f) {
+			break;
+		}
+		CIN_ShowFrame( f );
 		if (start != cinTable[currentHandle].startTime) {
 			// we need to use CL_ScaledMilliseconds because of the smp mode calls from the renderer
 		  cinTable[currentHandle].tfps = ((((CL_ScaledMilliseconds()*com_timescale->value)
@@ -1381,13 +1842,17 @@ e_status CIN_RunCinematic (int handle)
 
 	cinTable[currentHandle].lastTime = thisTime;
 
+	// get the next frames going while this one is drawn
+	CIN_ReadAhead( CIN_READ_AHEAD );
+	CIN_StartDecode();
+
 	if (cinTable[currentHandle].status == FMV_LOOPED) {
 		cinTable[currentHandle].status = FMV_PLAY;
 	}
 
 	if (cinTable[currentHandle].status == FMV_EOF) {
 	  if (cinTable[currentHandle].looping) {
-		RoQReset();
+		CIN_Restart();
 	  } else {
 		RoQShutdown();
 	  }
@@ -1422,6 +1887,7 @@ int CIN_PlayCinematic( const char *arg, int x, int y, int w, int h, int systemBi
 
 	Com_DPrintf("CIN_PlayCinematic( %s )\n", arg);
 
+	CIN_FlushQueue();
 	Com_Memset(&cin, 0, sizeof(cinematics_t) );
 	currentHandle = CIN_HandleForVideo();
 
@@ -1465,10 +1931,17 @@ int CIN_PlayCinematic( const char *arg, int x, int y, int w, int h, int systemBi
 	RoQID = (unsigned short)(cin.file[0]) + (unsigned short)(cin.file[1])*256;
 	if (RoQID == 0x1084)
 	{
+		if (cl_cinDecodeAhead->integer) {
+			CIN_BufferFile();
+		}
 		RoQ_init();
 //		FS_Read (cin.file, cinTable[currentHandle].RoQFrameSize+8, cinTable[currentHandle].iFile);
 
+		cin.status = FMV_PLAY;
 		cinTable[currentHandle].status = FMV_PLAY;
+		cinTable[currentHandle].numQuads = cin.numQuads;
+		// we need to use CL_ScaledMilliseconds because of the smp mode calls from the renderer
+		cinTable[currentHandle].startTime = cinTable[currentHandle].lastTime = CL_ScaledMilliseconds()*com_timescale->value;
 		Com_DPrintf("trFMV::play(), playing %s\n", arg);
 
 		if (cinTable[currentHandle].alterGameState) {
@@ -1501,6 +1974,44 @@ void CIN_SetLooping(int handle, qboolean loop) {
 	cinTable[handle].looping = loop;
 }
 
+#if CIN_SSE2
+/*
+==================
+CIN_ResampleRow_sse2
+
+Four output pixels a pass from two rows, summed in 16 bits so
+they match the C loops, in2 == in averages the columns only
+==================
+*/
+static void CIN_ResampleRow_sse2( const byte *in, const byte *in2, byte *out, int outWidth ) {
+	__m128i	zero, a0, a1, b0, b1;
+	__m128i	s0, s1, s2, s3;
+	int		j;
+
+	zero = _mm_setzero_si128();
+	for ( j = 0 ; j < outWidth ; j += 4, in += 32, in2 += 32, out += 16 ) {
+		a0 = _mm_loadu_si128( (const __m128i *)in );
+		a1 = _mm_loadu_si128( (const __m128i *)( in + 16 ) );
+		b0 = _mm_loadu_si128( (const __m128i *)in2 );
+		b1 = _mm_loadu_si128( (const __m128i *)( in2 + 16 ) );
+
+		s0 = _mm_add_epi16( _mm_unpacklo_epi8( a0, zero ), _mm_unpacklo_epi8( b0, zero ) );
+		s1 = _mm_add_epi16( _mm_unpackhi_epi8( a0, zero ), _mm_unpackhi_epi8( b0, zero ) );
+		s2 = _mm_add_epi16( _mm_unpacklo_epi8( a1, zero ), _mm_unpacklo_epi8( b1, zero ) );
+		s3 = _mm_add_epi16( _mm_unpackhi_epi8( a1, zero ), _mm_unpackhi_epi8( b1, zero ) );
+
+		s0 = _mm_add_epi16( s0, _mm_srli_si128( s0, 8 ) );
+		s1 = _mm_add_epi16( s1, _mm_srli_si128( s1, 8 ) );
+		s2 = _mm_add_epi16( s2, _mm_srli_si128( s2, 8 ) );
+		s3 = _mm_add_epi16( s3, _mm_srli_si128( s3, 8 ) );
+
+		s0 = _mm_srli_epi16( _mm_unpacklo_epi64( s0, s1 ), 2 );
+		s2 = _mm_srli_epi16( _mm_unpacklo_epi64( s2, s3 ), 2 );
+		_mm_storeu_si128( (__m128i *)out, _mm_packus_epi16( s0, s2 ) );
+	}
+}
+#endif
+
 /*
 ==================
 CIN_ResampleCinematic
@@ -1522,6 +2033,22 @@ void CIN_ResampleCinematic(int handle, int *buf2) {
 	}
 
 	buf3 = (int*)buf;
+#if CIN_SSE2
+	if (xm==2 && com_haveSSE2 && !cin_forceScalar) {
+		if (ym==2) {
+			for (iy = 0; iy<256; iy++) {
+				CIN_ResampleRow_sse2( buf + (iy<<12), buf + (iy<<12) + 2048, (byte *)buf2 + (iy<<10), 256 );
+			}
+			return;
+		}
+		if (ym==1) {
+			for (iy = 0; iy<256; iy++) {
+				CIN_ResampleRow_sse2( buf + (iy<<11), buf + (iy<<11), (byte *)buf2 + (iy<<10), 256 );
+			}
+			return;
+		}
+	}
+#endif
 	if (xm==2 && ym==2) {
 		byte *bc2, *bc3;
 		int	ic, iiy;
@@ -1695,3 +2222,109 @@ void CIN_UploadCinematic(int handle) {
 	}
 }
 
+
+/*
+==================
+CIN_BenchRun
+
+Plays name through without sound or drawing as fast as the frames
+decode, checksumming them when sum is given, -1 if it won't play
+==================
+*/
+static int CIN_BenchRun( const char *name, int *frames, unsigned int *sum ) {
+	cin_cache		*c;
+	cinFrame_t		*f;
+	unsigned int	*p;
+	int				handle, start, msec, i, n;
+
+	handle = CIN_PlayCinematic( name, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, CIN_silent );
+	if ( handle < 0 ) {
+		return -1;
+	}
+	c = &cinTable[handle];
+
+	// time the decoding, not the reads
+	CIN_ReadAhead( c->ROQSize );
+
+	*frames = 0;
+	start = Sys_Milliseconds();
+	while ( c->status == FMV_PLAY ) {
+		f = CIN_NextFrame();
+		if ( !f ) {
+			break;
+		}
+		if ( f->newFrame ) {
+			(*frames)++;
+			if ( sum ) {
+				p = (unsigned int *)f->pixels;
+				n = MIN( c->screenDelta, (long)sizeof( cinPixels[0] ) ) / 4;
+				for ( i = 0 ; i < n ; i++ ) {
+					*sum = *sum * 31 + p[i];
+				}
+			}
+		}
+		CIN_ShowFrame( f );
+	}
+	msec = Sys_Milliseconds() - start;
+
+	if ( c->buf ) {
+		RoQShutdown();
+	} else {
+		CIN_CloseFile( c );
+		c->fileName[0] = 0;
+		currentHandle = -1;
+	}
+	return msec;
+}
+
+/*
+==================
+CL_CinematicBench_f
+
+Decode rate of a cinematic with the C kernels and with SSE2,
+and whether the two give the same frames
+==================
+*/
+void CL_CinematicBench_f( void ) {
+	unsigned int	sum[2];
+	int				frames[2], msec[2];
+	int				i;
+
+	if ( Cmd_Argc() != 2 ) {
+		Com_Printf( "usage: cinbench <file.roq>\n" );
+		return;
+	}
+	for ( i = 0 ; i < MAX_VIDEO_HANDLES ; i++ ) {
+		if ( cinTable[i].fileName[0] ) {
+			Com_Printf( "cinbench: stop the playing cinematics first\n" );
+			return;
+		}
+	}
+	if ( !CIN_SSE2 || !com_haveSSE2 ) {
+		Com_Printf( "cinbench: no SSE2 path to compare\n" );
+		return;
+	}
+
+	sum[0] = sum[1] = 0;
+	for ( i = 0 ; i < 2 ; i++ ) {
+		cin_forceScalar = ( i == 0 );
+		msec[i] = CIN_BenchRun( Cmd_Argv( 1 ), &frames[i], NULL );
+		if ( msec[i] >= 0 ) {
+			CIN_BenchRun( Cmd_Argv( 1 ), &frames[i], &sum[i] );
+		}
+	}
+	cin_forceScalar = qfalse;
+
+	if ( msec[0] < 0 || msec[1] < 0 ) {
+		Com_Printf( "cinbench: couldn't play %s\n", Cmd_Argv( 1 ) );
+		return;
+	}
+
+	Com_Printf( "%s: %i frames\n", Cmd_Argv( 1 ), frames[1] );
+	Com_Printf( "scalar: %5i msec, %7.1f fps\n", msec[0],
+		msec[0] ? frames[0] * 1000.0f / msec[0] : 0.0f );
+	Com_Printf( "  sse2: %5i msec, %7.1f fps (%.2fx)\n", msec[1],
+		msec[1] ? frames[1] * 1000.0f / msec[1] : 0.0f,
+		msec[1] ? msec[0] / (float)msec[1] : 0.0f );
+	Com_Printf( "frames %s\n", ( frames[0] == frames[1] && sum[0] == sum[1] ) ? "match" : "DIFFER" );
+}
@@ -76,6 +76,7 @@ cvar_t	*cl_timedemoLog;
 cvar_t	*cl_autoRecordDemo;
 cvar_t	*cl_aviFrameRate;
 cvar_t	*cl_aviMotionJpeg;
+cvar_t	*cl_aviAsync;
 cvar_t	*cl_forceavidemo;
 
 cvar_t	*cl_freelook;
@@ -110,6 +111,7 @@ cvar_t	*cl_motdString;
 cvar_t	*cl_allowDownload;
 cvar_t	*cl_conXOffset;
 cvar_t	*cl_inGameVideo;
+cvar_t	*cl_cinDecodeAhead;
 
 cvar_t	*cl_serverStatusResendTime;
 cvar_t	*cl_trn;
@@ -3127,10 +3129,17 @@ void CL_InitRef( void ) {
 
 	ri.FS_ReadFile = FS_ReadFile;
 	ri.FS_FreeFile = FS_FreeFile;
+	ri.FS_ReadFileView = FS_ReadFileView;
+	ri.FS_ReleaseView = FS_ReleaseView;
 	ri.FS_WriteFile = FS_WriteFile;
+	ri.FS_HomeRemove = FS_HomeRemove;
 	ri.FS_FreeFileList = FS_FreeFileList;
 	ri.FS_ListFiles = FS_ListFiles;
+	ri.FS_ListPakFiles = FS_ListPakFiles;
+	ri.FS_PakFileCRC = FS_PakFileCRC;
 	ri.FS_FileIsInPAK = FS_FileIsInPAK;
+	ri.FS_LoadedPakChecksums = FS_LoadedPakChecksums;
+	ri.FS_PureServerActive = FS_PureServerActive;
 	ri.FS_FileExists = FS_FileExists;
 	ri.Cvar_Get = Cvar_Get;
 	ri.Cvar_Set = Cvar_Set;
@@ -3157,6 +3166,9 @@ void CL_InitRef( void ) {
 	ri.Sys_GLimpInit = Sys_GLimpInit;
 	ri.Sys_LowPhysicalMemory = Sys_LowPhysicalMemory;
 
+	ri.Job_ParallelFor = Job_ParallelFor;
+	ri.Job_NumThreads = Job_NumThreads;
+
 	ret = GetRefAPI( REF_API_VERSION, &ri );
 
 #if defined __USEA3D && defined __A3D_GEOM
@@ -3350,6 +3362,7 @@ void CL_Init( void ) {
 	cl_autoRecordDemo = Cvar_Get ("cl_autoRecordDemo", "0", CVAR_ARCHIVE);
 	cl_aviFrameRate = Cvar_Get ("cl_aviFrameRate", "25", CVAR_ARCHIVE);
 	cl_aviMotionJpeg = Cvar_Get ("cl_aviMotionJpeg", "1", CVAR_ARCHIVE);
+	cl_aviAsync = Cvar_Get ("cl_aviAsync", "1", CVAR_ARCHIVE);
 	cl_forceavidemo = Cvar_Get ("cl_forceavidemo", "0", 0);
 
 	rconAddress = Cvar_Get ("rconAddress", "", 0);
@@ -3388,6 +3401,7 @@ void CL_Init( void ) {
 #else
 	cl_inGameVideo = Cvar_Get ("r_inGameVideo", "1", CVAR_ARCHIVE);
 #endif
+	cl_cinDecodeAhead = Cvar_Get ("cl_cinDecodeAhead", "1", CVAR_ARCHIVE);
 
 	cl_serverStatusResendTime = Cvar_Get ("cl_serverStatusResendTime", "750", 0);
 
@@ -3494,6 +3508,7 @@ void CL_Init( void ) {
 	Cmd_AddCommand ("demo", CL_PlayDemo_f);
 	Cmd_SetCommandCompletionFunc( "demo", CL_CompleteDemoName );
 	Cmd_AddCommand ("cinematic", CL_PlayCinematic_f);
+	Cmd_AddCommand ("cinbench", CL_CinematicBench_f);
 	Cmd_AddCommand ("stoprecord", CL_StopRecord_f);
 	Cmd_AddCommand ("connect", CL_Connect_f);
 	Cmd_AddCommand ("reconnect", CL_Reconnect_f);
@@ -3509,6 +3524,7 @@ void CL_Init( void ) {
 	Cmd_AddCommand ("model", CL_SetModel_f );
 	Cmd_AddCommand ("video", CL_Video_f );
 	Cmd_AddCommand ("stopvideo", CL_StopVideo_f );
+	Cmd_AddCommand ("avitest", CL_AVITest_f );
 	CL_InitRef();
 
 	SCR_Init ();
@@ -3564,6 +3580,7 @@ void CL_Shutdown(char *finalmsg, qboolean disconnect, qboolean quit)
 	Cmd_RemoveCommand ("record");
 	Cmd_RemoveCommand ("demo");
 	Cmd_RemoveCommand ("cinematic");
+	Cmd_RemoveCommand ("cinbench");
 	Cmd_RemoveCommand ("stoprecord");
 	Cmd_RemoveCommand ("connect");
 	Cmd_RemoveCommand ("reconnect");
@@ -3578,6 +3595,7 @@ void CL_Shutdown(char *finalmsg, qboolean disconnect, qboolean quit)
 	Cmd_RemoveCommand ("model");
 	Cmd_RemoveCommand ("video");
 	Cmd_RemoveCommand ("stopvideo");
+	Cmd_RemoveCommand ("avitest");
 
 	CL_ShutdownInput();
 	Con_Shutdown();
@@ -412,6 +412,7 @@ extern	cvar_t	*j_up_axis;
 extern	cvar_t	*cl_timedemo;
 extern	cvar_t	*cl_aviFrameRate;
 extern	cvar_t	*cl_aviMotionJpeg;
+extern	cvar_t	*cl_aviAsync;
 
 extern	cvar_t	*cl_activeAction;
 
@@ -419,6 +420,7 @@ extern	cvar_t	*cl_allowDownload;
 extern  cvar_t  *cl_downloadMethod;
 extern	cvar_t	*cl_conXOffset;
 extern	cvar_t	*cl_inGameVideo;
+extern	cvar_t	*cl_cinDecodeAhead;
 
 extern	cvar_t	*cl_lanForcePackets;
 extern	cvar_t	*cl_autoRecordDemo;
@@ -578,6 +580,7 @@ void	SCR_DrawSmallChar( int x, int y, int ch );
 //
 
 void CL_PlayCinematic_f( void );
+void CL_CinematicBench_f( void );
 void SCR_DrawCinematic (void);
 void SCR_RunCinematic (void);
 void SCR_StopCinematic (void);
@@ -627,6 +630,7 @@ void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size );
 void CL_WriteAVIAudioFrame( const byte *pcmBuffer, int size );
 qboolean CL_CloseAVI( void );
 qboolean CL_VideoRecording( void );
+void CL_AVITest_f( void );
 
 //
 // cl_main.c
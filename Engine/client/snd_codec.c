@@ -183,6 +183,91 @@ int S_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer)
 	return stream->codec->read(stream, bytes, buffer);
 }
 
+/*
+=================
+S_CodecBufferStream
+
+Reads the rest of the file into memory and closes it.  The file
+system belongs to the main thread, but a buffered stream can be
+decoded anywhere.
+=================
+*/
+qboolean S_CodecBufferStream(snd_stream_t *stream)
+{
+	if(stream->data)
+		return qtrue;
+
+	stream->data = malloc(stream->length);
+	if(!stream->data)
+		return qfalse;
+
+	stream->dataPos = FS_FTell(stream->file);
+	if(stream->dataPos > 0)
+		FS_Seek(stream->file, 0, FS_SEEK_SET);
+
+	if(FS_Read(stream->data, stream->length, stream->file) != stream->length)
+	{
+		FS_Seek(stream->file, stream->dataPos, FS_SEEK_SET);
+		free(stream->data);
+		stream->data = NULL;
+		return qfalse;
+	}
+
+	FS_FCloseFile(stream->file);
+	stream->file = 0;
+	return qtrue;
+}
+
+/*
+=================
+S_CodecExists
+
+Finds the file S_CodecLoad would read, without decoding anything
+=================
+*/
+qboolean S_CodecExists(const char *filename)
+{
+	snd_codec_t *codec;
+	snd_codec_t *orgCodec = NULL;
+	char		localName[ MAX_QPATH ];
+	const char	*ext;
+	char		altName[ MAX_QPATH ];
+
+	Q_strncpyz(localName, filename, MAX_QPATH);
+
+	ext = COM_GetExtension(localName);
+
+	if( *ext )
+	{
+		for( codec = codecs; codec; codec = codec->next )
+		{
+			if( !Q_stricmp( ext, codec->ext ) )
+				break;
+		}
+
+		if( codec )
+		{
+			if( FS_FOpenFileRead( localName, NULL, qfalse ) > 0 )
+				return qtrue;
+
+			orgCodec = codec;
+			COM_StripExtension( filename, localName, MAX_QPATH );
+		}
+	}
+
+	for( codec = codecs; codec; codec = codec->next )
+	{
+		if( codec == orgCodec )
+			continue;
+
+		Com_sprintf( altName, sizeof (altName), "%s.%s", localName, codec->ext );
+		if( FS_FOpenFileRead( altName, NULL, qfalse ) > 0 )
+			return qtrue;
+	}
+
+	return qfalse;
+}
+
 //=======================================================================
 // Util functions (used by codecs)
 
@@ -227,7 +312,82 @@ S_CodecUtilClose
 */
 void S_CodecUtilClose(snd_stream_t **stream)
 {
-	FS_FCloseFile((*stream)->file);
+	if((*stream)->file)
+		FS_FCloseFile((*stream)->file);
+	if((*stream)->data)
+		free((*stream)->data);
 	Z_Free(*stream);
 	*stream = NULL;
 }
+
+/*
+=================
+S_CodecUtilRead
+
+FS_Read, or a copy once the stream is buffered
+=================
+*/
+int S_CodecUtilRead(snd_stream_t *stream, void *buffer, int bytes)
+{
+	int remaining;
+
+	if(!stream->data)
+		return FS_Read(buffer, bytes, stream->file);
+
+	remaining = stream->length - stream->dataPos;
+	if(bytes > remaining)
+		bytes = remaining;
+	if(bytes <= 0)
+		return 0;
+
+	Com_Memcpy(buffer, stream->data + stream->dataPos, bytes);
+	stream->dataPos += bytes;
+	return bytes;
+}
+
+/*
+=================
+S_CodecUtilSeek
+=================
+*/
+int S_CodecUtilSeek(snd_stream_t *stream, long offset, int origin)
+{
+	long pos;
+
+	if(!stream->data)
+		return FS_Seek(stream->file, offset, origin);
+
+	switch(origin)
+	{
+		case FS_SEEK_SET:
+			pos = offset;
+			break;
+		case FS_SEEK_CUR:
+			pos = stream->dataPos + offset;
+			break;
+		case FS_SEEK_END:
+			pos = stream->length + offset;
+			break;
+		default:
+			return -1;
+	}
+
+	if(pos < 0 || pos > stream->length)
+		return -1;
+
+	stream->dataPos = pos;
+	return 0;
+}
+
+/*
+=================
+S_CodecUtilTell
+=================
+*/
+int S_CodecUtilTell(snd_stream_t *stream)
+{
+	if(!stream->data)
+		return FS_FTell(stream->file);
+
+	return stream->dataPos;
+}
@@ -47,6 +47,8 @@ typedef struct snd_stream_s
 	int length;
 	int pos;
 	void *ptr;
+	byte *data;			// whole file once S_CodecBufferStream has read it
+	int dataPos;		// file position inside data
 } snd_stream_t;
 
 // Codec functions
@@ -74,10 +76,15 @@ void *S_CodecLoad(const char *filename, snd_info_t *info);
 snd_stream_t *S_CodecOpenStream(const char *filename);
 void S_CodecCloseStream(snd_stream_t *stream);
 int S_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer);
+qboolean S_CodecBufferStream(snd_stream_t *stream);
+qboolean S_CodecExists(const char *filename);
 
 // Util functions (used by codecs)
 snd_stream_t *S_CodecUtilOpen(const char *filename, snd_codec_t *codec);
 void S_CodecUtilClose(snd_stream_t **stream);
+int S_CodecUtilRead(snd_stream_t *stream, void *buffer, int bytes);
+int S_CodecUtilSeek(snd_stream_t *stream, long offset, int origin);
+int S_CodecUtilTell(snd_stream_t *stream);
 
 // WAV Codec
 extern snd_codec_t wav_codec;
@@ -36,8 +36,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 void S_Update_( void );
 void S_Base_StopAllSounds(void);
 void S_Base_StopBackgroundTrack( void );
+static void S_MusicInfo( void );
 
-snd_stream_t	*s_backgroundStream = NULL;
 static char		s_backgroundLoop[MAX_QPATH];
 //static char		s_backgroundMusic[MAX_QPATH]; //TTimo: unused
 
@@ -80,6 +80,8 @@ cvar_t		*s_testsound;
 cvar_t		*s_show;
 cvar_t		*s_mixahead;
 cvar_t		*s_mixPreStep;
+cvar_t		*s_mixThread;
+cvar_t		*s_lazyLoad;
 
 static loopSound_t		loopSounds[MAX_GENTITIES];
 static	channel_t		*freelist = NULL;
@@ -87,6 +89,189 @@ static	channel_t		*freelist = NULL;
 int						s_rawend[MAX_RAW_STREAMS];
 portable_samplepair_t s_rawsamples[MAX_RAW_STREAMS][MAX_RAW_SAMPLES];
 
+static int				s_localListener;	// listener_number as the main thread last set it
+
+
+// =======================================================================
+// Mixer thread event queue
+// =======================================================================
+
+/*
+With s_mixThread set, the sound calls from the client and cgame don't
+touch the channels themselves.  They are queued as events, and a mixer
+thread applies them and mixes ahead into the DMA buffer on its own
+schedule, so a long client frame doesn't starve the device.
+
+The main thread is the only producer, and it only publishes events at
+the end of a frame so the mixer never sees half of a frame's looping
+sounds.  Whoever holds s_mixer.lock consumes them: the mixer thread,
+or the main thread when it has to change the channels directly.
+*/
+
+#define	MAX_SOUND_EVENTS	4096	// must be a power of two
+#define	MIXER_THREAD_MSEC	5
+
+typedef enum {
+	SEV_START_SOUND,
+	SEV_ADD_LOOP,
+	SEV_ADD_REAL_LOOP,
+	SEV_STOP_LOOP,
+	SEV_CLEAR_LOOPS,
+	SEV_ENTITY_POSITION,
+	SEV_RESPATIALIZE,
+	SEV_PAINT			// s_mixthreadtest only
+} soundEventType_t;
+
+typedef struct {
+	soundEventType_t	type;
+	int				entityNum;
+	int				entchannel;
+	sfx_t			*sfx;
+	qboolean		fixedOrigin;
+	vec3_t			origin;			// the listener's head for SEV_RESPATIALIZE
+	vec3_t			velocity;
+	vec3_t			axis[3];
+	float			attenuation;
+	int				time;
+	int				framecount;
+	qboolean		killall;
+	int				endtime;
+} soundEvent_t;
+
+static struct {
+	qboolean			active;			// sound calls go through the queue
+	void				*thread;
+	volatile int		quit;
+	volatile int		lock;
+	volatile int		mainMixes;		// capturing video, the main thread mixes with the frames
+	qboolean			threadPainting;
+	qboolean			offline;		// s_mixthreadtest drives the clock and the painting
+	int					offlineTime;
+	volatile int		dropped;
+	int					droppedReported;
+
+	soundEvent_t		events[MAX_SOUND_EVENTS];
+	volatile unsigned	head;			// published by the main thread
+	volatile unsigned	tail;			// advanced by the lock holder
+	unsigned			write;			// the main thread's unpublished head
+} s_mixer;
+
+static void S_ApplySoundEvent( soundEvent_t *ev );
+
+/*
+=================
+S_CommitSoundEvents
+
+Publishes the events queued since the last commit
+=================
+*/
+static void S_CommitSoundEvents( void ) {
+	if ( !s_mixer.active ) {
+		return;
+	}
+	Job_MemoryBarrier();
+	s_mixer.head = s_mixer.write;
+}
+
+/*
+=================
+S_QueueSoundEvent
+
+Returns a slot for the main thread to fill in before the next commit
+=================
+*/
+static soundEvent_t *S_QueueSoundEvent( soundEventType_t type ) {
+	soundEvent_t	*ev;
+
+	while ( s_mixer.write - s_mixer.tail >= MAX_SOUND_EVENTS ) {
+		// the frame doesn't fit, let the mixer have what there is
+		S_CommitSoundEvents();
+		Sys_Sleep( 1 );
+	}
+
+	ev = &s_mixer.events[ s_mixer.write & ( MAX_SOUND_EVENTS - 1 ) ];
+	s_mixer.write++;
+	ev->type = type;
+	return ev;
+}
+
+/*
+=================
+S_DrainSoundEvents
+
+Applies the published events, only called by the lock holder
+=================
+*/
+static void S_DrainSoundEvents( void ) {
+	unsigned	head, tail;
+
+	head = s_mixer.head;
+	Job_MemoryBarrier();
+
+	for ( tail = s_mixer.tail ; tail != head ; tail++ ) {
+		S_ApplySoundEvent( &s_mixer.events[ tail & ( MAX_SOUND_EVENTS - 1 ) ] );
+	}
+
+	// the slots must be read before the producer can reuse them
+	Job_MemoryBarrier();
+	s_mixer.tail = tail;
+}
+
+/*
+=================
+S_LockMixer
+
+Waits for the mixer thread to finish painting and catches up with the
+published events, so the main thread can change the channels.  Callers
+that depend on the events of the current frame commit them first.
+=================
+*/
+void S_LockMixer( void ) {
+	if ( !s_mixer.active ) {
+		return;
+	}
+	Job_Lock( &s_mixer.lock );
+	S_DrainSoundEvents();
+}
+
+/*
+=================
+S_UnlockMixer
+=================
+*/
+void S_UnlockMixer( void ) {
+	if ( !s_mixer.active ) {
+		return;
+	}
+	Job_Unlock( &s_mixer.lock );
+}
+
+/*
+=================
+S_Milliseconds
+
+Event times, scripted by s_mixthreadtest so its runs can be compared
+=================
+*/
+static int S_Milliseconds( void ) {
+	if ( s_mixer.offline ) {
+		return s_mixer.offlineTime;
+	}
+	return Com_Milliseconds();
+}
+
+/*
+=================
+S_CapturingVideo
+
+Only the main thread hands audio to the AVI, the mixer thread leaves it
+alone in the frames before S_Update notices a capture started
+=================
+*/
+qboolean S_CapturingVideo( void ) {
+	return !s_mixer.threadPainting && CL_VideoRecording();
+}
+
 
 // ====================================================================
 // User-setable variables
@@ -104,11 +289,8 @@ void S_Base_SoundInfo(void) {
 		Com_Printf("%5d submission_chunk\n", dma.submission_chunk);
 		Com_Printf("%5d speed\n", dma.speed);
 		Com_Printf("%p dma buffer\n", dma.buffer);
-		if ( s_backgroundStream ) {
-			Com_Printf("Background file: %s\n", s_backgroundLoop );
-		} else {
-			Com_Printf("No background file.\n" );
-		}
+		S_MusicInfo();
+		S_DisplayFreeMemory();
 
 	}
 	Com_Printf("----------------------\n" );
@@ -187,14 +369,14 @@ void S_ChannelFree(channel_t *v) {
 	freelist = (channel_t*)v;
 }
 
-channel_t*	S_ChannelMalloc( void ) {
+channel_t*	S_ChannelMalloc( int time ) {
 	channel_t *v;
 	if (freelist == NULL) {
 		return NULL;
 	}
 	v = freelist;
 	freelist = *(channel_t **)freelist;
-	v->allocTime = Com_Milliseconds();
+	v->allocTime = time;
 	return v;
 }
 
@@ -368,6 +550,12 @@ sfxHandle_t	S_Base_RegisterSound( const char *name, qboolean compressed ) {
 	sfx->inMemory = qfalse;
 	sfx->soundCompressed = compressed;
 
+	// a sound that is there gets decoded the first time it is played,
+	// so registering a roster of characters doesn't decode every sound
+	if ( s_lazyLoad->integer && sfx->soundName[0] != '*' && S_CodecExists( sfx->soundName ) ) {
+		return sfx - s_knownSfx;
+	}
+
   S_memoryLoad(sfx);
 
 	if ( sfx->defaultSound ) {
@@ -398,12 +586,71 @@ void S_Base_BeginRegistration( void ) {
 }
 
 void S_memoryLoad(sfx_t	*sfx) {
+	// making room may free sounds the mixer thread is playing
+	S_LockMixer();
+
 	// load the sound file
 	if ( !S_LoadSound ( sfx ) ) {
 //		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't load sound: %s\n", sfx->soundName );
 		sfx->defaultSound = qtrue;
 	}
 	sfx->inMemory = qtrue;
+
+	S_UnlockMixer();
+}
+
+/*
+=================
+S_LoadBench_f
+
+Registers every known sound again, decoding it right away and then
+the s_lazyLoad way, and reports the time and the resident memory.
+Load a map with the whole roster of characters first.
+=================
+*/
+void S_LoadBench_f( void ) {
+	int		i, pass, start, msec[2], resident[2], count;
+	sfx_t	*sfx;
+
+	if ( !s_soundStarted || s_numSfx <= 1 ) {
+		Com_Printf( "no sounds registered\n" );
+		return;
+	}
+
+	S_Base_StopAllSounds();
+
+	count = 0;
+	for ( pass = 0 ; pass < 2 ; pass++ ) {
+		S_LockMixer();
+		for ( i = 1 ; i < s_numSfx ; i++ ) {
+			if ( s_knownSfx[i].inMemory && !s_knownSfx[i].defaultSound ) {
+				S_FreeSound( &s_knownSfx[i] );
+			}
+		}
+		S_UnlockMixer();
+
+		start = Sys_Milliseconds();
+		for ( i = 1 ; i < s_numSfx ; i++ ) {
+			sfx = &s_knownSfx[i];
+			if ( sfx->defaultSound || sfx->soundName[0] == '*' ) {
+				continue;
+			}
+			if ( !pass ) {
+				S_memoryLoad( sfx );
+				count++;
+			} else {
+				S_CodecExists( sfx->soundName );
+			}
+		}
+		msec[pass] = Sys_Milliseconds() - start;
+		resident[pass] = SND_Resident();
+	}
+
+	// the sounds load again as they are played
+	Com_Printf( "%i sounds\n", count );
+	Com_Printf( "decoded: %5i msec, %6i KB resident\n", msec[0], resident[0] / 1024 );
+	Com_Printf( "   lazy: %5i msec, %6i KB resident\n", msec[1], resident[1] / 1024 );
+	S_DisplayFreeMemory();
 }
 
 //=============================================================================
@@ -473,44 +720,20 @@ void S_SpatializeOrigin (vec3_t origin, int master_vol, int *left_vol, int *righ
 
 /*
 ====================
-S_StartSound
+S_StartSoundOnChannel
 
-Validates the parms and ques the sound up
-if pos is NULL, the sound will be dynamically sourced from the entity
-Entchannel 0 will never override a playing sound
+Picks a channel for a sound S_StartSound has validated and loaded
 ====================
 */
-void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t sfxHandle ) {
+static void S_StartSoundOnChannel( const vec3_t origin, int entityNum, int entchannel, sfx_t *sfx, int time ) {
 	channel_t	*ch;
-	sfx_t		*sfx;
-  int i, oldest, chosen, time;
+  int i, oldest, chosen;
   int	inplay, allowed;
 
-	if ( !s_soundStarted || s_soundMuted ) {
-		return;
-	}
-
-	if ( !origin && ( entityNum < 0 || entityNum > MAX_GENTITIES ) ) {
-		Com_Error( ERR_DROP, "S_StartSound: bad entitynum %i", entityNum );
-	}
-
-	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
-		Com_Printf( S_COLOR_YELLOW "S_StartSound: handle %i out of range\n", sfxHandle );
-		return;
-	}
-
-	sfx = &s_knownSfx[ sfxHandle ];
-
-	if (sfx->inMemory == qfalse) {
-		S_memoryLoad(sfx);
-	}
-
-	if ( s_show->integer == 1 ) {
-		Com_Printf( "%i : %s\n", s_paintedtime, sfx->soundName );
+	if ( !sfx->inMemory ) {
+		return;		// freed again while the event was queued
 	}
 
-	time = Com_Milliseconds();
-
 //	Com_Printf("playing %s\n", sfx->soundName);
 	// pick a channel to play on
 
@@ -539,7 +762,7 @@ void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t
 
 	sfx->lastTimeUsed = time;
 
-	ch = S_ChannelMalloc();	// entityNum, entchannel);
+	ch = S_ChannelMalloc( time );	// entityNum, entchannel);
 	if (!ch) {
 		ch = s_channels;
 
@@ -570,7 +793,11 @@ void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t
 					}
 				}
 				if (chosen == -1) {
-					Com_Printf("dropping sound\n");
+					if ( s_mixer.active ) {
+						s_mixer.dropped++;		// reported by S_Update
+					} else {
+						Com_Printf("dropping sound\n");
+					}
 					return;
 				}
 			}
@@ -596,6 +823,64 @@ void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t
 	ch->doppler = qfalse;
 }
 
+/*
+====================
+S_StartSound
+
+Validates the parms and ques the sound up
+if pos is NULL, the sound will be dynamically sourced from the entity
+Entchannel 0 will never override a playing sound
+====================
+*/
+void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t sfxHandle ) {
+	sfx_t		*sfx;
+	soundEvent_t	*ev;
+	int			time;
+
+	if ( !s_soundStarted || s_soundMuted ) {
+		return;
+	}
+
+	if ( !origin && ( entityNum < 0 || entityNum > MAX_GENTITIES ) ) {
+		Com_Error( ERR_DROP, "S_StartSound: bad entitynum %i", entityNum );
+	}
+
+	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
+		Com_Printf( S_COLOR_YELLOW "S_StartSound: handle %i out of range\n", sfxHandle );
+		return;
+	}
+
+	sfx = &s_knownSfx[ sfxHandle ];
+
+	if (sfx->inMemory == qfalse) {
+		S_memoryLoad(sfx);
+	}
+
+	if ( s_show->integer == 1 ) {
+		Com_Printf( "%i : %s\n", s_paintedtime, sfx->soundName );
+	}
+
+	time = S_Milliseconds();
+
+	if ( s_mixer.active ) {
+		// keep S_EvictSound off it until the mixer gets to it
+		sfx->lastTimeUsed = time;
+
+		ev = S_QueueSoundEvent( SEV_START_SOUND );
+		ev->fixedOrigin = ( origin != NULL );
+		if ( origin ) {
+			VectorCopy( origin, ev->origin );
+		}
+		ev->entityNum = entityNum;
+		ev->entchannel = entchannel;
+		ev->sfx = sfx;
+		ev->time = time;
+		return;
+	}
+
+	S_StartSoundOnChannel( origin, entityNum, entchannel, sfx, time );
+}
+
 
 /*
 ==================
@@ -612,23 +897,17 @@ void S_Base_StartLocalSound( sfxHandle_t sfxHandle, int channelNum ) {
 		return;
 	}
 
-	S_Base_StartSound (NULL, listener_number, channelNum, sfxHandle );
+	S_Base_StartSound (NULL, s_localListener, channelNum, sfxHandle );
 }
 
 
 /*
 ==================
-S_ClearSoundBuffer
-
-If we are about to perform file access, clear the buffer
-so sound doesn't stutter.
+S_ClearChannels
 ==================
 */
-void S_Base_ClearSoundBuffer( void ) {
+static void S_ClearChannels( void ) {
 	int		clear;
-		
-	if (!s_soundStarted)
-		return;
 
 	// stop looping sounds
 	Com_Memset(loopSounds, 0, MAX_GENTITIES*sizeof(loopSound_t));
@@ -650,6 +929,25 @@ void S_Base_ClearSoundBuffer( void ) {
 	SNDDMA_Submit ();
 }
 
+/*
+==================
+S_ClearSoundBuffer
+
+If we are about to perform file access, clear the buffer
+so sound doesn't stutter.
+==================
+*/
+void S_Base_ClearSoundBuffer( void ) {
+	if (!s_soundStarted)
+		return;
+
+	// nothing queued this frame may start after the clear
+	S_CommitSoundEvents();
+	S_LockMixer();
+	S_ClearChannels();
+	S_UnlockMixer();
+}
+
 /*
 ==================
 S_StopAllSounds
@@ -674,59 +972,59 @@ continuous looping sounds are added each frame
 ==============================================================
 */
 
-void S_Base_StopLoopingSound(int entityNum) {
+static void S_StopLoopSound( int entityNum ) {
 	loopSounds[entityNum].active = qfalse;
 //	loopSounds[entityNum].sfx = 0;
 	loopSounds[entityNum].kill = qfalse;
 }
 
+void S_Base_StopLoopingSound(int entityNum) {
+	soundEvent_t	*ev;
+
+	if ( s_mixer.active ) {
+		ev = S_QueueSoundEvent( SEV_STOP_LOOP );
+		ev->entityNum = entityNum;
+		return;
+	}
+
+	S_StopLoopSound( entityNum );
+}
+
 /*
 ==================
 S_ClearLoopingSounds
 
 ==================
 */
-void S_Base_ClearLoopingSounds( qboolean killall ) {
+static void S_ClearLoopSounds( qboolean killall ) {
 	int i;
 	for ( i = 0 ; i < MAX_GENTITIES ; i++) {
 		if (killall || loopSounds[i].kill == qtrue || (loopSounds[i].sfx && loopSounds[i].sfx->soundLength == 0)) {
 			loopSounds[i].kill = qfalse;
-			S_Base_StopLoopingSound(i);
+			S_StopLoopSound(i);
 		}
 	}
 	numLoopChannels = 0;
 }
 
-/*
-==================
-S_AddLoopingSound
-
-Called during entity generation for a frame
-Include velocity in case I get around to doing doppler...
-==================
-*/
-void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
-	sfx_t *sfx;
-
-	if ( !s_soundStarted || s_soundMuted ) {
-		return;
-	}
+void S_Base_ClearLoopingSounds( qboolean killall ) {
+	soundEvent_t	*ev;
 
-	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
-		Com_Printf( S_COLOR_YELLOW "S_AddLoopingSound: handle %i out of range\n", sfxHandle );
+	if ( s_mixer.active ) {
+		ev = S_QueueSoundEvent( SEV_CLEAR_LOOPS );
+		ev->killall = killall;
 		return;
 	}
 
-	sfx = &s_knownSfx[ sfxHandle ];
-
-	if (sfx->inMemory == qfalse) {
-		S_memoryLoad(sfx);
-	}
-
-	if ( !sfx->soundLength ) {
-		Com_Error( ERR_DROP, "%s has length 0", sfx->soundName );
-	}
+	S_ClearLoopSounds( killall );
+}
 
+/*
+==================
+S_SetLoopSound
+==================
+*/
+static void S_SetLoopSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfx_t *sfx, int framecount ) {
 	VectorCopy( origin, loopSounds[entityNum].origin );
 	VectorCopy( velocity, loopSounds[entityNum].velocity );
 	loopSounds[entityNum].active = qtrue;
@@ -744,7 +1042,7 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 		lena = DistanceSquared(loopSounds[listener_number].origin, loopSounds[entityNum].origin);
 		VectorAdd(loopSounds[entityNum].origin, loopSounds[entityNum].velocity, out);
 		lenb = DistanceSquared(loopSounds[listener_number].origin, out);
-		if ((loopSounds[entityNum].framenum+1) != cls.framecount) {
+		if ((loopSounds[entityNum].framenum+1) != framecount) {
 			loopSounds[entityNum].oldDopplerScale = 1.0;
 		} else {
 			loopSounds[entityNum].oldDopplerScale = loopSounds[entityNum].dopplerScale;
@@ -757,7 +1055,7 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 		}
 	}
 
-	loopSounds[entityNum].framenum = cls.framecount;
+	loopSounds[entityNum].framenum = framecount;
 }
 
 /*
@@ -768,15 +1066,16 @@ Called during entity generation for a frame
 Include velocity in case I get around to doing doppler...
 ==================
 */
-void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
+void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
 	sfx_t *sfx;
+	soundEvent_t	*ev;
 
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
 	}
 
 	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
-		Com_Printf( S_COLOR_YELLOW "S_AddRealLoopingSound: handle %i out of range\n", sfxHandle );
+		Com_Printf( S_COLOR_YELLOW "S_AddLoopingSound: handle %i out of range\n", sfxHandle );
 		return;
 	}
 
@@ -789,6 +1088,26 @@ void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_
 	if ( !sfx->soundLength ) {
 		Com_Error( ERR_DROP, "%s has length 0", sfx->soundName );
 	}
+
+	if ( s_mixer.active ) {
+		ev = S_QueueSoundEvent( SEV_ADD_LOOP );
+		ev->entityNum = entityNum;
+		VectorCopy( origin, ev->origin );
+		VectorCopy( velocity, ev->velocity );
+		ev->sfx = sfx;
+		ev->framecount = cls.framecount;
+		return;
+	}
+
+	S_SetLoopSound( entityNum, origin, velocity, sfx, cls.framecount );
+}
+
+/*
+==================
+S_SetRealLoopSound
+==================
+*/
+static void S_SetRealLoopSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfx_t *sfx ) {
 	VectorCopy( origin, loopSounds[entityNum].origin );
 	VectorCopy( velocity, loopSounds[entityNum].velocity );
 	loopSounds[entityNum].sfx = sfx;
@@ -797,19 +1116,62 @@ void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_
 	loopSounds[entityNum].doppler = qfalse;
 }
 
-
-
 /*
 ==================
-S_AddLoopSounds
+S_AddLoopingSound
 
-Spatialize all of the looping sounds.
+Called during entity generation for a frame
+Include velocity in case I get around to doing doppler...
+==================
+*/
+void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
+	sfx_t *sfx;
+	soundEvent_t	*ev;
+
+	if ( !s_soundStarted || s_soundMuted ) {
+		return;
+	}
+
+	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
+		Com_Printf( S_COLOR_YELLOW "S_AddRealLoopingSound: handle %i out of range\n", sfxHandle );
+		return;
+	}
+
+	sfx = &s_knownSfx[ sfxHandle ];
+
+	if (sfx->inMemory == qfalse) {
+		S_memoryLoad(sfx);
+	}
+
+	if ( !sfx->soundLength ) {
+		Com_Error( ERR_DROP, "%s has length 0", sfx->soundName );
+	}
+
+	if ( s_mixer.active ) {
+		ev = S_QueueSoundEvent( SEV_ADD_REAL_LOOP );
+		ev->entityNum = entityNum;
+		VectorCopy( origin, ev->origin );
+		VectorCopy( velocity, ev->velocity );
+		ev->sfx = sfx;
+		return;
+	}
+
+	S_SetRealLoopSound( entityNum, origin, velocity, sfx );
+}
+
+
+
+/*
+==================
+S_AddLoopSounds
+
+Spatialize all of the looping sounds.
 All sounds are on the same cycle, so any duplicates can just
 sum up the channel multipliers.
 ==================
 */
-void S_AddLoopSounds (float attenuation) {
-	int			i, j, time;
+void S_AddLoopSounds (float attenuation, int time) {
+	int			i, j;
 	int			left_total, right_total, left, right;
 	channel_t	*ch;
 	loopSound_t	*loop, *loop2;
@@ -818,8 +1180,6 @@ void S_AddLoopSounds (float attenuation) {
 
 	numLoopChannels = 0;
 
-	time = Com_Milliseconds();
-
 	loopFrame++;
 	for ( i = 0 ; i < MAX_GENTITIES ; i++) {
 		loop = &loopSounds[i];
@@ -937,6 +1297,8 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int s_chan
 	if ( (stream < 0) || (stream >= MAX_RAW_STREAMS) ) {
 		return;
 	}
+
+	S_LockMixer();
 	
 	rawsamples = s_rawsamples[stream];
 
@@ -1026,6 +1388,8 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int s_chan
 	if ( s_rawend[stream] > s_soundtime + MAX_RAW_SAMPLES ) {
 		Com_DPrintf( "S_Base_RawSamples: overflowed %i > %i\n", s_rawend[stream], s_soundtime );
 	}
+
+	S_UnlockMixer();
 }
 
 //=============================================================================
@@ -1038,29 +1402,33 @@ let the sound system know where an entity currently is
 ======================
 */
 void S_Base_UpdateEntityPosition( int entityNum, const vec3_t origin ) {
+	soundEvent_t	*ev;
+
 	if ( entityNum < 0 || entityNum > MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "S_UpdateEntityPosition: bad entitynum %i", entityNum );
 	}
+
+	if ( s_mixer.active ) {
+		ev = S_QueueSoundEvent( SEV_ENTITY_POSITION );
+		ev->entityNum = entityNum;
+		VectorCopy( origin, ev->origin );
+		return;
+	}
+
 	VectorCopy( origin, loopSounds[entityNum].origin );
 }
 
 
 /*
 ============
-S_Respatialize
-
-Change the volumes of all the playing sounds for changes in their positions
+S_RespatializeChannels
 ============
 */
-void S_Base_Respatialize( int entityNum, const vec3_t head, vec3_t axis[3], int inwater, float attenuation ) {
+static void S_RespatializeChannels( int entityNum, const vec3_t head, vec3_t axis[3], float attenuation, int time ) {
 	int			i;
 	channel_t	*ch;
 	vec3_t		origin;
 
-	if ( !s_soundStarted || s_soundMuted ) {
-		return;
-	}
-
 	listener_number = entityNum;
 	VectorCopy(head, listener_origin);
 	VectorCopy(axis[0], listener_axis[0]);
@@ -1089,7 +1457,38 @@ void S_Base_Respatialize( int entityNum, const vec3_t head, vec3_t axis[3], int
 	}
 
 	// add loopsounds
-	S_AddLoopSounds (attenuation);
+	S_AddLoopSounds (attenuation, time);
+}
+
+/*
+============
+S_Respatialize
+
+Change the volumes of all the playing sounds for changes in their positions
+============
+*/
+void S_Base_Respatialize( int entityNum, const vec3_t head, vec3_t axis[3], int inwater, float attenuation ) {
+	soundEvent_t	*ev;
+	int			time;
+
+	if ( !s_soundStarted || s_soundMuted ) {
+		return;
+	}
+
+	s_localListener = entityNum;
+	time = S_Milliseconds();
+
+	if ( s_mixer.active ) {
+		ev = S_QueueSoundEvent( SEV_RESPATIALIZE );
+		ev->entityNum = entityNum;
+		VectorCopy( head, ev->origin );
+		AxisCopy( axis, ev->axis );
+		ev->attenuation = attenuation;
+		ev->time = time;
+		return;
+	}
+
+	S_RespatializeChannels( entityNum, head, axis, attenuation, time );
 }
 
 
@@ -1166,6 +1565,27 @@ void S_Base_Update( void ) {
 	// add raw data from streamed samples
 	S_UpdateBackgroundTrack();
 
+	if ( s_mixer.active ) {
+		if ( s_mixer.dropped != s_mixer.droppedReported ) {
+			s_mixer.droppedReported = s_mixer.dropped;
+			Com_Printf ("dropping sound\n");
+		}
+
+		// hand the frame's sounds to the mixer thread
+		S_CommitSoundEvents();
+
+		// video capture needs the sound mixed in step with the frames
+		s_mixer.mainMixes = CL_VideoRecording();
+		if ( !s_mixer.mainMixes ) {
+			return;
+		}
+
+		S_LockMixer();
+		S_Update_();
+		S_UnlockMixer();
+		return;
+	}
+
 	// mix some sound
 	S_Update_();
 }
@@ -1179,7 +1599,7 @@ void S_GetSoundtime(void)
 	
 	fullsamples = dma.samples / dma.channels;
 
-	if( CL_VideoRecording( ) )
+	if( S_CapturingVideo( ) )
 	{
 		s_soundtime += (int)ceil( dma.speed / cl_aviFrameRate->value );
 		return;
@@ -1196,7 +1616,12 @@ void S_GetSoundtime(void)
 		{	// time to chop things off to avoid 32 bit limits
 			buffers = 0;
 			s_paintedtime = fullsamples;
-			S_Base_StopAllSounds ();
+			if ( s_mixer.active ) {
+				// the mixer is locked and the music belongs to the main thread
+				S_ClearChannels ();
+			} else {
+				S_Base_StopAllSounds ();
+			}
 		}
 	}
 	oldsamplepos = samplepos;
@@ -1232,7 +1657,7 @@ void S_Update_(void) {
 		return;
 	}
 
-	thisTime = Com_Milliseconds();
+	thisTime = s_mixer.active ? Sys_Milliseconds() : Com_Milliseconds();
 
 	// Updates s_soundtime
 	S_GetSoundtime();
@@ -1283,6 +1708,349 @@ void S_Update_(void) {
 
 
 
+/*
+===============================================================================
+
+mixer thread
+
+===============================================================================
+*/
+
+/*
+============
+S_PaintOffline
+
+Mixes to endtime without looking at the device, for s_mixthreadtest
+============
+*/
+static void S_PaintOffline( int endtime ) {
+	s_soundtime = s_paintedtime;
+	S_ScanChannelStarts();
+	S_PaintChannels( endtime );
+}
+
+/*
+============
+S_ApplySoundEvent
+
+Makes the call the main thread queued
+============
+*/
+static void S_ApplySoundEvent( soundEvent_t *ev ) {
+	switch ( ev->type ) {
+	case SEV_START_SOUND:
+		S_StartSoundOnChannel( ev->fixedOrigin ? ev->origin : NULL, ev->entityNum, ev->entchannel, ev->sfx, ev->time );
+		break;
+	case SEV_ADD_LOOP:
+		S_SetLoopSound( ev->entityNum, ev->origin, ev->velocity, ev->sfx, ev->framecount );
+		break;
+	case SEV_ADD_REAL_LOOP:
+		S_SetRealLoopSound( ev->entityNum, ev->origin, ev->velocity, ev->sfx );
+		break;
+	case SEV_STOP_LOOP:
+		S_StopLoopSound( ev->entityNum );
+		break;
+	case SEV_CLEAR_LOOPS:
+		S_ClearLoopSounds( ev->killall );
+		break;
+	case SEV_ENTITY_POSITION:
+		VectorCopy( ev->origin, loopSounds[ev->entityNum].origin );
+		break;
+	case SEV_RESPATIALIZE:
+		S_RespatializeChannels( ev->entityNum, ev->origin, ev->axis, ev->attenuation, ev->time );
+		break;
+	case SEV_PAINT:
+		S_PaintOffline( ev->endtime );
+		break;
+	}
+}
+
+/*
+============
+S_MixerThread
+============
+*/
+static void S_MixerThread( void *arg ) {
+	while ( !s_mixer.quit ) {
+		if ( s_mixer.lock ) {
+			// the main thread has the channels, don't spin on them
+			Sys_Sleep( 1 );
+			continue;
+		}
+		Job_Lock( &s_mixer.lock );
+
+		S_DrainSoundEvents();
+
+		if ( !s_mixer.mainMixes && !s_mixer.offline ) {
+			s_mixer.threadPainting = qtrue;
+			S_Update_();
+			s_mixer.threadPainting = qfalse;
+		}
+
+		Job_Unlock( &s_mixer.lock );
+
+		Sys_Sleep( MIXER_THREAD_MSEC );
+	}
+}
+
+/*
+============
+S_StartMixerThread
+============
+*/
+static void S_StartMixerThread( void ) {
+	s_mixer.head = s_mixer.tail = s_mixer.write = 0;
+	s_mixer.quit = qfalse;
+	s_mixer.mainMixes = qfalse;
+
+	// the sound calls have to queue before the thread looks at anything
+	s_mixer.active = qtrue;
+	s_mixer.thread = Sys_CreateThread( S_MixerThread, NULL );
+	if ( !s_mixer.thread ) {
+		s_mixer.active = qfalse;
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't start the mixer thread\n" );
+	}
+}
+
+/*
+============
+S_StopMixerThread
+
+Whatever is still queued is applied before the calls go direct again
+============
+*/
+static void S_StopMixerThread( void ) {
+	if ( !s_mixer.thread ) {
+		return;
+	}
+
+	S_CommitSoundEvents();
+	s_mixer.quit = qtrue;
+	Sys_JoinThread( s_mixer.thread );
+	s_mixer.thread = NULL;
+
+	S_DrainSoundEvents();
+	s_mixer.active = qfalse;
+}
+
+/*
+===============================================================================
+
+MIXER THREAD TEST
+
+s_mixthreadtest plays a scripted game through the sound calls twice,
+once mixed directly and once through the event queue and the mixer
+thread.  The script drives the clock and the painting, so the two
+renders must come out the same.
+
+===============================================================================
+*/
+
+#define	THREADTEST_FPS			60
+#define	THREADTEST_SFX			4
+#define	THREADTEST_LOOPS		24
+#define	THREADTEST_LISTENER		0
+
+/*
+============
+S_MixThreadTestRun
+============
+*/
+static void S_MixThreadTestRun( sfxHandle_t firstSfx, int frames ) {
+	vec3_t			origin, velocity, head, angles, axis[3];
+	soundEvent_t	*ev;
+	float			phase;
+	int				seed;
+	int				frame, i;
+
+	S_Base_ClearSoundBuffer();
+	s_soundtime = s_paintedtime = 0;
+	sfxScratchPointer = NULL;
+	seed = 0x7e57;
+
+	VectorClear( head );
+	AxisClear( axis );
+	s_mixer.offlineTime = 0;
+	S_Base_Respatialize( THREADTEST_LISTENER, head, axis, 0, SOUND_ATTENUATE );
+
+	for ( frame = 0 ; frame < frames ; frame++ ) {
+		s_mixer.offlineTime = frame * 1000 / THREADTEST_FPS;
+
+		// what cgame does with its entities each frame
+		S_Base_ClearLoopingSounds( qfalse );
+		for ( i = 1 ; i <= THREADTEST_LOOPS ; i++ ) {
+			phase = frame * 0.01f * i;
+			origin[0] = cos( phase ) * 64 * i;
+			origin[1] = sin( phase ) * 64 * i;
+			origin[2] = i * 8;
+			velocity[0] = -sin( phase ) * 40 * i;
+			velocity[1] = cos( phase ) * 40 * i;
+			velocity[2] = 0;
+
+			if ( i & 1 ) {
+				S_Base_AddLoopingSound( i, origin, velocity, firstSfx + i % THREADTEST_SFX );
+			} else {
+				S_Base_AddRealLoopingSound( i, origin, vec3_origin, firstSfx + i % THREADTEST_SFX );
+			}
+			S_Base_UpdateEntityPosition( i, origin );
+		}
+
+		if ( !( Q_rand( &seed ) & 3 ) ) {
+			i = 1 + ( Q_rand( &seed ) & 0x7fff ) % THREADTEST_LOOPS;
+			S_Base_StartSound( NULL, i, CHAN_AUTO, firstSfx + ( Q_rand( &seed ) & 3 ) );
+		}
+		if ( !( Q_rand( &seed ) & 7 ) ) {
+			origin[0] = Q_crandom( &seed ) * 1024;
+			origin[1] = Q_crandom( &seed ) * 1024;
+			origin[2] = 0;
+			S_Base_StartSound( origin, ENTITYNUM_WORLD, CHAN_AUTO, firstSfx + ( Q_rand( &seed ) & 3 ) );
+		}
+		if ( !( frame % THREADTEST_FPS ) ) {
+			S_Base_StartLocalSound( firstSfx, CHAN_LOCAL_SOUND );
+		}
+
+		head[0] = frame * 4;
+		VectorSet( angles, 0, frame * 0.5f, 0 );
+		AnglesToAxis( angles, axis );
+		S_Base_Respatialize( THREADTEST_LISTENER, head, axis, 0, SOUND_ATTENUATE );
+
+		// mix the frame
+		if ( s_mixer.active ) {
+			ev = S_QueueSoundEvent( SEV_PAINT );
+			ev->endtime = ( frame + 1 ) * dma.speed / THREADTEST_FPS;
+			S_CommitSoundEvents();
+		} else {
+			S_PaintOffline( ( frame + 1 ) * dma.speed / THREADTEST_FPS );
+		}
+	}
+
+	// wait for the mixer to catch up
+	S_LockMixer();
+	S_UnlockMixer();
+}
+
+/*
+============
+S_MixThreadTest_f
+
+s_mixthreadtest [seconds]
+============
+*/
+void S_MixThreadTest_f( void ) {
+	static const int	methods[THREADTEST_SFX] = { 0, 0, 1, 3 };
+	short		*render[2];
+	dma_t		savedDma;
+	qboolean	wasThreaded, threaded;
+	sfxHandle_t	firstSfx;
+	int			savedNumSfx, savedSoundtime, savedPaintedTime;
+	int			seconds, frames, samples, seed;
+	int			numDiffs;
+	int			i;
+
+	if ( !s_soundStarted || s_soundMuted ) {
+		Com_Printf( "s_mixthreadtest: sound is not playing\n" );
+		return;
+	}
+	if ( CL_VideoRecording() ) {
+		Com_Printf( "s_mixthreadtest: not while recording video\n" );
+		return;
+	}
+	if ( s_numSfx + THREADTEST_SFX > MAX_SFX ) {
+		Com_Printf( "s_mixthreadtest: no room for the test sounds\n" );
+		return;
+	}
+
+	seconds = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 10;
+	if ( seconds < 1 ) {
+		seconds = 1;
+	}
+
+	// the direct run needs the calls to go straight to the channels
+	wasThreaded = s_mixer.active;
+	S_StopMixerThread();
+
+	// keep the audio callback away from dma while it is swapped out
+	SNDDMA_BeginPainting();
+
+	savedDma = dma;
+	savedNumSfx = s_numSfx;
+	savedSoundtime = s_soundtime;
+	savedPaintedTime = s_paintedtime;
+
+	dma.channels = 2;
+	dma.samplebits = 16;
+	if ( !dma.speed ) {
+		dma.speed = 22050;
+	}
+	frames = seconds * THREADTEST_FPS;
+	samples = frames * dma.speed / THREADTEST_FPS * 2;
+	for ( dma.samples = 1 ; dma.samples < samples ; dma.samples <<= 1 ) {
+	}
+	dma.buffer = Z_Malloc( dma.samples * sizeof( short ) );
+	render[0] = Z_Malloc( samples * sizeof( short ) );
+	render[1] = Z_Malloc( samples * sizeof( short ) );
+
+	seed = 0x5e1f;
+	firstSfx = s_numSfx;
+	for ( i = 0 ; i < THREADTEST_SFX ; i++ ) {
+		S_MixBenchSound( &s_knownSfx[s_numSfx++], methods[i], dma.speed * ( i + 1 ) / 2 + 777 * i, &seed );
+	}
+
+	s_mixer.offline = qtrue;
+
+	S_MixThreadTestRun( firstSfx, frames );
+	Com_Memcpy( render[0], dma.buffer, samples * sizeof( short ) );
+
+	S_StartMixerThread();
+	threaded = s_mixer.active;
+	if ( threaded ) {
+		Com_Memset( dma.buffer, 0, dma.samples * sizeof( short ) );
+		S_MixThreadTestRun( firstSfx, frames );
+		Com_Memcpy( render[1], dma.buffer, samples * sizeof( short ) );
+		S_StopMixerThread();
+	}
+
+	s_mixer.offline = qfalse;
+
+	numDiffs = 0;
+	for ( i = 0 ; i < samples ; i++ ) {
+		if ( render[0][i] != render[1][i] ) {
+			numDiffs++;
+		}
+	}
+
+	// put the real sound back
+	for ( i = firstSfx ; i < s_numSfx ; i++ ) {
+		S_MixBenchFreeSound( &s_knownSfx[i] );
+		Com_Memset( &s_knownSfx[i], 0, sizeof( s_knownSfx[i] ) );
+	}
+	s_numSfx = savedNumSfx;
+
+	Z_Free( render[1] );
+	Z_Free( render[0] );
+	Z_Free( dma.buffer );
+	dma = savedDma;
+	s_soundtime = savedSoundtime;
+	s_paintedtime = savedPaintedTime;
+	sfxScratchPointer = NULL;
+	S_Base_ClearSoundBuffer();
+
+	SNDDMA_Submit();
+
+	if ( wasThreaded ) {
+		S_StartMixerThread();
+	}
+
+	Com_Printf( "%i frames at %i fps, %i loops, %i samples\n", frames, THREADTEST_FPS, THREADTEST_LOOPS, samples );
+	if ( !threaded ) {
+		Com_Printf( S_COLOR_RED "FAILED: couldn't start the mixer thread\n" );
+	} else if ( numDiffs ) {
+		Com_Printf( S_COLOR_RED "FAILED: %i samples differ between the direct and threaded mix\n", numDiffs );
+	} else {
+		Com_Printf( "direct and threaded mix are identical\n" );
+	}
+}
+
 /*
 ===============================================================================
 
@@ -1291,16 +2059,222 @@ background music functions
 ===============================================================================
 */
 
+/*
+The background track is decoded ahead into a ring buffer by a job,
+so Vorbis doesn't run on the main thread while the job threads are
+up.  The compressed file is read into memory when the stream is
+opened, which is the only part that needs the file system.
+
+The loop track gets a second ring.  cg_music passes the next track of
+its playlist as the loop, so it is opened and decoding before cgame
+asks for it, and a track that runs out early goes straight into it.
+*/
+
+#define	MUSIC_RING_BYTES	0x40000		// must be a power of two, about 1.5 seconds of 44khz stereo
+#define	MUSIC_DECODE_BYTES	0x4000		// handed to the main thread in pieces this big
+
+typedef struct {
+	snd_stream_t		*stream;
+	char				name[MAX_QPATH];
+	int					frameBytes;
+	volatile int		readPos;		// only the main thread moves it
+	volatile int		writePos;		// only the decoder moves it
+	volatile qboolean	eof;
+	jobCounter_t		decoding;
+	byte				ring[MUSIC_RING_BYTES];
+} musicStream_t;
+
+static musicStream_t	s_musicStreams[2];
+static musicStream_t	*s_music = &s_musicStreams[0];		// playing
+static musicStream_t	*s_musicNext = &s_musicStreams[1];	// s_backgroundLoop, decoded ahead
+static qboolean			s_musicAdvanced;	// s_music was started by the last track running out
+static qboolean			s_musicLoopOpened;	// s_musicNext was tried for this track
+
+/*
+======================
+S_MusicDecodeJob
+
+Decodes into the free part of the ring, pieces at a time, or until
+it is full if pieces is 0
+======================
+*/
+static void S_MusicDecodeJob( void *data, int pieces ) {
+	musicStream_t	*m;
+	int				space, offset, bytes, r;
+
+	m = (musicStream_t *)data;
+
+	while ( !m->eof ) {
+		space = MUSIC_RING_BYTES - ( m->writePos - m->readPos );
+		offset = m->writePos & ( MUSIC_RING_BYTES - 1 );
+		bytes = MUSIC_RING_BYTES - offset;
+		if ( bytes > space ) {
+			bytes = space;
+		}
+		if ( bytes > MUSIC_DECODE_BYTES ) {
+			bytes = MUSIC_DECODE_BYTES;
+		}
+		bytes -= bytes % m->frameBytes;
+		if ( bytes <= 0 ) {
+			break;
+		}
+
+		// the main thread must see the samples before the new position
+		r = S_CodecReadStream( m->stream, bytes, m->ring + offset );
+		Job_MemoryBarrier();
+		m->writePos += r - r % m->frameBytes;
+		if ( r < bytes ) {
+			m->eof = qtrue;
+		}
+
+		if ( pieces && !--pieces ) {
+			break;
+		}
+	}
+}
+
+/*
+======================
+S_MusicDecode
+
+Keeps a job decoding while the ring has room.  Without job threads,
+or a stream that couldn't be read into memory, it decodes a piece
+at a time on the main thread instead.
+======================
+*/
+static void S_MusicDecode( musicStream_t *m ) {
+	if ( !m->stream || m->eof || m->decoding.value > 0 ) {
+		return;
+	}
+	if ( MUSIC_RING_BYTES - ( m->writePos - m->readPos ) < MUSIC_RING_BYTES / 4 ) {
+		return;
+	}
+
+	if ( !m->stream->data || Job_NumThreads() == 0 ) {
+		S_MusicDecodeJob( m, 2 );
+		return;
+	}
+
+	Job_Add( S_MusicDecodeJob, m, 0, &m->decoding, NULL );
+}
+
+/*
+======================
+S_MusicFinished
+======================
+*/
+static qboolean S_MusicFinished( musicStream_t *m ) {
+	if ( m->decoding.value > 0 ) {
+		return qfalse;
+	}
+	Job_MemoryBarrier();
+	return m->eof && m->writePos == m->readPos;
+}
+
+/*
+======================
+S_MusicClose
+======================
+*/
+static void S_MusicClose( musicStream_t *m ) {
+	if ( !m->stream ) {
+		return;
+	}
+	Job_Wait( &m->decoding );
+	S_CodecCloseStream( m->stream );
+	m->stream = NULL;
+	m->name[0] = 0;
+}
+
+/*
+======================
+S_MusicOpen
+======================
+*/
+static qboolean S_MusicOpen( musicStream_t *m, const char *name ) {
+	S_MusicClose( m );
+
+	m->stream = S_CodecOpenStream( name );
+	if ( !m->stream ) {
+		return qfalse;
+	}
+
+	// a stream that is still reading the file has to decode on this thread
+	if ( !S_CodecBufferStream( m->stream ) ) {
+		Com_DPrintf( S_COLOR_YELLOW "WARNING: couldn't buffer music file %s\n", name );
+	}
+
+	Q_strncpyz( m->name, name, sizeof( m->name ) );
+	m->frameBytes = m->stream->info.width * m->stream->info.channels;
+	m->readPos = 0;
+	m->writePos = 0;
+	m->eof = qfalse;
+
+	S_MusicDecode( m );
+	return qtrue;
+}
+
+/*
+======================
+S_MusicPrefetch
+
+Opens s_backgroundLoop in the second ring, so it is decoded ahead
+======================
+*/
+static void S_MusicPrefetch( void ) {
+	s_musicLoopOpened = qtrue;
+
+	if ( !s_backgroundLoop[0] ) {
+		return;
+	}
+	if ( s_musicNext->stream && !Q_stricmp( s_musicNext->name, s_backgroundLoop ) ) {
+		return;
+	}
+	S_MusicOpen( s_musicNext, s_backgroundLoop );
+}
+
+/*
+======================
+S_MusicSwap
+======================
+*/
+static void S_MusicSwap( void ) {
+	musicStream_t	*m;
+
+	S_MusicClose( s_music );
+	m = s_music;
+	s_music = s_musicNext;
+	s_musicNext = m;
+}
+
+/*
+======================
+S_MusicInfo
+======================
+*/
+static void S_MusicInfo( void ) {
+	if ( !s_music->stream ) {
+		Com_Printf("No background file.\n" );
+		return;
+	}
+	Com_Printf("Background file: %s\n", s_music->name );
+	if ( s_musicNext->stream ) {
+		Com_Printf("Next background file: %s, %i KB decoded ahead\n", s_musicNext->name,
+			( s_musicNext->writePos - s_musicNext->readPos ) / 1024 );
+	}
+}
+
 /*
 ======================
 S_StopBackgroundTrack
 ======================
 */
 void S_Base_StopBackgroundTrack( void ) {
-	if(!s_backgroundStream)
+	if ( !s_music->stream && !s_musicNext->stream )
 		return;
-	S_CodecCloseStream(s_backgroundStream);
-	s_backgroundStream = NULL;
+	S_MusicClose( s_music );
+	S_MusicClose( s_musicNext );
+	s_musicAdvanced = qfalse;
 	s_rawend[0] = 0;
 }
 
@@ -1324,26 +2298,55 @@ void S_Base_StartBackgroundTrack( const char *intro, const char *loop ){
 		return;
 	}
 
-	if( !loop ) {
-		s_backgroundLoop[0] = 0;
-	} else {
-		Q_strncpyz( s_backgroundLoop, loop, sizeof( s_backgroundLoop ) );
-	}
+	Q_strncpyz( s_backgroundLoop, loop, sizeof( s_backgroundLoop ) );
 
 	// close the background track, but DON'T reset s_rawend
 	// if restarting the same back ground track
-	if(s_backgroundStream)
-	{
-		S_CodecCloseStream(s_backgroundStream);
-		s_backgroundStream = NULL;
-	}
-
-	// Open stream
-	s_backgroundStream = S_CodecOpenStream(intro);
-	if(!s_backgroundStream) {
+	if ( s_musicAdvanced && s_music->stream && !Q_stricmp( s_music->name, intro ) ) {
+		// the last track ran out into this one already
+	} else if ( s_musicNext->stream && !Q_stricmp( s_musicNext->name, intro ) ) {
+		S_MusicSwap();
+	} else if ( !S_MusicOpen( s_music, intro ) ) {
 		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't open music file %s\n", intro );
 		return;
 	}
+
+	s_musicAdvanced = qfalse;
+	s_musicLoopOpened = qfalse;
+
+	// a different loop track is the next one of a playlist, have it
+	// ready.  A track looping on itself waits until it is decoded to
+	// the end, rather than holding the file twice.
+	if ( Q_stricmp( loop, intro ) ) {
+		S_MusicPrefetch();
+	}
+}
+
+/*
+======================
+S_AdvanceBackgroundTrack
+
+The playing track ran out, carry on with the loop track
+======================
+*/
+static qboolean S_AdvanceBackgroundTrack( void ) {
+	if ( !s_backgroundLoop[0] ) {
+		S_Base_StopBackgroundTrack();
+		return qfalse;
+	}
+
+	if ( !s_musicNext->stream || Q_stricmp( s_musicNext->name, s_backgroundLoop ) ) {
+		if ( !S_MusicOpen( s_musicNext, s_backgroundLoop ) ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: couldn't open music file %s\n", s_backgroundLoop );
+			S_Base_StopBackgroundTrack();
+			return qfalse;
+		}
+	}
+
+	S_MusicSwap();
+	s_musicAdvanced = qtrue;
+	s_musicLoopOpened = qfalse;
+	return qtrue;
 }
 
 /*
@@ -1352,13 +2355,14 @@ S_UpdateBackgroundTrack
 ======================
 */
 void S_UpdateBackgroundTrack( void ) {
+	musicStream_t	*m;
 	int		bufferSamples;
 	int		fileSamples;
-	byte	raw[30000];		// just enough to fit in a mac stack frame
 	int		fileBytes;
-	int		r;
+	int		available;
+	int		offset;
 
-	if(!s_backgroundStream) {
+	if ( !s_music->stream ) {
 		return;
 	}
 
@@ -1373,91 +2377,126 @@ void S_UpdateBackgroundTrack( void ) {
 	}
 
 	while ( s_rawend[0] < s_soundtime + MAX_RAW_SAMPLES ) {
+		m = s_music;
 		bufferSamples = MAX_RAW_SAMPLES - (s_rawend[0] - s_soundtime);
 
-		// decide how much data needs to be read from the file
-		fileSamples = bufferSamples * s_backgroundStream->info.rate / dma.speed;
-
-		if (!fileSamples)
-			return;
-
-		// our max buffer size
-		fileBytes = fileSamples * (s_backgroundStream->info.width * s_backgroundStream->info.channels);
-		if ( fileBytes > sizeof(raw) ) {
-			fileBytes = sizeof(raw);
-			fileSamples = fileBytes / (s_backgroundStream->info.width * s_backgroundStream->info.channels);
-		}
-
-		// Read
-		r = S_CodecReadStream(s_backgroundStream, fileBytes, raw);
-		if(r < fileBytes)
-		{
-			fileBytes = r;
-			fileSamples = r / (s_backgroundStream->info.width * s_backgroundStream->info.channels);
+		// decide how much data needs to be taken from the ring
+		fileSamples = bufferSamples * m->stream->info.rate / dma.speed;
+		if ( !fileSamples ) {
+			break;
 		}
 
-		if(r > 0)
-		{
-			// add to raw buffer
-			S_Base_RawSamples(0, fileSamples, s_backgroundStream->info.rate,
-				s_backgroundStream->info.width, s_backgroundStream->info.channels, raw, s_musicVolume->value, -1);
-		}
-		else
-		{
-			// loop
-			if(s_backgroundLoop[0])
-			{
-				S_CodecCloseStream(s_backgroundStream);
-				s_backgroundStream = NULL;
-				S_Base_StartBackgroundTrack( s_backgroundLoop, s_backgroundLoop );
-				if(!s_backgroundStream)
-					return;
+		available = m->writePos - m->readPos;
+		if ( !available ) {
+			if ( !S_MusicFinished( m ) ) {
+				break;		// the decoder is behind, there will be more next frame
 			}
-			else
-			{
-				S_Base_StopBackgroundTrack();
+			if ( !S_AdvanceBackgroundTrack() ) {
 				return;
 			}
+			continue;
+		}
+		Job_MemoryBarrier();
+
+		// up to the end of the ring, the rest goes next time around
+		offset = m->readPos & ( MUSIC_RING_BYTES - 1 );
+		fileBytes = fileSamples * m->frameBytes;
+		if ( fileBytes > available ) {
+			fileBytes = available;
 		}
+		if ( fileBytes > MUSIC_RING_BYTES - offset ) {
+			fileBytes = MUSIC_RING_BYTES - offset;
+		}
+		fileSamples = fileBytes / m->frameBytes;
+
+		// add to raw buffer
+		S_Base_RawSamples( 0, fileSamples, m->stream->info.rate,
+			m->stream->info.width, m->stream->info.channels, m->ring + offset, s_musicVolume->value, -1 );
+
+		// done with the samples before the decoder may reuse them
+		Job_MemoryBarrier();
+		m->readPos += fileSamples * m->frameBytes;
+	}
 
+	if ( s_music->eof && !s_musicLoopOpened ) {
+		S_MusicPrefetch();
 	}
+
+	S_MusicDecode( s_music );
+	S_MusicDecode( s_musicNext );
 }
 
 
 /*
 ======================
-S_FreeOldestSound
+S_FreeSound
 ======================
 */
+void S_FreeSound( sfx_t *sfx ) {
+	sndBuffer	*buffer, *nbuffer;
 
-void S_FreeOldestSound( void ) {
-	int	i, oldest, used;
+	buffer = sfx->soundData;
+	while(buffer != NULL) {
+		nbuffer = buffer->next;
+		SND_free(buffer);
+		buffer = nbuffer;
+	}
+	sfx->inMemory = qfalse;
+	sfx->soundData = NULL;
+}
+
+/*
+======================
+S_EvictSound
+
+Frees the least recently used sound that no channel or looping sound
+is playing, to make room under s_soundBudget.  Returns qfalse if all
+the resident sounds are playing.
+======================
+*/
+qboolean S_EvictSound( void ) {
+	static byte	playing[MAX_SFX];
+	int		i, oldest, used;
 	sfx_t	*sfx;
-	sndBuffer	*buffer, *nbuffer;
 
-	oldest = Com_Milliseconds();
-	used = 0;
+	Com_Memset( playing, 0, s_numSfx );
+	for ( i = 0 ; i < MAX_CHANNELS ; i++ ) {
+		if ( s_channels[i].thesfx ) {
+			playing[s_channels[i].thesfx - s_knownSfx] = 1;
+		}
+	}
+	for ( i = 0 ; i < numLoopChannels ; i++ ) {
+		if ( loop_channels[i].thesfx ) {
+			playing[loop_channels[i].thesfx - s_knownSfx] = 1;
+		}
+	}
+	for ( i = 0 ; i < MAX_GENTITIES ; i++ ) {
+		if ( loopSounds[i].active && loopSounds[i].sfx ) {
+			playing[loopSounds[i].sfx - s_knownSfx] = 1;
+		}
+	}
 
-	for (i=1 ; i < s_numSfx ; i++) {
+	oldest = 0;
+	used = -1;
+	for ( i = 0 ; i < s_numSfx ; i++ ) {
 		sfx = &s_knownSfx[i];
-		if (sfx->inMemory && sfx->lastTimeUsed<oldest) {
+		if ( !sfx->inMemory || !sfx->soundData || playing[i] ) {
+			continue;
+		}
+		if ( used == -1 || sfx->lastTimeUsed - oldest < 0 ) {
 			used = i;
 			oldest = sfx->lastTimeUsed;
 		}
 	}
 
-	sfx = &s_knownSfx[used];
-
-	Com_DPrintf("S_FreeOldestSound: freeing sound %s\n", sfx->soundName);
-
-	buffer = sfx->soundData;
-	while(buffer != NULL) {
-		nbuffer = buffer->next;
-		SND_free(buffer);
-		buffer = nbuffer;
+	if ( used == -1 ) {
+		return qfalse;
 	}
-	sfx->inMemory = qfalse;
-	sfx->soundData = NULL;
+
+	sfx = &s_knownSfx[used];
+	Com_DPrintf("S_EvictSound: freeing sound %s\n", sfx->soundName);
+	S_FreeSound( sfx );
+	return qtrue;
 }
 
 // =======================================================================
@@ -1469,6 +2508,9 @@ void S_Base_Shutdown( void ) {
 		return;
 	}
 
+	S_StopMixerThread();
+	S_Base_StopBackgroundTrack();
+
 	SNDDMA_Shutdown();
 	SND_shutdown();
 
@@ -1476,6 +2518,9 @@ void S_Base_Shutdown( void ) {
 	s_numSfx = 0;
 
 	Cmd_RemoveCommand("s_info");
+	Cmd_RemoveCommand("s_mixbench");
+	Cmd_RemoveCommand("s_mixthreadtest");
+	Cmd_RemoveCommand("s_loadbench");
 }
 
 /*
@@ -1494,6 +2539,8 @@ qboolean S_Base_Init( soundInterface_t *si ) {
 	s_mixPreStep = Cvar_Get ("s_mixPreStep", "0.05", CVAR_ARCHIVE);
 	s_show = Cvar_Get ("s_show", "0", CVAR_CHEAT);
 	s_testsound = Cvar_Get ("s_testsound", "0", CVAR_CHEAT);
+	s_mixThread = Cvar_Get ("s_mixThread", "0", CVAR_ARCHIVE | CVAR_LATCH);
+	s_lazyLoad = Cvar_Get ("s_lazyLoad", "1", CVAR_ARCHIVE);
 
 	r = SNDDMA_Init();
 
@@ -1508,6 +2555,14 @@ qboolean S_Base_Init( soundInterface_t *si ) {
 		s_paintedtime = 0;
 
 		S_Base_StopAllSounds( );
+
+		if ( s_mixThread->integer ) {
+			S_StartMixerThread();
+		}
+
+		Cmd_AddCommand( "s_mixbench", S_MixBench_f );
+		Cmd_AddCommand( "s_mixthreadtest", S_MixThreadTest_f );
+		Cmd_AddCommand( "s_loadbench", S_LoadBench_f );
 	} else {
 		return qfalse;
 	}
@@ -204,11 +204,21 @@ void		SND_free(sndBuffer *v);
 sndBuffer*	SND_malloc( void );
 void		SND_setup( void );
 void		SND_shutdown(void);
+int			SND_Resident( void );
 
 void S_PaintChannels(int endtime);
+void S_MixBench_f( void );
+void S_MixBenchSound( sfx_t *sfx, int method, int length, int *seed );
+void S_MixBenchFreeSound( sfx_t *sfx );
 
 void S_memoryLoad(sfx_t *sfx);
 
+// with s_mixThread the channels belong to the mixer thread
+void S_LockMixer( void );
+void S_UnlockMixer( void );
+qboolean S_CapturingVideo( void );
+void S_MixThreadTest_f( void );
+
 // spatializes a channel
 void S_Spatialize(channel_t *ch);
 
@@ -222,7 +232,8 @@ void S_AdpcmGetSamples(sndBuffer *chunk, short *to);
 #define SENTINEL_MULAW_ZERO_RUN 127
 #define SENTINEL_MULAW_FOUR_BIT_RUN 126
 
-void S_FreeOldestSound( void );
+qboolean S_EvictSound( void );
+void S_FreeSound( sfx_t *sfx );
 
 #define	NXStream byte
 
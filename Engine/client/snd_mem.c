@@ -46,49 +46,112 @@ static	sndBuffer	*buffer = NULL;
 static	sndBuffer	*freelist = NULL;
 static	int inUse = 0;
 static	int totalInUse = 0;
+static	int numBuffers = 0;
+
+// resident sound memory, kept under s_soundBudget by evicting the least
+// recently used sounds.  When everything resident is playing the chunks
+// come from malloc instead, over the budget rather than cutting a sound.
+static	cvar_t	*s_soundBudget;
+static	int resident = 0;
+static	int residentPeak = 0;
+static	int evictions = 0;
+static	int overBudget = 0;
 
 short *sfxScratchBuffer = NULL;
 sfx_t *sfxScratchPointer = NULL;
 int	   sfxScratchIndex = 0;
 
 void	SND_free(sndBuffer *v) {
+	resident -= sizeof(sndBuffer);
+
+	if (v < buffer || v >= buffer + numBuffers) {
+		free(v);
+		return;
+	}
+
 	*(sndBuffer **)v = freelist;
 	freelist = (sndBuffer*)v;
 	inUse += sizeof(sndBuffer);
 }
 
+/*
+================
+SND_Budget
+
+Bytes of sound the pool may hold, s_soundBudget megabytes or all of it
+================
+*/
+static int SND_Budget(void) {
+	int		budget;
+
+	budget = numBuffers * sizeof(sndBuffer);
+	if (s_soundBudget && s_soundBudget->integer > 0 && s_soundBudget->integer * 1024 * 1024 < budget) {
+		budget = s_soundBudget->integer * 1024 * 1024;
+	}
+	return budget;
+}
+
 sndBuffer*	SND_malloc(void) {
 	sndBuffer *v;
-redo:
+	int		budget;
+
+	budget = SND_Budget();
+	while ((freelist == NULL || resident + (int)sizeof(sndBuffer) > budget) && S_EvictSound()) {
+		evictions++;
+	}
+
 	if (freelist == NULL) {
-		S_FreeOldestSound();
-		goto redo;
+		v = malloc(sizeof(sndBuffer));
+		if (!v) {
+			Com_Error(ERR_FATAL, "SND_malloc: out of memory");
+		}
+		overBudget++;
+	} else {
+		inUse -= sizeof(sndBuffer);
+		v = freelist;
+		freelist = *(sndBuffer **)freelist;
 	}
 
-	inUse -= sizeof(sndBuffer);
 	totalInUse += sizeof(sndBuffer);
+	resident += sizeof(sndBuffer);
+	if (resident > residentPeak) {
+		residentPeak = resident;
+	}
 
-	v = freelist;
-	freelist = *(sndBuffer **)freelist;
 	v->next = NULL;
 	return v;
 }
 
+/*
+================
+SND_Resident
+
+Bytes of decoded sound currently held
+================
+*/
+int SND_Resident(void) {
+	return resident;
+}
+
 void SND_setup(void) {
 	sndBuffer *p, *q;
 	cvar_t	*cv;
 	int scs;
 
 	cv = Cvar_Get( "com_soundMegs", DEF_COMSOUNDMEGS, CVAR_LATCH | CVAR_ARCHIVE );
+	s_soundBudget = Cvar_Get( "s_soundBudget", "0", CVAR_ARCHIVE );
 
 	scs = (cv->integer*1536);
 
 	buffer = malloc(scs*sizeof(sndBuffer) );
+	numBuffers = scs;
 	// allocate the stack based hunk allocator
 	sfxScratchBuffer = malloc(SND_CHUNK_SIZE * sizeof(short) * 4);	//Hunk_Alloc(SND_CHUNK_SIZE * sizeof(short) * 4);
 	sfxScratchPointer = NULL;
 
 	inUse = scs*sizeof(sndBuffer);
+	resident = residentPeak = 0;
+	evictions = overBudget = 0;
 	p = buffer;;
 	q = p + scs;
 	while (--q > p)
@@ -264,4 +327,6 @@ qboolean S_LoadSound( sfx_t *sfx )
 
 void S_DisplayFreeMemory(void) {
 	Com_Printf("%d bytes free sound buffer memory, %d total used\n", inUse, totalInUse);
+	Com_Printf("%d KB resident of a %d KB budget, %d KB peak\n", resident / 1024, SND_Budget() / 1024, residentPeak / 1024);
+	Com_Printf("%d sounds evicted, %d chunks over budget\n", evictions, overBudget);
 }
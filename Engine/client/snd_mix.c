@@ -26,10 +26,24 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #if idppc_altivec && !defined(MACOS_X)
 #include <altivec.h>
 #endif
+#if idx64 || ( id386 && defined( __SSE2__ ))
+#include <emmintrin.h>
+#define SND_SSE2		1
+#else
+#define SND_SSE2		0
+#endif
 
 static portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
 static int snd_vol;
 
+#if SND_SSE2
+// the SSE2 mixer accumulates into this instead, left and right interleaved
+// and in paintbuffer units, and converts once per block before the transfer
+static float paintbufferf[PAINTBUFFER_SIZE*2];
+static qboolean s_mixFloat;			// com_haveSSE2, unless s_mixbench wants the scalar mixer
+static qboolean s_mixForceScalar;
+#endif
+
 int*     snd_p;  
 int      snd_linear_count;
 short*   snd_out;
@@ -138,7 +152,7 @@ void S_TransferStereo16 (unsigned long *pbuf, int endtime)
 		snd_p += snd_linear_count;
 		ls_paintedtime += (snd_linear_count>>1);
 
-		if( CL_VideoRecording( ) )
+		if( S_CapturingVideo( ) )
 			CL_WriteAVIAudioFrame( (byte *)snd_out, snd_linear_count << 1 );
 	}
 }
@@ -623,6 +637,361 @@ void S_PaintChannelFromMuLaw( channel_t *ch, sfx_t *sc, int count, int sampleOff
 	}
 }
 
+#if SND_SSE2
+/*
+===============================================================================
+
+SSE2 FLOAT MIXER
+
+Every format ends up in S_MixSpan_sse2: 16 bit sfx are mixed straight
+from their chunks, compressed ones a decoded block at a time.  Only the
+doppler resampling loops stay per sample.
+
+===============================================================================
+*/
+
+#define	MULAW_BLOCK		256
+
+/*
+===================
+S_MixSpan_sse2
+
+Adds count mono samples into interleaved float pairs
+===================
+*/
+static void S_MixSpan_sse2( float *out, const short *in, int count, float leftvol, float rightvol ) {
+	__m128i	s;
+	__m128	f, l, r, lv, rv;
+	int		i;
+
+	lv = _mm_set1_ps( leftvol );
+	rv = _mm_set1_ps( rightvol );
+
+	for ( i = 0 ; i + 8 <= count ; i += 8, in += 8, out += 16 ) {
+		s = _mm_loadu_si128( (const __m128i *)in );
+
+		f = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( s, s ), 16 ) );
+		l = _mm_mul_ps( f, lv );
+		r = _mm_mul_ps( f, rv );
+		_mm_storeu_ps( out, _mm_add_ps( _mm_loadu_ps( out ), _mm_unpacklo_ps( l, r ) ) );
+		_mm_storeu_ps( out + 4, _mm_add_ps( _mm_loadu_ps( out + 4 ), _mm_unpackhi_ps( l, r ) ) );
+
+		f = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( s, s ), 16 ) );
+		l = _mm_mul_ps( f, lv );
+		r = _mm_mul_ps( f, rv );
+		_mm_storeu_ps( out + 8, _mm_add_ps( _mm_loadu_ps( out + 8 ), _mm_unpacklo_ps( l, r ) ) );
+		_mm_storeu_ps( out + 12, _mm_add_ps( _mm_loadu_ps( out + 12 ), _mm_unpackhi_ps( l, r ) ) );
+	}
+
+	for ( ; i < count ; i++, in++, out += 2 ) {
+		out[0] += *in * leftvol;
+		out[1] += *in * rightvol;
+	}
+}
+
+/*
+===================
+S_FloatFromPaintBuffer_sse2
+
+Starts the float mix from the raw samples already in paintbuffer
+===================
+*/
+static void S_FloatFromPaintBuffer_sse2( int count ) {
+	int		i;
+
+	for ( i = 0 ; i + 2 <= count ; i += 2 ) {
+		_mm_storeu_ps( &paintbufferf[i*2], _mm_cvtepi32_ps( _mm_loadu_si128( (const __m128i *)&paintbuffer[i] ) ) );
+	}
+	for ( ; i < count ; i++ ) {
+		paintbufferf[i*2] = paintbuffer[i].left;
+		paintbufferf[i*2+1] = paintbuffer[i].right;
+	}
+}
+
+/*
+===================
+S_PaintBufferFromFloat_sse2
+
+Rounds the float mix into paintbuffer for the transfer code
+===================
+*/
+static void S_PaintBufferFromFloat_sse2( int count ) {
+	const __m128	lo = _mm_set1_ps( -2.0e9f );
+	const __m128	hi = _mm_set1_ps( 2.0e9f );
+	__m128			f;
+	int				i;
+
+	for ( i = 0 ; i + 2 <= count ; i += 2 ) {
+		f = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( &paintbufferf[i*2] ), lo ), hi );
+		_mm_storeu_si128( (__m128i *)&paintbuffer[i], _mm_cvtps_epi32( f ) );
+	}
+	for ( ; i < count ; i++ ) {
+		f = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( &paintbufferf[i*2] ), lo ), hi );
+		paintbuffer[i].left = _mm_cvtss_si32( f );
+		paintbuffer[i].right = _mm_cvtss_si32( _mm_shuffle_ps( f, f, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+	}
+}
+
+static void S_PaintChannelFrom16_sse2( channel_t *ch, const sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
+	int						aoff, boff;
+	int						i, j, n;
+	float					*out;
+	sndBuffer				*chunk;
+	short					*samples;
+	float					ooff, fdata, fdiv, fleftvol, frightvol;
+
+	out = &paintbufferf[ bufferOffset*2 ];
+
+	if (ch->doppler) {
+		sampleOffset = sampleOffset*ch->oldDopplerScale;
+	}
+
+	chunk = sc->soundData;
+	while (sampleOffset>=SND_CHUNK_SIZE) {
+		chunk = chunk->next;
+		sampleOffset -= SND_CHUNK_SIZE;
+		if (!chunk) {
+			chunk = sc->soundData;
+		}
+	}
+
+	fleftvol = ch->leftvol*snd_vol;
+	frightvol = ch->rightvol*snd_vol;
+
+	if (!ch->doppler || ch->dopplerScale==1.0f) {
+		while ( count > 0 && chunk ) {
+			n = SND_CHUNK_SIZE - sampleOffset;
+			if ( n > count ) {
+				n = count;
+			}
+			S_MixSpan_sse2( out, chunk->sndChunk + sampleOffset, n, fleftvol * (1.0f/256), frightvol * (1.0f/256) );
+			out += n*2;
+			count -= n;
+			sampleOffset += n;
+
+			if (sampleOffset == SND_CHUNK_SIZE) {
+				chunk = chunk->next;
+				sampleOffset = 0;
+			}
+		}
+	} else {
+		ooff = sampleOffset;
+		samples = chunk->sndChunk;
+
+		for ( i=0 ; i<count ; i++ ) {
+			aoff = ooff;
+			ooff = ooff + ch->dopplerScale;
+			boff = ooff;
+			fdata = 0;
+			for (j=aoff; j<boff; j++) {
+				if (j == SND_CHUNK_SIZE) {
+					chunk = chunk->next;
+					if (!chunk) {
+						chunk = sc->soundData;
+					}
+					samples = chunk->sndChunk;
+					ooff -= SND_CHUNK_SIZE;
+				}
+				fdata  += samples[j&(SND_CHUNK_SIZE-1)];
+			}
+			fdiv = 256 * (boff-aoff);
+			out[i*2] += (fdata * fleftvol)/fdiv;
+			out[i*2+1] += (fdata * frightvol)/fdiv;
+		}
+	}
+}
+
+static void S_PaintChannelFromWavelet_sse2( channel_t *ch, sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
+	int						i, n;
+	float					*out;
+	float					leftvol, rightvol;
+	sndBuffer				*chunk;
+
+	leftvol = ch->leftvol*snd_vol * (1.0f/256);
+	rightvol = ch->rightvol*snd_vol * (1.0f/256);
+
+	i = 0;
+	out = &paintbufferf[ bufferOffset*2 ];
+	chunk = sc->soundData;
+	while (sampleOffset>=(SND_CHUNK_SIZE_FLOAT*4)) {
+		chunk = chunk->next;
+		sampleOffset -= (SND_CHUNK_SIZE_FLOAT*4);
+		i++;
+	}
+
+	if (i!=sfxScratchIndex || sfxScratchPointer != sc) {
+		S_AdpcmGetSamples( chunk, sfxScratchBuffer );
+		sfxScratchIndex = i;
+		sfxScratchPointer = sc;
+	}
+
+	while ( count > 0 ) {
+		n = SND_CHUNK_SIZE*2 - sampleOffset;
+		if ( n > count ) {
+			n = count;
+		}
+		S_MixSpan_sse2( out, sfxScratchBuffer + sampleOffset, n, leftvol, rightvol );
+		out += n*2;
+		count -= n;
+		sampleOffset += n;
+
+		if (sampleOffset == SND_CHUNK_SIZE*2 && count > 0) {
+			chunk = chunk->next;
+			decodeWavelet(chunk, sfxScratchBuffer);
+			sfxScratchIndex++;
+			sampleOffset = 0;
+		}
+	}
+}
+
+static void S_PaintChannelFromADPCM_sse2( channel_t *ch, sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
+	int						i, n;
+	float					*out;
+	float					leftvol, rightvol;
+	sndBuffer				*chunk;
+
+	leftvol = ch->leftvol*snd_vol * (1.0f/256);
+	rightvol = ch->rightvol*snd_vol * (1.0f/256);
+
+	i = 0;
+	out = &paintbufferf[ bufferOffset*2 ];
+	chunk = sc->soundData;
+
+	if (ch->doppler) {
+		sampleOffset = sampleOffset*ch->oldDopplerScale;
+	}
+
+	while (sampleOffset>=(SND_CHUNK_SIZE*4)) {
+		chunk = chunk->next;
+		sampleOffset -= (SND_CHUNK_SIZE*4);
+		i++;
+	}
+
+	if (i!=sfxScratchIndex || sfxScratchPointer != sc) {
+		S_AdpcmGetSamples( chunk, sfxScratchBuffer );
+		sfxScratchIndex = i;
+		sfxScratchPointer = sc;
+	}
+
+	while ( count > 0 ) {
+		n = SND_CHUNK_SIZE*4 - sampleOffset;
+		if ( n > count ) {
+			n = count;
+		}
+		S_MixSpan_sse2( out, sfxScratchBuffer + sampleOffset, n, leftvol, rightvol );
+		out += n*2;
+		count -= n;
+		sampleOffset += n;
+
+		if (sampleOffset == SND_CHUNK_SIZE*4 && count > 0) {
+			chunk = chunk->next;
+			S_AdpcmGetSamples( chunk, sfxScratchBuffer);
+			sampleOffset = 0;
+			sfxScratchIndex++;
+		}
+	}
+}
+
+static void S_PaintChannelFromMuLaw_sse2( channel_t *ch, sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
+	int						i, n;
+	float					*out;
+	float					leftvol, rightvol;
+	sndBuffer				*chunk;
+	byte					*samples;
+	short					block[MULAW_BLOCK];
+	float					ooff;
+
+	leftvol = ch->leftvol*snd_vol * (1.0f/256);
+	rightvol = ch->rightvol*snd_vol * (1.0f/256);
+
+	out = &paintbufferf[ bufferOffset*2 ];
+	chunk = sc->soundData;
+	while (sampleOffset>=(SND_CHUNK_SIZE*2)) {
+		chunk = chunk->next;
+		sampleOffset -= (SND_CHUNK_SIZE*2);
+		if (!chunk) {
+			chunk = sc->soundData;
+		}
+	}
+
+	if (!ch->doppler) {
+		samples = (byte *)chunk->sndChunk + sampleOffset;
+		while ( count > 0 ) {
+			n = (byte *)chunk->sndChunk+(SND_CHUNK_SIZE*2) - samples;
+			if ( n > count ) {
+				n = count;
+			}
+			if ( n > MULAW_BLOCK ) {
+				n = MULAW_BLOCK;
+			}
+			for ( i = 0 ; i < n ; i++ ) {
+				block[i] = mulawToShort[samples[i]];
+			}
+			S_MixSpan_sse2( out, block, n, leftvol, rightvol );
+			out += n*2;
+			count -= n;
+			samples += n;
+
+			if (samples == (byte *)chunk->sndChunk+(SND_CHUNK_SIZE*2)) {
+				chunk = chunk->next;
+				if ( !chunk ) {
+					break;
+				}
+				samples = (byte *)chunk->sndChunk;
+			}
+		}
+	} else {
+		ooff = sampleOffset;
+		samples = (byte *)chunk->sndChunk;
+		for ( i=0 ; i<count ; i++ ) {
+			n = mulawToShort[samples[(int)(ooff)]];
+			ooff = ooff + ch->dopplerScale;
+			out[i*2] += n * leftvol;
+			out[i*2+1] += n * rightvol;
+			if (ooff >= SND_CHUNK_SIZE*2) {
+				chunk = chunk->next;
+				if (!chunk) {
+					chunk = sc->soundData;
+				}
+				samples = (byte *)chunk->sndChunk;
+				ooff = 0.0;
+			}
+		}
+	}
+}
+#endif
+
+/*
+===================
+S_PaintChannel
+===================
+*/
+static void S_PaintChannel( channel_t *ch, sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
+#if SND_SSE2
+	if ( s_mixFloat ) {
+		if( sc->soundCompressionMethod == 1) {
+			S_PaintChannelFromADPCM_sse2	(ch, sc, count, sampleOffset, bufferOffset);
+		} else if( sc->soundCompressionMethod == 2) {
+			S_PaintChannelFromWavelet_sse2	(ch, sc, count, sampleOffset, bufferOffset);
+		} else if( sc->soundCompressionMethod == 3) {
+			S_PaintChannelFromMuLaw_sse2	(ch, sc, count, sampleOffset, bufferOffset);
+		} else {
+			S_PaintChannelFrom16_sse2		(ch, sc, count, sampleOffset, bufferOffset);
+		}
+		return;
+	}
+#endif
+	if( sc->soundCompressionMethod == 1) {
+		S_PaintChannelFromADPCM		(ch, sc, count, sampleOffset, bufferOffset);
+	} else if( sc->soundCompressionMethod == 2) {
+		S_PaintChannelFromWavelet	(ch, sc, count, sampleOffset, bufferOffset);
+	} else if( sc->soundCompressionMethod == 3) {
+		S_PaintChannelFromMuLaw		(ch, sc, count, sampleOffset, bufferOffset);
+	} else {
+		S_PaintChannelFrom16		(ch, sc, count, sampleOffset, bufferOffset);
+	}
+}
+
 /*
 ===================
 S_PaintChannels
@@ -642,6 +1011,10 @@ void S_PaintChannels( int endtime ) {
 	else
 		snd_vol = s_volume->value*255;
 
+#if SND_SSE2
+	s_mixFloat = com_haveSSE2 && !s_mixForceScalar;
+#endif
+
 //Com_Printf ("%i to %i\n", s_paintedtime, endtime);
 	while ( s_paintedtime < endtime ) {
 		// if paintbuffer is smaller than DMA buffer
@@ -665,6 +1038,11 @@ void S_PaintChannels( int endtime ) {
 				}
 			}
 		}
+#if SND_SSE2
+		if ( s_mixFloat ) {
+			S_FloatFromPaintBuffer_sse2( end - s_paintedtime );
+		}
+#endif
 
 		// paint in the channels.
 		ch = s_channels;
@@ -683,15 +1061,7 @@ void S_PaintChannels( int endtime ) {
 			}
 
 			if ( count > 0 ) {	
-				if( sc->soundCompressionMethod == 1) {
-					S_PaintChannelFromADPCM		(ch, sc, count, sampleOffset, ltime - s_paintedtime);
-				} else if( sc->soundCompressionMethod == 2) {
-					S_PaintChannelFromWavelet	(ch, sc, count, sampleOffset, ltime - s_paintedtime);
-				} else if( sc->soundCompressionMethod == 3) {
-					S_PaintChannelFromMuLaw	(ch, sc, count, sampleOffset, ltime - s_paintedtime);
-				} else {
-					S_PaintChannelFrom16		(ch, sc, count, sampleOffset, ltime - s_paintedtime);
-				}
+				S_PaintChannel( ch, sc, count, sampleOffset, ltime - s_paintedtime );
 			}
 		}
 
@@ -720,22 +1090,286 @@ void S_PaintChannels( int endtime ) {
 				}
 
 				if ( count > 0 ) {	
-					if( sc->soundCompressionMethod == 1) {
-						S_PaintChannelFromADPCM		(ch, sc, count, sampleOffset, ltime - s_paintedtime);
-					} else if( sc->soundCompressionMethod == 2) {
-						S_PaintChannelFromWavelet	(ch, sc, count, sampleOffset, ltime - s_paintedtime);
-					} else if( sc->soundCompressionMethod == 3) {
-						S_PaintChannelFromMuLaw		(ch, sc, count, sampleOffset, ltime - s_paintedtime);
-					} else {
-						S_PaintChannelFrom16		(ch, sc, count, sampleOffset, ltime - s_paintedtime);
-					}
+					S_PaintChannel( ch, sc, count, sampleOffset, ltime - s_paintedtime );
 					ltime += count;
 				}
 			} while ( ltime < end);
 		}
 
+#if SND_SSE2
+		if ( s_mixFloat ) {
+			S_PaintBufferFromFloat_sse2( end - s_paintedtime );
+		}
+#endif
+
 		// transfer out according to DMA format
 		S_TransferPaintBuffer( end );
 		s_paintedtime = end;
 	}
 }
+
+/*
+===============================================================================
+
+MIXER BENCHMARK
+
+s_mixbench renders a scripted set of one shot and looping channels
+into a private buffer with the scalar mixer and the SSE2 float mixer,
+compares the two renders and times them.  The integer mixer truncates
+every channel on its own, so the two may differ by an LSB or so.
+
+===============================================================================
+*/
+
+#define	MIXBENCH_SFX			4
+#define	MIXBENCH_CHANNELS		48
+#define	MIXBENCH_LOOPS			24
+#define	MIXBENCH_ROUNDS			4
+#define	MIXBENCH_TOLERANCE		2
+
+/*
+===================
+S_MixBenchSound
+
+A few seconds of tones and noise, stored the way S_LoadSound would
+===================
+*/
+void S_MixBenchSound( sfx_t *sfx, int method, int length, int *seed ) {
+	short		*samples;
+	sndBuffer	*chunk, *newchunk;
+	float		freq;
+	int			i, n;
+
+	Com_Memset( sfx, 0, sizeof( *sfx ) );
+	Com_sprintf( sfx->soundName, sizeof( sfx->soundName ), "*mixbench%i", method );
+	sfx->soundLength = length;
+	sfx->soundCompressionMethod = method;
+	sfx->inMemory = qtrue;
+
+	samples = Z_Malloc( length * sizeof( *samples ) );
+	freq = 0.02f + Q_random( seed ) * 0.1f;
+	for ( i = 0 ; i < length ; i++ ) {
+		samples[i] = sin( i * freq ) * 12000 + Q_crandom( seed ) * 4000 + ( ( i & 255 ) - 128 ) * 20;
+	}
+
+	switch ( method ) {
+	case 1:
+		S_AdpcmEncodeSound( sfx, samples );
+		break;
+	case 3:
+		encodeMuLaw( sfx, samples );
+		break;
+	default:
+		chunk = NULL;
+		for ( i = 0 ; i < length ; i += SND_CHUNK_SIZE ) {
+			newchunk = SND_malloc();
+			if ( chunk ) {
+				chunk->next = newchunk;
+			} else {
+				sfx->soundData = newchunk;
+			}
+			chunk = newchunk;
+
+			n = length - i;
+			if ( n > SND_CHUNK_SIZE ) {
+				n = SND_CHUNK_SIZE;
+			}
+			Com_Memset( chunk->sndChunk, 0, sizeof( chunk->sndChunk ) );
+			Com_Memcpy( chunk->sndChunk, samples + i, n * sizeof( *samples ) );
+			chunk->size = n;
+		}
+		break;
+	}
+
+	Z_Free( samples );
+}
+
+/*
+===================
+S_MixBenchFreeSound
+===================
+*/
+void S_MixBenchFreeSound( sfx_t *sfx ) {
+	sndBuffer	*chunk, *next;
+
+	for ( chunk = sfx->soundData ; chunk ; chunk = next ) {
+		next = chunk->next;
+		SND_free( chunk );
+	}
+	sfx->soundData = NULL;
+	sfx->inMemory = qfalse;
+}
+
+/*
+===================
+S_MixBenchRender
+===================
+*/
+static int S_MixBenchRender( int frames, qboolean scalar ) {
+	int		start;
+
+#if SND_SSE2
+	s_mixForceScalar = scalar;
+#endif
+	sfxScratchPointer = NULL;
+	s_paintedtime = 0;
+
+	start = Sys_Milliseconds();
+	S_PaintChannels( frames );
+	return Sys_Milliseconds() - start;
+}
+
+/*
+===================
+S_MixBench_f
+
+s_mixbench [seconds]
+===================
+*/
+void S_MixBench_f( void ) {
+	static const int	methods[MIXBENCH_SFX] = { 0, 0, 1, 3 };
+	sfx_t		sfx[MIXBENCH_SFX];
+	channel_t	*savedChannels, *savedLoops;
+	int			savedRawEnd[MAX_RAW_STREAMS];
+	int			savedNumLoops, savedPaintedTime;
+	dma_t		savedDma;
+	short		*render[2];
+	channel_t	*ch;
+	int			seconds, speed, frames, seed;
+	int			msec[2];
+	int			diff, maxDiff, numDiffs;
+	int			i, round;
+
+	if ( CL_VideoRecording() ) {
+		Com_Printf( "s_mixbench: not while recording video\n" );
+		return;
+	}
+
+	seconds = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 10;
+	if ( seconds < 1 ) {
+		seconds = 1;
+	}
+
+	// keep the mixer thread and the audio callback away from dma
+	// while it is swapped out
+	S_LockMixer();
+	SNDDMA_BeginPainting();
+
+	savedDma = dma;
+	savedChannels = Z_Malloc( sizeof( s_channels ) );
+	savedLoops = Z_Malloc( sizeof( loop_channels ) );
+	Com_Memcpy( savedChannels, s_channels, sizeof( s_channels ) );
+	Com_Memcpy( savedLoops, loop_channels, sizeof( loop_channels ) );
+	Com_Memcpy( savedRawEnd, s_rawend, sizeof( s_rawend ) );
+	savedNumLoops = numLoopChannels;
+	savedPaintedTime = s_paintedtime;
+
+	dma.channels = 2;
+	dma.samplebits = 16;
+	if ( !dma.speed ) {
+		dma.speed = 22050;
+	}
+	speed = dma.speed;
+	frames = seconds * speed;
+	for ( dma.samples = 1 ; dma.samples < frames * 2 ; dma.samples <<= 1 ) {
+	}
+	dma.buffer = Z_Malloc( dma.samples * sizeof( short ) );
+	render[0] = Z_Malloc( frames * 2 * sizeof( short ) );
+	render[1] = Z_Malloc( frames * 2 * sizeof( short ) );
+
+	// the script: one shots part way through, and loops, some of them
+	// doppler shifted, over 16 bit, ADPCM and mu-law sfx.  Volumes are
+	// kept down so the integer mixer does not wrap around
+	seed = 0x5e1f;
+	for ( i = 0 ; i < MIXBENCH_SFX ; i++ ) {
+		S_MixBenchSound( &sfx[i], methods[i], dma.speed * ( i + 1 ) + 777 * i, &seed );
+	}
+
+	Com_Memset( s_channels, 0, sizeof( s_channels ) );
+	Com_Memset( loop_channels, 0, sizeof( loop_channels ) );
+	Com_Memset( s_rawend, 0, sizeof( s_rawend ) );
+
+	for ( i = 0, ch = s_channels ; i < MIXBENCH_CHANNELS ; i++, ch++ ) {
+		ch->thesfx = &sfx[i % MIXBENCH_SFX];
+		ch->leftvol = Q_rand( &seed ) & 63;
+		ch->rightvol = Q_rand( &seed ) & 63;
+		ch->startSample = -( ( Q_rand( &seed ) & 0x7fff ) % ( ch->thesfx->soundLength / 2 ) );
+	}
+	for ( i = 0, ch = loop_channels ; i < MIXBENCH_LOOPS ; i++, ch++ ) {
+		ch->thesfx = &sfx[i % MIXBENCH_SFX];
+		ch->leftvol = Q_rand( &seed ) & 63;
+		ch->rightvol = Q_rand( &seed ) & 63;
+		// the ADPCM path has no resampler, and S_Base_AddLoopingSound only
+		// turns doppler on for scales above one
+		if ( ( i & 1 ) && ch->thesfx->soundCompressionMethod != 1 ) {
+			ch->doppler = qtrue;
+			ch->dopplerScale = ch->oldDopplerScale = 1.1f + Q_random( &seed );
+		}
+	}
+	numLoopChannels = MIXBENCH_LOOPS;
+
+	msec[0] = msec[1] = 0;
+	for ( i = 0 ; i < 2 ; i++ ) {
+		Com_Memset( dma.buffer, 0, dma.samples * sizeof( short ) );
+		S_MixBenchRender( frames, i == 0 );
+		Com_Memcpy( render[i], dma.buffer, frames * 2 * sizeof( short ) );
+	}
+	for ( round = 0 ; round < MIXBENCH_ROUNDS ; round++ ) {
+		msec[0] += S_MixBenchRender( frames, qtrue );
+		msec[1] += S_MixBenchRender( frames, qfalse );
+	}
+
+	maxDiff = numDiffs = 0;
+	for ( i = 0 ; i < frames * 2 ; i++ ) {
+		diff = abs( render[0][i] - render[1][i] );
+		if ( diff ) {
+			numDiffs++;
+		}
+		if ( diff > maxDiff ) {
+			maxDiff = diff;
+		}
+	}
+
+	// put the real mix back
+	for ( i = 0 ; i < MIXBENCH_SFX ; i++ ) {
+		S_MixBenchFreeSound( &sfx[i] );
+	}
+	Z_Free( render[1] );
+	Z_Free( render[0] );
+	Z_Free( dma.buffer );
+
+	Com_Memcpy( s_channels, savedChannels, sizeof( s_channels ) );
+	Com_Memcpy( loop_channels, savedLoops, sizeof( loop_channels ) );
+	Com_Memcpy( s_rawend, savedRawEnd, sizeof( s_rawend ) );
+	Z_Free( savedLoops );
+	Z_Free( savedChannels );
+	numLoopChannels = savedNumLoops;
+	s_paintedtime = savedPaintedTime;
+	dma = savedDma;
+	sfxScratchPointer = NULL;
+#if SND_SSE2
+	s_mixForceScalar = qfalse;
+#endif
+
+	SNDDMA_Submit();
+	S_UnlockMixer();
+
+	Com_Printf( "%i channels, %i loops, %i seconds at %i Hz, %i rounds\n",
+		MIXBENCH_CHANNELS, MIXBENCH_LOOPS, seconds, speed, MIXBENCH_ROUNDS );
+#if SND_SSE2
+	if ( !com_haveSSE2 ) {
+		Com_Printf( "no SSE2 on this machine, both renders used the scalar mixer\n" );
+	}
+#else
+	Com_Printf( "no SSE2 mixer in this build, both renders used the scalar mixer\n" );
+#endif
+	Com_Printf( "scalar: %5i msec, %6.1fx realtime\n", msec[0],
+		msec[0] ? seconds * MIXBENCH_ROUNDS * 1000.0f / msec[0] : 0.0f );
+	Com_Printf( "  sse2: %5i msec, %6.1fx realtime (%.2fx)\n", msec[1],
+		msec[1] ? seconds * MIXBENCH_ROUNDS * 1000.0f / msec[1] : 0.0f,
+		msec[1] ? msec[0] / (float)msec[1] : 0.0f );
+	Com_Printf( "%i of %i samples differ, by at most %i\n", numDiffs, frames * 2, maxDiff );
+	if ( maxDiff > MIXBENCH_TOLERANCE ) {
+		Com_Printf( S_COLOR_RED "FAILED: renders differ by more than %i\n", MIXBENCH_TOLERANCE );
+	}
+}
@@ -69,6 +69,15 @@ void R_PerformanceCounters( void ) {
 		ri.Printf( PRINT_ALL, "flare adds:%i tests:%i renders:%i\n", 
 			backEnd.pc.c_flareAdds, backEnd.pc.c_flareTests, backEnd.pc.c_flareRenders );
 	}
+	else if (r_speeds->integer == 7 )
+	{
+		int		hits = tr.pc.c_iqmPoseHits + backEnd.pc.c_iqmPoseHits;
+		int		lookups = hits + tr.pc.c_iqmPoseMisses + backEnd.pc.c_iqmPoseMisses;
+
+		ri.Printf( PRINT_ALL, "iqm poses front:%i/%i back:%i/%i hits/computed, %.0f%% hit rate\n",
+			tr.pc.c_iqmPoseHits, tr.pc.c_iqmPoseMisses, backEnd.pc.c_iqmPoseHits, backEnd.pc.c_iqmPoseMisses,
+			lookups ? 100.0f * hits / lookups : 0.0f );
+	}
 
 	Com_Memset( &tr.pc, 0, sizeof( tr.pc ) );
 	Com_Memset( &backEnd.pc, 0, sizeof( backEnd.pc ) );
@@ -117,6 +126,10 @@ int	c_blockedOnMain;
 void R_IssueRenderCommands( qboolean runPerformanceCounters ) {
 	renderCommandList_t	*cmdList;
 
+	// skin the animated models the new commands draw, while
+	// the render thread may still be busy with the last frame
+	R_AnimateSurfaces();
+
 	cmdList = &backEndData[tr.smpFrame]->commands;
 	assert(cmdList);
 	// add an end-of-list command
@@ -232,6 +245,8 @@ void	R_AddDrawSurfCmd( drawSurf_t *drawSurfs, int numDrawSurfs ) {
 
 	cmd->refdef = tr.refdef;
 	cmd->viewParms = tr.viewParms;
+
+	R_AddAnimatedSurfaces( drawSurfs, numDrawSurfs );
 }
 
 
@@ -22,6 +22,13 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_image.c
 #include "tr_local.h"
 
+#if idx64 || ( id386 && defined( __SSE2__ ))
+#include <emmintrin.h>
+#define MIP_SSE2			1
+#else
+#define MIP_SSE2			0
+#endif
+
 static byte			 s_intensitytable[256];
 static unsigned char s_gammatable[256];
 
@@ -31,6 +38,16 @@ int		gl_filter_max = GL_LINEAR;
 #define FILE_HASH_SIZE		1024
 static	image_t*		hashTable[FILE_HASH_SIZE];
 
+typedef struct {
+	int		hits, misses;
+	int		written;
+	int		uncacheable;			// read from a directory, there's no crc to key them by
+	int		evicted;
+	int		hitBytes, writtenBytes;
+} imageCacheStats_t;
+
+static imageCacheStats_t	imageCacheStats;
+
 /*
 ** R_GammaCorrect
 */
@@ -211,11 +228,105 @@ void R_ImageList_f( void ) {
 	}
 	ri.Printf (PRINT_ALL, " ---------\n");
 	ri.Printf (PRINT_ALL, " %i total texels (not including mipmaps)\n", texels);
-	ri.Printf (PRINT_ALL, " %i total images\n\n", tr.numImages );
+	ri.Printf (PRINT_ALL, " %i total images\n", tr.numImages );
+	ri.Printf (PRINT_ALL, " image cache: %i hits (%i KB), %i misses, %i written (%i KB), %i uncacheable, %i evicted\n\n",
+		imageCacheStats.hits, imageCacheStats.hitBytes / 1024, imageCacheStats.misses,
+		imageCacheStats.written, imageCacheStats.writtenBytes / 1024, imageCacheStats.uncacheable,
+		imageCacheStats.evicted );
 }
 
 //=======================================================================
 
+/*
+=============================================================================
+
+IMAGE BANDS
+
+Resampling, light scaling and the mip chain work on whole rows of
+the output, so an image is cut into bands of rows and the bands are
+run on the job threads.  Nothing here touches GL or the hunk, which
+lets the prefetch jobs prepare a whole upload as well.
+
+=============================================================================
+*/
+
+#define	IMAGE_BAND_PIXELS		16384	// output pixels per job
+
+typedef struct imageBand_s {
+	void		(*function)( struct imageBand_s *band, int firstRow, int numRows );
+	const byte	*in;
+	int			inWidth, inHeight;
+	byte		*out;
+	int			outWidth, outHeight;
+	int			rowsPerBand;
+	int			param;
+	const int	*table;
+} imageBand_t;
+
+/*
+================
+R_ImageBandJob
+================
+*/
+static void R_ImageBandJob( void *data, int index ) {
+	imageBand_t	*band = (imageBand_t *)data;
+	int			firstRow;
+
+	firstRow = index * band->rowsPerBand;
+	band->function( band, firstRow, MIN( band->rowsPerBand, band->outHeight - firstRow ) );
+}
+
+/*
+================
+R_RunImageBands
+
+Small images are done in place, they aren't worth a job
+================
+*/
+static void R_RunImageBands( imageBand_t *band ) {
+	int		numBands;
+
+	band->rowsPerBand = MAX( 1, IMAGE_BAND_PIXELS / band->outWidth );
+	numBands = ( band->outHeight + band->rowsPerBand - 1 ) / band->rowsPerBand;
+
+	if ( numBands <= 1 || ri.Job_NumThreads() <= 1 ) {
+		band->function( band, 0, band->outHeight );
+		return;
+	}
+
+	ri.Job_ParallelFor( R_ImageBandJob, band, numBands, 1 );
+}
+
+/*
+================
+R_ResampleRows
+================
+*/
+static void R_ResampleRows( imageBand_t *band, int firstRow, int numRows ) {
+	const int	*p1 = band->table;
+	const int	*p2 = band->table + band->outWidth;
+	const byte	*inrow, *inrow2;
+	const byte	*pix1, *pix2, *pix3, *pix4;
+	byte		*out;
+	int			i, j;
+
+	for ( i = firstRow ; i < firstRow + numRows ; i++ ) {
+		inrow = band->in + 4 * band->inWidth * (int)( ( i + 0.25 ) * band->inHeight / band->outHeight );
+		inrow2 = band->in + 4 * band->inWidth * (int)( ( i + 0.75 ) * band->inHeight / band->outHeight );
+		out = band->out + 4 * band->outWidth * i;
+		for ( j = 0 ; j < band->outWidth ; j++, out += 4 ) {
+			pix1 = inrow + p1[j];
+			pix2 = inrow + p2[j];
+			pix3 = inrow2 + p1[j];
+			pix4 = inrow2 + p2[j];
+			out[0] = ( pix1[0] + pix2[0] + pix3[0] + pix4[0] ) >> 2;
+			out[1] = ( pix1[1] + pix2[1] + pix3[1] + pix4[1] ) >> 2;
+			out[2] = ( pix1[2] + pix2[2] + pix3[2] + pix4[2] ) >> 2;
+			out[3] = ( pix1[3] + pix2[3] + pix3[3] + pix4[3] ) >> 2;
+		}
+	}
+}
+
 /*
 ================
 ResampleTexture
@@ -225,71 +336,62 @@ Used to resample images in a more general than quartering fashion.
 This will only be filtered properly if the resampled size
 is greater than half the original size.
 
-If a larger shrinking is needed, use the mipmap function 
+If a larger shrinking is needed, use the mipmap function
 before or after.
 ================
 */
-static void ResampleTexture( unsigned *in, int inwidth, int inheight, unsigned *out,  
+static void ResampleTexture( unsigned *in, int inwidth, int inheight, unsigned *out,
 							int outwidth, int outheight ) {
-	int		i, j;
-	unsigned	*inrow, *inrow2;
+	imageBand_t	band;
+	int			*table;
+	int			i;
 	unsigned	frac, fracstep;
-	unsigned	p1[2048], p2[2048];
-	byte		*pix1, *pix2, *pix3, *pix4;
 
-	if (outwidth>2048)
-		ri.Error(ERR_DROP, "ResampleTexture: max width");
-								
+	table = ri.Malloc( outwidth * 2 * sizeof( *table ) );
+
 	fracstep = inwidth*0x10000/outwidth;
 
 	frac = fracstep>>2;
 	for ( i=0 ; i<outwidth ; i++ ) {
-		p1[i] = 4*(frac>>16);
+		table[i] = 4*(frac>>16);
 		frac += fracstep;
 	}
 	frac = 3*(fracstep>>2);
 	for ( i=0 ; i<outwidth ; i++ ) {
-		p2[i] = 4*(frac>>16);
+		table[outwidth + i] = 4*(frac>>16);
 		frac += fracstep;
 	}
 
-	for (i=0 ; i<outheight ; i++, out += outwidth) {
-		inrow = in + inwidth*(int)((i+0.25)*inheight/outheight);
-		inrow2 = in + inwidth*(int)((i+0.75)*inheight/outheight);
-		frac = fracstep >> 1;
-		for (j=0 ; j<outwidth ; j++) {
-			pix1 = (byte *)inrow + p1[j];
-			pix2 = (byte *)inrow + p2[j];
-			pix3 = (byte *)inrow2 + p1[j];
-			pix4 = (byte *)inrow2 + p2[j];
-			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
-			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
-			((byte *)(out+j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
-			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
-		}
-	}
+	Com_Memset( &band, 0, sizeof( band ) );
+	band.function = R_ResampleRows;
+	band.in = (byte *)in;
+	band.inWidth = inwidth;
+	band.inHeight = inheight;
+	band.out = (byte *)out;
+	band.outWidth = outwidth;
+	band.outHeight = outheight;
+	band.table = table;
+	R_RunImageBands( &band );
+
+	ri.Free( table );
 }
 
 /*
 ================
-R_LightScaleTexture
-
-Scale up the pixel values in a texture to increase the
-lighting range
+R_LightScaleRows
 ================
 */
-void R_LightScaleTexture (unsigned *in, int inwidth, int inheight, qboolean only_gamma )
-{
-	if ( only_gamma )
+static void R_LightScaleRows( imageBand_t *band, int firstRow, int numRows ) {
+	int		i, c;
+	byte	*p;
+
+	p = band->out + 4 * band->outWidth * firstRow;
+	c = band->outWidth * numRows;
+
+	if ( band->param )
 	{
 		if ( !glConfig.deviceSupportsGamma )
 		{
-			int		i, c;
-			byte	*p;
-
-			p = (byte *)in;
-
-			c = inwidth*inheight;
 			for (i=0 ; i<c ; i++, p+=4)
 			{
 				p[0] = s_gammatable[p[0]];
@@ -300,13 +402,6 @@ void R_LightScaleTexture (unsigned *in, int inwidth, int inheight, qboolean only
 	}
 	else
 	{
-		int		i, c;
-		byte	*p;
-
-		p = (byte *)in;
-
-		c = inwidth*inheight;
-
 		if ( glConfig.deviceSupportsGamma )
 		{
 			for (i=0 ; i<c ; i++, p+=4)
@@ -328,92 +423,207 @@ void R_LightScaleTexture (unsigned *in, int inwidth, int inheight, qboolean only
 	}
 }
 
+/*
+================
+R_LightScaleTexture
+
+Scale up the pixel values in a texture to increase the
+lighting range
+================
+*/
+void R_LightScaleTexture (unsigned *in, int inwidth, int inheight, qboolean only_gamma )
+{
+	imageBand_t	band;
+
+	if ( only_gamma && glConfig.deviceSupportsGamma ) {
+		return;
+	}
+
+	Com_Memset( &band, 0, sizeof( band ) );
+	band.function = R_LightScaleRows;
+	band.out = (byte *)in;
+	band.outWidth = inwidth;
+	band.outHeight = inheight;
+	band.param = only_gamma;
+	R_RunImageBands( &band );
+}
+
+/*
+================
+R_GreyscaleRows
+================
+*/
+static void R_GreyscaleRows( imageBand_t *band, int firstRow, int numRows ) {
+	int		i, c;
+	byte	*scan;
+
+	scan = band->out + 4 * band->outWidth * firstRow;
+	c = band->outWidth * numRows;
+
+	if( r_greyscale->integer )
+	{
+		for ( i = 0; i < c; i++ )
+		{
+			byte luma = LUMA(scan[i*4], scan[i*4 + 1], scan[i*4 + 2]);
+			scan[i*4] = luma;
+			scan[i*4 + 1] = luma;
+			scan[i*4 + 2] = luma;
+		}
+	}
+	else
+	{
+		for ( i = 0; i < c; i++ )
+		{
+			float luma = LUMA(scan[i*4], scan[i*4 + 1], scan[i*4 + 2]);
+			scan[i*4] = LERP(scan[i*4], luma, r_greyscale->value);
+			scan[i*4 + 1] = LERP(scan[i*4 + 1], luma, r_greyscale->value);
+			scan[i*4 + 2] = LERP(scan[i*4 + 2], luma, r_greyscale->value);
+		}
+	}
+}
 
 /*
 ================
-R_MipMap2
+R_MipMap2Rows
 
-Operates in place, quartering the size of the texture
 Proper linear filter
 ================
 */
-static void R_MipMap2( unsigned *in, int inWidth, int inHeight ) {
+static void R_MipMap2Rows( imageBand_t *band, int firstRow, int numRows ) {
+	const byte	*in = band->in;
 	int			i, j, k;
 	byte		*outpix;
-	int			inWidthMask, inHeightMask;
+	int			inWidth, inWidthMask, inHeightMask;
 	int			total;
-	int			outWidth, outHeight;
-	unsigned	*temp;
 
-	outWidth = inWidth >> 1;
-	outHeight = inHeight >> 1;
-	temp = ri.Hunk_AllocateTempMemory( outWidth * outHeight * 4 );
+	inWidth = band->inWidth;
+	inWidthMask = band->inWidth - 1;
+	inHeightMask = band->inHeight - 1;
 
-	inWidthMask = inWidth - 1;
-	inHeightMask = inHeight - 1;
+#define	MIP2PIX( y, x )		in[ ( ( ( (y) & inHeightMask ) * inWidth ) + ( (x) & inWidthMask ) ) * 4 + k ]
 
-	for ( i = 0 ; i < outHeight ; i++ ) {
-		for ( j = 0 ; j < outWidth ; j++ ) {
-			outpix = (byte *) ( temp + i * outWidth + j );
+	for ( i = firstRow ; i < firstRow + numRows ; i++ ) {
+		for ( j = 0 ; j < band->outWidth ; j++ ) {
+			outpix = band->out + ( i * band->outWidth + j ) * 4;
 			for ( k = 0 ; k < 4 ; k++ ) {
-				total = 
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k];
+				total =
+					1 * MIP2PIX( i*2-1, j*2-1 ) +
+					2 * MIP2PIX( i*2-1, j*2 ) +
+					2 * MIP2PIX( i*2-1, j*2+1 ) +
+					1 * MIP2PIX( i*2-1, j*2+2 ) +
+
+					2 * MIP2PIX( i*2, j*2-1 ) +
+					4 * MIP2PIX( i*2, j*2 ) +
+					4 * MIP2PIX( i*2, j*2+1 ) +
+					2 * MIP2PIX( i*2, j*2+2 ) +
+
+					2 * MIP2PIX( i*2+1, j*2-1 ) +
+					4 * MIP2PIX( i*2+1, j*2 ) +
+					4 * MIP2PIX( i*2+1, j*2+1 ) +
+					2 * MIP2PIX( i*2+1, j*2+2 ) +
+
+					1 * MIP2PIX( i*2+2, j*2-1 ) +
+					2 * MIP2PIX( i*2+2, j*2 ) +
+					2 * MIP2PIX( i*2+2, j*2+1 ) +
+					1 * MIP2PIX( i*2+2, j*2+2 );
 				outpix[k] = total / 36;
 			}
 		}
 	}
 
-	Com_Memcpy( in, temp, outWidth * outHeight * 4 );
-	ri.Hunk_FreeTempMemory( temp );
+#undef MIP2PIX
 }
 
+#if MIP_SSE2
 /*
 ================
-R_MipMap
+R_MipMapRow_sse2
 
-Operates in place, quartering the size of the texture
+Four output pixels a pass, summed in 16 bits so the
+result is the same as the plain C loop
 ================
 */
-static void R_MipMap (byte *in, int width, int height) {
-	int		i, j;
-	byte	*out;
-	int		row;
+static int R_MipMapRow_sse2( const byte *in, const byte *in2, byte *out, int outWidth ) {
+	__m128i	zero, a0, a1, b0, b1;
+	__m128i	s0, s1, s2, s3;
+	int		j;
+
+	zero = _mm_setzero_si128();
+	for ( j = 0 ; j + 4 <= outWidth ; j += 4, in += 32, in2 += 32, out += 16 ) {
+		a0 = _mm_loadu_si128( (const __m128i *)in );
+		a1 = _mm_loadu_si128( (const __m128i *)( in + 16 ) );
+		b0 = _mm_loadu_si128( (const __m128i *)in2 );
+		b1 = _mm_loadu_si128( (const __m128i *)( in2 + 16 ) );
+
+		// add the two rows, two input pixels per register
+		s0 = _mm_add_epi16( _mm_unpacklo_epi8( a0, zero ), _mm_unpacklo_epi8( b0, zero ) );
+		s1 = _mm_add_epi16( _mm_unpackhi_epi8( a0, zero ), _mm_unpackhi_epi8( b0, zero ) );
+		s2 = _mm_add_epi16( _mm_unpacklo_epi8( a1, zero ), _mm_unpacklo_epi8( b1, zero ) );
+		s3 = _mm_add_epi16( _mm_unpackhi_epi8( a1, zero ), _mm_unpackhi_epi8( b1, zero ) );
+
+		// then the neighbouring columns
+		s0 = _mm_add_epi16( s0, _mm_srli_si128( s0, 8 ) );
+		s1 = _mm_add_epi16( s1, _mm_srli_si128( s1, 8 ) );
+		s2 = _mm_add_epi16( s2, _mm_srli_si128( s2, 8 ) );
+		s3 = _mm_add_epi16( s3, _mm_srli_si128( s3, 8 ) );
+
+		s0 = _mm_srli_epi16( _mm_unpacklo_epi64( s0, s1 ), 2 );
+		s2 = _mm_srli_epi16( _mm_unpacklo_epi64( s2, s3 ), 2 );
+		_mm_storeu_si128( (__m128i *)out, _mm_packus_epi16( s0, s2 ) );
+	}
+
+	return j;
+}
+#endif
 
-	if ( !r_simpleMipMaps->integer ) {
-		R_MipMap2( (unsigned *)in, width, height );
-		return;
-	}
+/*
+================
+R_MipMapRows
 
-	if ( width == 1 && height == 1 ) {
-		return;
+Box filter
+================
+*/
+static void R_MipMapRows( imageBand_t *band, int firstRow, int numRows ) {
+	const byte	*in;
+	byte		*out;
+	int			i, j;
+	int			row;
+
+	row = band->inWidth * 4;
+
+	for ( i = firstRow ; i < firstRow + numRows ; i++ ) {
+		in = band->in + i * 2 * row;
+		out = band->out + i * band->outWidth * 4;
+		j = 0;
+#if MIP_SSE2
+		j = R_MipMapRow_sse2( in, in + row, out, band->outWidth );
+		in += j * 8;
+		out += j * 4;
+#endif
+		for ( ; j < band->outWidth ; j++, out += 4, in += 8 ) {
+			out[0] = (in[0] + in[4] + in[row+0] + in[row+4])>>2;
+			out[1] = (in[1] + in[5] + in[row+1] + in[row+5])>>2;
+			out[2] = (in[2] + in[6] + in[row+2] + in[row+6])>>2;
+			out[3] = (in[3] + in[7] + in[row+3] + in[row+7])>>2;
+		}
 	}
+}
 
-	row = width * 4;
-	out = in;
-	width >>= 1;
-	height >>= 1;
+/*
+================
+R_MipMap
 
-	if ( width == 0 || height == 0 ) {
-		width += height;	// get largest
-		for (i=0 ; i<width ; i++, out+=4, in+=8 ) {
+Writes the next mip level of in to out, quartering the size
+================
+*/
+static void R_MipMap( const byte *in, int width, int height, byte *out ) {
+	imageBand_t	band;
+	int			i, count;
+
+	// a single row or column is averaged in pairs
+	if ( width == 1 || height == 1 ) {
+		count = ( width >> 1 ) + ( height >> 1 );
+		for ( i = 0 ; i < count ; i++, out += 4, in += 8 ) {
 			out[0] = ( in[0] + in[4] )>>1;
 			out[1] = ( in[1] + in[5] )>>1;
 			out[2] = ( in[2] + in[6] )>>1;
@@ -422,14 +632,15 @@ static void R_MipMap (byte *in, int width, int height) {
 		return;
 	}
 
-	for (i=0 ; i<height ; i++, in+=row) {
-		for (j=0 ; j<width ; j++, out+=4, in+=8) {
-			out[0] = (in[0] + in[4] + in[row+0] + in[row+4])>>2;
-			out[1] = (in[1] + in[5] + in[row+1] + in[row+5])>>2;
-			out[2] = (in[2] + in[6] + in[row+2] + in[row+6])>>2;
-			out[3] = (in[3] + in[7] + in[row+3] + in[row+7])>>2;
-		}
-	}
+	Com_Memset( &band, 0, sizeof( band ) );
+	band.function = r_simpleMipMaps->integer ? R_MipMapRows : R_MipMap2Rows;
+	band.in = in;
+	band.inWidth = width;
+	band.inHeight = height;
+	band.out = out;
+	band.outWidth = width >> 1;
+	band.outHeight = height >> 1;
+	R_RunImageBands( &band );
 }
 
 
@@ -477,30 +688,61 @@ byte	mipBlendColors[16][4] = {
 };
 
 
+/*
+=============================================================================
+
+UPLOAD
+
+R_PrepareUpload does everything up to the GL calls: the power of two
+resample, picmip, greyscale, picking the internal format, light
+scaling and the whole mip chain.  It may run on any thread.
+R_UploadLevels then hands the finished levels to GL on the main thread.
+
+=============================================================================
+*/
+
+#define	MAX_UPLOAD_LEVELS		32
+
+typedef struct {
+	byte		*data;				// source pixels
+	int			width, height;
+	qboolean	mipmap;				// cleared if r_mipmaps is off
+	qboolean	picmip;
+	qboolean	lightMap;
+
+	int			internalFormat;
+	int			numLevels;
+	int			levelWidth[MAX_UPLOAD_LEVELS];
+	int			levelHeight[MAX_UPLOAD_LEVELS];
+	byte		*levels[MAX_UPLOAD_LEVELS];
+	byte		*buffer;			// every level, unless levels[0] is the source
+	byte		*resampled;			// the power of two copy of the source
+} imageUpload_t;
+
 /*
 ===============
-Upload32
+R_PrepareUpload
 
+The source pixels may be changed in place
 ===============
 */
-extern qboolean charSet;
-static void Upload32( unsigned *data, 
-						  int width, int height, 
-						  qboolean mipmap, 
-						  qboolean picmip, 
-							qboolean lightMap,
-						  int *format, 
-						  int *pUploadWidth, int *pUploadHeight )
-{
+static void R_PrepareUpload( imageUpload_t *upload ) {
+	unsigned	*data = (unsigned *)upload->data;
+	int			width = upload->width;
+	int			height = upload->height;
+	byte		*src, *dst;
 	int			samples;
-	unsigned	*scaledBuffer = NULL;
-	unsigned	*resampledBuffer = NULL;
 	int			scaled_width, scaled_height;
-	int			i, c;
+	int			mipWidth, mipHeight;
+	int			i, c, size;
 	byte		*scan;
 	GLenum		internalFormat = GL_RGB;
 	float		rMax = 0, gMax = 0, bMax = 0;
-	if(!r_mipmaps->integer){mipmap = qfalse;}
+
+	if ( !r_mipmaps->integer ) {
+		upload->mipmap = qfalse;
+	}
+
 	//
 	// convert to exact power of 2 sizes
 	//
@@ -514,9 +756,9 @@ static void Upload32( unsigned *data,
 		scaled_height >>= 1;
 
 	if ( scaled_width != width || scaled_height != height ) {
-		resampledBuffer = ri.Hunk_AllocateTempMemory( scaled_width * scaled_height * 4 );
-		ResampleTexture (data, width, height, resampledBuffer, scaled_width, scaled_height);
-		data = resampledBuffer;
+		upload->resampled = ri.Malloc( scaled_width * scaled_height * 4 );
+		ResampleTexture (data, width, height, (unsigned *)upload->resampled, scaled_width, scaled_height);
+		data = (unsigned *)upload->resampled;
 		width = scaled_width;
 		height = scaled_height;
 	}
@@ -524,7 +766,7 @@ static void Upload32( unsigned *data,
 	//
 	// perform optional picmip operation
 	//
-	if ( picmip ) {
+	if ( upload->picmip ) {
 		scaled_width >>= r_picmip->integer;
 		scaled_height >>= r_picmip->integer;
 	}
@@ -550,8 +792,6 @@ static void Upload32( unsigned *data,
 		scaled_height >>= 1;
 	}
 
-	scaledBuffer = ri.Hunk_AllocateTempMemory( sizeof( unsigned ) * scaled_width * scaled_height );
-
 	//
 	// scan the texture for each channel's max values
 	// and verify if the alpha channel is being used or not
@@ -560,28 +800,19 @@ static void Upload32( unsigned *data,
 	scan = ((byte *)data);
 	samples = 3;
 
-	if( r_greyscale->integer )
-	{
-		for ( i = 0; i < c; i++ )
-		{
-			byte luma = LUMA(scan[i*4], scan[i*4 + 1], scan[i*4 + 2]);
-			scan[i*4] = luma;
-			scan[i*4 + 1] = luma;
-			scan[i*4 + 2] = luma;
-		}
-	}
-	else if( r_greyscale->value )
+	if( r_greyscale->value )
 	{
-		for ( i = 0; i < c; i++ )
-		{
-			float luma = LUMA(scan[i*4], scan[i*4 + 1], scan[i*4 + 2]);
-			scan[i*4] = LERP(scan[i*4], luma, r_greyscale->value);
-			scan[i*4 + 1] = LERP(scan[i*4 + 1], luma, r_greyscale->value);
-			scan[i*4 + 2] = LERP(scan[i*4 + 2], luma, r_greyscale->value);
-		}
+		imageBand_t	band;
+
+		Com_Memset( &band, 0, sizeof( band ) );
+		band.function = R_GreyscaleRows;
+		band.out = scan;
+		band.outWidth = width;
+		band.outHeight = height;
+		R_RunImageBands( &band );
 	}
 
-	if(lightMap)
+	if(upload->lightMap)
 	{
 		if(r_greyscale->integer)
 			internalFormat = GL_LUMINANCE;
@@ -604,7 +835,7 @@ static void Upload32( unsigned *data,
 			{
 				bMax = scan[i*4+2];
 			}
-			if ( scan[i*4 + 3] != 255 ) 
+			if ( scan[i*4 + 3] != 255 )
 			{
 				samples = 4;
 				break;
@@ -675,71 +906,122 @@ static void Upload32( unsigned *data,
 		}
 	}
 
-	// copy or resample data as appropriate for first MIP level
-	if ( ( scaled_width == width ) && 
-		( scaled_height == height ) ) {
-		if (!mipmap)
-		{
-			qglTexImage2D (GL_TEXTURE_2D, 0, internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-			*pUploadWidth = scaled_width;
-			*pUploadHeight = scaled_height;
-			*format = internalFormat;
+	upload->internalFormat = internalFormat;
+	upload->numLevels = 1;
+	upload->levelWidth[0] = scaled_width;
+	upload->levelHeight[0] = scaled_height;
+
+	// an unscaled image without mips goes to GL as it is
+	if ( scaled_width == width && scaled_height == height && !upload->mipmap ) {
+		upload->levels[0] = (byte *)data;
+		return;
+	}
 
-			goto done;
+	// lay out the mip chain in one block
+	size = scaled_width * scaled_height * 4;
+	if ( upload->mipmap ) {
+		mipWidth = scaled_width;
+		mipHeight = scaled_height;
+		while ( ( mipWidth > 1 || mipHeight > 1 ) && upload->numLevels < MAX_UPLOAD_LEVELS ) {
+			mipWidth = MAX( 1, mipWidth >> 1 );
+			mipHeight = MAX( 1, mipHeight >> 1 );
+			upload->levelWidth[upload->numLevels] = mipWidth;
+			upload->levelHeight[upload->numLevels] = mipHeight;
+			upload->numLevels++;
+			size += mipWidth * mipHeight * 4;
 		}
-		Com_Memcpy (scaledBuffer, data, width*height*4);
+	}
+
+	upload->buffer = ri.Malloc( size );
+	upload->levels[0] = upload->buffer;
+	for ( i = 1 ; i < upload->numLevels ; i++ ) {
+		upload->levels[i] = upload->levels[i-1] + upload->levelWidth[i-1] * upload->levelHeight[i-1] * 4;
+	}
+
+	// copy or resample data as appropriate for first MIP level
+	if ( ( scaled_width == width ) &&
+		( scaled_height == height ) ) {
+		Com_Memcpy( upload->buffer, data, width*height*4 );
 	}
 	else
 	{
-		// use the normal mip-mapping function to go down from here
+		// use the normal mip-mapping function to go down from here,
+		// the last step lands in the first level
+		src = (byte *)data;
 		while ( width > scaled_width || height > scaled_height ) {
-			R_MipMap( (byte *)data, width, height );
-			width >>= 1;
-			height >>= 1;
-			if ( width < 1 ) {
-				width = 1;
+			mipWidth = MAX( 1, width >> 1 );
+			mipHeight = MAX( 1, height >> 1 );
+			if ( mipWidth == scaled_width && mipHeight == scaled_height ) {
+				dst = upload->buffer;
+			} else {
+				dst = ri.Malloc( mipWidth * mipHeight * 4 );
 			}
-			if ( height < 1 ) {
-				height = 1;
+			R_MipMap( src, width, height, dst );
+			if ( src != (byte *)data ) {
+				ri.Free( src );
 			}
+			src = dst;
+			width = mipWidth;
+			height = mipHeight;
 		}
-		Com_Memcpy( scaledBuffer, data, width * height * 4 );
 	}
 
-	R_LightScaleTexture (scaledBuffer, scaled_width, scaled_height, !mipmap );
-
-	*pUploadWidth = scaled_width;
-	*pUploadHeight = scaled_height;
-	*format = internalFormat;
+	if ( upload->resampled ) {
+		ri.Free( upload->resampled );
+		upload->resampled = NULL;
+	}
 
-	qglTexImage2D (GL_TEXTURE_2D, 0, internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaledBuffer );
-	//qglTexParameterf(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, r_mipmaps->integer);
-	if (mipmap)
-	{
-		int		miplevel;
+	R_LightScaleTexture( (unsigned *)upload->buffer, scaled_width, scaled_height, !upload->mipmap );
 
-		miplevel = 0;
-		while (scaled_width > 1 || scaled_height > 1)
-		{
-			R_MipMap( (byte *)scaledBuffer, scaled_width, scaled_height );
-			scaled_width >>= 1;
-			scaled_height >>= 1;
-			if (scaled_width < 1)
-				scaled_width = 1;
-			if (scaled_height < 1)
-				scaled_height = 1;
-			miplevel++;
-
-			if ( r_colorMipLevels->integer ) {
-				R_BlendOverTexture( (byte *)scaledBuffer, scaled_width * scaled_height, mipBlendColors[miplevel] );
-			}
+	for ( i = 1 ; i < upload->numLevels ; i++ ) {
+		R_MipMap( upload->levels[i-1], upload->levelWidth[i-1], upload->levelHeight[i-1], upload->levels[i] );
 
-			qglTexImage2D (GL_TEXTURE_2D, miplevel, internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaledBuffer );
+		if ( r_colorMipLevels->integer ) {
+			R_BlendOverTexture( upload->levels[i], upload->levelWidth[i] * upload->levelHeight[i], mipBlendColors[i & 15] );
 		}
 	}
-done:
+}
+
+/*
+===============
+R_FreeUpload
+
+Frees what R_PrepareUpload allocated, not the source pixels
+===============
+*/
+static void R_FreeUpload( imageUpload_t *upload ) {
+	if ( upload->buffer ) {
+		ri.Free( upload->buffer );
+	}
+	if ( upload->resampled ) {
+		ri.Free( upload->resampled );
+	}
+	upload->buffer = NULL;
+	upload->resampled = NULL;
+	upload->numLevels = 0;
+}
+
+/*
+===============
+R_UploadLevels
+
+Sends a prepared upload to the bound texture
+===============
+*/
+static void R_UploadLevels( imageUpload_t *upload, int *format, int *pUploadWidth, int *pUploadHeight ) {
+	int		i;
+
+	for ( i = 0 ; i < upload->numLevels ; i++ ) {
+		qglTexImage2D( GL_TEXTURE_2D, i, upload->internalFormat, upload->levelWidth[i], upload->levelHeight[i],
+			0, GL_RGBA, GL_UNSIGNED_BYTE, upload->levels[i] );
+	}
+	//qglTexParameterf(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, r_mipmaps->integer);
 
-	if (mipmap)
+	*pUploadWidth = upload->levelWidth[0];
+	*pUploadHeight = upload->levelHeight[0];
+	*format = upload->internalFormat;
+
+	if (upload->mipmap)
 	{
 		if ( textureFilterAnisotropic )
 			qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
@@ -761,22 +1043,18 @@ done:
 	}
 
 	GL_CheckErrors();
-
-	if ( scaledBuffer != 0 )
-		ri.Hunk_FreeTempMemory( scaledBuffer );
-	if ( resampledBuffer != 0 )
-		ri.Hunk_FreeTempMemory( resampledBuffer );
 }
 
 
 /*
 ================
-R_CreateImage
+R_CreateImageFromUpload
 
-This is the only way any image_t are created
+Every image_t is created here, the upload is prepared
+first if it hasn't been already
 ================
 */
-image_t *R_CreateImage( const char *name, const byte *pic, int width, int height, 
+static image_t *R_CreateImageFromUpload( const char *name, imageUpload_t *upload, int width, int height,
 					   qboolean mipmap, qboolean allowPicmip, int glWrapClampMode ) {
 	image_t		*image;
 	qboolean	isLightmap = qfalse;
@@ -793,6 +1071,11 @@ image_t *R_CreateImage( const char *name, const byte *pic, int width, int height
 		ri.Error( ERR_DROP, "R_CreateImage: MAX_DRAWIMAGES hit");
 	}
 
+	if ( !upload->numLevels ) {
+		upload->lightMap = isLightmap;
+		R_PrepareUpload( upload );
+	}
+
 	image = tr.images[tr.numImages] = ri.Hunk_Alloc( sizeof( image_t ), h_low );
 	image->texnum = 1024 + tr.numImages;
 	tr.numImages++;
@@ -819,13 +1102,7 @@ image_t *R_CreateImage( const char *name, const byte *pic, int width, int height
 
 	GL_Bind(image);
 
-	Upload32( (unsigned *)pic, image->width, image->height, 
-								image->mipmap,
-								allowPicmip,
-								isLightmap,
-								&image->internalFormat,
-								&image->uploadWidth,
-								&image->uploadHeight );
+	R_UploadLevels( upload, &image->internalFormat, &image->uploadWidth, &image->uploadHeight );
 
 	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, glWrapClampMode );
 	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, glWrapClampMode );
@@ -843,52 +1120,1139 @@ image_t *R_CreateImage( const char *name, const byte *pic, int width, int height
 	return image;
 }
 
-//===================================================================
+/*
+================
+R_CreateImage
 
-typedef struct
-{
-	char *ext;
-	void (*ImageLoader)( const char *, unsigned char **, int *, int * );
-} imageExtToLoaderMap_t;
+This is the only way any image_t are created
+================
+*/
+image_t *R_CreateImage( const char *name, const byte *pic, int width, int height, 
+					   qboolean mipmap, qboolean allowPicmip, int glWrapClampMode ) {
+	imageUpload_t	upload;
+	image_t			*image;
 
-// Note that the ordering indicates the order of preference used
-// when there are multiple images of different formats available
-static imageExtToLoaderMap_t imageLoaders[ ] =
-{
-	{ "tga",  R_LoadTGA },
-	{ "jpg",  R_LoadJPG },
-	{ "jpeg", R_LoadJPG },
-	{ "png",  R_LoadPNG },
-	{ "pcx",  R_LoadPCX },
-	{ "bmp",  R_LoadBMP }
-};
+	Com_Memset( &upload, 0, sizeof( upload ) );
+	upload.data = (byte *)pic;
+	upload.width = width;
+	upload.height = height;
+	upload.mipmap = mipmap;
+	upload.picmip = allowPicmip;
 
-static int numImageLoaders = ARRAY_LEN( imageLoaders );
+	image = R_CreateImageFromUpload( name, &upload, width, height, mipmap, allowPicmip, glWrapClampMode );
+	R_FreeUpload( &upload );
+
+	return image;
+}
+
+//===================================================================
 
 /*
 =================
-R_LoadImage
+R_DecodeError
 
-Loads any of the supported image types into a cannonical
-32 bit format.
+Fails the decode, freeing the pic if the decoder had allocated it
 =================
 */
-void R_LoadImage( const char *name, byte **pic, int *width, int *height )
-{
-	qboolean orgNameFailed = qfalse;
-	int orgLoader = -1;
-	int i;
-	char localName[ MAX_QPATH ];
-	const char *ext;
-	char *altName;
+void R_DecodeError( imageDecode_t *decode, int level, const char *fmt, ... ) {
+	va_list		argptr;
 
-	*pic = NULL;
-	*width = 0;
-	*height = 0;
+	if ( decode->pic ) {
+		ri.Free( decode->pic );
+		decode->pic = NULL;
+	}
+	decode->width = 0;
+	decode->height = 0;
+	decode->errorLevel = level;
 
-	Q_strncpyz( localName, name, MAX_QPATH );
+	va_start( argptr, fmt );
+	Q_vsnprintf( decode->error, sizeof( decode->error ), fmt, argptr );
+	va_end( argptr );
+}
 
-	ext = COM_GetExtension( localName );
+/*
+=================
+R_DecodeWarning
+=================
+*/
+void R_DecodeWarning( imageDecode_t *decode, const char *fmt, ... ) {
+	va_list		argptr;
+	int			len;
+
+	len = strlen( decode->warning );
+	va_start( argptr, fmt );
+	Q_vsnprintf( decode->warning + len, sizeof( decode->warning ) - len, fmt, argptr );
+	va_end( argptr );
+}
+
+/*
+=================
+R_FinishImageDecode
+
+Reports what the decoder ran into and hands over the pic
+=================
+*/
+void R_FinishImageDecode( imageDecode_t *decode, byte **pic, int *width, int *height ) {
+	if ( decode->warning[0] ) {
+		ri.Printf( PRINT_WARNING, "%s", decode->warning );
+	}
+	if ( decode->error[0] ) {
+		ri.Error( decode->errorLevel, "%s", decode->error );
+	}
+
+	*pic = decode->pic;
+	if ( width ) {
+		*width = decode->width;
+	}
+	if ( height ) {
+		*height = decode->height;
+	}
+	decode->pic = NULL;
+}
+
+/*
+=================
+R_DecodeImageFile
+=================
+*/
+void R_DecodeImageFile( const char *name, imageDecoder_t decoder, byte **pic, int *width, int *height ) {
+	imageDecode_t	decode;
+	void			*buffer;
+
+	*pic = NULL;
+	if ( width ) {
+		*width = 0;
+	}
+	if ( height ) {
+		*height = 0;
+	}
+
+	Com_Memset( &decode, 0, sizeof( decode ) );
+	decode.name = name;
+	decode.length = ri.FS_ReadFileView( name, &buffer );
+	if ( !buffer || decode.length < 0 ) {
+		return;
+	}
+	decode.buffer = buffer;
+
+	decoder( &decode );
+
+	ri.FS_ReleaseView( buffer );
+	R_FinishImageDecode( &decode, pic, width, height );
+}
+
+typedef struct
+{
+	char *ext;
+	void (*ImageLoader)( const char *, unsigned char **, int *, int * );
+	imageDecoder_t ImageDecoder;	// NULL if the format can't be prefetched
+} imageExtToLoaderMap_t;
+
+// Note that the ordering indicates the order of preference used
+// when there are multiple images of different formats available
+static imageExtToLoaderMap_t imageLoaders[ ] =
+{
+	{ "tga",  R_LoadTGA, R_DecodeTGA },
+	{ "jpg",  R_LoadJPG, R_DecodeJPG },
+	{ "jpeg", R_LoadJPG, R_DecodeJPG },
+	{ "png",  R_LoadPNG, R_DecodePNG },
+	{ "pcx",  R_LoadPCX, NULL },
+	{ "bmp",  R_LoadBMP, NULL }
+};
+
+static int numImageLoaders = ARRAY_LEN( imageLoaders );
+
+/*
+=================
+R_FindImageSource
+
+Finds the file R_LoadImageFile would try first, returns what
+FS_PakFileCRC does for it
+=================
+*/
+static int R_FindImageSource( const char *name, char *source, int *crc ) {
+	char		localName[MAX_QPATH];
+	const char	*ext;
+	char		*altName;
+	int			orgLoader = -1;
+	int			found;
+	int			i;
+
+	Q_strncpyz( localName, name, MAX_QPATH );
+
+	ext = COM_GetExtension( localName );
+	if ( *ext ) {
+		for ( i = 0; i < numImageLoaders; i++ ) {
+			if ( !Q_stricmp( ext, imageLoaders[i].ext ) ) {
+				break;
+			}
+		}
+
+		if ( i < numImageLoaders ) {
+			found = ri.FS_PakFileCRC( localName, crc );
+			if ( found >= 0 ) {
+				Q_strncpyz( source, localName, MAX_QPATH );
+				return found;
+			}
+
+			orgLoader = i;
+			COM_StripExtension( name, localName, MAX_QPATH );
+		}
+	}
+
+	for ( i = 0; i < numImageLoaders; i++ ) {
+		if ( i == orgLoader ) {
+			continue;
+		}
+
+		altName = va( "%s.%s", localName, imageLoaders[i].ext );
+		found = ri.FS_PakFileCRC( altName, crc );
+		if ( found >= 0 ) {
+			Q_strncpyz( source, altName, MAX_QPATH );
+			return found;
+		}
+	}
+
+	return -1;
+}
+
+/*
+=============================================================================
+
+IMAGE CACHE
+
+Prepared uploads of images read from pk3s are kept in imagecache/ under
+fs_homepath, one file per image named after a key made from the source
+file, the crc the pk3 stores for it, the image parms and everything
+R_PrepareUpload depends on: picmip, rounding, mip filter, greyscale,
+texture bits and compression, the max texture size and the gamma and
+intensity tables.  Changing any of them just keys different files.
+The levels follow a fixed header unchanged, so a hit is mapped and
+handed to GL without decoding or mipping anything.
+
+imagecache/index.dat records the settings each file was made under,
+its size and the last level that read or wrote it.  When a level
+ends, the files made under other settings are removed, then the least
+recently used ones until the rest fit in r_imageCacheMegs.
+
+=============================================================================
+*/
+
+#define	IMAGECACHE_IDENT		(('C'<<24)+('G'<<16)+('M'<<8)+'I')
+#define	IMAGECACHE_VERSION		1
+
+typedef struct {
+	int		ident;
+	int		version;
+	int		crc;					// of the source file
+	int		key[2];
+	int		width, height;			// of the source image
+	int		mipmap;
+	int		internalFormat;
+	int		numLevels;
+	int		levelWidth[MAX_UPLOAD_LEVELS];
+	int		levelHeight[MAX_UPLOAD_LEVELS];
+} imageCacheHeader_t;
+
+typedef struct {
+	char	path[MAX_QPATH];		// empty if the image can't be cached
+	char	source[MAX_QPATH];
+	int		crc;
+	int		key[2];
+	int		settings;				// R_ImageCacheSettings
+} imageCacheEntry_t;
+
+#define	IMAGECACHE_INDEX			"imagecache/index.dat"
+#define	IMAGECACHE_INDEX_IDENT		(('X'<<24)+('C'<<16)+('M'<<8)+'I')
+#define	MAX_IMAGECACHE_FILES		4096
+#define	IMAGECACHE_HASH_SIZE		1024
+
+typedef struct {
+	int		key[2];
+	int		settings;				// R_ImageCacheSettings when it was written
+	int		size;
+	int		lastUsed;				// the imageCacheIndex.level it was last read or written in
+} imageCacheFile_t;
+
+typedef struct {
+	int		ident;
+	int		version;
+	int		level;
+	int		numFiles;
+	// followed by numFiles imageCacheFile_t
+} imageCacheIndexHeader_t;
+
+typedef struct {
+	qboolean			loaded;
+	qboolean			modified;
+	qboolean			swept;			// files the index lost track of have been removed
+	int					level;			// counts the levels that ended with the cache in use
+	int					numFiles;
+	imageCacheFile_t	files[MAX_IMAGECACHE_FILES];
+	int					next[MAX_IMAGECACHE_FILES];
+	int					hashTable[IMAGECACHE_HASH_SIZE];	// -1 ends a chain
+} imageCacheIndex_t;
+
+static imageCacheIndex_t	imageCacheIndex;
+
+/*
+=================
+R_ImageCacheHash
+=================
+*/
+static unsigned R_ImageCacheHash( unsigned hash, const byte *data, int length ) {
+	int		i;
+
+	for ( i = 0; i < length; i++ ) {
+		hash = ( hash ^ data[i] ) * 16777619;
+	}
+	return hash;
+}
+
+/*
+=================
+R_ImageCacheSettings
+
+Hashes everything R_PrepareUpload depends on besides the image parms
+=================
+*/
+static int R_ImageCacheSettings( void ) {
+	char		state[MAX_QPATH];
+	unsigned	hash;
+
+	Com_sprintf( state, sizeof( state ), "%i %i %i %i %i %g %i %i %i %i",
+		r_picmip->integer, r_roundImagesDown->integer, r_mipmaps->integer, r_simpleMipMaps->integer,
+		r_colorMipLevels->integer, r_greyscale->value, r_texturebits->integer, glConfig.textureCompression,
+		glConfig.maxTextureSize, glConfig.deviceSupportsGamma );
+
+	hash = R_ImageCacheHash( 2166136261u, (byte *)state, strlen( state ) );
+	hash = R_ImageCacheHash( hash, s_gammatable, sizeof( s_gammatable ) );
+	hash = R_ImageCacheHash( hash, s_intensitytable, sizeof( s_intensitytable ) );
+	return hash;
+}
+
+/*
+=================
+R_HashCachedFiles
+=================
+*/
+static void R_HashCachedFiles( void ) {
+	int		i, bucket;
+
+	for ( i = 0; i < IMAGECACHE_HASH_SIZE; i++ ) {
+		imageCacheIndex.hashTable[i] = -1;
+	}
+
+	for ( i = 0; i < imageCacheIndex.numFiles; i++ ) {
+		bucket = imageCacheIndex.files[i].key[0] & ( IMAGECACHE_HASH_SIZE - 1 );
+		imageCacheIndex.next[i] = imageCacheIndex.hashTable[bucket];
+		imageCacheIndex.hashTable[bucket] = i;
+	}
+}
+
+/*
+=================
+R_FindCachedFile
+
+Returns -1 if the index has no file for the key
+=================
+*/
+static int R_FindCachedFile( const int *key ) {
+	int		i;
+
+	for ( i = imageCacheIndex.hashTable[key[0] & ( IMAGECACHE_HASH_SIZE - 1 )]; i != -1; i = imageCacheIndex.next[i] ) {
+		if ( imageCacheIndex.files[i].key[0] == key[0] && imageCacheIndex.files[i].key[1] == key[1] ) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+=================
+R_LoadImageCacheIndex
+=================
+*/
+static void R_LoadImageCacheIndex( void ) {
+	imageCacheIndexHeader_t	*header;
+	imageCacheFile_t		*in, *out;
+	long					length;
+	int						i;
+
+	if ( imageCacheIndex.loaded ) {
+		return;
+	}
+
+	imageCacheIndex.loaded = qtrue;
+	imageCacheIndex.modified = qfalse;
+	imageCacheIndex.level = 0;
+	imageCacheIndex.numFiles = 0;
+
+	length = ri.FS_ReadFile( IMAGECACHE_INDEX, (void **)&header );
+	if ( header ) {
+		if ( length >= sizeof( *header ) && LittleLong( header->ident ) == IMAGECACHE_INDEX_IDENT &&
+			LittleLong( header->version ) == IMAGECACHE_VERSION ) {
+			imageCacheIndex.level = LittleLong( header->level );
+			imageCacheIndex.numFiles = LittleLong( header->numFiles );
+			if ( imageCacheIndex.numFiles < 0 || imageCacheIndex.numFiles > MAX_IMAGECACHE_FILES ||
+				length != sizeof( *header ) + imageCacheIndex.numFiles * sizeof( *in ) ) {
+				imageCacheIndex.numFiles = 0;
+			}
+		}
+
+		in = (imageCacheFile_t *)( header + 1 );
+		out = imageCacheIndex.files;
+		for ( i = 0; i < imageCacheIndex.numFiles; i++, in++, out++ ) {
+			out->key[0] = LittleLong( in->key[0] );
+			out->key[1] = LittleLong( in->key[1] );
+			out->settings = LittleLong( in->settings );
+			out->size = LittleLong( in->size );
+			out->lastUsed = LittleLong( in->lastUsed );
+		}
+
+		ri.FS_FreeFile( header );
+	}
+
+	R_HashCachedFiles();
+}
+
+/*
+=================
+R_TouchCachedFile
+
+Records a hit or a write in the index.  Returns qfalse if the
+index is full, and the file shouldn't be written.
+=================
+*/
+static qboolean R_TouchCachedFile( const imageCacheEntry_t *entry, int size ) {
+	imageCacheFile_t	*file;
+	int					i, bucket;
+
+	i = R_FindCachedFile( entry->key );
+	if ( i == -1 ) {
+		if ( imageCacheIndex.numFiles == MAX_IMAGECACHE_FILES ) {
+			return qfalse;
+		}
+
+		i = imageCacheIndex.numFiles++;
+		bucket = entry->key[0] & ( IMAGECACHE_HASH_SIZE - 1 );
+		imageCacheIndex.next[i] = imageCacheIndex.hashTable[bucket];
+		imageCacheIndex.hashTable[bucket] = i;
+	}
+
+	file = &imageCacheIndex.files[i];
+	file->key[0] = entry->key[0];
+	file->key[1] = entry->key[1];
+	file->settings = entry->settings;
+	file->size = size;
+	file->lastUsed = imageCacheIndex.level;
+	imageCacheIndex.modified = qtrue;
+
+	return qtrue;
+}
+
+/*
+=================
+R_SortCachedFiles
+
+Most recently used first
+=================
+*/
+static int R_SortCachedFiles( const void *a, const void *b ) {
+	return ((imageCacheFile_t *)b)->lastUsed - ((imageCacheFile_t *)a)->lastUsed;
+}
+
+/*
+=================
+R_TrimImageCache
+
+Called when a level ends
+=================
+*/
+void R_TrimImageCache( void ) {
+	imageCacheIndexHeader_t	*header;
+	imageCacheFile_t	*file;
+	char				**list;
+	unsigned			key[2];
+	int					settings;
+	int					budget, total, kb;
+	int					numList;
+	int					i, j;
+
+	if ( !imageCacheIndex.loaded ) {
+		return;
+	}
+
+	// files written by a session that never got to save the index
+	if ( !imageCacheIndex.swept ) {
+		imageCacheIndex.swept = qtrue;
+
+		list = ri.FS_ListFiles( "imagecache", ".dat", &numList );
+		for ( i = 0; i < numList; i++ ) {
+			if ( strlen( list[i] ) == 20 && sscanf( list[i], "%8x%8x", &key[0], &key[1] ) == 2 &&
+				R_FindCachedFile( (int *)key ) == -1 ) {
+				ri.FS_HomeRemove( va( "imagecache/%s", list[i] ) );
+				imageCacheStats.evicted++;
+			}
+		}
+		ri.FS_FreeFileList( list );
+	}
+
+	settings = R_ImageCacheSettings();
+	budget = r_imageCacheMegs->integer * 1024;
+	total = 0;
+
+	qsort( imageCacheIndex.files, imageCacheIndex.numFiles, sizeof( imageCacheIndex.files[0] ), R_SortCachedFiles );
+
+	for ( i = j = 0; i < imageCacheIndex.numFiles; i++ ) {
+		file = &imageCacheIndex.files[i];
+		kb = ( file->size + 1023 ) / 1024;
+
+		if ( file->settings == settings ) {
+			if ( total + kb <= budget ) {
+				total += kb;
+				imageCacheIndex.files[j++] = *file;
+				continue;
+			}
+
+			// this and everything used before it goes
+			budget = total;
+		}
+
+		ri.FS_HomeRemove( va( "imagecache/%08x%08x.dat", file->key[0], file->key[1] ) );
+		imageCacheStats.evicted++;
+		imageCacheIndex.modified = qtrue;
+	}
+	imageCacheIndex.numFiles = j;
+
+	R_HashCachedFiles();
+	imageCacheIndex.level++;
+
+	if ( imageCacheIndex.modified ) {
+		header = ri.Malloc( sizeof( *header ) + imageCacheIndex.numFiles * sizeof( *file ) );
+		header->ident = LittleLong( IMAGECACHE_INDEX_IDENT );
+		header->version = LittleLong( IMAGECACHE_VERSION );
+		header->level = LittleLong( imageCacheIndex.level );
+		header->numFiles = LittleLong( imageCacheIndex.numFiles );
+
+		file = (imageCacheFile_t *)( header + 1 );
+		for ( i = 0; i < imageCacheIndex.numFiles; i++, file++ ) {
+			file->key[0] = LittleLong( imageCacheIndex.files[i].key[0] );
+			file->key[1] = LittleLong( imageCacheIndex.files[i].key[1] );
+			file->settings = LittleLong( imageCacheIndex.files[i].settings );
+			file->size = LittleLong( imageCacheIndex.files[i].size );
+			file->lastUsed = LittleLong( imageCacheIndex.files[i].lastUsed );
+		}
+
+		ri.FS_WriteFile( IMAGECACHE_INDEX, header, sizeof( *header ) + imageCacheIndex.numFiles * sizeof( *file ) );
+		ri.Free( header );
+
+		imageCacheIndex.modified = qfalse;
+	}
+}
+
+/*
+=================
+R_ImageCacheEntry
+
+Leaves entry->path empty if the image can't be cached
+=================
+*/
+static void R_ImageCacheEntry( const char *name, qboolean mipmap, qboolean allowPicmip, imageCacheEntry_t *entry ) {
+	char		state[MAX_QPATH * 2];
+	unsigned	hash;
+	int			i;
+
+	Com_Memset( entry, 0, sizeof( *entry ) );
+
+	if ( !r_imageCache->integer ) {
+		return;
+	}
+
+	// the cache files come from disk, and a pure server only
+	// trusts the pixels in its pk3s
+	if ( ri.FS_PureServerActive() ) {
+		return;
+	}
+
+	switch ( R_FindImageSource( name, entry->source, &entry->crc ) ) {
+	case 1:
+		break;
+	case 0:
+		imageCacheStats.uncacheable++;
+		return;
+	default:
+		return;
+	}
+
+	R_LoadImageCacheIndex();
+
+	entry->settings = R_ImageCacheSettings();
+	Com_sprintf( state, sizeof( state ), "%s %i %i %i", entry->source, entry->crc, mipmap, allowPicmip );
+	Q_strlwr( state );
+
+	// two differently seeded hashes make the key
+	for ( i = 0; i < 2; i++ ) {
+		hash = i ? 0x84222325 : 2166136261u;
+		hash = R_ImageCacheHash( hash, (byte *)state, strlen( state ) );
+		hash = R_ImageCacheHash( hash, (byte *)&entry->settings, sizeof( entry->settings ) );
+		entry->key[i] = hash;
+	}
+
+	Com_sprintf( entry->path, sizeof( entry->path ), "imagecache/%08x%08x.dat", entry->key[0], entry->key[1] );
+}
+
+/*
+=================
+R_CreateCachedImage
+
+Returns NULL on a miss
+=================
+*/
+static image_t *R_CreateCachedImage( const char *name, imageCacheEntry_t *entry,
+									qboolean mipmap, qboolean allowPicmip, int glWrapClampMode ) {
+	imageCacheHeader_t	*header;
+	imageUpload_t		upload;
+	image_t				*image;
+	void				*buffer;
+	byte				*data;
+	long				length;
+	int					size;
+	int					i;
+
+	if ( !entry->path[0] ) {
+		return NULL;
+	}
+
+	length = ri.FS_ReadFileView( entry->path, &buffer );
+	if ( !buffer ) {
+		imageCacheStats.misses++;
+		return NULL;
+	}
+
+	header = (imageCacheHeader_t *)buffer;
+	Com_Memset( &upload, 0, sizeof( upload ) );
+	size = sizeof( *header );
+
+	if ( length >= sizeof( *header ) && LittleLong( header->ident ) == IMAGECACHE_IDENT &&
+		LittleLong( header->version ) == IMAGECACHE_VERSION && LittleLong( header->crc ) == entry->crc &&
+		LittleLong( header->key[0] ) == entry->key[0] && LittleLong( header->key[1] ) == entry->key[1] ) {
+		upload.numLevels = LittleLong( header->numLevels );
+		if ( upload.numLevels < 1 || upload.numLevels > MAX_UPLOAD_LEVELS ) {
+			upload.numLevels = 0;
+		}
+
+		for ( i = 0; i < upload.numLevels; i++ ) {
+			upload.levelWidth[i] = LittleLong( header->levelWidth[i] );
+			upload.levelHeight[i] = LittleLong( header->levelHeight[i] );
+			if ( upload.levelWidth[i] < 1 || upload.levelHeight[i] < 1 ||
+				upload.levelWidth[i] > glConfig.maxTextureSize || upload.levelHeight[i] > glConfig.maxTextureSize ) {
+				upload.numLevels = 0;
+				break;
+			}
+			size += upload.levelWidth[i] * upload.levelHeight[i] * 4;
+		}
+	}
+
+	if ( !upload.numLevels || size != length ) {
+		ri.FS_ReleaseView( buffer );
+		imageCacheStats.misses++;
+		return NULL;
+	}
+
+	upload.mipmap = LittleLong( header->mipmap );
+	upload.internalFormat = LittleLong( header->internalFormat );
+	data = (byte *)( header + 1 );
+	for ( i = 0; i < upload.numLevels; i++ ) {
+		upload.levels[i] = data;
+		data += upload.levelWidth[i] * upload.levelHeight[i] * 4;
+	}
+
+	image = R_CreateImageFromUpload( name, &upload, LittleLong( header->width ), LittleLong( header->height ),
+		mipmap, allowPicmip, glWrapClampMode );
+
+	ri.FS_ReleaseView( buffer );
+
+	R_TouchCachedFile( entry, length );
+	imageCacheStats.hits++;
+	imageCacheStats.hitBytes += length;
+
+	return image;
+}
+
+/*
+=================
+R_WriteCachedImage
+
+source is the file the image was actually read from, if a
+loader fell through to another one the entry doesn't match it
+=================
+*/
+static void R_WriteCachedImage( imageCacheEntry_t *entry, const imageUpload_t *upload,
+							   int width, int height, const char *source ) {
+	imageCacheHeader_t	*header;
+	byte				*buffer, *data;
+	int					size;
+	int					i;
+
+	if ( !entry->path[0] || Q_stricmp( entry->source, source ) ) {
+		return;
+	}
+
+	size = sizeof( *header );
+	for ( i = 0; i < upload->numLevels; i++ ) {
+		size += upload->levelWidth[i] * upload->levelHeight[i] * 4;
+	}
+
+	if ( !R_TouchCachedFile( entry, size ) ) {
+		return;
+	}
+
+	buffer = ri.Malloc( size );
+	header = (imageCacheHeader_t *)buffer;
+	Com_Memset( header, 0, sizeof( *header ) );
+	header->ident = LittleLong( IMAGECACHE_IDENT );
+	header->version = LittleLong( IMAGECACHE_VERSION );
+	header->crc = LittleLong( entry->crc );
+	header->key[0] = LittleLong( entry->key[0] );
+	header->key[1] = LittleLong( entry->key[1] );
+	header->width = LittleLong( width );
+	header->height = LittleLong( height );
+	header->mipmap = LittleLong( upload->mipmap );
+	header->internalFormat = LittleLong( upload->internalFormat );
+	header->numLevels = LittleLong( upload->numLevels );
+
+	data = (byte *)( header + 1 );
+	for ( i = 0; i < upload->numLevels; i++ ) {
+		header->levelWidth[i] = LittleLong( upload->levelWidth[i] );
+		header->levelHeight[i] = LittleLong( upload->levelHeight[i] );
+		Com_Memcpy( data, upload->levels[i], upload->levelWidth[i] * upload->levelHeight[i] * 4 );
+		data += upload->levelWidth[i] * upload->levelHeight[i] * 4;
+	}
+
+	ri.FS_WriteFile( entry->path, buffer, size );
+	ri.Free( buffer );
+
+	imageCacheStats.written++;
+	imageCacheStats.writtenBytes += size;
+}
+
+/*
+=============================================================================
+
+PREFETCH
+
+While a map registers, every image R_LoadImage decodes is recorded
+in prefetch/<map>.txt.  The next time the map loads, the files listed
+there are read up front and decoded on the job threads, and
+R_LoadImage takes the finished pixels instead of decoding them itself.
+Images that went through R_FindImageFile are recorded with their
+mipmap and picmip parms, and the jobs prepare the whole upload for
+them too, leaving only the GL calls to the main thread.
+The reads stay on the main thread, the filesystem isn't thread safe.
+
+=============================================================================
+*/
+
+#define	MAX_PREFETCH_IMAGES		1024
+#define	PREFETCH_BATCH			64		// files read before decoding them
+
+// manifest flags
+#define	PREFETCH_UPLOAD			1		// prepare the upload after decoding
+#define	PREFETCH_MIPMAP			2
+#define	PREFETCH_PICMIP			4
+
+typedef struct {
+	char			name[MAX_QPATH];	// as asked for by R_LoadImage
+	char			file[MAX_QPATH];	// the file that had it
+	int				width, height;
+	int				flags;
+} prefetchRecord_t;
+
+typedef struct {
+	char			name[MAX_QPATH];
+	char			file[MAX_QPATH];
+	int				flags;
+	imageDecoder_t	decoder;
+	imageDecode_t	decode;
+	imageUpload_t	upload;
+	void			*view;
+	qboolean		used;
+} prefetchImage_t;
+
+static qboolean			prefetchActive;			// recording between RE_PrefetchImages and R_EndPrefetch
+static char				prefetchManifest[MAX_QPATH];
+static char				*prefetchOldManifest;	// to skip rewriting it unchanged
+
+static prefetchRecord_t	prefetchRecords[MAX_PREFETCH_IMAGES];
+static int				prefetchNumRecords;
+
+static prefetchImage_t	*prefetchImages;
+static int				prefetchNumImages;
+static int				prefetchNumUsed;
+static int				prefetchNext;			// images are usually asked for in manifest order
+static int				prefetchMsec;
+
+/*
+=================
+R_ImageDecoderForFile
+=================
+*/
+static imageDecoder_t R_ImageDecoderForFile( const char *file ) {
+	const char	*ext;
+	int			i;
+
+	ext = COM_GetExtension( file );
+	for ( i = 0; i < numImageLoaders; i++ ) {
+		if ( !Q_stricmp( ext, imageLoaders[i].ext ) ) {
+			return imageLoaders[i].ImageDecoder;
+		}
+	}
+	return NULL;
+}
+
+/*
+=================
+R_PrefetchJob
+=================
+*/
+static void R_PrefetchJob( void *data, int index ) {
+	prefetchImage_t	*image = (prefetchImage_t *)data + index;
+	imageUpload_t	*upload = &image->upload;
+
+	if ( !image->view ) {
+		return;
+	}
+
+	image->decoder( &image->decode );
+
+	if ( !( image->flags & PREFETCH_UPLOAD ) || !image->decode.pic ) {
+		return;
+	}
+
+	upload->data = image->decode.pic;
+	upload->width = image->decode.width;
+	upload->height = image->decode.height;
+	upload->mipmap = ( image->flags & PREFETCH_MIPMAP ) ? qtrue : qfalse;
+	upload->picmip = ( image->flags & PREFETCH_PICMIP ) ? qtrue : qfalse;
+	R_PrepareUpload( upload );
+
+	// the pixels are only kept if they're uploaded as they are
+	if ( upload->levels[0] != image->decode.pic ) {
+		ri.Free( image->decode.pic );
+		image->decode.pic = NULL;
+	}
+}
+
+/*
+=================
+R_FreePrefetchedImages
+=================
+*/
+void R_FreePrefetchedImages( void ) {
+	int		i;
+
+	for ( i = 0; i < prefetchNumImages; i++ ) {
+		R_FreeUpload( &prefetchImages[i].upload );
+		if ( prefetchImages[i].decode.pic ) {
+			ri.Free( prefetchImages[i].decode.pic );
+		}
+	}
+	if ( prefetchImages ) {
+		ri.Free( prefetchImages );
+	}
+	if ( prefetchOldManifest ) {
+		ri.Free( prefetchOldManifest );
+	}
+
+	prefetchImages = NULL;
+	prefetchOldManifest = NULL;
+	prefetchNumImages = 0;
+	prefetchNumUsed = 0;
+	prefetchNext = 0;
+	prefetchNumRecords = 0;
+	prefetchActive = qfalse;
+}
+
+/*
+=================
+RE_PrefetchImages
+
+Called by the client before the cgame starts registering a map
+=================
+*/
+void RE_PrefetchImages( const char *mapname ) {
+	char			base[MAX_QPATH];
+	char			*text, *text_p, *token;
+	char			source[MAX_QPATH];
+	prefetchImage_t	*image;
+	int				budget, size, crc;
+	int				start, count;
+	int				i, j;
+
+	R_FreePrefetchedImages();
+
+	if ( !r_prefetch->integer ) {
+		return;
+	}
+
+	COM_StripExtension( COM_SkipPath( (char *)mapname ), base, sizeof( base ) );
+	Com_sprintf( prefetchManifest, sizeof( prefetchManifest ), "prefetch/%s.txt", base );
+	prefetchActive = qtrue;
+
+	if ( ri.FS_ReadFile( prefetchManifest, (void **)&text ) <= 0 ) {
+		return;
+	}
+
+	start = ri.Milliseconds();
+
+	prefetchOldManifest = ri.Malloc( strlen( text ) + 1 );
+	strcpy( prefetchOldManifest, text );
+
+	// each line is the name, the file, the decoded size and the flags
+	prefetchImages = ri.Malloc( MAX_PREFETCH_IMAGES * sizeof( *prefetchImages ) );
+	budget = r_prefetchMegs->integer * 1024 * 1024;
+	text_p = text;
+	while ( prefetchNumImages < MAX_PREFETCH_IMAGES ) {
+		image = &prefetchImages[prefetchNumImages];
+		Com_Memset( image, 0, sizeof( *image ) );
+
+		token = COM_ParseExt( &text_p, qtrue );
+		if ( !token[0] ) {
+			break;
+		}
+		Q_strncpyz( image->name, token, sizeof( image->name ) );
+		Q_strncpyz( image->file, COM_ParseExt( &text_p, qfalse ), sizeof( image->file ) );
+		size = atoi( COM_ParseExt( &text_p, qfalse ) );
+		size *= atoi( COM_ParseExt( &text_p, qfalse ) ) * 4;
+		image->flags = atoi( COM_ParseExt( &text_p, qfalse ) );
+		SkipRestOfLine( &text_p );
+
+		// roughly, the mips add a third
+		if ( image->flags & PREFETCH_UPLOAD ) {
+			size += size / 3;
+		}
+
+		image->decoder = R_ImageDecoderForFile( image->file );
+		if ( !image->decoder || size <= 0 || size > budget ) {
+			continue;
+		}
+
+		// a pak added since the manifest was written can have another
+		// file for the name, which R_LoadImage would find first
+		if ( R_FindImageSource( image->name, source, &crc ) < 0 || Q_stricmp( source, image->file ) ) {
+			continue;
+		}
+		budget -= size;
+		prefetchNumImages++;
+	}
+	ri.FS_FreeFile( text );
+
+	for ( i = 0; i < prefetchNumImages; i += PREFETCH_BATCH ) {
+		count = MIN( prefetchNumImages - i, PREFETCH_BATCH );
+
+		for ( j = 0; j < count; j++ ) {
+			image = &prefetchImages[i + j];
+			image->decode.name = image->file;
+			image->decode.length = ri.FS_ReadFileView( image->file, &image->view );
+			if ( image->decode.length < 0 ) {
+				image->view = NULL;
+			}
+			image->decode.buffer = image->view;
+		}
+
+		ri.Job_ParallelFor( R_PrefetchJob, prefetchImages + i, count, 1 );
+
+		// release in reverse, views that aren't mapped are temp hunk memory
+		for ( j = count - 1; j >= 0; j-- ) {
+			image = &prefetchImages[i + j];
+			if ( image->view ) {
+				ri.FS_ReleaseView( image->view );
+				image->view = NULL;
+			}
+			image->decode.buffer = NULL;
+		}
+	}
+
+	prefetchMsec = ri.Milliseconds() - start;
+}
+
+/*
+=================
+R_RecordPrefetch
+=================
+*/
+static void R_RecordPrefetch( const char *name, const char *file, int width, int height, int flags ) {
+	prefetchRecord_t	*record;
+
+	if ( !prefetchActive || prefetchNumRecords == MAX_PREFETCH_IMAGES ) {
+		return;
+	}
+
+	record = &prefetchRecords[prefetchNumRecords++];
+	Q_strncpyz( record->name, name, sizeof( record->name ) );
+	Q_strncpyz( record->file, file, sizeof( record->file ) );
+	record->width = width;
+	record->height = height;
+	record->flags = flags;
+}
+
+/*
+=================
+R_FindPrefetchedImage
+
+Only a decode for the same use is taken, a prepared upload
+no longer has its pixels
+=================
+*/
+static prefetchImage_t *R_FindPrefetchedImage( const char *name, int flags ) {
+	prefetchImage_t	*image;
+	int				i;
+
+	for ( i = 0; i < prefetchNumImages; i++ ) {
+		image = &prefetchImages[( prefetchNext + i ) % prefetchNumImages];
+		if ( image->used || image->flags != flags || strcmp( image->name, name ) ) {
+			continue;
+		}
+
+		// failed decodes are left to R_LoadImage, which reports them
+		if ( !image->decode.pic && !image->upload.numLevels ) {
+			return NULL;
+		}
+
+		image->used = qtrue;
+		prefetchNumUsed++;
+		prefetchNext = ( prefetchNext + i + 1 ) % prefetchNumImages;
+		R_RecordPrefetch( image->name, image->file, image->decode.width, image->decode.height, flags );
+		return image;
+	}
+
+	return NULL;
+}
+
+/*
+=================
+R_TakePrefetchedImage
+=================
+*/
+static qboolean R_TakePrefetchedImage( const char *name, int flags, byte **pic, int *width, int *height, char *source ) {
+	prefetchImage_t	*image;
+
+	image = R_FindPrefetchedImage( name, flags );
+	if ( !image ) {
+		return qfalse;
+	}
+
+	R_FinishImageDecode( &image->decode, pic, width, height );
+	if ( source ) {
+		Q_strncpyz( source, image->file, MAX_QPATH );
+	}
+	return qtrue;
+}
+
+/*
+=================
+R_CreatePrefetchedImage
+=================
+*/
+static image_t *R_CreatePrefetchedImage( const char *name, int flags, int glWrapClampMode, imageCacheEntry_t *cache ) {
+	prefetchImage_t	*prefetch;
+	image_t			*image;
+
+	prefetch = R_FindPrefetchedImage( name, flags );
+	if ( !prefetch ) {
+		return NULL;
+	}
+
+	if ( prefetch->decode.warning[0] ) {
+		ri.Printf( PRINT_WARNING, "%s", prefetch->decode.warning );
+	}
+
+	image = R_CreateImageFromUpload( name, &prefetch->upload, prefetch->decode.width, prefetch->decode.height,
+		( flags & PREFETCH_MIPMAP ) ? qtrue : qfalse, ( flags & PREFETCH_PICMIP ) ? qtrue : qfalse, glWrapClampMode );
+	R_WriteCachedImage( cache, &prefetch->upload, prefetch->decode.width, prefetch->decode.height, prefetch->file );
+
+	R_FreeUpload( &prefetch->upload );
+	if ( prefetch->decode.pic ) {
+		ri.Free( prefetch->decode.pic );
+		prefetch->decode.pic = NULL;
+	}
+
+	return image;
+}
+
+/*
+=================
+R_EndPrefetch
+
+Called by RE_EndRegistration, rewrites the manifest if the map
+loaded a different set of images this time
+=================
+*/
+void R_EndPrefetch( void ) {
+	char	*text;
+	int		size, len;
+	int		i;
+
+	if ( !prefetchActive ) {
+		return;
+	}
+
+	ri.Printf( PRINT_ALL, "%i of %i images prefetched for %s, %i msec reading and decoding\n",
+		prefetchNumUsed, prefetchNumRecords, prefetchManifest, prefetchMsec );
+
+	if ( prefetchNumRecords ) {
+		size = prefetchNumRecords * ( MAX_QPATH * 2 + 32 ) + 1;
+		text = ri.Hunk_AllocateTempMemory( size );
+		len = 0;
+		text[0] = '\0';
+
+		for ( i = 0; i < prefetchNumRecords; i++ ) {
+			prefetchRecord_t	*record = &prefetchRecords[i];
+
+			len += Com_sprintf( text + len, size - len, "\"%s\" \"%s\" %i %i %i\n",
+				record->name, record->file, record->width, record->height, record->flags );
+		}
+
+		if ( !prefetchOldManifest || strcmp( text, prefetchOldManifest ) ) {
+			ri.FS_WriteFile( prefetchManifest, text, len );
+		}
+
+		ri.Hunk_FreeTempMemory( text );
+	}
+
+	R_FreePrefetchedImages();
+}
+
+/*
+=================
+R_LoadImageFile
+
+Loads any of the supported image types into a cannonical
+32 bit format, flags are recorded for the prefetch.
+source gets the file that had it if it isn't NULL.
+=================
+*/
+static void R_LoadImageFile( const char *name, int flags, byte **pic, int *width, int *height, char *source )
+{
+	qboolean orgNameFailed = qfalse;
+	int orgLoader = -1;
+	int i;
+	char localName[ MAX_QPATH ];
+	const char *ext;
+	char *altName;
+
+	*pic = NULL;
+	*width = 0;
+	*height = 0;
+
+	if ( R_TakePrefetchedImage( name, flags, pic, width, height, source ) ) {
+		return;
+	}
+
+	Q_strncpyz( localName, name, MAX_QPATH );
+
+	ext = COM_GetExtension( localName );
 
 	if( *ext )
 	{
@@ -917,6 +2281,10 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height )
 			else
 			{
 				// Something loaded
+				if( imageLoaders[ i ].ImageDecoder )
+					R_RecordPrefetch( name, localName, *width, *height, flags );
+				if( source )
+					Q_strncpyz( source, localName, MAX_QPATH );
 				return;
 			}
 		}
@@ -942,11 +2310,26 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height )
 						name, altName );
 			}
 
+			if( imageLoaders[ i ].ImageDecoder )
+				R_RecordPrefetch( name, altName, *width, *height, flags );
+			if( source )
+				Q_strncpyz( source, altName, MAX_QPATH );
+
 			break;
 		}
 	}
 }
 
+/*
+=================
+R_LoadImage
+=================
+*/
+void R_LoadImage( const char *name, byte **pic, int *width, int *height )
+{
+	R_LoadImageFile( name, 0, pic, width, height, NULL );
+}
+
 
 /*
 ===============
@@ -957,10 +2340,14 @@ Returns NULL if it fails, not a default image.
 ==============
 */
 image_t	*R_FindImageFile( const char *name, qboolean mipmap, qboolean allowPicmip, int glWrapClampMode ) {
-	image_t	*image;
-	int		width, height;
-	byte	*pic;
-	long	hash;
+	image_t				*image;
+	int					width, height;
+	byte				*pic;
+	long				hash;
+	int					flags;
+	imageCacheEntry_t	cache;
+	imageUpload_t		upload;
+	char				source[MAX_QPATH];
 
 	if (!name) {
 		return NULL;
@@ -989,19 +2376,247 @@ image_t	*R_FindImageFile( const char *name, qboolean mipmap, qboolean allowPicmi
 		}
 	}
 
+	R_ImageCacheEntry( name, mipmap, allowPicmip, &cache );
+	image = R_CreateCachedImage( name, &cache, mipmap, allowPicmip, glWrapClampMode );
+	if ( image ) {
+		return image;
+	}
+
+	flags = PREFETCH_UPLOAD;
+	if ( mipmap ) {
+		flags |= PREFETCH_MIPMAP;
+	}
+	if ( allowPicmip ) {
+		flags |= PREFETCH_PICMIP;
+	}
+
+	image = R_CreatePrefetchedImage( name, flags, glWrapClampMode, &cache );
+	if ( image ) {
+		return image;
+	}
+
 	//
 	// load the pic from disk
 	//
-	R_LoadImage( name, &pic, &width, &height );
+	R_LoadImageFile( name, flags, &pic, &width, &height, source );
 	if ( pic == NULL ) {
 		return NULL;
 	}
 
-	image = R_CreateImage( ( char * ) name, pic, width, height, mipmap, allowPicmip, glWrapClampMode );
+	Com_Memset( &upload, 0, sizeof( upload ) );
+	upload.data = pic;
+	upload.width = width;
+	upload.height = height;
+	upload.mipmap = mipmap;
+	upload.picmip = allowPicmip;
+
+	image = R_CreateImageFromUpload( name, &upload, width, height, mipmap, allowPicmip, glWrapClampMode );
+	R_WriteCachedImage( &cache, &upload, width, height, source );
+
+	R_FreeUpload( &upload );
 	ri.Free( pic );
 	return image;
 }
 
+/*
+=============================================================================
+
+IMAGE BENCHMARK
+
+imagebench <pk3> decodes every image in a pk3 and prepares its upload
+with a full mip chain, without touching GL.  Each batch of files is
+read first, then decoded and mipped one image at a time, then run
+again through the job threads the way the prefetch does it.
+
+=============================================================================
+*/
+
+#define	IMAGEBENCH_BATCH		64
+
+typedef struct {
+	imageDecoder_t	decoder;
+	imageDecode_t	decode;
+	imageUpload_t	upload;
+	void			*view;
+	int				length;
+	char			*file;
+} benchImage_t;
+
+typedef struct {
+	int				files;
+	int				failed;
+	double			pixels;
+	int				decodeMsec;
+	int				mipMsec;
+	int				pipelineMsec;
+} benchFormat_t;
+
+/*
+===============
+R_ImageBenchDecode
+===============
+*/
+static void R_ImageBenchDecode( benchImage_t *image ) {
+	Com_Memset( &image->decode, 0, sizeof( image->decode ) );
+	image->decode.name = image->file;
+	image->decode.buffer = image->view;
+	image->decode.length = image->length;
+	image->decoder( &image->decode );
+}
+
+/*
+===============
+R_ImageBenchMip
+===============
+*/
+static void R_ImageBenchMip( benchImage_t *image ) {
+	imageUpload_t	*upload = &image->upload;
+
+	Com_Memset( upload, 0, sizeof( *upload ) );
+	if ( !image->decode.pic ) {
+		return;
+	}
+
+	upload->data = image->decode.pic;
+	upload->width = image->decode.width;
+	upload->height = image->decode.height;
+	upload->mipmap = qtrue;
+	R_PrepareUpload( upload );
+}
+
+/*
+===============
+R_ImageBenchFree
+===============
+*/
+static void R_ImageBenchFree( benchImage_t *image ) {
+	R_FreeUpload( &image->upload );
+	if ( image->decode.pic ) {
+		ri.Free( image->decode.pic );
+		image->decode.pic = NULL;
+	}
+}
+
+/*
+===============
+R_ImageBenchJob
+===============
+*/
+static void R_ImageBenchJob( void *data, int index ) {
+	benchImage_t	*image = (benchImage_t *)data + index;
+
+	if ( image->view ) {
+		R_ImageBenchDecode( image );
+		R_ImageBenchMip( image );
+	}
+}
+
+/*
+===============
+R_ImageBenchFormat
+===============
+*/
+static void R_ImageBenchFormat( char **files, int numFiles, imageDecoder_t decoder, benchFormat_t *stats ) {
+	benchImage_t	images[IMAGEBENCH_BATCH];
+	benchImage_t	*image;
+	int				start, count;
+	int				i, j;
+
+	for ( i = 0; i < numFiles; i += IMAGEBENCH_BATCH ) {
+		count = MIN( numFiles - i, IMAGEBENCH_BATCH );
+
+		Com_Memset( images, 0, sizeof( images ) );
+		for ( j = 0; j < count; j++ ) {
+			image = &images[j];
+			image->file = files[i + j];
+			image->decoder = decoder;
+			image->length = ri.FS_ReadFileView( image->file, &image->view );
+			if ( image->length < 0 ) {
+				image->view = NULL;
+			}
+		}
+
+		start = ri.Milliseconds();
+		for ( j = 0; j < count; j++ ) {
+			if ( images[j].view ) {
+				R_ImageBenchDecode( &images[j] );
+			}
+		}
+		stats->decodeMsec += ri.Milliseconds() - start;
+
+		start = ri.Milliseconds();
+		for ( j = 0; j < count; j++ ) {
+			R_ImageBenchMip( &images[j] );
+		}
+		stats->mipMsec += ri.Milliseconds() - start;
+
+		for ( j = 0; j < count; j++ ) {
+			image = &images[j];
+			stats->files++;
+			if ( image->upload.numLevels ) {
+				stats->pixels += (double)image->decode.width * image->decode.height;
+			} else {
+				stats->failed++;
+			}
+			R_ImageBenchFree( image );
+		}
+
+		start = ri.Milliseconds();
+		ri.Job_ParallelFor( R_ImageBenchJob, images, count, 1 );
+		stats->pipelineMsec += ri.Milliseconds() - start;
+
+		// release in reverse, views that aren't mapped are temp hunk memory
+		for ( j = count - 1; j >= 0; j-- ) {
+			image = &images[j];
+			R_ImageBenchFree( image );
+			if ( image->view ) {
+				ri.FS_ReleaseView( image->view );
+			}
+		}
+	}
+}
+
+/*
+===============
+R_ImageBench_f
+===============
+*/
+void R_ImageBench_f( void ) {
+	benchFormat_t	stats;
+	char			**files;
+	int				numFiles;
+	int				i;
+
+	if ( ri.Cmd_Argc() != 2 ) {
+		ri.Printf( PRINT_ALL, "usage: imagebench <pk3 without extension>\n" );
+		return;
+	}
+
+	ri.Printf( PRINT_ALL, "%i job threads, r_simpleMipMaps %i\n", ri.Job_NumThreads(), r_simpleMipMaps->integer );
+	ri.Printf( PRINT_ALL, "format files failed   mpixels  decode     mip  parallel\n" );
+	ri.Printf( PRINT_ALL, "------ ----- ------ --------- ------- ------- ---------\n" );
+
+	for ( i = 0; i < numImageLoaders; i++ ) {
+		if ( !imageLoaders[i].ImageDecoder ) {
+			continue;
+		}
+
+		files = ri.FS_ListPakFiles( ri.Cmd_Argv( 1 ), va( ".%s", imageLoaders[i].ext ), &numFiles );
+		if ( !files ) {
+			continue;
+		}
+
+		Com_Memset( &stats, 0, sizeof( stats ) );
+		R_ImageBenchFormat( files, numFiles, imageLoaders[i].ImageDecoder, &stats );
+		ri.FS_FreeFileList( files );
+
+		ri.Printf( PRINT_ALL, "%-6s %5i %6i %9.2f %7i %7i %9i\n", imageLoaders[i].ext, stats.files, stats.failed,
+			stats.pixels / ( 1024.0 * 1024.0 ), stats.decodeMsec, stats.mipMsec, stats.pipelineMsec );
+	}
+
+	ri.Printf( PRINT_ALL, "times are msec, decode and mip run one image at a time, parallel does both on the job threads\n" );
+}
+
 
 /*
 ================
@@ -1342,6 +2957,7 @@ R_InitImages
 */
 void	R_InitImages( void ) {
 	Com_Memset(hashTable, 0, sizeof(hashTable));
+	Com_Memset(&imageCacheStats, 0, sizeof(imageCacheStats));
 	// build brightness translation tables
 	R_SetColorMappings();
 
@@ -69,7 +69,7 @@ void R_LoadBMP( const char *name, byte **pic, int *width, int *height )
 	//
 	// load the file
 	//
-	length = ri.FS_ReadFile( ( char * ) name, &buffer.v);
+	length = ri.FS_ReadFileView( ( char * ) name, &buffer.v);
 	if (!buffer.b || length < 0) {
 		return;
 	}
@@ -234,6 +234,6 @@ void R_LoadBMP( const char *name, byte **pic, int *width, int *height )
 		}
 	}
 
-	ri.FS_FreeFile( buffer.v );
+	ri.FS_ReleaseView( buffer.v );
 
 }
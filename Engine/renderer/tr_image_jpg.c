@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #include <jpeglib.h>
+#include <setjmp.h>
 
 #ifndef USE_INTERNAL_JPEG
 #  if JPEG_LIB_VERSION < 80
@@ -65,49 +66,58 @@ static void R_JPGOutputMessage(j_common_ptr cinfo)
   ri.Printf(PRINT_ALL, "%s\n", buffer);
 }
 
-void R_LoadJPG(const char *filename, unsigned char **pic, int *width, int *height)
+/* The decoder's error handler keeps the message and jumps back out
+ * instead, since it may be running on a job thread.
+ */
+typedef struct {
+  struct jpeg_error_mgr pub;	/* "public" fields */
+  jmp_buf setjmp_buffer;	/* for return to caller */
+  imageDecode_t *decode;
+  char message[JMSG_LENGTH_MAX];
+} r_jpeg_error_mgr;
+
+static void R_JPGDecodeErrorExit(j_common_ptr cinfo)
+{
+  r_jpeg_error_mgr *jerr = (r_jpeg_error_mgr *) cinfo->err;
+
+  (*cinfo->err->format_message) (cinfo, jerr->message);
+
+  /* Return control to the setjmp point */
+  longjmp(jerr->setjmp_buffer, 1);
+}
+
+static void R_JPGDecodeOutputMessage(j_common_ptr cinfo)
+{
+  r_jpeg_error_mgr *jerr = (r_jpeg_error_mgr *) cinfo->err;
+  char buffer[JMSG_LENGTH_MAX];
+  
+  /* Create the message */
+  (*cinfo->err->format_message) (cinfo, buffer);
+  
+  /* Keep it for the console, adding a newline */
+  R_DecodeWarning(jerr->decode, "%s\n", buffer);
+}
+
+void R_DecodeJPG(imageDecode_t *decode)
 {
   /* This struct contains the JPEG decompression parameters and pointers to
    * working space (which is allocated as needed by the JPEG library).
    */
   struct jpeg_decompress_struct cinfo = {NULL};
-  /* We use our private extension JPEG error handler.
+  /* We use our private extension JPEG error handler, which returns to the
+   * setjmp below instead of exiting, so a bad file only fails this decode.
    * Note that this struct must live as long as the main JPEG parameter
    * struct, to avoid dangling-pointer problems.
    */
-  /* This struct represents a JPEG error handler.  It is declared separately
-   * because applications often want to supply a specialized error handler
-   * (see the second half of this file for an example).  But here we just
-   * take the easy way out and use the standard error handler, which will
-   * print a message on stderr and call exit() if compression fails.
-   * Note that this struct must live as long as the main JPEG parameter
-   * struct, to avoid dangling-pointer problems.
-   */
-  struct jpeg_error_mgr jerr;
+  r_jpeg_error_mgr jerr;
   /* More stuff */
   JSAMPARRAY buffer;		/* Output row buffer */
   unsigned int row_stride;	/* physical row width in output buffer */
   unsigned int pixelcount, memcount;
   unsigned int sindex, dindex;
   byte *out;
-  int len;
-	union {
-		byte *b;
-		void *v;
-	} fbuffer;
   byte  *buf;
 
-  /* In this example we want to open the input file before doing anything else,
-   * so that the setjmp() error recovery below can assume the file is open.
-   * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-   * requires it in order to read binary files.
-   */
-
-  len = ri.FS_ReadFile ( ( char * ) filename, &fbuffer.v);
-  if (!fbuffer.b || len < 0) {
-	return;
-  }
-
   /* Step 1: allocate and initialize JPEG decompression object */
 
   /* We have to set up the error handler first, in case the initialization
@@ -115,16 +125,26 @@ void R_LoadJPG(const char *filename, unsigned char **pic, int *width, int *heigh
    * This routine fills in the contents of struct jerr, and returns jerr's
    * address which we place into the link field in cinfo.
    */
-  cinfo.err = jpeg_std_error(&jerr);
-  cinfo.err->error_exit = R_JPGErrorExit;
-  cinfo.err->output_message = R_JPGOutputMessage;
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = R_JPGDecodeErrorExit;
+  jerr.pub.output_message = R_JPGDecodeOutputMessage;
+  jerr.decode = decode;
+
+  /* Establish the setjmp return context for R_JPGDecodeErrorExit to use. */
+  if (setjmp(jerr.setjmp_buffer)) {
+    /* Let the memory manager delete any temp files before we fail */
+    jpeg_destroy_decompress(&cinfo);
+
+    R_DecodeError(decode, ERR_FATAL, "%s", jerr.message);
+    return;
+  }
 
   /* Now we can initialize the JPEG decompression object. */
   jpeg_create_decompress(&cinfo);
 
   /* Step 2: specify data source (eg, a file) */
 
-  jpeg_mem_src(&cinfo, fbuffer.b, len);
+  jpeg_mem_src(&cinfo, (unsigned char *) decode->buffer, decode->length);
 
   /* Step 3: read file parameters with jpeg_read_header() */
 
@@ -165,21 +185,19 @@ void R_LoadJPG(const char *filename, unsigned char **pic, int *width, int *heigh
       || pixelcount > 0x1FFFFFFF || cinfo.output_components != 3
     )
   {
+    R_DecodeError(decode, ERR_DROP, "LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", decode->name,
+		    cinfo.output_width, cinfo.output_height, pixelcount * 4, cinfo.output_components);
+
     // Free the memory to make sure we don't leak memory
-    ri.FS_FreeFile (fbuffer.v);
     jpeg_destroy_decompress(&cinfo);
-  
-    ri.Error(ERR_DROP, "LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", filename,
-		    cinfo.output_width, cinfo.output_height, pixelcount * 4, cinfo.output_components);
+    return;
   }
 
   memcount = pixelcount * 4;
   row_stride = cinfo.output_width * cinfo.output_components;
 
   out = ri.Malloc(memcount);
-
-  *width = cinfo.output_width;
-  *height = cinfo.output_height;
+  decode->pic = out;	// freed by R_DecodeError if libjpeg bails out
 
   /* Step 6: while (scan lines remain to be read) */
   /*           jpeg_read_scanlines(...); */
@@ -211,7 +229,8 @@ void R_LoadJPG(const char *filename, unsigned char **pic, int *width, int *heigh
     buf[--dindex] = buf[--sindex];
   } while(sindex);
 
-  *pic = out;
+  decode->width = cinfo.output_width;
+  decode->height = cinfo.output_height;
 
   /* Step 7: Finish decompression */
 
@@ -225,13 +244,6 @@ void R_LoadJPG(const char *filename, unsigned char **pic, int *width, int *heigh
   /* This is an important step since it will release a good deal of memory. */
   jpeg_destroy_decompress(&cinfo);
 
-  /* After finish_decompress, we can close the input file.
-   * Here we postpone it until after no more JPEG errors are possible,
-   * so as to simplify the setjmp error logic above.  (Actually, I don't
-   * think that jpeg_destroy can do an error exit, but why assume anything...)
-   */
-  ri.FS_FreeFile (fbuffer.v);
-
   /* At this point you may want to check to see whether any corrupt-data
    * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
    */
@@ -239,6 +251,11 @@ void R_LoadJPG(const char *filename, unsigned char **pic, int *width, int *heigh
   /* And we're done! */
 }
 
+void R_LoadJPG(const char *filename, unsigned char **pic, int *width, int *height)
+{
+  R_DecodeImageFile(filename, R_DecodeJPG, pic, width, height);
+}
+
 
 /* Expanded data destination object for stdio output */
 
@@ -74,7 +74,7 @@ void R_LoadPCX ( const char *filename, byte **pic, int *width, int *height)
 	//
 	// load the file
 	//
-	len = ri.FS_ReadFile( ( char * ) filename, &raw.v);
+	len = ri.FS_ReadFileView( ( char * ) filename, &raw.v);
 	if (!raw.b || len < 0) {
 		return;
 	}
@@ -82,7 +82,7 @@ void R_LoadPCX ( const char *filename, byte **pic, int *width, int *height)
 	if((unsigned)len < sizeof(pcx_t))
 	{
 		ri.Printf (PRINT_ALL, "PCX truncated: %s\n", filename);
-		ri.FS_FreeFile (raw.v);
+		ri.FS_ReleaseView (raw.v);
 		return;
 	}
 
@@ -138,14 +138,14 @@ void R_LoadPCX ( const char *filename, byte **pic, int *width, int *height)
 	if(pix < pic8+size)
 	{
 		ri.Printf (PRINT_ALL, "PCX file truncated: %s\n", filename);
-		ri.FS_FreeFile (pcx);
+		ri.FS_ReleaseView (pcx);
 		ri.Free (pic8);
 	}
 
 	if (raw.b-(byte*)pcx >= end - (byte*)769 || end[-769] != 0x0c)
 	{
 		ri.Printf (PRINT_ALL, "PCX missing palette: %s\n", filename);
-		ri.FS_FreeFile (pcx);
+		ri.FS_ReleaseView (pcx);
 		ri.Free (pic8);
 		return;
 	}
@@ -170,6 +170,6 @@ void R_LoadPCX ( const char *filename, byte **pic, int *width, int *height)
 
 	*pic = out;
 
-	ri.FS_FreeFile (pcx);
+	ri.FS_ReleaseView (pcx);
 	ri.Free (pic8);
 }
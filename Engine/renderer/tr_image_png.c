@@ -209,22 +209,18 @@ struct BufferedFile
 };
 
 /*
- *  Read a file into a buffer.
+ *  Wrap a file that has already been read.
  */
 
-static struct BufferedFile *ReadBufferedFile(const char *name)
+static struct BufferedFile *OpenBufferedFile(const byte *buffer, int length)
 {
 	struct BufferedFile *BF;
-	union {
-		byte *b;
-		void *v;
-	} buffer;
 
 	/*
 	 *  input verification
 	 */
 
-	if(!name)
+	if(!(buffer && (length > 0)))
 	{
 		return(NULL);
 	}
@@ -249,22 +245,11 @@ static struct BufferedFile *ReadBufferedFile(const char *name)
 	BF->BytesLeft = 0;
 
 	/*
-	 *  Read the file.
-	 */
-
-	BF->Length = ri.FS_ReadFile((char *) name, &buffer.v);
-	BF->Buffer = buffer.b;
-
-	/*
-	 *  Did we get it? Is it big enough?
+	 *  Point at the file, it is only ever read.
 	 */
 
-	if(!(BF->Buffer && (BF->Length > 0)))
-	{
-		ri.Free(BF);
-
-		return(NULL);
-	}
+	BF->Length = length;
+	BF->Buffer = (byte *) buffer;
 
 	/*
 	 *  Set the pointers and counters.
@@ -284,11 +269,6 @@ static void CloseBufferedFile(struct BufferedFile *BF)
 {
 	if(BF)
 	{
-		if(BF->Buffer)
-		{
-			ri.FS_FreeFile(BF->Buffer);
-		}
-
 		ri.Free(BF);
 	}
 }
@@ -1901,8 +1881,12 @@ static qboolean DecodeImageInterlaced(struct PNG_Chunk_IHDR *IHDR,
  *  The PNG loader
  */
 
-void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
+void R_DecodePNG(imageDecode_t *decode)
 {
+	const char *name = decode->name;
+	byte **pic = &decode->pic;
+	int *width = &decode->width;
+	int *height = &decode->height;
 	struct BufferedFile *ThePNG;
 	byte *OutBuffer;
 	uint8_t *Signature;
@@ -1960,7 +1944,7 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	 *  Read the file.
 	 */
 
-	ThePNG = ReadBufferedFile(name);
+	ThePNG = OpenBufferedFile(decode->buffer, decode->length);
 	if(!ThePNG)
 	{
 		return;
@@ -2063,7 +2047,7 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	{
 		CloseBufferedFile(ThePNG);
 
-		ri.Printf( PRINT_WARNING, "%s: invalid image size\n", name );
+		R_DecodeWarning( decode, "%s: invalid image size\n", name );
 
 		return; 
 	}
@@ -2484,3 +2468,8 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 
 	CloseBufferedFile(ThePNG);
 }
+
+void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
+{
+	R_DecodeImageFile(name, R_DecodePNG, pic, width, height);
+}
@@ -38,43 +38,25 @@ typedef struct _TargaHeader {
 	unsigned char	pixel_size, attributes;
 } TargaHeader;
 
-void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
+void R_DecodeTGA( imageDecode_t *decode )
 {
+	const char	*name = decode->name;
 	unsigned	columns, rows, numPixels;
 	byte	*pixbuf;
 	int		row, column;
-	byte	*buf_p;
-	byte	*end;
-	union {
-		byte *b;
-		void *v;
-	} buffer;
+	const byte	*buf_p;
+	const byte	*end;
 	TargaHeader	targa_header;
 	byte		*targa_rgba;
-	int length;
-
-	*pic = NULL;
-
-	if(width)
-		*width = 0;
-	if(height)
-		*height = 0;
-
-	//
-	// load the file
-	//
-	length = ri.FS_ReadFile ( ( char * ) name, &buffer.v);
-	if (!buffer.b || length < 0) {
-		return;
-	}
 
-	if(length < 18)
+	if(decode->length < 18)
 	{
-		ri.Error( ERR_DROP, "LoadTGA: header too short (%s)", name );
+		R_DecodeError( decode, ERR_DROP, "LoadTGA: header too short (%s)", name );
+		return;
 	}
 
-	buf_p = buffer.b;
-	end = buffer.b + length;
+	buf_p = decode->buffer;
+	end = decode->buffer + decode->length;
 
 	targa_header.id_length = buf_p[0];
 	targa_header.colormap_type = buf_p[1];
@@ -103,17 +85,20 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 		&& targa_header.image_type!=10
 		&& targa_header.image_type != 3 ) 
 	{
-		ri.Error (ERR_DROP, "LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported");
+		R_DecodeError( decode, ERR_DROP, "LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported" );
+		return;
 	}
 
 	if ( targa_header.colormap_type != 0 )
 	{
-		ri.Error( ERR_DROP, "LoadTGA: colormaps not supported" );
+		R_DecodeError( decode, ERR_DROP, "LoadTGA: colormaps not supported" );
+		return;
 	}
 
 	if ( ( targa_header.pixel_size != 32 && targa_header.pixel_size != 24 ) && targa_header.image_type != 3 )
 	{
-		ri.Error (ERR_DROP, "LoadTGA: Only 32 or 24 bit images supported (no colormaps)");
+		R_DecodeError( decode, ERR_DROP, "LoadTGA: Only 32 or 24 bit images supported (no colormaps)" );
+		return;
 	}
 
 	columns = targa_header.width;
@@ -122,16 +107,20 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 
 	if(!columns || !rows || numPixels > 0x7FFFFFFF || numPixels / columns / 4 != rows)
 	{
-		ri.Error (ERR_DROP, "LoadTGA: %s has an invalid image size", name);
+		R_DecodeError( decode, ERR_DROP, "LoadTGA: %s has an invalid image size", name );
+		return;
 	}
 
 
 	targa_rgba = ri.Malloc (numPixels);
+	decode->pic = targa_rgba;	// freed by R_DecodeError
 
 	if (targa_header.id_length != 0)
 	{
-		if (buf_p + targa_header.id_length > end)
-			ri.Error( ERR_DROP, "LoadTGA: header too short (%s)", name );
+		if (buf_p + targa_header.id_length > end) {
+			R_DecodeError( decode, ERR_DROP, "LoadTGA: header too short (%s)", name );
+			return;
+		}
 
 		buf_p += targa_header.id_length;  // skip TARGA image comment
 	}
@@ -140,7 +129,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 	{ 
 		if(buf_p + columns*rows*targa_header.pixel_size/8 > end)
 		{
-			ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+			R_DecodeError( decode, ERR_DROP, "LoadTGA: file truncated (%s)", name );
+			return;
 		}
 
 		// Uncompressed RGB or gray scale image
@@ -183,8 +173,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 					*pixbuf++ = alphabyte;
 					break;
 				default:
-					ri.Error( ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
-					break;
+					R_DecodeError( decode, ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+					return;
 				}
 			}
 		}
@@ -200,13 +190,17 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 		for(row=rows-1; row>=0; row--) {
 			pixbuf = targa_rgba + row*columns*4;
 			for(column=0; column<columns; ) {
-				if(buf_p + 1 > end)
-					ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+				if(buf_p + 1 > end) {
+					R_DecodeError( decode, ERR_DROP, "LoadTGA: file truncated (%s)", name );
+					return;
+				}
 				packetHeader= *buf_p++;
 				packetSize = 1 + (packetHeader & 0x7f);
 				if (packetHeader & 0x80) {        // run-length packet
-					if(buf_p + targa_header.pixel_size/8 > end)
-						ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+					if(buf_p + targa_header.pixel_size/8 > end) {
+						R_DecodeError( decode, ERR_DROP, "LoadTGA: file truncated (%s)", name );
+						return;
+					}
 					switch (targa_header.pixel_size) {
 						case 24:
 								blue = *buf_p++;
@@ -221,8 +215,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 								alphabyte = *buf_p++;
 								break;
 						default:
-							ri.Error( ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
-							break;
+							R_DecodeError( decode, ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+							return;
 					}
 	
 					for(j=0;j<packetSize;j++) {
@@ -243,8 +237,10 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 				}
 				else {                            // non run-length packet
 
-					if(buf_p + targa_header.pixel_size/8*packetSize > end)
-						ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+					if(buf_p + targa_header.pixel_size/8*packetSize > end) {
+						R_DecodeError( decode, ERR_DROP, "LoadTGA: file truncated (%s)", name );
+						return;
+					}
 					for(j=0;j<packetSize;j++) {
 						switch (targa_header.pixel_size) {
 							case 24:
@@ -267,8 +263,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 									*pixbuf++ = alphabyte;
 									break;
 							default:
-								ri.Error( ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
-								break;
+								R_DecodeError( decode, ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+								return;
 						}
 						column++;
 						if (column==columns) { // pixel packet run spans across rows
@@ -306,15 +302,14 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 #endif
   // instead we just print a warning
   if (targa_header.attributes & 0x20) {
-    ri.Printf( PRINT_WARNING, "WARNING: '%s' TGA file header declares top-down image, ignoring\n", name);
+    R_DecodeWarning( decode, "WARNING: '%s' TGA file header declares top-down image, ignoring\n", name);
   }
 
-  if (width)
-	  *width = columns;
-  if (height)
-	  *height = rows;
-
-  *pic = targa_rgba;
+  decode->width = columns;
+  decode->height = rows;
+}
 
-  ri.FS_FreeFile (buffer.v);
+void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
+{
+	R_DecodeImageFile( name, R_DecodeTGA, pic, width, height );
 }
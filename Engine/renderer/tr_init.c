@@ -63,6 +63,11 @@ cvar_t	*r_stereoSeparation;
 
 cvar_t	*r_smp;
 cvar_t	*r_showSmp;
+cvar_t	*r_animJobs;
+cvar_t	*r_prefetch;
+cvar_t	*r_prefetchMegs;
+cvar_t	*r_imageCache;
+cvar_t	*r_imageCacheMegs;
 cvar_t	*r_skipBackEnd;
 
 cvar_t	*r_stereoEnabled;
@@ -1050,6 +1055,12 @@ void R_Register( void )
 	r_uiFullScreen = ri.Cvar_Get( "r_uifullscreen", "0", 0);
 	r_subdivisions = ri.Cvar_Get ("r_subdivisions", "4", CVAR_ARCHIVE | CVAR_LATCH);
 	r_smp = ri.Cvar_Get( "r_smp", "0", CVAR_ARCHIVE | CVAR_LATCH);
+	r_animJobs = ri.Cvar_Get( "r_animJobs", "1", CVAR_ARCHIVE | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_animJobs, 0, 1, qtrue );
+	r_prefetch = ri.Cvar_Get( "r_prefetch", "1", CVAR_ARCHIVE );
+	r_prefetchMegs = ri.Cvar_Get( "r_prefetchMegs", "16", CVAR_ARCHIVE );
+	r_imageCache = ri.Cvar_Get( "r_imageCache", "1", CVAR_ARCHIVE );
+	r_imageCacheMegs = ri.Cvar_Get( "r_imageCacheMegs", "256", CVAR_ARCHIVE );
 	r_stereoEnabled = ri.Cvar_Get( "r_stereoEnabled", "0", CVAR_ARCHIVE | CVAR_LATCH);
 	r_ignoreFastPath = ri.Cvar_Get( "r_ignoreFastPath", "1", CVAR_ARCHIVE | CVAR_LATCH );
 	r_greyscale = ri.Cvar_Get("r_greyscale", "0", CVAR_ARCHIVE | CVAR_LATCH);
@@ -1170,6 +1181,7 @@ void R_Register( void )
 	// make sure all the commands added here are also
 	// removed in R_Shutdown
 	ri.Cmd_AddCommand( "imagelist", R_ImageList_f );
+	ri.Cmd_AddCommand( "imagebench", R_ImageBench_f );
 	ri.Cmd_AddCommand( "shaderlist", R_ShaderList_f );
 	ri.Cmd_AddCommand( "skinlist", R_SkinList_f );
 	ri.Cmd_AddCommand( "modellist", R_Modellist_f );
@@ -1262,6 +1274,12 @@ void R_Init( void ) {
 	} else {
 		backEndData[1] = NULL;
 	}
+	for ( i = 0 ; i < SMP_FRAMES ; i++ ) {
+		if ( backEndData[i] && r_animJobs->integer ) {
+			backEndData[i]->animXyz = ri.Hunk_Alloc( sizeof( vec4_t ) * MAX_ANIMVERTEXES, h_low );
+			backEndData[i]->animNormal = ri.Hunk_Alloc( sizeof( vec4_t ) * MAX_ANIMVERTEXES, h_low );
+		}
+	}
 	R_ToggleSmpFrame();
 
 	InitOpenGL();
@@ -1299,6 +1317,7 @@ void RE_Shutdown( qboolean destroyWindow ) {
 	ri.Cmd_RemoveCommand ("screenshotJPEG");
 	ri.Cmd_RemoveCommand ("screenshot");
 	ri.Cmd_RemoveCommand ("imagelist");
+	ri.Cmd_RemoveCommand ("imagebench");
 	ri.Cmd_RemoveCommand ("shaderlist");
 	ri.Cmd_RemoveCommand ("skinlist");
 	ri.Cmd_RemoveCommand ("gfxinfo");
@@ -1313,6 +1332,9 @@ void RE_Shutdown( qboolean destroyWindow ) {
 		R_DeleteTextures();
 	}
 
+	R_FreePrefetchedImages();
+	R_TrimImageCache();
+
 	R_DoneFreeType();
 
 	// shut down platform specific OpenGL stuff
@@ -1332,6 +1354,7 @@ Touch all images to make sure they are resident
 =============
 */
 void RE_EndRegistration( void ) {
+	R_EndPrefetch();
 	R_SyncRenderThread();
 	if (!ri.Sys_LowPhysicalMemory()) {
 		RB_ShowImages();
@@ -1375,12 +1398,15 @@ refexport_t *GetRefAPI ( int apiVersion, refimport_t *rimp ) {
 	re.LoadWorld = RE_LoadWorldMap;
 	re.SetWorldVisData = RE_SetWorldVisData;
 	re.EndRegistration = RE_EndRegistration;
+	re.PrefetchImages = RE_PrefetchImages;
 
 	re.BeginFrame = RE_BeginFrame;
 	re.EndFrame = RE_EndFrame;
 
 	re.MarkFragments = R_MarkFragments;
 	re.LerpTag = R_LerpTag;
+	re.RegisterTag = R_RegisterTag;
+	re.LerpTagIndex = R_LerpTagIndex;
 	re.ModelBounds = R_ModelBounds;
 
 	re.ClearScene = RE_ClearScene;
@@ -1403,6 +1429,7 @@ refexport_t *GetRefAPI ( int apiVersion, refimport_t *rimp ) {
 	re.inPVS = R_inPVS;
 
 	re.TakeVideoFrame = RE_TakeVideoFrame;
+	re.SaveJPGToBuffer = RE_SaveJPGToBuffer;
 
 	return &re;
 }
@@ -76,6 +76,8 @@ typedef struct {
 	vec3_t		directedLight;
 	vec3_t		dynamicLight;
 	float		lightDistance;
+
+	int			animSurfs;		// first animSurf_t of this entity, 1 based, 0 for none
 } trRefEntity_t;
 
 
@@ -881,8 +883,11 @@ typedef struct model_s {
 
 void		R_ModelInit (void);
 model_t		*R_GetModelByHandle( qhandle_t hModel );
+int			R_RegisterTag( qhandle_t handle, const char *tagName );
 int			R_LerpTag( orientation_t *tag, qhandle_t handle, int startFrame, int endFrame, 
 					 float frac, const char *tagName );
+int			R_LerpTagIndex( orientation_t *tag, qhandle_t handle, int startFrame, int endFrame, 
+					 float frac, int tagIndex );
 void		R_ModelBounds( qhandle_t handle, vec3_t mins, vec3_t maxs );
 
 void		R_Modellist_f (void);
@@ -938,6 +943,8 @@ typedef struct {
 	int		c_leafs;
 	int		c_dlightSurfaces;
 	int		c_dlightSurfacesCulled;
+
+	int		c_iqmPoseHits, c_iqmPoseMisses;
 } frontEndCounters_t;
 
 #define	FOG_TABLE_SIZE		256
@@ -972,6 +979,8 @@ typedef struct {
 	int		c_flareTests;
 	int		c_flareRenders;
 
+	int		c_iqmPoseHits, c_iqmPoseMisses;
+
 	int		msec;			// total msec for backend run
 } backEndCounters_t;
 
@@ -1246,6 +1255,11 @@ extern	cvar_t	*r_subdivisions;
 extern	cvar_t	*r_lodCurveError;
 extern	cvar_t	*r_smp;
 extern	cvar_t	*r_showSmp;
+extern	cvar_t	*r_animJobs;
+extern	cvar_t	*r_prefetch;				// decode the images a map used last time on job threads
+extern	cvar_t	*r_prefetchMegs;			// limit on the decoded images held for registration
+extern	cvar_t	*r_imageCache;				// keep prepared uploads of pk3 images under imagecache/
+extern	cvar_t	*r_imageCacheMegs;			// disk space the image cache is trimmed to when a level ends
 extern	cvar_t	*r_skipBackEnd;
 
 extern	cvar_t	*r_stereoEnabled;
@@ -1377,6 +1391,7 @@ void		R_SetColorMappings( void );
 void		R_GammaCorrect( byte *buffer, int bufSize );
 
 void	R_ImageList_f( void );
+void	R_ImageBench_f( void );
 void	R_SkinList_f( void );
 // https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=516
 const void *RB_TakeScreenshotCmd( const void *data );
@@ -1386,6 +1401,10 @@ void	R_InitFogTable( void );
 float	R_FogFactor( float s, float t );
 void	R_InitImages( void );
 void	R_DeleteTextures( void );
+void	RE_PrefetchImages( const char *mapname );
+void	R_EndPrefetch( void );
+void	R_FreePrefetchedImages( void );
+void	R_TrimImageCache( void );
 int		R_SumOfUsedImages( void );
 void	R_InitSkins( void );
 skin_t	*R_GetSkinByHandle( qhandle_t hSkin );
@@ -1868,9 +1887,12 @@ ANIMATED MODELS
 qboolean R_LoadIQM (model_t *mod, void *buffer, int filesize, const char *name );
 void R_AddIQMSurfaces( trRefEntity_t *ent );
 void RB_IQMSurfaceAnim( surfaceType_t *surface );
+void R_IQMAnimateVertexes( srfIQModel_t *surf, const float *jointMats, vec4_t *outXYZ, vec4_t *outNormal );
+float *R_IQMEntityPose( iqmData_t *data, trRefEntity_t *ent );
+int R_IQMTagIndex( iqmData_t *data, const char *tagName );
 int R_IQMLerpTag( orientation_t *tag, iqmData_t *data,
                   int startFrame, int endFrame,
-                  float frac, const char *tagName );
+                  float frac, int joint );
 
 /*
 =============================================================
@@ -1880,6 +1902,34 @@ IMAGE LOADERS
 =============================================================
 */
 
+// An image file that has already been read.  The decoders only look
+// at the buffer and never use the filesystem, ri.Printf or ri.Error,
+// so they can run on job threads; problems are left in error and
+// warning for R_FinishImageDecode to report.
+typedef struct {
+	const char	*name;
+	const byte	*buffer;
+	int			length;
+
+	byte		*pic;				// ri.Malloc'd RGBA, NULL if decoding failed
+	int			width, height;
+
+	int			errorLevel;
+	char		error[256];			// raised with ri.Error( errorLevel ) when set
+	char		warning[256];		// printed when set
+} imageDecode_t;
+
+typedef void (*imageDecoder_t)( imageDecode_t *decode );
+
+void R_DecodeJPG( imageDecode_t *decode );
+void R_DecodePNG( imageDecode_t *decode );
+void R_DecodeTGA( imageDecode_t *decode );
+
+void R_DecodeError( imageDecode_t *decode, int level, const char *fmt, ... ) __attribute__ ((format (printf, 3, 4)));
+void R_DecodeWarning( imageDecode_t *decode, const char *fmt, ... ) __attribute__ ((format (printf, 2, 3)));
+void R_FinishImageDecode( imageDecode_t *decode, byte **pic, int *width, int *height );
+void R_DecodeImageFile( const char *name, imageDecoder_t decoder, byte **pic, int *width, int *height );
+
 void R_LoadBMP( const char *name, byte **pic, int *width, int *height );
 void R_LoadJPG( const char *name, byte **pic, int *width, int *height );
 void R_LoadPCX( const char *name, byte **pic, int *width, int *height );
@@ -2047,6 +2097,35 @@ typedef enum {
 #define	MAX_POLYS		16000
 #define	MAX_POLYVERTS	16000
 
+// animated model surfaces have their vertexes skinned in a
+// separate pass before the back end is started on them
+#define	MAX_ANIMSURFS		2048
+#define	MAX_ANIMVERTEXES	0x20000
+
+typedef struct {
+	surfaceType_t	*surface;		// SF_MD3 or SF_IQM
+	trRefEntity_t	*entity;
+	int				next;			// next animSurf_t of the same entity, 1 based
+	int				firstVertex;	// into animXyz / animNormal
+	int				numVertexes;
+	float			*jointMats;		// SF_IQM only, from iqmPoseMats
+} animSurf_t;
+
+// interpolated IQM joint matrices are only computed once per frame
+// for every model pose, and shared by all surfaces, passes and tag
+// queries that use it
+#define	MAX_IQMPOSES		256
+#define	MAX_IQMPOSEFLOATS	0x30000
+#define	IQMPOSE_HASH_SIZE	256
+
+typedef struct {
+	iqmData_t		*data;
+	int				frame, oldframe;
+	float			backlerp;
+	float			*jointMats;		// into iqmPoseMats
+	int				next;			// hash chain, 1 based
+} iqmPoseCache_t;
+
 // all of the information needed by the back end must be
 // contained in a backEndData_t.  This entire structure is
 // duplicated so the front and back end can run in parallel
@@ -2058,6 +2137,19 @@ typedef struct {
 	srfPoly_t	*polys;//[MAX_POLYS];
 	polyVert_t	*polyVerts;//[MAX_POLYVERTS];
 	renderCommandList_t	commands;
+
+	animSurf_t	animSurfs[MAX_ANIMSURFS];
+	int			numAnimSurfs;
+	int			numAnimSurfsDone;		// the ones before this have been skinned
+	int			numAnimVertexes;
+	vec4_t		*animXyz;//[MAX_ANIMVERTEXES], NULL if r_animJobs is 0
+	vec4_t		*animNormal;//[MAX_ANIMVERTEXES]
+
+	iqmPoseCache_t	iqmPoses[MAX_IQMPOSES];
+	int			numIqmPoses;
+	int			iqmPoseHash[IQMPOSE_HASH_SIZE];
+	float		iqmPoseMats[MAX_IQMPOSEFLOATS];
+	int			numIqmPoseFloats;
 } backEndData_t;
 
 extern	int		max_polys;
@@ -2073,6 +2165,10 @@ extern	volatile qboolean	renderThreadActive;
 void *R_GetCommandBuffer( int bytes );
 void RB_ExecuteRenderCommands( const void *data );
 
+void R_AddAnimatedSurfaces( drawSurf_t *drawSurfs, int numDrawSurfs );
+void R_AnimateSurfaces( void );
+animSurf_t *RB_FindAnimatedSurface( surfaceType_t *surface );
+
 void R_InitCommandBuffers( void );
 void R_ShutdownCommandBuffers( void );
 
@@ -566,25 +566,49 @@ void R_Modellist_f( void ) {
 /*
 ================
 R_GetTag
+
+Every frame of an md3 stores its tags in the same order,
+so a tag index found in one frame is valid for all of them.
 ================
 */
-static md3Tag_t *R_GetTag( md3Header_t *mod, int frame, const char *tagName ) {
-	md3Tag_t		*tag;
-	int				i;
-
+static md3Tag_t *R_GetTag( md3Header_t *mod, int frame, int tagIndex ) {
 	if ( frame >= mod->numFrames ) {
 		// it is possible to have a bad frame while changing models, so don't error
 		frame = mod->numFrames - 1;
 	}
 
-	tag = (md3Tag_t *)((byte *)mod + mod->ofsTags) + frame * mod->numTags;
-	for ( i = 0 ; i < mod->numTags ; i++, tag++ ) {
+	return (md3Tag_t *)((byte *)mod + mod->ofsTags) + frame * mod->numTags + tagIndex;
+}
+
+/*
+================
+R_RegisterTag
+
+Returns the index of the named tag for R_LerpTagIndex,
+or -1 if the model doesn't have it
+================
+*/
+int R_RegisterTag( qhandle_t handle, const char *tagName ) {
+	md3Tag_t	*tag;
+	int			i;
+	model_t		*model;
+
+	model = R_GetModelByHandle( handle );
+	if ( !model->md3[0] ) {
+		if( model->type == MOD_IQM ) {
+			return R_IQMTagIndex( model->modelData, tagName );
+		}
+		return -1;
+	}
+
+	tag = (md3Tag_t *)((byte *)model->md3[0] + model->md3[0]->ofsTags);
+	for ( i = 0 ; i < model->md3[0]->numTags ; i++, tag++ ) {
 		if ( !strcmp( tag->name, tagName ) ) {
-			return tag;	// found it
+			return i;	// found it
 		}
 	}
 
-	return NULL;
+	return -1;
 }
 
 /*
@@ -594,6 +618,19 @@ R_LerpTag
 */
 int R_LerpTag( orientation_t *tag, qhandle_t handle, int startFrame, int endFrame, 
 					 float frac, const char *tagName ) {
+	return R_LerpTagIndex( tag, handle, startFrame, endFrame, frac,
+		R_RegisterTag( handle, tagName ) );
+}
+
+/*
+================
+R_LerpTagIndex
+
+Same as R_LerpTag, with the tag already looked up by R_RegisterTag
+================
+*/
+int R_LerpTagIndex( orientation_t *tag, qhandle_t handle, int startFrame, int endFrame, 
+					 float frac, int tagIndex ) {
 	md3Tag_t	*start, *end;
 	int		i;
 	float		frontLerp, backLerp;
@@ -606,7 +643,7 @@ int R_LerpTag( orientation_t *tag, qhandle_t handle, int startFrame, int endFram
 		if( model->type == MOD_IQM ) {
 			return R_IQMLerpTag( tag, model->modelData,
 					startFrame, endFrame,
-					frac, tagName );
+					frac, tagIndex );
 		} else {
 
 			AxisClear( tag->axis );
@@ -617,13 +654,13 @@ int R_LerpTag( orientation_t *tag, qhandle_t handle, int startFrame, int endFram
 	}
 	else
 	{
-		start = R_GetTag( model->md3[0], startFrame, tagName );
-		end = R_GetTag( model->md3[0], endFrame, tagName );
-		if ( !start || !end ) {
+		if ( tagIndex < 0 || tagIndex >= model->md3[0]->numTags ) {
 			AxisClear( tag->axis );
 			VectorClear( tag->origin );
 			return qfalse;
 		}
+		start = R_GetTag( model->md3[0], startFrame, tagIndex );
+		end = R_GetTag( model->md3[0], endFrame, tagIndex );
 	}
 	
 	frontLerp = frac;
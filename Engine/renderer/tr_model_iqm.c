@@ -897,41 +897,87 @@ static void ComputeJointMats( iqmData_t *data, int frame, int oldframe,
 	}
 }
 
-
 /*
 =================
-RB_AddIQMSurfaces
+R_IQMPose
 
-Compute vertices for this model surface
+Returns the joint matrices of the model interpolated between frame
+and oldframe, computing them only the first time they are asked for
+this frame. Returns NULL if the pose cache is full.
 =================
 */
-void RB_IQMSurfaceAnim( surfaceType_t *surface ) {
-	srfIQModel_t	*surf = (srfIQModel_t *)surface;
-	iqmData_t	*data = surf->data;
-	float		jointMats[IQM_MAX_JOINTS * 12];
-	int		i;
+static float *R_IQMPose( backEndData_t *bd, iqmData_t *data, int frame, int oldframe,
+			 float backlerp, int *hits, int *misses ) {
+	iqmPoseCache_t	*pose;
+	int		hash;
+	int		p;
 
-	vec4_t		*outXYZ = &tess.xyz[tess.numVertexes];
-	vec4_t		*outNormal = &tess.normal[tess.numVertexes];
-	vec2_t		(*outTexCoord)[2] = &tess.texCoords[tess.numVertexes];
-	color4ub_t	*outColor = &tess.vertexColors[tess.numVertexes];
+	if ( oldframe == frame ) {
+		backlerp = 0;
+	}
 
-	int	frame = backEnd.currentEntity->e.frame % data->num_frames;
-	int	oldframe = backEnd.currentEntity->e.oldframe % data->num_frames;
-	float	backlerp = backEnd.currentEntity->e.backlerp;
+	hash = ( (int)( (intptr_t)data >> 4 ) + frame * 31 + oldframe * 17 ) & ( IQMPOSE_HASH_SIZE - 1 );
 
-	int		*tri;
-	glIndex_t	*ptr;
-	glIndex_t	base;
+	// tag queries come with the frames swapped, so the lerp
+	// may be off by a rounding error
+	for ( p = bd->iqmPoseHash[hash]; p; p = pose->next ) {
+		pose = &bd->iqmPoses[p - 1];
+		if ( pose->data == data && pose->frame == frame && pose->oldframe == oldframe
+			&& fabs( pose->backlerp - backlerp ) < 0.00001f ) {
+			(*hits)++;
+			return pose->jointMats;
+		}
+	}
 
-	RB_CHECKOVERFLOW( surf->num_vertexes, surf->num_triangles * 3 );
+	if ( bd->numIqmPoses == MAX_IQMPOSES
+		|| bd->numIqmPoseFloats + 12 * data->num_joints > MAX_IQMPOSEFLOATS ) {
+		return NULL;
+	}
 
-	// compute interpolated joint matrices
-	ComputeJointMats( data, frame, oldframe, backlerp, jointMats );
+	pose = &bd->iqmPoses[bd->numIqmPoses++];
+	pose->data = data;
+	pose->frame = frame;
+	pose->oldframe = oldframe;
+	pose->backlerp = backlerp;
+	pose->jointMats = bd->iqmPoseMats + bd->numIqmPoseFloats;
+	pose->next = bd->iqmPoseHash[hash];
+	bd->iqmPoseHash[hash] = bd->numIqmPoses;
+	bd->numIqmPoseFloats += 12 * data->num_joints;
 
-	// transform vertexes and fill other data
+	ComputeJointMats( data, frame, oldframe, backlerp, pose->jointMats );
+	(*misses)++;
+
+	return pose->jointMats;
+}
+
+/*
+=================
+R_IQMEntityPose
+
+Front end pose of the entity, NULL if it couldn't be cached
+=================
+*/
+float *R_IQMEntityPose( iqmData_t *data, trRefEntity_t *ent ) {
+	return R_IQMPose( backEndData[tr.smpFrame], data,
+			  ent->e.frame % data->num_frames, ent->e.oldframe % data->num_frames,
+			  ent->e.backlerp, &tr.pc.c_iqmPoseHits, &tr.pc.c_iqmPoseMisses );
+}
+
+
+/*
+=================
+R_IQMAnimateVertexes
+
+Compute the vertex positions and normals of this model surface
+=================
+*/
+void R_IQMAnimateVertexes( srfIQModel_t *surf, const float *jointMats, vec4_t *outXYZ, vec4_t *outNormal ) {
+	iqmData_t	*data = surf->data;
+	int		i;
+
+	// transform vertexes
 	for( i = 0; i < surf->num_vertexes;
-	     i++, outXYZ++, outNormal++, outTexCoord++, outColor++ ) {
+	     i++, outXYZ++, outNormal++ ) {
 		int	j, k;
 		float	vtxMat[12];
 		float	nrmMat[9];
@@ -964,11 +1010,6 @@ void RB_IQMSurfaceAnim( surfaceType_t *surface ) {
 		nrmMat[ 7] = vtxMat[ 2]*vtxMat[ 4] - vtxMat[ 0]*vtxMat[ 6];
 		nrmMat[ 8] = vtxMat[ 0]*vtxMat[ 5] - vtxMat[ 1]*vtxMat[ 4];
 
-		(*outTexCoord)[0][0] = data->texcoords[2*vtx + 0];
-		(*outTexCoord)[0][1] = data->texcoords[2*vtx + 1];
-		(*outTexCoord)[1][0] = (*outTexCoord)[0][0];
-		(*outTexCoord)[1][1] = (*outTexCoord)[0][1];
-
 		(*outXYZ)[0] =
 			vtxMat[ 0] * data->positions[3*vtx+0] +
 			vtxMat[ 1] * data->positions[3*vtx+1] +
@@ -999,6 +1040,67 @@ void RB_IQMSurfaceAnim( surfaceType_t *surface ) {
 			nrmMat[ 7] * data->normals[3*vtx+1] +
 			nrmMat[ 8] * data->normals[3*vtx+2];
 		(*outNormal)[3] = 0.0f;
+	}
+}
+
+/*
+=================
+RB_IQMSurfaceAnim
+
+Compute vertices for this model surface
+=================
+*/
+void RB_IQMSurfaceAnim( surfaceType_t *surface ) {
+	srfIQModel_t	*surf = (srfIQModel_t *)surface;
+	iqmData_t	*data = surf->data;
+	animSurf_t	*anim;
+	float		*jointMats;
+	float		scratchMats[IQM_MAX_JOINTS * 12];
+	int		i;
+
+	vec2_t		(*outTexCoord)[2] = &tess.texCoords[tess.numVertexes];
+	color4ub_t	*outColor = &tess.vertexColors[tess.numVertexes];
+
+	int		*tri;
+	glIndex_t	*ptr;
+	glIndex_t	base;
+
+	RB_CHECKOVERFLOW( surf->num_vertexes, surf->num_triangles * 3 );
+
+	// the animation jobs may have done the skinning already
+	anim = RB_FindAnimatedSurface( surface );
+	if( anim ) {
+		Com_Memcpy( &tess.xyz[tess.numVertexes], backEndData[backEnd.smpFrame]->animXyz + anim->firstVertex,
+			surf->num_vertexes * sizeof( vec4_t ) );
+		Com_Memcpy( &tess.normal[tess.numVertexes], backEndData[backEnd.smpFrame]->animNormal + anim->firstVertex,
+			surf->num_vertexes * sizeof( vec4_t ) );
+	} else {
+		int	frame = backEnd.currentEntity->e.frame % data->num_frames;
+		int	oldframe = backEnd.currentEntity->e.oldframe % data->num_frames;
+		float	backlerp = backEnd.currentEntity->e.backlerp;
+
+		// compute interpolated joint matrices, unless another
+		// surface or pass already did
+		jointMats = R_IQMPose( backEndData[backEnd.smpFrame], data, frame, oldframe, backlerp,
+				       &backEnd.pc.c_iqmPoseHits, &backEnd.pc.c_iqmPoseMisses );
+		if( !jointMats ) {
+			ComputeJointMats( data, frame, oldframe, backlerp, scratchMats );
+			jointMats = scratchMats;
+		}
+
+		R_IQMAnimateVertexes( surf, jointMats,
+			&tess.xyz[tess.numVertexes], &tess.normal[tess.numVertexes] );
+	}
+
+	// fill other data
+	for( i = 0; i < surf->num_vertexes;
+	     i++, outTexCoord++, outColor++ ) {
+		int	vtx = i + surf->first_vertex;
+
+		(*outTexCoord)[0][0] = data->texcoords[2*vtx + 0];
+		(*outTexCoord)[0][1] = data->texcoords[2*vtx + 1];
+		(*outTexCoord)[1][0] = (*outTexCoord)[0][0];
+		(*outTexCoord)[1][1] = (*outTexCoord)[0][1];
 
 		(*outColor)[0] = data->colors[4*vtx+0];
 		(*outColor)[1] = data->colors[4*vtx+1];
@@ -1020,26 +1122,39 @@ void RB_IQMSurfaceAnim( surfaceType_t *surface ) {
 	tess.numVertexes += surf->num_vertexes;
 }
 
-int R_IQMLerpTag( orientation_t *tag, iqmData_t *data,
-		  int startFrame, int endFrame, 
-		  float frac, const char *tagName ) {
-	float	jointMats[IQM_MAX_JOINTS * 12];
+int R_IQMTagIndex( iqmData_t *data, const char *tagName ) {
 	int	joint;
 	char	*names = data->names;
 
 	// get joint number by reading the joint names
 	for( joint = 0; joint < data->num_joints; joint++ ) {
 		if( !strcmp( tagName, names ) )
-			break;
+			return joint;
 		names += strlen( names ) + 1;
 	}
-	if( joint >= data->num_joints ) {
+	return -1;
+}
+
+int R_IQMLerpTag( orientation_t *tag, iqmData_t *data,
+		  int startFrame, int endFrame, 
+		  float frac, int joint ) {
+	float	scratchMats[IQM_MAX_JOINTS * 12];
+	float	*jointMats;
+
+	if( joint < 0 || joint >= data->num_joints ) {
 		AxisClear( tag->axis );
 		VectorClear( tag->origin );
 		return qfalse;
 	}
 
-	ComputeJointMats( data, startFrame, endFrame, frac, jointMats );
+	// share the pose with the entity drawing the model, which
+	// lerps from endFrame back to startFrame instead
+	jointMats = R_IQMPose( backEndData[tr.smpFrame], data, endFrame, startFrame, 1.0f - frac,
+			       &tr.pc.c_iqmPoseHits, &tr.pc.c_iqmPoseMisses );
+	if( !jointMats ) {
+		jointMats = scratchMats;
+		ComputeJointMats( data, endFrame, startFrame, 1.0f - frac, jointMats );
+	}
 
 	tag->axis[0][0] = jointMats[12 * joint + 0];
 	tag->axis[1][0] = jointMats[12 * joint + 1];
@@ -24,7 +24,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "tr_types.h"
 
-#define	REF_API_VERSION		8
+#define	REF_API_VERSION		15
 
 //
 // these are the functions exported by the refresh module
@@ -59,6 +59,11 @@ typedef struct {
 	// them to be loaded into card memory
 	void	(*EndRegistration)( void );
 
+	// PrefetchImages decodes the images the map used the last time it
+	// was loaded, so registration can upload them without waiting on
+	// the decoders.  EndRegistration drops whatever was not used.
+	void	(*PrefetchImages)( const char *mapname );
+
 	// a scene is built up by calls to R_ClearScene and the various R_Add functions.
 	// Nothing is drawn until R_RenderScene is called.
 	void	(*ClearScene)( void );
@@ -89,6 +94,10 @@ typedef struct {
 
 	int		(*LerpTag)( orientation_t *tag,  qhandle_t model, int startFrame, int endFrame, 
 					 float frac, const char *tagName );
+	// tag lookups by index, for callers that lerp the same tags every frame
+	int		(*RegisterTag)( qhandle_t model, const char *tagName );
+	int		(*LerpTagIndex)( orientation_t *tag,  qhandle_t model, int startFrame, int endFrame, 
+					 float frac, int tagIndex );
 	void	(*ModelBounds)( qhandle_t model, vec3_t mins, vec3_t maxs );
 
 #ifdef __USEA3D
@@ -100,6 +109,11 @@ typedef struct {
 	qboolean (*inPVS)( const vec3_t p1, const vec3_t p2 );
 
 	void (*TakeVideoFrame)( int h, int w, byte* captureBuffer, byte *encodeBuffer, qboolean motionJpeg );
+
+	// encodes bottom up RGB lines, safe to call from a job while
+	// the renderer runs
+	size_t	(*SaveJPGToBuffer)( byte *buffer, size_t bufSize, int quality,
+		int image_width, int image_height, byte *image_buffer, int padding );
 } refexport_t;
 
 //
@@ -153,13 +167,20 @@ typedef struct {
 	// a -1 return means the file does not exist
 	// NULL can be passed for buf to just determine existance
 	int		(*FS_FileIsInPAK)( const char *name, int *pCheckSum );
+	int		(*FS_PakFileCRC)( const char *name, int *crc );
 	long		(*FS_ReadFile)( const char *name, void **buf );
 	void	(*FS_FreeFile)( void *buf );
+	long	(*FS_ReadFileView)( const char *name, void **buf );
+	void	(*FS_ReleaseView)( void *buf );
 	char **	(*FS_ListFiles)( const char *name, const char *extension, int *numfilesfound );
 	char **	(*FS_ListFilesFull)( const char *name, const char *extension, int *numfilesfound );
+	char **	(*FS_ListPakFiles)( const char *pakName, const char *extension, int *numfilesfound );
 	void	(*FS_FreeFileList)( char **filelist );
 	void	(*FS_WriteFile)( const char *qpath, const void *buffer, int size );
+	void	(*FS_HomeRemove)( const char *homePath );
 	qboolean (*FS_FileExists)( const char *file );
+	const char *(*FS_LoadedPakChecksums)( void );
+	qboolean (*FS_PureServerActive)( void );
 
 	// cinematic stuff
 	void	(*CIN_UploadCinematic)(int handle);
@@ -181,6 +202,10 @@ typedef struct {
 	void	(*Sys_GLimpSafeInit)( void );
 	void	(*Sys_GLimpInit)( void );
 	qboolean (*Sys_LowPhysicalMemory)( void );
+
+	// job system
+	void	(*Job_ParallelFor)( void (*function)( void *data, int index ), void *data, int count, int batch );
+	int		(*Job_NumThreads)( void );
 } refimport_t;
 
 
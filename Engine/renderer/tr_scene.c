@@ -53,6 +53,14 @@ void R_ToggleSmpFrame( void ) {
 
 	backEndData[tr.smpFrame]->commands.used = 0;
 
+	backEndData[tr.smpFrame]->numAnimSurfs = 0;
+	backEndData[tr.smpFrame]->numAnimSurfsDone = 0;
+	backEndData[tr.smpFrame]->numAnimVertexes = 0;
+
+	backEndData[tr.smpFrame]->numIqmPoses = 0;
+	backEndData[tr.smpFrame]->numIqmPoseFloats = 0;
+	Com_Memset( backEndData[tr.smpFrame]->iqmPoseHash, 0, sizeof( backEndData[tr.smpFrame]->iqmPoseHash ) );
+
 	r_firstSceneDrawSurf = 0;
 
 	r_numdlights = 0;
@@ -226,6 +234,7 @@ void RE_AddRefEntityToScene( const refEntity_t *ent ) {
 
 	backEndData[tr.smpFrame]->entities[r_numentities].e = *ent;
 	backEndData[tr.smpFrame]->entities[r_numentities].lightingCalculated = qfalse;
+	backEndData[tr.smpFrame]->entities[r_numentities].animSurfs = 0;
 
 	r_numentities++;
 }
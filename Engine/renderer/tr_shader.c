@@ -31,8 +31,6 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 // SKYBOX FIX END !!
 
-static char *s_shaderText;
-
 // the shader is parsed into these global variables, then copied into
 // dynamically allocated memory if it is valid.
 static	shaderStage_t	stages[MAX_SHADER_STAGES];		
@@ -42,8 +40,61 @@ static	texModInfo_t	texMods[MAX_SHADER_STAGES][TR_MAX_TEXMODS];
 #define FILE_HASH_SIZE		1024
 static	shader_t*		hashTable[FILE_HASH_SIZE];
 
+/*
+The shader text index maps every shader name in the .shader files to
+the file that defines it and the offset of the definition in that
+file's compressed text.  It is saved to SHADERINDEX_FILE under a key
+made from the loaded pak checksums and the shader file names and
+sizes, so a run with the same data reads the index instead of every
+shader file, and only loads the files whose shaders get used.
+*/
 #define MAX_SHADERTEXT_HASH		2048
-static char **shaderTextHashTable[MAX_SHADERTEXT_HASH];
+
+#define	SHADERINDEX_FILE		"shaderindex.dat"
+#define	SHADERINDEX_IDENT		(('X'<<24)+('I'<<16)+('H'<<8)+'S')
+#define	SHADERINDEX_VERSION		1
+
+typedef struct {
+	int		name;				// offset in s_shaderIndex.names
+	int		length;				// of the file as read
+	int		textLength;			// of the compressed text the offsets point into
+	char	*text;				// compressed, NULL until one of its shaders is used
+} shaderTextFile_t;
+
+typedef struct {
+	int		name;
+	int		file;
+	int		offset, length;		// of the name and braced section in the text
+	int		next;				// in the hash chain, -1 at the end
+} shaderTextEntry_t;
+
+typedef struct {
+	int		ident;
+	int		version;
+	int		key;
+	int		numFiles;
+	int		numEntries;
+	int		namesSize;
+	// followed by numFiles name/length/textLength triples, numEntries
+	// name/file/offset/length quads and the names
+} shaderIndexHeader_t;
+
+static struct {
+	int					numFiles;
+	int					numEntries;
+	int					namesSize;
+	shaderTextFile_t	*files;
+	shaderTextEntry_t	*entries;
+	char				*names;
+	int					hashTable[MAX_SHADERTEXT_HASH];
+	int					key;
+	qboolean			cached;			// read from SHADERINDEX_FILE
+
+	int					buildMsec;
+	int					lookups, misses;
+	int					filesLoaded;
+	int					parseCount, parseMsec;
+} s_shaderIndex;
 
 /*
 ================
@@ -3324,12 +3375,47 @@ static shader_t *FinishShader( void ) {
 
 //========================================================================================
 
+/*
+====================
+LoadShaderTextFile
+
+Reads and compresses a shader file the index points into
+=====================
+*/
+static char *LoadShaderTextFile( shaderTextFile_t *file ) {
+	char	filename[MAX_QPATH];
+	char	*buffer;
+	int		length;
+
+	if ( file->text ) {
+		return file->text;
+	}
+
+	Com_sprintf( filename, sizeof( filename ), "scripts/%s", s_shaderIndex.names + file->name );
+	length = ri.FS_ReadFile( filename, (void **)&buffer );
+	if ( !buffer ) {
+		return NULL;
+	}
+
+	// the same size can still compress differently, and then
+	// the offsets are no good
+	if ( length == file->length && COM_Compress( buffer ) == file->textLength ) {
+		file->text = ri.Hunk_Alloc( strlen( buffer ) + 1, h_low );
+		strcpy( file->text, buffer );
+		s_shaderIndex.filesLoaded++;
+	}
+
+	ri.FS_FreeFile( buffer );
+	return file->text;
+}
+
+static void BuildShaderIndex( qboolean useCache );
+
 /*
 ====================
 FindShaderInShaderText
 
-Scans the combined text description of all the shader files for
-the given shader name.
+Looks the shader name up in the shader text index.
 
 return NULL if not found
 
@@ -3337,41 +3423,45 @@ If found, it will return a valid shader
 =====================
 */
 static char *FindShaderInShaderText( const char *shadername ) {
+	shaderTextEntry_t	*entry;
+	char				*token, *p, *end;
+	int					i;
 
-	char *token, *p;
-
-	int i, hash;
+	if ( !s_shaderIndex.entries ) {
+		return NULL;
+	}
 
-	hash = generateHashValue(shadername, MAX_SHADERTEXT_HASH);
+	s_shaderIndex.lookups++;
 
-	for (i = 0; shaderTextHashTable[hash][i]; i++) {
-		p = shaderTextHashTable[hash][i];
-		token = COM_ParseExt(&p, qtrue);
-		if ( !Q_stricmp( token, shadername ) ) {
-			return p;
+	i = s_shaderIndex.hashTable[generateHashValue( shadername, MAX_SHADERTEXT_HASH )];
+	for ( ; i != -1; i = s_shaderIndex.entries[i].next ) {
+		if ( !Q_stricmp( s_shaderIndex.names + s_shaderIndex.entries[i].name, shadername ) ) {
+			break;
 		}
 	}
-
-	p = s_shaderText;
-
-	if ( !p ) {
+	if ( i == -1 ) {
+		s_shaderIndex.misses++;
 		return NULL;
 	}
+	entry = &s_shaderIndex.entries[i];
 
-	// look for label
-	while ( 1 ) {
+	// the section has to lie inside the text, and the name inside the section
+	p = LoadShaderTextFile( &s_shaderIndex.files[entry->file] );
+	if ( p && entry->offset + entry->length <= s_shaderIndex.files[entry->file].textLength ) {
+		end = p + entry->offset + entry->length;
+		p += entry->offset;
 		token = COM_ParseExt( &p, qtrue );
-		if ( token[0] == 0 ) {
-			break;
-		}
-
-		if ( !Q_stricmp( token, shadername ) ) {
+		if ( p <= end && !Q_stricmp( token, shadername ) ) {
 			return p;
 		}
-		else {
-			// skip the definition
-			SkipBracedSection( &p );
-		}
+	}
+
+	// a shader file changed without changing size, so the saved index
+	// no longer matches it
+	if ( s_shaderIndex.cached ) {
+		ri.Printf( PRINT_WARNING, "WARNING: %s is out of date, rebuilding it\n", SHADERINDEX_FILE );
+		BuildShaderIndex( qfalse );
+		return FindShaderInShaderText( shadername );
 	}
 
 	return NULL;
@@ -3517,10 +3607,13 @@ shader_t *R_FindShader( const char *name, int lightmapIndex, qboolean mipRawImag
 			ri.Printf( PRINT_ALL, "*SHADER* %s\n", name );
 		}
 
+		s_shaderIndex.parseMsec -= ri.Milliseconds();
 		if ( !ParseShader( &shaderText ) ) {
 			// had errors, so use default shader
 			shader.defaultShader = qtrue;
 		}
+		s_shaderIndex.parseMsec += ri.Milliseconds();
+		s_shaderIndex.parseCount++;
 		sh = FinishShader();
 		return sh;
 	}
@@ -3880,41 +3973,245 @@ void	R_ShaderList_f (void) {
 		count++;
 	}
 	ri.Printf (PRINT_ALL, "%i total shaders\n", count);
+	ri.Printf (PRINT_ALL, "%i shader texts in %i files, index %s in %i msec\n",
+		s_shaderIndex.numEntries, s_shaderIndex.numFiles,
+		s_shaderIndex.cached ? "loaded" : "built", s_shaderIndex.buildMsec );
+	ri.Printf (PRINT_ALL, "%i lookups, %i not found, %i files read, %i shaders parsed in %i msec\n",
+		s_shaderIndex.lookups, s_shaderIndex.misses, s_shaderIndex.filesLoaded,
+		s_shaderIndex.parseCount, s_shaderIndex.parseMsec );
 	ri.Printf (PRINT_ALL, "------------------\n");
 }
 
+/*
+====================
+HashShaderIndex
+=====================
+*/
+static void HashShaderIndex( void ) {
+	int		i, hash;
+
+	for ( i = 0; i < MAX_SHADERTEXT_HASH; i++ ) {
+		s_shaderIndex.hashTable[i] = -1;
+	}
+
+	for ( i = 0; i < s_shaderIndex.numEntries; i++ ) {
+		hash = generateHashValue( s_shaderIndex.names + s_shaderIndex.entries[i].name, MAX_SHADERTEXT_HASH );
+		s_shaderIndex.entries[i].next = s_shaderIndex.hashTable[hash];
+		s_shaderIndex.hashTable[hash] = i;
+	}
+}
+
+/*
+====================
+AddShaderIndexEntry
+
+The first definition of a name is the one that is kept
+=====================
+*/
+static void AddShaderIndexEntry( const char *name, int file, int offset, int length ) {
+	shaderTextEntry_t	*entry;
+	int					i, hash;
+
+	hash = generateHashValue( name, MAX_SHADERTEXT_HASH );
+	for ( i = s_shaderIndex.hashTable[hash]; i != -1; i = s_shaderIndex.entries[i].next ) {
+		if ( !Q_stricmp( s_shaderIndex.names + s_shaderIndex.entries[i].name, name ) ) {
+			return;
+		}
+	}
+
+	entry = &s_shaderIndex.entries[s_shaderIndex.numEntries];
+	entry->name = s_shaderIndex.namesSize;
+	entry->file = file;
+	entry->offset = offset;
+	entry->length = length;
+	entry->next = s_shaderIndex.hashTable[hash];
+	s_shaderIndex.hashTable[hash] = s_shaderIndex.numEntries++;
+
+	strcpy( s_shaderIndex.names + s_shaderIndex.namesSize, name );
+	s_shaderIndex.namesSize += strlen( name ) + 1;
+}
+
+/*
+====================
+ShaderIndexKey
+
+Changes whenever a pak or a shader file does
+=====================
+*/
+static int ShaderIndexKey( char **shaderFiles, const int *lengths, int numShaderFiles ) {
+	const char	*s;
+	unsigned	key;
+	int			i;
+
+	key = 2166136261u;
+	for ( s = ri.FS_LoadedPakChecksums(); *s; s++ ) {
+		key = ( key ^ (byte)*s ) * 16777619u;
+	}
+
+	for ( i = 0; i < numShaderFiles; i++ ) {
+		for ( s = shaderFiles[i]; *s; s++ ) {
+			key = ( key ^ (byte)*s ) * 16777619u;
+		}
+		key = ( key ^ (unsigned)lengths[i] ) * 16777619u;
+	}
+
+	return (int)key;
+}
+
+/*
+====================
+LoadShaderIndex
+
+Takes the index from SHADERINDEX_FILE if it was saved for the same
+shader files
+=====================
+*/
+static qboolean LoadShaderIndex( char **shaderFiles, const int *lengths, int numShaderFiles ) {
+	shaderIndexHeader_t	header;
+	union {
+		byte	*b;
+		void	*v;
+	} buffer;
+	int			*data;
+	char		*names;
+	int			length;
+	int			i;
+
+	length = ri.FS_ReadFile( SHADERINDEX_FILE, &buffer.v );
+	if ( !buffer.b ) {
+		return qfalse;
+	}
+
+	Com_Memset( &header, 0, sizeof( header ) );
+	if ( length >= (int)sizeof( header ) ) {
+		for ( i = 0; i < (int)sizeof( header ) / 4; i++ ) {
+			( (int *)&header )[i] = LittleLong( ( (int *)buffer.b )[i] );
+		}
+	}
+
+	if ( header.ident != SHADERINDEX_IDENT || header.version != SHADERINDEX_VERSION
+		|| header.key != s_shaderIndex.key || header.numFiles != numShaderFiles
+		|| header.numEntries < 0 || header.namesSize <= 0
+		|| length != (int)sizeof( header ) + ( header.numFiles * 3 + header.numEntries * 4 ) * 4 + header.namesSize ) {
+		ri.FS_FreeFile( buffer.v );
+		return qfalse;
+	}
+
+	data = (int *)( buffer.b + sizeof( header ) );
+	names = (char *)( data + header.numFiles * 3 + header.numEntries * 4 );
+	if ( names[header.namesSize - 1] ) {
+		ri.FS_FreeFile( buffer.v );
+		return qfalse;
+	}
+
+	for ( i = 0; i < numShaderFiles; i++ ) {
+		int		name = LittleLong( data[i * 3] );
+
+		if ( name < 0 || name >= header.namesSize || Q_stricmp( names + name, shaderFiles[i] )
+			|| LittleLong( data[i * 3 + 1] ) != lengths[i] || LittleLong( data[i * 3 + 2] ) < 0 ) {
+			ri.FS_FreeFile( buffer.v );
+			return qfalse;
+		}
+	}
+
+	s_shaderIndex.numFiles = header.numFiles;
+	s_shaderIndex.numEntries = header.numEntries;
+	s_shaderIndex.namesSize = header.namesSize;
+	s_shaderIndex.files = ri.Hunk_Alloc( header.numFiles * sizeof( shaderTextFile_t ), h_low );
+	s_shaderIndex.entries = ri.Hunk_Alloc( ( header.numEntries + 1 ) * sizeof( shaderTextEntry_t ), h_low );
+	s_shaderIndex.names = ri.Hunk_Alloc( header.namesSize, h_low );
+	Com_Memcpy( s_shaderIndex.names, names, header.namesSize );
+
+	for ( i = 0; i < header.numFiles; i++, data += 3 ) {
+		s_shaderIndex.files[i].name = LittleLong( data[0] );
+		s_shaderIndex.files[i].length = LittleLong( data[1] );
+		s_shaderIndex.files[i].textLength = LittleLong( data[2] );
+	}
+
+	for ( i = 0; i < header.numEntries; i++, data += 4 ) {
+		shaderTextEntry_t	*entry = &s_shaderIndex.entries[i];
+
+		entry->name = LittleLong( data[0] );
+		entry->file = LittleLong( data[1] );
+		entry->offset = LittleLong( data[2] );
+		entry->length = LittleLong( data[3] );
+		if ( entry->name < 0 || entry->name >= header.namesSize
+			|| entry->file < 0 || entry->file >= header.numFiles
+			|| entry->offset < 0 || entry->length <= 0
+			|| entry->offset > s_shaderIndex.files[entry->file].textLength - entry->length ) {
+			// the hunk memory is lost until the next level, but
+			// the index will be rebuilt rather than trusted
+			s_shaderIndex.numFiles = 0;
+			s_shaderIndex.numEntries = 0;
+			s_shaderIndex.namesSize = 0;
+			s_shaderIndex.entries = NULL;
+			ri.FS_FreeFile( buffer.v );
+			return qfalse;
+		}
+	}
+
+	ri.FS_FreeFile( buffer.v );
+
+	HashShaderIndex();
+	return qtrue;
+}
+
+/*
+====================
+SaveShaderIndex
+=====================
+*/
+static void SaveShaderIndex( void ) {
+	shaderIndexHeader_t	*header;
+	int					*data;
+	int					size;
+	int					i;
+
+	size = sizeof( *header ) + ( s_shaderIndex.numFiles * 3 + s_shaderIndex.numEntries * 4 ) * 4
+		+ s_shaderIndex.namesSize;
+	header = ri.Malloc( size );
+
+	header->ident = LittleLong( SHADERINDEX_IDENT );
+	header->version = LittleLong( SHADERINDEX_VERSION );
+	header->key = LittleLong( s_shaderIndex.key );
+	header->numFiles = LittleLong( s_shaderIndex.numFiles );
+	header->numEntries = LittleLong( s_shaderIndex.numEntries );
+	header->namesSize = LittleLong( s_shaderIndex.namesSize );
+
+	data = (int *)( header + 1 );
+	for ( i = 0; i < s_shaderIndex.numFiles; i++ ) {
+		*data++ = LittleLong( s_shaderIndex.files[i].name );
+		*data++ = LittleLong( s_shaderIndex.files[i].length );
+		*data++ = LittleLong( s_shaderIndex.files[i].textLength );
+	}
+	for ( i = 0; i < s_shaderIndex.numEntries; i++ ) {
+		*data++ = LittleLong( s_shaderIndex.entries[i].name );
+		*data++ = LittleLong( s_shaderIndex.entries[i].file );
+		*data++ = LittleLong( s_shaderIndex.entries[i].offset );
+		*data++ = LittleLong( s_shaderIndex.entries[i].length );
+	}
+	Com_Memcpy( data, s_shaderIndex.names, s_shaderIndex.namesSize );
+
+	ri.FS_WriteFile( SHADERINDEX_FILE, header, size );
+	ri.Free( header );
+}
+
 /*
 ====================
 ScanAndLoadShaderFiles
 
-Finds and loads all .shader files, combining them into
-a single large text block that can be scanned for shader names
+Finds and loads all .shader files, indexing the shader names in them
 =====================
 */
 #define	MAX_SHADER_FILES	4096
-static void ScanAndLoadShaderFiles( void )
+static void ScanAndLoadShaderFiles( char **shaderFiles, const int *lengths, int numShaderFiles )
 {
-	char **shaderFiles;
 	char *buffers[MAX_SHADER_FILES];
 	char *p;
-	int numShaderFiles;
 	int i;
-	char *oldp, *token, *hashMem, *textEnd;
-	int shaderTextHashTableSizes[MAX_SHADERTEXT_HASH], hash, size;
-
-	long sum = 0, summand;
-	// scan for shader files
-	shaderFiles = ri.FS_ListFiles( "scripts", ".shader", &numShaderFiles );
-
-	if ( !shaderFiles || !numShaderFiles )
-	{
-		ri.Printf( PRINT_WARNING, "WARNING: no shader files found\n" );
-		return;
-	}
-
-	if ( numShaderFiles > MAX_SHADER_FILES ) {
-		numShaderFiles = MAX_SHADER_FILES;
-	}
+	char *oldp, *token, *text;
+	char name[MAX_TOKEN_CHARS];
+	int numEntries, namesSize;
 
 	// load and parse shader files
 	for ( i = 0; i < numShaderFiles; i++ )
@@ -3923,22 +4220,22 @@ static void ScanAndLoadShaderFiles( void )
 
 		Com_sprintf( filename, sizeof( filename ), "scripts/%s", shaderFiles[i] );
 		ri.Printf( PRINT_DEVELOPER, "...loading '%s'\n", filename );
-		summand = ri.FS_ReadFile( filename, (void **)&buffers[i] );
-		
+		ri.FS_ReadFile( filename, (void **)&buffers[i] );
+
 		if ( !buffers[i] )
 			ri.Error( ERR_DROP, "Couldn't load %s", filename );
-		
+
 		// Do a simple check on the shader structure in that file to make sure one bad shader file cannot fuck up all other shaders.
 		p = buffers[i];
 		while(1)
 		{
 			token = COM_ParseExt(&p, qtrue);
-			
+
 			if(!*token)
 				break;
-			
+
 			oldp = p;
-			
+
 			token = COM_ParseExt(&p, qtrue);
 			if(token[0] != '{' && token[1] != '\0')
 			{
@@ -3951,79 +4248,127 @@ static void ScanAndLoadShaderFiles( void )
 			SkipBracedSection(&oldp);
 			p = oldp;
 		}
-			
-		
-		if (buffers[i])
-			sum += summand;		
 	}
 
-	// build single large buffer
-	s_shaderText = ri.Hunk_Alloc( sum + numShaderFiles*2, h_low );
-	s_shaderText[ 0 ] = '\0';
-	textEnd = s_shaderText;
- 
-	// free in reverse order, so the temp files are all dumped
-	for ( i = numShaderFiles - 1; i >= 0 ; i-- )
+	// size the index
+	numEntries = 0;
+	namesSize = 0;
+	for ( i = 0; i < numShaderFiles; i++ )
 	{
+		namesSize += strlen( shaderFiles[i] ) + 1;
+
 		if ( !buffers[i] )
 			continue;
 
-		strcat( textEnd, buffers[i] );
-		strcat( textEnd, "\n" );
-		textEnd += strlen( textEnd );
-		ri.FS_FreeFile( buffers[i] );
+		COM_Compress( buffers[i] );
+
+		p = buffers[i];
+		while ( 1 ) {
+			token = COM_ParseExt( &p, qtrue );
+			if ( token[0] == 0 ) {
+				break;
+			}
+
+			numEntries++;
+			namesSize += strlen( token ) + 1;
+			SkipBracedSection( &p );
+		}
 	}
 
-	COM_Compress( s_shaderText );
+	s_shaderIndex.numFiles = numShaderFiles;
+	s_shaderIndex.files = ri.Hunk_Alloc( numShaderFiles * sizeof( shaderTextFile_t ), h_low );
+	s_shaderIndex.entries = ri.Hunk_Alloc( ( numEntries + 1 ) * sizeof( shaderTextEntry_t ), h_low );
+	s_shaderIndex.names = ri.Hunk_Alloc( namesSize, h_low );
+	for ( i = 0; i < MAX_SHADERTEXT_HASH; i++ ) {
+		s_shaderIndex.hashTable[i] = -1;
+	}
 
-	// free up memory
-	ri.FS_FreeFileList( shaderFiles );
+	for ( i = 0; i < numShaderFiles; i++ )
+	{
+		s_shaderIndex.files[i].name = s_shaderIndex.namesSize;
+		s_shaderIndex.files[i].length = lengths[i];
+		strcpy( s_shaderIndex.names + s_shaderIndex.namesSize, shaderFiles[i] );
+		s_shaderIndex.namesSize += strlen( shaderFiles[i] ) + 1;
+	}
 
-	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
-	size = 0;
+	// later files go first, as they did when all the files were
+	// concatenated in reverse order, and free in reverse order,
+	// so the temp files are all dumped
+	for ( i = numShaderFiles - 1; i >= 0 ; i-- )
+	{
+		if ( !buffers[i] )
+			continue;
 
-	p = s_shaderText;
-	// look for shader names
-	while ( 1 ) {
-		token = COM_ParseExt( &p, qtrue );
-		if ( token[0] == 0 ) {
-			break;
-		}
+		s_shaderIndex.files[i].textLength = strlen( buffers[i] );
+		text = ri.Hunk_Alloc( s_shaderIndex.files[i].textLength + 1, h_low );
+		strcpy( text, buffers[i] );
+		s_shaderIndex.files[i].text = text;
+		ri.FS_FreeFile( buffers[i] );
 
-		hash = generateHashValue(token, MAX_SHADERTEXT_HASH);
-		shaderTextHashTableSizes[hash]++;
-		size++;
-		SkipBracedSection(&p);
+		p = text;
+		// look for shader names
+		while ( 1 ) {
+			oldp = p;
+			token = COM_ParseExt( &p, qtrue );
+			if ( token[0] == 0 ) {
+				break;
+			}
+			Q_strncpyz( name, token, sizeof( name ) );
+
+			SkipBracedSection( &p );
+			AddShaderIndexEntry( name, i, oldp - text, p - oldp );
+		}
 	}
+}
 
-	size += MAX_SHADERTEXT_HASH;
+/*
+====================
+BuildShaderIndex
+=====================
+*/
+static void BuildShaderIndex( qboolean useCache )
+{
+	char **shaderFiles;
+	int lengths[MAX_SHADER_FILES];
+	int numShaderFiles;
+	int i;
+	int start;
 
-	hashMem = ri.Hunk_Alloc( size * sizeof(char *), h_low );
+	start = ri.Milliseconds();
 
-	for (i = 0; i < MAX_SHADERTEXT_HASH; i++) {
-		shaderTextHashTable[i] = (char **) hashMem;
-		hashMem = ((char *) hashMem) + ((shaderTextHashTableSizes[i] + 1) * sizeof(char *));
+	Com_Memset( &s_shaderIndex, 0, sizeof( s_shaderIndex ) );
+
+	// scan for shader files
+	shaderFiles = ri.FS_ListFiles( "scripts", ".shader", &numShaderFiles );
+
+	if ( !shaderFiles || !numShaderFiles )
+	{
+		ri.Printf( PRINT_WARNING, "WARNING: no shader files found\n" );
+		return;
 	}
 
-	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
+	if ( numShaderFiles > MAX_SHADER_FILES ) {
+		numShaderFiles = MAX_SHADER_FILES;
+	}
 
-	p = s_shaderText;
-	// look for shader names
-	while ( 1 ) {
-		oldp = p;
-		token = COM_ParseExt( &p, qtrue );
-		if ( token[0] == 0 ) {
-			break;
-		}
+	for ( i = 0; i < numShaderFiles; i++ )
+	{
+		lengths[i] = ri.FS_ReadFile( va( "scripts/%s", shaderFiles[i] ), NULL );
+	}
 
-		hash = generateHashValue(token, MAX_SHADERTEXT_HASH);
-		shaderTextHashTable[hash][shaderTextHashTableSizes[hash]++] = oldp;
+	s_shaderIndex.key = ShaderIndexKey( shaderFiles, lengths, numShaderFiles );
 
-		SkipBracedSection(&p);
+	if ( useCache && LoadShaderIndex( shaderFiles, lengths, numShaderFiles ) ) {
+		s_shaderIndex.cached = qtrue;
+	} else {
+		ScanAndLoadShaderFiles( shaderFiles, lengths, numShaderFiles );
+		SaveShaderIndex();
 	}
 
-	return;
+	// free up memory
+	ri.FS_FreeFileList( shaderFiles );
 
+	s_shaderIndex.buildMsec = ri.Milliseconds() - start;
 }
 
 
@@ -4085,7 +4430,7 @@ void R_InitShaders( void ) {
 
 	CreateInternalShaders();
 
-	ScanAndLoadShaderFiles();
+	BuildShaderIndex( qtrue );
 
 	CreateExternalShaders();
 }
@@ -611,7 +611,7 @@ static void VectorArrayNormalize(vec4_t *normals, unsigned int count)
 ** LerpMeshVertexes
 */
 #if idppc_altivec
-static void LerpMeshVertexes_altivec(md3Surface_t *surf, float backlerp)
+static void LerpMeshVertexes_altivec(md3Surface_t *surf, trRefEntity_t *ent, float backlerp, vec4_t *xyz, vec4_t *normal)
 {
 	short	*oldXyz, *newXyz, *oldNormals, *newNormals;
 	float	*outXyz, *outNormal;
@@ -623,11 +623,11 @@ static void LerpMeshVertexes_altivec(md3Surface_t *surf, float backlerp)
 	unsigned lat, lng;
 	int		numVerts;
 
-	outXyz = tess.xyz[tess.numVertexes];
-	outNormal = tess.normal[tess.numVertexes];
+	outXyz = xyz[0];
+	outNormal = normal[0];
 
 	newXyz = (short *)((byte *)surf + surf->ofsXyzNormals)
-		+ (backEnd.currentEntity->e.frame * surf->numVerts * 4);
+		+ (ent->e.frame * surf->numVerts * 4);
 	newNormals = newXyz + 3;
 
 	newXyzScale = MD3_XYZ_SCALE * (1.0 - backlerp);
@@ -694,7 +694,7 @@ static void LerpMeshVertexes_altivec(md3Surface_t *surf, float backlerp)
 		// interpolate and copy the vertex and normal
 		//
 		oldXyz = (short *)((byte *)surf + surf->ofsXyzNormals)
-			+ (backEnd.currentEntity->e.oldframe * surf->numVerts * 4);
+			+ (ent->e.oldframe * surf->numVerts * 4);
 		oldNormals = oldXyz + 3;
 
 		oldXyzScale = MD3_XYZ_SCALE * backlerp;
@@ -735,12 +735,12 @@ static void LerpMeshVertexes_altivec(md3Surface_t *surf, float backlerp)
 
 //			VectorNormalize (outNormal);
 		}
-    	VectorArrayNormalize((vec4_t *)tess.normal[tess.numVertexes], numVerts);
+    	VectorArrayNormalize(normal, numVerts);
    	}
 }
 #endif
 
-static void LerpMeshVertexes_scalar(md3Surface_t *surf, float backlerp)
+static void LerpMeshVertexes_scalar(md3Surface_t *surf, trRefEntity_t *ent, float backlerp, vec4_t *xyz, vec4_t *normal)
 {
 	short	*oldXyz, *newXyz, *oldNormals, *newNormals;
 	float	*outXyz, *outNormal;
@@ -750,11 +750,11 @@ static void LerpMeshVertexes_scalar(md3Surface_t *surf, float backlerp)
 	unsigned lat, lng;
 	int		numVerts;
 
-	outXyz = tess.xyz[tess.numVertexes];
-	outNormal = tess.normal[tess.numVertexes];
+	outXyz = xyz[0];
+	outNormal = normal[0];
 
 	newXyz = (short *)((byte *)surf + surf->ofsXyzNormals)
-		+ (backEnd.currentEntity->e.frame * surf->numVerts * 4);
+		+ (ent->e.frame * surf->numVerts * 4);
 	newNormals = newXyz + 3;
 
 	newXyzScale = MD3_XYZ_SCALE * (1.0 - backlerp);
@@ -793,7 +793,7 @@ static void LerpMeshVertexes_scalar(md3Surface_t *surf, float backlerp)
 		// interpolate and copy the vertex and normal
 		//
 		oldXyz = (short *)((byte *)surf + surf->ofsXyzNormals)
-			+ (backEnd.currentEntity->e.oldframe * surf->numVerts * 4);
+			+ (ent->e.oldframe * surf->numVerts * 4);
 		oldNormals = oldXyz + 3;
 
 		oldXyzScale = MD3_XYZ_SCALE * backlerp;
@@ -834,20 +834,183 @@ static void LerpMeshVertexes_scalar(md3Surface_t *surf, float backlerp)
 
 //			VectorNormalize (outNormal);
 		}
-    	VectorArrayNormalize((vec4_t *)tess.normal[tess.numVertexes], numVerts);
+    	VectorArrayNormalize(normal, numVerts);
    	}
 }
 
-static void LerpMeshVertexes(md3Surface_t *surf, float backlerp)
+static void LerpMeshVertexes(md3Surface_t *surf, trRefEntity_t *ent, vec4_t *xyz, vec4_t *normal)
 {
+	float	backlerp;
+
+	if ( ent->e.oldframe == ent->e.frame ) {
+		backlerp = 0;
+	} else  {
+		backlerp = ent->e.backlerp;
+	}
+
 #if idppc_altivec
 	if (com_altivec->integer) {
 		// must be in a seperate function or G3 systems will crash.
-		LerpMeshVertexes_altivec( surf, backlerp );
+		LerpMeshVertexes_altivec( surf, ent, backlerp, xyz, normal );
 		return;
 	}
 #endif // idppc_altivec
-	LerpMeshVertexes_scalar( surf, backlerp );
+	LerpMeshVertexes_scalar( surf, ent, backlerp, xyz, normal );
+}
+
+
+/*
+=============================================================
+
+ANIMATED SURFACE JOBS
+
+Every view's animated surfaces are queued when its draw surface
+command is added, and skinned in one go on the job threads when
+the commands are issued, so an r_smp render thread still busy with
+the last frame runs alongside. Every surface writes only its own
+vertex range, so the jobs can run in any order. The back end then
+only copies the results into tess. The same code runs as in the
+serial path, so the vertexes come out identical.
+
+=============================================================
+*/
+
+/*
+=============
+R_AddAnimatedSurfaces
+=============
+*/
+void R_AddAnimatedSurfaces( drawSurf_t *drawSurfs, int numDrawSurfs ) {
+	backEndData_t	*data;
+	animSurf_t		*anim;
+	trRefEntity_t	*ent;
+	shader_t		*shader;
+	float			*jointMats;
+	int				entityNum, fogNum, dlighted;
+	int				numVerts;
+	int				i, a;
+
+	data = backEndData[tr.smpFrame];
+	if ( !data->animXyz ) {
+		return;
+	}
+
+	for ( i = 0 ; i < numDrawSurfs ; i++, drawSurfs++ ) {
+		if ( *drawSurfs->surface == SF_MD3 ) {
+			numVerts = ((md3Surface_t *)drawSurfs->surface)->numVerts;
+		} else if ( *drawSurfs->surface == SF_IQM ) {
+			numVerts = ((srfIQModel_t *)drawSurfs->surface)->num_vertexes;
+		} else {
+			continue;
+		}
+
+		R_DecomposeSort( drawSurfs->sort, &entityNum, &shader, &fogNum, &dlighted );
+		if ( entityNum == ENTITYNUM_WORLD ) {
+			continue;
+		}
+		ent = &tr.refdef.entities[entityNum];
+
+		// shadows and other views draw the same vertexes
+		for ( a = ent->animSurfs ; a ; a = data->animSurfs[a - 1].next ) {
+			if ( data->animSurfs[a - 1].surface == drawSurfs->surface ) {
+				break;
+			}
+		}
+		if ( a ) {
+			continue;
+		}
+
+		// out of room, leave it to the back end
+		if ( data->numAnimSurfs == MAX_ANIMSURFS
+			|| data->numAnimVertexes + numVerts > MAX_ANIMVERTEXES ) {
+			continue;
+		}
+
+		// the jobs only read the shared joint matrices
+		jointMats = NULL;
+		if ( *drawSurfs->surface == SF_IQM ) {
+			jointMats = R_IQMEntityPose( ((srfIQModel_t *)drawSurfs->surface)->data, ent );
+			if ( !jointMats ) {
+				continue;
+			}
+		}
+
+		anim = &data->animSurfs[data->numAnimSurfs++];
+		anim->surface = drawSurfs->surface;
+		anim->jointMats = jointMats;
+		anim->entity = ent;
+		anim->firstVertex = data->numAnimVertexes;
+		anim->numVertexes = numVerts;
+		anim->next = ent->animSurfs;
+		ent->animSurfs = data->numAnimSurfs;
+
+		data->numAnimVertexes += numVerts;
+	}
+}
+
+/*
+=============
+R_AnimateSurfaceJob
+
+Skins one of the surfaces queued since the last R_AnimateSurfaces
+=============
+*/
+static void R_AnimateSurfaceJob( void *jobData, int index ) {
+	backEndData_t	*data = jobData;
+	animSurf_t		*anim;
+
+	anim = &data->animSurfs[data->numAnimSurfsDone + index];
+	if ( *anim->surface == SF_MD3 ) {
+		LerpMeshVertexes( (md3Surface_t *)anim->surface, anim->entity,
+			data->animXyz + anim->firstVertex, data->animNormal + anim->firstVertex );
+	} else {
+		R_IQMAnimateVertexes( (srfIQModel_t *)anim->surface, anim->jointMats,
+			data->animXyz + anim->firstVertex, data->animNormal + anim->firstVertex );
+	}
+}
+
+/*
+=============
+R_AnimateSurfaces
+
+Skins everything queued since the last call
+=============
+*/
+void R_AnimateSurfaces( void ) {
+	backEndData_t	*data;
+
+	data = backEndData[tr.smpFrame];
+	if ( data->numAnimSurfsDone == data->numAnimSurfs ) {
+		return;
+	}
+
+	ri.Job_ParallelFor( R_AnimateSurfaceJob, data, data->numAnimSurfs - data->numAnimSurfsDone, 0 );
+
+	data->numAnimSurfsDone = data->numAnimSurfs;
+}
+
+/*
+=============
+RB_FindAnimatedSurface
+
+Returns the skinned vertexes of the surface on the current
+entity, or NULL if it must be animated here
+=============
+*/
+animSurf_t *RB_FindAnimatedSurface( surfaceType_t *surface ) {
+	backEndData_t	*data;
+	int				a;
+
+	data = backEndData[backEnd.smpFrame];
+	for ( a = backEnd.currentEntity->animSurfs ; a ; a = data->animSurfs[a - 1].next ) {
+		if ( data->animSurfs[a - 1].surface == surface ) {
+			if ( a > data->numAnimSurfsDone || data->animSurfs[a - 1].entity != backEnd.currentEntity ) {
+				return NULL;
+			}
+			return &data->animSurfs[a - 1];
+		}
+	}
+	return NULL;
 }
 
 
@@ -858,22 +1021,27 @@ RB_SurfaceMesh
 */
 static void RB_SurfaceMesh(md3Surface_t *surface) {
 	int				j;
-	float			backlerp;
 	int				*triangles;
 	float			*texCoords;
 	int				indexes;
 	int				Bob, Doug;
 	int				numVerts;
-
-	if (  backEnd.currentEntity->e.oldframe == backEnd.currentEntity->e.frame ) {
-		backlerp = 0;
-	} else  {
-		backlerp = backEnd.currentEntity->e.backlerp;
-	}
+	animSurf_t		*anim;
 
 	RB_CHECKOVERFLOW( surface->numVerts, surface->numTriangles*3 );
 
-	LerpMeshVertexes (surface, backlerp);
+	anim = RB_FindAnimatedSurface( (surfaceType_t *)surface );
+	if ( anim ) {
+		vec4_t	*xyz = backEndData[backEnd.smpFrame]->animXyz + anim->firstVertex;
+		vec4_t	*normal = backEndData[backEnd.smpFrame]->animNormal + anim->firstVertex;
+
+		for ( j = 0 ; j < surface->numVerts ; j++ ) {
+			VectorCopy( xyz[j], tess.xyz[tess.numVertexes + j] );
+			VectorCopy( normal[j], tess.normal[tess.numVertexes + j] );
+		}
+	} else {
+		LerpMeshVertexes (surface, backEnd.currentEntity, tess.xyz + tess.numVertexes, tess.normal + tess.numVertexes);
+	}
 
 	triangles = (int *) ((byte *)surface + surface->ofsTriangles);
 	indexes = surface->numTriangles * 3;
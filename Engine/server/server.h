@@ -54,7 +54,6 @@ typedef struct svEntity_s {
 	int			clusternums[MAX_ENT_CLUSTERS];
 	int			lastCluster;		// if all the clusters don't fit in clusternums
 	int			areanum, areanum2;
-	int			snapshotCounter;	// used to prevent double adding from portal views
 } svEntity_t;
 
 typedef enum {
@@ -72,7 +71,6 @@ typedef struct {
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=475
 	// the serverId associated with the current checksumFeed (always <= serverId)
 	int       checksumFeedServerId;	
-	int				snapshotCounter;	// incremented for each snapshot built
 	int				timeResidual;		// <= 1000 / sv_frame->value
 	int				nextFrameTime;		// when time > nextFrameTime, process world
 	struct cmodel_s	*models[MAX_MODELS];
@@ -91,6 +89,9 @@ typedef struct {
 
 	int				restartTime;
 	int				time;
+
+	int				visCacheHits;		// snapshot viewpoints that shared another's visible entities
+	int				visCacheMisses;
 } server_t;
 
 
@@ -361,6 +362,7 @@ void SV_WriteFrameToClient (client_t *client, msg_t *msg);
 void SV_SendMessageToClient( msg_t *msg, client_t *client );
 void SV_SendClientMessages( void );
 void SV_SendClientSnapshot( client_t *client );
+void SV_SnapshotBench_f( void );
 
 //
 // sv_game.c
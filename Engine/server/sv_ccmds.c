@@ -993,6 +993,8 @@ static void SV_Status_f( void ) {
 		Com_Printf ("\n");
 	}
 	Com_Printf ("\n");
+
+	Com_Printf ("snapshot visibility cache: %i hits, %i misses\n", sv.visCacheHits, sv.visCacheMisses );
 }
 
 /*
@@ -1142,6 +1144,7 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_AddCommand ("dumpuser", SV_DumpUser_f);
 	Cmd_AddCommand ("map_restart", SV_MapRestart_f);
 	Cmd_AddCommand ("sectorlist", SV_SectorList_f);
+	Cmd_AddCommand ("snapbench", SV_SnapshotBench_f);
 	Cmd_AddCommand ("map", SV_Map_f);
 	Cmd_SetCommandCompletionFunc( "map", SV_CompleteMapName );
 #ifndef PRE_RELEASE_DEMO
@@ -1184,6 +1187,7 @@ void SV_RemoveOperatorCommands( void ) {
 	Cmd_RemoveCommand ("dumpuser");
 	Cmd_RemoveCommand ("map_restart");
 	Cmd_RemoveCommand ("sectorlist");
+	Cmd_RemoveCommand ("snapbench");
 	Cmd_RemoveCommand ("say");
 #endif
 }
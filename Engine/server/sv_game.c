@@ -412,6 +412,13 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
 		Q_SnapVector(VMA(1));
 		return 0;
 
+	case G_PARALLELFOR:
+		if ( !VM_IsNative( gvm ) ) {
+			return qfalse;
+		}
+		Job_ParallelFor( (jobFunc_t)args[1], VMA(2), args[3], args[4] );
+		return qtrue;
+
 		//====================================
 
 	case TRAP_MEMSET:
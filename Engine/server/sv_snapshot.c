@@ -117,9 +117,14 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 /*
 ==================
 SV_WriteSnapshotToClient
+
+snapshotEnd is svs.nextSnapshotEntities once every snapshot being built
+this frame has its entities, so a delta source that any of them may have
+overwritten is refused.  The reason is passed back in warning instead of
+printed, because this can run on a job thread.
 ==================
 */
-static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
+static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg, int snapshotEnd, const char **warning ) {
 	clientSnapshot_t	*frame, *oldframe;
 	int					lastframe;
 	int					i;
@@ -136,7 +141,7 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 	} else if ( client->netchan.outgoingSequence - client->deltaMessage 
 		>= (PACKET_BACKUP - 3) ) {
 		// client hasn't gotten a good message through in a long time
-		Com_DPrintf ("%s: Delta request from out of date packet.\n", client->name);
+		*warning = "Delta request from out of date packet";
 		oldframe = NULL;
 		lastframe = 0;
 	} else {
@@ -145,8 +150,8 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 		lastframe = client->netchan.outgoingSequence - client->deltaMessage;
 
 		// the snapshot's entities may still have rolled off the buffer, though
-		if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities ) {
-			Com_DPrintf ("%s: Delta request from out of date entities.\n", client->name);
+		if ( oldframe->first_entity <= snapshotEnd - svs.numSnapshotEntities ) {
+			*warning = "Delta request from out of date entities";
 			oldframe = NULL;
 			lastframe = 0;
 		}
@@ -237,85 +242,59 @@ Build a client snapshot structure
 
 #define	MAX_SNAPSHOT_ENTITIES	1024
 typedef struct {
-	int		numSnapshotEntities;
-	int		snapshotEntities[MAX_SNAPSHOT_ENTITIES];	
+	int			numSnapshotEntities;
+	int			snapshotEntities[MAX_SNAPSHOT_ENTITIES];	
+	byte		added[MAX_GENTITIES/8];		// prevents double adding from portal views
+	const char	*error;						// raised once the snapshot is back on the main thread
 } snapshotEntityNumbers_t;
 
 /*
-=======================
-SV_QsortEntityNumbers
-=======================
+===============
+SV_AddEntToSnapshot
+===============
 */
-static int QDECL SV_QsortEntityNumbers( const void *a, const void *b ) {
-	int	*ea, *eb;
-
-	ea = (int *)a;
-	eb = (int *)b;
-
-	if ( *ea == *eb ) {
-		Com_Error( ERR_DROP, "SV_QsortEntityStates: duplicated entity" );
-	}
-
-	if ( *ea < *eb ) {
-		return -1;
-	}
-
-	return 1;
+static void SV_AddEntToSnapshot( int entityNum, snapshotEntityNumbers_t *eNums ) {
+	eNums->added[ entityNum >> 3 ] |= 1 << ( entityNum & 7 );
 }
 
-
 /*
-===============
-SV_AddEntToSnapshot
-===============
+=============================================================================
+
+Clients standing in the same cluster and area see the same entities, up
+to the per-client flags, so the set is worked out once per viewpoint each
+time snapshots are built.  The cache is filled on the main thread before
+the snapshot jobs run and is only read by them.
+
+=============================================================================
 */
-static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
-	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
-		return;
-	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
 
-	// if we are full, silently discard entities
-	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES ) {
-		return;
-	}
+typedef struct {
+	int		cluster;
+	int		area;
+	byte	entities[MAX_GENTITIES/8];
+} svVisibility_t;
 
-	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = gEnt->s.number;
-	eNums->numSnapshotEntities++;
-}
+static svVisibility_t	svVisibility[MAX_CLIENTS];
+static int				svNumVisibility;
 
 /*
 ===============
-SV_AddEntitiesVisibleFromPoint
+SV_VisibleEntities
+
+Marks the entities that can be seen from the cluster and area, before
+any of the per-client flags are applied.
 ===============
 */
-static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *frame, 
-									snapshotEntityNumbers_t *eNums, qboolean portal ) {
+static void SV_VisibleEntities( int clientcluster, int clientarea, byte *entities ) {
 	int		e, i;
 	sharedEntity_t *ent;
 	svEntity_t	*svEnt;
 	int		l;
-	int		clientarea, clientcluster;
-	int		leafnum;
-	byte	*clientpvs;
 	byte	*bitvector;
 
-	// during an error shutdown message we may need to transmit
-	// the shutdown message after the server has shutdown, so
-	// specfically check for it
-	if ( !sv.state ) {
-		return;
-	}
+	Com_Memset( entities, 0, MAX_GENTITIES/8 );
 
-	leafnum = CM_PointLeafnum (origin);
-	clientarea = CM_LeafArea (leafnum);
-	clientcluster = CM_LeafCluster (leafnum);
-
-	// calculate the visible areas
-	frame->areabytes = CM_WriteAreaBits( frame->areabits, clientarea );
-
-	clientpvs = CM_ClusterPVS (clientcluster);
+	bitvector = CM_ClusterPVS (clientcluster);
 
 	for ( e = 0 ; e < sv.num_entities ; e++ ) {
 		ent = SV_GentityNum(e);
@@ -325,49 +304,19 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 			continue;
 		}
 
-		if (ent->s.number != e) {
-			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
-		}
-
 		// entities can be flagged to explicitly not be sent to the client
 		if ( ent->r.svFlags & SVF_NOCLIENT ) {
 			continue;
 		}
 
-		// entities can be flagged to be sent to only one client
-		if ( ent->r.svFlags & SVF_SINGLECLIENT ) {
-			if ( ent->r.singleClient != frame->ps.clientNum ) {
-				continue;
-			}
-		}
-		// entities can be flagged to be sent to everyone but one client
-		if ( ent->r.svFlags & SVF_NOTSINGLECLIENT ) {
-			if ( ent->r.singleClient == frame->ps.clientNum ) {
-				continue;
-			}
-		}
-		// entities can be flagged to be sent to a given mask of clients
-		if ( ent->r.svFlags & SVF_CLIENTMASK ) {
-			if (frame->ps.clientNum >= 32)
-				Com_Error( ERR_DROP, "SVF_CLIENTMASK: clientNum >= 32" );
-			if (~ent->r.singleClient & (1 << frame->ps.clientNum))
-				continue;
-		}
-
-		svEnt = SV_SvEntityForGentity( ent );
-
-		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
-			continue;
-		}
-
 		// broadcast entities are always sent
 		if ( ent->r.svFlags & SVF_BROADCAST ) {
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+			entities[ e >> 3 ] |= 1 << ( e & 7 );
 			continue;
 		}
 
+		svEnt = SV_SvEntityForGentity( ent );
+
 		// ignore if not touching a PV leaf
 		// check area
 		if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
@@ -378,8 +327,6 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 			}
 		}
 
-		bitvector = clientpvs;
-
 		// check individual leafs
 		if ( !svEnt->numClusters ) {
 			continue;
@@ -409,21 +356,185 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 			}
 		}
 
-		// add it
-		SV_AddEntToSnapshot( svEnt, ent, eNums );
+		entities[ e >> 3 ] |= 1 << ( e & 7 );
+	}
+}
+
+/*
+===============
+SV_FindVisibility
+===============
+*/
+static svVisibility_t *SV_FindVisibility( int cluster, int area ) {
+	int		i;
+
+	for ( i = 0 ; i < svNumVisibility ; i++ ) {
+		if ( svVisibility[i].cluster == cluster && svVisibility[i].area == area ) {
+			return &svVisibility[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+===============
+SV_CacheClientVisibility
+
+Main thread only.
+===============
+*/
+static void SV_CacheClientVisibility( client_t *client ) {
+	playerState_t	*ps;
+	vec3_t			org;
+	int				leafnum, cluster, area;
+	svVisibility_t	*vis;
+
+	if ( !sv.state || !client->gentity || client->state == CS_ZOMBIE ) {
+		return;
+	}
+
+	ps = SV_GameClientNum( client - svs.clients );
+	VectorCopy( ps->origin, org );
+	org[2] += ps->viewheight;
 
-		// if it's a portal entity, add everything visible from its camera position
-		if ( ent->r.svFlags & SVF_PORTAL ) {
-			if ( ent->s.generic1 ) {
-				vec3_t dir;
-				VectorSubtract(ent->s.origin, origin, dir);
-				if ( VectorLengthSquared(dir) > (float) ent->s.generic1 * ent->s.generic1 ) {
+	leafnum = CM_PointLeafnum (org);
+	cluster = CM_LeafCluster (leafnum);
+	area = CM_LeafArea (leafnum);
+
+	if ( SV_FindVisibility( cluster, area ) ) {
+		sv.visCacheHits++;
+		return;
+	}
+
+	if ( svNumVisibility == MAX_CLIENTS ) {
+		return;
+	}
+	sv.visCacheMisses++;
+
+	vis = &svVisibility[svNumVisibility++];
+	vis->cluster = cluster;
+	vis->area = area;
+	SV_VisibleEntities( cluster, area, vis->entities );
+}
+
+/*
+===============
+SV_AddEntitiesVisibleFromPoint
+===============
+*/
+static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *frame, 
+									snapshotEntityNumbers_t *eNums, qboolean portal ) {
+	int		e, i;
+	sharedEntity_t *ent;
+	int		clientarea, clientcluster;
+	int		leafnum;
+	svVisibility_t	*vis;
+	byte	portalEntities[MAX_GENTITIES/8];
+	byte	*entities;
+
+	// during an error shutdown message we may need to transmit
+	// the shutdown message after the server has shutdown, so
+	// specfically check for it
+	if ( !sv.state ) {
+		return;
+	}
+
+	leafnum = CM_PointLeafnum (origin);
+	clientarea = CM_LeafArea (leafnum);
+	clientcluster = CM_LeafCluster (leafnum);
+
+	// calculate the visible areas
+	frame->areabytes = CM_WriteAreaBits( frame->areabits, clientarea );
+
+	// portal cameras are rarely shared, so they aren't cached
+	vis = SV_FindVisibility( clientcluster, clientarea );
+	if ( vis ) {
+		entities = vis->entities;
+	} else {
+		SV_VisibleEntities( clientcluster, clientarea, portalEntities );
+		entities = portalEntities;
+	}
+
+	for ( i = 0 ; i < MAX_GENTITIES/8 ; i++ ) {
+		if ( !entities[i] ) {
+			continue;
+		}
+
+		for ( e = i * 8 ; e < i * 8 + 8 ; e++ ) {
+			if ( !( entities[i] & ( 1 << ( e & 7 ) ) ) ) {
+				continue;
+			}
+
+			ent = SV_GentityNum(e);
+
+			// entities can be flagged to be sent to only one client
+			if ( ent->r.svFlags & SVF_SINGLECLIENT ) {
+				if ( ent->r.singleClient != frame->ps.clientNum ) {
 					continue;
 				}
 			}
-			SV_AddEntitiesVisibleFromPoint( ent->s.origin2, frame, eNums, qtrue );
+			// entities can be flagged to be sent to everyone but one client
+			if ( ent->r.svFlags & SVF_NOTSINGLECLIENT ) {
+				if ( ent->r.singleClient == frame->ps.clientNum ) {
+					continue;
+				}
+			}
+			// entities can be flagged to be sent to a given mask of clients
+			if ( ent->r.svFlags & SVF_CLIENTMASK ) {
+				if (frame->ps.clientNum >= 32) {
+					eNums->error = "SVF_CLIENTMASK: clientNum >= 32";
+					continue;
+				}
+				if (~ent->r.singleClient & (1 << frame->ps.clientNum))
+					continue;
+			}
+
+			// don't double add an entity through portals
+			if ( eNums->added[i] & ( 1 << ( e & 7 ) ) ) {
+				continue;
+			}
+
+			// add it
+			SV_AddEntToSnapshot( e, eNums );
+
+			// if it's a portal entity, add everything visible from its camera position
+			if ( ( ent->r.svFlags & SVF_PORTAL ) && !( ent->r.svFlags & SVF_BROADCAST ) ) {
+				if ( ent->s.generic1 ) {
+					vec3_t dir;
+					VectorSubtract(ent->s.origin, origin, dir);
+					if ( VectorLengthSquared(dir) > (float) ent->s.generic1 * ent->s.generic1 ) {
+						continue;
+					}
+				}
+				SV_AddEntitiesVisibleFromPoint( ent->s.origin2, frame, eNums, qtrue );
+			}
 		}
+	}
+}
 
+/*
+=============
+SV_CheckEntityNumbers
+
+Done once before the snapshots are built, so the builders only read the
+game entities.
+=============
+*/
+static void SV_CheckEntityNumbers( void ) {
+	int				e;
+	sharedEntity_t	*ent;
+
+	if ( !sv.state ) {
+		return;
+	}
+
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		ent = SV_GentityNum(e);
+		if ( ent->r.linked && ent->s.number != e ) {
+			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = e;
+		}
 	}
 }
 
@@ -432,7 +543,10 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 SV_BuildClientSnapshot
 
 Decides which entities are going to be visible to the client, and
-copies off the playerstate and areabits.
+copies off the playerstate and areabits.  Nothing shared is written, so
+this can run on a job thread; the entity states are copied out by
+SV_CopySnapshotEntities once the frame has its place in
+svs.snapshotEntities.  Returns qfalse if the client has nothing to see.
 
 This properly handles multiple recursive portals, but the render
 currently doesn't.
@@ -440,26 +554,21 @@ currently doesn't.
 For viewing through other player's eyes, clent can be something other than client->gentity
 =============
 */
-static void SV_BuildClientSnapshot( client_t *client ) {
+static qboolean SV_BuildClientSnapshot( client_t *client, snapshotEntityNumbers_t *eNums ) {
 	vec3_t						org;
 	clientSnapshot_t			*frame;
-	snapshotEntityNumbers_t		entityNumbers;
-	int							i;
-	sharedEntity_t				*ent;
-	entityState_t				*state;
-	svEntity_t					*svEnt;
+	int							i, e;
 	sharedEntity_t				*clent;
 	int							clientNum;
 	playerState_t				*ps;
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
-
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	eNums->numSnapshotEntities = 0;
+	eNums->error = NULL;
+	Com_Memset( eNums->added, 0, sizeof( eNums->added ) );
 	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
   // https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=62
@@ -467,7 +576,7 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	
 	clent = client->gentity;
 	if ( !clent || client->state == CS_ZOMBIE ) {
-		return;
+		return qfalse;
 	}
 
 	// grab the current playerState_t
@@ -478,11 +587,10 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	// be regenerated from the playerstate
 	clientNum = frame->ps.clientNum;
 	if ( clientNum < 0 || clientNum >= MAX_GENTITIES ) {
-		Com_Error( ERR_DROP, "SV_SvEntityForGentity: bad gEnt" );
+		eNums->error = "SV_SvEntityForGentity: bad gEnt";
+		return qfalse;
 	}
-	svEnt = &sv.svEntities[ clientNum ];
-
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	SV_AddEntToSnapshot( clientNum, eNums );
 
 	// find the client's viewpoint
 	VectorCopy( ps->origin, org );
@@ -490,14 +598,23 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse );
+	SV_AddEntitiesVisibleFromPoint( org, frame, eNums, qfalse );
 
-	// if there were portals visible, there may be out of order entities
-	// in the list which will need to be resorted for the delta compression
-	// to work correctly.  This also catches the error condition
-	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities, 
-		sizeof( entityNumbers.snapshotEntities[0] ), SV_QsortEntityNumbers );
+	eNums->added[ clientNum >> 3 ] &= ~( 1 << ( clientNum & 7 ) );
+
+	// if there were portals visible, entities were found out of order,
+	// but walking the added bits gives the sorted list the delta
+	// compression needs, with no entity included twice
+	for ( i = 0 ; i < MAX_GENTITIES/8 ; i++ ) {
+		if ( !eNums->added[i] ) {
+			continue;
+		}
+		for ( e = i * 8 ; e < i * 8 + 8 ; e++ ) {
+			if ( eNums->added[i] & ( 1 << ( e & 7 ) ) ) {
+				eNums->snapshotEntities[ eNums->numSnapshotEntities++ ] = e;
+			}
+		}
+	}
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
@@ -505,20 +622,40 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
 	}
 
-	// copy the entity states out
-	frame->num_entities = 0;
+	return qtrue;
+}
+
+/*
+=============
+SV_AllocSnapshotEntities
+
+Gives the frame its place in svs.snapshotEntities.  Always done on the
+main thread, in client order.
+=============
+*/
+static void SV_AllocSnapshotEntities( clientSnapshot_t *frame, int numEntities ) {
 	frame->first_entity = svs.nextSnapshotEntities;
-	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ ) {
-		ent = SV_GentityNum(entityNumbers.snapshotEntities[i]);
-		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
-		*state = ent->s;
-		svs.nextSnapshotEntities++;
-		// this should never hit, map should always be restarted first in SV_Frame
-		if ( svs.nextSnapshotEntities >= 0x7FFFFFFE ) {
-			Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
-		}
-		frame->num_entities++;
+	svs.nextSnapshotEntities += numEntities;
+	// this should never hit, map should always be restarted first in SV_Frame
+	if ( svs.nextSnapshotEntities >= 0x7FFFFFFE ) {
+		Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
+	}
+}
+
+/*
+=============
+SV_CopySnapshotEntities
+=============
+*/
+static void SV_CopySnapshotEntities( clientSnapshot_t *frame, const snapshotEntityNumbers_t *eNums ) {
+	int				i;
+	sharedEntity_t	*ent;
+
+	for ( i = 0 ; i < eNums->numSnapshotEntities ; i++ ) {
+		ent = SV_GentityNum(eNums->snapshotEntities[i]);
+		svs.snapshotEntities[(frame->first_entity + i) % svs.numSnapshotEntities] = ent->s;
 	}
+	frame->num_entities = eNums->numSnapshotEntities;
 }
 
 #ifdef USE_VOIP
@@ -588,45 +725,159 @@ void SV_SendMessageToClient(msg_t *msg, client_t *client)
 
 
 /*
-=======================
-SV_SendClientSnapshot
+=============================================================================
 
-Also called by SV_FinalMessage
+Snapshots for several clients are built and encoded as jobs: each job
+only writes its own client's frame and message.  Between the two passes
+the frames get their places in svs.snapshotEntities in client order, and
+afterwards the messages are finished and sent in client order on the
+main thread.
+
+=============================================================================
+*/
+
+typedef struct {
+	client_t				*client;
+	qboolean				built;
+	snapshotEntityNumbers_t	entityNumbers;
+	const char				*warning;
+	msg_t					msg;
+	byte					msgBuffer[MAX_MSGLEN];
+} snapshotJob_t;
 
+static snapshotJob_t	svSnapshotJobs[MAX_CLIENTS];
+static int				svSnapshotEnd;		// svs.nextSnapshotEntities after this frame's snapshots
+
+/*
+=======================
+SV_BuildSnapshotJob
 =======================
 */
-void SV_SendClientSnapshot( client_t *client ) {
-	byte		msg_buf[MAX_MSGLEN];
-	msg_t		msg;
+static void SV_BuildSnapshotJob( void *data, int index ) {
+	snapshotJob_t	*job = (snapshotJob_t *)data + index;
+
+	job->built = SV_BuildClientSnapshot( job->client, &job->entityNumbers );
+}
 
-	// build the snapshot
-	SV_BuildClientSnapshot( client );
+/*
+=======================
+SV_WriteSnapshotJob
+=======================
+*/
+static void SV_WriteSnapshotJob( void *data, int index ) {
+	snapshotJob_t	*job = (snapshotJob_t *)data + index;
+	client_t		*client = job->client;
 
-	MSG_Init (&msg, msg_buf, sizeof(msg_buf));
-	msg.allowoverflow = qtrue;
+	if ( job->built ) {
+		SV_CopySnapshotEntities( &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ],
+			&job->entityNumbers );
+	}
 
 	// NOTE, MRE: all server->client messages now acknowledge
 	// let the client know which reliable clientCommands we have received
-	MSG_WriteLong( &msg, client->lastClientCommand );
+	MSG_WriteLong( &job->msg, client->lastClientCommand );
 
 	// (re)send any reliable server commands
-	SV_UpdateServerCommandsToClient( client, &msg );
+	SV_UpdateServerCommandsToClient( client, &job->msg );
 
 	// send over all the relevant entityState_t
 	// and the playerState_t
-	SV_WriteSnapshotToClient( client, &msg );
+	SV_WriteSnapshotToClient( client, &job->msg, svSnapshotEnd, &job->warning );
+}
+
+/*
+=======================
+SV_BuildSnapshots
+
+Builds and encodes the snapshots of all the jobs, on the job threads
+if parallel is set.
+=======================
+*/
+static void SV_BuildSnapshots( snapshotJob_t *jobs, int numJobs, qboolean parallel ) {
+	snapshotJob_t	*job;
+	client_t		*client;
+	int				i;
+
+	SV_CheckEntityNumbers();
+
+	svNumVisibility = 0;
+	for ( i = 0, job = jobs ; i < numJobs ; i++, job++ ) {
+		SV_CacheClientVisibility( job->client );
+		MSG_Init( &job->msg, job->msgBuffer, sizeof( job->msgBuffer ) );
+		job->msg.allowoverflow = qtrue;
+		job->warning = NULL;
+	}
+
+	if ( parallel ) {
+		Job_ParallelFor( SV_BuildSnapshotJob, jobs, numJobs, 1 );
+	} else {
+		for ( i = 0 ; i < numJobs ; i++ ) {
+			SV_BuildSnapshotJob( jobs, i );
+		}
+	}
+
+	for ( i = 0, job = jobs ; i < numJobs ; i++, job++ ) {
+		if ( job->entityNumbers.error ) {
+			Com_Error( ERR_DROP, "%s", job->entityNumbers.error );
+		}
+		if ( job->built ) {
+			client = job->client;
+			SV_AllocSnapshotEntities( &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ],
+				job->entityNumbers.numSnapshotEntities );
+		}
+	}
+	svSnapshotEnd = svs.nextSnapshotEntities;
+
+	if ( parallel ) {
+		Job_ParallelFor( SV_WriteSnapshotJob, jobs, numJobs, 1 );
+	} else {
+		for ( i = 0 ; i < numJobs ; i++ ) {
+			SV_WriteSnapshotJob( jobs, i );
+		}
+	}
+}
+
+/*
+=======================
+SV_SendSnapshot
+
+Finishes a built snapshot on the main thread and sends it.
+=======================
+*/
+static void SV_SendSnapshot( snapshotJob_t *job ) {
+	client_t	*client = job->client;
+
+	if ( job->warning ) {
+		Com_DPrintf ("%s: %s.\n", client->name, job->warning);
+	}
 
 #ifdef USE_VOIP
-	SV_WriteVoipToClient( client, &msg );
+	SV_WriteVoipToClient( client, &job->msg );
 #endif
 
 	// check for overflow
-	if ( msg.overflowed ) {
+	if ( job->msg.overflowed ) {
 		Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
-		MSG_Clear (&msg);
+		MSG_Clear (&job->msg);
 	}
 
-	SV_SendMessageToClient( &msg, client );
+	SV_SendMessageToClient( &job->msg, client );
+}
+
+/*
+=======================
+SV_SendClientSnapshot
+
+Also called by SV_FinalMessage
+
+=======================
+*/
+void SV_SendClientSnapshot( client_t *client ) {
+	snapshotJob_t	job;
+
+	job.client = client;
+	SV_BuildSnapshots( &job, 1, qfalse );
+	SV_SendSnapshot( &job );
 }
 
 
@@ -638,9 +889,11 @@ SV_SendClientMessages
 void SV_SendClientMessages(void)
 {
 	int		i;
+	int		numJobs;
 	client_t	*c;
 
-	// send a message to each connected client
+	// find the connected clients that are due a message
+	numJobs = 0;
 	for(i=0; i < sv_maxclients->integer; i++)
 	{
 		c = &svs.clients[i];
@@ -673,9 +926,92 @@ void SV_SendClientMessages(void)
 			}
 		}
 
-		// generate and send a new message
-		SV_SendClientSnapshot(c);
+		svSnapshotJobs[numJobs++].client = c;
+	}
+
+	if(!numJobs)
+		return;
+
+	// generate the new messages, sharing them out if there are job threads
+	SV_BuildSnapshots(svSnapshotJobs, numJobs, numJobs > 1 && Job_NumThreads() > 0);
+
+	// and send them
+	for(i=0; i < numJobs; i++)
+	{
+		c = svSnapshotJobs[i].client;
+		SV_SendSnapshot(&svSnapshotJobs[i]);
 		c->lastSnapshotTime = svs.time;
 		c->rateDelayed = qfalse;
 	}
 }
+
+/*
+=======================
+SV_SnapshotBench_f
+
+Times building and encoding snapshots for the first 1, 2, 4... active
+clients, bots included, serially and on the job threads.  Nothing is
+sent, but the clients may get a full snapshot instead of a delta next.
+=======================
+*/
+void SV_SnapshotBench_f( void ) {
+	int				reliableSent[MAX_CLIENTS];
+	int				frames, numClients, count;
+	int				i, f, start, serialMsec, parallelMsec;
+	client_t		*cl;
+
+	if ( !com_sv_running->integer || sv.state != SS_GAME ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	frames = 100;
+	if ( Cmd_Argc() > 1 ) {
+		frames = atoi( Cmd_Argv( 1 ) );
+		if ( frames < 1 ) {
+			frames = 1;
+		}
+	}
+
+	numClients = 0;
+	for ( i = 0, cl = svs.clients ; i < sv_maxclients->integer ; i++, cl++ ) {
+		if ( cl->state == CS_ACTIVE && cl->gentity ) {
+			reliableSent[numClients] = cl->reliableSent;
+			svSnapshotJobs[numClients++].client = cl;
+		}
+	}
+	if ( !numClients ) {
+		Com_Printf( "No active clients.\n" );
+		return;
+	}
+
+	Com_Printf( "%i frames, %i job threads:\n", frames, Job_NumThreads() );
+	for ( count = 1 ; ; count *= 2 ) {
+		if ( count > numClients ) {
+			count = numClients;
+		}
+
+		start = Sys_Milliseconds();
+		for ( f = 0 ; f < frames ; f++ ) {
+			SV_BuildSnapshots( svSnapshotJobs, count, qfalse );
+		}
+		serialMsec = Sys_Milliseconds() - start;
+
+		start = Sys_Milliseconds();
+		for ( f = 0 ; f < frames ; f++ ) {
+			SV_BuildSnapshots( svSnapshotJobs, count, qtrue );
+		}
+		parallelMsec = Sys_Milliseconds() - start;
+
+		Com_Printf( "%3i clients: %7.3f msec serial, %7.3f msec parallel per frame\n",
+			count, serialMsec / (float)frames, parallelMsec / (float)frames );
+
+		if ( count == numClients ) {
+			break;
+		}
+	}
+
+	for ( i = 0 ; i < numClients ; i++ ) {
+		svSnapshotJobs[i].client->reliableSent = reliableSent[i];
+	}
+}
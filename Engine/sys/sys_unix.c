@@ -38,6 +38,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <fcntl.h>
 #include <fenv.h>
 #include <sys/wait.h>
+#include <pthread.h>
 
 qboolean stdinIsATTY;
 
@@ -881,3 +882,203 @@ qboolean Sys_PIDIsRunning( int pid )
 {
 	return kill( pid, 0 ) == 0;
 }
+
+/*
+==============================================================
+
+FILE MAPPING
+
+==============================================================
+*/
+
+/*
+==================
+Sys_MapFile
+
+Maps length bytes of the file from offset.  Writes go to private copies
+of the pages.  Returns NULL if the file can't be mapped, otherwise
+*base and *baseLength are what Sys_UnmapFile takes.
+==================
+*/
+void *Sys_MapFile( const char *path, long offset, long length, void **base, long *baseLength )
+{
+	long	start = offset - offset % sysconf( _SC_PAGESIZE );
+	void	*p;
+	int		fd;
+
+	fd = open( path, O_RDONLY );
+	if( fd == -1 )
+		return NULL;
+
+	p = mmap( NULL, length + offset - start, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, start );
+	close( fd );
+
+	if( p == MAP_FAILED )
+		return NULL;
+
+	*base = p;
+	*baseLength = length + offset - start;
+	return (byte *)p + offset - start;
+}
+
+/*
+==================
+Sys_UnmapFile
+==================
+*/
+void Sys_UnmapFile( void *base, long baseLength )
+{
+	munmap( base, baseLength );
+}
+
+/*
+==============================================================
+
+THREADS
+
+For the job system, which the dedicated server uses as well,
+so they can't go through SDL like the render thread does.
+==============================================================
+*/
+
+typedef struct {
+	void	(*function)( void *arg );
+	void	*arg;
+} sysThreadStart_t;
+
+typedef struct {
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	int				count;
+} sysSemaphore_t;
+
+static void *Sys_ThreadStart( void *start )
+{
+	sysThreadStart_t	s = *(sysThreadStart_t *)start;
+
+	free( start );
+	s.function( s.arg );
+	return NULL;
+}
+
+/*
+==============
+Sys_CreateThread
+
+Returns NULL if the thread couldn't be started
+==============
+*/
+void *Sys_CreateThread( void (*function)( void *arg ), void *arg )
+{
+	sysThreadStart_t	*start;
+	pthread_t			*thread;
+
+	start = malloc( sizeof( *start ) );
+	thread = malloc( sizeof( *thread ) );
+	if( !start || !thread )
+	{
+		free( start );
+		free( thread );
+		return NULL;
+	}
+
+	start->function = function;
+	start->arg = arg;
+	if( pthread_create( thread, NULL, Sys_ThreadStart, start ) )
+	{
+		free( start );
+		free( thread );
+		return NULL;
+	}
+
+	return thread;
+}
+
+/*
+==============
+Sys_JoinThread
+
+Waits for the thread to exit and frees it
+==============
+*/
+void Sys_JoinThread( void *thread )
+{
+	pthread_join( *(pthread_t *)thread, NULL );
+	free( thread );
+}
+
+/*
+==============
+Sys_CreateSemaphore
+==============
+*/
+void *Sys_CreateSemaphore( void )
+{
+	sysSemaphore_t	*sem;
+
+	sem = malloc( sizeof( *sem ) );
+	if( !sem )
+		return NULL;
+
+	pthread_mutex_init( &sem->mutex, NULL );
+	pthread_cond_init( &sem->cond, NULL );
+	sem->count = 0;
+	return sem;
+}
+
+/*
+==============
+Sys_DestroySemaphore
+==============
+*/
+void Sys_DestroySemaphore( void *semaphore )
+{
+	sysSemaphore_t	*sem = semaphore;
+
+	pthread_cond_destroy( &sem->cond );
+	pthread_mutex_destroy( &sem->mutex );
+	free( sem );
+}
+
+/*
+==============
+Sys_SemaphoreWait
+==============
+*/
+void Sys_SemaphoreWait( void *semaphore )
+{
+	sysSemaphore_t	*sem = semaphore;
+
+	pthread_mutex_lock( &sem->mutex );
+	while( sem->count <= 0 )
+		pthread_cond_wait( &sem->cond, &sem->mutex );
+	sem->count--;
+	pthread_mutex_unlock( &sem->mutex );
+}
+
+/*
+==============
+Sys_SemaphorePost
+==============
+*/
+void Sys_SemaphorePost( void *semaphore )
+{
+	sysSemaphore_t	*sem = semaphore;
+
+	pthread_mutex_lock( &sem->mutex );
+	sem->count++;
+	pthread_cond_signal( &sem->cond );
+	pthread_mutex_unlock( &sem->mutex );
+}
+
+/*
+==============
+Sys_ProcessorCount
+==============
+*/
+int Sys_ProcessorCount( void )
+{
+	long	count = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return count > 0 ? count : 1;
+}
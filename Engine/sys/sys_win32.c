@@ -813,3 +813,178 @@ qboolean Sys_PIDIsRunning( int pid )
 
 	return qfalse;
 }
+
+/*
+==============================================================
+
+FILE MAPPING
+
+==============================================================
+*/
+
+/*
+==================
+Sys_MapFile
+
+Maps length bytes of the file from offset.  Writes go to private copies
+of the pages.  Returns NULL if the file can't be mapped, otherwise
+*base and *baseLength are what Sys_UnmapFile takes.
+==================
+*/
+void *Sys_MapFile( const char *path, long offset, long length, void **base, long *baseLength )
+{
+	SYSTEM_INFO	info;
+	HANDLE		file, mapping;
+	long		start;
+	void		*p;
+
+	GetSystemInfo( &info );
+	start = offset - offset % info.dwAllocationGranularity;
+
+	file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( file == INVALID_HANDLE_VALUE )
+		return NULL;
+
+	// the view keeps the mapping and the file open
+	mapping = CreateFileMapping( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+	CloseHandle( file );
+	if( !mapping )
+		return NULL;
+
+	p = MapViewOfFile( mapping, FILE_MAP_COPY, 0, start, length + offset - start );
+	CloseHandle( mapping );
+	if( !p )
+		return NULL;
+
+	*base = p;
+	*baseLength = length + offset - start;
+	return (byte *)p + offset - start;
+}
+
+/*
+==================
+Sys_UnmapFile
+==================
+*/
+void Sys_UnmapFile( void *base, long baseLength )
+{
+	UnmapViewOfFile( base );
+}
+
+/*
+==============================================================
+
+THREADS
+
+For the job system, which the dedicated server uses as well,
+so they can't go through SDL like the render thread does.
+==============================================================
+*/
+
+typedef struct {
+	void	(*function)( void *arg );
+	void	*arg;
+} sysThreadStart_t;
+
+static DWORD WINAPI Sys_ThreadStart( LPVOID start )
+{
+	sysThreadStart_t	s = *(sysThreadStart_t *)start;
+
+	free( start );
+	s.function( s.arg );
+	return 0;
+}
+
+/*
+==============
+Sys_CreateThread
+
+Returns NULL if the thread couldn't be started
+==============
+*/
+void *Sys_CreateThread( void (*function)( void *arg ), void *arg )
+{
+	sysThreadStart_t	*start;
+	HANDLE				thread;
+
+	start = malloc( sizeof( *start ) );
+	if( !start )
+		return NULL;
+
+	start->function = function;
+	start->arg = arg;
+	thread = CreateThread( NULL, 0, Sys_ThreadStart, start, 0, NULL );
+	if( !thread )
+	{
+		free( start );
+		return NULL;
+	}
+
+	return thread;
+}
+
+/*
+==============
+Sys_JoinThread
+
+Waits for the thread to exit and frees it
+==============
+*/
+void Sys_JoinThread( void *thread )
+{
+	WaitForSingleObject( thread, INFINITE );
+	CloseHandle( thread );
+}
+
+/*
+==============
+Sys_CreateSemaphore
+==============
+*/
+void *Sys_CreateSemaphore( void )
+{
+	return CreateSemaphore( NULL, 0, 0x7fffffff, NULL );
+}
+
+/*
+==============
+Sys_DestroySemaphore
+==============
+*/
+void Sys_DestroySemaphore( void *semaphore )
+{
+	CloseHandle( semaphore );
+}
+
+/*
+==============
+Sys_SemaphoreWait
+==============
+*/
+void Sys_SemaphoreWait( void *semaphore )
+{
+	WaitForSingleObject( semaphore, INFINITE );
+}
+
+/*
+==============
+Sys_SemaphorePost
+==============
+*/
+void Sys_SemaphorePost( void *semaphore )
+{
+	ReleaseSemaphore( semaphore, 1, NULL );
+}
+
+/*
+==============
+Sys_ProcessorCount
+==============
+*/
+int Sys_ProcessorCount( void )
+{
+	SYSTEM_INFO	info;
+
+	GetSystemInfo( &info );
+	return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
@@ -84,19 +84,17 @@ CG_Aura_GetHullPoints
   Reads and prepares the positions of the tags for a convex hull aura.
 */
 #define MAX_AURATAGNAME 12
+static int	auraTagNames[MAX_AURATAGS];	// "tag_aura%i", registered by CG_RegisterClientAura
 static void CG_Aura_GetHullPoints( centity_t *player, auraState_t *state, auraConfig_t *config){
-	char		tagName[MAX_AURATAGNAME];
 	int			i, j;
 	j = 0;
 	
 
-	for (i = 0;i < config->numTags[0];i++){
+	for (i = 0;i < config->numTags[0] && i < MAX_AURATAGS;i++){
 		orientation_t tagOrient;
 			
 		// Lerp the tag's position
-		Com_sprintf( tagName, sizeof(tagName), "tag_aura%i", i);
-			
-		if (!CG_GetTagOrientationFromPlayerEntityHeadModel( player, tagName, &tagOrient)) continue;
+		if (!CG_GetTagHandleOrientationFromPlayerPart( player, PLAYERPART_HEAD, auraTagNames[i], &tagOrient)) continue;
 		VectorCopy( tagOrient.origin, state->convexHull[j].pos_world);
 
 		if (CG_WorldCoordToScreenCoordVec( state->convexHull[j].pos_world, state->convexHull[j].pos_screen)){
@@ -105,13 +103,11 @@ static void CG_Aura_GetHullPoints( centity_t *player, auraState_t *state, auraCo
 		}
 	}
 
-	for (i = 0;i < config->numTags[1];i++){
+	for (i = 0;i < config->numTags[1] && i < MAX_AURATAGS;i++){
 		orientation_t tagOrient;
 			
 		// Lerp the tag's position
-		Com_sprintf( tagName, sizeof(tagName), "tag_aura%i", i);
-			
-		if(!CG_GetTagOrientationFromPlayerEntityTorsoModel( player, tagName, &tagOrient)) continue;
+		if (!CG_GetTagHandleOrientationFromPlayerPart( player, PLAYERPART_TORSO, auraTagNames[i], &tagOrient)) continue;
 		VectorCopy( tagOrient.origin, state->convexHull[j].pos_world);
 
 		if (CG_WorldCoordToScreenCoordVec( state->convexHull[j].pos_world, state->convexHull[j].pos_screen)){
@@ -120,13 +116,11 @@ static void CG_Aura_GetHullPoints( centity_t *player, auraState_t *state, auraCo
 		}
 	}
 
-	for (i = 0;i < config->numTags[2];i++){
+	for (i = 0;i < config->numTags[2] && i < MAX_AURATAGS;i++){
 		orientation_t tagOrient;
 			
 		// Lerp the tag's position
-		Com_sprintf( tagName, sizeof(tagName), "tag_aura%i", i);
-			
-		if(!CG_GetTagOrientationFromPlayerEntityLegsModel( player, tagName, &tagOrient)) continue;
+		if (!CG_GetTagHandleOrientationFromPlayerPart( player, PLAYERPART_LEGS, auraTagNames[i], &tagOrient)) continue;
 		VectorCopy( tagOrient.origin, state->convexHull[j].pos_world);
 
 		if (CG_WorldCoordToScreenCoordVec( state->convexHull[j].pos_world, state->convexHull[j].pos_screen)){
@@ -887,6 +881,13 @@ void parseAura(char *path,auraConfig_t *aura);
 void CG_RegisterClientAura(int clientNum,clientInfo_t *ci){
 	int	i;
 	char filename[MAX_QPATH * 2];
+	char tagName[MAX_AURATAGNAME];
+	if(!auraTagNames[0]){
+		for(i = 0;i < MAX_AURATAGS;i++){
+			Com_sprintf(tagName,sizeof(tagName),"tag_aura%i",i);
+			auraTagNames[i] = CG_RegisterTagName(tagName);
+		}
+	}
 	memset(&(auraStates[clientNum]), 0, sizeof(auraState_t));
 	for(i = 0;i < 8;i++){ 
 		ci->auraConfig[i] = &(auraStates[clientNum].configurations[i]);
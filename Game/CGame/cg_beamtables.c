@@ -25,7 +25,7 @@ typedef struct {
 	qboolean			alreadyWiped;
 	int					updateTime;
 	qhandle_t			shader;
-	char				tagName[MAX_QPATH];
+	int					tagName;		// from CG_RegisterTagName
 	float				width;
 } beamTable_t;
 
@@ -143,7 +143,7 @@ void CG_BeamTableUpdate( centity_t *cent, float width, qhandle_t shader, char *t
 	// set the width, shader and tag to lock on to.
 	currentTable->width = width;
 	currentTable->shader = shader;
-	Q_strncpyz(currentTable->tagName, tagName, sizeof(currentTable->tagName));
+	currentTable->tagName = CG_RegisterTagName(tagName);
 
 	// always update the terminator symbol
 	VectorCopy(cent->lerpOrigin, currentTable->table_activeList.pos);
@@ -450,7 +450,7 @@ static void CG_DrawBeamTable ( int clientNum, qboolean alternate ) {
 		currentTable = &(beamTableAlternate[clientNum]);
 
 		// retrieve the correct starter point
-		if (!CG_GetTagOrientationFromPlayerEntity( &(cg_entities[clientNum]), currentTable->tagName, &orient)) {
+		if (!CG_GetTagHandleOrientationFromPlayerEntity( &(cg_entities[clientNum]), currentTable->tagName, &orient)) {
 			// If the tag can not be found, wipe the table and don't display the beam
 			currentTable->activeThisFrame = qfalse;
 		} else {
@@ -465,7 +465,7 @@ static void CG_DrawBeamTable ( int clientNum, qboolean alternate ) {
 		currentTable = &(beamTablePrimary[clientNum]);
 
 		// retrieve the correct starter point
-		if (!CG_GetTagOrientationFromPlayerEntity( &(cg_entities[clientNum]), currentTable->tagName, &orient)) {
+		if (!CG_GetTagHandleOrientationFromPlayerEntity( &(cg_entities[clientNum]), currentTable->tagName, &orient)) {
 			// If the tag can not be found, wipe the table and don't display the beam
 			currentTable->activeThisFrame = qfalse;
 		} else {
@@ -217,6 +217,34 @@ void CG_PositionRotatedEntityOnTag( refEntity_t *entity, const refEntity_t *pare
 	MatrixMultiply( tempAxis, ((refEntity_t *)parent)->axis, entity->axis );
 }
 
+/*
+======================
+CG_PositionRotatedEntityOnTagIndex
+
+Same as CG_PositionRotatedEntityOnTag, with the tag index
+from trap_R_RegisterTag
+======================
+*/
+void CG_PositionRotatedEntityOnTagIndex( refEntity_t *entity, const refEntity_t *parent, 
+							qhandle_t parentModel, int tagIndex ) {
+	int				i;
+	orientation_t	lerped;
+	vec3_t			tempAxis[3];
+
+	// lerp the tag
+	trap_R_LerpTagIndex( &lerped, parentModel, parent->oldframe, parent->frame,
+		1.0 - parent->backlerp, tagIndex );
+
+	VectorCopy( parent->origin, entity->origin );
+	for ( i = 0 ; i < 3 ; i++ ) {
+		VectorMA( entity->origin, lerped.origin[i], parent->axis[i], entity->origin );
+	}
+
+	// had to cast away the const to avoid compiler problems...
+	MatrixMultiply( entity->axis, lerped.axis, tempAxis );
+	MatrixMultiply( tempAxis, ((refEntity_t *)parent)->axis, entity->axis );
+}
+
 
 
 /*
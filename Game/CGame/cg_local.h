@@ -316,6 +316,21 @@ typedef struct {
 // this is regenerated each time a client's configstring changes,
 // usually as a result of a userinfo (name, model, etc) change
 #define	MAX_CUSTOM_SOUNDS	256
+#define	MAX_CLIENT_TAGS		256		// must be a power of two
+
+// renderer tag index of a registered tag name on one model
+typedef struct {
+	qhandle_t		model;
+	int				name;			// from CG_RegisterTagName
+	int				index;			// -1 if the model doesn't have the tag
+} clientTag_t;
+
+typedef enum {
+	PLAYERPART_HEAD,
+	PLAYERPART_TORSO,
+	PLAYERPART_LEGS,
+	PLAYERPART_CAMERA
+} playerPart_t;
 
 typedef struct {
 	qboolean		infoValid;
@@ -372,6 +387,7 @@ typedef struct {
 	int				cameraBackup[4];
 	tierConfig_cg	tierConfig[MAX_TIERS];
 	auraConfig_t	*auraConfig[MAX_TIERS];
+	clientTag_t		tags[MAX_CLIENT_TAGS];	// filled in by CG_ClientTagIndex
 } clientInfo_t;
 
 
@@ -982,6 +998,7 @@ extern	vmCvar_t		cg_playTransformTrackToEnd;
 extern	vmCvar_t		cg_particlesQuality;
 extern	vmCvar_t		cg_particlesStop;
 extern  vmCvar_t		cg_particlesMaximum;
+extern	vmCvar_t		cg_particlesBatch;
 extern	vmCvar_t		cg_drawBBox;
 // END ADDING
 extern	radar_t			cg_playerOrigins[MAX_CLIENTS];
@@ -1012,7 +1029,8 @@ void CG_BuildSpectatorString( void );
 //
 void CG_Music_Start(void);
 void CG_Music_Update(void);
-void CG_Music_Play(char* track,int duration);
+void CG_Music_Play(char* track,int duration,char* next);
+int CG_Music_PickTrack(int type);
 void CG_Music_NextTrack(void);
 void CG_Music_FadeNext(void);
 int CG_Music_GetMilliseconds(char* time);
@@ -1132,6 +1150,11 @@ void CG_ResetPlayerEntity( centity_t *cent );
 void CG_AddRefEntityWithPowerups( refEntity_t *ent, entityState_t *state, int team, qboolean auraAlways );
 void CG_NewClientInfo( int clientNum );
 sfxHandle_t	CG_CustomSound( int clientNum, const char *soundName );
+int CG_RegisterTagName( const char *tagName );
+void CG_InitTagNames( void );
+int CG_ClientTagIndex( clientInfo_t *ci, qhandle_t model, int tagName );
+qboolean CG_GetTagHandleOrientationFromPlayerPart( centity_t *cent, playerPart_t part, int tagName, orientation_t *tagOrient );
+qboolean CG_GetTagHandleOrientationFromPlayerEntity( centity_t *cent, int tagName, orientation_t *tagOrient );
 qboolean CG_GetTagOrientationFromPlayerEntity( centity_t *cent, char *tagName, orientation_t *tagOrient );
 qboolean CG_GetTagOrientationFromPlayerEntityCameraModel( centity_t *cent, char *tagName, orientation_t *tagOrient );
 qboolean CG_GetTagOrientationFromPlayerEntityHeadModel( centity_t *cent, char *tagName, orientation_t *tagOrient );
@@ -1176,6 +1199,8 @@ void CG_Beam( centity_t *cent );
 void CG_AdjustPositionForMover( const vec3_t in, int moverNum, int fromTime, int toTime, vec3_t out );
 void CG_PositionEntityOnTag( refEntity_t *entity, const refEntity_t *parent, 
 							qhandle_t parentModel, char *tagName );
+void CG_PositionRotatedEntityOnTagIndex( refEntity_t *entity, const refEntity_t *parent, 
+							qhandle_t parentModel, int tagIndex );
 void CG_PositionRotatedEntityOnTag( refEntity_t *entity, const refEntity_t *parent, 
 							qhandle_t parentModel, char *tagName );
 void CG_GetTagPosition( refEntity_t *parent, char *tagName, vec3_t outpos);
@@ -1425,6 +1450,10 @@ void		trap_R_DrawStretchPic( float x, float y, float w, float h,
 void		trap_R_ModelBounds( clipHandle_t model, vec3_t mins, vec3_t maxs, int frame );
 int			trap_R_LerpTag( orientation_t *tag, clipHandle_t mod, int startFrame, int endFrame, 
 					   float frac, const char *tagName );
+// returns the tag's index for trap_R_LerpTagIndex, or -1 if the model doesn't have it
+int			trap_R_RegisterTag( clipHandle_t mod, const char *tagName );
+int			trap_R_LerpTagIndex( orientation_t *tag, clipHandle_t mod, int startFrame, int endFrame, 
+					   float frac, int tagIndex );
 void		trap_R_RemapShader( const char *oldShader, const char *newShader, const char *timeOffset );
 
 // The glconfig_t will not change during the life of a cgame.
@@ -1489,6 +1518,11 @@ void trap_CIN_SetExtents (int handle, int x, int y, int w, int h);
 
 void trap_SnapVector( float *v );
 
+// calls function( data, index ) for every index below count, on the engine's
+// job threads if the cgame is a native library.  The function must not call
+// any traps, or write anything the other indexes use.
+void trap_ParallelFor( void (*function)( void *data, int index ), void *data, int count, int batch );
+
 qboolean	trap_loadCamera(const char *name);
 void		trap_startCamera(int time);
 qboolean	trap_getCameraInfo(int time, vec3_t *origin, vec3_t *angles);
@@ -1546,6 +1580,7 @@ qboolean CG_RegisterClientModelnameWithTiers( clientInfo_t *ci, const char *mode
 //
 void CG_InitParticleSystems( void );
 void CG_AddParticleSystems( void );
+void CG_ParticleBenchmark_f( void );
 void PSys_SpawnCachedSystem( char* systemName, vec3_t origin, vec3_t *axis,
 							 centity_t *cent, char* tagName,
 							 qboolean auraLink, qboolean weaponLink );
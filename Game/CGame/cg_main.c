@@ -185,6 +185,7 @@ vmCvar_t	cg_particlesQuality;
 vmCvar_t	cg_particlesType;
 vmCvar_t	cg_particlesStop;
 vmCvar_t	cg_particlesMaximum;
+vmCvar_t	cg_particlesBatch;
 vmCvar_t	cg_drawBBox;
 //END ADDING
 typedef struct {
@@ -301,7 +302,8 @@ static cvarTable_t cvarTable[] = {
 	{ &cg_particlesType, "cg_particlesType", "1", CVAR_ARCHIVE},
 	{ &cg_particlesQuality, "cg_particlesQuality", "1", CVAR_ARCHIVE},
 	{ &cg_particlesStop, "cg_particlesStop", "0", CVAR_ARCHIVE},
-	{ &cg_particlesMaximum, "cg_particlesMaximum", "1024", CVAR_ARCHIVE},
+	{ &cg_particlesMaximum, "cg_particlesMaximum", "10240", CVAR_ARCHIVE},
+	{ &cg_particlesBatch, "cg_particlesBatch", "1", CVAR_ARCHIVE},
 	{ &cg_drawBBox, "cg_drawBBox", "0", CVAR_CHEAT }
 	// END ADDING
 //	{ &cg_pmove_fixed, "cg_pmove_fixed", "0", CVAR_USERINFO | CVAR_ARCHIVE }
@@ -724,6 +726,9 @@ void CG_Init( int serverMessageNum, int serverCommandSequence, int clientNum ) {
 
 	CG_InitConsoleCommands();
 
+	CG_ClearTierCache();
+	CG_InitTagNames();
+
 	cg.weaponSelect = 1;
 
 	cgs.redflag = cgs.blueflag = -1; // For compatibily, default to unset for
@@ -825,3 +830,20 @@ void CG_KeyEvent(int key, qboolean down) {
 
 void CG_MouseEvent(int x, int y) {
 }
+
+#ifdef Q3_VM
+/*
+==================
+trap_ParallelFor
+
+The engine can't call back into a QVM, so it just runs the loop
+==================
+*/
+void trap_ParallelFor( void (*function)( void *data, int index ), void *data, int count, int batch ) {
+	int		i;
+
+	for ( i = 0; i < count; i++ ) {
+		function( data, i );
+	}
+}
+#endif
@@ -39,27 +39,37 @@ void CG_Music_CheckType(int type){
 		clientInfo_t* info = &cgs.clientinfo[state->clientNum];
 		tierConfig_cg* tier = &info->tierConfig[info->tierCurrent];
 		if(!tier->transformMusic[0]){CG_Music_NextTrack();}
-		else{CG_Music_Play(tier->transformMusic,tier->transformMusicLength);}
+		else{CG_Music_Play(tier->transformMusic,tier->transformMusicLength,tier->transformMusic);}
 	}
 	else{CG_Music_NextTrack();}
 }
-void CG_Music_Play(char* track,int duration){
-	char* path = va("music/%s",track);
+void CG_Music_Play(char* track,int duration,char* next){
+	char path[MAX_QPATH];
+	char loop[MAX_QPATH];
+	Com_sprintf(path,sizeof(path),"music/%s",track);
+	Com_sprintf(loop,sizeof(loop),"music/%s",next);
 	if(duration > MUSIC_MAXDURATION){duration = MUSIC_MAXDURATION;}
 	Music.endTime = cg.time + duration - Music.fadeAmount;
-	trap_S_StartBackgroundTrack(path,path);
+	trap_S_StartBackgroundTrack(path,loop);
 	trap_Cvar_Set("s_musicvolume",va("%f",cg_music.value));
 }
+int CG_Music_PickTrack(int type){
+	int typeSize = Music.typeSize[type];
+	int trackIndex = Music.isRandom ? random() * typeSize : Music.lastTrack[type]+1;
+	trackIndex %= typeSize;
+	if(trackIndex == Music.lastTrack[type]){trackIndex = (Music.lastTrack[type]+1) % typeSize;}
+	return trackIndex;
+}
 void CG_Music_NextTrack(){
 	int type = Music.currentType;
-	int typeSize = Music.typeSize[type];
 	int trackIndex = 0;
+	int nextIndex = 0;
 	if(Music.isFading || Music.playToEnd){return;}
-	trackIndex = Music.isRandom ? random() * typeSize : Music.lastTrack[type]+1;
-	trackIndex %= typeSize;
-	if(trackIndex == Music.lastTrack[type]){trackIndex = (Music.lastTrack[type]+1) % typeSize;}
+	trackIndex = Music.queuedTrack[type] ? Music.queuedTrack[type]-1 : CG_Music_PickTrack(type);
 	Music.lastTrack[type] = trackIndex;
-	CG_Music_Play(Music.playlist[type][trackIndex],Music.trackLength[type][trackIndex]);
+	nextIndex = CG_Music_PickTrack(type);
+	Music.queuedTrack[type] = nextIndex+1;
+	CG_Music_Play(Music.playlist[type][trackIndex],Music.trackLength[type][trackIndex],Music.playlist[type][nextIndex]);
 }
 void CG_Music_FadeNext(void){
 	if(Music.playToEnd){return;}
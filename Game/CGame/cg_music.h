@@ -7,6 +7,7 @@ struct{
 	int trackLength[MUSIC_MAXTYPES][MUSIC_MAXTRACKS];
 	int typeSize[MUSIC_MAXTYPES];
 	int lastTrack[MUSIC_MAXTYPES];
+	int queuedTrack[MUSIC_MAXTYPES];
 	int currentType;
 	int fadeAmount;
 	int endTime;
@@ -5,14 +5,24 @@
 #include "cg_local.h"
 #include "cg_particlesystem.h"
 
+#if idx64 || ( id386 && defined( __SSE__ ))
+#include <xmmintrin.h>
+#define PSYS_SSE			1
+#else
+#define PSYS_SSE			0
+#endif
+
 #define MAX_ITERATIONS		10 // NOTE -RiO; Will this be enough?
 #define MIN_BOUNCE_DELTA	 8
+#define BENCH_FRAMETIME		16 // Fixed frame time used by psysbench
 
 // Prototypes.
-static void PSys_AccumulateSystem( PSys_System_t *system );
-static void PSys_AccumulateParticle( PSys_System_t *system, PSys_Particle_t *particle );
-static void PSys_IntegrateSystem( PSys_System_t *system, float timeStepSquare, float timeStepCorrected );
+static int PSys_GatherSystem( PSys_System_t *system );
+static void PSys_AccumulateSystem( PSys_System_t *system, int count );
+static void PSys_AccumulateParticle( PSys_System_t *system, int slot );
+static void PSys_IntegrateSystem( int count, float timeStepSquare, float timeStepCorrected );
 static void PSys_IntegrateParticle( PSys_Particle_t *particle, float timeStepSquare, float timeStepCorrected );
+static void PSys_IntegrateBatch( PSys_System_t *system, int count, float timeStepSquare, float timeStepCorrected );
 static qboolean PSys_ConstrainSystem( PSys_System_t *system );
 static qboolean PSys_ApplyConstraint( PSys_System_t *system, PSys_Constraint_t *constraint );
 static qboolean PSys_ApplyDistanceMaxConstraint( PSys_System_t *system, float value );
@@ -41,6 +51,31 @@ static PSys_Constraint_t		PSys_Constraints[MAX_CONSTRAINTS];
 static PSys_Constraint_t		PSys_Constraints_inuse;
 static PSys_Constraint_t		*PSys_Constraints_free;
 
+// Structure-of-arrays storage for the physical state of the particles.
+// Every array is indexed by the slot of the particle in PSys_Particles,
+// so the integrator can work on several particles at a time.
+typedef struct PSys_ParticleData_s {
+	float		pos[3][MAX_PARTICLES];
+	float		oldPos[3][MAX_PARTICLES];
+	float		force[3][MAX_PARTICLES];	// Force accumulator, only used by the scalar path
+	float		accel[3][MAX_PARTICLES];	// Acceleration accumulator, only used by the scalar path
+	float		mass[MAX_PARTICLES];
+	float		invMass[MAX_PARTICLES];		// Inverse mass
+} PSys_ParticleData_t;
+
+static PSys_ParticleData_t		PSys_Data;
+static int						PSys_Particles_count;
+
+// Slots of the live particles of the system currently being simulated.
+// Padded by a block, so the last block can always be loaded in full.
+static int						PSys_Batch[MAX_PARTICLES + PSYS_BLOCK_SIZE];
+static PSys_Particle_t			*PSys_BatchParticles[MAX_PARTICLES];
+
+// Particle positions recorded by the first pass of psysbench.
+static float					PSys_BenchPos[3][MAX_PARTICLES];
+
+#define PSYS_SLOT(p)			((int)((p) - PSys_Particles))
+
 static float					PSys_LastTimeStep;
 
 /*
@@ -69,6 +104,8 @@ static void PSys_InitParticles( void ) {
 	int		i;
 
 	memset( PSys_Particles, 0, sizeof( PSys_Particles ) );
+	memset( &PSys_Data, 0, sizeof( PSys_Data ) );
+	PSys_Particles_count = 0;
 	PSys_Particles_inuse.next = &PSys_Particles_inuse;
 	PSys_Particles_inuse.prev = &PSys_Particles_inuse;
 	PSys_Particles_free = PSys_Particles;
@@ -141,12 +178,66 @@ void CG_InitParticleSystems( void ) {
 -------------------
 */
 
+static void PSys_GetPosition( const PSys_Particle_t *particle, vec3_t out ) {
+	int slot = PSYS_SLOT( particle );
+
+	out[0] = PSys_Data.pos[0][slot];
+	out[1] = PSys_Data.pos[1][slot];
+	out[2] = PSys_Data.pos[2][slot];
+}
+
+static void PSys_SetPosition( const PSys_Particle_t *particle, const vec3_t in ) {
+	int slot = PSYS_SLOT( particle );
+
+	PSys_Data.pos[0][slot] = in[0];
+	PSys_Data.pos[1][slot] = in[1];
+	PSys_Data.pos[2][slot] = in[2];
+}
+
+static void PSys_GetOldPosition( const PSys_Particle_t *particle, vec3_t out ) {
+	int slot = PSYS_SLOT( particle );
+
+	out[0] = PSys_Data.oldPos[0][slot];
+	out[1] = PSys_Data.oldPos[1][slot];
+	out[2] = PSys_Data.oldPos[2][slot];
+}
+
+static void PSys_SetOldPosition( const PSys_Particle_t *particle, const vec3_t in ) {
+	int slot = PSYS_SLOT( particle );
+
+	PSys_Data.oldPos[0][slot] = in[0];
+	PSys_Data.oldPos[1][slot] = in[1];
+	PSys_Data.oldPos[2][slot] = in[2];
+}
+
+static void PSys_ClearParticleData( int slot ) {
+	int		i;
+
+	for ( i = 0; i < 3; i++ ) {
+		PSys_Data.pos[i][slot] = 0;
+		PSys_Data.oldPos[i][slot] = 0;
+		PSys_Data.force[i][slot] = 0;
+		PSys_Data.accel[i][slot] = 0;
+	}
+	PSys_Data.mass[slot] = 0;
+	PSys_Data.invMass[slot] = 0;
+}
+
+static int PSys_ParticleLimit( void ) {
+	if ( cg_particlesMaximum.integer <= 0 || cg_particlesMaximum.integer > MAX_PARTICLES ) {
+		return MAX_PARTICLES;
+	}
+	return cg_particlesMaximum.integer;
+}
+
 static void PSys_FreeParticle( PSys_Particle_t *particle ) {
 
 	if ( !particle->prev ) {
 		CG_Error( "PSys_FreeParticle: not active" );
 	}
 
+	PSys_Particles_count--;
+
 	// remove from the doubly linked global active list
 	particle->prev->next = particle->next;
 	particle->next->prev = particle->prev;
@@ -164,7 +255,7 @@ static void PSys_FreeParticle( PSys_Particle_t *particle ) {
 static PSys_Particle_t *PSys_SpawnParticle( PSys_System_t *system ) {
 	PSys_Particle_t	*particle;
 
-	if ( !PSys_Particles_free ) {
+	while ( !PSys_Particles_free || PSys_Particles_count >= PSys_ParticleLimit() ) {
 		// No free entities, so free the one at the end of the chain,
 		// removing the oldest active entity.
 		PSys_FreeParticle( PSys_Particles_inuse.prev );
@@ -174,6 +265,8 @@ static PSys_Particle_t *PSys_SpawnParticle( PSys_System_t *system ) {
 	PSys_Particles_free = PSys_Particles_free->next;
 
 	memset( particle, 0, sizeof( PSys_Particle_t ) );
+	PSys_ClearParticleData( PSYS_SLOT( particle ));
+	PSys_Particles_count++;
 
 	// link into the global active list
 	particle->next = PSys_Particles_inuse.next;
@@ -601,10 +694,12 @@ static void PSys_UpdateEmitters( PSys_System_t *system ) {
 			PSys_Particle_t *particle;
 			vec3_t	jitVec, sphereVec;
 			vec3_t	tempAxis[3];
-			int		i, templateIndex;
+			vec3_t	position, oldPosition;
+			int		i, templateIndex, slot;
 
 			for ( i = 0; i < emitter->amount; i++ ) {
 				particle = PSys_SpawnParticle( system );
+				slot = PSYS_SLOT( particle );
 
 				// Set starting point based on emitter type
 				VectorSet( jitVec,
@@ -615,7 +710,7 @@ static void PSys_UpdateEmitters( PSys_System_t *system ) {
 				switch ( emitter->type ) {
 					case ETYPE_POINT:
 					case ETYPE_POINT_SURFACE:
-						VectorAdd( root.origin, jitVec, particle->position );
+						VectorAdd( root.origin, jitVec, position );
 						break;
 
 					case ETYPE_RADIUS:
@@ -625,39 +720,41 @@ static void PSys_UpdateEmitters( PSys_System_t *system ) {
 						// NOTE: This function takes deg, not rad
 						RotateAroundDirection( tempAxis, crandom() * 360 );
 						
-						VectorMA( root.origin, emitter->radius, tempAxis[1], particle->position );
-						VectorMA( particle->position, emitter->offset, root.axis[0], particle->position );
-						VectorAdd( particle->position, jitVec, particle->position );
+						VectorMA( root.origin, emitter->radius, tempAxis[1], position );
+						VectorMA( position, emitter->offset, root.axis[0], position );
+						VectorAdd( position, jitVec, position );
 						break;
 
 					case ETYPE_SPHERE:
 						VectorSet( sphereVec, crandom() - crandom(), crandom() - crandom(), crandom() - crandom() );
 						VectorNormalize( sphereVec );
-						VectorMA( root.origin, emitter->radius, sphereVec, particle->position );
-						VectorAdd( particle->position, jitVec, particle->position );						
+						VectorMA( root.origin, emitter->radius, sphereVec, position );
+						VectorAdd( position, jitVec, position );						
 						break;
 
 					default:
-						VectorCopy( root.origin, particle->position );
+						VectorCopy( root.origin, position );
 						break;
 				}
 
 				templateIndex = rand() % emitter->nrTemplates;
 
 				// Set initial speed
-				VectorMA( particle->position, -emitter->particleTemplates[templateIndex].speed, root.axis[0], particle->oldPosition );
+				VectorMA( position, -emitter->particleTemplates[templateIndex].speed, root.axis[0], oldPosition );
+				PSys_SetPosition( particle, position );
+				PSys_SetOldPosition( particle, oldPosition );
 
 				// Set other initial particle physics
 				particle->lifeTime = emitter->particleTemplates[templateIndex].lifeTime;
 				particle->spawnTime = cg.time;
-				particle->mass = emitter->particleTemplates[templateIndex].mass;
+				PSys_Data.mass[slot] = emitter->particleTemplates[templateIndex].mass;
 
 				// If the particle has infinite aka zero mass, then the inverse mass must be zero.
 				// Avoid division by zero error.
-				if ( particle->mass ) {
-					particle->invMass = 1 / particle->mass;
+				if ( PSys_Data.mass[slot] ) {
+					PSys_Data.invMass[slot] = 1 / PSys_Data.mass[slot];
 				} else {
-					particle->invMass = 0;
+					PSys_Data.invMass[slot] = 0;
 				}
 
 				// Assign a look to the particle
@@ -670,7 +767,7 @@ static void PSys_UpdateEmitters( PSys_System_t *system ) {
 				// If the particle is a ray, and the emitter is not a ground type, set the point of origin as well.
 				// Don't bother otherwise.
 				if ( (particle->rType = emitter->particleTemplates[templateIndex].rType) == RTYPE_RAY ) {
-					VectorCopy( particle->position, particle->rayOrigin );
+					VectorCopy( position, particle->rayOrigin );
 
 					if ( emitter->type < ETYPE_POINT_SURFACE ) {
 						particle->rayParent = emitter;						
@@ -691,18 +788,34 @@ static void PSys_UpdateEmitters( PSys_System_t *system ) {
 }
 
 static void PSys_GetParticleVelocity( PSys_Particle_t *particle, vec3_t v ) {
-	VectorCopy( particle->position, v );
-	VectorSubtract( v, particle->oldPosition, v );
+	vec3_t	oldPosition;
+
+	PSys_GetPosition( particle, v );
+	PSys_GetOldPosition( particle, oldPosition );
+	VectorSubtract( v, oldPosition, v );
 }
 
 static void PSys_SetParticleVelocity( PSys_Particle_t *particle, vec3_t v ) {
-	VectorCopy( particle->position, particle->oldPosition );
-	VectorSubtract( particle->oldPosition, v, particle->oldPosition );
+	vec3_t	oldPosition;
+
+	PSys_GetPosition( particle, oldPosition );
+	VectorSubtract( oldPosition, v, oldPosition );
+	PSys_SetOldPosition( particle, oldPosition );
 }
 
-static void PSys_AccumulateSystem( PSys_System_t *system ) {
+/*
+========================
+PSys_GatherSystem
+========================
+  Frees the particles of the system that outlived their lifetime and
+  collects the slots of the remaining ones in PSys_Batch, in the order
+  in which the particle list is walked. Returns the number of slots.
+*/
+static int PSys_GatherSystem( PSys_System_t *system ) {
 	PSys_Particle_t *particle, *next;
+	int				count;
 
+	count = 0;
 	particle = system->particles.prev_local;
 	for ( ; particle != &(system->particles) ; particle = next ) {
 		// Grab next now, so if the entity is freed we still have the next one.
@@ -714,7 +827,18 @@ static void PSys_AccumulateSystem( PSys_System_t *system ) {
 			continue;
 		}
 
-		PSys_AccumulateParticle( system, particle );
+		PSys_BatchParticles[count] = particle;
+		PSys_Batch[count++] = PSYS_SLOT( particle );
+	}
+
+	return count;
+}
+
+static void PSys_AccumulateSystem( PSys_System_t *system, int count ) {
+	int		i;
+
+	for ( i = 0; i < count; i++ ) {
+		PSys_AccumulateParticle( system, PSys_Batch[i] );
 	}
 }
 
@@ -767,14 +891,22 @@ static float PSys_ApplyFalloff( PSys_Force_t *force, vec3_t particlePos, float s
 	return sourceVal;
 }
 
-static void PSys_AccumulateParticle( PSys_System_t *system, PSys_Particle_t *particle ) {
+static void PSys_AccumulateParticle( PSys_System_t *system, int slot ) {
 	PSys_Force_t	*force, *next;
+	vec3_t			position, oldPosition;
+	vec3_t			forceAccum;
 	vec3_t			sphereForce;
 	vec3_t			dragForce;
 	vec3_t			swirlForce, swirlOut;
 	vec3_t			v;
+	int				i;
 
-	VectorAdd( particle->accelAccum, system->gravity, particle->accelAccum );
+	for ( i = 0; i < 3; i++ ) {
+		position[i] = PSys_Data.pos[i][slot];
+		oldPosition[i] = PSys_Data.oldPos[i][slot];
+		forceAccum[i] = PSys_Data.force[i][slot];
+		PSys_Data.accel[i][slot] += system->gravity[i];
+	}
 
 	force = system->forces.prev_local;
 	for ( ; force != &(system->forces) ; force = next ) {
@@ -783,35 +915,35 @@ static void PSys_AccumulateParticle( PSys_System_t *system, PSys_Particle_t *par
 
 		switch ( force->type ) {
 		case FTYPE_DIRECTIONAL:		
-			VectorMA( particle->forceAccum, PSys_ApplyFalloff( force, particle->position, force->value ), force->orientation.geometry.axis[0], particle->forceAccum );
+			VectorMA( forceAccum, PSys_ApplyFalloff( force, position, force->value ), force->orientation.geometry.axis[0], forceAccum );
 			break;
 
 		case FTYPE_SPHERICAL:
-			VectorSubtract( particle->position, force->orientation.geometry.origin, sphereForce );
+			VectorSubtract( position, force->orientation.geometry.origin, sphereForce );
 			if ( VectorNormalize( sphereForce ) == 0.0f ) {
 				// If the point is placed exactly on the point of force, shoot it upwards instead
 				VectorSet( sphereForce, 0, 0, 1 );
 			}
 			
-			VectorMA( particle->forceAccum, PSys_ApplyFalloff( force, particle->position, force->value ), sphereForce, particle->forceAccum );
+			VectorMA( forceAccum, PSys_ApplyFalloff( force, position, force->value ), sphereForce, forceAccum );
 			break;
 
 		case FTYPE_DRAG:
-			PSys_GetParticleVelocity( particle, v );
-			VectorScale( v, PSys_ApplyFalloff( force, particle->position, force->value ) * -1, dragForce );
-			VectorAdd( particle->forceAccum, dragForce, particle->forceAccum );
+			VectorSubtract( position, oldPosition, v );
+			VectorScale( v, PSys_ApplyFalloff( force, position, force->value ) * -1, dragForce );
+			VectorAdd( forceAccum, dragForce, forceAccum );
 			break;
 
 		case FTYPE_SWIRL:
-			VectorSubtract( particle->position, force->orientation.geometry.origin, swirlOut );
+			VectorSubtract( position, force->orientation.geometry.origin, swirlOut );
 			if ( VectorNormalize( swirlOut ) == 0.0f ) {
 				// zero radius means we're at the 'center of the storm'
 				break;
 			}
 			CrossProduct( force->orientation.geometry.axis[0], swirlOut, swirlForce );
 			VectorNormalize( swirlForce );
-			VectorMA( particle->forceAccum, PSys_ApplyFalloff( force, particle->position, force->value ), swirlForce, particle->forceAccum );
-			VectorMA( particle->forceAccum, -1 * PSys_ApplyFalloff( force, particle->position, force->pullIn ), swirlOut, particle->forceAccum );
+			VectorMA( forceAccum, PSys_ApplyFalloff( force, position, force->value ), swirlForce, forceAccum );
+			VectorMA( forceAccum, -1 * PSys_ApplyFalloff( force, position, force->pullIn ), swirlOut, forceAccum );
 			break;
 
 		default:
@@ -819,54 +951,326 @@ static void PSys_AccumulateParticle( PSys_System_t *system, PSys_Particle_t *par
 			break;
 		}
 	}
-}
 
-static void PSys_IntegrateSystem( PSys_System_t *system, float timeStepSquare, float timeStepCorrected ) {
-	PSys_Particle_t	*particle, *next;
+	for ( i = 0; i < 3; i++ ) {
+		PSys_Data.force[i][slot] = forceAccum[i];
+	}
+}
 
-	particle = system->particles.prev_local;
-	for ( ; particle != &(system->particles) ; particle = next ) {
-		// Grab next now, so if the entity is freed we still have the next one.
-		next = particle->prev_local;
+static void PSys_IntegrateSystem( int count, float timeStepSquare, float timeStepCorrected ) {
+	int		i;
 
-		PSys_IntegrateParticle( particle, timeStepSquare, timeStepCorrected );
+	for ( i = 0; i < count; i++ ) {
+		PSys_IntegrateParticle( PSys_BatchParticles[i], timeStepSquare, timeStepCorrected );
 	}
 }
 
 
+static void PSys_UpdateRayOrigin( PSys_Particle_t *particle ) {
+	if ( particle->rayParent ) {
+		VectorAdd( particle->rayParent->orientation.geometry.origin, particle->rayOffset, particle->rayOrigin );
+	}
+}
+
 static void PSys_IntegrateParticle( PSys_Particle_t *particle, float timeStepSquare, float timeStepCorrected ) {
-	vec3_t vel;
+	vec3_t	position, oldPosition;
+	vec3_t	forceAccum, accelAccum;
+	vec3_t	vel;
+	int		slot, i;
+
+	slot = PSYS_SLOT( particle );
+	for ( i = 0; i < 3; i++ ) {
+		position[i] = PSys_Data.pos[i][slot];
+		oldPosition[i] = PSys_Data.oldPos[i][slot];
+		forceAccum[i] = PSys_Data.force[i][slot];
+		accelAccum[i] = PSys_Data.accel[i][slot];
+	}
 
 	// Handle (infinite) mass
-	VectorScale( particle->forceAccum, particle->invMass, particle->forceAccum );
-	if ( particle->mass != 0 ) {
-		VectorAdd( particle->forceAccum, particle->accelAccum, particle->forceAccum );
+	VectorScale( forceAccum, PSys_Data.invMass[slot], forceAccum );
+	if ( PSys_Data.mass[slot] != 0 ) {
+		VectorAdd( forceAccum, accelAccum, forceAccum );
 	}
-	
-	// Save the old position
-	VectorCopy( particle->position, particle->accelAccum );
-
 
 	// Timestep corrected Verlet integration:
 	// xi+1 = xi + (xi - xi-1) * (dti / dti-1) + a * dti * dti
 
-	VectorScale( particle->forceAccum, timeStepSquare, particle->forceAccum );
-	VectorSubtract( particle->position, particle->oldPosition, vel );
+	VectorScale( forceAccum, timeStepSquare, forceAccum );
+	VectorSubtract( position, oldPosition, vel );
 	VectorScale( vel, timeStepCorrected, vel );
-	VectorAdd( particle->position, vel, particle->position );
-	VectorAdd( particle->position, particle->forceAccum, particle->position );
-	
-	// Restore the old position
-	VectorCopy( particle->accelAccum, particle->oldPosition );
+	for ( i = 0; i < 3; i++ ) {
+		// Save the old position
+		PSys_Data.oldPos[i][slot] = position[i];
 
-	// Reset the accumulators for the next frame
-	VectorSet( particle->forceAccum, 0, 0, 0 );
-	VectorSet( particle->accelAccum, 0, 0, 0 );
+		PSys_Data.pos[i][slot] = position[i] + vel[i];
+		PSys_Data.pos[i][slot] += forceAccum[i];
 
+		// Reset the accumulators for the next frame
+		PSys_Data.force[i][slot] = 0;
+		PSys_Data.accel[i][slot] = 0;
+	}
 
 	// Update ray information if necessary
-	if ( particle->rayParent ) {
-		VectorAdd( particle->rayParent->orientation.geometry.origin, particle->rayOffset, particle->rayOrigin );
+	PSys_UpdateRayOrigin( particle );
+}
+
+
+/*
+-----------------------------------------
+
+  B A T C H E D   I N T E G R A T I O N
+
+-----------------------------------------
+*/
+
+#if PSYS_SSE
+
+static ID_INLINE __m128 PSys_LoadLanes_sse( const float *data, const int *slots ) {
+	return _mm_set_ps( data[slots[3]], data[slots[2]], data[slots[1]], data[slots[0]] );
+}
+
+static ID_INLINE void PSys_StoreLanes_sse( float *data, const int *slots, int count, __m128 v ) {
+	float	lanes[PSYS_BLOCK_SIZE];
+	int		i;
+
+	_mm_storeu_ps( lanes, v );
+	for ( i = 0; i < count; i++ ) {
+		data[slots[i]] = lanes[i];
+	}
+}
+
+// Per lane ( mask ? a : b )
+static ID_INLINE __m128 PSys_Select_sse( __m128 mask, __m128 a, __m128 b ) {
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ));
+}
+
+// Same operations as VectorNormalize, on four vectors at once.
+static ID_INLINE __m128 PSys_Normalize_sse( __m128 *x, __m128 *y, __m128 *z ) {
+	__m128	length, ilength, nonZero;
+
+	length = _mm_add_ps( _mm_add_ps( _mm_mul_ps( *x, *x ), _mm_mul_ps( *y, *y )), _mm_mul_ps( *z, *z ));
+	nonZero = _mm_cmpneq_ps( length, _mm_setzero_ps());
+	ilength = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( length ));
+
+	*x = PSys_Select_sse( nonZero, _mm_mul_ps( *x, ilength ), *x );
+	*y = PSys_Select_sse( nonZero, _mm_mul_ps( *y, ilength ), *y );
+	*z = PSys_Select_sse( nonZero, _mm_mul_ps( *z, ilength ), *z );
+
+	return _mm_and_ps( nonZero, _mm_mul_ps( length, ilength ));
+}
+
+// Same operations as PSys_ApplyFalloff, on four particles at once.
+static __m128 PSys_ApplyFalloff_sse( PSys_Force_t *force, __m128 x, __m128 y, __m128 z, float sourceVal ) {
+	float	*origin;
+	__m128	dx, dy, dz, distance, lerp;
+	float	lanes[3][PSYS_BLOCK_SIZE];
+	float	result[PSYS_BLOCK_SIZE];
+	vec3_t	particlePos;
+	int		i;
+
+	switch ( force->AOItype ) {
+	case AOI_INFINITE:
+		return _mm_set1_ps( sourceVal );
+
+	case AOI_SPHERE:
+		origin = force->orientation.geometry.origin;
+		dx = _mm_sub_ps( x, _mm_set1_ps( origin[0] ));
+		dy = _mm_sub_ps( y, _mm_set1_ps( origin[1] ));
+		dz = _mm_sub_ps( z, _mm_set1_ps( origin[2] ));
+		distance = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy )), _mm_mul_ps( dz, dz )));
+
+		if ( force->falloff ) {
+			lerp = _mm_div_ps( _mm_sub_ps( distance, _mm_set1_ps( force->AOIrange[0] )), _mm_set1_ps( force->falloff ));
+			lerp = _mm_sub_ps( _mm_set1_ps( 1.0f ), lerp );
+			// NOTE: Operand order matters here, so NaN passes through like it does in the scalar clamp.
+			lerp = _mm_max_ps( _mm_setzero_ps(), lerp );
+			lerp = _mm_min_ps( _mm_set1_ps( 1.0f ), lerp );
+		} else {
+			lerp = _mm_andnot_ps( _mm_cmpgt_ps( distance, _mm_set1_ps( force->AOIrange[0] )), _mm_set1_ps( 1.0f ));
+		}
+		return _mm_mul_ps( lerp, _mm_set1_ps( sourceVal ));
+
+	default:
+		// Cylinders are rare enough to just take the scalar path per lane
+		_mm_storeu_ps( lanes[0], x );
+		_mm_storeu_ps( lanes[1], y );
+		_mm_storeu_ps( lanes[2], z );
+		for ( i = 0; i < PSYS_BLOCK_SIZE; i++ ) {
+			VectorSet( particlePos, lanes[0][i], lanes[1][i], lanes[2][i] );
+			result[i] = PSys_ApplyFalloff( force, particlePos, sourceVal );
+		}
+		return _mm_loadu_ps( result );
+	}
+}
+
+/*
+========================
+PSys_IntegrateBlock_sse
+========================
+  Accumulates the forces on, and integrates, PSYS_BLOCK_SIZE particles
+  at once. Performs the same floating point operations in the same
+  order as PSys_AccumulateParticle followed by PSys_IntegrateParticle,
+  so on SSE builds the results match the scalar path bit for bit, save
+  for the sign of exact zeros.
+*/
+static void PSys_IntegrateBlock_sse( PSys_System_t *system, const int *slots, int count, float timeStepSquare, float timeStepCorrected ) {
+	PSys_Force_t	*force, *next;
+	float			*origin, *axis;
+	__m128			px, py, pz, ox, oy, oz;
+	__m128			fx, fy, fz, tx, ty, tz, sx, sy, sz;
+	__m128			scale, pull, length, mask;
+
+	px = PSys_LoadLanes_sse( PSys_Data.pos[0], slots );
+	py = PSys_LoadLanes_sse( PSys_Data.pos[1], slots );
+	pz = PSys_LoadLanes_sse( PSys_Data.pos[2], slots );
+	ox = PSys_LoadLanes_sse( PSys_Data.oldPos[0], slots );
+	oy = PSys_LoadLanes_sse( PSys_Data.oldPos[1], slots );
+	oz = PSys_LoadLanes_sse( PSys_Data.oldPos[2], slots );
+	fx = fy = fz = _mm_setzero_ps();
+
+	force = system->forces.prev_local;
+	for ( ; force != &(system->forces) ; force = next ) {
+		// Grab next now, so if the entity is freed we still have the next one.
+		next = force->prev_local;
+
+		origin = force->orientation.geometry.origin;
+		axis = force->orientation.geometry.axis[0];
+
+		switch ( force->type ) {
+		case FTYPE_DIRECTIONAL:
+			scale = PSys_ApplyFalloff_sse( force, px, py, pz, force->value );
+			fx = _mm_add_ps( fx, _mm_mul_ps( _mm_set1_ps( axis[0] ), scale ));
+			fy = _mm_add_ps( fy, _mm_mul_ps( _mm_set1_ps( axis[1] ), scale ));
+			fz = _mm_add_ps( fz, _mm_mul_ps( _mm_set1_ps( axis[2] ), scale ));
+			break;
+
+		case FTYPE_SPHERICAL:
+			sx = _mm_sub_ps( px, _mm_set1_ps( origin[0] ));
+			sy = _mm_sub_ps( py, _mm_set1_ps( origin[1] ));
+			sz = _mm_sub_ps( pz, _mm_set1_ps( origin[2] ));
+			length = PSys_Normalize_sse( &sx, &sy, &sz );
+
+			// If the point is placed exactly on the point of force, shoot it upwards instead
+			mask = _mm_cmpeq_ps( length, _mm_setzero_ps());
+			sx = _mm_andnot_ps( mask, sx );
+			sy = _mm_andnot_ps( mask, sy );
+			sz = PSys_Select_sse( mask, _mm_set1_ps( 1.0f ), sz );
+
+			scale = PSys_ApplyFalloff_sse( force, px, py, pz, force->value );
+			fx = _mm_add_ps( fx, _mm_mul_ps( sx, scale ));
+			fy = _mm_add_ps( fy, _mm_mul_ps( sy, scale ));
+			fz = _mm_add_ps( fz, _mm_mul_ps( sz, scale ));
+			break;
+
+		case FTYPE_DRAG:
+			scale = _mm_mul_ps( PSys_ApplyFalloff_sse( force, px, py, pz, force->value ), _mm_set1_ps( -1.0f ));
+			fx = _mm_add_ps( fx, _mm_mul_ps( _mm_sub_ps( px, ox ), scale ));
+			fy = _mm_add_ps( fy, _mm_mul_ps( _mm_sub_ps( py, oy ), scale ));
+			fz = _mm_add_ps( fz, _mm_mul_ps( _mm_sub_ps( pz, oz ), scale ));
+			break;
+
+		case FTYPE_SWIRL:
+			sx = _mm_sub_ps( px, _mm_set1_ps( origin[0] ));
+			sy = _mm_sub_ps( py, _mm_set1_ps( origin[1] ));
+			sz = _mm_sub_ps( pz, _mm_set1_ps( origin[2] ));
+			length = PSys_Normalize_sse( &sx, &sy, &sz );
+
+			// zero radius means we're at the 'center of the storm'
+			mask = _mm_cmpneq_ps( length, _mm_setzero_ps());
+			if ( !_mm_movemask_ps( mask )) {
+				break;
+			}
+
+			tx = _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( axis[1] ), sz ), _mm_mul_ps( _mm_set1_ps( axis[2] ), sy ));
+			ty = _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( axis[2] ), sx ), _mm_mul_ps( _mm_set1_ps( axis[0] ), sz ));
+			tz = _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( axis[0] ), sy ), _mm_mul_ps( _mm_set1_ps( axis[1] ), sx ));
+			PSys_Normalize_sse( &tx, &ty, &tz );
+
+			scale = PSys_ApplyFalloff_sse( force, px, py, pz, force->value );
+			pull = _mm_mul_ps( _mm_set1_ps( -1.0f ), PSys_ApplyFalloff_sse( force, px, py, pz, force->pullIn ));
+			tx = _mm_add_ps( _mm_add_ps( fx, _mm_mul_ps( tx, scale )), _mm_mul_ps( sx, pull ));
+			ty = _mm_add_ps( _mm_add_ps( fy, _mm_mul_ps( ty, scale )), _mm_mul_ps( sy, pull ));
+			tz = _mm_add_ps( _mm_add_ps( fz, _mm_mul_ps( tz, scale )), _mm_mul_ps( sz, pull ));
+			fx = PSys_Select_sse( mask, tx, fx );
+			fy = PSys_Select_sse( mask, ty, fy );
+			fz = PSys_Select_sse( mask, tz, fz );
+			break;
+
+		default:
+			// should never happen
+			break;
+		}
+	}
+
+	// Handle (infinite) mass
+	scale = PSys_LoadLanes_sse( PSys_Data.invMass, slots );
+	mask = _mm_cmpneq_ps( PSys_LoadLanes_sse( PSys_Data.mass, slots ), _mm_setzero_ps());
+	fx = _mm_mul_ps( fx, scale );
+	fy = _mm_mul_ps( fy, scale );
+	fz = _mm_mul_ps( fz, scale );
+	fx = PSys_Select_sse( mask, _mm_add_ps( fx, _mm_set1_ps( system->gravity[0] )), fx );
+	fy = PSys_Select_sse( mask, _mm_add_ps( fy, _mm_set1_ps( system->gravity[1] )), fy );
+	fz = PSys_Select_sse( mask, _mm_add_ps( fz, _mm_set1_ps( system->gravity[2] )), fz );
+
+	// Timestep corrected Verlet integration:
+	// xi+1 = xi + (xi - xi-1) * (dti / dti-1) + a * dti * dti
+	scale = _mm_set1_ps( timeStepSquare );
+	fx = _mm_mul_ps( fx, scale );
+	fy = _mm_mul_ps( fy, scale );
+	fz = _mm_mul_ps( fz, scale );
+
+	scale = _mm_set1_ps( timeStepCorrected );
+	tx = _mm_add_ps( _mm_add_ps( px, _mm_mul_ps( _mm_sub_ps( px, ox ), scale )), fx );
+	ty = _mm_add_ps( _mm_add_ps( py, _mm_mul_ps( _mm_sub_ps( py, oy ), scale )), fy );
+	tz = _mm_add_ps( _mm_add_ps( pz, _mm_mul_ps( _mm_sub_ps( pz, oz ), scale )), fz );
+
+	PSys_StoreLanes_sse( PSys_Data.oldPos[0], slots, count, px );
+	PSys_StoreLanes_sse( PSys_Data.oldPos[1], slots, count, py );
+	PSys_StoreLanes_sse( PSys_Data.oldPos[2], slots, count, pz );
+	PSys_StoreLanes_sse( PSys_Data.pos[0], slots, count, tx );
+	PSys_StoreLanes_sse( PSys_Data.pos[1], slots, count, ty );
+	PSys_StoreLanes_sse( PSys_Data.pos[2], slots, count, tz );
+}
+
+#endif // PSYS_SSE
+
+/*
+========================
+PSys_IntegrateBatch
+========================
+  Accumulates forces and integrates the gathered particles of a system
+  in blocks of PSYS_BLOCK_SIZE. Builds without SSE run the scalar
+  functions over each block instead.
+*/
+static void PSys_IntegrateBatch( PSys_System_t *system, int count, float timeStepSquare, float timeStepCorrected ) {
+	int		i, j, blockCount;
+
+	if ( !count ) {
+		return;
+	}
+
+	// Pad the last block by repeating the last slot. The padding lanes are never stored.
+	for ( i = count; i < count + PSYS_BLOCK_SIZE; i++ ) {
+		PSys_Batch[i] = PSys_Batch[count - 1];
+	}
+
+	for ( i = 0; i < count; i += PSYS_BLOCK_SIZE ) {
+		blockCount = count - i;
+		if ( blockCount > PSYS_BLOCK_SIZE ) {
+			blockCount = PSYS_BLOCK_SIZE;
+		}
+
+#if PSYS_SSE
+		PSys_IntegrateBlock_sse( system, &PSys_Batch[i], blockCount, timeStepSquare, timeStepCorrected );
+		for ( j = 0; j < blockCount; j++ ) {
+			PSys_UpdateRayOrigin( PSys_BatchParticles[i + j] );
+		}
+#else
+		for ( j = 0; j < blockCount; j++ ) {
+			PSys_AccumulateParticle( system, PSys_Batch[i + j] );
+			PSys_IntegrateParticle( PSys_BatchParticles[i + j], timeStepSquare, timeStepCorrected );
+		}
+#endif
 	}
 }
 
@@ -917,7 +1321,7 @@ static qboolean PSys_ApplyConstraint( PSys_System_t *system, PSys_Constraint_t *
 static qboolean PSys_ApplyDistanceMaxConstraint( PSys_System_t *system, float value ) {
 	PSys_Particle_t		*pt1, *pt2, *next1, *next2, *minDistPt = NULL;
 	float				dist, tempDist;
-	vec3_t				dir;
+	vec3_t				dir, pos1, pos2, minDistPos;
 	qboolean			retval;	
 
 	retval = qtrue;
@@ -929,15 +1333,17 @@ static qboolean PSys_ApplyDistanceMaxConstraint( PSys_System_t *system, float va
 		// not yet been affected by the constraint.
 		// NOTE: This last bit is important! Otherwise the particles
 		//       will form seperate clusters instead of one cluster!
+		PSys_GetPosition( pt1, pos1 );
 		pt2 = next1;
 		dist = -1; // Start with 'infinite' distance
 		for ( ; pt2 != &(system->particles) ; pt2 = next2 ) {
 			next2 = pt2->prev_local;
 			
+			PSys_GetPosition( pt2, pos2 );
 			if ( dist == -1 ) {
-				dist = Distance( pt1->position, pt2->position );
+				dist = Distance( pos1, pos2 );
 				minDistPt = pt2;
-			} else if ( dist > ( tempDist = Distance( pt1->position, pt2->position ))) {
+			} else if ( dist > ( tempDist = Distance( pos1, pos2 ))) {
 				dist = tempDist;
 				minDistPt = pt2;
 			}			
@@ -950,12 +1356,15 @@ static qboolean PSys_ApplyDistanceMaxConstraint( PSys_System_t *system, float va
 		// If the minimum distance to another particle in the system is greater than the
 		// distance allowed by the constraint, ...
 		if ( dist > value && minDistPt) {
-			VectorSubtract( pt1->position, minDistPt->position, dir );
+			PSys_GetPosition( minDistPt, minDistPos );
+			VectorSubtract( pos1, minDistPos, dir );
 			VectorNormalize( dir );
 			// ... slide both half the distance overshoot closer together and ...
 			dist = (dist - value) / 2.0f;
-			VectorMA( pt1->position, -dist, dir, pt1->position );
-			VectorMA( minDistPt->position, dist, dir, minDistPt->position );
+			VectorMA( pos1, -dist, dir, pos1 );
+			VectorMA( minDistPos, dist, dir, minDistPos );
+			PSys_SetPosition( pt1, pos1 );
+			PSys_SetPosition( minDistPt, minDistPos );
 
 			// ... report a constraint violation.
 			retval = qfalse;
@@ -969,7 +1378,7 @@ static qboolean PSys_ApplyDistanceMaxConstraint( PSys_System_t *system, float va
 static qboolean PSys_ApplyDistanceMinConstraint( PSys_System_t *system, float value ) {
 	PSys_Particle_t		*pt1, *pt2, *next1, *next2, *minDistPt = NULL;
 	float				dist, tempDist;
-	vec3_t				dir;
+	vec3_t				dir, pos1, pos2, minDistPos;
 	qboolean			retval;	
 
 	retval = qtrue;
@@ -981,15 +1390,17 @@ static qboolean PSys_ApplyDistanceMinConstraint( PSys_System_t *system, float va
 		// not yet been affected by the constraint.
 		// NOTE: This last bit is important! Otherwise the particles
 		//       will form seperate clusters instead of one cluster!
+		PSys_GetPosition( pt1, pos1 );
 		pt2 = next1;
 		dist = -1; // Start with 'infinite' distance
 		for ( ; pt2 != &(system->particles) ; pt2 = next2 ) {
 			next2 = pt2->prev_local;
 			
+			PSys_GetPosition( pt2, pos2 );
 			if ( dist == -1 ) {
-				dist = Distance( pt1->position, pt2->position );
+				dist = Distance( pos1, pos2 );
 				minDistPt = pt2;
-			} else if ( dist > ( tempDist = Distance( pt1->position, pt2->position ))) {
+			} else if ( dist > ( tempDist = Distance( pos1, pos2 ))) {
 				dist = tempDist;
 				minDistPt = pt2;
 			}			
@@ -1002,12 +1413,15 @@ static qboolean PSys_ApplyDistanceMinConstraint( PSys_System_t *system, float va
 		// If the minimum distance to another particle in the system is less than the
 		// distance allowed by the constraint, ...
 		if ( dist < value && minDistPt) {
-			VectorSubtract( pt1->position, minDistPt->position, dir );
+			PSys_GetPosition( minDistPt, minDistPos );
+			VectorSubtract( pos1, minDistPos, dir );
 			VectorNormalize( dir );
 			// ... slide both half the distance overshoot closer together and ...
 			dist = (dist - value) / 2.0f;
-			VectorMA( pt1->position, dist, dir, pt1->position );
-			VectorMA( minDistPt->position, -dist, dir, minDistPt->position );
+			VectorMA( pos1, dist, dir, pos1 );
+			VectorMA( minDistPos, -dist, dir, minDistPos );
+			PSys_SetPosition( pt1, pos1 );
+			PSys_SetPosition( minDistPt, minDistPos );
 
 			// ... report a constraint violation.
 			retval = qfalse;
@@ -1021,7 +1435,7 @@ static qboolean PSys_ApplyDistanceMinConstraint( PSys_System_t *system, float va
 static qboolean PSys_ApplyDistanceConstraint( PSys_System_t *system, float value ) {
 	PSys_Particle_t		*pt1, *pt2, *next1, *next2;
 	float				dist;
-	vec3_t				dir;
+	vec3_t				dir, pos1, pos2;
 	qboolean			retval;	
 
 	retval = qtrue;
@@ -1029,21 +1443,25 @@ static qboolean PSys_ApplyDistanceConstraint( PSys_System_t *system, float value
 	for ( ; pt1 != &(system->particles) ; pt1 = next1 ) {
 		next1 = pt1->prev_local;
 		
+		PSys_GetPosition( pt1, pos1 );
 		pt2 = next1;
 		for ( ; pt2 != &(system->particles) ; pt2 = next2 ) {
 			next2 = pt2->prev_local;
 		
 			// Determine distance between particles
-			dist = Distance( pt1->position, pt2->position );
+			PSys_GetPosition( pt2, pos2 );
+			dist = Distance( pos1, pos2 );
 			
 			// If distance doesn't match constraint
 			if ( dist != value ) {
-				VectorSubtract( pt1->position, pt2->position, dir );
+				VectorSubtract( pos1, pos2, dir );
 				VectorNormalize( dir );
 				// ... slide both half the distance overshoot closer together and ...
 				dist = (dist - value) / 2.0f;
-				VectorMA( pt1->position, dist, dir, pt1->position );
-				VectorMA( pt2->position, -dist, dir, pt2->position );
+				VectorMA( pos1, dist, dir, pos1 );
+				VectorMA( pos2, -dist, dir, pos2 );
+				PSys_SetPosition( pt1, pos1 );
+				PSys_SetPosition( pt2, pos2 );
 
 				// ... report a constraint violation.
 				retval = qfalse;
@@ -1059,6 +1477,7 @@ static qboolean PSys_ApplyPlaneConstraint( PSys_System_t *system, float value )
 	PSys_Particle_t	*particle, *next;
 	qboolean		retval;
 	trace_t			trace;
+	vec3_t			position, oldPosition;
 
 	retval = qtrue;
 	particle = system->particles.prev_local;
@@ -1068,10 +1487,12 @@ static qboolean PSys_ApplyPlaneConstraint( PSys_System_t *system, float value )
 
 		// Find out if there were any collisions during the bit of movement the particle
 		// experienced this frame.
-		CG_Trace( &trace, particle->oldPosition, NULL, NULL, particle->position, -1, CONTENTS_SOLID );
+		PSys_GetPosition( particle, position );
+		PSys_GetOldPosition( particle, oldPosition );
+		CG_Trace( &trace, oldPosition, NULL, NULL, position, -1, CONTENTS_SOLID );
 		if ( trace.startsolid || trace.allsolid ) {
 			// make sure the entityNum is set to the one we're stuck in
-			CG_Trace( &trace, particle->position, NULL, NULL, particle->position, -1, CONTENTS_SOLID );
+			CG_Trace( &trace, position, NULL, NULL, position, -1, CONTENTS_SOLID );
 			trace.fraction = 0.0f;
 		}
 
@@ -1106,7 +1527,7 @@ static qboolean PSys_ApplyPlaneConstraint( PSys_System_t *system, float value )
 
 				if (VectorLength( v ) > 0.0 && VectorLength( v ) < 0.6){
 					VectorSet(v, 0, 0, 0);
-					particle->mass = 0.0f;
+					PSys_Data.mass[PSYS_SLOT( particle )] = 0.0f;
 				}
 
 				if ( cg_particlesStop.value ) {
@@ -1117,8 +1538,9 @@ static qboolean PSys_ApplyPlaneConstraint( PSys_System_t *system, float value )
 
 			// NOTE: Though a bit inaccurate, we have to perform this shift of the particle's
 			//       position to prevent a trace.startsolid when re-evaluating constraints.
-			VectorAdd( trace.endpos, trace.plane.normal, particle->position );
-			VectorAdd( particle->position, v, particle->position );
+			VectorAdd( trace.endpos, trace.plane.normal, position );
+			VectorAdd( position, v, position );
+			PSys_SetPosition( particle, position );
 
 			// Set the new velocity
 			PSys_SetParticleVelocity( particle, v );
@@ -1145,7 +1567,7 @@ static qboolean PSys_ApplyPlaneConstraint( PSys_System_t *system, float value )
 static void PSys_UpdateSystems( void ) {
 	PSys_System_t	*system, *next;
 	float			timeStep, timeStepSquare, timeStepCorrected;
-	int				iterations;
+	int				iterations, count;
 
 	// Set the current timesteps
 	timeStep = cg.frametime * 0.01f;
@@ -1174,8 +1596,13 @@ static void PSys_UpdateSystems( void ) {
 		}
 		
 		// Accumulate forces and integrate new position
-		PSys_AccumulateSystem( system );
-		PSys_IntegrateSystem( system, timeStepSquare, timeStepCorrected );
+		count = PSys_GatherSystem( system );
+		if ( cg_particlesBatch.integer ) {
+			PSys_IntegrateBatch( system, count, timeStepSquare, timeStepCorrected );
+		} else {
+			PSys_AccumulateSystem( system, count );
+			PSys_IntegrateSystem( count, timeStepSquare, timeStepCorrected );
+		}
 		
 		// Apply constraints
 		iterations = 0;
@@ -1202,6 +1629,7 @@ static void PSys_RenderSystems( void ) {
 	float			lerpedScale;
 
 	vec3_t			angles;
+	vec3_t			position, oldPosition;
 
 	system = PSys_Systems_inuse.prev;
 	for ( ; system != &(PSys_Systems_inuse) ; system = next_s ) {
@@ -1215,6 +1643,9 @@ static void PSys_RenderSystems( void ) {
 
 			lifetime_end = particle->lifeTime;
 			lifetime_cur = cg.time - particle->spawnTime;
+
+			PSys_GetPosition( particle, position );
+			PSys_GetOldPosition( particle, oldPosition );
 			
 			lerpedScale = particle->scale.midVal;			
 			lerpedRGBA[0] = particle->rgba.midVal[0];
@@ -1308,16 +1739,16 @@ static void PSys_RenderSystems( void ) {
 			switch ( particle->rType ) {
 			case RTYPE_DEFAULT:
 				memset( &ent, 0, sizeof( ent ));
-				VectorCopy( particle->position, ent.origin );
+				VectorCopy( position, ent.origin );
 
 				if ( !particle->model ) {
 					ent.reType = RT_SPRITE;
 					ent.radius = lerpedScale;
 
-					if (particle->oldPosition != particle->position){
-						if ((lerpedRotation[0] || lerpedRotation[1] || lerpedRotation[2]) > 0){ 
-							ent.rotation = particle->position[0];
-						}
+					// NOTE: This used to be guarded by comparing the addresses of the position
+					//       and oldPosition arrays, which was always true.
+					if ((lerpedRotation[0] || lerpedRotation[1] || lerpedRotation[2]) > 0){ 
+						ent.rotation = position[0];
 					}
 
 				} else {
@@ -1326,16 +1757,14 @@ static void PSys_RenderSystems( void ) {
 
 					AxisClear( ent.axis );
 
-					if (particle->oldPosition != particle->position){
-						if (lerpedRotation[0]){ 
-							lerpedRotation[0] = particle->position[0]/* * lerpedRotation[0] / 100*/;
-						}
-						if (lerpedRotation[1]){ 
-							lerpedRotation[1] = particle->position[1]/* * lerpedRotation[1] / 100*/;
-						}
-						if (lerpedRotation[2]){ 
-							lerpedRotation[2] = particle->position[2]/* * lerpedRotation[2] / 100*/;
-						}
+					if (lerpedRotation[0]){ 
+						lerpedRotation[0] = position[0]/* * lerpedRotation[0] / 100*/;
+					}
+					if (lerpedRotation[1]){ 
+						lerpedRotation[1] = position[1]/* * lerpedRotation[1] / 100*/;
+					}
+					if (lerpedRotation[2]){ 
+						lerpedRotation[2] = position[2]/* * lerpedRotation[2] / 100*/;
 					}
 
 					VectorCopy( lerpedRotation, angles );
@@ -1357,11 +1786,11 @@ static void PSys_RenderSystems( void ) {
 				break;
 			
 			case RTYPE_SPARK:
-				CG_DrawLineRGBA( particle->oldPosition, particle->position, lerpedScale, particle->shader, lerpedRGBA );
+				CG_DrawLineRGBA( oldPosition, position, lerpedScale, particle->shader, lerpedRGBA );
 				break;
 
 			case RTYPE_RAY:
-				CG_DrawLineRGBA( particle->rayOrigin, particle->position, lerpedScale, particle->shader, lerpedRGBA );
+				CG_DrawLineRGBA( particle->rayOrigin, position, lerpedScale, particle->shader, lerpedRGBA );
 				break;
 
 			default:
@@ -1378,6 +1807,124 @@ void CG_AddParticleSystems( void ) {
 }
 
 
+static void PSys_FreeAllSystems( void ) {
+	while ( PSys_Systems_inuse.prev != &PSys_Systems_inuse ) {
+		PSys_FreeSystem( PSys_Systems_inuse.prev );
+	}
+}
+
+/*
+========================
+CG_ParticleBenchmark_f
+========================
+  Spawns copies of a cached particle system in front of the view and
+  runs a fixed number of frames of PSys_UpdateSystems on them, once
+  through the batched integrator and once through the scalar one.
+  Reports the time taken by each pass and the largest difference
+  between the particle positions both passes ended up with.
+
+  usage: psysbench <system> [copies] [frames]
+*/
+void CG_ParticleBenchmark_f( void ) {
+	PSys_Particle_t	*particle;
+	char			systemName[MAX_QPATH];
+	vec3_t			origin;
+	int				copies, frames;
+	int				pass, i, n, slot, start;
+	int				msec[2], alive[2];
+	int				savedTime, savedFrametime, savedBatch;
+	float			savedTimeStep, delta, maxDelta;
+
+	if ( trap_Argc() < 2 ) {
+		CG_Printf( "usage: psysbench <system> [copies] [frames]\n" );
+		return;
+	}
+
+	Q_strncpyz( systemName, CG_Argv( 1 ), sizeof( systemName ));
+	copies = ( trap_Argc() > 2 ) ? atoi( CG_Argv( 2 )) : 32;
+	frames = ( trap_Argc() > 3 ) ? atoi( CG_Argv( 3 )) : 300;
+	if ( copies < 1 ) copies = 1;
+	if ( copies > MAX_PARTICLESYSTEMS ) copies = MAX_PARTICLESYSTEMS;
+	if ( frames < 1 ) frames = 1;
+
+	if ( !PSys_LoadSystemFromCache( systemName )) {
+		CG_Printf( S_COLOR_YELLOW "WARNING: '%s': can not find particle system\n", systemName );
+		return;
+	}
+
+	savedTime = cg.time;
+	savedFrametime = cg.frametime;
+	savedTimeStep = PSys_LastTimeStep;
+	savedBatch = cg_particlesBatch.integer;
+
+	PSys_FreeAllSystems();
+
+	maxDelta = 0;
+	for ( pass = 0; pass < 2; pass++ ) {
+		cg_particlesBatch.integer = ( pass == 0 );
+		cg.time = savedTime;
+		PSys_LastTimeStep = 1;
+
+		// Both passes must spawn the exact same particles
+		srand( 1337 );
+		for ( i = 0; i < copies; i++ ) {
+			VectorMA( cg.refdef.vieworg, 128 + 16 * i, cg.refdef.viewaxis[0], origin );
+			PSys_SpawnCachedSystem( systemName, origin, NULL, NULL, NULL, qfalse, qfalse );
+		}
+
+		start = trap_Milliseconds();
+		for ( i = 0; i < frames; i++ ) {
+			cg.frametime = BENCH_FRAMETIME;
+			cg.time += BENCH_FRAMETIME;
+			PSys_UpdateSystems();
+		}
+		msec[pass] = trap_Milliseconds() - start;
+
+		// The slots differ between passes, but the order of the active list does not
+		n = 0;
+		particle = PSys_Particles_inuse.next;
+		for ( ; particle != &PSys_Particles_inuse ; particle = particle->next, n++ ) {
+			slot = PSYS_SLOT( particle );
+
+			if ( pass == 0 ) {
+				PSys_BenchPos[0][n] = PSys_Data.pos[0][slot];
+				PSys_BenchPos[1][n] = PSys_Data.pos[1][slot];
+				PSys_BenchPos[2][n] = PSys_Data.pos[2][slot];
+				continue;
+			}
+
+			if ( n >= alive[0] ) {
+				continue;
+			}
+
+			for ( i = 0; i < 3; i++ ) {
+				delta = fabs( PSys_Data.pos[i][slot] - PSys_BenchPos[i][n] );
+				if ( delta > maxDelta ) {
+					maxDelta = delta;
+				}
+			}
+		}
+		alive[pass] = n;
+
+		PSys_FreeAllSystems();
+	}
+
+	cg.time = savedTime;
+	cg.frametime = savedFrametime;
+	PSys_LastTimeStep = savedTimeStep;
+	cg_particlesBatch.integer = savedBatch;
+
+	CG_Printf( "%i x '%s', %i frames (%s integrator)\n", copies, systemName, frames, PSYS_SSE ? "SSE" : "C" );
+	CG_Printf( "batched: %5i msec, %i particles left\n", msec[0], alive[0] );
+	CG_Printf( "scalar:  %5i msec, %i particles left\n", msec[1], alive[1] );
+	if ( alive[0] != alive[1] ) {
+		CG_Printf( S_COLOR_YELLOW "WARNING: passes ended with a different number of particles\n" );
+	} else {
+		CG_Printf( "largest position difference: %g\n", maxDelta );
+	}
+}
+
+
 /*
 ========================
 PSys_SpawnCachedSystem
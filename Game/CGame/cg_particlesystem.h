@@ -3,13 +3,14 @@
 // cg_particlesystem.h -- particle system headers
 
 
-#define MAX_PARTICLES			  1024
+#define MAX_PARTICLES			 10240
 #define MAX_PARTICLESYSTEMS		   128
 #define MAX_EMITTERS			   256
 #define MAX_FORCES				   256
 #define MAX_CONSTRAINTS			   256
 #define MAX_PARTICLE_TEMPLATES	     3
 #define MAX_PARTICLESYSTEM_MEMBERS   8
+#define PSYS_BLOCK_SIZE				 4	// Particles integrated per step by the batched integrator
 
 typedef enum {
 	CTYPE_DISTANCE_MAX,
@@ -184,15 +185,11 @@ typedef struct PSys_Particle_s {
 	struct PSys_Particle_s	*prev, *next; // Singly or doubly linked list of particles
 	struct PSys_Particle_s	*prev_local, *next_local; // Same, but local within the system
 
-	// Position and movement
-	vec3_t		position;
-	vec3_t		oldPosition;
-	vec3_t		forceAccum;
-	vec3_t		accelAccum;	
+	// NOTE: Position, movement and mass are not stored here, but in the
+	//       structure-of-arrays pool in cg_particlesystem.c, indexed by
+	//       the particle's slot in the particle array.
 
 	// Properties
-	float		mass;
-	float		invMass;		// Inverse mass
 	int			lifeTime;
 	int			spawnTime;
 	
@@ -48,6 +48,7 @@ char	*cg_customSoundNames[MAX_CUSTOM_SOUNDS] = {
 //       WTF is up with this stupid bug anyway?! Same thing happened when adding
 //       certain fields to centity_t...
 static playerEntity_t	playerInfoDuplicate[MAX_GENTITIES];
+static int				cg_tagTorso, cg_tagHead;	// registered by CG_InitTagNames
 /*================
 CG_CustomSound
 ================*/
@@ -983,7 +984,7 @@ void CG_Player( centity_t *cent ) {
 	VectorScale(legs.axis[0],meshScale,legs.axis[0]);
 	VectorScale(legs.axis[1],meshScale,legs.axis[1]);
 	VectorScale(legs.axis[2],meshScale,legs.axis[2]);
-	CG_PositionRotatedEntityOnTag( &torso, &legs, legs.hModel, "tag_torso");
+	CG_PositionRotatedEntityOnTagIndex( &torso, &legs, legs.hModel, CG_ClientTagIndex( ci, legs.hModel, cg_tagTorso ) );
 	VectorScale(torso.axis[0],1/meshScale,torso.axis[0]);
 	VectorScale(torso.axis[1],1/meshScale,torso.axis[1]);
 	VectorScale(torso.axis[2],1/meshScale,torso.axis[2]);
@@ -994,7 +995,7 @@ void CG_Player( centity_t *cent ) {
 	head.customSkin = ci->tierConfig[tier].headSkinDamaged[damageTextureState];
 	if(!head.hModel){return;}
 	VectorCopy( cent->lerpOrigin, head.lightingOrigin );
-	CG_PositionRotatedEntityOnTag( &head, &torso, torso.hModel, "tag_head");
+	CG_PositionRotatedEntityOnTagIndex( &head, &torso, torso.hModel, CG_ClientTagIndex( ci, torso.hModel, cg_tagHead ) );
 	head.shadowPlane = shadowPlane;
 	head.renderfx = renderfx;
 	VectorCopy(cent->lerpOrigin,camera.origin);
@@ -1004,7 +1005,7 @@ void CG_Player( centity_t *cent ) {
 	camera.shadowPlane = shadowPlane;
 	camera.renderfx = renderfx;
 	VectorCopy (camera.origin, camera.oldorigin);	// don't positionally lerp at all
-	CG_PositionRotatedEntityOnTag( &camera, &torso, torso.hModel, "tag_torso");
+	CG_PositionRotatedEntityOnTagIndex( &camera, &torso, torso.hModel, CG_ClientTagIndex( ci, torso.hModel, cg_tagTorso ) );
 	CG_AddRefEntityWithPowerups( &legs, &cent->currentState, ci->team, ci->auraConfig[tier]->auraAlways );
 	CG_AddRefEntityWithPowerups( &torso, &cent->currentState, ci->team, ci->auraConfig[tier]->auraAlways );
 	CG_AddRefEntityWithPowerups( &head, &cent->currentState, ci->team, ci->auraConfig[tier]->auraAlways );
@@ -1047,162 +1048,128 @@ void CG_Player( centity_t *cent ) {
 	if(ci->auraConfig[tier]->showLightning){CG_LightningEffect(cent->lerpOrigin, ci, tier);}
 	if(ci->auraConfig[tier]->showLightning && ps->bitFlags & usingMelee){CG_BigLightningEffect(cent->lerpOrigin);}
 }
-qboolean CG_GetTagOrientationFromPlayerEntityHeadModel( centity_t *cent, char *tagName, orientation_t *tagOrient ) {
-	int				i, clientNum;
-	orientation_t	lerped;
-	vec3_t			tempAxis[3];
-	playerEntity_t	*pe;
-	if(cent->currentState.eType != ET_PLAYER || !tagName[0]){return qfalse;}
-	// The client number is stored in clientNum.  It can't be derived
-	// from the entity number, because a single client may have
-	// multiple corpses on the level using the same clientinfo
-	clientNum = cent->currentState.clientNum;
-	if ( clientNum < 0 || clientNum >= MAX_CLIENTS ) {
-		CG_Error( "Bad clientNum on player entity" );
-	}
-	// It is possible to see corpses from disconnected players that may
-	// not have valid clientinfo
-	if ( !cgs.clientinfo[clientNum].infoValid ) {
-		return qfalse;
-	}
-	// HACK: Use this copy, which is sure to be stored correctly, unlike
-	//       reading it from cg_entities, which tends to clear out its
-	//       fields every now and then. WTF?!
-	pe = &playerInfoDuplicate[clientNum];
-	// Prepare the destination orientation_t
-	AxisClear( tagOrient->axis );
-	// Try to find the tag and return its coordinates
-	if ( trap_R_LerpTag( &lerped, pe->headRef.hModel, pe->head.oldFrame, pe->head.frame, 1.0 - pe->head.backlerp, tagName ) ) {
-		VectorCopy( pe->headRef.origin, tagOrient->origin );
-		for ( i = 0 ; i < 3 ; i++ ) {
-			VectorMA( tagOrient->origin, lerped.origin[i], pe->headRef.axis[i], tagOrient->origin );
-		}
-		MatrixMultiply( tagOrient->axis, lerped.axis, tempAxis );
-		MatrixMultiply( tempAxis, pe->headRef.axis, tagOrient->axis );
-		return qtrue;
+/*
+=============================================================================
+
+TAG HANDLES
+
+Tag names are registered once into small integer handles. Each clientInfo_t
+then remembers the renderer's index of every handle on every model it
+lerped it on, so the per-frame tag lookups don't compare strings at all.
+
+=============================================================================
+*/
+
+#define	MAX_TAG_NAMES		256
+#define	TAG_NAME_HASH_SIZE	512		// must be a power of two
+
+static char		cg_tagNames[MAX_TAG_NAMES][MAX_QPATH];
+static int		cg_numTagNames = 1;		// 0 is the empty name
+static int		cg_tagNameHash[TAG_NAME_HASH_SIZE];
+
+/*
+===============
+CG_TagNameHash
+===============
+*/
+static int CG_TagNameHash( const char *tagName ) {
+	int		i;
+	int		hash;
+
+	hash = 0;
+	for ( i = 0 ; tagName[i] ; i++ ) {
+		hash += tagName[i] * ( i + 119 );
 	}
-	return qfalse;
+	hash = ( hash ^ ( hash >> 10 ) ^ ( hash >> 20 ) );
+	return hash & ( TAG_NAME_HASH_SIZE - 1 );
 }
 
-qboolean CG_GetTagOrientationFromPlayerEntityTorsoModel( centity_t *cent, char *tagName, orientation_t *tagOrient ) {
-	int				i, clientNum;
-	orientation_t	lerped;
-	vec3_t			tempAxis[3];
-	playerEntity_t	*pe;
-	if(cent->currentState.eType != ET_PLAYER || !tagName[0]){return qfalse;}
-	// The client number is stored in clientNum.  It can't be derived
-	// from the entity number, because a single client may have
-	// multiple corpses on the level using the same clientinfo
-	clientNum = cent->currentState.clientNum;
-	if ( clientNum < 0 || clientNum >= MAX_CLIENTS ) {
-		CG_Error( "Bad clientNum on player entity" );
-	}
-	// It is possible to see corpses from disconnected players that may
-	// not have valid clientinfo
-	if ( !cgs.clientinfo[clientNum].infoValid ) {
-		return qfalse;
+/*
+===============
+CG_RegisterTagName
+
+Returns the handle for a tag name, 0 if it is empty or there's no room left
+===============
+*/
+int CG_RegisterTagName( const char *tagName ) {
+	int		slot;
+	int		name;
+
+	if ( !tagName || !tagName[0] ) {
+		return 0;
 	}
-	// HACK: Use this copy, which is sure to be stored correctly, unlike
-	//       reading it from cg_entities, which tends to clear out its
-	//       fields every now and then. WTF?!
-	pe = &playerInfoDuplicate[clientNum];
-	// Prepare the destination orientation_t
-	AxisClear( tagOrient->axis );
-	// Try to find the tag and return its coordinates
-	if ( trap_R_LerpTag( &lerped, pe->torsoRef.hModel, pe->torso.oldFrame, pe->torso.frame, 1.0 - pe->torso.backlerp, tagName ) ) {
-		VectorCopy( pe->torsoRef.origin, tagOrient->origin );
-		for ( i = 0 ; i < 3 ; i++ ) {
-			VectorMA( tagOrient->origin, lerped.origin[i], pe->torsoRef.axis[i], tagOrient->origin );
-		}
-		MatrixMultiply( tagOrient->axis, lerped.axis, tempAxis );
-		MatrixMultiply( tempAxis, pe->torsoRef.axis, tagOrient->axis );
 
-		return qtrue;
-	}/* else if(pe->torsoRef.renderfx & RF_SKEL) {
-		for(i=0;i<pe->torsoRef.skel.numBones;i++)
-		{
-			if(!strcmp(pe->torsoRef.skel.bones[i].name,tagName))
-			{
-				VectorCopy(pe->torsoRef.skel.bones[i].origin,lerped.origin);
-				VectorCopy(pe->torsoRef.skel.bones[i].axis[0],lerped.axis[0]);
-				VectorCopy(pe->torsoRef.skel.bones[i].axis[1],lerped.axis[1]);
-				VectorCopy(pe->torsoRef.skel.bones[i].axis[2],lerped.axis[2]);
-			}
+	for ( slot = CG_TagNameHash( tagName ) ; ; slot = ( slot + 1 ) & ( TAG_NAME_HASH_SIZE - 1 ) ) {
+		name = cg_tagNameHash[slot];
+		if ( !name ) {
+			break;
 		}
-		VectorCopy( pe->headRef.origin, tagOrient->origin );
-		for ( i = 0 ; i < 3 ; i++ ) {
-			VectorMA( tagOrient->origin, lerped.origin[i], pe->headRef.axis[i], tagOrient->origin );
+		if ( !strcmp( cg_tagNames[name], tagName ) ) {
+			return name;
 		}
+	}
 
-		MatrixMultiply( tagOrient->axis, lerped.axis, tempAxis );
-		MatrixMultiply( tempAxis, pe->headRef.axis, tagOrient->axis );
-		return qtrue;
-	}*/
-	return qfalse;
+	if ( cg_numTagNames == MAX_TAG_NAMES ) {
+		CG_Printf( "^3CG_RegisterTagName: MAX_TAG_NAMES hit on '%s'\n", tagName );
+		return 0;
+	}
+
+	name = cg_numTagNames++;
+	Q_strncpyz( cg_tagNames[name], tagName, sizeof( cg_tagNames[name] ) );
+	cg_tagNameHash[slot] = name;
+	return name;
 }
 
-qboolean CG_GetTagOrientationFromPlayerEntityLegsModel( centity_t *cent, char *tagName, orientation_t *tagOrient ) {
-	int				i, clientNum;
-	orientation_t	lerped;
-	vec3_t			tempAxis[3];
-	playerEntity_t	*pe;
-	if(cent->currentState.eType != ET_PLAYER || !tagName[0]){return qfalse;}
-	// The client number is stored in clientNum.  It can't be derived
-	// from the entity number, because a single client may have
-	// multiple corpses on the level using the same clientinfo
-	clientNum = cent->currentState.clientNum;
-	if ( clientNum < 0 || clientNum >= MAX_CLIENTS ) {
-		CG_Error( "Bad clientNum on player entity" );
-	}
-	// It is possible to see corpses from disconnected players that may
-	// not have valid clientinfo
-	if ( !cgs.clientinfo[clientNum].infoValid ) {
-		return qfalse;
+/*
+===============
+CG_InitTagNames
+
+Registers the tags the player models are put together with
+===============
+*/
+void CG_InitTagNames( void ) {
+	cg_tagTorso = CG_RegisterTagName( "tag_torso" );
+	cg_tagHead = CG_RegisterTagName( "tag_head" );
+}
+
+/*
+===============
+CG_ClientTagIndex
+
+Returns the renderer's index of the tag on the model, -1 if it isn't there
+===============
+*/
+int CG_ClientTagIndex( clientInfo_t *ci, qhandle_t model, int tagName ) {
+	clientTag_t	*tag;
+
+	if ( !model || !tagName ) {
+		return -1;
 	}
-	// HACK: Use this copy, which is sure to be stored correctly, unlike
-	//       reading it from cg_entities, which tends to clear out its
-	//       fields every now and then. WTF?!
-	pe = &playerInfoDuplicate[clientNum];
-	// Prepare the destination orientation_t
-	AxisClear( tagOrient->axis );
-	// Try to find the tag and return its coordinates
-	if ( trap_R_LerpTag( &lerped, pe->legsRef.hModel, pe->legs.oldFrame, pe->legs.frame, 1.0 - pe->legs.backlerp, tagName ) ) {
-		VectorCopy( pe->legsRef.origin, tagOrient->origin );
-		for ( i = 0 ; i < 3 ; i++ ) {
-			VectorMA( tagOrient->origin, lerped.origin[i], pe->legsRef.axis[i], tagOrient->origin );
-		}
-		MatrixMultiply( tagOrient->axis, lerped.axis, tempAxis );
-		MatrixMultiply( tempAxis, pe->legsRef.axis, tagOrient->axis );
-		return qtrue;
-	}/* else if(pe->legsRef.renderfx & RF_SKEL) {
-		for(i=0;i<pe->legsRef.skel.numBones;i++)
-		{
-			if(!strcmp(pe->legsRef.skel.bones[i].name,tagName))
-			{
-				VectorCopy(pe->legsRef.skel.bones[i].origin,lerped.origin);
-				VectorCopy(pe->legsRef.skel.bones[i].axis[0],lerped.axis[0]);
-				VectorCopy(pe->legsRef.skel.bones[i].axis[1],lerped.axis[1]);
-				VectorCopy(pe->legsRef.skel.bones[i].axis[2],lerped.axis[2]);
-			}
-		}
-		VectorCopy( pe->headRef.origin, tagOrient->origin );
-		for ( i = 0 ; i < 3 ; i++ ) {
-			VectorMA( tagOrient->origin, lerped.origin[i], pe->headRef.axis[i], tagOrient->origin );
-		}
 
-		MatrixMultiply( tagOrient->axis, lerped.axis, tempAxis );
-		MatrixMultiply( tempAxis, pe->headRef.axis, tagOrient->axis );
-		return qtrue;
-	}*/
-	return qfalse;
+	tag = &ci->tags[( model * 131 + tagName ) & ( MAX_CLIENT_TAGS - 1 )];
+	if ( tag->model != model || tag->name != tagName ) {
+		tag->model = model;
+		tag->name = tagName;
+		tag->index = trap_R_RegisterTag( model, cg_tagNames[tagName] );
+	}
+	return tag->index;
 }
 
-qboolean CG_GetTagOrientationFromPlayerEntityCameraModel( centity_t *cent, char *tagName, orientation_t *tagOrient ) {
-	int				i, clientNum;
+/*
+===============
+CG_GetTagHandleOrientationFromPlayerPart
+
+Gets the orientation of a registered tag on one of the player's models.
+===============
+*/
+qboolean CG_GetTagHandleOrientationFromPlayerPart( centity_t *cent, playerPart_t part, int tagName, orientation_t *tagOrient ) {
+	int				i, clientNum, tagIndex;
 	orientation_t	lerped;
 	vec3_t			tempAxis[3];
 	playerEntity_t	*pe;
-	if(cent->currentState.eType != ET_PLAYER || !tagName[0]){return qfalse;}
+	refEntity_t		*ref;
+	lerpFrame_t		*lf;
+	if(cent->currentState.eType != ET_PLAYER || !tagName){return qfalse;}
 	// The client number is stored in clientNum.  It can't be derived
 	// from the entity number, because a single client may have
 	// multiple corpses on the level using the same clientinfo
@@ -1219,40 +1186,71 @@ qboolean CG_GetTagOrientationFromPlayerEntityCameraModel( centity_t *cent, char
 	//       reading it from cg_entities, which tends to clear out its
 	//       fields every now and then. WTF?!
 	pe = &playerInfoDuplicate[clientNum];
+	switch ( part ) {
+	case PLAYERPART_HEAD:
+		ref = &pe->headRef;
+		lf = &pe->head;
+		break;
+	case PLAYERPART_TORSO:
+		ref = &pe->torsoRef;
+		lf = &pe->torso;
+		break;
+	case PLAYERPART_LEGS:
+		ref = &pe->legsRef;
+		lf = &pe->legs;
+		break;
+	default:
+		ref = &pe->cameraRef;
+		lf = &pe->camera;
+		break;
+	}
 	// Prepare the destination orientation_t
 	AxisClear( tagOrient->axis );
 	// Try to find the tag and return its coordinates
-	if ( trap_R_LerpTag( &lerped, pe->cameraRef.hModel, pe->camera.oldFrame, pe->camera.frame, 1.0 - pe->camera.backlerp, tagName ) ) {
-		VectorCopy( pe->cameraRef.origin, tagOrient->origin );
+	tagIndex = CG_ClientTagIndex( &cgs.clientinfo[clientNum], ref->hModel, tagName );
+	if ( tagIndex >= 0 && trap_R_LerpTagIndex( &lerped, ref->hModel, lf->oldFrame, lf->frame, 1.0 - lf->backlerp, tagIndex ) ) {
+		VectorCopy( ref->origin, tagOrient->origin );
 		for ( i = 0 ; i < 3 ; i++ ) {
-			VectorMA( tagOrient->origin, lerped.origin[i], pe->cameraRef.axis[i], tagOrient->origin );
+			VectorMA( tagOrient->origin, lerped.origin[i], ref->axis[i], tagOrient->origin );
 		}
 		MatrixMultiply( tagOrient->axis, lerped.axis, tempAxis );
-		MatrixMultiply( tempAxis, pe->cameraRef.axis, tagOrient->axis );
+		MatrixMultiply( tempAxis, ref->axis, tagOrient->axis );
 		return qtrue;
-	}/* else if(pe->cameraRef.renderfx & RF_SKEL) {
-		for(i=0;i<pe->cameraRef.skel.numBones;i++)
-		{
-			if(!strcmp(pe->cameraRef.skel.bones[i].name,tagName))
-			{
-				VectorCopy(pe->cameraRef.skel.bones[i].origin,lerped.origin);
-				VectorCopy(pe->cameraRef.skel.bones[i].axis[0],lerped.axis[0]);
-				VectorCopy(pe->cameraRef.skel.bones[i].axis[1],lerped.axis[1]);
-				VectorCopy(pe->cameraRef.skel.bones[i].axis[2],lerped.axis[2]);
-			}
-		}
-		VectorCopy( pe->cameraRef.origin, tagOrient->origin );
-		for ( i = 0 ; i < 3 ; i++ ) {
-			VectorMA( tagOrient->origin, lerped.origin[i], pe->cameraRef.axis[i], tagOrient->origin );
-		}
+	}
+	return qfalse;
+}
 
-		MatrixMultiply( tagOrient->axis, lerped.axis, tempAxis );
-		MatrixMultiply( tempAxis, pe->cameraRef.axis, tagOrient->axis );
-		return qtrue;
-	}*/
+/*
+===============
+CG_GetTagHandleOrientationFromPlayerEntity
+
+Same as CG_GetTagOrientationFromPlayerEntity, with a registered tag name.
+===============
+*/
+qboolean CG_GetTagHandleOrientationFromPlayerEntity( centity_t *cent, int tagName, orientation_t *tagOrient ) {
+	if(CG_GetTagHandleOrientationFromPlayerPart(cent,PLAYERPART_TORSO,tagName,tagOrient)){return qtrue;}
+	if(CG_GetTagHandleOrientationFromPlayerPart(cent,PLAYERPART_HEAD,tagName,tagOrient)){return qtrue;}
+	if(CG_GetTagHandleOrientationFromPlayerPart(cent,PLAYERPART_LEGS,tagName,tagOrient)){return qtrue;}
+	if(CG_GetTagHandleOrientationFromPlayerPart(cent,PLAYERPART_CAMERA,tagName,tagOrient)){return qtrue;}
 	return qfalse;
 }
 
+qboolean CG_GetTagOrientationFromPlayerEntityHeadModel( centity_t *cent, char *tagName, orientation_t *tagOrient ) {
+	return CG_GetTagHandleOrientationFromPlayerPart( cent, PLAYERPART_HEAD, CG_RegisterTagName( tagName ), tagOrient );
+}
+
+qboolean CG_GetTagOrientationFromPlayerEntityTorsoModel( centity_t *cent, char *tagName, orientation_t *tagOrient ) {
+	return CG_GetTagHandleOrientationFromPlayerPart( cent, PLAYERPART_TORSO, CG_RegisterTagName( tagName ), tagOrient );
+}
+
+qboolean CG_GetTagOrientationFromPlayerEntityLegsModel( centity_t *cent, char *tagName, orientation_t *tagOrient ) {
+	return CG_GetTagHandleOrientationFromPlayerPart( cent, PLAYERPART_LEGS, CG_RegisterTagName( tagName ), tagOrient );
+}
+
+qboolean CG_GetTagOrientationFromPlayerEntityCameraModel( centity_t *cent, char *tagName, orientation_t *tagOrient ) {
+	return CG_GetTagHandleOrientationFromPlayerPart( cent, PLAYERPART_CAMERA, CG_RegisterTagName( tagName ), tagOrient );
+}
+
 /*
 ===============
 CG_GetTagOrientationFromPlayerEntity
@@ -1264,11 +1262,7 @@ true is returned.
 ===============
 */
 qboolean CG_GetTagOrientationFromPlayerEntity( centity_t *cent, char *tagName, orientation_t *tagOrient ) {
-	if(CG_GetTagOrientationFromPlayerEntityTorsoModel(cent,tagName,tagOrient)){return qtrue;}
-	if(CG_GetTagOrientationFromPlayerEntityHeadModel(cent,tagName,tagOrient)){return qtrue;}
-	if(CG_GetTagOrientationFromPlayerEntityLegsModel(cent,tagName,tagOrient)){return qtrue;}
-	if(CG_GetTagOrientationFromPlayerEntityCameraModel(cent,tagName,tagOrient)){return qtrue;}
-	return qfalse;
+	return CG_GetTagHandleOrientationFromPlayerEntity( cent, CG_RegisterTagName( tagName ), tagOrient );
 }
 
 //=====================================================================
@@ -185,6 +185,9 @@ typedef enum {
 	CG_FS_GETFILELIST,
 	CG_R_ADDFOGTOSCENE,
 	// -->
+	CG_R_REGISTERTAG,
+	CG_R_LERPTAGINDEX,
+	CG_PARALLELFOR,
 } cgameImport_t;
 
 
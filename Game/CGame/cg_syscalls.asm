@@ -104,4 +104,6 @@ equ	testPrintInt				-110
 equ	testPrintFloat				-111
 equ acos						-112
 equ	trap_FS_GetFileList				-113
-equ	trap_R_AddFogToScene				-114
\ No newline at end of file
+equ	trap_R_AddFogToScene				-114
+equ	trap_R_RegisterTag				-115
+equ	trap_R_LerpTagIndex				-116
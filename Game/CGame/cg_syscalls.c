@@ -304,6 +304,15 @@ int		trap_R_LerpTag( orientation_t *tag, clipHandle_t mod, int startFrame, int e
 	return syscall( CG_R_LERPTAG, tag, mod, startFrame, endFrame, PASSFLOAT(frac), tagName );
 }
 
+int		trap_R_RegisterTag( clipHandle_t mod, const char *tagName ) {
+	return syscall( CG_R_REGISTERTAG, mod, tagName );
+}
+
+int		trap_R_LerpTagIndex( orientation_t *tag, clipHandle_t mod, int startFrame, int endFrame, 
+					   float frac, int tagIndex ) {
+	return syscall( CG_R_LERPTAGINDEX, tag, mod, startFrame, endFrame, PASSFLOAT(frac), tagIndex );
+}
+
 void	trap_R_RemapShader( const char *oldShader, const char *newShader, const char *timeOffset ) {
 	syscall( CG_R_REMAP_SHADER, oldShader, newShader, timeOffset );
 }
@@ -450,3 +459,14 @@ qboolean trap_GetEntityToken( char *buffer, int bufferSize ) {
 qboolean trap_R_inPVS( const vec3_t p1, const vec3_t p2 ) {
 	return syscall( CG_R_INPVS, p1, p2 );
 }
+
+void trap_ParallelFor( void (*function)( void *data, int index ), void *data, int count, int batch ) {
+	int		i;
+
+	// the engine can only call back into a native library
+	if ( !syscall( CG_PARALLELFOR, function, data, count, batch ) ) {
+		for ( i = 0; i < count; i++ ) {
+			function( data, i );
+		}
+	}
+}
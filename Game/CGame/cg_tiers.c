@@ -1,13 +1,156 @@
 #include "cg_local.h"
+enum{
+	TF_MODEL = KF_CUSTOM,
+	TF_SKIN,
+	TF_SOUND,
+	TF_SHADER,			// "default" keeps the current shader
+	TF_MODEL_DAMAGED,
+	TF_SKIN_DAMAGED,
+	TF_SHADER_STATES,	// health percentage followed by a shader
+	TF_MUSIC,
+	TF_VECTOR,			// arg integers, missing values read as 0
+	TF_ZOOM
+};
+#define	TFOFS(x) ((size_t)&(((tierConfig_cg *)0)->x))
+static keyField_t tierFields[] = {
+	{"tierName",					TFOFS(name),						KF_STRING,	TIERNAMELENGTH},
+	{"powerLevelHudMultiplier",		TFOFS(hudMultiplier),				KF_FLOAT},
+	{"sustainCurrent",				TFOFS(sustainCurrent),				KF_INT},
+	{"sustainCurrentPercent",		TFOFS(sustainCurrentPercent),		KF_INT},
+	{"sustainMaximum",				TFOFS(sustainMaximum),				KF_INT},
+	{"sustainFatigue",				TFOFS(sustainFatigue),				KF_INT},
+	{"sustainHealth",				TFOFS(sustainHealth),				KF_INT},
+	{"requirementCurrent",			TFOFS(requirementCurrent),			KF_INT},
+	{"requirementCurrentPercent",	TFOFS(requirementCurrentPercent),	KF_INT},
+	{"requirementFatigue",			TFOFS(requirementFatigue),			KF_INT},
+	{"requirementMaximum",			TFOFS(requirementMaximum),			KF_INT},
+	{"requirementHealth",			TFOFS(requirementHealth),			KF_INT},
+	{"requirementHealthMaximum",	TFOFS(requirementHealthMaximum),	KF_INT},
+	{"transformSoundFirst",			TFOFS(soundTransformFirst),			TF_SOUND},
+	{"transformSoundUp",			TFOFS(soundTransformUp),			TF_SOUND},
+	{"transformSoundDown",			TFOFS(soundTransformDown),			TF_SOUND},
+	{"transformMusic",				TFOFS(transformMusic),				TF_MUSIC},
+	{"poweringUpSound",				TFOFS(soundPoweringUp),				TF_SOUND},
+	{"headModel",					TFOFS(headModel),					TF_MODEL},
+	{"torsoModel",					TFOFS(torsoModel),					TF_MODEL},
+	{"legsModel",					TFOFS(legsModel),					TF_MODEL},
+	{"cameraModel",					TFOFS(cameraModel),					TF_MODEL},
+	{"headSkin",					TFOFS(headSkin),					TF_SKIN},
+	{"torsoSkin",					TFOFS(torsoSkin),					TF_SKIN},
+	{"legsSkin",					TFOFS(legsSkin),					TF_SKIN},
+	{"headModelDamaged",			TFOFS(headModelDamaged),			TF_MODEL_DAMAGED},
+	{"torsoModelDamaged",			TFOFS(torsoModelDamaged),			TF_MODEL_DAMAGED},
+	{"legsModelDamaged",			TFOFS(legsModelDamaged),			TF_MODEL_DAMAGED},
+	{"headSkinDamaged",				TFOFS(headSkinDamaged),				TF_SKIN_DAMAGED},
+	{"torsoSkinDamaged",			TFOFS(torsoSkinDamaged),			TF_SKIN_DAMAGED},
+	{"legsSkinDamaged",				TFOFS(legsSkinDamaged),				TF_SKIN_DAMAGED},
+	{"damageFeatures",				TFOFS(damageFeatures),				KF_BOOLEAN},
+	{"damageModelsRevertHealed",	TFOFS(damageModelsRevertHealed),	KF_BOOLEAN},
+	{"damageTexturesRevertHealed",	TFOFS(damageTexturesRevertHealed),	KF_BOOLEAN},
+	{"icon2DShader",				TFOFS(icon2D),						TF_SHADER_STATES},
+	{"icon2DPoweringShader",		TFOFS(icon2DPowering),				TF_SHADER},
+	{"icon2DTransformingShader",	TFOFS(icon2DTransforming),			TF_SHADER},
+	{"icon3DOffset",				TFOFS(icon3DOffset),				TF_VECTOR,	2},
+	{"icon3DRotation",				TFOFS(icon3DRotation),				TF_VECTOR,	3},
+	{"icon3DSize",					TFOFS(icon3DSize),					TF_VECTOR,	2},
+	{"icon3DZoom",					TFOFS(icon3DZoom),					TF_ZOOM},
+	{"screenShader",				TFOFS(screenEffect),				TF_SHADER_STATES},
+	{"screenPoweringShader",		TFOFS(screenEffectPowering),		TF_SHADER},
+	{"screenTransformingShader",	TFOFS(screenEffectTransforming),	TF_SHADER},
+	{"crosshairShader",				TFOFS(crosshair),					TF_SHADER},
+	{"crosshairPoweringShader",		TFOFS(crosshairPowering),			TF_SHADER},
+	{"meshScale",					TFOFS(meshScale),					KF_FLOAT},
+	{"meshOffset",					TFOFS(meshOffset),					KF_INT},
+	{"cameraOffsetSlide",			TFOFS(cameraOffset[0]),				KF_INT},
+	{"cameraOffsetHeight",			TFOFS(cameraOffset[1]),				KF_INT},
+	{"cameraOffsetRange",			TFOFS(cameraOffset[2]),				KF_INT}
+};
+static const int numTierFields = ARRAY_LEN(tierFields);
+static keyFieldTable_t tierFieldTable;
+
+// Every tier is parsed once per cgame instance and copied out of this cache
+// for each client that uses the same (model, skin, tier).  The registered
+// handles stay valid until the renderer restarts, which also reloads cgame.
+#define MAX_TIER_CACHE 128
+typedef struct{
+	char			key[MAX_QPATH * 2];
+	int				hash;
+	qboolean		exists;
+	tierConfig_cg	config;
+}tierCache_cg;
+static tierCache_cg tierCache[MAX_TIER_CACHE];
+static int tierCacheCount;
+
+/*
+===============
+CG_ClearTierCache
+===============
+*/
+void CG_ClearTierCache(void){
+	if(!tierFieldTable.numFields){
+		BG_InitKeyFieldTable(&tierFieldTable,tierFields,numTierFields);
+	}
+	tierCacheCount = 0;
+}
+
+/*
+===============
+CG_LoadTier
+
+Fills in the config of one tier, returns qfalse if the tier has no icon
+and should be skipped.
+===============
+*/
+static qboolean CG_LoadTier(tierConfig_cg *tier,const char *modelName,const char *skinName,int tierIndex){
+	tierCache_cg *entry;
+	char tierPath[MAX_QPATH];
+	char filename[MAX_QPATH * 2];
+	char key[MAX_QPATH * 2];
+	qhandle_t tempShader;
+	int index;
+	int hash;
+	Com_sprintf(key,sizeof(key),"%s/%s/%i",modelName,skinName,tierIndex);
+	hash = 0;
+	for(index=0;key[index];++index){hash = hash * 31 + tolower(key[index]);}
+	for(index=0;index<tierCacheCount;++index){
+		entry = &tierCache[index];
+		if(entry->hash == hash && !Q_stricmp(entry->key,key)){
+			if(entry->exists){*tier = entry->config;}
+			return entry->exists;
+		}
+	}
+	if(tierCacheCount == MAX_TIER_CACHE){tierCacheCount = 0;}
+	entry = &tierCache[tierCacheCount++];
+	Q_strncpyz(entry->key,key,sizeof(entry->key));
+	entry->hash = hash;
+	entry->exists = qfalse;
+	Com_sprintf(tierPath,sizeof(tierPath),"players/%s/Tier%i/icon.png",modelName,tierIndex+1);
+	if(trap_FS_FOpenFile(tierPath,0,FS_READ) <= 0){return qfalse;}
+	entry->exists = qtrue;
+	memset(&entry->config,0,sizeof(tierConfig_cg));
+	tempShader = trap_R_RegisterShaderNoMip(tierPath);
+	for(index=0;index<10;++index){
+		entry->config.icon2D[index] = tempShader;
+		entry->config.screenEffect[index] = cgs.media.clearShader;
+	}
+	Com_sprintf(tierPath,sizeof(tierPath),"players/%s/Tier%i/transformScript.cfg",modelName,tierIndex+1);
+	if(trap_FS_FOpenFile(tierPath,0,FS_READ) > 0){
+		entry->config.transformScriptExists = qtrue;
+	}
+	parseTier("players/TierDefault.config",&entry->config);
+	Com_sprintf(filename,sizeof(filename),"players/%s/Tier%i/%s/Tier.config",modelName,tierIndex+1,skinName);
+	parseTier(filename,&entry->config);
+	*tier = entry->config;
+	return qtrue;
+}
+
 qboolean CG_RegisterClientModelnameWithTiers(clientInfo_t *ci, const char *modelName, const char *skinName){
-	int	i,index,partIndex,damageIndex,lastSkinIndex,lastModelIndex;
+	int	i,partIndex,damageIndex,lastSkinIndex,lastModelIndex;
 	char filename[MAX_QPATH * 2];
-	char tierPath[MAX_QPATH];
 	char tempPath[MAX_QPATH];
 	char legsPath[MAX_QPATH];
 	char headPath[MAX_QPATH];
 	char cameraPath[MAX_QPATH];
-	qhandle_t tempShader;
 	Com_sprintf(legsPath,sizeof(legsPath),"%s",modelName);
 	Com_sprintf(headPath,sizeof(headPath),"%s",modelName);
 	Com_sprintf(cameraPath,sizeof(cameraPath),"%s",modelName);
@@ -37,22 +180,7 @@ qboolean CG_RegisterClientModelnameWithTiers(clientInfo_t *ci, const char *model
 		// ===================================
 		// Config
 		// ===================================
-		Com_sprintf(tierPath,sizeof(tierPath),"players/%s/Tier%i/icon.png",modelName,i+1);
-		if(trap_FS_FOpenFile(tierPath,0,FS_READ) <= 0){continue;}
-		memset(&ci->tierConfig[i],0,sizeof(tierConfig_cg));
-		tempShader = trap_R_RegisterShaderNoMip(tierPath);
-		for(index=0;index<10;++index){
-			ci->tierConfig[i].icon2D[index] = tempShader; 
-			ci->tierConfig[i].screenEffect[index] = cgs.media.clearShader;
-		}
-		Com_sprintf(tierPath,sizeof(tierPath),"players/%s/Tier%i/transformScript.cfg",modelName,i+1);
-		if(trap_FS_FOpenFile(tierPath,0,FS_READ) > 0){
-			ci->tierConfig[i].transformScriptExists = qtrue;
-		}
-		Com_sprintf(filename,sizeof(filename),"players/TierDefault.config");
-		parseTier(filename,&ci->tierConfig[i]);
-		Com_sprintf(filename,sizeof(filename),"players/%s/Tier%i/%s/Tier.config",modelName,i+1,skinName);
-		parseTier(filename,&ci->tierConfig[i]);
+		if(!CG_LoadTier(&ci->tierConfig[i],modelName,skinName,i)){continue;}
 		// ===================================
 		// Models
 		// ===================================
@@ -151,338 +279,91 @@ qboolean CG_RegisterClientModelnameWithTiers(clientInfo_t *ci, const char *model
 }
 void parseTier(char *path,tierConfig_cg *tier){
 	fileHandle_t tierCFG;
+	keyField_t *field;
 	char *token,*parse;
 	int fileLength;
 	int tokenInt;
+	int index;
 	char fileContents[32000];
-	if(trap_FS_FOpenFile(path,0,FS_READ)>0){
-		fileLength = trap_FS_FOpenFile(path,&tierCFG,FS_READ);
-		trap_FS_Read(fileContents,fileLength,tierCFG);
-		fileContents[fileLength] = 0;
+	fileLength = trap_FS_FOpenFile(path,&tierCFG,FS_READ);
+	if(!tierCFG){return;}
+	if(fileLength <= 0 || fileLength >= sizeof(fileContents)){
 		trap_FS_FCloseFile(tierCFG);
-		parse = fileContents;
-		while(1){
+		return;
+	}
+	trap_FS_Read(fileContents,fileLength,tierCFG);
+	fileContents[fileLength] = 0;
+	trap_FS_FCloseFile(tierCFG);
+	parse = fileContents;
+	while(1){
+		token = COM_Parse(&parse);
+		if(!token[0]){break;}
+		field = BG_FindKeyField(&tierFieldTable,token);
+		if(!field){continue;}
+		if(field->type < KF_CUSTOM){
+			if(!BG_ParseKeyField(field,(byte*)tier,&parse)){break;}
+			continue;
+		}
+		switch(field->type){
+		case TF_MODEL:
+		case TF_SKIN:
+		case TF_SOUND:
+		case TF_SHADER:
 			token = COM_Parse(&parse);
-			if(!token[0]){break;}
-			else if(!Q_stricmp(token,"tierName")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				Q_strncpyz(tier->name, token, sizeof(tier->name));
-			}
-			else if(!Q_stricmp(token,"powerLevelHudMultiplier")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->hudMultiplier = atof(token);
-			}
-			else if(!Q_stricmp(token,"sustainCurrent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainCurrent = atoi(token);
-			}
-			else if(!Q_stricmp(token,"sustainCurrentPercent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainCurrentPercent = atoi(token);
-			}
-			else if(!Q_stricmp(token,"sustainMaximum")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainMaximum = atoi(token);
-			}
-			else if(!Q_stricmp(token,"sustainFatigue")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainFatigue = atoi(token);
-			}
-			else if(!Q_stricmp(token,"sustainHealth")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainHealth = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementCurrent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementCurrent = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementCurrentPercent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementCurrentPercent = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementFatigue")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementFatigue = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementMaximum")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementMaximum = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementHealth")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementHealth = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementHealthMaximum")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementHealthMaximum = atoi(token);
-			}
-			else if(!Q_stricmp(token,"transformSoundFirst")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->soundTransformFirst = trap_S_RegisterSound(token,qfalse);
-			}
-			else if(!Q_stricmp(token,"transformSoundUp")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->soundTransformUp = trap_S_RegisterSound(token,qfalse);
-			}
-			else if(!Q_stricmp(token,"transformSoundDown")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->soundTransformDown = trap_S_RegisterSound(token,qfalse);
-			}
-			else if(!Q_stricmp(token,"transformMusic")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(trap_FS_FOpenFile(va("music/%s.ogg", token),0,FS_READ)>0){
-					Q_strncpyz(tier->transformMusic, token, sizeof(tier->transformMusic));
-					token = COM_Parse(&parse);
-					if(!token[0]){break;}
-					tier->transformMusicLength = CG_Music_GetMilliseconds(token);
-				}
-			}
-			else if(!Q_stricmp(token,"poweringUpSound")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->soundPoweringUp = trap_S_RegisterSound(token,qfalse);
-			}
-			else if(!Q_stricmp(token,"headModel")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->headModel = trap_R_RegisterModel(token);
-			}
-			else if(!Q_stricmp(token,"torsoModel")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->torsoModel = trap_R_RegisterModel(token);
-			}
-			else if(!Q_stricmp(token,"legsModel")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->legsModel = trap_R_RegisterModel(token);
-			}
-			else if(!Q_stricmp(token,"cameraModel")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->cameraModel = trap_R_RegisterModel(token);
-			}
-			else if(!Q_stricmp(token,"headSkin")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->headSkin = trap_R_RegisterSkin(token);
-			}
-			else if(!Q_stricmp(token,"torsoSkin")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->torsoSkin = trap_R_RegisterSkin(token);
-			}
-			else if(!Q_stricmp(token,"legsSkin")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->legsSkin = trap_R_RegisterSkin(token);
-			}
-			else if(!Q_stricmp(token,"headModelDamaged")){
-				int percent = -1;
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				percent = atoi(token) / 10 - 1;
-				if(percent < 0){percent = 0;}
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->headModelDamaged[percent] = trap_R_RegisterModel(token);
-			}
-			else if(!Q_stricmp(token,"torsoModelDamaged")){
-				int percent = -1;
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				percent = atoi(token) / 10 - 1;
-				if(percent < 0){percent = 0;}
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->torsoModelDamaged[percent] = trap_R_RegisterModel(token);
-			}
-			else if(!Q_stricmp(token,"legsModelDamaged")){
-				int percent = -1;
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				percent = atoi(token) / 10 - 1;
-				if(percent < 0){percent = 0;}
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->legsModelDamaged[percent] = trap_R_RegisterModel(token);
-			}
-			else if(!Q_stricmp(token,"headSkinDamaged")){
-				int percent = -1;
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				percent = atoi(token) / 10 - 1;
-				if(percent < 0){percent = 0;}
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->headSkinDamaged[percent] = trap_R_RegisterSkin(token);
-			}
-			else if(!Q_stricmp(token,"torsoSkinDamaged")){
-				int percent = -1;
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				percent = atoi(token) / 10 - 1;
-				if(percent < 0){percent = 0;}
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->torsoSkinDamaged[percent] = trap_R_RegisterSkin(token);
-			}
-			else if(!Q_stricmp(token,"legsSkinDamaged")){
-				int percent = -1;
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				percent = atoi(token) / 10 - 1;
-				if(percent < 0){percent = 0;}
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->legsSkinDamaged[percent] = trap_R_RegisterSkin(token);
-			}
-			else if(!Q_stricmp(token,"damageFeatures")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->damageFeatures = strlen(token) == 4 ? qtrue : qfalse;
-			}
-			else if(!Q_stricmp(token,"damageModelsRevertHealed")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->damageModelsRevertHealed = strlen(token) == 4 ? qtrue : qfalse;
-			}
-			else if(!Q_stricmp(token,"damageTexturesRevertHealed")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->damageTexturesRevertHealed = strlen(token) == 4 ? qtrue : qfalse;
-			}
-			else if(!Q_stricmp(token,"icon2DShader")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tokenInt = atoi(token);
-				token = COM_Parse(&parse);
-				if(Q_stricmp(token,"default")){
-					int countdown = tokenInt/10-1;
-					while(countdown > 0){
-						tier->icon2D[countdown] = trap_R_RegisterShaderNoMip(token);
-						countdown -= 1;
-					}
-				}
-			}
-			else if(!Q_stricmp(token,"icon2DPoweringShader")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(Q_stricmp(token,"default")){
-					tier->icon2DPowering = trap_R_RegisterShaderNoMip(token);
-				}
-			}
-			else if(!Q_stricmp(token,"icon2DTransformingShader")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(Q_stricmp(token,"default")){
-					tier->icon2DTransforming = trap_R_RegisterShaderNoMip(token);
-				}
-			}
-			else if(!Q_stricmp(token,"icon3DOffset")){
-				tier->icon3DOffset[0] = atoi(COM_Parse(&parse));
-				tier->icon3DOffset[1] = atoi(COM_Parse(&parse));
-			}
-			else if(!Q_stricmp(token,"icon3DRotation")){
-				tier->icon3DRotation[0] = atoi(COM_Parse(&parse));
-				tier->icon3DRotation[1] = atoi(COM_Parse(&parse));
-				tier->icon3DRotation[2] = atoi(COM_Parse(&parse));
-			}
-			else if(!Q_stricmp(token,"icon3DSize")){
-				tier->icon3DSize[0] = atoi(COM_Parse(&parse));
-				tier->icon3DSize[1] = atoi(COM_Parse(&parse));
-			}
-			else if(!Q_stricmp(token,"icon3DZoom")){
-				tier->icon3DZoom = atof(COM_Parse(&parse));
-			}
-			else if(!Q_stricmp(token,"screenShader")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tokenInt = atoi(token);
-				token = COM_Parse(&parse);
-				if(Q_stricmp(token,"default")){
-					int countdown = tokenInt/10-1;
-					while(countdown > 0){
-						tier->screenEffect[countdown] = trap_R_RegisterShaderNoMip(token);
-						countdown -= 1;
-					}
-				}
-			}
-			else if(!Q_stricmp(token,"screenPoweringShader")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(Q_stricmp(token,"default")){
-					tier->screenEffectPowering = trap_R_RegisterShaderNoMip(token);
-				}
-			}
-			else if(!Q_stricmp(token,"screenTransformingShader")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(Q_stricmp(token,"default")){
-					tier->screenEffectTransforming = trap_R_RegisterShaderNoMip(token);
-				}
-			}
-			else if(!Q_stricmp(token,"crosshairShader")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(Q_stricmp(token,"default")){
-					tier->crosshair = trap_R_RegisterShaderNoMip(token);
-				}
-			}
-			else if(!Q_stricmp(token,"crosshairPoweringShader")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(Q_stricmp(token,"default")){
-					tier->crosshairPowering = trap_R_RegisterShaderNoMip(token);
+			if(!token[0]){return;}
+			if(field->type == TF_MODEL){*(qhandle_t*)((byte*)tier + field->ofs) = trap_R_RegisterModel(token);}
+			else if(field->type == TF_SKIN){*(qhandle_t*)((byte*)tier + field->ofs) = trap_R_RegisterSkin(token);}
+			else if(field->type == TF_SOUND){*(sfxHandle_t*)((byte*)tier + field->ofs) = trap_S_RegisterSound(token,qfalse);}
+			else if(Q_stricmp(token,"default")){*(qhandle_t*)((byte*)tier + field->ofs) = trap_R_RegisterShaderNoMip(token);}
+			break;
+		case TF_MODEL_DAMAGED:
+		case TF_SKIN_DAMAGED:
+			token = COM_Parse(&parse);
+			if(!token[0]){return;}
+			index = atoi(token) / 10 - 1;
+			if(index < 0){index = 0;}
+			if(index >= MAX_DAMAGED_STATES){index = MAX_DAMAGED_STATES - 1;}
+			token = COM_Parse(&parse);
+			if(!token[0]){return;}
+			if(field->type == TF_MODEL_DAMAGED){((qhandle_t*)((byte*)tier + field->ofs))[index] = trap_R_RegisterModel(token);}
+			else{((qhandle_t*)((byte*)tier + field->ofs))[index] = trap_R_RegisterSkin(token);}
+			break;
+		case TF_SHADER_STATES:
+			token = COM_Parse(&parse);
+			if(!token[0]){return;}
+			tokenInt = atoi(token);
+			token = COM_Parse(&parse);
+			if(Q_stricmp(token,"default")){
+				int countdown = tokenInt/10-1;
+				if(countdown >= MAX_DAMAGED_STATES){countdown = MAX_DAMAGED_STATES - 1;}
+				while(countdown > 0){
+					((qhandle_t*)((byte*)tier + field->ofs))[countdown] = trap_R_RegisterShaderNoMip(token);
+					countdown -= 1;
 				}
 			}
-			else if(!Q_stricmp(token,"meshScale")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->meshScale = atof(token);
-			}
-			else if(!Q_stricmp(token,"meshOffset")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->meshOffset = atoi(token);
-			}
-			else if(!Q_stricmp(token,"cameraOffsetSlide")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->cameraOffset[0] = atoi(token);
-			}
-			else if(!Q_stricmp(token,"cameraOffsetHeight")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->cameraOffset[1] = atoi(token);
-			}
-			else if(!Q_stricmp(token,"cameraOffsetRange")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->cameraOffset[2] = atoi(token);
-			}
+			break;
+		case TF_MUSIC:
+			token = COM_Parse(&parse);
+			if(!token[0]){return;}
+			if(trap_FS_FOpenFile(va("music/%s.ogg", token),0,FS_READ)>0){
+				Q_strncpyz(tier->transformMusic, token, sizeof(tier->transformMusic));
+				token = COM_Parse(&parse);
+				if(!token[0]){return;}
+				tier->transformMusicLength = CG_Music_GetMilliseconds(token);
+			}
+			break;
+		case TF_VECTOR:
+			for(index=0;index<field->arg;++index){
+				((int*)((byte*)tier + field->ofs))[index] = atoi(COM_Parse(&parse));
+			}
+			break;
+		case TF_ZOOM:
+			*(float*)((byte*)tier + field->ofs) = atof(COM_Parse(&parse));
+			break;
 		}
 	}
 }
 
-
 /*
 ===============
 CG_NextTier_f
@@ -55,3 +55,4 @@ typedef struct{
 	sfxHandle_t soundPoweringUp;
 }tierConfig_cg;
 void parseTier(char *path,tierConfig_cg *tier);
+void CG_ClearTierCache(void);
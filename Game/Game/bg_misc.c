@@ -437,3 +437,111 @@ void BG_PlayerStateToEntityState( playerState_t *ps, entityState_t *s,qboolean s
 	s->loopSound = ps->loopSound;
 	s->generic1 = ps->generic1;
 }
+
+/*
+===============
+BG_KeyFieldHash
+===============
+*/
+static int BG_KeyFieldHash( const char *name ) {
+	int		i;
+	int		hash;
+
+	hash = 0;
+	for( i = 0; name[i]; ++i ) {
+		hash += tolower( name[i] ) * ( i + 119 );
+	}
+	hash = ( hash ^ ( hash >> 10 ) ^ ( hash >> 20 ) );
+	return hash & ( KEYFIELD_HASH_SIZE - 1 );
+}
+
+/*
+===============
+BG_InitKeyFieldTable
+
+Builds the open addressed lookup table for a static keyword list, so config
+parsers can resolve a key with a single hash instead of a Q_stricmp chain.
+===============
+*/
+void BG_InitKeyFieldTable( keyFieldTable_t *table, keyField_t *fields, int numFields ) {
+	int		i;
+	int		slot;
+
+	if( numFields >= KEYFIELD_HASH_SIZE ) {
+		Com_Error( ERR_DROP, "BG_InitKeyFieldTable: too many fields (%i)", numFields );
+	}
+	memset( table, 0, sizeof( *table ) );
+	table->fields = fields;
+	table->numFields = numFields;
+	for( i = 0; i < numFields; ++i ) {
+		slot = BG_KeyFieldHash( fields[i].name );
+		while( table->hash[slot] ) {
+			slot = ( slot + 1 ) & ( KEYFIELD_HASH_SIZE - 1 );
+		}
+		table->hash[slot] = i + 1;
+	}
+}
+
+/*
+===============
+BG_FindKeyField
+
+Returns NULL for keys that are not in the table
+===============
+*/
+keyField_t *BG_FindKeyField( keyFieldTable_t *table, const char *name ) {
+	int			slot;
+	keyField_t	*field;
+
+	slot = BG_KeyFieldHash( name );
+	while( table->hash[slot] ) {
+		field = &table->fields[table->hash[slot] - 1];
+		if( !Q_stricmp( field->name, name ) ) {
+			return field;
+		}
+		slot = ( slot + 1 ) & ( KEYFIELD_HASH_SIZE - 1 );
+	}
+	return NULL;
+}
+
+/*
+===============
+BG_ParseKeyField
+
+Reads the value of one of the generic field types into base.
+Returns qfalse when the value is missing, which ends the parse.
+===============
+*/
+qboolean BG_ParseKeyField( keyField_t *field, byte *base, char **parse ) {
+	char	*token;
+
+	token = COM_Parse( parse );
+	if( !token[0] ) {
+		return qfalse;
+	}
+	switch( field->type ) {
+	case KF_INT:
+		*(int *)( base + field->ofs ) = atoi( token );
+		break;
+	case KF_FLOAT:
+		*(float *)( base + field->ofs ) = atof( token );
+		break;
+	case KF_INTFLOAT:
+		*(float *)( base + field->ofs ) = atoi( token );
+		break;
+	case KF_BOOLEAN:
+		*(qboolean *)( base + field->ofs ) = strlen( token ) == 4 ? qtrue : qfalse;
+		break;
+	case KF_FLAG:
+		if( strlen( token ) == 4 ) {
+			*(int *)( base + field->ofs ) |= field->arg;
+		}
+		break;
+	case KF_STRING:
+		Q_strncpyz( (char *)( base + field->ofs ), token, field->arg );
+		break;
+	default:
+		break;
+	}
+	return qtrue;
+}
@@ -832,6 +832,36 @@ void	BG_TouchJumpPad( playerState_t *ps, entityState_t *jumppad );
 
 void	BG_PlayerStateToEntityState( playerState_t *ps, entityState_t *s,qboolean snap );
 
+// table driven keyword lookup for the config parsers
+#define	KEYFIELD_HASH_SIZE	256		// must be a power of two
+
+typedef enum {
+	KF_INT,
+	KF_FLOAT,
+	KF_INTFLOAT,		// whole number stored in a float field
+	KF_BOOLEAN,			// "true" sets the field
+	KF_FLAG,			// "true" ORs arg into the field
+	KF_STRING,			// arg is the size of the field
+	KF_CUSTOM			// module specific types start here
+} keyFieldType_t;
+
+typedef struct {
+	char	*name;
+	int		ofs;
+	int		type;
+	int		arg;
+} keyField_t;
+
+typedef struct {
+	keyField_t	*fields;
+	int			numFields;
+	short		hash[KEYFIELD_HASH_SIZE];	// field index + 1, 0 is an empty slot
+} keyFieldTable_t;
+
+void		BG_InitKeyFieldTable( keyFieldTable_t *table, keyField_t *fields, int numFields );
+keyField_t	*BG_FindKeyField( keyFieldTable_t *table, const char *name );
+qboolean	BG_ParseKeyField( keyField_t *field, byte *base, char **parse );
+
 int		BG_IntLoBits( const int i );
 int		BG_IntHiBits( const int i );
 int		BG_IntMergeBits( const int hi, const int lo );
@@ -566,6 +566,7 @@ void ClientThink_real( gentity_t *ent ) {
 	ent->watertype = pm.watertype;
 	ClientEvents(ent,oldEventSequence);
 	trap_LinkEntity (ent);
+	G_SpatialLinkEntity (ent);
 	if(!ent->client->noclip){
 		G_TouchTriggers(ent);
 	}
@@ -663,10 +663,23 @@ qboolean G_weapPhysParser_MainParse( char *filename, int clientNum, int *weaponM
 //
 void G_RadarUpdateCS( void );
 
+//
+// g_spatial.c
+//
+#define	MAX_SPATIAL_RESULTS		256
+
+void G_SpatialClear( void );
+void G_SpatialBuild( void );
+void G_SpatialLinkEntity( gentity_t *ent );
+void G_SpatialUnlinkEntity( gentity_t *ent );
+int G_SpatialEntitiesInBox( const vec3_t mins, const vec3_t maxs, int *list, int maxcount );
+void Svcmd_SpatialBench_f( void );
+
 //
 // g_weapPhysParser.c
 //
 qboolean G_weapPhys_Parse( char *filename, int clientNum );
+void G_weapPhys_CacheInfo_f( void );
 
 ///
 /// g_userweapons.c
@@ -679,6 +692,7 @@ void G_CheckSkills(playerState_t *ps );
 void checkTier(gclient_t *client );
 void syncTier(gclient_t *client );
 void setupTiers(gclient_t *client );
+void clearTierCache(void);
 
 #include "g_team.h" // teamplay specific stuff
 extern	level_locals_t	level;
@@ -795,3 +809,8 @@ void	trap_DebugPolygonDelete(int id);
 
 void	trap_SnapVector( float *v );
 
+// calls function( data, index ) for every index below count, on the engine's
+// job threads if the game is a native library.  The function must not call
+// any traps, or write anything the other indexes use.
+void	trap_ParallelFor( void (*function)( void *data, int index ), void *data, int count, int batch );
+
@@ -417,6 +417,8 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 
 	G_InitMemory();
 
+	clearTierCache();
+
 	// set some level globals
 	memset( &level, 0, sizeof( level ) );
 	level.time = levelTime;
@@ -447,6 +449,7 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 	// initialize all entities for this game
 	memset( g_entities, 0, MAX_GENTITIES * sizeof(g_entities[0]) );
 	level.gentities = g_entities;
+	G_SpatialClear();
 
 	// initialize all clients for this game
 	level.maxclients = g_maxclients.integer;
@@ -1458,6 +1461,9 @@ void G_RunFrame( int levelTime ) {
 	// get any cvar changes
 	G_UpdateCvars();
 
+	// index the damageable entities for missile target queries
+	G_SpatialBuild();
+
 	//
 	// go through all allocated objects
 	//
@@ -1551,3 +1557,20 @@ void G_RunFrame( int levelTime ) {
 		trap_Cvar_Set("g_listEntity", "0");
 	}
 }
+
+#ifdef Q3_VM
+/*
+==================
+trap_ParallelFor
+
+The engine can't call back into a QVM, so it just runs the loop
+==================
+*/
+void trap_ParallelFor( void (*function)( void *data, int index ), void *data, int count, int batch ) {
+	int		i;
+
+	for ( i = 0; i < count; i++ ) {
+		function( data, i );
+	}
+}
+#endif
@@ -178,6 +178,7 @@ qboolean	G_TryPushingEntity( gentity_t *check, gentity_t *pusher, vec3_t move, v
 			VectorCopy( check->s.pos.trBase, check->r.currentOrigin );
 		}
 		trap_LinkEntity (check);
+		G_SpatialLinkEntity (check);
 		return qtrue;
 	}
 
@@ -248,6 +249,7 @@ qboolean G_TryPushingProxMine( gentity_t *check, gentity_t *pusher, vec3_t move,
 	if (ret) {
 		VectorCopy( check->s.pos.trBase, check->r.currentOrigin );
 		trap_LinkEntity (check);
+		G_SpatialLinkEntity (check);
 	}
 	return ret;
 }
@@ -367,6 +369,7 @@ qboolean G_MoverPush( gentity_t *pusher, vec3_t move, vec3_t amove, gentity_t **
 				VectorCopy (p->origin, p->ent->client->ps.origin);
 			}
 			trap_LinkEntity (p->ent);
+			G_SpatialLinkEntity (p->ent);
 		}
 		return qfalse;
 	}
@@ -410,6 +413,7 @@ void G_MoverTeam( gentity_t *ent ) {
 			BG_EvaluateTrajectory( &part->s, &part->s.pos, level.time, part->r.currentOrigin );
 			BG_EvaluateTrajectory( &part->s, &part->s.apos, level.time, part->r.currentAngles );
 			trap_LinkEntity( part );
+			G_SpatialLinkEntity( part );
 		}
 
 		// if the pusher has a "blocked" function, call it
@@ -502,6 +506,7 @@ void SetMoverState( gentity_t *ent, moverState_t moverState, int time ) {
 	}
 	BG_EvaluateTrajectory( &ent->s, &ent->s.pos, level.time, ent->r.currentOrigin );	
 	trap_LinkEntity( ent );
+	G_SpatialLinkEntity( ent );
 }
 
 /*
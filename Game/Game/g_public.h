@@ -221,6 +221,10 @@ typedef enum {
 	G_TRACECAPSULE,	// ( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask );
 	G_ENTITY_CONTACTCAPSULE,	// ( const vec3_t mins, const vec3_t maxs, const gentity_t *ent );
 
+	G_PARALLELFOR,	// qboolean ( void (*function)( void *data, int index ), void *data, int count, int batch );
+	// runs function for every index below count on the engine's job threads.
+	// Returns qfalse without running anything if the game isn't a native library.
+
 
 } gameImport_t;
 
@@ -0,0 +1,466 @@
+// g_spatial.c -- spatial hash of damageable entities
+//
+// Homing, proximity detonation and radius damage used to scan every client
+// or ask the server for every entity in a box, once per missile per think.
+// Instead the damageable entities are kept in a hash of square cells on the
+// horizontal plane. It is rebuilt at the start of every server frame and
+// entities that move during the frame are relinked as they move.
+
+#include "g_local.h"
+
+#define	SPATIAL_CELL_SIZE		256
+#define	SPATIAL_BUCKETS			1024	// must be a power of two
+#define	SPATIAL_MAX_CELLS		16		// entities covering more cells go on the large list
+#define	SPATIAL_MAX_NODES		( MAX_GENTITIES * 2 )
+
+typedef struct {
+	int		entityNum;
+	int		bucket;
+	int		prev, next;			// bucket chain, -1 terminated
+	int		nextForEntity;		// nodes owned by the same entity
+} spatialNode_t;
+
+typedef struct {
+	qboolean	linked;
+	qboolean	large;
+	int			firstNode;
+	vec3_t		absmin, absmax;
+} spatialEntity_t;
+
+static spatialNode_t	spatialNodes[SPATIAL_MAX_NODES];
+static int				spatialFreeNode;
+static int				spatialBuckets[SPATIAL_BUCKETS];
+static spatialEntity_t	spatialEntities[MAX_GENTITIES];
+static int				spatialStamp[MAX_GENTITIES];
+static int				spatialQueryStamp;
+static int				spatialOverflowStamp;	// query that last warned about a full list
+
+// everything that's linked, used when a query covers more cells than that
+static int				spatialLinked[MAX_GENTITIES];
+static int				spatialLinkedIndex[MAX_GENTITIES];
+static int				spatialNumLinked;
+
+/*
+================
+G_SpatialBucket
+================
+*/
+static int G_SpatialBucket( int x, int y ) {
+	return ( (unsigned)x * 73856093u ^ (unsigned)y * 19349663u ) & ( SPATIAL_BUCKETS - 1 );
+}
+
+/*
+================
+G_SpatialCell
+================
+*/
+static int G_SpatialCell( float coord ) {
+	return (int)floor( coord / SPATIAL_CELL_SIZE );
+}
+
+/*
+================
+G_SpatialClear
+
+Empties the hash, called on level start
+================
+*/
+void G_SpatialClear( void ) {
+	int i;
+
+	for ( i = 0; i < SPATIAL_MAX_NODES - 1; i++ ) {
+		spatialNodes[i].next = i + 1;
+	}
+	spatialNodes[SPATIAL_MAX_NODES - 1].next = -1;
+	spatialFreeNode = 0;
+
+	for ( i = 0; i < SPATIAL_BUCKETS; i++ ) {
+		spatialBuckets[i] = -1;
+	}
+
+	memset( spatialEntities, 0, sizeof( spatialEntities ) );
+	spatialNumLinked = 0;
+}
+
+/*
+================
+G_SpatialUnlinkEntity
+================
+*/
+void G_SpatialUnlinkEntity( gentity_t *ent ) {
+	spatialEntity_t	*sent;
+	spatialNode_t	*node;
+	int				num, last;
+	int				n, next;
+
+	num = ent - g_entities;
+	sent = &spatialEntities[num];
+	if ( !sent->linked ) {
+		return;
+	}
+
+	for ( n = sent->firstNode; n != -1; n = next ) {
+		node = &spatialNodes[n];
+		next = node->nextForEntity;
+
+		if ( node->prev != -1 ) {
+			spatialNodes[node->prev].next = node->next;
+		} else {
+			spatialBuckets[node->bucket] = node->next;
+		}
+		if ( node->next != -1 ) {
+			spatialNodes[node->next].prev = node->prev;
+		}
+
+		node->next = spatialFreeNode;
+		spatialFreeNode = n;
+	}
+
+	// swap the last linked entity into our place
+	last = spatialLinked[--spatialNumLinked];
+	spatialLinked[spatialLinkedIndex[num]] = last;
+	spatialLinkedIndex[last] = spatialLinkedIndex[num];
+
+	sent->linked = qfalse;
+	sent->large = qfalse;
+	sent->firstNode = -1;
+}
+
+/*
+================
+G_SpatialLinkEntity
+
+Places an entity in the cells its bounds cover, or takes it out
+if it can no longer be a target. Call whenever an entity moves.
+================
+*/
+void G_SpatialLinkEntity( gentity_t *ent ) {
+	spatialEntity_t	*sent;
+	spatialNode_t	*node;
+	int				num;
+	int				x, y, x0, y0, x1, y1;
+	int				n;
+
+	G_SpatialUnlinkEntity( ent );
+
+	if ( !ent->inuse || ( !ent->client && !ent->takedamage ) ) {
+		return;
+	}
+
+	num = ent - g_entities;
+	sent = &spatialEntities[num];
+
+	// Unlinked clients still count as homing targets, at the position
+	// the old client scan used to read.
+	if ( ent->r.linked ) {
+		VectorCopy( ent->r.absmin, sent->absmin );
+		VectorCopy( ent->r.absmax, sent->absmax );
+	} else {
+		VectorAdd( ent->r.currentOrigin, ent->r.mins, sent->absmin );
+		VectorAdd( ent->r.currentOrigin, ent->r.maxs, sent->absmax );
+	}
+
+	sent->linked = qtrue;
+	sent->large = qfalse;
+	sent->firstNode = -1;
+	spatialLinkedIndex[num] = spatialNumLinked;
+	spatialLinked[spatialNumLinked++] = num;
+
+	x0 = G_SpatialCell( sent->absmin[0] );
+	y0 = G_SpatialCell( sent->absmin[1] );
+	x1 = G_SpatialCell( sent->absmax[0] );
+	y1 = G_SpatialCell( sent->absmax[1] );
+
+	if ( ( x1 - x0 + 1 ) * ( y1 - y0 + 1 ) > SPATIAL_MAX_CELLS ) {
+		sent->large = qtrue;
+		return;
+	}
+
+	for ( x = x0; x <= x1; x++ ) {
+		for ( y = y0; y <= y1; y++ ) {
+			n = spatialFreeNode;
+			if ( n == -1 ) {
+				// out of nodes, so always test this one
+				sent->large = qtrue;
+				return;
+			}
+			node = &spatialNodes[n];
+			spatialFreeNode = node->next;
+
+			node->entityNum = num;
+			node->bucket = G_SpatialBucket( x, y );
+			node->prev = -1;
+			node->next = spatialBuckets[node->bucket];
+			if ( node->next != -1 ) {
+				spatialNodes[node->next].prev = n;
+			}
+			spatialBuckets[node->bucket] = n;
+
+			node->nextForEntity = sent->firstNode;
+			sent->firstNode = n;
+		}
+	}
+}
+
+/*
+================
+G_SpatialBuild
+
+Relinks every entity, called at the start of each server frame
+================
+*/
+void G_SpatialBuild( void ) {
+	int			i;
+	gentity_t	*ent;
+
+	while ( spatialNumLinked ) {
+		G_SpatialUnlinkEntity( &g_entities[spatialLinked[spatialNumLinked - 1]] );
+	}
+
+	for ( i = 0, ent = g_entities; i < level.num_entities; i++, ent++ ) {
+		if ( !ent->inuse ) {
+			continue;
+		}
+		G_SpatialLinkEntity( ent );
+	}
+}
+
+/*
+================
+G_SpatialAddResult
+================
+*/
+static int G_SpatialAddResult( int num, const vec3_t mins, const vec3_t maxs, int *list, int count, int maxcount ) {
+	spatialEntity_t	*sent;
+	int				i;
+
+	if ( spatialStamp[num] == spatialQueryStamp ) {
+		return count;
+	}
+	spatialStamp[num] = spatialQueryStamp;
+
+	sent = &spatialEntities[num];
+	if ( sent->absmin[0] > maxs[0] || sent->absmin[1] > maxs[1] || sent->absmin[2] > maxs[2]
+		|| sent->absmax[0] < mins[0] || sent->absmax[1] < mins[1] || sent->absmax[2] < mins[2] ) {
+		return count;
+	}
+
+	// When the list is full, keep the lowest entity numbers so the
+	// clients always make it in.
+	if ( count == maxcount ) {
+		if ( spatialOverflowStamp != spatialQueryStamp ) {
+			spatialOverflowStamp = spatialQueryStamp;
+			G_Printf( "G_SpatialEntitiesInBox: MAXCOUNT\n" );
+		}
+		if ( !count || list[count - 1] < num ) {
+			return count;
+		}
+		count--;
+	}
+
+	// keep the list in entity order, like the scans this replaces
+	for ( i = count; i > 0 && list[i - 1] > num; i-- ) {
+		list[i] = list[i - 1];
+	}
+	list[i] = num;
+
+	return count + 1;
+}
+
+/*
+================
+G_SpatialEntitiesInBox
+
+Fills list with the clients and damageable entities whose bounds
+touch the box, sorted by entity number. Returns the count.
+================
+*/
+int G_SpatialEntitiesInBox( const vec3_t mins, const vec3_t maxs, int *list, int maxcount ) {
+	int		i, n;
+	int		x, y, x0, y0, x1, y1;
+	int		bucket;
+	int		count;
+
+	if ( ++spatialQueryStamp == 0 ) {
+		memset( spatialStamp, 0, sizeof( spatialStamp ) );
+		spatialQueryStamp = 1;
+		spatialOverflowStamp = 0;
+	}
+
+	count = 0;
+	x0 = G_SpatialCell( mins[0] );
+	y0 = G_SpatialCell( mins[1] );
+	x1 = G_SpatialCell( maxs[0] );
+	y1 = G_SpatialCell( maxs[1] );
+
+	// Walking the cells only pays off while there are fewer of them
+	// than entities to test.
+	if ( ( x1 - x0 + 1 ) * ( y1 - y0 + 1 ) > spatialNumLinked ) {
+		for ( i = 0; i < spatialNumLinked; i++ ) {
+			count = G_SpatialAddResult( spatialLinked[i], mins, maxs, list, count, maxcount );
+		}
+		return count;
+	}
+
+	for ( x = x0; x <= x1; x++ ) {
+		for ( y = y0; y <= y1; y++ ) {
+			bucket = G_SpatialBucket( x, y );
+			for ( n = spatialBuckets[bucket]; n != -1; n = spatialNodes[n].next ) {
+				count = G_SpatialAddResult( spatialNodes[n].entityNum, mins, maxs, list, count, maxcount );
+			}
+		}
+	}
+
+	for ( i = 0; i < spatialNumLinked; i++ ) {
+		if ( spatialEntities[spatialLinked[i]].large ) {
+			count = G_SpatialAddResult( spatialLinked[i], mins, maxs, list, count, maxcount );
+		}
+	}
+
+	return count;
+}
+
+/*
+================
+Svcmd_SpatialBench_f
+
+spatialbench [missiles] [targets] [frames]
+
+Spawns dummy targets and times target acquisition for the given
+number of missiles per frame, against a scan of every target and
+against the server's entity list.
+================
+*/
+#define	BENCH_SPREAD	4096
+#define	BENCH_RANGE		1000
+
+void Svcmd_SpatialBench_f( void ) {
+	char		arg[MAX_TOKEN_CHARS];
+	int			numMissiles, numTargets, numFrames;
+	int			frame, i, j, k;
+	int			start, scanTime, serverTime, spatialTime;
+	int			scanHits, serverHits, spatialHits;
+	int			count;
+	gentity_t	*ent;
+	vec3_t		mins, maxs, mid;
+	static int			list[MAX_GENTITIES];
+	static gentity_t	*targets[MAX_GENTITIES];
+	static vec3_t		origins[MAX_GENTITIES];
+
+	trap_Argv( 1, arg, sizeof( arg ) );
+	numMissiles = arg[0] ? atoi( arg ) : 64;
+	trap_Argv( 2, arg, sizeof( arg ) );
+	numTargets = arg[0] ? atoi( arg ) : 32;
+	trap_Argv( 3, arg, sizeof( arg ) );
+	numFrames = arg[0] ? atoi( arg ) : 100;
+
+	numMissiles = Com_Clamp( 1, MAX_GENTITIES, numMissiles );
+	numTargets = Com_Clamp( 1, MAX_GENTITIES / 2, numTargets );
+	numFrames = Com_Clamp( 1, 10000, numFrames );
+
+	// spawn the targets
+	for ( i = 0; i < numTargets; i++ ) {
+		ent = G_Spawn();
+		ent->classname = "spatialbench";
+		ent->takedamage = qtrue;
+		ent->r.contents = CONTENTS_BODY;
+		VectorSet( ent->r.mins, -15, -15, -24 );
+		VectorSet( ent->r.maxs, 15, 15, 32 );
+		VectorSet( mid, crandom() * BENCH_SPREAD, crandom() * BENCH_SPREAD, crandom() * BENCH_SPREAD * 0.25f );
+		G_SetOrigin( ent, mid );
+		trap_LinkEntity( ent );
+		G_SpatialLinkEntity( ent );
+		targets[i] = ent;
+		if ( ent->s.number == ENTITYNUM_MAX_NORMAL - 1 ) {
+			numTargets = i + 1;
+			break;
+		}
+	}
+
+	for ( i = 0; i < numMissiles; i++ ) {
+		VectorSet( origins[i], crandom() * BENCH_SPREAD, crandom() * BENCH_SPREAD, crandom() * BENCH_SPREAD * 0.25f );
+	}
+
+	// scan every target, like the old homing thinks
+	scanHits = 0;
+	start = trap_Milliseconds();
+	for ( frame = 0; frame < numFrames; frame++ ) {
+		for ( i = 0; i < numMissiles; i++ ) {
+			for ( j = 0; j < numTargets; j++ ) {
+				ent = targets[j];
+				if ( !ent->inuse || !ent->takedamage ) {
+					continue;
+				}
+				for ( k = 0; k < 3; k++ ) {
+					mid[k] = ent->r.currentOrigin[k] + ( ent->r.mins[k] + ent->r.maxs[k] ) * 0.5f;
+				}
+				if ( Distance( mid, origins[i] ) <= BENCH_RANGE ) {
+					scanHits++;
+				}
+			}
+		}
+	}
+	scanTime = trap_Milliseconds() - start;
+
+	// ask the server, like the old radius damage
+	serverHits = 0;
+	start = trap_Milliseconds();
+	for ( frame = 0; frame < numFrames; frame++ ) {
+		for ( i = 0; i < numMissiles; i++ ) {
+			for ( k = 0; k < 3; k++ ) {
+				mins[k] = origins[i][k] - BENCH_RANGE;
+				maxs[k] = origins[i][k] + BENCH_RANGE;
+			}
+			count = trap_EntitiesInBox( mins, maxs, list, MAX_GENTITIES );
+			for ( j = 0; j < count; j++ ) {
+				ent = &g_entities[list[j]];
+				if ( !ent->takedamage || Q_stricmp( ent->classname, "spatialbench" ) ) {
+					continue;
+				}
+				for ( k = 0; k < 3; k++ ) {
+					mid[k] = ent->r.currentOrigin[k] + ( ent->r.mins[k] + ent->r.maxs[k] ) * 0.5f;
+				}
+				if ( Distance( mid, origins[i] ) <= BENCH_RANGE ) {
+					serverHits++;
+				}
+			}
+		}
+	}
+	serverTime = trap_Milliseconds() - start;
+
+	// query the hash, rebuilding it once per frame
+	spatialHits = 0;
+	start = trap_Milliseconds();
+	for ( frame = 0; frame < numFrames; frame++ ) {
+		G_SpatialBuild();
+		for ( i = 0; i < numMissiles; i++ ) {
+			for ( k = 0; k < 3; k++ ) {
+				mins[k] = origins[i][k] - BENCH_RANGE;
+				maxs[k] = origins[i][k] + BENCH_RANGE;
+			}
+			count = G_SpatialEntitiesInBox( mins, maxs, list, MAX_GENTITIES );
+			for ( j = 0; j < count; j++ ) {
+				ent = &g_entities[list[j]];
+				if ( !ent->takedamage || Q_stricmp( ent->classname, "spatialbench" ) ) {
+					continue;
+				}
+				for ( k = 0; k < 3; k++ ) {
+					mid[k] = ent->r.currentOrigin[k] + ( ent->r.mins[k] + ent->r.maxs[k] ) * 0.5f;
+				}
+				if ( Distance( mid, origins[i] ) <= BENCH_RANGE ) {
+					spatialHits++;
+				}
+			}
+		}
+	}
+	spatialTime = trap_Milliseconds() - start;
+
+	for ( i = 0; i < numTargets; i++ ) {
+		G_FreeEntity( targets[i] );
+	}
+
+	G_Printf( "%i missiles, %i targets, %i frames\n", numMissiles, numTargets, numFrames );
+	G_Printf( "  scan:    %5i msec, %.3f msec/frame, %i hits\n", scanTime, (float)scanTime / numFrames, scanHits );
+	G_Printf( "  server:  %5i msec, %.3f msec/frame, %i hits\n", serverTime, (float)serverTime / numFrames, serverHits );
+	G_Printf( "  spatial: %5i msec, %.3f msec/frame, %i hits\n", spatialTime, (float)spatialTime / numFrames, spatialHits );
+}
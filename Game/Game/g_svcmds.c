@@ -477,6 +477,16 @@ qboolean	ConsoleCommand( void ) {
 		return qtrue;
 	}
 
+	if (Q_stricmp (cmd, "weapphys_cache") == 0) {
+		G_weapPhys_CacheInfo_f();
+		return qtrue;
+	}
+
+	if (Q_stricmp (cmd, "spatialbench") == 0) {
+		Svcmd_SpatialBench_f();
+		return qtrue;
+	}
+
 	if (Q_stricmp (cmd, "abort_podium") == 0) {
 		Svcmd_AbortPodium_f();
 		return qtrue;
@@ -215,3 +215,14 @@ void trap_SnapVector( float *v ) {
 	syscall( G_SNAPVECTOR, v );
 	return;
 }
+
+void trap_ParallelFor( void (*function)( void *data, int index ), void *data, int count, int batch ) {
+	int		i;
+
+	// the engine can only call back into a native library
+	if ( !syscall( G_PARALLELFOR, function, data, count, batch ) ) {
+		for ( i = 0; i < count; i++ ) {
+			function( data, i );
+		}
+	}
+}
@@ -215,405 +215,181 @@ void checkTier(gclient_t *client){
 	ps->powerLevel[plTierSelectionMode]=0;
 }
 
+#define	TFOFS(x) ((size_t)&(((tierConfig_g *)0)->x))
+static keyField_t tierFields[] = {
+	{"speed",									TFOFS(speed),							KF_INT},
+	{"meleeAttack",								TFOFS(meleeAttack),						KF_FLOAT},
+	{"energyAttackDamage",						TFOFS(energyAttackDamage),				KF_FLOAT},
+	{"energyAttackCost",						TFOFS(energyAttackCost),				KF_FLOAT},
+	{"defenseMelee",							TFOFS(defenseMelee),					KF_FLOAT},
+	{"defenseEnergy",							TFOFS(defenseEnergy),					KF_FLOAT},
+	{"defenseCapacity",							TFOFS(defenseCapacity),					KF_FLOAT},
+	{"defenseRecovery",							TFOFS(defenseRecovery),					KF_FLOAT},
+	{"defenseRecoveryDelay",					TFOFS(defenseRecoveryDelay),			KF_INT},
+	{"knockbackPower",							TFOFS(knockbackPower),					KF_FLOAT},
+	{"knockbackIntensity",						TFOFS(knockbackIntensity),				KF_FLOAT},
+	{"airBrakeCost",							TFOFS(airBrakeCost),					KF_FLOAT},
+	{"fatigueRecovery",							TFOFS(fatigueRecovery),					KF_FLOAT},
+	{"boostCost",								TFOFS(boostCost),						KF_FLOAT},
+	{"zanzokenCost",							TFOFS(zanzokenCost),					KF_FLOAT},
+	{"zanzokenQuickCost",						TFOFS(zanzokenQuickCost),				KF_FLOAT},
+	{"zanzokenSpeed",							TFOFS(zanzokenSpeed),					KF_FLOAT},
+	{"zanzokenDistance",						TFOFS(zanzokenDistance),				KF_FLOAT},
+	{"zanzokenQuickDistance",					TFOFS(zanzokenQuickDistance),			KF_FLOAT},
+	{"breakLimitRate",							TFOFS(breakLimitRate),					KF_FLOAT},
+	{"effectCurrent",							TFOFS(effectCurrent),					KF_INTFLOAT},
+	{"effectMaximum",							TFOFS(effectMaximum),					KF_INTFLOAT},
+	{"effectFatigue",							TFOFS(effectFatigue),					KF_INTFLOAT},
+	{"effectHealth",							TFOFS(effectHealth),					KF_INTFLOAT},
+	{"requirementCurrent",						TFOFS(requirementCurrent),				KF_INT},
+	{"requirementCurrentPercent",				TFOFS(requirementCurrentPercent),		KF_INT},
+	{"requirementMaximum",						TFOFS(requirementMaximum),				KF_INT},
+	{"requirementHealth",						TFOFS(requirementHealth),				KF_INT},
+	{"requirementHealthMaximum",				TFOFS(requirementHealthMaximum),		KF_INT},
+	{"requirementFatigue",						TFOFS(requirementFatigue),				KF_INT},
+	{"sustainCurrent",							TFOFS(sustainCurrent),					KF_INT},
+	{"sustainCurrentPercent",					TFOFS(sustainCurrentPercent),			KF_INT},
+	{"sustainHealth",							TFOFS(sustainHealth),					KF_INT},
+	{"sustainFatigue",							TFOFS(sustainFatigue),					KF_INT},
+	{"sustainMaximum",							TFOFS(sustainMaximum),					KF_INT},
+	{"transformFirstDuration",					TFOFS(transformFirstDuration),			KF_INT},
+	{"transformFirstHealth",					TFOFS(transformFirstHealth),			KF_INT},
+	{"transformFirstFatigue",					TFOFS(transformFirstFatigue),			KF_INT},
+	{"transformFirstEffectMaximum",				TFOFS(transformFirstEffectMaximum),		KF_INT},
+	{"transformDuration",						TFOFS(transformDuration),				KF_INT},
+	{"transformHealth",							TFOFS(transformHealth),					KF_INT},
+	{"transformFatigue",						TFOFS(transformFatigue),				KF_INT},
+	{"transformEffectMaximum",					TFOFS(transformEffectMaximum),			KF_INT},
+	{"transformSubsequentDuration",				TFOFS(transformSubsequentDuration),		KF_FLOAT},
+	{"transformEffectSubsequentHealthScale",	TFOFS(transformSubsequentHealthScale),	KF_FLOAT},
+	{"transformEffectSubsequentFatigueScale",	TFOFS(transformSubsequentFatigueScale),	KF_FLOAT},
+	{"transformEffectSubsequentMaximumScale",	TFOFS(transformSubsequentMaximumScale),	KF_FLOAT},
+	{"transformTime",							TFOFS(transformTime),					KF_INTFLOAT},
+	{"requirementUseSkill",						TFOFS(requirementUseSkill),				KF_INT},
+	{"requirementButtonUp",						TFOFS(requirementButtonUp),				KF_BOOLEAN},
+	{"requirementButtonDown",					TFOFS(requirementButtonDown),			KF_BOOLEAN},
+	{"tierPermanent",							TFOFS(permanent),						KF_BOOLEAN},
+	{"canBlock",								TFOFS(capabilities),					KF_FLAG,	canBlock},
+	{"canMelee",								TFOFS(capabilities),					KF_FLAG,	canMelee},
+	{"canLockon",								TFOFS(capabilities),					KF_FLAG,	canLockon},
+	{"canHandspring",							TFOFS(capabilities),					KF_FLAG,	canHandspring},
+	{"canGrab",									TFOFS(capabilities),					KF_FLAG,	canGrab},
+	{"canSlam",									TFOFS(capabilities),					KF_FLAG,	canSlam},
+	{"canClench",								TFOFS(capabilities),					KF_FLAG,	canClench},
+	{"canExpulse",								TFOFS(capabilities),					KF_FLAG,	canExpulse},
+	{"canDischarge",							TFOFS(capabilities),					KF_FLAG,	canDischarge},
+	{"canBoost",								TFOFS(capabilities),					KF_FLAG,	canBoost},
+	{"canSwim",									TFOFS(capabilities),					KF_FLAG,	canSwim},
+	{"canFly",									TFOFS(capabilities),					KF_FLAG,	canFly},
+	{"canJump",									TFOFS(capabilities),					KF_FLAG,	canJump},
+	{"canZanzoken",								TFOFS(capabilities),					KF_FLAG,	canZanzoken},
+	{"canBallFlip",								TFOFS(capabilities),					KF_FLAG,	canBallFlip},
+	{"canOverheal",								TFOFS(capabilities),					KF_FLAG,	canOverheal},
+	{"canBreakLimit",							TFOFS(capabilities),					KF_FLAG,	canBreakLimit},
+	{"canTransform",							TFOFS(capabilities),					KF_FLAG,	canTransform},
+	{"canSoar",									TFOFS(capabilities),					KF_FLAG,	canSoar},
+	{"canAlter",								TFOFS(capabilities),					KF_FLAG,	canAlter}
+};
+static const int numTierFields = ARRAY_LEN(tierFields);
+static keyFieldTable_t tierFieldTable;
+
+// Parsed tiers are kept for the lifetime of the level, keyed by the path of
+// their Tier.config (which encodes model, skin and tier), with
+// TierDefault.config already merged in.
+#define MAX_TIER_CACHE 256
+typedef struct{
+	char			path[MAX_QPATH * 2];
+	int				hash;
+	tierConfig_g	config;
+}tierCache_g;
+static tierCache_g tierCache[MAX_TIER_CACHE];
+static int tierCacheCount;
+static tierConfig_g tierDefault;
+static qboolean tierDefaultLoaded;
+
+void clearTierCache(void){
+	if(!tierFieldTable.numFields){
+		BG_InitKeyFieldTable(&tierFieldTable,tierFields,numTierFields);
+	}
+	tierCacheCount = 0;
+	tierDefaultLoaded = qfalse;
+}
+
+static int tierPathHash(const char *path){
+	int i;
+	int hash = 0;
+	for(i=0;path[i];i++){hash = hash * 31 + tolower(path[i]);}
+	return hash;
+}
+
+static tierConfig_g *findTier(const char *path,int hash){
+	int i;
+	for(i=0;i<tierCacheCount;i++){
+		if(tierCache[i].hash == hash && !Q_stricmp(tierCache[i].path,path)){
+			return &tierCache[i].config;
+		}
+	}
+	return NULL;
+}
+
+static tierConfig_g *loadTier(const char *path){
+	tierCache_g *entry;
+	tierConfig_g *cached;
+	int hash;
+	hash = tierPathHash(path);
+	cached = findTier(path,hash);
+	if(cached){return cached;}
+	if(!tierDefaultLoaded){
+		memset(&tierDefault,0,sizeof(tierConfig_g));
+		parseTier("players/TierDefault.config",&tierDefault);
+		tierDefaultLoaded = qtrue;
+	}
+	if(tierCacheCount == MAX_TIER_CACHE){tierCacheCount = 0;}
+	entry = &tierCache[tierCacheCount++];
+	Q_strncpyz(entry->path,path,sizeof(entry->path));
+	entry->hash = hash;
+	entry->config = tierDefault;
+	parseTier((char*)path,&entry->config);
+	return &entry->config;
+}
+
 void setupTiers(gclient_t *client){
 	int	i;
-	tierConfig_g *tier;
 	char *modelName;
 	char *skinName;
-	char *tierPath;
-	char tempPath[MAX_QPATH];
+	char tierPath[MAX_QPATH * 2];
 	modelName = client->modelName;
 	skinName = strchr(modelName,'/');
 	if(!skinName){skinName = "default";}
 	for(i=0;i<8;i++){
-		tier = &client->tiers[i];
-		memset(tier,0,sizeof(tierConfig_g));
-		tierPath = va("players/%s/Tier%i/%s/",modelName,i+1,skinName);
-		parseTier("players/TierDefault.config",tier);
-		parseTier(strcat(tierPath,"Tier.config"),tier);
+		Com_sprintf(tierPath,sizeof(tierPath),"players/%s/Tier%i/%s/Tier.config",modelName,i+1,skinName);
+		client->tiers[i] = *loadTier(tierPath);
 	}
 	syncTier(client);
 }
 void parseTier(char *path,tierConfig_g *tier){
 	fileHandle_t tierCFG;
-	int i;
+	keyField_t *field;
 	char *token,*parse;
 	int fileLength;
 	char fileContents[32000];
 	tier->exists = qfalse;
-	if(trap_FS_FOpenFile(path,0,FS_READ)>0){
-		tier->exists = qtrue;
-		fileLength = trap_FS_FOpenFile(path,&tierCFG,FS_READ);
-		trap_FS_Read(fileContents,fileLength,tierCFG);
-		fileContents[fileLength] = 0;
+	fileLength = trap_FS_FOpenFile(path,&tierCFG,FS_READ);
+	if(!tierCFG){return;}
+	if(fileLength <= 0 || fileLength >= sizeof(fileContents)){
 		trap_FS_FCloseFile(tierCFG);
-		parse = fileContents;
-		while(1){
-			token = COM_Parse(&parse);
-			if(!token[0]){break;}
-			else if(!Q_stricmp(token,"speed")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->speed = atof(token);
-			}
-			else if(!Q_stricmp(token,"meleeAttack")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->meleeAttack = atof(token);
-			}
-			else if(!Q_stricmp(token,"energyAttackDamage")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->energyAttackDamage = atof(token);
-			}
-			else if(!Q_stricmp(token,"energyAttackCost")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->energyAttackCost = atof(token);
-			}
-			else if(!Q_stricmp(token,"defenseMelee")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->defenseMelee = atof(token);
-			}
-			else if(!Q_stricmp(token,"defenseEnergy")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->defenseEnergy = atof(token);
-			}
-			else if(!Q_stricmp(token,"defenseCapacity")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->defenseCapacity = atof(token);
-			}
-			else if(!Q_stricmp(token,"defenseRecovery")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->defenseRecovery = atof(token);
-			}
-			else if(!Q_stricmp(token,"defenseRecoveryDelay")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->defenseRecoveryDelay = atof(token);
-			}
-			else if(!Q_stricmp(token,"knockbackPower")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->knockbackPower = atof(token);
-			}
-			else if(!Q_stricmp(token,"knockbackIntensity")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->knockbackIntensity = atof(token);
-			}
-			else if(!Q_stricmp(token,"airBrakeCost")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->airBrakeCost = atof(token);
-			}
-			else if(!Q_stricmp(token,"fatigueRecovery")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->fatigueRecovery = atof(token);
-			}
-			else if(!Q_stricmp(token,"boostCost")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->boostCost = atof(token);
-			}
-			else if(!Q_stricmp(token,"zanzokenCost")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->zanzokenCost = atof(token);
-			}
-			else if(!Q_stricmp(token,"zanzokenQuickCost")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->zanzokenQuickCost = atof(token);
-			}
-			else if(!Q_stricmp(token,"zanzokenSpeed")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->zanzokenSpeed = atof(token);
-			}
-			else if(!Q_stricmp(token,"zanzokenDistance")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->zanzokenDistance = atof(token);
-			}
-			else if(!Q_stricmp(token,"zanzokenQuickDistance")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->zanzokenQuickDistance = atof(token);
-			}
-			else if(!Q_stricmp(token,"breakLimitRate")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->breakLimitRate = atof(token);
-			}
-			else if(!Q_stricmp(token,"effectCurrent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->effectCurrent = atoi(token);
-			}
-			else if(!Q_stricmp(token,"effectMaximum")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->effectMaximum = atoi(token);
-			}
-			else if(!Q_stricmp(token,"effectFatigue")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->effectFatigue = atoi(token);
-			}
-			else if(!Q_stricmp(token,"effectHealth")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->effectHealth = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementCurrent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementCurrent = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementCurrentPercent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementCurrentPercent = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementMaximum")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementMaximum = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementHealth")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementHealth = atoi(token);
-			}
-			//Begin Add
-			else if(!Q_stricmp(token,"requirementHealthMaximum")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementHealthMaximum = atoi(token);
-			}
-			//End Add
-			else if(!Q_stricmp(token,"requirementFatigue")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementFatigue = atoi(token);
-			}
-			else if(!Q_stricmp(token,"sustainCurrent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainCurrent = atoi(token);
-			}
-			else if(!Q_stricmp(token,"sustainCurrentPercent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainCurrentPercent = atoi(token);
-			}
-			else if(!Q_stricmp(token,"sustainHealth")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainHealth = atoi(token);
-			}
-			else if(!Q_stricmp(token,"sustainFatigue")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainFatigue = atoi(token);
-			}
-			else if(!Q_stricmp(token,"sustainMaximum")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->sustainMaximum = atoi(token);
-			}
-			else if(!Q_stricmp(token,"transformFirstDuration")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformFirstDuration = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformFirstHealth")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformFirstHealth = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformFirstFatigue")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformFirstFatigue = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformFirstEffectMaximum")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformFirstEffectMaximum = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformDuration")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformDuration = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformHealth")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformHealth = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformFatigue")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformFatigue = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformEffectMaximum")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformEffectMaximum = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformSubsequentDuration")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformSubsequentDuration = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformEffectSubsequentHealthScale")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformSubsequentHealthScale = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformEffectSubsequentFatigueScale")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformSubsequentFatigueScale = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformEffectSubsequentMaximumScale")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformSubsequentMaximumScale = atof(token);
-			}
-			else if(!Q_stricmp(token,"transformTime")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->transformTime = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementUseSkill")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementUseSkill = atoi(token);
-			}
-			else if(!Q_stricmp(token,"requirementButtonUp")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementButtonUp = strlen(token) == 4 ? qtrue : qfalse;
-			}
-			else if(!Q_stricmp(token,"requirementButtonDown")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->requirementButtonDown = strlen(token) == 4 ? qtrue : qfalse;
-				if(tier->requirementButtonDown == 0);
-			}
-			else if(!Q_stricmp(token,"tierPermanent")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				tier->permanent = strlen(token) == 4 ? qtrue : qfalse;
-			}
-			else if(!Q_stricmp(token,"canBlock")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canBlock;}
-			}
-			else if(!Q_stricmp(token,"canMelee")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canMelee;}
-			}
-			else if(!Q_stricmp(token,"canLockon")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canLockon;}
-			}
-			else if(!Q_stricmp(token,"canHandspring")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canHandspring;}
-			}
-			else if(!Q_stricmp(token,"canGrab")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canGrab;}
-			}
-			else if(!Q_stricmp(token,"canSlam")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canSlam;}
-			}
-			else if(!Q_stricmp(token,"canClench")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canClench;}
-			}
-			else if(!Q_stricmp(token,"canExpulse")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canExpulse;}
-			}
-			else if(!Q_stricmp(token,"canDischarge")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canDischarge;}
-			}
-			else if(!Q_stricmp(token,"canBoost")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canBoost;}
-			}
-			else if(!Q_stricmp(token,"canSwim")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canSwim;}
-			}
-			else if(!Q_stricmp(token,"canFly")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canFly;}
-			}
-			else if(!Q_stricmp(token,"canJump")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canJump;}
-			}
-			else if(!Q_stricmp(token,"canZanzoken")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canZanzoken;}
-			}
-			else if(!Q_stricmp(token,"canBallFlip")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canBallFlip;}
-			}
-			else if(!Q_stricmp(token,"canOverheal")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canOverheal;}
-			}
-			else if(!Q_stricmp(token,"canBreakLimit")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canBreakLimit;}
-			}
-			else if(!Q_stricmp(token,"canTransform")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canTransform;}
-			}
-			else if(!Q_stricmp(token,"canSoar")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canSoar;}
-			}
-			else if(!Q_stricmp(token,"canAlter")){
-				token = COM_Parse(&parse);
-				if(!token[0]){break;}
-				if(strlen(token) == 4){tier->capabilities |= canAlter;}
-			}
-		}
+		return;
+	}
+	tier->exists = qtrue;
+	trap_FS_Read(fileContents,fileLength,tierCFG);
+	fileContents[fileLength] = 0;
+	trap_FS_FCloseFile(tierCFG);
+	parse = fileContents;
+	while(1){
+		token = COM_Parse(&parse);
+		if(!token[0]){break;}
+		field = BG_FindKeyField(&tierFieldTable,token);
+		if(!field){continue;}
+		if(!BG_ParseKeyField(field,(byte*)tier,&parse)){break;}
 	}
 }
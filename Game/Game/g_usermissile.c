@@ -39,17 +39,30 @@ Think_ProxDet
 ===============
 */
 void Think_ProxDet( gentity_t *self ) {
-	int			i; // loop variable
+	int			i, e; // loop variables
+	int			entityList[MAX_SPATIAL_RESULTS];
+	int			numListedEntities;
 	gentity_t	*target_ent;
 	gentity_t	*target_owner;
-	vec3_t		midbody;
+	vec3_t		midbody, mins, maxs;
 	float		proxDistance;	// The distance between a potential
 								// target and the missile.
 
-	for (i = 0; i < level.maxclients; i++) {
+	// Only clients whose bounds reach into the homing range can be close enough.
+	for ( i = 0 ; i < 3 ; i++ ) {
+		mins[i] = self->r.currentOrigin[i] - self->homRange;
+		maxs[i] = self->r.currentOrigin[i] + self->homRange;
+	}
+	numListedEntities = G_SpatialEntitiesInBox( mins, maxs, entityList, MAX_SPATIAL_RESULTS );
+	target_owner = GetMissileOwnerEntity( self );
+
+	for (e = 0; e < numListedEntities; e++) {
+		// The list is sorted, so the clients come first.
+		i = entityList[e];
+		if ( i >= level.maxclients ) break;
+
 		// Here we use target_ent to point to potential targets
 		target_ent = &g_entities[i];
-		target_owner = GetMissileOwnerEntity( self );
 
 		// We don't bother with non-used clients, ourselves,
 		// or clients on our team.
@@ -75,7 +88,7 @@ void Think_ProxDet( gentity_t *self ) {
 		self->think = G_ExplodeUserWeapon;
 
 		// Force premature exit of Bounded Linear Search
-		i = level.maxclients;
+		break;
 	}
 
 	// If the weapon has existed too long, make the next think detonate it.
@@ -150,8 +163,10 @@ Think_Homing
 void Think_Homing (gentity_t *self) {
 	gentity_t	*target_ent, *target_owner;
 	float		target_length;
-	int			i;
-	vec3_t		target_dir, forward, midbody;
+	int			i, e;
+	int			entityList[MAX_SPATIAL_RESULTS];
+	int			numListedEntities;
+	vec3_t		target_dir, forward, midbody, mins, maxs;
 	trace_t		tr;
 	
 	vec3_t		chosen_dir;
@@ -180,11 +195,22 @@ void Think_Homing (gentity_t *self) {
 	VectorCopy(forward, chosen_dir);
 	chosen_length = -1;
 
+	// Only clients whose bounds reach into the homing range can qualify.
+	for ( i = 0 ; i < 3 ; i++ ) {
+		mins[i] = self->r.currentOrigin[i] - self->homRange;
+		maxs[i] = self->r.currentOrigin[i] + self->homRange;
+	}
+	numListedEntities = G_SpatialEntitiesInBox( mins, maxs, entityList, MAX_SPATIAL_RESULTS );
+	target_owner = GetMissileOwnerEntity( self );
+
 	// Cycle through the clients for a qualified target
-	for (i = 0; i < level.maxclients; i++) {
+	for (e = 0; e < numListedEntities; e++) {
+		// The list is sorted, so the clients come first.
+		i = entityList[e];
+		if ( i >= level.maxclients ) break;
+
 		// Here we use target_ent to point to potential targets
 		target_ent = &g_entities[i];
-		target_owner = GetMissileOwnerEntity( self );
 
 		if (!target_ent->inuse) continue;
 		if (target_ent == target_owner) continue;
@@ -249,8 +275,10 @@ Think_CylinderHoming
 void Think_CylinderHoming (gentity_t *self) {
 	gentity_t	*target_ent, *target_owner;
 	float		target_length;
-	int			i;
-	vec3_t		target_dir, forward, midbody;
+	int			i, e;
+	int			entityList[MAX_SPATIAL_RESULTS];
+	int			numListedEntities;
+	vec3_t		target_dir, forward, midbody, mins, maxs;
 	trace_t		tr;
 	
 	vec3_t		chosen_dir;
@@ -279,11 +307,24 @@ void Think_CylinderHoming (gentity_t *self) {
 	VectorCopy(forward, chosen_dir);
 	chosen_length = -1;
 
+	// Only clients whose bounds reach into the homing cylinder can qualify.
+	for ( i = 0 ; i < 2 ; i++ ) {
+		mins[i] = self->r.currentOrigin[i] - self->homRange;
+		maxs[i] = self->r.currentOrigin[i] + self->homRange;
+	}
+	mins[2] = -99999;
+	maxs[2] = self->r.currentOrigin[2];
+	numListedEntities = G_SpatialEntitiesInBox( mins, maxs, entityList, MAX_SPATIAL_RESULTS );
+	target_owner = GetMissileOwnerEntity( self );
+
 	// Cycle through the clients for a qualified target
-	for (i = 0; i < level.maxclients; i++) {
+	for (e = 0; e < numListedEntities; e++) {
+		// The list is sorted, so the clients come first.
+		i = entityList[e];
+		if ( i >= level.maxclients ) break;
+
 		// Here we use target_ent to point to potential targets
 		target_ent = &g_entities[i];
-		target_owner = GetMissileOwnerEntity( self );
 
 		if (!target_ent->inuse) continue;
 		if (target_ent == target_owner) continue;
@@ -520,14 +561,14 @@ qboolean G_UserRadiusDamage ( vec3_t origin, gentity_t *attacker, gentity_t *ign
 		maxs[i] = origin[i] + radius;
 	}
 
-	numListedEntities = trap_EntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
+	numListedEntities = G_SpatialEntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
 
 	for ( e = 0 ; e < numListedEntities ; e++ ) {
 		ent = &g_entities[entityList[ e ]];
 
 		if (ent == ignore)
 			continue;
-		if (!ent->takedamage)
+		if (!ent->takedamage || !ent->r.linked)
 			continue;
 		if (ent == owner && ignore->isBlindable)
 			continue;
@@ -1558,6 +1599,7 @@ void G_RunUserMissile( gentity_t *ent ) {
 	}
 	//Missile_Smooth(ent,origin,&trace);
 	trap_LinkEntity(ent);
+	G_SpatialLinkEntity(ent);
 	//G_Printf("%i\n",ent->r.currentOrigin);
 
 	if(trace.fraction != 1){
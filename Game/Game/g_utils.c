@@ -463,6 +463,7 @@ Marks the entity as free
 */
 void G_FreeEntity( gentity_t *ed ) {
 	trap_UnlinkEntity (ed);		// unlink from world
+	G_SpatialUnlinkEntity (ed);
 
 	if ( ed->neverFree ) {
 		return;
@@ -10,6 +10,186 @@ static g_userWeaponParseBuffer_t	g_weapPhysBuffer;
 	// FIXME: Can this be a local variable instead, or would it give us
 	//		  > 32k locals errors in the VM-bytecode compiler?
 
+
+// --< Compiled script cache >--
+
+// Clients sharing a character share their scripts, so the results of
+// a parse are kept around and copied out again on the next request.
+// Every cached result remembers the checksums of the files it was
+// compiled from, and is discarded as soon as one of those changes.
+
+typedef struct {
+	char	filename[MAX_QPATH];
+	int		checksum;
+} g_weapPhysDependency_t;
+
+typedef struct {
+	char						filename[MAX_QPATH];
+	char						refname[MAX_TOKENSTRING_LENGTH];
+	g_weapPhysDependency_t		deps[MAX_SCRIPT_DEPENDENCIES];
+	int							numDeps;
+	int							depth;		// Recursion levels the definition needs
+	g_userWeaponParseBuffer_t	buffer;
+	qboolean					active;
+} g_weapPhysDefinitionCache_t;
+
+typedef struct {
+	char						filename[MAX_QPATH];
+	g_weapPhysDependency_t		deps[MAX_SCRIPT_DEPENDENCIES];
+	int							numDeps;
+	int							weaponMask;
+	g_userWeaponParseBuffer_t	priBuffer[MAX_LINKS];
+	g_userWeaponParseBuffer_t	secBuffer[MAX_LINKS];
+	qboolean					active;
+} g_weapPhysScriptCache_t;
+
+static g_weapPhysScriptCache_t		g_weapPhysScriptCache[MAX_CACHED_SCRIPTS];
+static g_weapPhysDefinitionCache_t	g_weapPhysDefinitionCache[MAX_CACHED_DEFINITIONS];
+static g_weapPhysScriptCache_t		g_weapPhysCompiling;
+static g_userWeaponParseBuffer_t	g_weapPhysEmptyBuffer;
+static int							g_weapPhysNextScript;
+static int							g_weapPhysNextDefinition;
+static int							g_weapPhysPeakDepth;
+
+// Files loaded or checked during the current call to G_weapPhys_Parse.
+#define MAX_PARSE_DEPENDENCIES		64
+static g_weapPhysDependency_t		g_weapPhysDeps[MAX_PARSE_DEPENDENCIES];
+static int							g_weapPhysNumDeps;
+static qboolean						g_weapPhysDepsOverflow;
+
+static struct {
+	int		scriptHits;
+	int		scriptMisses;
+	int		definitionHits;
+	int		definitionMisses;
+	int		invalidated;
+} g_weapPhysCacheStats;
+
+
+/*
+============================
+G_weapPhys_AddDependency
+============================
+Records a file the current parse depends on.
+*/
+static void G_weapPhys_AddDependency( char *filename, int checksum ) {
+	g_weapPhysDependency_t *dep;
+
+	if ( g_weapPhysNumDeps == MAX_PARSE_DEPENDENCIES ) {
+		g_weapPhysDepsOverflow = qtrue;
+		return;
+	}
+
+	dep = &g_weapPhysDeps[g_weapPhysNumDeps++];
+	Q_strncpyz( dep->filename, filename, sizeof(dep->filename) );
+	dep->checksum = checksum;
+}
+
+
+/*
+============================
+G_weapPhys_CheckDependencies
+============================
+Returns qfalse if any of the files a cached result
+was compiled from has changed. Every file is read
+at most once per call to G_weapPhys_Parse.
+*/
+static qboolean G_weapPhys_CheckDependencies( g_weapPhysDependency_t *deps, int numDeps ) {
+	int i, j;
+	int checksum;
+
+	for ( i = 0; i < numDeps; i++ ) {
+		for ( j = 0; j < g_weapPhysNumDeps; j++ ) {
+			if ( !Q_stricmp( g_weapPhysDeps[j].filename, deps[i].filename ) ) {
+				break;
+			}
+		}
+
+		if ( j < g_weapPhysNumDeps ) {
+			checksum = g_weapPhysDeps[j].checksum;
+		} else {
+			checksum = G_weapPhys_FileChecksum( deps[i].filename );
+		}
+
+		// Also record it for any result that's being compiled right now.
+		G_weapPhys_AddDependency( deps[i].filename, checksum );
+
+		if ( checksum != deps[i].checksum ) {
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+
+/*
+============================
+G_weapPhys_CopyDependencies
+============================
+Copies the dependencies recorded since 'start' into a cache
+entry, dropping duplicates. Returns -1 if they don't fit.
+*/
+static int G_weapPhys_CopyDependencies( g_weapPhysDependency_t *deps, int start ) {
+	int i, j;
+	int numDeps;
+
+	if ( g_weapPhysDepsOverflow ) {
+		return -1;
+	}
+
+	numDeps = 0;
+	for ( i = start; i < g_weapPhysNumDeps; i++ ) {
+		for ( j = 0; j < numDeps; j++ ) {
+			if ( !Q_stricmp( deps[j].filename, g_weapPhysDeps[i].filename ) ) {
+				break;
+			}
+		}
+
+		if ( j < numDeps ) {
+			continue;
+		}
+
+		if ( numDeps == MAX_SCRIPT_DEPENDENCIES ) {
+			return -1;
+		}
+
+		deps[numDeps++] = g_weapPhysDeps[i];
+	}
+
+	return numDeps;
+}
+
+
+/*
+============================
+G_weapPhys_CacheInfo_f
+============================
+Server console command reporting how well the
+script cache is doing.
+*/
+void G_weapPhys_CacheInfo_f( void ) {
+	int i;
+	int scripts, definitions;
+
+	scripts = definitions = 0;
+	for ( i = 0; i < MAX_CACHED_SCRIPTS; i++ ) {
+		if ( g_weapPhysScriptCache[i].active ) {
+			scripts++;
+		}
+	}
+	for ( i = 0; i < MAX_CACHED_DEFINITIONS; i++ ) {
+		if ( g_weapPhysDefinitionCache[i].active ) {
+			definitions++;
+		}
+	}
+
+	G_Printf( "Weapon physics cache:\n" );
+	G_Printf( "  scripts:     %i hits, %i misses, %i of %i cached\n", g_weapPhysCacheStats.scriptHits, g_weapPhysCacheStats.scriptMisses, scripts, MAX_CACHED_SCRIPTS );
+	G_Printf( "  definitions: %i hits, %i misses, %i of %i cached\n", g_weapPhysCacheStats.definitionHits, g_weapPhysCacheStats.definitionMisses, definitions, MAX_CACHED_DEFINITIONS );
+	G_Printf( "  %i entries invalidated by changed files\n", g_weapPhysCacheStats.invalidated );
+}
+
 /*
 =======================
 G_weapPhys_StoreBuffer
@@ -2124,6 +2304,9 @@ static qboolean G_weapPhys_IncreaseRecursionDepth( void ) {
 	}
 
 	g_weapPhysRecursionDepth++;
+	if ( g_weapPhysRecursionDepth > g_weapPhysPeakDepth ) {
+		g_weapPhysPeakDepth = g_weapPhysRecursionDepth;
+	}
 	return qtrue;
 }
 
@@ -2142,13 +2325,13 @@ static void G_weapPhys_DecreaseRecursionDepth( void ) {
 qboolean G_weapPhys_ParseDefinition( g_weapPhysParser_t *parser, char* refname, g_weapPhysAccessLvls_t *accessLvl );
 
 /*
-==================================
-G_weapPhys_ParseRemoteDefinition
-==================================
+====================================
+G_weapPhys_CompileRemoteDefinition
+====================================
 Instantiates a new parser and scanner
 to parse a remote definition
 */
-qboolean G_weapPhys_ParseRemoteDefinition( char *filename, char *refname ) {
+static qboolean G_weapPhys_CompileRemoteDefinition( char *filename, char *refname ) {
 	g_weapPhysParser_t		parser;
 	g_weapPhysScanner_t		*scanner;
 	g_weapPhysToken_t		*token;
@@ -2161,6 +2344,7 @@ qboolean G_weapPhys_ParseRemoteDefinition( char *filename, char *refname ) {
 
 	// Initialize the scanner by loading the file
 	G_weapPhys_LoadFile( scanner, filename );
+	G_weapPhys_AddDependency( filename, scanner->checksum );
 
 	// Get the very first token initialized. If
 	// it is an end of file token, we will not parse
@@ -2218,6 +2402,87 @@ qboolean G_weapPhys_ParseRemoteDefinition( char *filename, char *refname ) {
 }
 
 
+/*
+==================================
+G_weapPhys_ParseRemoteDefinition
+==================================
+Parses a remote definition into the buffer, or
+copies it from the cache if the same (file, refname)
+pair was compiled before.
+*/
+qboolean G_weapPhys_ParseRemoteDefinition( char *filename, char *refname ) {
+	g_weapPhysDefinitionCache_t	*cached;
+	int							i;
+	int							depStart;
+	int							startDepth;
+	int							savedPeak;
+	int							numDeps;
+	qboolean					cacheable;
+
+	// Imported definitions always start a chain of inheritance, so
+	// the buffer is normally empty here. If it isn't, the result
+	// depends on what came before and can't be shared.
+	cacheable = !memcmp( &g_weapPhysBuffer, &g_weapPhysEmptyBuffer, sizeof(g_weapPhysBuffer) );
+
+	for ( i = 0; cacheable && i < MAX_CACHED_DEFINITIONS; i++ ) {
+		cached = &g_weapPhysDefinitionCache[i];
+		if ( !cached->active || Q_stricmp( cached->filename, filename ) || strcmp( cached->refname, refname ) ) {
+			continue;
+		}
+
+		if ( !G_weapPhys_CheckDependencies( cached->deps, cached->numDeps ) ) {
+			cached->active = qfalse;
+			g_weapPhysCacheStats.invalidated++;
+			break;
+		}
+
+		// Let a full parse report the error if inheriting this deep isn't allowed.
+		if ( g_weapPhysRecursionDepth + cached->depth > MAX_RECURSION_DEPTH ) {
+			break;
+		}
+
+		if ( g_weapPhysRecursionDepth + cached->depth > g_weapPhysPeakDepth ) {
+			g_weapPhysPeakDepth = g_weapPhysRecursionDepth + cached->depth;
+		}
+
+		memcpy( &g_weapPhysBuffer, &cached->buffer, sizeof(g_weapPhysBuffer) );
+		g_weapPhysCacheStats.definitionHits++;
+		return qtrue;
+	}
+
+	g_weapPhysCacheStats.definitionMisses++;
+
+	depStart = g_weapPhysNumDeps;
+	startDepth = g_weapPhysRecursionDepth;
+	savedPeak = g_weapPhysPeakDepth;
+	g_weapPhysPeakDepth = startDepth;
+
+	if ( !G_weapPhys_CompileRemoteDefinition( filename, refname ) ) {
+		return qfalse;
+	}
+
+	if ( cacheable ) {
+		cached = &g_weapPhysDefinitionCache[g_weapPhysNextDefinition];
+		numDeps = G_weapPhys_CopyDependencies( cached->deps, depStart );
+		if ( numDeps >= 0 ) {
+			Q_strncpyz( cached->filename, filename, sizeof(cached->filename) );
+			Q_strncpyz( cached->refname, refname, sizeof(cached->refname) );
+			cached->numDeps = numDeps;
+			cached->depth = g_weapPhysPeakDepth - startDepth;
+			memcpy( &cached->buffer, &g_weapPhysBuffer, sizeof(cached->buffer) );
+			cached->active = qtrue;
+			g_weapPhysNextDefinition = ( g_weapPhysNextDefinition + 1 ) % MAX_CACHED_DEFINITIONS;
+		}
+	}
+
+	if ( savedPeak > g_weapPhysPeakDepth ) {
+		g_weapPhysPeakDepth = savedPeak;
+	}
+
+	return qtrue;
+}
+
+
 /*
 ============================
 G_weapPhys_ParseDefinition
@@ -2325,7 +2590,9 @@ qboolean G_weapPhys_Parse( char *filename, int clientNum ) {
 	g_weapPhysParser_t		parser;
 	g_weapPhysScanner_t		*scanner;
 	g_weapPhysToken_t		*token;
-	int						i;
+	g_weapPhysScriptCache_t	*cached;
+	int						i, j;
+	int						numDeps;
 	int						*weaponMask;
 
 	// Initialize the parser
@@ -2333,14 +2600,54 @@ qboolean G_weapPhys_Parse( char *filename, int clientNum ) {
 	scanner = &parser.scanner;
 	token = &parser.token;
 	g_weapPhysRecursionDepth = 0;
+	g_weapPhysPeakDepth = 0;
+	g_weapPhysNumDeps = 0;
+	g_weapPhysDepsOverflow = qfalse;
 
 	// Clear the weapons here, so we are never stuck with 'ghost' weapons
 	// if an error occurs in the parse.
 	weaponMask = G_FindUserWeaponMask( clientNum );
 	*weaponMask = 0;
-	
+
+	// Copy the weapons from an earlier parse of the same script, if
+	// none of its files changed since.
+	for ( i = 0; i < MAX_CACHED_SCRIPTS; i++ ) {
+		cached = &g_weapPhysScriptCache[i];
+		if ( !cached->active || Q_stricmp( cached->filename, filename ) ) {
+			continue;
+		}
+
+		if ( !G_weapPhys_CheckDependencies( cached->deps, cached->numDeps ) ) {
+			cached->active = qfalse;
+			g_weapPhysCacheStats.invalidated++;
+			break;
+		}
+
+		for ( j = 0; j < MAX_LINKS; j++ ) {
+			if ( !( cached->weaponMask & ( 1 << (j+1) ) ) ) {
+				continue;
+			}
+			memcpy( &g_weapPhysBuffer, &cached->priBuffer[j], sizeof(g_weapPhysBuffer) );
+			G_weapPhys_StoreBuffer( clientNum, j );
+			memcpy( &g_weapPhysBuffer, &cached->secBuffer[j], sizeof(g_weapPhysBuffer) );
+			G_weapPhys_StoreBuffer( clientNum, j + ALTWEAPON_OFFSET );
+		}
+		*weaponMask = cached->weaponMask;
+		g_weapPhysCacheStats.scriptHits++;
+
+		if ( g_verboseParse.integer ) {
+			G_Printf( "Using cached weapons for '%s', mask reads: %i\n", filename, *weaponMask );
+		}
+
+		return qtrue;
+	}
+
+	g_weapPhysCacheStats.scriptMisses++;
+	memset( &g_weapPhysCompiling, 0, sizeof(g_weapPhysCompiling) );
+
 	// Initialize the scanner by loading the file
 	G_weapPhys_LoadFile( scanner, filename );
+	G_weapPhys_AddDependency( filename, scanner->checksum );
 
 	// Get the very first token initialized. If
 	// it is an end of file token, we will not parse
@@ -2394,6 +2701,7 @@ qboolean G_weapPhys_Parse( char *filename, int clientNum ) {
 			return qfalse;
 		}
 
+		memcpy( &g_weapPhysCompiling.priBuffer[i], &g_weapPhysBuffer, sizeof(g_weapPhysBuffer) );
 		G_weapPhys_StoreBuffer( clientNum, i );
 
 		// Empty the buffer.
@@ -2412,6 +2720,7 @@ qboolean G_weapPhys_Parse( char *filename, int clientNum ) {
 			g_weapPhysBuffer.general_bitflags |= WPF_ALTWEAPONPRESENT;
 		}
 
+		memcpy( &g_weapPhysCompiling.secBuffer[i], &g_weapPhysBuffer, sizeof(g_weapPhysBuffer) );
 		G_weapPhys_StoreBuffer( clientNum, i + ALTWEAPON_OFFSET );
 
 
@@ -2425,6 +2734,27 @@ qboolean G_weapPhys_Parse( char *filename, int clientNum ) {
 		
 	}
 
+	// Keep the result around for the next client using this script.
+	numDeps = G_weapPhys_CopyDependencies( g_weapPhysCompiling.deps, 0 );
+	if ( numDeps >= 0 ) {
+		Q_strncpyz( g_weapPhysCompiling.filename, filename, sizeof(g_weapPhysCompiling.filename) );
+		g_weapPhysCompiling.numDeps = numDeps;
+		g_weapPhysCompiling.weaponMask = *weaponMask;
+		g_weapPhysCompiling.active = qtrue;
+
+		// Replace an older entry for the same file, if there is one.
+		for ( i = 0; i < MAX_CACHED_SCRIPTS; i++ ) {
+			if ( !Q_stricmp( g_weapPhysScriptCache[i].filename, filename ) ) {
+				break;
+			}
+		}
+		if ( i == MAX_CACHED_SCRIPTS ) {
+			i = g_weapPhysNextScript;
+			g_weapPhysNextScript = ( g_weapPhysNextScript + 1 ) % MAX_CACHED_SCRIPTS;
+		}
+		memcpy( &g_weapPhysScriptCache[i], &g_weapPhysCompiling, sizeof(g_weapPhysCompiling) );
+	}
+
 	if ( g_verboseParse.integer ) {
 		G_Printf("Parse completed succesfully.\n");
 	}
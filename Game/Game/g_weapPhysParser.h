@@ -12,6 +12,9 @@
 #define MAX_LINKS	  6 // We only have 6 weapon definitions, after all.
 
 #define MAX_RECURSION_DEPTH		   5
+#define MAX_SCRIPT_DEPENDENCIES	   8	// Files a cached result may be compiled from
+#define MAX_CACHED_SCRIPTS		  32
+#define MAX_CACHED_DEFINITIONS	  64
 #define MAX_SCRIPT_LENGTH		8192		// 2^13
 #define MAX_TOKENSTRING_LENGTH	MAX_QPATH	// Equal to MAX_QPATH, to prevent problems
 											// with reading filenames.
@@ -109,6 +112,7 @@ typedef struct {
 	int		line;
 	char	*pos;
 	char	filename[MAX_QPATH];
+	int		checksum;		// 0 if the file could not be loaded
 } g_weapPhysScanner_t;
 
 typedef struct {
@@ -221,6 +225,8 @@ extern char *g_weapPhysCategories[];
 // -Lexical Scanner-
 qboolean G_weapPhys_NextSym( g_weapPhysScanner_t *scanner, g_weapPhysToken_t *token );
 qboolean G_weapPhys_LoadFile( g_weapPhysScanner_t *scanner, char *filename );
+int G_weapPhys_Checksum( const char *data, int len );
+int G_weapPhys_FileChecksum( char *filename );
 // -Token Parser-
 void G_weapPhys_ErrorHandle( g_weapPhysError_t errorNr, g_weapPhysScanner_t *scanner, char *string1, char *string2 );
 // -Attribute Evaluator-
@@ -558,6 +558,7 @@ qboolean G_weapPhys_LoadFile( g_weapPhysScanner_t *scanner, char *filename ) {
 
 	// Ensure null termination
 	scanner->script[len] = '\0';
+	scanner->checksum = G_weapPhys_Checksum( scanner->script, len );
 
 	// Set starting position
 	scanner->line = 0;
@@ -571,3 +572,58 @@ qboolean G_weapPhys_LoadFile( g_weapPhysScanner_t *scanner, char *filename ) {
 
 	return qtrue;
 }
+
+
+/*
+=====================
+G_weapPhys_Checksum
+=====================
+Hashes the contents of a scriptfile, so cached
+parse results can be checked against the file
+they were compiled from.
+*/
+int G_weapPhys_Checksum( const char *data, int len ) {
+	unsigned int	hash;
+	int				i;
+
+	hash = 2166136261u;
+	for ( i = 0; i < len; i++ ) {
+		hash = ( hash ^ (byte)data[i] ) * 16777619u;
+	}
+
+	// Zero is reserved for files that could not be read.
+	if ( !hash ) {
+		hash = 1;
+	}
+
+	return (int)hash;
+}
+
+
+/*
+=======================
+G_weapPhys_FileChecksum
+=======================
+Returns the checksum of a scriptfile without
+scanning it, or 0 if the file can't be loaded.
+*/
+int G_weapPhys_FileChecksum( char *filename ) {
+	static char	script[MAX_SCRIPT_LENGTH];
+	int			len;
+	qhandle_t	file;
+
+	len = trap_FS_FOpenFile( filename, &file, FS_READ );
+	if ( !file ) {
+		return 0;
+	}
+
+	if ( len >= ( sizeof(char) * MAX_SCRIPT_LENGTH - 1 ) ) {
+		trap_FS_FCloseFile( file );
+		return 0;
+	}
+
+	trap_FS_Read( script, len, file );
+	trap_FS_FCloseFile( file );
+
+	return G_weapPhys_Checksum( script, len );
+}
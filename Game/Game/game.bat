@@ -59,6 +59,8 @@ if "%1"=="TA" goto TA
 @if errorlevel 1 goto quit
 %cc%  ../g_radar.c
 @if errorlevel 1 goto quit
+%cc%  ../g_spatial.c
+@if errorlevel 1 goto quit
 %cc%  ../g_weapPhysParser.c
 @if errorlevel 1 goto quit
 %cc%  ../g_weapPhysScanner.c
@@ -224,6 +224,57 @@ void CM_BoundBrush( cbrush_t *b ) {
 }
 
 
+#if CM_SSE
+/*
+=================
+CMod_BuildBrushSides4
+
+Copies the side planes of every brush into blocks of four so the
+trace code can test a whole block at once
+=================
+*/
+static void CMod_BuildBrushSides4( void ) {
+	cbrush_t		*b;
+	cbrushSides4_t	*out;
+	cplane_t		*plane;
+	int				i, j, numBlocks;
+
+	numBlocks = 0;
+	for ( i = 0, b = cm.brushes ; i < cm.numBrushes ; i++, b++ ) {
+		if ( b->numsides > 0 ) {
+			numBlocks += ( b->numsides + 3 ) >> 2;
+		}
+	}
+	if ( !numBlocks ) {
+		return;
+	}
+
+	out = Hunk_Alloc( numBlocks * sizeof( *out ), h_high );
+
+	for ( i = 0, b = cm.brushes ; i < cm.numBrushes ; i++, b++ ) {
+		if ( b->numsides <= 0 ) {
+			continue;
+		}
+		b->sides4 = out;
+		for ( j = 0 ; j < ( ( b->numsides + 3 ) & ~3 ) ; j++ ) {
+			if ( j < b->numsides ) {
+				plane = b->sides[j].plane;
+				out[j>>2].normal[0][j&3] = plane->normal[0];
+				out[j>>2].normal[1][j&3] = plane->normal[1];
+				out[j>>2].normal[2][j&3] = plane->normal[2];
+				out[j>>2].dist[j&3] = plane->dist;
+			} else {
+				out[j>>2].normal[0][j&3] = 0;
+				out[j>>2].normal[1][j&3] = 0;
+				out[j>>2].normal[2][j&3] = 0;
+				out[j>>2].dist[j&3] = SIDES4_INERT_DIST;
+			}
+		}
+		out += ( b->numsides + 3 ) >> 2;
+	}
+}
+#endif
+
 /*
 =================
 CMod_LoadBrushes
@@ -259,6 +310,9 @@ void CMod_LoadBrushes( lump_t *l ) {
 		CM_BoundBrush( out );
 	}
 
+#if CM_SSE
+	CMod_BuildBrushSides4();
+#endif
 }
 
 /*
@@ -595,6 +649,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	// free old stuff
 	Com_Memset( &cm, 0, sizeof( cm ) );
 	CM_ClearLevelPatches();
+	CM_ClearTraceMemo();
 
 	if ( !name[0] ) {
 		cm.numLeafs = 1;
@@ -609,7 +664,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	// load the file
 	//
 #ifndef BSPC
-	length = FS_ReadFile( name, &buf.v );
+	length = FS_ReadFileView( name, &buf.v );
 #else
 	length = LoadQuakeFile((quakefile_t *) name, &buf.v);
 #endif
@@ -648,7 +703,11 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	CMod_LoadPatches( &header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS] );
 
 	// we are NOT freeing the file, because it is cached for the ref
+#ifndef BSPC
+	FS_ReleaseView (buf.v);
+#else
 	FS_FreeFile (buf.v);
+#endif
 
 	CM_InitBoxHull ();
 
@@ -668,6 +727,7 @@ CM_ClearMap
 void CM_ClearMap( void ) {
 	Com_Memset( &cm, 0, sizeof( cm ) );
 	CM_ClearLevelPatches();
+	CM_ClearTraceMemo();
 }
 
 /*
@@ -757,6 +817,7 @@ void CM_InitBoxHull (void)
 	box_brush->numsides = 6;
 	box_brush->sides = cm.brushsides + cm.numBrushSides;
 	box_brush->contents = CONTENTS_BODY;
+	box_brush->sides4 = NULL;	// planes are rewritten by every CM_TempBoxModel
 
 	box_model.leaf.numLeafBrushes = 1;
 //	box_model.leaf.firstLeafBrush = cm.numBrushes;
@@ -24,6 +24,13 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "qcommon.h"
 #include "cm_polylib.h"
 
+#if idx64 || ( id386 && defined( __SSE__ ))
+#include <xmmintrin.h>
+#define CM_SSE				1
+#else
+#define CM_SSE				0
+#endif
+
 #define	MAX_SUBMODELS			256
 #define	BOX_MODEL_HANDLE		255
 #define CAPSULE_MODEL_HANDLE	254
@@ -56,12 +63,22 @@ typedef struct {
 	int			shaderNum;
 } cbrushside_t;
 
+// brush side planes regrouped four to a block for the SSE plane tests,
+// lanes past numsides hold an inert plane that never clips anything
+typedef struct {
+	float		normal[3][4];
+	float		dist[4];
+} cbrushSides4_t;
+
+#define	SIDES4_INERT_DIST	1e30f
+
 typedef struct {
 	int			shaderNum;		// the shader that determined the contents
 	int			contents;
 	vec3_t		bounds[2];
 	int			numsides;
 	cbrushside_t	*sides;
+	cbrushSides4_t	*sides4;	// NULL if the brush must use the scalar tests
 	int			checkcount;		// to avoid repeated testings
 } cbrush_t;
 
@@ -151,7 +168,22 @@ typedef struct
 	vec3_t		offset;
 } sphere_t;
 
+#if CM_SSE
+// the trace parameters the block side tests need, splatted across all lanes
+typedef struct {
+	__m128		size[2][3];
+	__m128		start[3];
+	__m128		end[3];
+	__m128		zero;
+	__m128		epsilon;
+} traceWork4_t;
+#endif
+
 typedef struct {
+#if CM_SSE
+	traceWork4_t	tw4;		// set up by the first brush that needs it
+	qboolean	tw4Valid;
+#endif
 	vec3_t		start;
 	vec3_t		end;
 	vec3_t		size[2];	// size of the box being swept through the model
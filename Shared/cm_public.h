@@ -46,6 +46,11 @@ void		CM_TransformedBoxTrace( trace_t *results, const vec3_t start, const vec3_t
 						  clipHandle_t model, int brushmask,
 						  const vec3_t origin, const vec3_t angles, int capsule );
 
+// CM_BoxTrace remembers its results until this is called once per frame
+void		CM_ClearTraceMemo( void );
+void		CM_TraceRecord_f( void );
+void		CM_TraceBench_f( void );
+
 byte		*CM_ClusterPVS (int cluster);
 
 int			CM_PointLeafnum( const vec3_t p );
@@ -28,6 +28,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 //#define CAPSULE_DEBUG
 
+// tracebench turns these off to produce the reference results
+static qboolean	cm_useSides4 = qtrue;
+static qboolean	cm_useTraceMemo = qtrue;
+
 /*
 ===============================================================================
 
@@ -145,6 +149,78 @@ float SquareRootFloat(float number) {
 }
 
 
+#if CM_SSE
+/*
+===============================================================================
+
+SSE BRUSH SIDES
+
+===============================================================================
+*/
+
+/*
+================
+CM_SetupTraceWork4
+================
+*/
+static void CM_SetupTraceWork4( traceWork_t *tw ) {
+	traceWork4_t	*tw4;
+	int				i;
+
+	tw4 = &tw->tw4;
+	tw->tw4Valid = qtrue;
+
+	for ( i = 0 ; i < 3 ; i++ ) {
+		tw4->size[0][i] = _mm_set1_ps( tw->size[0][i] );
+		tw4->size[1][i] = _mm_set1_ps( tw->size[1][i] );
+		tw4->start[i] = _mm_set1_ps( tw->start[i] );
+		tw4->end[i] = _mm_set1_ps( tw->end[i] );
+	}
+	tw4->zero = _mm_setzero_ps();
+	tw4->epsilon = _mm_set1_ps( SURFACE_CLIP_EPSILON );
+}
+
+/*
+================
+CM_Sides4Distances
+
+Start and end distances of the box to four side planes at once.  The
+corner picks size[1] on the axes where the normal is negative, which is
+what offsets[signbits] holds, and the products are summed in DotProduct
+order, so a lane only differs from the scalar loop where the compiler
+has reordered that loop's float math
+================
+*/
+static ID_INLINE void CM_Sides4Distances( const traceWork4_t *tw4, const cbrushSides4_t *block,
+										 __m128 *d1, __m128 *d2 ) {
+	__m128	nx, ny, nz;
+	__m128	neg, ox, oy, oz;
+	__m128	dist;
+
+	nx = _mm_loadu_ps( block->normal[0] );
+	ny = _mm_loadu_ps( block->normal[1] );
+	nz = _mm_loadu_ps( block->normal[2] );
+
+	neg = _mm_cmplt_ps( nx, tw4->zero );
+	ox = _mm_or_ps( _mm_and_ps( neg, tw4->size[1][0] ), _mm_andnot_ps( neg, tw4->size[0][0] ) );
+	neg = _mm_cmplt_ps( ny, tw4->zero );
+	oy = _mm_or_ps( _mm_and_ps( neg, tw4->size[1][1] ), _mm_andnot_ps( neg, tw4->size[0][1] ) );
+	neg = _mm_cmplt_ps( nz, tw4->zero );
+	oz = _mm_or_ps( _mm_and_ps( neg, tw4->size[1][2] ), _mm_andnot_ps( neg, tw4->size[0][2] ) );
+
+	// adjust the plane distance apropriately for mins/maxs
+	dist = _mm_sub_ps( _mm_loadu_ps( block->dist ),
+		_mm_add_ps( _mm_add_ps( _mm_mul_ps( ox, nx ), _mm_mul_ps( oy, ny ) ), _mm_mul_ps( oz, nz ) ) );
+
+	*d1 = _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( tw4->start[0], nx ), _mm_mul_ps( tw4->start[1], ny ) ),
+		_mm_mul_ps( tw4->start[2], nz ) ), dist );
+	if ( d2 ) {
+		*d2 = _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( tw4->end[0], nx ), _mm_mul_ps( tw4->end[1], ny ) ),
+			_mm_mul_ps( tw4->end[2], nz ) ), dist );
+	}
+}
+#endif
+
 /*
 ===============================================================================
 
@@ -166,6 +242,10 @@ void CM_TestBoxInBrush( traceWork_t *tw, cbrush_t *brush ) {
 	cbrushside_t	*side;
 	float		t;
 	vec3_t		startp;
+#if CM_SSE
+	const cbrushSides4_t	*block;
+	__m128		v1;
+#endif
 
 	if (!brush->numsides) {
 		return;
@@ -207,6 +287,21 @@ void CM_TestBoxInBrush( traceWork_t *tw, cbrush_t *brush ) {
 				return;
 			}
 		}
+#if CM_SSE
+	} else if ( brush->sides4 && cm_useSides4 ) {
+		if ( !tw->tw4Valid ) {
+			CM_SetupTraceWork4( tw );
+		}
+		// the axial planes are sides 0 to 5, so the first block
+		// tested holds two of them that have to be masked off
+		for ( i = 4, block = brush->sides4 + 1 ; i < brush->numsides ; i += 4, block++ ) {
+			CM_Sides4Distances( &tw->tw4, block, &v1, NULL );
+			// if completely in front of face, no intersection
+			if ( _mm_movemask_ps( _mm_cmpgt_ps( v1, tw->tw4.zero ) ) & ( i == 4 ? 12 : 15 ) ) {
+				return;
+			}
+		}
+#endif
 	} else {
 		// the first six planes are the axial planes, so we only
 		// need to test the remainder
@@ -491,6 +586,12 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 	float		t;
 	vec3_t		startp;
 	vec3_t		endp;
+#if CM_SSE
+	const cbrushSides4_t	*block;
+	__m128		v1, v2;
+	float		d1s[4], d2s[4];
+	int			j, cross, startOut, endOut;
+#endif
 
 	enterFrac = -1.0;
 	leaveFrac = 1.0;
@@ -574,6 +675,74 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 				}
 			}
 		}
+#if CM_SSE
+	} else if ( brush->sides4 && cm_useSides4 ) {
+		//
+		// same as the loop below, four planes at a time: a block with any
+		// plane the trace is completely in front of ends the test, and the
+		// planes it crosses are then clipped in side order
+		//
+		if ( !tw->tw4Valid ) {
+			CM_SetupTraceWork4( tw );
+		}
+		for ( i = 0, block = brush->sides4 ; i < brush->numsides ; i += 4, block++ ) {
+			CM_Sides4Distances( &tw->tw4, block, &v1, &v2 );
+
+			// if completely in front of face, no intersection with the entire brush
+			if ( _mm_movemask_ps( _mm_and_ps( _mm_cmpgt_ps( v1, tw->tw4.zero ),
+				_mm_or_ps( _mm_cmpge_ps( v2, tw->tw4.epsilon ), _mm_cmpge_ps( v2, v1 ) ) ) ) ) {
+				return;
+			}
+
+			endOut = _mm_movemask_ps( _mm_cmpgt_ps( v2, tw->tw4.zero ) );
+			startOut = _mm_movemask_ps( _mm_cmpgt_ps( v1, tw->tw4.zero ) );
+			if ( endOut ) {
+				getout = qtrue;	// endpoint is not in solid
+			}
+			if ( startOut ) {
+				startout = qtrue;
+			}
+
+			// if it doesn't cross the plane, the plane isn't relevent
+			cross = startOut | endOut;
+			if ( !cross ) {
+				continue;
+			}
+
+			_mm_storeu_ps( d1s, v1 );
+			_mm_storeu_ps( d2s, v2 );
+			for ( j = 0 ; j < 4 ; j++ ) {
+				if ( !( cross & ( 1 << j ) ) ) {
+					continue;
+				}
+				d1 = d1s[j];
+				d2 = d2s[j];
+				side = brush->sides + i + j;
+				plane = side->plane;
+
+				// crosses face
+				if (d1 > d2) {	// enter
+					f = (d1-SURFACE_CLIP_EPSILON) / (d1-d2);
+					if ( f < 0 ) {
+						f = 0;
+					}
+					if (f > enterFrac) {
+						enterFrac = f;
+						clipplane = plane;
+						leadside = side;
+					}
+				} else {	// leave
+					f = (d1+SURFACE_CLIP_EPSILON) / (d1-d2);
+					if ( f > 1 ) {
+						f = 1;
+					}
+					if (f < leaveFrac) {
+						leaveFrac = f;
+					}
+				}
+			}
+		}
+#endif
 	} else {
 		//
 		// compare the trace against all planes of the brush
@@ -1354,6 +1523,106 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 	*results = tw.trace;
 }
 
+/*
+===============================================================================
+
+TRACE MEMO
+
+Movement code asks the same question several times a frame, so
+CM_BoxTrace remembers recent answers against the static models.
+The temporary box and capsule models change with every query and
+are never remembered.
+
+===============================================================================
+*/
+
+#define	TRACE_MEMO_SIZE		256		// must be a power of two
+
+typedef struct {
+	vec3_t		start, end;
+	vec3_t		mins, maxs;
+	int			model;			// -1 marks a frame boundary in recordings
+	int			brushmask;
+	int			capsule;
+} traceQuery_t;
+
+typedef struct {
+	traceQuery_t	query;
+	int				frame;
+	trace_t			trace;
+} traceMemo_t;
+
+static traceMemo_t	cm_traceMemo[TRACE_MEMO_SIZE];
+static int			cm_traceMemoFrame = 1;	// entries from older frames are stale
+static int			c_traceMemoLookups, c_traceMemoHits;
+
+#ifndef BSPC
+static fileHandle_t	cm_traceRecordFile;
+static int			cm_traceRecordCount;
+
+static void CM_RecordTraceQuery( const traceQuery_t *query );
+#endif
+
+/*
+==================
+CM_ClearTraceMemo
+==================
+*/
+void CM_ClearTraceMemo( void ) {
+	cm_traceMemoFrame++;
+#ifndef BSPC
+	if ( cm_traceRecordFile ) {
+		traceQuery_t	marker;
+
+		Com_Memset( &marker, 0, sizeof( marker ) );
+		marker.model = -1;
+		CM_RecordTraceQuery( &marker );
+	}
+#endif
+}
+
+/*
+==================
+CM_SetTraceQuery
+==================
+*/
+static void CM_SetTraceQuery( traceQuery_t *query, const vec3_t start, const vec3_t end,
+							 const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask, int capsule ) {
+	VectorCopy( start, query->start );
+	VectorCopy( end, query->end );
+	if ( mins ) {
+		VectorCopy( mins, query->mins );
+	} else {
+		VectorClear( query->mins );
+	}
+	if ( maxs ) {
+		VectorCopy( maxs, query->maxs );
+	} else {
+		VectorClear( query->maxs );
+	}
+	query->model = model;
+	query->brushmask = brushmask;
+	query->capsule = capsule;
+}
+
+/*
+==================
+CM_TraceQueryHash
+==================
+*/
+static int CM_TraceQueryHash( const traceQuery_t *query ) {
+	const unsigned	*w;
+	unsigned		hash;
+	int				i;
+
+	w = (const unsigned *)query;
+	hash = 2166136261u;
+	for ( i = 0 ; i < sizeof( *query ) / sizeof( *w ) ; i++ ) {
+		hash = ( hash ^ w[i] ) * 16777619u;
+	}
+	return ( hash ^ ( hash >> 16 ) ) & ( TRACE_MEMO_SIZE - 1 );
+}
+
 /*
 ==================
 CM_BoxTrace
@@ -1362,7 +1631,39 @@ CM_BoxTrace
 void CM_BoxTrace( trace_t *results, const vec3_t start, const vec3_t end,
 						  vec3_t mins, vec3_t maxs,
 						  clipHandle_t model, int brushmask, int capsule ) {
+	traceQuery_t	query;
+	traceMemo_t		*memo;
+
+	if ( model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE ) {
+		CM_Trace( results, start, end, mins, maxs, model, vec3_origin, brushmask, capsule, NULL );
+		return;
+	}
+
+	CM_SetTraceQuery( &query, start, end, mins, maxs, model, brushmask, capsule );
+#ifndef BSPC
+	if ( cm_traceRecordFile ) {
+		CM_RecordTraceQuery( &query );
+	}
+#endif
+
+	if ( !cm_useTraceMemo ) {
+		CM_Trace( results, start, end, mins, maxs, model, vec3_origin, brushmask, capsule, NULL );
+		return;
+	}
+
+	c_traceMemoLookups++;
+	memo = &cm_traceMemo[ CM_TraceQueryHash( &query ) ];
+	if ( memo->frame == cm_traceMemoFrame && !memcmp( &memo->query, &query, sizeof( query ) ) ) {
+		c_traceMemoHits++;
+		*results = memo->trace;
+		return;
+	}
+
 	CM_Trace( results, start, end, mins, maxs, model, vec3_origin, brushmask, capsule, NULL );
+
+	memo->query = query;
+	memo->frame = cm_traceMemoFrame;
+	memo->trace = *results;
 }
 
 /*
@@ -1464,3 +1765,401 @@ void CM_TransformedBoxTrace( trace_t *results, const vec3_t start, const vec3_t
 
 	*results = trace;
 }
+
+#ifndef BSPC
+/*
+===============================================================================
+
+TRACE BENCHMARK
+
+tracerecord saves the CM_BoxTrace queries of a running game, and
+tracebench replays them against the loaded map, checking the block
+side tests and the memo against the plain scalar code and timing both
+
+===============================================================================
+*/
+
+#define	TRACERECORD_IDENT		(('Q'<<24)+('R'<<16)+('T'<<8)+'C')	// "CTRQ"
+#define	TRACERECORD_VERSION		1
+
+#define	TRACEBENCH_ROUNDS		10
+#define	TRACEBENCH_FRAMES		256
+#define	TRACEBENCH_UNIQUE		48		// distinct queries per synthetic frame
+#define	TRACEBENCH_REPEATS		16		// repeated queries per synthetic frame
+
+typedef struct {
+	int			ident;
+	int			version;
+	char		mapname[MAX_QPATH];
+} traceRecordHeader_t;
+
+/*
+==================
+CM_SwapTraceQuery
+==================
+*/
+static void CM_SwapTraceQuery( traceQuery_t *query ) {
+	int		*w;
+	int		i;
+
+	w = (int *)query;
+	for ( i = 0 ; i < sizeof( *query ) / sizeof( *w ) ; i++ ) {
+		w[i] = LittleLong( w[i] );
+	}
+}
+
+/*
+==================
+CM_RecordTraceQuery
+==================
+*/
+static void CM_RecordTraceQuery( const traceQuery_t *query ) {
+	traceQuery_t	out;
+
+	out = *query;
+	CM_SwapTraceQuery( &out );
+	FS_Write( &out, sizeof( out ), cm_traceRecordFile );
+	if ( query->model >= 0 ) {
+		cm_traceRecordCount++;
+	}
+}
+
+/*
+==================
+CM_TraceRecord_f
+
+tracerecord <file> starts saving queries, tracerecord with no file stops
+==================
+*/
+void CM_TraceRecord_f( void ) {
+	traceRecordHeader_t	header;
+	char				name[MAX_QPATH];
+
+	if ( cm_traceRecordFile ) {
+		FS_FCloseFile( cm_traceRecordFile );
+		cm_traceRecordFile = 0;
+		Com_Printf( "recorded %i traces\n", cm_traceRecordCount );
+	}
+
+	if ( Cmd_Argc() != 2 ) {
+		if ( Cmd_Argc() > 2 ) {
+			Com_Printf( "usage: tracerecord [file]\n" );
+		}
+		return;
+	}
+
+	if ( !cm.numNodes ) {
+		Com_Printf( "tracerecord: no map loaded\n" );
+		return;
+	}
+
+	Q_strncpyz( name, Cmd_Argv( 1 ), sizeof( name ) );
+	COM_DefaultExtension( name, sizeof( name ), ".trq" );
+
+	cm_traceRecordFile = FS_FOpenFileWrite( name );
+	if ( !cm_traceRecordFile ) {
+		Com_Printf( "tracerecord: couldn't open %s\n", name );
+		return;
+	}
+
+	Com_Memset( &header, 0, sizeof( header ) );
+	header.ident = LittleLong( TRACERECORD_IDENT );
+	header.version = LittleLong( TRACERECORD_VERSION );
+	Q_strncpyz( header.mapname, cm.name, sizeof( header.mapname ) );
+	FS_Write( &header, sizeof( header ), cm_traceRecordFile );
+
+	cm_traceRecordCount = 0;
+	Com_Printf( "recording traces to %s\n", name );
+}
+
+/*
+==================
+CM_LoadTraceQueries
+
+Returns the number of entries, frame markers included, which are
+swapped in place in the file buffer
+==================
+*/
+static int CM_LoadTraceQueries( const char *name, void **buffer, traceQuery_t **queries ) {
+	union {
+		traceRecordHeader_t	*header;
+		void				*v;
+	} buf;
+	int		length, count, numTraces, i;
+
+	length = FS_ReadFile( name, &buf.v );
+	if ( !buf.v ) {
+		Com_Printf( "tracebench: couldn't load %s\n", name );
+		return 0;
+	}
+	if ( length < sizeof( traceRecordHeader_t )
+		|| LittleLong( buf.header->ident ) != TRACERECORD_IDENT
+		|| LittleLong( buf.header->version ) != TRACERECORD_VERSION ) {
+		Com_Printf( "tracebench: %s is not a trace recording\n", name );
+		FS_FreeFile( buf.v );
+		return 0;
+	}
+	if ( Q_stricmp( buf.header->mapname, cm.name ) ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: %s was recorded on %s\n", name, buf.header->mapname );
+	}
+
+	count = ( length - sizeof( traceRecordHeader_t ) ) / sizeof( traceQuery_t );
+	*queries = (traceQuery_t *)( buf.header + 1 );
+
+	numTraces = 0;
+	for ( i = 0 ; i < count ; i++ ) {
+		CM_SwapTraceQuery( &(*queries)[i] );
+		// a recording from another map may name models this one lacks
+		if ( (*queries)[i].model >= cm.numSubModels ) {
+			(*queries)[i].model = 0;
+		}
+		if ( (*queries)[i].model >= 0 ) {
+			numTraces++;
+		}
+	}
+	if ( !numTraces ) {
+		Com_Printf( "tracebench: %s holds no traces\n", name );
+		FS_FreeFile( buf.v );
+		return 0;
+	}
+
+	*buffer = buf.v;
+	return count;
+}
+
+/*
+==================
+CM_SyntheticTraceQueries
+
+Movement-like queries scattered through the world bounds, with some
+of each frame's queries asked again the way pmove and the game do
+==================
+*/
+static int CM_SyntheticTraceQueries( traceQuery_t **queries ) {
+	static const vec3_t	playerMins = { -15, -15, -24 };
+	static const vec3_t	playerMaxs = { 15, 15, 32 };
+	traceQuery_t	*q, *frame;
+	cmodel_t		*world;
+	int				seed;
+	int				i, j, k;
+
+	*queries = Hunk_AllocateTempMemory( TRACEBENCH_FRAMES * ( TRACEBENCH_UNIQUE + TRACEBENCH_REPEATS + 1 ) * sizeof( traceQuery_t ) );
+	Com_Memset( *queries, 0, TRACEBENCH_FRAMES * ( TRACEBENCH_UNIQUE + TRACEBENCH_REPEATS + 1 ) * sizeof( traceQuery_t ) );
+
+	world = &cm.cmodels[0];
+	seed = 0x7ace;
+	q = *queries;
+	for ( i = 0 ; i < TRACEBENCH_FRAMES ; i++ ) {
+		frame = q;
+		for ( j = 0 ; j < TRACEBENCH_UNIQUE ; j++, q++ ) {
+			for ( k = 0 ; k < 3 ; k++ ) {
+				q->start[k] = world->mins[k] + Q_random( &seed ) * ( world->maxs[k] - world->mins[k] );
+			}
+			VectorCopy( q->start, q->end );
+			q->brushmask = CONTENTS_SOLID | CONTENTS_PLAYERCLIP;
+			switch ( j % 3 ) {
+			case 0:		// hitscan
+				for ( k = 0 ; k < 3 ; k++ ) {
+					q->end[k] += Q_crandom( &seed ) * 1024;
+				}
+				q->brushmask = CONTENTS_SOLID;
+				break;
+			case 1:		// player move
+				q->end[0] += Q_crandom( &seed ) * 32;
+				q->end[1] += Q_crandom( &seed ) * 32;
+				VectorCopy( playerMins, q->mins );
+				VectorCopy( playerMaxs, q->maxs );
+				break;
+			default:	// ground check
+				q->end[2] -= 0.25f;
+				VectorCopy( playerMins, q->mins );
+				VectorCopy( playerMaxs, q->maxs );
+				break;
+			}
+		}
+		for ( j = 0 ; j < TRACEBENCH_REPEATS ; j++, q++ ) {
+			*q = frame[ ( Q_rand( &seed ) & 0x7fff ) % TRACEBENCH_UNIQUE ];
+		}
+		q->model = -1;
+		q++;
+	}
+	return q - *queries;
+}
+
+/*
+==================
+CM_TraceBenchPass
+==================
+*/
+static int CM_TraceBenchPass( const traceQuery_t *queries, int count, trace_t *results ) {
+	const traceQuery_t	*q;
+	int					i, start;
+
+	start = Sys_Milliseconds();
+	for ( i = 0, q = queries ; i < count ; i++, q++ ) {
+		if ( q->model < 0 ) {
+			CM_ClearTraceMemo();
+			continue;
+		}
+		CM_BoxTrace( &results[i], q->start, q->end, (float *)q->mins, (float *)q->maxs,
+			q->model, q->brushmask, q->capsule );
+	}
+	return Sys_Milliseconds() - start;
+}
+
+/*
+==================
+CM_TracesClose
+
+The scalar loops are built with -ffast-math and may sum their dot
+products in another order, so the fraction can move in its last bits
+==================
+*/
+static qboolean CM_TracesClose( const trace_t *a, const trace_t *b ) {
+	int		i;
+
+	if ( a->allsolid != b->allsolid || a->startsolid != b->startsolid
+		|| a->surfaceFlags != b->surfaceFlags || a->contents != b->contents
+		|| memcmp( &a->plane, &b->plane, sizeof( a->plane ) ) ) {
+		return qfalse;
+	}
+	if ( fabs( a->fraction - b->fraction ) > 0.0001f ) {
+		return qfalse;
+	}
+	for ( i = 0 ; i < 3 ; i++ ) {
+		if ( fabs( a->endpos[i] - b->endpos[i] ) > 0.125f ) {
+			return qfalse;
+		}
+	}
+	return qtrue;
+}
+
+/*
+==================
+CM_TraceBench_f
+
+tracebench [file] replays a recording, or synthetic queries without one
+==================
+*/
+void CM_TraceBench_f( void ) {
+	static const char	*modeNames[3] = { "scalar", "sides4", "sides4+memo" };
+	void			*buffer;
+	traceQuery_t	*queries;
+	trace_t			*reference, *sides4, *results;
+	char			name[MAX_QPATH];
+	int				count, numTraces;
+	int				msec[3];
+	int				hits, lookups;
+	int				sides4Rounded, sides4Mismatches, memoMismatches;
+	int				mode, round, i;
+
+	if ( !cm.numNodes ) {
+		Com_Printf( "tracebench: no map loaded\n" );
+		return;
+	}
+	if ( cm_traceRecordFile ) {
+		Com_Printf( "tracebench: stop tracerecord first\n" );
+		return;
+	}
+
+	if ( Cmd_Argc() > 1 ) {
+		Q_strncpyz( name, Cmd_Argv( 1 ), sizeof( name ) );
+		COM_DefaultExtension( name, sizeof( name ), ".trq" );
+		count = CM_LoadTraceQueries( name, &buffer, &queries );
+		if ( !count ) {
+			return;
+		}
+	} else {
+		Q_strncpyz( name, "synthetic queries", sizeof( name ) );
+		count = CM_SyntheticTraceQueries( &queries );
+		buffer = NULL;
+	}
+
+	numTraces = 0;
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( queries[i].model >= 0 ) {
+			numTraces++;
+		}
+	}
+
+	reference = Hunk_AllocateTempMemory( count * sizeof( trace_t ) + 1 );
+	sides4 = Hunk_AllocateTempMemory( count * sizeof( trace_t ) + 1 );
+	results = Hunk_AllocateTempMemory( count * sizeof( trace_t ) + 1 );
+	Com_Memset( reference, 0, count * sizeof( trace_t ) );
+	Com_Memset( sides4, 0, count * sizeof( trace_t ) );
+	Com_Memset( results, 0, count * sizeof( trace_t ) );
+
+	cm_useSides4 = qfalse;
+	cm_useTraceMemo = qfalse;
+	CM_TraceBenchPass( queries, count, reference );
+
+	cm_useSides4 = qtrue;
+	CM_TraceBenchPass( queries, count, sides4 );
+
+	cm_useTraceMemo = qtrue;
+	CM_ClearTraceMemo();
+	c_traceMemoHits = c_traceMemoLookups = 0;
+	CM_TraceBenchPass( queries, count, results );
+	hits = c_traceMemoHits;
+	lookups = c_traceMemoLookups;
+
+	// the block side tests must agree with the scalar loops up to
+	// rounding, and the memo must hand back exactly what it was given
+	sides4Rounded = sides4Mismatches = memoMismatches = 0;
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( memcmp( &reference[i], &sides4[i], sizeof( trace_t ) ) ) {
+			if ( CM_TracesClose( &reference[i], &sides4[i] ) ) {
+				sides4Rounded++;
+			} else {
+				sides4Mismatches++;
+			}
+		}
+		if ( memcmp( &sides4[i], &results[i], sizeof( trace_t ) ) ) {
+			memoMismatches++;
+		}
+	}
+
+	Com_Memset( msec, 0, sizeof( msec ) );
+	for ( round = 0 ; round < TRACEBENCH_ROUNDS ; round++ ) {
+		for ( mode = 0 ; mode < 3 ; mode++ ) {
+			cm_useSides4 = ( mode >= 1 );
+			cm_useTraceMemo = ( mode >= 2 );
+			CM_ClearTraceMemo();
+			msec[mode] += CM_TraceBenchPass( queries, count, results );
+		}
+	}
+
+	cm_useSides4 = qtrue;
+	cm_useTraceMemo = qtrue;
+	CM_ClearTraceMemo();
+
+#if !CM_SSE
+	Com_Printf( "no SSE in this build, sides4 runs the scalar code\n" );
+#endif
+	Com_Printf( "%s: %i traces, %i rounds\n", name, numTraces, TRACEBENCH_ROUNDS );
+	for ( mode = 0 ; mode < 3 ; mode++ ) {
+		Com_Printf( "%12s: %5i msec, %.3f usec/trace (%.2fx)\n", modeNames[mode], msec[mode],
+			numTraces ? msec[mode] * 1000.0f / ( numTraces * (float)TRACEBENCH_ROUNDS ) : 0.0f,
+			msec[mode] ? msec[0] / (float)msec[mode] : 0.0f );
+	}
+	Com_Printf( "memo: %i of %i lookups hit (%.1f%%)\n", hits, lookups, lookups ? hits * 100.0f / lookups : 0.0f );
+	if ( sides4Rounded ) {
+		Com_Printf( "sides4: %i traces differ from scalar by rounding only\n", sides4Rounded );
+	}
+	if ( sides4Mismatches ) {
+		Com_Printf( S_COLOR_RED "FAILED: %i sides4 traces came out differently\n", sides4Mismatches );
+	}
+	if ( memoMismatches ) {
+		Com_Printf( S_COLOR_RED "FAILED: %i memo traces came out differently\n", memoMismatches );
+	}
+
+	Hunk_FreeTempMemory( results );
+	Hunk_FreeTempMemory( sides4 );
+	Hunk_FreeTempMemory( reference );
+	if ( buffer ) {
+		FS_FreeFile( buffer );
+	} else {
+		Hunk_FreeTempMemory( queries );
+	}
+}
+#endif
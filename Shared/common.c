@@ -63,6 +63,7 @@ cvar_t	*com_fixedtime;
 cvar_t	*com_journal;
 cvar_t	*com_maxfps;
 cvar_t	*com_altivec;
+qboolean	com_haveSSE2;		// set by Com_DetectSSE for the SIMD code paths
 cvar_t	*com_timedemo;
 cvar_t	*com_sv_running;
 cvar_t	*com_cl_running;
@@ -299,6 +300,7 @@ void QDECL Com_Error( int code, const char *fmt, ... ) {
 		CL_Disconnect( qtrue );
 		CL_FlushMemory( );
 		VM_Forced_Unload_Done();
+		FS_ReleaseViews();
 		// make sure we can get at our local stuff
 		FS_PureServerSetLoadedPaks("", "");
 		com_errorEntered = qfalse;
@@ -310,6 +312,7 @@ void QDECL Com_Error( int code, const char *fmt, ... ) {
 		CL_Disconnect( qtrue );
 		CL_FlushMemory( );
 		VM_Forced_Unload_Done();
+		FS_ReleaseViews();
 		FS_PureServerSetLoadedPaks("", "");
 		com_errorEntered = qfalse;
 		longjmp (abortframe, -1);
@@ -776,6 +779,9 @@ memzone_t	*mainzone;
 // fragment the main zone (think of cvar and cmd strings)
 memzone_t	*smallzone;
 
+// both zones share one lock so job threads can allocate
+static volatile int	zoneLock;
+
 void Z_CheckHeap( void );
 
 /*
@@ -821,13 +827,56 @@ int Z_AvailableMemory( void ) {
 	return Z_AvailableZoneMemory( mainzone );
 }
 
+/*
+========================
+Z_FreeBlock
+
+The zone lock must be held
+========================
+*/
+static void Z_FreeBlock( memzone_t *zone, memblock_t *block ) {
+	memblock_t	*other;
+
+	zone->used -= block->size;
+	// set the block to something that should cause problems
+	// if it is referenced...
+	Com_Memset( block + 1, 0xaa, block->size - sizeof( *block ) );
+
+	block->tag = 0;		// mark as free
+	
+	other = block->prev;
+	if (!other->tag) {
+		// merge with previous free block
+		other->size += block->size;
+		other->next = block->next;
+		other->next->prev = other;
+		if (block == zone->rover) {
+			zone->rover = other;
+		}
+		block = other;
+	}
+
+	zone->rover = block;
+
+	other = block->next;
+	if ( !other->tag ) {
+		// merge the next free block onto the end
+		block->size += other->size;
+		block->next = other->next;
+		block->next->prev = block;
+		if (other == zone->rover) {
+			zone->rover = block;
+		}
+	}
+}
+
 /*
 ========================
 Z_Free
 ========================
 */
 void Z_Free( void *ptr ) {
-	memblock_t	*block, *other;
+	memblock_t	*block;
 	memzone_t *zone;
 	
 	if (!ptr) {
@@ -858,37 +907,9 @@ void Z_Free( void *ptr ) {
 		zone = mainzone;
 	}
 
-	zone->used -= block->size;
-	// set the block to something that should cause problems
-	// if it is referenced...
-	Com_Memset( ptr, 0xaa, block->size - sizeof( *block ) );
-
-	block->tag = 0;		// mark as free
-	
-	other = block->prev;
-	if (!other->tag) {
-		// merge with previous free block
-		other->size += block->size;
-		other->next = block->next;
-		other->next->prev = other;
-		if (block == zone->rover) {
-			zone->rover = other;
-		}
-		block = other;
-	}
-
-	zone->rover = block;
-
-	other = block->next;
-	if ( !other->tag ) {
-		// merge the next free block onto the end
-		block->size += other->size;
-		block->next = other->next;
-		block->next->prev = block;
-		if (other == zone->rover) {
-			zone->rover = block;
-		}
-	}
+	Job_Lock( &zoneLock );
+	Z_FreeBlock( zone, block );
+	Job_Unlock( &zoneLock );
 }
 
 
@@ -908,17 +929,19 @@ void Z_FreeTags( int tag ) {
 		zone = mainzone;
 	}
 	count = 0;
+	Job_Lock( &zoneLock );
 	// use the rover as our pointer, because
-	// Z_Free automatically adjusts it
+	// Z_FreeBlock automatically adjusts it
 	zone->rover = zone->blocklist.next;
 	do {
 		if ( zone->rover->tag == tag ) {
 			count++;
-			Z_Free( (void *)(zone->rover + 1) );
+			Z_FreeBlock( zone, zone->rover );
 			continue;
 		}
 		zone->rover = zone->rover->next;
 	} while ( zone->rover != &zone->blocklist );
+	Job_Unlock( &zoneLock );
 }
 
 
@@ -959,12 +982,15 @@ void *Z_TagMalloc( int size, int tag ) {
 	size += 4;					// space for memory trash tester
 	size = PAD(size, sizeof(intptr_t));		// align to 32/64 bit boundary
 	
+	Job_Lock( &zoneLock );
+
 	base = rover = zone->rover;
 	start = base->prev;
 	
 	do {
 		if (rover == start)	{
 			// scaned all the way around the list
+			Job_Unlock( &zoneLock );
 #ifdef ZONE_DEBUG
 			Z_LogHeap();
 
@@ -1017,6 +1043,8 @@ void *Z_TagMalloc( int size, int tag ) {
 	// marker for memory trash testing
 	*(int *)((byte *)base + base->size - 4) = ZONEID;
 
+	Job_Unlock( &zoneLock );
+
 	return (void *) ((byte *)base + sizeof(memblock_t));
 }
 
@@ -2441,7 +2469,8 @@ static void Com_DetectAltivec(void)
 /*
 =================
 Com_DetectSSE
-Find out whether we have SSE support for Q_ftol function
+Find out whether we have SSE support for Q_ftol function,
+and SSE2 for the code paths that check com_haveSSE2
 =================
 */
 
@@ -2457,11 +2486,16 @@ static void Com_DetectSSE(void)
 	if(feat & CF_SSE)
 	{
 		if(feat & CF_SSE2)
+		{
 			Q_SnapVector = qsnapvectorsse;
+			com_haveSSE2 = qtrue;
+		}
 		else
 			Q_SnapVector = qsnapvectorx87;
 
 		Q_ftol = qftolsse;
+#else
+		com_haveSSE2 = qtrue;
 #endif
 		Q_VMftol = qvmftolsse;
 
@@ -2569,6 +2603,12 @@ void Com_Init( char *commandLine ) {
 	}
 	Cmd_AddCommand ("quit", Com_Quit_f);
 	Cmd_AddCommand ("changeVectors", MSG_ReportChangeVectors_f );
+	Cmd_AddCommand ("hufftest", MSG_HuffTest_f );
+	Cmd_AddCommand ("huffbench", MSG_HuffBench_f );
+	Cmd_AddCommand ("deltatest", MSG_DeltaTest_f );
+	Cmd_AddCommand ("deltabench", MSG_DeltaBench_f );
+	Cmd_AddCommand ("tracerecord", CM_TraceRecord_f );
+	Cmd_AddCommand ("tracebench", CM_TraceBench_f );
 	Cmd_AddCommand ("writeconfig", Com_WriteConfig_f );
 	Cmd_SetCommandCompletionFunc( "writeconfig", Cmd_CompleteCfgName );
 	Cmd_AddCommand("game_restart", Com_GameRestart_f);
@@ -2644,6 +2684,8 @@ void Com_Init( char *commandLine ) {
 
 	Sys_Init();
 
+	Job_Init();
+
 	if( Sys_WritePIDFile( ) ) {
 #ifndef DEDICATED
 		const char *message = "The last time " CLIENT_WINDOW_TITLE " ran, "
@@ -2997,6 +3039,9 @@ void Com_Frame( void ) {
 	// mess with msec if needed
 	msec = Com_ModifyMsec(msec);
 
+	// remembered traces only live for one frame
+	CM_ClearTraceMemo();
+
 	//
 	// server side
 	//
@@ -3102,6 +3147,8 @@ Com_Shutdown
 =================
 */
 void Com_Shutdown (void) {
+	Job_Shutdown();
+
 	if (logfile) {
 		FS_FCloseFile (logfile);
 		logfile = 0;
@@ -186,6 +186,7 @@ or configs will never get loaded from disk!
 #define MAX_ZPATH			256
 #define	MAX_SEARCH_PATHS	4096
 #define MAX_FILEHASH_SIZE	1024
+#define FS_INDEX_HASH_SIZE	16384
 
 typedef struct fileInPack_s {
 	char					*name;		// name of the file
@@ -194,6 +195,14 @@ typedef struct fileInPack_s {
 	struct	fileInPack_s*	next;		// next file in the hash
 } fileInPack_t;
 
+// an entry in the merged file index
+typedef struct fsIndexFile_s {
+	struct searchpath_s		*search;	// the pack holding the file
+	fileInPack_t			*pakFile;
+	struct fsIndexFile_s	*nextPack;	// same name further down the search path
+	struct fsIndexFile_s	*next;		// next name in the hash
+} fsIndexFile_t;
+
 typedef struct {
     char			pakPathname[MAX_OSPATH];	// c:\quake3\baseq3
 	char			pakFilename[MAX_OSPATH];	// c:\quake3\baseq3\pak0.pk3
@@ -207,6 +216,7 @@ typedef struct {
 	int				hashSize;					// hash table size (power of 2)
 	fileInPack_t*	*hashTable;					// hash table
 	fileInPack_t*	buildBuffer;				// buffer with the filenames etc.
+	fsIndexFile_t	*indexFiles;				// this pack's entries in the merged index
 } pack_t;
 
 typedef struct {
@@ -220,6 +230,9 @@ typedef struct searchpath_s {
 
 	pack_t		*pack;		// only one of pack / dir will be non NULL
 	directory_t	*dir;
+
+	int			order;		// position in the search path, lower is searched first
+	struct searchpath_s *nextDir;	// next directory in search order
 } searchpath_t;
 
 static	char		fs_gamedir[MAX_OSPATH];	// this will be a single file name with no separators
@@ -235,6 +248,7 @@ static	cvar_t		*fs_basepath;
 static	cvar_t		*fs_basegame;
 static	cvar_t		*fs_gamedirvar;
 static	searchpath_t	*fs_searchpaths;
+static	searchpath_t	*fs_dirSearchPaths;		// just the directories, in search order
 static	int			fs_readCount;			// total bytes read
 static	int			fs_loadCount;			// total files read
 static	int			fs_loadStack;			// total files in memory
@@ -259,12 +273,29 @@ typedef struct {
 	int			fileSize;
 	int			zipFilePos;
 	qboolean	zipFile;
+	pack_t		*pack;			// the pack a zipFile is read from
+	directory_t	*dir;			// the directory any other file is read from
 	qboolean	streamed;
 	char		name[MAX_ZPATH];
 } fileHandleData_t;
 
 static fileHandleData_t	fsh[MAX_FILE_HANDLES];
 
+// mapped views of files stored in pk3s, see FS_ReadFileView
+#define	MAX_FILE_VIEWS		64
+#define	FS_VIEW_MIN_SIZE	0x10000		// smaller files aren't worth a mapping
+
+typedef struct {
+	void	*buffer;		// what the caller was given
+	void	*base;			// the mapping
+	long	length;
+} fileView_t;
+
+static fileView_t	fs_views[MAX_FILE_VIEWS];
+static int			fs_viewsMapped;
+static int			fs_viewsCopied;
+static int			fs_viewBytes;			// bytes mapped instead of allocated
+
 // TTimo - https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=540
 // wether we did a reorder on the current search path when joining the server
 static qboolean fs_reordered;
@@ -1051,26 +1082,194 @@ qboolean FS_IsDemoExt(const char *filename, int namelen)
 	return qfalse;
 }
 
+/*
+======================================================================================
+
+MERGED FILE INDEX
+
+Every file in the pk3s is entered in one hash keyed by its name, with the
+packs that hold it chained in search path order, so finding a file costs
+one hash lookup instead of one per pack.  Packs are entered as they are
+added to the head of the search path, and the index is rebuilt if the
+search path is reordered for a pure server.
+
+Loose directories aren't indexed, as their files can change while the
+game runs; only those searched ahead of the winning pack are probed.
+
+======================================================================================
+*/
+
+static fsIndexFile_t	*fs_indexTable[FS_INDEX_HASH_SIZE];
+static int				fs_indexNames;			// distinct names in the index
+static int				fs_indexMsec;			// time spent building the index
+static int				fs_indexLookups;
+static int				fs_indexHits;
+static int				fs_dirProbes;			// loose directories opened by lookups
+
+/*
+================
+FS_IndexPack
+
+Enters a pack that has just been put at the head of the search path.
+================
+*/
+static void FS_IndexPack( searchpath_t *search ) {
+	pack_t			*pak = search->pack;
+	fsIndexFile_t	*file, **link;
+	long			hash;
+	int				i;
+
+	if ( !pak->indexFiles ) {
+		pak->indexFiles = Z_Malloc( pak->numfiles * sizeof( *pak->indexFiles ) );
+	}
+
+	for ( i = 0, file = pak->indexFiles ; i < pak->numfiles ; i++, file++ ) {
+		file->search = search;
+		file->pakFile = &pak->buildBuffer[i];
+		file->nextPack = NULL;
+
+		hash = FS_HashFileName( file->pakFile->name, FS_INDEX_HASH_SIZE );
+		for ( link = &fs_indexTable[hash] ; *link ; link = &(*link)->next ) {
+			if ( !FS_FilenameCompare( (*link)->pakFile->name, file->pakFile->name ) ) {
+				break;
+			}
+		}
+
+		// this pack comes first, so it takes the name's place in the hash
+		if ( *link ) {
+			file->nextPack = *link;
+			file->next = (*link)->next;
+			(*link)->next = NULL;
+		} else {
+			file->next = NULL;
+			fs_indexNames++;
+		}
+		*link = file;
+	}
+}
+
+/*
+================
+FS_AddSearchPath
+
+Puts a pack or directory at the head of the search path.
+================
+*/
+static void FS_AddSearchPath( searchpath_t *search ) {
+	int		start;
+
+	search->order = fs_searchpaths ? fs_searchpaths->order - 1 : 0;
+	search->next = fs_searchpaths;
+	fs_searchpaths = search;
+
+	if ( search->dir ) {
+		search->nextDir = fs_dirSearchPaths;
+		fs_dirSearchPaths = search;
+	} else {
+		start = Sys_Milliseconds();
+		FS_IndexPack( search );
+		fs_indexMsec += Sys_Milliseconds() - start;
+	}
+}
+
+/*
+================
+FS_RebuildIndex
+
+Renumbers the search path and enters all of the packs again.
+================
+*/
+static void FS_RebuildIndex( void ) {
+	searchpath_t	*search, **order;
+	int				i, count, start;
+
+	start = Sys_Milliseconds();
+
+	count = 0;
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		search->order = count++;
+	}
+
+	Com_Memset( fs_indexTable, 0, sizeof( fs_indexTable ) );
+	fs_indexNames = 0;
+
+	if ( count ) {
+		// packs are entered from the back of the search path forward
+		order = Z_Malloc( count * sizeof( *order ) );
+		for ( i = 0, search = fs_searchpaths ; search ; search = search->next ) {
+			order[i++] = search;
+		}
+		for ( i = count - 1 ; i >= 0 ; i-- ) {
+			if ( order[i]->pack ) {
+				FS_IndexPack( order[i] );
+			}
+		}
+		Z_Free( order );
+	}
+
+	fs_indexMsec += Sys_Milliseconds() - start;
+}
+
+/*
+================
+FS_IndexLookup
+
+Returns the first pack holding the file, if any
+================
+*/
+static fsIndexFile_t *FS_IndexLookup( const char *filename ) {
+	fsIndexFile_t	*file;
+
+	fs_indexLookups++;
+
+	for ( file = fs_indexTable[FS_HashFileName( filename, FS_INDEX_HASH_SIZE )] ; file ; file = file->next ) {
+		if ( !FS_FilenameCompare( file->pakFile->name, filename ) ) {
+			fs_indexHits++;
+			return file;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+================
+FS_Stats_f
+================
+*/
+void FS_Stats_f( void ) {
+	searchpath_t	*search;
+	int				packs, dirs;
+
+	packs = dirs = 0;
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack ) {
+			packs++;
+		} else {
+			dirs++;
+		}
+	}
+
+	Com_Printf( "%i packs, %i directories in the search path\n", packs, dirs );
+	Com_Printf( "%i files in packs, %i distinct names, index built in %i msec\n",
+		fs_packFiles, fs_indexNames, fs_indexMsec );
+	Com_Printf( "%i lookups, %i found in packs, %i directory probes\n",
+		fs_indexLookups, fs_indexHits, fs_dirProbes );
+	Com_Printf( "%i file views mapped (%i KB kept off the hunk), %i copied\n",
+		fs_viewsMapped, fs_viewBytes / 1024, fs_viewsCopied );
+}
+
 /*
 ===========
-FS_FOpenFileReadDir
+FS_ReadableQpath
 
-Tries opening file "filename" in searchpath "search"
-Returns filesize and an open FILE pointer.
+Returns the filename without a leading slash, or NULL if it must not be read
 ===========
 */
 extern qboolean		com_fullyInitialized;
 
-long FS_FOpenFileReadDir(const char *filename, searchpath_t *search, fileHandle_t *file, qboolean uniqueFILE, qboolean unpure)
+static const char *FS_ReadableQpath(const char *filename)
 {
-	long			hash;
-	pack_t		*pak;
-	fileInPack_t	*pakFile;
-	directory_t	*dir;
-	char		*netpath;
-	FILE		*filep;
-	int			len;
-
 	if(filename == NULL)
 		Com_Error(ERR_FATAL, "FS_FOpenFileRead: NULL 'filename' parameter passed");
 
@@ -1082,221 +1281,236 @@ long FS_FOpenFileReadDir(const char *filename, searchpath_t *search, fileHandle_
 	// The searchpaths do guarantee that something will always
 	// be prepended, so we don't need to worry about "c:" or "//limbo" 
 	if(strstr(filename, ".." ) || strstr(filename, "::"))
-	{
-	        if(file == NULL)
-	                return qfalse;
-	                
-		*file = 0;
-		return -1;
-	}
-        
+		return NULL;
+
 	// make sure the q3key file is only readable by the quake3.exe at initialization
 	// any other time the key should only be accessed in memory using the provided functions
 	if(com_fullyInitialized && strstr(filename, "q3key"))
+		return NULL;
+
+	return filename;
+}
+
+/*
+===========
+FS_FOpenFileInPack
+
+Opens pakFile from the pack in search, or just returns its length
+if file is NULL
+===========
+*/
+static long FS_FOpenFileInPack(const char *filename, searchpath_t *search, fileInPack_t *pakFile, fileHandle_t *file, qboolean uniqueFILE, qboolean unpure)
+{
+	pack_t		*pak = search->pack;
+	int			len;
+
+	if(file == NULL)
 	{
-	        if(file == NULL)
-	                return qfalse;
+		// just wants to see if file is there
+		if(pakFile->len)
+			return pakFile->len;
 
+		// It's not nice, but legacy code depends
+		// on positive value if file exists no matter
+		// what size
+		return 1;
+	}
+
+	// disregard if it doesn't match one of the allowed pure pak files
+	if(!unpure && !FS_PakIsPure(pak))
+	{
 		*file = 0;
 		return -1;
 	}
 
+	*file = FS_HandleForFile();
+	fsh[*file].handleFiles.unique = uniqueFILE;
+
+	// mark the pak as having been referenced and mark specifics on cgame and ui
+	// shaders, txt, arena files  by themselves do not count as a reference as 
+	// these are loaded from all pk3s 
+	// from every pk3 file.. 
+	len = strlen(filename);
+
+	if (!(pak->referenced & FS_GENERAL_REF))
+	{
+		if(!FS_IsExt(filename, ".shader", len) &&
+		   !FS_IsExt(filename, ".txt", len) &&
+		   !FS_IsExt(filename, ".cfg", len) &&
+		   !FS_IsExt(filename, ".config", len) &&
+		   !FS_IsExt(filename, ".arena", len) &&
+		   !FS_IsExt(filename, ".menu", len) &&
+		   !strstr(filename, "levelshots"))
+		{
+			pak->referenced |= FS_GENERAL_REF;
+		}
+	}
+
+	if(strstr(filename, "game.qvm"))
+		pak->referenced |= FS_GAME_REF;
+	if(strstr(filename, "cgame.qvm"))
+		pak->referenced |= FS_CGAME_REF;
+	if(strstr(filename, "ui.qvm"))
+		pak->referenced |= FS_UI_REF;
+
+	if(uniqueFILE)
+	{
+		// open a new file on the pakfile
+		fsh[*file].handleFiles.file.z = unzOpen(pak->pakFilename);
+	
+		if(fsh[*file].handleFiles.file.z == NULL)
+			Com_Error(ERR_FATAL, "Couldn't open %s", pak->pakFilename);
+	}
+	else
+		fsh[*file].handleFiles.file.z = pak->handle;
+
+	Q_strncpyz(fsh[*file].name, filename, sizeof(fsh[*file].name));
+	fsh[*file].zipFile = qtrue;
+	fsh[*file].pack = pak;
+
+	// set the file position in the zip file (also sets the current file info)
+	unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
+
+	// open the file in the zip
+	unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
+	fsh[*file].zipFilePos = pakFile->pos;
+
+	if(fs_debug->integer)
+	{
+		Com_Printf("FS_FOpenFileRead: %s (found in '%s')\n", 
+			filename, pak->pakFilename);
+	}
+
+	return pakFile->len;
+}
+
+/*
+===========
+FS_FOpenFileInDir
+
+Opens the file from the directory in search, or just returns its length
+if file is NULL
+===========
+*/
+static long FS_FOpenFileInDir(const char *filename, searchpath_t *search, fileHandle_t *file, qboolean uniqueFILE, qboolean unpure)
+{
+	directory_t	*dir = search->dir;
+	char		*netpath;
+	FILE		*filep;
+	int			len;
+
+	fs_dirProbes++;
+
 	if(file == NULL)
 	{
 		// just wants to see if file is there
+		netpath = FS_BuildOSPath(dir->path, dir->gamedir, filename);
+		filep = fopen (netpath, "rb");
 
-		// is the element a pak file?
-		if(search->pack)
+		if(filep)
 		{
-			hash = FS_HashFileName(filename, search->pack->hashSize);
-                        
-                        if(search->pack->hashTable[hash])
-                        {
-				// look through all the pak file elements
-				pak = search->pack;
-				pakFile = pak->hashTable[hash];
-
-				do
-				{
-					// case and separator insensitive comparisons
-					if(!FS_FilenameCompare(pakFile->name, filename))
-					{
-						// found it!
-						if(pakFile->len)
-        						return pakFile->len;
-                                                else
-                                                {
-                                                        // It's not nice, but legacy code depends
-                                                        // on positive value if file exists no matter
-                                                        // what size
-                                                        return 1;
-                                                }
-					}
+			len = FS_fplength(filep);
+			fclose(filep);
 
-					pakFile = pakFile->next;
-				} while(pakFile != NULL);
-			}
+			if(len)
+				return len;
+			else
+				return 1;
 		}
-		else if(search->dir)
-		{
-			dir = search->dir;
-		
-			netpath = FS_BuildOSPath(dir->path, dir->gamedir, filename);
-			filep = fopen (netpath, "rb");
 
-			if(filep)
-			{
-			        len = FS_fplength(filep);
-				fclose(filep);
-				
-				if(len)
-        				return len;
-                                else
-                                        return 1;
-			}
-		}
-		
 		return 0;
 	}
 
+	// if we are running restricted, the only files we
+	// will allow to come from the directory are .cfg files
+	len = strlen(filename);
+	// FIXME TTimo I'm not sure about the fs_numServerPaks test
+	// if you are using FS_ReadFile to find out if a file exists,
+	//   this test can make the search fail although the file is in the directory
+	// I had the problem on https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=8
+	// turned out I used FS_FileExists instead
+	if(!unpure && fs_numServerPaks)
+	{
+		if(!FS_IsExt(filename, ".cfg", len) &&		// for config files
+		   !FS_IsExt(filename, ".menu", len) &&		// menu files
+		   !FS_IsExt(filename, ".game", len) &&		// menu files
+		   !FS_IsExt(filename, ".dat", len) &&		// for journal files
+		   !FS_IsDemoExt(filename, len))			// demos
+		{
+			*file = 0;
+			return -1;
+		}
+	}
+
+	netpath = FS_BuildOSPath(dir->path, dir->gamedir, filename);
+	filep = fopen(netpath, "rb");
+
+	if (filep == NULL)
+	{
+		*file = 0;
+		return -1;
+	}
+
 	*file = FS_HandleForFile();
 	fsh[*file].handleFiles.unique = uniqueFILE;
+
+	Q_strncpyz(fsh[*file].name, filename, sizeof(fsh[*file].name));
+	fsh[*file].zipFile = qfalse;
+	fsh[*file].dir = dir;
 	
-	// is the element a pak file?
-	if(search->pack)
+	if(fs_debug->integer)
 	{
-		hash = FS_HashFileName(filename, search->pack->hashSize);
+		Com_Printf("FS_FOpenFileRead: %s (found in '%s/%s')\n", filename,
+			dir->path, dir->gamedir);
+	}
 
-		if(search->pack->hashTable[hash])
-		{
-			// disregard if it doesn't match one of the allowed pure pak files
-			if(!unpure && !FS_PakIsPure(search->pack))
-			{
-				*file = 0;
-				return -1;
-			}
+	fsh[*file].handleFiles.file.o = filep;
+	return FS_fplength(filep);
+}
 
-			// look through all the pak file elements
-			pak = search->pack;
-			pakFile = pak->hashTable[hash];
-		
-			do
-			{
-				// case and separator insensitive comparisons
-				if(!FS_FilenameCompare(pakFile->name, filename))
-				{
-					// found it!
-
-					// mark the pak as having been referenced and mark specifics on cgame and ui
-					// shaders, txt, arena files  by themselves do not count as a reference as 
-					// these are loaded from all pk3s 
-					// from every pk3 file.. 
-					len = strlen(filename);
-
-					if (!(pak->referenced & FS_GENERAL_REF))
-					{
-						if(!FS_IsExt(filename, ".shader", len) &&
-						   !FS_IsExt(filename, ".txt", len) &&
-						   !FS_IsExt(filename, ".cfg", len) &&
-						   !FS_IsExt(filename, ".config", len) &&
-						   !FS_IsExt(filename, ".arena", len) &&
-						   !FS_IsExt(filename, ".menu", len) &&
-						   !strstr(filename, "levelshots"))
-						{
-							pak->referenced |= FS_GENERAL_REF;
-						}
-					}
+/*
+===========
+FS_FOpenFileReadDir
 
-					if(strstr(filename, "game.qvm"))
-						pak->referenced |= FS_GAME_REF;
-					if(strstr(filename, "cgame.qvm"))
-						pak->referenced |= FS_CGAME_REF;
-					if(strstr(filename, "ui.qvm"))
-						pak->referenced |= FS_UI_REF;
-
-					if(uniqueFILE)
-					{
-						// open a new file on the pakfile
-						fsh[*file].handleFiles.file.z = unzOpen(pak->pakFilename);
-					
-						if(fsh[*file].handleFiles.file.z == NULL)
-							Com_Error(ERR_FATAL, "Couldn't open %s", pak->pakFilename);
-					}
-					else
-						fsh[*file].handleFiles.file.z = pak->handle;
-
-					Q_strncpyz(fsh[*file].name, filename, sizeof(fsh[*file].name));
-					fsh[*file].zipFile = qtrue;
-				
-					// set the file position in the zip file (also sets the current file info)
-					unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
-
-					// open the file in the zip
-					unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
-					fsh[*file].zipFilePos = pakFile->pos;
-
-					if(fs_debug->integer)
-					{
-						Com_Printf("FS_FOpenFileRead: %s (found in '%s')\n", 
-							filename, pak->pakFilename);
-					}
-				
-					return pakFile->len;
-				}
-			
-				pakFile = pakFile->next;
-			} while(pakFile != NULL);
-		}
-	}
-	else if(search->dir)
-	{
-		// check a file in the directory tree
-
-		// if we are running restricted, the only files we
-		// will allow to come from the directory are .cfg files
-		len = strlen(filename);
-		// FIXME TTimo I'm not sure about the fs_numServerPaks test
-		// if you are using FS_ReadFile to find out if a file exists,
-		//   this test can make the search fail although the file is in the directory
-		// I had the problem on https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=8
-		// turned out I used FS_FileExists instead
-		if(!unpure && fs_numServerPaks)
-		{
-			if(!FS_IsExt(filename, ".cfg", len) &&		// for config files
-			   !FS_IsExt(filename, ".menu", len) &&		// menu files
-			   !FS_IsExt(filename, ".game", len) &&		// menu files
-			   !FS_IsExt(filename, ".dat", len) &&		// for journal files
-			   !FS_IsDemoExt(filename, len))			// demos
-			{
-				*file = 0;
-				return -1;
-			}
-		}
+Tries opening file "filename" in searchpath "search"
+Returns filesize and an open FILE pointer.
+===========
+*/
+long FS_FOpenFileReadDir(const char *filename, searchpath_t *search, fileHandle_t *file, qboolean uniqueFILE, qboolean unpure)
+{
+	long			hash;
+	fileInPack_t	*pakFile;
 
-		dir = search->dir;
+	filename = FS_ReadableQpath(filename);
+	if(!filename)
+	{
+		if(file == NULL)
+			return qfalse;
 
-		netpath = FS_BuildOSPath(dir->path, dir->gamedir, filename);
-		filep = fopen(netpath, "rb");
+		*file = 0;
+		return -1;
+	}
 
-		if (filep == NULL)
-		{
-			*file = 0;
-                        return -1;
-		}
+	// is the element a pak file?
+	if(search->pack)
+	{
+		hash = FS_HashFileName(filename, search->pack->hashSize);
 
-		Q_strncpyz(fsh[*file].name, filename, sizeof(fsh[*file].name));
-		fsh[*file].zipFile = qfalse;
-		
-		if(fs_debug->integer)
+		// look through all the pak file elements
+		for(pakFile = search->pack->hashTable[hash]; pakFile; pakFile = pakFile->next)
 		{
-			Com_Printf("FS_FOpenFileRead: %s (found in '%s/%s')\n", filename,
-				dir->path, dir->gamedir);
+			// case and separator insensitive comparisons
+			if(!FS_FilenameCompare(pakFile->name, filename))
+				return FS_FOpenFileInPack(filename, search, pakFile, file, uniqueFILE, unpure);
 		}
-
-		fsh[*file].handleFiles.file.o = filep;
-		return FS_fplength(filep);
 	}
+	else if(search->dir)
+		return FS_FOpenFileInDir(filename, search, file, uniqueFILE, unpure);
 
+	if(file == NULL)
+		return 0;
+
+	*file = 0;
 	return -1;
 }
 
@@ -1312,16 +1526,43 @@ separate file or a ZIP file.
 */
 long FS_FOpenFileRead(const char *filename, fileHandle_t *file, qboolean uniqueFILE)
 {
-	searchpath_t *search;
+	fsIndexFile_t	*indexFile;
+	searchpath_t	*dir, *search;
 	long len;
 
 	if(!fs_searchpaths)
 		Com_Error(ERR_FATAL, "Filesystem call made without initialization");
 
-	for(search = fs_searchpaths; search; search = search->next)
+	filename = FS_ReadableQpath(filename);
+	if(!filename)
 	{
-	        len = FS_FOpenFileReadDir(filename, search, file, uniqueFILE, qfalse);
-	        
+		if(file == NULL)
+			return qfalse;
+
+		*file = 0;
+		return -1;
+	}
+
+	// walk the packs holding the file and the loose directories together,
+	// in search path order
+	indexFile = FS_IndexLookup(filename);
+	dir = fs_dirSearchPaths;
+
+	while(indexFile || dir)
+	{
+		if(indexFile && (!dir || indexFile->search->order < dir->order))
+		{
+			search = indexFile->search;
+			len = FS_FOpenFileInPack(filename, search, indexFile->pakFile, file, uniqueFILE, qfalse);
+			indexFile = indexFile->nextPack;
+		}
+		else
+		{
+			search = dir;
+			len = FS_FOpenFileInDir(filename, search, file, uniqueFILE, qfalse);
+			dir = dir->nextDir;
+		}
+
 	        if(file == NULL)
 	        {
 	                if(len > 0)
@@ -1663,10 +1904,7 @@ CONVENIENCE FUNCTIONS FOR ENTIRE FILES
 */
 
 int	FS_FileIsInPAK(const char *filename, int *pChecksum ) {
-	searchpath_t	*search;
-	pack_t			*pak;
-	fileInPack_t	*pakFile;
-	long			hash = 0;
+	fsIndexFile_t	*indexFile;
 
 	if ( !fs_searchpaths ) {
 		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
@@ -1688,40 +1926,53 @@ int	FS_FileIsInPAK(const char *filename, int *pChecksum ) {
 		return -1;
 	}
 
-	//
-	// search through the path, one element at a time
-	//
-
-	for ( search = fs_searchpaths ; search ; search = search->next ) {
-		//
-		if (search->pack) {
-			hash = FS_HashFileName(filename, search->pack->hashSize);
+	// the packs holding the file, in search path order
+	for ( indexFile = FS_IndexLookup( filename ) ; indexFile ; indexFile = indexFile->nextPack ) {
+		// disregard if it doesn't match one of the allowed pure pak files
+		if ( !FS_PakIsPure( indexFile->search->pack ) ) {
+			continue;
 		}
-		// is the element a pak file?
-		if ( search->pack && search->pack->hashTable[hash] ) {
-			// disregard if it doesn't match one of the allowed pure pak files
-			if ( !FS_PakIsPure(search->pack) ) {
-				continue;
-			}
 
-			// look through all the pak file elements
-			pak = search->pack;
-			pakFile = pak->hashTable[hash];
-			do {
-				// case and separator insensitive comparisons
-				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-					if (pChecksum) {
-						*pChecksum = pak->pure_checksum;
-					}
-					return 1;
-				}
-				pakFile = pakFile->next;
-			} while(pakFile != NULL);
+		if ( pChecksum ) {
+			*pChecksum = indexFile->search->pack->pure_checksum;
 		}
+		return 1;
 	}
 	return -1;
 }
 
+/*
+============
+FS_PakFileCRC
+
+Returns 1 and the crc the pk3 stores for the file if that is where
+it would be read from, 0 if it would be read from a directory and
+-1 if it can't be read at all
+============
+*/
+int FS_PakFileCRC( const char *qpath, int *crc ) {
+	fileHandle_t	h;
+	unz_file_info	info;
+	int				found;
+
+	*crc = 0;
+
+	FS_FOpenFileRead( qpath, &h, qfalse );
+	if ( !h ) {
+		return -1;
+	}
+
+	found = 0;
+	if ( fsh[h].zipFile &&
+		unzGetCurrentFileInfo( fsh[h].handleFiles.file.z, &info, NULL, 0, NULL, 0, NULL, 0 ) == UNZ_OK ) {
+		*crc = info.crc;
+		found = 1;
+	}
+
+	FS_FCloseFile( h );
+	return found;
+}
+
 /*
 ============
 FS_ReadFileDir
@@ -1888,6 +2139,142 @@ void FS_FreeFile( void *buffer ) {
 	}
 }
 
+/*
+======================================================================================
+
+FILE VIEWS
+
+Large files stored uncompressed in a pk3 are mapped straight from the
+archive instead of being copied to the hunk, which keeps the biggest
+loads (bsps, textures) off the temp hunk.  Large loose files are mapped
+whole.  Everything else is read from the handle straight into the hunk
+buffer.
+
+======================================================================================
+*/
+
+/*
+============
+FS_ReadFileView
+============
+*/
+long FS_ReadFileView( const char *qpath, void **buffer ) {
+	fileHandle_t	h;
+	fileView_t		*view;
+	unz_file_info	info;
+	unzFile			z;
+	byte			*buf;
+	long			len;
+	int				i;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		Com_Error( ERR_FATAL, "FS_ReadFileView with empty name" );
+	}
+
+	// configs may come from the journal
+	if ( !buffer || strstr( qpath, ".cfg" ) ) {
+		return FS_ReadFile( qpath, buffer );
+	}
+
+	view = NULL;
+	for ( i = 0 ; i < MAX_FILE_VIEWS ; i++ ) {
+		if ( !fs_views[i].buffer ) {
+			view = &fs_views[i];
+			break;
+		}
+	}
+
+	len = FS_FOpenFileRead( qpath, &h, qfalse );
+	if ( !h ) {
+		*buffer = NULL;
+		return -1;
+	}
+
+	if ( view && len >= FS_VIEW_MIN_SIZE ) {
+		if ( fsh[h].zipFile ) {
+			z = fsh[h].handleFiles.file.z;
+
+			if ( unzGetCurrentFileInfo( z, &info, NULL, 0, NULL, 0, NULL, 0 ) == UNZ_OK &&
+				info.compression_method == 0 && !( info.flag & 1 ) ) {
+				view->buffer = Sys_MapFile( fsh[h].pack->pakFilename, unzGetCurrentFileZStreamPos( z ), len,
+					&view->base, &view->length );
+			}
+		} else if ( fsh[h].dir ) {
+			view->buffer = Sys_MapFile( FS_BuildOSPath( fsh[h].dir->path, fsh[h].dir->gamedir, fsh[h].name ), 0, len,
+				&view->base, &view->length );
+		}
+
+		if ( view->buffer ) {
+			FS_FCloseFile( h );
+
+			fs_viewsMapped++;
+			fs_viewBytes += len;
+			fs_loadCount++;
+
+			*buffer = view->buffer;
+			return len;
+		}
+	}
+
+	fs_viewsCopied++;
+	fs_loadCount++;
+	fs_loadStack++;
+
+	buf = Hunk_AllocateTempMemory( len + 1 );
+	*buffer = buf;
+
+	FS_Read( buf, len, h );
+
+	// guarantee that it will have a trailing 0 for string operations
+	buf[len] = 0;
+	FS_FCloseFile( h );
+
+	return len;
+}
+
+/*
+=============
+FS_ReleaseView
+=============
+*/
+void FS_ReleaseView( void *buffer ) {
+	int		i;
+
+	if ( buffer ) {
+		for ( i = 0 ; i < MAX_FILE_VIEWS ; i++ ) {
+			if ( fs_views[i].buffer == buffer ) {
+				Sys_UnmapFile( fs_views[i].base, fs_views[i].length );
+				Com_Memset( &fs_views[i], 0, sizeof( fs_views[i] ) );
+				return;
+			}
+		}
+	}
+
+	FS_FreeFile( buffer );
+}
+
+/*
+=============
+FS_ReleaseViews
+
+Unmaps every outstanding view, for loads abandoned by an error drop
+=============
+*/
+void FS_ReleaseViews( void ) {
+	int		i;
+
+	for ( i = 0 ; i < MAX_FILE_VIEWS ; i++ ) {
+		if ( fs_views[i].buffer ) {
+			Sys_UnmapFile( fs_views[i].base, fs_views[i].length );
+			Com_Memset( &fs_views[i], 0, sizeof( fs_views[i] ) );
+		}
+	}
+}
+
 /*
 ============
 FS_WriteFile
@@ -2047,6 +2434,8 @@ static void FS_FreePak(pack_t *thepak)
 {
 	unzClose(thepak->handle);
 	Z_Free(thepak->buildBuffer);
+	if (thepak->indexFiles)
+		Z_Free(thepak->indexFiles);
 	Z_Free(thepak);
 }
 
@@ -2278,6 +2667,63 @@ char **FS_ListFiles( const char *path, const char *extension, int *numfiles ) {
 	return FS_ListFilteredFiles( path, extension, NULL, numfiles, qfalse );
 }
 
+/*
+=================
+FS_ListPakFiles
+
+Returns every file in the loaded pk3 with the given base name
+that ends in extension, at any depth
+=================
+*/
+char **FS_ListPakFiles( const char *pakName, const char *extension, int *numfiles ) {
+	searchpath_t	*search;
+	pack_t			*pak;
+	char			**list;
+	char			*name;
+	int				extensionLength, length;
+	int				i, nfiles;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	*numfiles = 0;
+	if ( !extension ) {
+		extension = "";
+	}
+	extensionLength = strlen( extension );
+
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack && !Q_stricmp( search->pack->pakBasename, pakName ) ) {
+			break;
+		}
+	}
+	if ( !search ) {
+		return NULL;
+	}
+
+	pak = search->pack;
+	list = Z_Malloc( ( pak->numfiles + 1 ) * sizeof( *list ) );
+	nfiles = 0;
+	for ( i = 0 ; i < pak->numfiles ; i++ ) {
+		name = pak->buildBuffer[i].name;
+		length = strlen( name );
+		if ( length < extensionLength || Q_stricmp( name + length - extensionLength, extension ) ) {
+			continue;
+		}
+		list[nfiles++] = CopyString( name );
+	}
+	list[nfiles] = NULL;
+
+	if ( !nfiles ) {
+		Z_Free( list );
+		return NULL;
+	}
+
+	*numfiles = nfiles;
+	return list;
+}
+
 /*
 =================
 FS_FreeFileList
@@ -2839,8 +3285,7 @@ void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 		search = Z_Malloc (sizeof(searchpath_t));
 		search->pack = pak;
-		search->next = fs_searchpaths;
-		fs_searchpaths = search;
+		FS_AddSearchPath( search );
 	}
 
 	// done
@@ -2856,8 +3301,7 @@ void FS_AddGameDirectory( const char *path, const char *dir ) {
 	Q_strncpyz(search->dir->fullpath, curpath, sizeof(search->dir->fullpath));
 	Q_strncpyz(search->dir->gamedir, dir, sizeof(search->dir->gamedir));
 
-	search->next = fs_searchpaths;
-	fs_searchpaths = search;
+	FS_AddSearchPath( search );
 }
 
 /*
@@ -3037,6 +3481,8 @@ void FS_Shutdown( qboolean closemfp ) {
 		}
 	}
 
+	FS_ReleaseViews();
+
 	// free everything
 	for(p = fs_searchpaths; p; p = next)
 	{
@@ -3052,12 +3498,16 @@ void FS_Shutdown( qboolean closemfp ) {
 
 	// any FS_ calls will now be an error until reinitialized
 	fs_searchpaths = NULL;
+	fs_dirSearchPaths = NULL;
+	Com_Memset( fs_indexTable, 0, sizeof( fs_indexTable ) );
+	fs_indexNames = 0;
 
 	Cmd_RemoveCommand( "path" );
 	Cmd_RemoveCommand( "dir" );
 	Cmd_RemoveCommand( "fdir" );
 	Cmd_RemoveCommand( "touchFile" );
 	Cmd_RemoveCommand( "which" );
+	Cmd_RemoveCommand( "fs_stats" );
 
 #ifdef FS_MISSING
 	if (closemfp) {
@@ -3104,6 +3554,11 @@ static void FS_ReorderPurePaks( void )
 			p_previous = &s->next;
 		}
 	}
+
+	// the index orders packs by their place in the search path
+	if ( fs_reordered ) {
+		FS_RebuildIndex();
+	}
 }
 
 /*
@@ -3120,6 +3575,13 @@ static void FS_Startup( const char *gameName, qboolean quiet )
 	}
 
 	fs_packFiles = 0;
+	fs_indexMsec = 0;
+	fs_indexLookups = 0;
+	fs_indexHits = 0;
+	fs_dirProbes = 0;
+	fs_viewsMapped = 0;
+	fs_viewsCopied = 0;
+	fs_viewBytes = 0;
 
 	fs_debug = Cvar_Get( "fs_debug", "0", 0 );
 	fs_basepath = Cvar_Get ("fs_basepath", Sys_DefaultInstallPath(), CVAR_INIT|CVAR_PROTECTED );
@@ -3176,6 +3638,7 @@ static void FS_Startup( const char *gameName, qboolean quiet )
 	Cmd_AddCommand ("fdir", FS_NewDir_f );
 	Cmd_AddCommand ("touchFile", FS_TouchFile_f );
 	Cmd_AddCommand ("which", FS_Which_f );
+	Cmd_AddCommand ("fs_stats", FS_Stats_f );
 
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=506
 	// reorder the pure pk3 files according to server order
@@ -3494,6 +3957,15 @@ void FS_PureServerSetLoadedPaks( const char *pakSums, const char *pakNames ) {
 	}
 }
 
+/*
+=====================
+FS_PureServerActive
+=====================
+*/
+qboolean FS_PureServerActive( void ) {
+	return fs_numServerPaks ? qtrue : qfalse;
+}
+
 /*
 =====================
 FS_PureServerSetReferencedPaks
@@ -29,14 +29,15 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 static int			bloc = 0;
 
+/* The offset writers below never touch bloc, so several messages
+ * can be written at once from the job threads */
 void	Huff_putBit( int bit, byte *fout, int *offset) {
-	bloc = *offset;
-	if ((bloc&7) == 0) {
-		fout[(bloc>>3)] = 0;
+	int b = *offset;
+	if ((b&7) == 0) {
+		fout[(b>>3)] = 0;
 	}
-	fout[(bloc>>3)] |= bit << (bloc&7);
-	bloc++;
-	*offset = bloc;
+	fout[(b>>3)] |= bit << (b&7);
+	*offset = b + 1;
 }
 
 int		Huff_getBloc(void)
@@ -325,10 +326,157 @@ void Huff_transmit (huff_t *huff, int ch, byte *fout) {
 	}
 }
 
+/* Send the prefix code for this node at *offset */
+static void offsetSend(node_t *node, node_t *child, byte *fout, int *offset) {
+	if (node->parent) {
+		offsetSend(node->parent, node, fout, offset);
+	}
+	if (child) {
+		Huff_putBit(node->right == child, fout, offset);
+	}
+}
+
 void Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset) {
-	bloc = *offset;
-	send(huff->loc[ch], NULL, fout);
-	*offset = bloc;
+	offsetSend(huff->loc[ch], NULL, fout, offset);
+}
+
+/* Write the low bits of value, first in the lowest bit, exactly as that
+ * many Huff_putBit calls would: a byte is cleared when its first bit is
+ * written, and bytes past the last bit are left alone */
+void Huff_putBits( unsigned value, int bits, byte *fout, int *offset ) {
+	int b = *offset;
+	int n;
+
+	while (bits > 0) {
+		n = 8 - (b&7);
+		if (n > bits) {
+			n = bits;
+		}
+		if ((b&7) == 0) {
+			fout[(b>>3)] = value & ((1<<n)-1);
+		} else {
+			fout[(b>>3)] |= (value & ((1<<n)-1)) << (b&7);
+		}
+		value >>= n;
+		b += n;
+		bits -= n;
+	}
+	*offset = b;
+}
+
+/* At least 17 bits from offset, first in the lowest bit.  Bytes past
+ * size read as zero, so a bad message can't walk off the buffer */
+static unsigned peekBits( const byte *fin, int size, int offset ) {
+	int			i = offset>>3;
+	unsigned	window;
+
+	if (i + 3 <= size) {
+		window = fin[i] | (fin[i+1] << 8) | (fin[i+2] << 16);
+	} else {
+		window = 0;
+		if (i < size) {
+			window = fin[i];
+		}
+		if (i + 1 < size) {
+			window |= fin[i+1] << 8;
+		}
+	}
+	return window >> (offset&7);
+}
+
+/* Read up to 16 raw bits, as that many Huff_getBit calls would */
+int Huff_getBits( const byte *fin, int size, int bits, int *offset ) {
+	int value;
+
+	value = peekBits(fin, size, *offset) & ((1<<bits)-1);
+	*offset += bits;
+	return value;
+}
+
+/* Flatten a tree that won't change any more into code and lookup
+ * tables.  The tables point back into huff, so it must outlive them */
+void Huff_BuildTable( huffTable_t *table, huff_t *huff ) {
+	node_t		*node;
+	unsigned	code;
+	int			i, j, length;
+
+	Com_Memset(table, 0, sizeof(*table));
+	table->huff = huff;
+
+	/* codes are sent from the root down, so walking up from the leaf
+	 * pushes the earlier bits in underneath */
+	for (i = 0; i < HMAX; i++) {
+		code = 0;
+		length = 0;
+		for (node = huff->loc[i]; node && node->parent && length < 32; node = node->parent) {
+			code = (code << 1) | (node->parent->right == node);
+			length++;
+		}
+		if (!node || node->parent || !length) {
+			continue;		/* left to Huff_offsetTransmit */
+		}
+		table->code[i] = code;
+		table->length[i] = length;
+	}
+
+	for (i = 0; i < HUFF_LOOKUP_SIZE; i++) {
+		node = huff->tree;
+		for (j = 0; j < HUFF_LOOKUP_BITS && node && node->symbol == INTERNAL_NODE; j++) {
+			node = ((i>>j) & 1) ? node->right : node->left;
+		}
+		if (!node) {
+			/* Huff_offsetReceive gives 0 and doesn't move on */
+			table->lookup[i].symbol = 0;
+			table->lookup[i].length = 0;
+		} else if (node->symbol == INTERNAL_NODE) {
+			table->lookup[i].symbol = INTERNAL_NODE;
+			table->lookup[i].length = HUFF_LOOKUP_BITS;
+			table->lookupNode[i] = node;
+		} else {
+			table->lookup[i].symbol = node->symbol;
+			table->lookup[i].length = j;
+		}
+	}
+}
+
+/* Same bits as Huff_offsetTransmit */
+void Huff_tableTransmit( const huffTable_t *table, int ch, byte *fout, int *offset ) {
+	if (table->length[ch]) {
+		Huff_putBits(table->code[ch], table->length[ch], fout, offset);
+	} else {
+		Huff_offsetTransmit(table->huff, ch, fout, offset);
+	}
+}
+
+/* Same symbol and offset as Huff_offsetReceive, without touching bloc */
+int Huff_tableReceive( const huffTable_t *table, const byte *fin, int size, int *offset ) {
+	const huffLookup_t	*entry;
+	node_t				*node;
+	int					b, index;
+
+	b = *offset;
+	index = peekBits(fin, size, b) & (HUFF_LOOKUP_SIZE-1);
+	entry = &table->lookup[index];
+	if (entry->symbol != INTERNAL_NODE) {
+		*offset = b + entry->length;
+		return entry->symbol;
+	}
+
+	node = table->lookupNode[index];
+	b += HUFF_LOOKUP_BITS;
+	while (node && node->symbol == INTERNAL_NODE) {
+		if (peekBits(fin, size, b) & 1) {
+			node = node->right;
+		} else {
+			node = node->left;
+		}
+		b++;
+	}
+	if (!node) {
+		return 0;
+	}
+	*offset = b;
+	return node->symbol;
 }
 
 void Huff_Decompress(msg_t *mbuf, int offset) {
@@ -383,8 +531,6 @@ void Huff_Decompress(msg_t *mbuf, int offset) {
 	Com_Memcpy(mbuf->data + offset, seq, cch);
 }
 
-extern 	int oldsize;
-
 void Huff_Compress(msg_t *mbuf, int offset) {
 	int			i, ch, size;
 	byte		seq[65536];
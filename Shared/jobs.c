@@ -0,0 +1,794 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// jobs.c -- work stealing job scheduler
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+/*
+Every job thread owns a deque of jobs.  The owner pushes and pops
+at the bottom without locking, and the other threads steal from the
+top when they run out of work of their own (Chase and Lev, "Dynamic
+Circular Work-Stealing Deque").  The main thread is job thread 0,
+the workers are 1 to jobNumThreads.  Any other thread, like the render
+thread, adds its jobs to a small spin locked queue instead.
+
+Waiting on a counter runs other jobs until it drops to zero, so jobs
+can wait on other jobs without tying up a thread.
+*/
+
+#define	JOB_DEQUE_SIZE		1024	// must be a power of two
+#define	JOB_DEQUE_MASK		( JOB_DEQUE_SIZE - 1 )
+#define	JOB_SPINS			2000	// empty looks before a worker goes to sleep
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define	JOB_THREADLOCAL				__declspec( thread )
+#define	Job_AtomicAdd( p, v )		( _InterlockedExchangeAdd( (volatile long *)(p), (v) ) + (v) )
+#define	Job_AtomicCAS( p, o, n )	( _InterlockedCompareExchange( (volatile long *)(p), (n), (o) ) == (long)(o) )
+#define	Job_Pause()					_mm_pause()
+#else
+#define	JOB_THREADLOCAL				__thread
+#define	Job_AtomicAdd( p, v )		__sync_add_and_fetch( (p), (v) )
+#define	Job_AtomicCAS( p, o, n )	__sync_bool_compare_and_swap( (p), (o), (n) )
+#if id386 || idx64
+#define	Job_Pause()					__builtin_ia32_pause()
+#else
+#define	Job_Pause()
+#endif
+#endif
+
+/*
+=============
+Job_MemoryBarrier
+=============
+*/
+void Job_MemoryBarrier( void ) {
+#ifdef _MSC_VER
+	volatile long	barrier = 0;
+
+	_InterlockedExchange( &barrier, 1 );
+#else
+	__sync_synchronize();
+#endif
+}
+
+typedef struct {
+	jobFunc_t		function;
+	void			*data;
+	int				first, last;
+	jobCounter_t	*counter;
+	jobCounter_t	*waitFor;
+} job_t;
+
+typedef struct {
+	volatile unsigned	top;			// thieves take from here
+	byte				pad[60];		// keep top and bottom on separate cache lines
+	volatile unsigned	bottom;			// the owner pushes and pops here
+	job_t				jobs[JOB_DEQUE_SIZE];
+} jobDeque_t;
+
+static cvar_t		*com_jobThreads;
+
+static int			jobNumThreads;		// workers that were started
+static int			jobNumDeques;		// workers asked for, plus the main thread
+static jobDeque_t	*jobDeques;
+static void			*jobThreads[MAX_JOB_THREADS];
+
+static void			*jobSemaphore;
+static volatile int	jobSleepers;
+static volatile int	jobQuit;
+
+static volatile int			jobForeignLock;
+static volatile unsigned	jobForeignHead, jobForeignTail;
+static job_t				jobForeign[JOB_DEQUE_SIZE];
+
+static JOB_THREADLOCAL int	jobThreadNum = -1;	// -1 if not a job thread
+
+/*
+=============
+Job_Lock
+=============
+*/
+void Job_Lock( volatile int *lock ) {
+	while ( !Job_AtomicCAS( lock, 0, 1 ) ) {
+		Job_Pause();
+	}
+}
+
+/*
+=============
+Job_Unlock
+=============
+*/
+void Job_Unlock( volatile int *lock ) {
+	Job_AtomicCAS( lock, 1, 0 );
+}
+
+/*
+==============================================================
+
+DEQUES
+
+==============================================================
+*/
+
+/*
+=============
+Job_Push
+
+Only called by the owner
+=============
+*/
+static qboolean Job_Push( jobDeque_t *d, const job_t *job ) {
+	unsigned	b = d->bottom;
+	unsigned	t = d->top;
+
+	if ( b - t >= JOB_DEQUE_SIZE ) {
+		return qfalse;
+	}
+
+	d->jobs[b & JOB_DEQUE_MASK] = *job;
+	Job_MemoryBarrier();
+	d->bottom = b + 1;
+	return qtrue;
+}
+
+/*
+=============
+Job_Pop
+
+Only called by the owner, takes the most recently pushed job
+=============
+*/
+static qboolean Job_Pop( jobDeque_t *d, job_t *job ) {
+	unsigned	b = d->bottom - 1;
+	unsigned	t;
+	qboolean	taken;
+
+	d->bottom = b;
+	Job_MemoryBarrier();
+	t = d->top;
+
+	if ( (int)( b - t ) < 0 ) {
+		// empty
+		d->bottom = t;
+		return qfalse;
+	}
+
+	*job = d->jobs[b & JOB_DEQUE_MASK];
+	if ( b != t ) {
+		return qtrue;
+	}
+
+	// last one, race the thieves for it
+	taken = Job_AtomicCAS( &d->top, t, t + 1 );
+	d->bottom = t + 1;
+	return taken;
+}
+
+/*
+=============
+Job_Steal
+
+Takes the oldest job, from any thread
+=============
+*/
+static qboolean Job_Steal( jobDeque_t *d, job_t *job ) {
+	unsigned	t = d->top;
+	unsigned	b;
+
+	Job_MemoryBarrier();
+	b = d->bottom;
+	if ( (int)( b - t ) <= 0 ) {
+		return qfalse;
+	}
+
+	// the owner can't write over this slot before top moves past it
+	*job = d->jobs[t & JOB_DEQUE_MASK];
+	return Job_AtomicCAS( &d->top, t, t + 1 );
+}
+
+/*
+=============
+Job_PushForeign
+=============
+*/
+static qboolean Job_PushForeign( const job_t *job ) {
+	qboolean	pushed = qfalse;
+
+	Job_Lock( &jobForeignLock );
+
+	if ( jobForeignHead - jobForeignTail < JOB_DEQUE_SIZE ) {
+		jobForeign[jobForeignHead & JOB_DEQUE_MASK] = *job;
+		jobForeignHead++;
+		pushed = qtrue;
+	}
+
+	Job_Unlock( &jobForeignLock );
+	return pushed;
+}
+
+/*
+=============
+Job_PopForeign
+=============
+*/
+static qboolean Job_PopForeign( job_t *job ) {
+	qboolean	popped = qfalse;
+
+	if ( jobForeignHead == jobForeignTail ) {
+		return qfalse;
+	}
+
+	Job_Lock( &jobForeignLock );
+
+	if ( jobForeignHead != jobForeignTail ) {
+		*job = jobForeign[jobForeignTail & JOB_DEQUE_MASK];
+		jobForeignTail++;
+		popped = qtrue;
+	}
+
+	Job_Unlock( &jobForeignLock );
+	return popped;
+}
+
+/*
+==============================================================
+
+SCHEDULING
+
+==============================================================
+*/
+
+/*
+=============
+Job_Find
+
+Our own newest job, or one queued by another thread, or the
+oldest job of another job thread
+=============
+*/
+static qboolean Job_Find( job_t *job ) {
+	int		i, victim;
+
+	if ( !jobNumDeques ) {
+		return qfalse;
+	}
+
+	if ( jobThreadNum >= 0 && Job_Pop( &jobDeques[jobThreadNum], job ) ) {
+		return qtrue;
+	}
+
+	if ( Job_PopForeign( job ) ) {
+		return qtrue;
+	}
+
+	// start after ourselves so the thieves spread out
+	for ( i = 1 ; i <= jobNumDeques ; i++ ) {
+		victim = ( jobThreadNum + i ) % jobNumDeques;
+		if ( victim < 0 ) {
+			victim += jobNumDeques;
+		}
+		if ( victim != jobThreadNum && Job_Steal( &jobDeques[victim], job ) ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+/*
+=============
+Job_Execute
+=============
+*/
+static void Job_Execute( job_t *job ) {
+	int		i;
+
+	if ( job->waitFor ) {
+		Job_Wait( job->waitFor );
+	}
+
+	for ( i = job->first ; i < job->last ; i++ ) {
+		job->function( job->data, i );
+	}
+
+	if ( job->counter ) {
+		Job_AtomicAdd( &job->counter->value, -1 );
+	}
+}
+
+/*
+=============
+Job_Unsleep
+
+Takes back a sleeper registration, ours or one of a thread
+that is actually asleep, which is just as good as the
+semaphore doesn't care who it wakes
+=============
+*/
+static qboolean Job_Unsleep( void ) {
+	int		sleepers;
+
+	do {
+		sleepers = jobSleepers;
+		if ( sleepers <= 0 ) {
+			return qfalse;
+		}
+	} while ( !Job_AtomicCAS( &jobSleepers, sleepers, sleepers - 1 ) );
+
+	return qtrue;
+}
+
+/*
+=============
+Job_Thread
+=============
+*/
+static void Job_Thread( void *arg ) {
+	job_t	job;
+	int		spins = 0;
+
+	jobThreadNum = (int)(intptr_t)arg;
+
+	while ( !jobQuit ) {
+		if ( Job_Find( &job ) ) {
+			Job_Execute( &job );
+			spins = 0;
+			continue;
+		}
+
+		if ( ++spins < JOB_SPINS ) {
+			Job_Pause();
+			continue;
+		}
+		spins = 0;
+
+		// register before the last look, so a job added right
+		// after it will see us and post the semaphore
+		Job_AtomicAdd( &jobSleepers, 1 );
+		if ( Job_Find( &job ) ) {
+			Job_Unsleep();
+			Job_Execute( &job );
+			continue;
+		}
+
+		Sys_SemaphoreWait( jobSemaphore );
+	}
+}
+
+/*
+=============
+Job_AddRange
+=============
+*/
+static void Job_AddRange( jobFunc_t function, void *data, int first, int last,
+						  jobCounter_t *counter, jobCounter_t *waitFor ) {
+	job_t		job;
+	qboolean	queued;
+
+	job.function = function;
+	job.data = data;
+	job.first = first;
+	job.last = last;
+	job.counter = counter;
+	job.waitFor = waitFor;
+
+	if ( counter ) {
+		Job_AtomicAdd( &counter->value, 1 );
+	}
+
+	if ( !jobNumThreads ) {
+		queued = qfalse;
+	} else if ( jobThreadNum >= 0 ) {
+		queued = Job_Push( &jobDeques[jobThreadNum], &job );
+	} else {
+		queued = Job_PushForeign( &job );
+	}
+
+	// no workers, or too much queued already
+	if ( !queued ) {
+		Job_Execute( &job );
+		return;
+	}
+
+	Job_MemoryBarrier();
+	if ( jobSleepers > 0 && Job_Unsleep() ) {
+		Sys_SemaphorePost( jobSemaphore );
+	}
+}
+
+/*
+=============
+Job_Add
+=============
+*/
+void Job_Add( jobFunc_t function, void *data, int index, jobCounter_t *counter, jobCounter_t *waitFor ) {
+	Job_AddRange( function, data, index, index + 1, counter, waitFor );
+}
+
+/*
+=============
+Job_Wait
+=============
+*/
+void Job_Wait( jobCounter_t *counter ) {
+	job_t	job;
+
+	while ( counter->value > 0 ) {
+		if ( Job_Find( &job ) ) {
+			Job_Execute( &job );
+		} else {
+			Job_Pause();
+		}
+	}
+
+	// make sure we see everything the jobs wrote
+	Job_MemoryBarrier();
+}
+
+/*
+=============
+Job_ParallelFor
+=============
+*/
+void Job_ParallelFor( jobFunc_t function, void *data, int count, int batch ) {
+	jobCounter_t	counter;
+	int				first, last;
+
+	if ( batch <= 0 ) {
+		batch = count / ( 4 * ( jobNumThreads + 1 ) );
+		if ( batch < 1 ) {
+			batch = 1;
+		}
+	}
+
+	// nothing to gain from queueing a single batch
+	if ( !jobNumThreads || count <= batch ) {
+		for ( first = 0 ; first < count ; first++ ) {
+			function( data, first );
+		}
+		return;
+	}
+
+	counter.value = 0;
+	for ( first = 0 ; first < count ; first = last ) {
+		last = first + batch;
+		if ( last > count ) {
+			last = count;
+		}
+		Job_AddRange( function, data, first, last, &counter, NULL );
+	}
+
+	Job_Wait( &counter );
+}
+
+/*
+=============
+Job_NumThreads
+=============
+*/
+int Job_NumThreads( void ) {
+	return jobNumThreads;
+}
+
+/*
+==============================================================
+
+TESTS
+
+==============================================================
+*/
+
+#define	JOBTEST_COUNT		10000
+#define	JOBTEST_STAGE		64
+#define	JOBTEST_OUTER		16
+#define	JOBTEST_INNER		100
+
+typedef struct {
+	int				hits[JOBTEST_COUNT];
+	int				stageA[JOBTEST_STAGE];
+	volatile int	stageErrors;
+	volatile int	nested[JOBTEST_OUTER];
+} jobTest_t;
+
+static void Job_TestHit( void *data, int index ) {
+	((jobTest_t *)data)->hits[index]++;
+}
+
+static void Job_TestStageA( void *data, int index ) {
+	((jobTest_t *)data)->stageA[index] = 1;
+}
+
+static void Job_TestStageB( void *data, int index ) {
+	jobTest_t	*test = data;
+	int			i;
+
+	for ( i = 0 ; i < JOBTEST_STAGE ; i++ ) {
+		if ( !test->stageA[i] ) {
+			Job_AtomicAdd( &test->stageErrors, 1 );
+			return;
+		}
+	}
+}
+
+static void Job_TestInner( void *data, int index ) {
+	Job_AtomicAdd( (volatile int *)data, 1 );
+}
+
+static void Job_TestOuter( void *data, int index ) {
+	jobTest_t	*test = data;
+
+	Job_ParallelFor( Job_TestInner, (void *)&test->nested[index], JOBTEST_INNER, 1 );
+}
+
+static void Job_TestForeign( void *data ) {
+	Job_ParallelFor( Job_TestHit, data, JOBTEST_COUNT, 0 );
+}
+
+static qboolean Job_TestHits( jobTest_t *test ) {
+	int		i;
+
+	for ( i = 0 ; i < JOBTEST_COUNT ; i++ ) {
+		if ( test->hits[i] != 1 ) {
+			return qfalse;
+		}
+	}
+	return qtrue;
+}
+
+/*
+=============
+Job_Test_f
+
+Checks the scheduler does every job once, in order of their
+dependencies, from any thread
+=============
+*/
+static void Job_Test_f( void ) {
+	static const int	batches[] = { 1, 7, 0 };
+	jobTest_t			*test;
+	jobCounter_t		stageA, stageB;
+	void				*thread;
+	int					i, passed, total;
+
+	test = Z_Malloc( sizeof( *test ) );
+	passed = total = 0;
+
+	for ( i = 0 ; i < (int)ARRAY_LEN( batches ) ; i++ ) {
+		Com_Memset( test->hits, 0, sizeof( test->hits ) );
+		Job_ParallelFor( Job_TestHit, test, JOBTEST_COUNT, batches[i] );
+		total++;
+		if ( Job_TestHits( test ) ) {
+			passed++;
+		} else {
+			Com_Printf( "FAILED: parallel for, batch %i\n", batches[i] );
+		}
+	}
+
+	stageA.value = stageB.value = 0;
+	for ( i = 0 ; i < JOBTEST_STAGE ; i++ ) {
+		Job_Add( Job_TestStageA, test, i, &stageA, NULL );
+	}
+	for ( i = 0 ; i < JOBTEST_STAGE ; i++ ) {
+		Job_Add( Job_TestStageB, test, i, &stageB, &stageA );
+	}
+	Job_Wait( &stageB );
+	total++;
+	if ( !test->stageErrors && !stageA.value ) {
+		passed++;
+	} else {
+		Com_Printf( "FAILED: %i jobs started before their dependencies\n", test->stageErrors );
+	}
+
+	Job_ParallelFor( Job_TestOuter, test, JOBTEST_OUTER, 1 );
+	total++;
+	for ( i = 0 ; i < JOBTEST_OUTER ; i++ ) {
+		if ( test->nested[i] != JOBTEST_INNER ) {
+			break;
+		}
+	}
+	if ( i == JOBTEST_OUTER ) {
+		passed++;
+	} else {
+		Com_Printf( "FAILED: nested parallel for\n" );
+	}
+
+	Com_Memset( test->hits, 0, sizeof( test->hits ) );
+	thread = Sys_CreateThread( Job_TestForeign, test );
+	if ( thread ) {
+		Sys_JoinThread( thread );
+		total++;
+		if ( Job_TestHits( test ) ) {
+			passed++;
+		} else {
+			Com_Printf( "FAILED: parallel for from another thread\n" );
+		}
+	}
+
+	Com_Printf( "%i of %i job tests passed with %i worker threads\n", passed, total, jobNumThreads );
+	Z_Free( test );
+}
+
+#define	JOBBENCH_ROUND		( JOB_DEQUE_SIZE / 2 )
+#define	JOBBENCH_ELEMENTS	0x100000
+
+static void Job_BenchEmpty( void *data, int index ) {
+}
+
+static void Job_BenchWork( void *data, int index ) {
+	float	*f = (float *)data + index;
+	int		i;
+
+	for ( i = 0 ; i < 64 ; i++ ) {
+		*f = sqrt( *f * *f + i ) * 0.5f + sin( *f );
+	}
+}
+
+/*
+=============
+Job_Bench_f
+
+Measures the scheduling overhead with empty jobs, and the speed
+up of a parallel for over a simple float kernel
+=============
+*/
+static void Job_Bench_f( void ) {
+	jobCounter_t	counter;
+	float			*elements;
+	int				count, rounds;
+	int				i, j, start, msec, serialMsec;
+
+	count = 1000000;
+	if ( Cmd_Argc() > 1 ) {
+		count = atoi( Cmd_Argv( 1 ) );
+	}
+	rounds = ( count + JOBBENCH_ROUND - 1 ) / JOBBENCH_ROUND;
+	if ( rounds < 1 ) {
+		rounds = 1;
+	}
+
+	// keep under the deque size, or the jobs would run inline
+	start = Sys_Milliseconds();
+	for ( i = 0 ; i < rounds ; i++ ) {
+		counter.value = 0;
+		for ( j = 0 ; j < JOBBENCH_ROUND ; j++ ) {
+			Job_Add( Job_BenchEmpty, NULL, j, &counter, NULL );
+		}
+		Job_Wait( &counter );
+	}
+	msec = Sys_Milliseconds() - start;
+	Com_Printf( "%i empty jobs: %i msec, %.0f jobs/sec\n", rounds * JOBBENCH_ROUND, msec,
+		msec ? rounds * JOBBENCH_ROUND * 1000.0f / msec : 0.0f );
+
+	elements = Hunk_AllocateTempMemory( JOBBENCH_ELEMENTS * sizeof( *elements ) );
+	Com_Memset( elements, 0, JOBBENCH_ELEMENTS * sizeof( *elements ) );
+
+	start = Sys_Milliseconds();
+	for ( i = 0 ; i < JOBBENCH_ELEMENTS ; i++ ) {
+		Job_BenchWork( elements, i );
+	}
+	serialMsec = Sys_Milliseconds() - start;
+
+	// same input for both passes
+	Com_Memset( elements, 0, JOBBENCH_ELEMENTS * sizeof( *elements ) );
+
+	start = Sys_Milliseconds();
+	Job_ParallelFor( Job_BenchWork, elements, JOBBENCH_ELEMENTS, 0 );
+	msec = Sys_Milliseconds() - start;
+
+	Com_Printf( "parallel for over %i elements: %i msec serial, %i msec on %i threads (%.2fx)\n",
+		JOBBENCH_ELEMENTS, serialMsec, msec, jobNumThreads + 1, msec ? serialMsec / (float)msec : 0.0f );
+
+	Hunk_FreeTempMemory( elements );
+}
+
+/*
+==============================================================
+
+INIT
+
+==============================================================
+*/
+
+/*
+=============
+Job_Init
+=============
+*/
+void Job_Init( void ) {
+	int		count;
+
+	com_jobThreads = Cvar_Get( "com_jobThreads", "-1", CVAR_ARCHIVE | CVAR_LATCH );
+	Cvar_CheckRange( com_jobThreads, -1, MAX_JOB_THREADS, qtrue );
+
+	Cmd_AddCommand( "jobtest", Job_Test_f );
+	Cmd_AddCommand( "jobbench", Job_Bench_f );
+
+	jobThreadNum = 0;
+
+	count = com_jobThreads->integer;
+	if ( count < 0 ) {
+		// leave a processor to the main thread
+		count = Sys_ProcessorCount() - 1;
+		if ( count > MAX_JOB_THREADS ) {
+			count = MAX_JOB_THREADS;
+		}
+	}
+	if ( !count ) {
+		Com_Printf( "Jobs run on the main thread\n" );
+		return;
+	}
+
+	jobSemaphore = Sys_CreateSemaphore();
+	if ( !jobSemaphore ) {
+		Com_Printf( "WARNING: couldn't create the job semaphore\n" );
+		return;
+	}
+
+	jobQuit = 0;
+	jobNumDeques = count + 1;
+	jobDeques = Z_Malloc( jobNumDeques * sizeof( *jobDeques ) );
+
+	// threads that fail to start just leave an empty deque
+	for ( jobNumThreads = 0 ; jobNumThreads < count ; jobNumThreads++ ) {
+		jobThreads[jobNumThreads] = Sys_CreateThread( Job_Thread, (void *)(intptr_t)( jobNumThreads + 1 ) );
+		if ( !jobThreads[jobNumThreads] ) {
+			break;
+		}
+	}
+
+	Com_Printf( "Started %i of %i job threads\n", jobNumThreads, count );
+}
+
+/*
+=============
+Job_Shutdown
+=============
+*/
+void Job_Shutdown( void ) {
+	int		i;
+
+	Cmd_RemoveCommand( "jobtest" );
+	Cmd_RemoveCommand( "jobbench" );
+
+	if ( !jobDeques ) {
+		return;
+	}
+
+	jobQuit = 1;
+	for ( i = 0 ; i < jobNumThreads ; i++ ) {
+		Sys_SemaphorePost( jobSemaphore );
+	}
+	for ( i = 0 ; i < jobNumThreads ; i++ ) {
+		Sys_JoinThread( jobThreads[i] );
+	}
+	jobNumThreads = 0;
+
+	Sys_DestroySemaphore( jobSemaphore );
+	jobSemaphore = NULL;
+
+	Z_Free( jobDeques );
+	jobDeques = NULL;
+	jobNumDeques = 0;
+}
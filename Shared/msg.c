@@ -22,10 +22,20 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "q_shared.h"
 #include "qcommon.h"
 
+#if idx64 || ( id386 && defined( __SSE2__ ))
+#include <emmintrin.h>
+#define MSG_SSE2			1
+#else
+#define MSG_SSE2			0
+#endif
+
 static huffman_t		msgHuff;
+static huffTable_t		msgHuffTable;
 
 static qboolean			msgInit = qfalse;
 
+static void MSG_InitDeltaFields( void );
+
 int pcount[256];
 
 /*
@@ -37,8 +47,6 @@ Handles byte ordering and avoids alignment errors
 ==============================================================================
 */
 
-int oldsize = 0;
-
 void MSG_initHuffman( void );
 
 void MSG_Init( msg_t *buf, byte *data, int length ) {
@@ -108,8 +116,6 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 	int	i;
 //	FILE*	fp;
 
-	oldsize += bits;
-
 	// this isn't an exact overflow check, but close enough
 	if ( msg->maxsize - msg->cursize < 4 ) {
 		msg->overflowed = qtrue;
@@ -168,16 +174,14 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 		if (bits&7) {
 			int nbits;
 			nbits = bits&7;
-			for(i=0;i<nbits;i++) {
-				Huff_putBit((value&1), msg->data, &msg->bit);
-				value = (value>>1);
-			}
+			Huff_putBits(value, nbits, msg->data, &msg->bit);
+			value = (value>>nbits);
 			bits = bits - nbits;
 		}
 		if (bits) {
 			for(i=0;i<bits;i+=8) {
 //				fwrite(bp, 1, 1, fp);
-				Huff_offsetTransmit (&msgHuff.compressor, (value&0xff), msg->data, &msg->bit);
+				Huff_tableTransmit (&msgHuffTable, (value&0xff), msg->data, &msg->bit);
 				value = (value>>8);
 			}
 		}
@@ -230,15 +234,13 @@ int MSG_ReadBits( msg_t *msg, int bits ) {
 		nbits = 0;
 		if (bits&7) {
 			nbits = bits&7;
-			for(i=0;i<nbits;i++) {
-				value |= (Huff_getBit(msg->data, &msg->bit)<<i);
-			}
+			value = Huff_getBits(msg->data, msg->maxsize, nbits, &msg->bit);
 			bits = bits - nbits;
 		}
 		if (bits) {
 //			fp = fopen("c:\\netchan.bin", "a");
 			for(i=0;i<bits;i+=8) {
-				Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data, &msg->bit);
+				get = Huff_tableReceive (&msgHuffTable, msg->data, msg->maxsize, &msg->bit);
 //				fwrite(&get, 1, 1, fp);
 				value |= (get<<(i+nbits));
 			}
@@ -752,7 +754,6 @@ void MSG_WriteDeltaUsercmdKey( msg_t *msg, int key, usercmd_t *from, usercmd_t *
 		from->weaponSelectionMode == to->weaponSelectionMode &&
 		from->tierSelectionMode == to->tierSelectionMode) {
 			MSG_WriteBits( msg, 0, 1 );				// no change
-			oldsize += 7;
 			return;
 	}
 	key ^= to->serverTime;
@@ -840,6 +841,200 @@ typedef struct {
 	int		bits;		// 0 = float
 } netField_t;
 
+/*
+==============================================================================
+
+			DELTA BITS
+
+The delta writers find what changed with wide compares over the whole
+state, then gather the flag bits between the huffman coded bytes and
+write them out together.  The bits are the same as the MSG_WriteBits
+calls would have written, overflow included
+==============================================================================
+*/
+
+#define	ENTITY_WORDS		( sizeof( entityState_t ) / 4 )
+#define	PLAYER_WORDS		( sizeof( playerState_t ) / 4 )
+
+#define	MSG_WORD_CHANGED( changed, word )	( ( changed )[( word ) >> 5] & ( 1u << ( ( word ) & 31 ) ) )
+
+// the field whose word it is, plus one, so the last changed field
+// comes from the changed words alone
+static byte		entityWordField[ENTITY_WORDS];
+static byte		playerWordField[PLAYER_WORDS];
+
+// the deltatest and deltabench reference: MSG_WriteBits for every
+// write and scalar compares, as the delta writers always did
+static qboolean	msgDeltaReference;
+
+typedef struct {
+	msg_t		*msg;
+	qboolean	direct;		// straight through MSG_WriteBits
+	unsigned	raw;		// flag bits not written yet, first in the lowest bit
+	int			numRaw;
+	int			cursize;	// what msg->cursize would be by now
+} msgBits_t;
+
+static void MSG_BitsBegin( msgBits_t *bits, msg_t *msg ) {
+	bits->msg = msg;
+	bits->direct = msg->oob || msgDeltaReference;
+	bits->raw = 0;
+	bits->numRaw = 0;
+	bits->cursize = msg->cursize;
+}
+
+static void MSG_BitsFlush( msgBits_t *bits ) {
+	if ( bits->numRaw ) {
+		Huff_putBits( bits->raw, bits->numRaw, bits->msg->data, &bits->msg->bit );
+		bits->raw = 0;
+		bits->numRaw = 0;
+	}
+}
+
+static void MSG_BitsEnd( msgBits_t *bits ) {
+	if ( !bits->direct ) {
+		MSG_BitsFlush( bits );
+		bits->msg->cursize = bits->cursize;
+	}
+}
+
+/*
+=================
+MSG_BitsWrite
+
+MSG_WriteBits for 1 to 32 bits, negative for signed values, holding the
+odd bits back until a huffman coded byte has to go after them
+=================
+*/
+static ID_INLINE void MSG_BitsWrite( msgBits_t *bits, int value, int count ) {
+	msg_t	*msg;
+	int		n;
+
+	if ( bits->direct ) {
+		MSG_WriteBits( bits->msg, value, count );
+		return;
+	}
+
+	msg = bits->msg;
+	if ( msg->maxsize - bits->cursize < 4 ) {
+		msg->overflowed = qtrue;
+		return;
+	}
+
+	if ( count < 0 ) {
+		count = -count;
+	}
+	value &= (0xffffffff>>(32-count));
+	n = count & 7;
+	if ( n ) {
+		if ( bits->numRaw + n > 32 ) {
+			MSG_BitsFlush( bits );
+		}
+		bits->raw |= (unsigned)( value & ( ( 1 << n ) - 1 ) ) << bits->numRaw;
+		bits->numRaw += n;
+		value = ( value >> n );
+		count -= n;
+	}
+	if ( count ) {
+		MSG_BitsFlush( bits );
+		for ( ; count > 0 ; count -= 8 ) {
+			Huff_tableTransmit( &msgHuffTable, ( value & 0xff ), msg->data, &msg->bit );
+			value = ( value >> 8 );
+		}
+	}
+	bits->cursize = ( ( msg->bit + bits->numRaw ) >> 3 ) + 1;
+}
+
+/*
+=================
+MSG_ChangedFields
+
+Sets a bit in changed for every 32 bit word that differs between from
+and to, and returns the number of fields up to the last changed one
+=================
+*/
+static int MSG_ChangedFields( const void *from, const void *to, int numWords, const byte *wordField, unsigned *changed ) {
+	const int	*fromW = from;
+	const int	*toW = to;
+	unsigned	mask;
+	int			i, w, lc;
+
+	Com_Memset( changed, 0, ( ( numWords + 31 ) >> 5 ) * sizeof( *changed ) );
+
+	w = 0;
+#if MSG_SSE2
+	if ( !msgDeltaReference ) {
+		for ( ; w + 4 <= numWords ; w += 4 ) {
+			__m128i	a = _mm_loadu_si128( (const __m128i *)( fromW + w ) );
+			__m128i	b = _mm_loadu_si128( (const __m128i *)( toW + w ) );
+
+			mask = ~_mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( a, b ) ) ) & 15;
+			changed[w >> 5] |= mask << ( w & 31 );
+		}
+	}
+#endif
+	for ( ; w < numWords ; w++ ) {
+		if ( fromW[w] != toW[w] ) {
+			changed[w >> 5] |= 1u << ( w & 31 );
+		}
+	}
+
+	lc = 0;
+	for ( i = 0 ; i < ( numWords + 31 ) >> 5 ; i++ ) {
+		for ( mask = changed[i], w = i << 5 ; mask ; mask >>= 1, w++ ) {
+			if ( ( mask & 1 ) && wordField[w] > lc ) {
+				lc = wordField[w];
+			}
+		}
+	}
+	return lc;
+}
+
+/*
+=================
+MSG_ChangedBits
+
+The changed bits of count words from firstWord, for an int array
+=================
+*/
+static int MSG_ChangedBits( const unsigned *changed, int firstWord, int count ) {
+	unsigned	bits;
+	int			shift;
+
+	shift = firstWord & 31;
+	bits = changed[firstWord >> 5] >> shift;
+	if ( shift && shift + count > 32 ) {
+		bits |= changed[( firstWord >> 5 ) + 1] << ( 32 - shift );
+	}
+	if ( count < 32 ) {
+		bits &= ( 1u << count ) - 1;
+	}
+	return bits;
+}
+
+/*
+=================
+MSG_BitsWriteArray
+
+A changed flag, and when set the changed mask and each changed value
+=================
+*/
+static void MSG_BitsWriteArray( msgBits_t *bits, int changed, int count, const int *values, int valueBits ) {
+	int		i;
+
+	if ( !changed ) {
+		MSG_BitsWrite( bits, 0, 1 );	// no change
+		return;
+	}
+	MSG_BitsWrite( bits, 1, 1 );	// changed
+	MSG_BitsWrite( bits, changed, count );
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( changed & ( 1 << i ) ) {
+			MSG_BitsWrite( bits, values[i], valueBits );
+		}
+	}
+}
+
 // using the stringizing operator to save typing...
 #define	NETF(x) #x,(size_t)&((entityState_t*)0)->x
 
@@ -938,19 +1133,18 @@ identical, under the assumption that the in-order delta code will catch it.
 void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entityState_s *to, 
 						   qboolean force ) {
 	int			i, lc;
-	int			numFields;
 	netField_t	*field;
 	int			trunc;
 	float		fullFloat;
-	int			*fromF, *toF;
-
-	numFields = ARRAY_LEN( entityStateFields );
+	int			*toF;
+	unsigned	changed[( ENTITY_WORDS + 31 ) / 32];
+	msgBits_t	bits;
 
 	// all fields should be 32 bits to avoid any compiler packing issues
 	// the "number" field is not part of the field list
 	// if this assert fails, someone added a field to the entityState_t
 	// struct without updating the message fields
-	assert( numFields + 1 == sizeof( *from )/4 );
+	assert( ARRAY_LEN( entityStateFields ) + 1 == sizeof( *from )/4 );
 
 	// a NULL to is a delta remove message
 	if ( to == NULL ) {
@@ -966,15 +1160,7 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 		Com_Error (ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number: %i", to->number );
 	}
 
-	lc = 0;
-	// build the change vector as bytes so it is endien independent
-	for ( i = 0, field = entityStateFields ; i < numFields ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-		if ( *fromF != *toF ) {
-			lc = i+1;
-		}
-	}
+	lc = MSG_ChangedFields( from, to, ENTITY_WORDS, entityWordField, changed );
 
 	if ( lc == 0 ) {
 		// nothing at all changed
@@ -988,24 +1174,21 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 		return;
 	}
 
-	MSG_WriteBits( msg, to->number, GENTITYNUM_BITS );
-	MSG_WriteBits( msg, 0, 1 );			// not removed
-	MSG_WriteBits( msg, 1, 1 );			// we have a delta
-
-	MSG_WriteByte( msg, lc );	// # of changes
+	MSG_BitsBegin( &bits, msg );
+	MSG_BitsWrite( &bits, to->number, GENTITYNUM_BITS );
+	MSG_BitsWrite( &bits, 0, 1 );			// not removed
+	MSG_BitsWrite( &bits, 1, 1 );			// we have a delta
 
-	oldsize += numFields;
+	MSG_BitsWrite( &bits, lc, 8 );	// # of changes
 
 	for ( i = 0, field = entityStateFields ; i < lc ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-
-		if ( *fromF == *toF ) {
-			MSG_WriteBits( msg, 0, 1 );	// no change
+		if ( !MSG_WORD_CHANGED( changed, field->offset >> 2 ) ) {
+			MSG_BitsWrite( &bits, 0, 1 );	// no change
 			continue;
 		}
+		toF = (int *)( (byte *)to + field->offset );
 
-		MSG_WriteBits( msg, 1, 1 );	// changed
+		MSG_BitsWrite( &bits, 1, 1 );	// changed
 
 		if ( field->bits == 0 ) {
 			// float
@@ -1013,31 +1196,31 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 			trunc = (int)fullFloat;
 
 			if (fullFloat == 0.0f) {
-					MSG_WriteBits( msg, 0, 1 );
-					oldsize += FLOAT_INT_BITS;
+					MSG_BitsWrite( &bits, 0, 1 );
 			} else {
-				MSG_WriteBits( msg, 1, 1 );
+				MSG_BitsWrite( &bits, 1, 1 );
 				if ( trunc == fullFloat && trunc + FLOAT_INT_BIAS >= 0 && 
 					trunc + FLOAT_INT_BIAS < ( 1 << FLOAT_INT_BITS ) ) {
 					// send as small integer
-					MSG_WriteBits( msg, 0, 1 );
-					MSG_WriteBits( msg, trunc + FLOAT_INT_BIAS, FLOAT_INT_BITS );
+					MSG_BitsWrite( &bits, 0, 1 );
+					MSG_BitsWrite( &bits, trunc + FLOAT_INT_BIAS, FLOAT_INT_BITS );
 				} else {
 					// send as full floating point value
-					MSG_WriteBits( msg, 1, 1 );
-					MSG_WriteBits( msg, *toF, 32 );
+					MSG_BitsWrite( &bits, 1, 1 );
+					MSG_BitsWrite( &bits, *toF, 32 );
 				}
 			}
 		} else {
 			if (*toF == 0) {
-				MSG_WriteBits( msg, 0, 1 );
+				MSG_BitsWrite( &bits, 0, 1 );
 			} else {
-				MSG_WriteBits( msg, 1, 1 );
+				MSG_BitsWrite( &bits, 1, 1 );
 				// integer
-				MSG_WriteBits( msg, *toF, field->bits );
+				MSG_BitsWrite( &bits, *toF, field->bits );
 			}
 		}
 	}
+	MSG_BitsEnd( &bits );
 }
 
 /*
@@ -1252,6 +1435,24 @@ netField_t	playerStateFields[] =
 { PSF(attackPower), 32 },
 };
 
+/*
+=================
+MSG_InitDeltaFields
+=================
+*/
+static void MSG_InitDeltaFields( void ) {
+	int		i;
+
+	Com_Memset( entityWordField, 0, sizeof( entityWordField ) );
+	for ( i = 0 ; i < ARRAY_LEN( entityStateFields ) ; i++ ) {
+		entityWordField[entityStateFields[i].offset >> 2] = i + 1;
+	}
+	Com_Memset( playerWordField, 0, sizeof( playerWordField ) );
+	for ( i = 0 ; i < ARRAY_LEN( playerStateFields ) ; i++ ) {
+		playerWordField[playerStateFields[i].offset >> 2] = i + 1;
+	}
+}
+
 /*
 =============
 MSG_WriteDeltaPlayerstate
@@ -1273,42 +1474,31 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	int				basestatsbits;
 	int				bufferbits;
 	int				lockedbits;
-	int				numFields;
 	netField_t		*field;
-	int				*fromF, *toF;
+	int				*toF;
 	float			fullFloat;
 	int				trunc, lc;
+	unsigned		changed[( PLAYER_WORDS + 31 ) / 32];
+	msgBits_t		bits;
 
 	if (!from) {
 		from = &dummy;
 		Com_Memset (&dummy, 0, sizeof(dummy));
 	}
 
-	numFields = ARRAY_LEN( playerStateFields );
-
-	lc = 0;
-	for ( i = 0, field = playerStateFields ; i < numFields ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-		if ( *fromF != *toF ) {
-			lc = i+1;
-		}
-	}
-
-	MSG_WriteByte( msg, lc );	// # of changes
+	lc = MSG_ChangedFields( from, to, PLAYER_WORDS, playerWordField, changed );
 
-	oldsize += numFields - lc;
+	MSG_BitsBegin( &bits, msg );
+	MSG_BitsWrite( &bits, lc, 8 );	// # of changes
 
 	for ( i = 0, field = playerStateFields ; i < lc ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-
-		if ( *fromF == *toF ) {
-			MSG_WriteBits( msg, 0, 1 );	// no change
+		if ( !MSG_WORD_CHANGED( changed, field->offset >> 2 ) ) {
+			MSG_BitsWrite( &bits, 0, 1 );	// no change
 			continue;
 		}
+		toF = (int *)( (byte *)to + field->offset );
 
-		MSG_WriteBits( msg, 1, 1 );	// changed
+		MSG_BitsWrite( &bits, 1, 1 );	// changed
 //		pcount[i]++;
 
 		if ( field->bits == 0 ) {
@@ -1319,16 +1509,16 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 			if ( trunc == fullFloat && trunc + FLOAT_INT_BIAS >= 0 && 
 				trunc + FLOAT_INT_BIAS < ( 1 << FLOAT_INT_BITS ) ) {
 				// send as small integer
-				MSG_WriteBits( msg, 0, 1 );
-				MSG_WriteBits( msg, trunc + FLOAT_INT_BIAS, FLOAT_INT_BITS );
+				MSG_BitsWrite( &bits, 0, 1 );
+				MSG_BitsWrite( &bits, trunc + FLOAT_INT_BIAS, FLOAT_INT_BITS );
 			} else {
 				// send as full floating point value
-				MSG_WriteBits( msg, 1, 1 );
-				MSG_WriteBits( msg, *toF, 32 );
+				MSG_BitsWrite( &bits, 1, 1 );
+				MSG_BitsWrite( &bits, *toF, 32 );
 			}
 		} else {
 			// integer
-			MSG_WriteBits( msg, *toF, field->bits );
+			MSG_BitsWrite( &bits, *toF, field->bits );
 		}
 	}
 
@@ -1336,67 +1526,20 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	//
 	// send the arrays
 	//
-	statsbits = 0;
-	for (i=0 ; i<MAX_STATS ; i++) {
-		if (to->stats[i] != from->stats[i]) {
-			statsbits |= 1<<i;
-		}
-	}
-	lockedbits = 0;
-	for (i=0 ; i<MAX_LOCKED_STATS ; i++) {
-		if (to->lockonData[i] != from->lockonData[i]) {
-			lockedbits |= 1<<i;
-		}
-	}
-	persistantbits = 0;
-	for (i=0 ; i<MAX_PERSISTANT ; i++) {
-		if (to->persistant[i] != from->persistant[i]) {
-			persistantbits |= 1<<i;
-		}
-	}
-	skillbits = 0;
-	for (i=0 ; i<MAX_WEAPONS ; i++) {
-		if (to->currentSkill[i] != from->currentSkill[i]) {
-			skillbits |= 1<<i;
-		}
-	}
-	powerupbits = 0;
-	for (i=0 ; i<MAX_POWERUPS ; i++) {
-		if (to->powerups[i] != from->powerups[i]) {
-			powerupbits |= 1<<i;
-		}
-	}
-	timerbits = 0;
-	for (i=0 ; i<MAX_TIMERS ; i++) {
-		if (to->timers[i] != from->timers[i]) {
-			timerbits |= 1<<i;
-		}
-	}
-	cooldownbits = 0;
-	for (i=0 ; i<MAX_COOLDOWN ; i++) {
-		if (to->cooldownTimers[i] != from->cooldownTimers[i]) {
-			cooldownbits |= 1<<i;
-		}
-	}
-	sequencebits = 0;
-	for (i=0 ; i<MAX_SEQUENCE ; i++) {
-		if (to->sequenceTimers[i] != from->sequenceTimers[i]) {
-			sequencebits |= 1<<i;
-		}
-	}
-	measurebits = 0;
-	for (i=0 ; i<MAX_MEASURES ; i++) {
-		if (to->measureTimers[i] != from->measureTimers[i]) {
-			measurebits |= 1<<i;
-		}
-	}
-	powerlevelbits = 0;
-	for (i=0 ; i<MAX_POWERSTATS ; i++) {
-		if (to->powerLevel[i] != from->powerLevel[i]) {
-			powerlevelbits |= 1<<i;
-		}
-	}
-
+#define	PS_CHANGED( array, count )	MSG_ChangedBits( changed, (int)( (size_t)&((playerState_t*)0)->array / 4 ), count )
+	statsbits = PS_CHANGED( stats, MAX_STATS );
+	lockedbits = PS_CHANGED( lockonData, MAX_LOCKED_STATS );
+	persistantbits = PS_CHANGED( persistant, MAX_PERSISTANT );
+	skillbits = PS_CHANGED( currentSkill, MAX_WEAPONS );
+	powerupbits = PS_CHANGED( powerups, MAX_POWERUPS );
+	timerbits = PS_CHANGED( timers, MAX_TIMERS );
+	cooldownbits = PS_CHANGED( cooldownTimers, MAX_COOLDOWN );
+	sequencebits = PS_CHANGED( sequenceTimers, MAX_SEQUENCE );
+	measurebits = PS_CHANGED( measureTimers, MAX_MEASURES );
+	powerlevelbits = PS_CHANGED( powerLevel, MAX_POWERSTATS );
+#undef PS_CHANGED
+
+	// these are compared as floats, so -0 is no change and a NaN always is
 	basestatsbits = 0;
 	for (i=0 ; i<MAX_BASESTATS ; i++) {
 		if (to->baseStats[i] != from->baseStats[i]) {
@@ -1412,129 +1555,25 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	}
 
 	if (!statsbits && !persistantbits && !skillbits && !lockedbits && !powerupbits && !timerbits && !powerlevelbits && !basestatsbits && !cooldownbits && !sequencebits && !measurebits && !bufferbits) {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-		oldsize += 8;
+		MSG_BitsWrite( &bits, 0, 1 );	// no change
+		MSG_BitsEnd( &bits );
 		return;
 	}
-	MSG_WriteBits( msg, 1, 1 );	// changed
-
-	if ( statsbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, statsbits, MAX_STATS );
-		for (i=0 ; i<MAX_STATS ; i++)
-			if (statsbits & (1<<i) )
-				MSG_WriteShort (msg, to->stats[i]);
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-	if ( lockedbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, lockedbits, MAX_LOCKED_STATS );
-		for (i=0 ; i<MAX_LOCKED_STATS ; i++)
-			if (lockedbits & (1<<i) )
-				MSG_WriteShort (msg, to->lockonData[i]);
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-	if ( persistantbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, persistantbits, MAX_PERSISTANT );
-		for (i=0 ; i<MAX_PERSISTANT ; i++)
-			if (persistantbits & (1<<i) )
-				MSG_WriteShort (msg, to->persistant[i]);
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-
-	if ( skillbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, skillbits, MAX_WEAPONS );
-		for (i=0 ; i<MAX_WEAPONS ; i++)
-			if (skillbits & (1<<i) )
-				MSG_WriteShort (msg, to->currentSkill[i]);
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-
-	if ( powerupbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, powerupbits, MAX_POWERUPS );
-		for (i=0 ; i<MAX_POWERUPS ; i++)
-			if (powerupbits & (1<<i) )
-				MSG_WriteShort( msg, to->powerups[i] );
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-
-	if ( timerbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, timerbits, MAX_TIMERS );
-		for (i=0 ; i<MAX_TIMERS ; i++)
-			if (timerbits & (1<<i) )
-				MSG_WriteShort( msg, to->timers[i] );
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-
-	if ( cooldownbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, cooldownbits, MAX_COOLDOWN );
-		for (i=0 ; i<MAX_COOLDOWN ; i++)
-			if (cooldownbits & (1<<i) )
-				MSG_WriteShort( msg, to->cooldownTimers[i] );
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-
-	if ( sequencebits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, sequencebits, MAX_SEQUENCE );
-		for (i=0 ; i<MAX_SEQUENCE ; i++)
-			if (sequencebits & (1<<i) )
-				MSG_WriteShort( msg, to->sequenceTimers[i] );
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-
-	if ( measurebits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, measurebits, MAX_MEASURES );
-		for (i=0 ; i<MAX_MEASURES ; i++)
-			if (measurebits & (1<<i) )
-				MSG_WriteShort( msg, to->measureTimers[i] );
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-
-	if ( powerlevelbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, powerlevelbits, MAX_POWERSTATS );
-		for (i=0 ; i<MAX_POWERSTATS ; i++)
-			if (powerlevelbits & (1<<i) )
-				MSG_WriteShort( msg, to->powerLevel[i] );
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-
-	if ( basestatsbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, basestatsbits, MAX_BASESTATS );
-		for (i=0 ; i<MAX_BASESTATS ; i++)
-			if (basestatsbits & (1<<i) )
-				MSG_WriteFloat( msg, to->baseStats[i] );
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
-
-	if ( bufferbits ) {
-		MSG_WriteBits( msg, 1, 1 );	// changed
-		MSG_WriteBits( msg, bufferbits, MAX_RBUFFERS );
-		for (i=0 ; i<MAX_RBUFFERS ; i++)
-			if (bufferbits & (1<<i) )
-				MSG_WriteFloat( msg, to->buffers[i] );
-	} else {
-		MSG_WriteBits( msg, 0, 1 );	// no change
-	}
+	MSG_BitsWrite( &bits, 1, 1 );	// changed
+
+	MSG_BitsWriteArray( &bits, statsbits, MAX_STATS, to->stats, 16 );
+	MSG_BitsWriteArray( &bits, lockedbits, MAX_LOCKED_STATS, to->lockonData, 16 );
+	MSG_BitsWriteArray( &bits, persistantbits, MAX_PERSISTANT, to->persistant, 16 );
+	MSG_BitsWriteArray( &bits, skillbits, MAX_WEAPONS, to->currentSkill, 16 );
+	MSG_BitsWriteArray( &bits, powerupbits, MAX_POWERUPS, to->powerups, 16 );
+	MSG_BitsWriteArray( &bits, timerbits, MAX_TIMERS, to->timers, 16 );
+	MSG_BitsWriteArray( &bits, cooldownbits, MAX_COOLDOWN, to->cooldownTimers, 16 );
+	MSG_BitsWriteArray( &bits, sequencebits, MAX_SEQUENCE, to->sequenceTimers, 16 );
+	MSG_BitsWriteArray( &bits, measurebits, MAX_MEASURES, to->measureTimers, 16 );
+	MSG_BitsWriteArray( &bits, powerlevelbits, MAX_POWERSTATS, to->powerLevel, 16 );
+	MSG_BitsWriteArray( &bits, basestatsbits, MAX_BASESTATS, (int *)to->baseStats, 32 );
+	MSG_BitsWriteArray( &bits, bufferbits, MAX_RBUFFERS, (int *)to->buffers, 32 );
+	MSG_BitsEnd( &bits );
 }
 
 
@@ -2037,6 +2076,9 @@ void MSG_initHuffman( void ) {
 			Huff_addRef(&msgHuff.decompressor,	(byte)i);			// Do update
 		}
 	}
+	// both trees were built the same way, so one table does for reading and writing
+	Huff_BuildTable(&msgHuffTable, &msgHuff.compressor);
+	MSG_InitDeltaFields();
 }
 
 /*
@@ -2075,3 +2117,1117 @@ void MSG_NUinitHuffman() {
 */
 
 //===========================================================================
+
+/*
+==============================================================================
+
+			HUFFMAN TESTS
+
+The tables must put the same bits on the wire as the tree they came from
+==============================================================================
+*/
+
+#define	HUFFTEST_PACKETS	500
+#define	HUFFTEST_SIZE		1400
+#define	HUFFTEST_FIELDS		( HUFFTEST_SIZE * 8 )
+#define	HUFFTEST_SLACK		64		// MSG_WriteBits only stops within 4 bytes of the end
+
+#define	HUFFBENCH_BYTES		0x100000
+#define	HUFFBENCH_PAD		8		// zeros after each packet, so the tree walk stays in the buffer
+#define	HUFFBENCH_ROUNDS	20
+
+static int MSG_HuffRand( int *seed ) {
+	return ( Q_rand( seed ) >> 8 ) & 0xffff;
+}
+
+/*
+=================
+MSG_HuffTreeWriteBits
+
+MSG_WriteBits as it was before the tables, walking the tree
+=================
+*/
+static void MSG_HuffTreeWriteBits( byte *data, int *bit, int value, int bits ) {
+	int	i;
+
+	value &= (0xffffffff>>(32-bits));
+	for ( i = 0 ; i < ( bits & 7 ) ; i++ ) {
+		Huff_putBit( ( value & 1 ), data, bit );
+		value = ( value >> 1 );
+	}
+	for ( bits -= bits & 7 ; bits > 0 ; bits -= 8 ) {
+		Huff_offsetTransmit( &msgHuff.compressor, ( value & 0xff ), data, bit );
+		value = ( value >> 8 );
+	}
+}
+
+/*
+=================
+MSG_HuffTreeReadBits
+
+MSG_ReadBits as it was before the tables, walking the tree
+=================
+*/
+static int MSG_HuffTreeReadBits( byte *data, int *bit, int bits ) {
+	int	value, get;
+	int	i, nbits;
+
+	value = 0;
+	nbits = bits & 7;
+	for ( i = 0 ; i < nbits ; i++ ) {
+		value |= ( Huff_getBit( data, bit ) << i );
+	}
+	for ( i = 0 ; i < bits - nbits ; i += 8 ) {
+		Huff_offsetReceive( msgHuff.decompressor.tree, &get, data, bit );
+		value |= ( get << ( i + nbits ) );
+	}
+	return value;
+}
+
+/*
+=================
+MSG_HuffTest_f
+
+Writes and reads back random fields through MSG_WriteBits and
+MSG_ReadBits and through the tree, and decodes random garbage both
+ways, checking every bit and value matches
+=================
+*/
+void MSG_HuffTest_f( void ) {
+	msg_t	msg;
+	byte	*tableData, *treeData;
+	int		*values, *sizes;
+	int		startSeed, seed, packet, size, fields, i;
+	int		treeBit, tableBit, value, get;
+	int		failed, failedGarbage, symbols;
+
+	if ( !msgInit ) {
+		MSG_initHuffman();
+	}
+	// the readers log through it, and dedicated servers don't have one
+	if ( !cl_shownet ) {
+		cl_shownet = Cvar_Get( "cl_shownet", "0", CVAR_TEMP );
+	}
+
+	startSeed = seed = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : Sys_Milliseconds();
+	tableData = Z_Malloc( HUFFTEST_SIZE + HUFFTEST_SLACK );
+	treeData = Z_Malloc( HUFFTEST_SIZE + HUFFTEST_SLACK );
+	values = Z_Malloc( HUFFTEST_FIELDS * sizeof( *values ) );
+	sizes = Z_Malloc( HUFFTEST_FIELDS * sizeof( *sizes ) );
+
+	failed = failedGarbage = symbols = 0;
+	for ( packet = 0 ; packet < HUFFTEST_PACKETS ; packet++ ) {
+		size = 64 + MSG_HuffRand( &seed ) % ( HUFFTEST_SIZE - 64 );
+
+		// stale bytes must be overwritten or kept the same way
+		for ( i = 0 ; i < size + HUFFTEST_SLACK ; i++ ) {
+			tableData[i] = treeData[i] = MSG_HuffRand( &seed );
+		}
+
+		MSG_Init( &msg, tableData, size );
+		treeBit = 0;
+		for ( fields = 0 ; fields < HUFFTEST_FIELDS ; fields++ ) {
+			sizes[fields] = 1 + MSG_HuffRand( &seed ) % 32;
+			values[fields] = Q_rand( &seed );
+			if ( sizes[fields] != 32 ) {
+				values[fields] &= ( 1 << sizes[fields] ) - 1;
+			}
+			MSG_WriteBits( &msg, values[fields], sizes[fields] );
+			if ( msg.overflowed ) {
+				break;
+			}
+			MSG_HuffTreeWriteBits( treeData, &treeBit, values[fields], sizes[fields] );
+		}
+
+		if ( msg.bit != treeBit || memcmp( tableData, treeData, size + HUFFTEST_SLACK ) ) {
+			Com_Printf( "FAILED: packet %i of %i bytes written differently\n", packet, size );
+			failed++;
+			continue;
+		}
+
+		// the last field can run past the end, and the tables read
+		// nothing past maxsize
+		MSG_BeginReading( &msg );
+		msg.maxsize = size + HUFFTEST_SLACK;
+		treeBit = 0;
+		for ( i = 0 ; i < fields ; i++ ) {
+			value = MSG_ReadBits( &msg, sizes[i] );
+			get = MSG_HuffTreeReadBits( treeData, &treeBit, sizes[i] );
+			if ( value != get || value != values[i] || msg.bit != treeBit ) {
+				break;
+			}
+		}
+		if ( i != fields ) {
+			Com_Printf( "FAILED: packet %i field %i of %i bits read back differently\n", packet, i, sizes[i] );
+			failed++;
+			continue;
+		}
+
+		// what a bad packet decodes to must not change either
+		for ( treeBit = tableBit = 0 ; treeBit < ( size - 8 ) * 8 ; symbols++ ) {
+			Huff_offsetReceive( msgHuff.decompressor.tree, &get, treeData, &treeBit );
+			value = Huff_tableReceive( &msgHuffTable, treeData, size, &tableBit );
+			if ( value != get || tableBit != treeBit ) {
+				Com_Printf( "FAILED: packet %i garbage decoded differently at bit %i\n", packet, treeBit );
+				failedGarbage++;
+				break;
+			}
+		}
+	}
+
+	Com_Printf( "%i of %i packets round tripped, %i of %i garbage packets decoded the same (%i symbols, seed %i)\n",
+		HUFFTEST_PACKETS - failed, HUFFTEST_PACKETS, HUFFTEST_PACKETS - failedGarbage, HUFFTEST_PACKETS, symbols, startSeed );
+
+	Z_Free( sizes );
+	Z_Free( values );
+	Z_Free( treeData );
+	Z_Free( tableData );
+}
+
+/*
+=================
+MSG_HuffBenchAddDemo
+
+Appends the packets of a demo, each followed by HUFFBENCH_PAD zeros,
+until the buffer is full.  Reads them one by one like the demo player,
+as FS_ReadFile would clear the temp memory they go into
+=================
+*/
+static void MSG_HuffBenchAddDemo( const char *name, byte *data, int *offsets, int *numPackets ) {
+	fileHandle_t	f;
+	int				header[2], length, end;
+
+	FS_FOpenFileRead( name, &f, qtrue );
+	if ( !f ) {
+		Com_Printf( "Couldn't open %s\n", name );
+		return;
+	}
+
+	end = offsets[*numPackets];
+	while ( FS_Read( header, sizeof( header ), f ) == sizeof( header ) ) {
+		length = LittleLong( header[1] );
+		if ( length <= 0 || length > MAX_MSGLEN || end + length + HUFFBENCH_PAD > HUFFBENCH_BYTES ) {
+			break;
+		}
+		if ( FS_Read( data + end, length, f ) != length ) {
+			break;
+		}
+		Com_Memset( data + end + length, 0, HUFFBENCH_PAD );
+		end += length + HUFFBENCH_PAD;
+		offsets[++*numPackets] = end;
+	}
+
+	FS_FCloseFile( f );
+}
+
+/*
+=================
+MSG_HuffBenchAddSynthetic
+
+Fills the buffer with packets of random bytes spread like msg_hData,
+for when there are no demos to read
+=================
+*/
+static void MSG_HuffBenchAddSynthetic( byte *data, int *offsets, int *numPackets ) {
+	msg_t	msg;
+	int		total[256];
+	int		seed, length, end, r, i;
+
+	total[0] = msg_hData[0];
+	for ( i = 1 ; i < 256 ; i++ ) {
+		total[i] = total[i-1] + msg_hData[i];
+	}
+
+	seed = 0;
+	end = offsets[*numPackets];
+	while ( 1 ) {
+		length = 64 + MSG_HuffRand( &seed ) % ( HUFFTEST_SIZE - 64 );
+		if ( end + length + HUFFBENCH_PAD > HUFFBENCH_BYTES ) {
+			break;
+		}
+		// stop well short, as a long code can run past the overflow check
+		MSG_Init( &msg, data + end, length );
+		while ( msg.cursize < length - 16 ) {
+			r = ( Q_rand( &seed ) & 0x7fffffff ) % total[255];
+			for ( i = 0 ; total[i] <= r ; i++ ) {
+			}
+			MSG_WriteBits( &msg, i, 8 );
+		}
+		Com_Memset( data + end + msg.cursize, 0, HUFFBENCH_PAD );
+		end += msg.cursize + HUFFBENCH_PAD;
+		offsets[++*numPackets] = end;
+	}
+}
+
+/*
+=================
+MSG_HuffBench_f
+
+Decodes every packet of the given demos, or of all the demos when none
+are given, to symbols and encodes them again, with the tree and with the
+tables.  The two must agree on every symbol and every byte
+=================
+*/
+void MSG_HuffBench_f( void ) {
+	byte	*data, *symbols, *treeOut, *tableOut;
+	int		*offsets, *symbolStart;
+	char	**demos;
+	int		numPackets, numDemos, numSymbols, numBytes, mismatches;
+	int		i, j, round, start, end, bit, treeBit, tableBit, ch, check;
+	int		msec[4];
+
+	if ( !msgInit ) {
+		MSG_initHuffman();
+	}
+
+	data = Hunk_AllocateTempMemory( HUFFBENCH_BYTES );
+	offsets = Hunk_AllocateTempMemory( ( HUFFBENCH_BYTES / ( 1 + HUFFBENCH_PAD ) + 1 ) * sizeof( *offsets ) );
+
+	numPackets = 0;
+	offsets[0] = 0;
+	if ( Cmd_Argc() > 1 ) {
+		for ( i = 1 ; i < Cmd_Argc() ; i++ ) {
+			MSG_HuffBenchAddDemo( va( "demos/%s", Cmd_Argv( i ) ), data, offsets, &numPackets );
+		}
+	} else {
+		demos = FS_ListFiles( "demos", "", &numDemos );
+		for ( i = 0 ; i < numDemos ; i++ ) {
+			if ( strstr( demos[i], "." DEMOEXT ) ) {
+				MSG_HuffBenchAddDemo( va( "demos/%s", demos[i] ), data, offsets, &numPackets );
+			}
+		}
+		FS_FreeFileList( demos );
+	}
+	if ( !numPackets ) {
+		Com_Printf( "No demo packets, using synthetic ones\n" );
+		MSG_HuffBenchAddSynthetic( data, offsets, &numPackets );
+	}
+	numBytes = offsets[numPackets] - numPackets * HUFFBENCH_PAD;
+
+	// every bit pattern decodes, so there are at most 8 symbols a byte
+	symbols = Hunk_AllocateTempMemory( offsets[numPackets] * 8 );
+	symbolStart = Hunk_AllocateTempMemory( ( numPackets + 1 ) * sizeof( *symbolStart ) );
+	treeOut = Hunk_AllocateTempMemory( MAX_MSGLEN + HUFFBENCH_PAD );
+	tableOut = Hunk_AllocateTempMemory( MAX_MSGLEN + HUFFBENCH_PAD );
+
+	// check the two agree, and keep the symbols for the encoders
+	numSymbols = mismatches = 0;
+	for ( i = 0 ; i < numPackets ; i++ ) {
+		symbolStart[i] = numSymbols;
+		start = offsets[i];
+		end = offsets[i+1] - HUFFBENCH_PAD;
+		for ( treeBit = tableBit = 0 ; treeBit < ( end - start ) * 8 ; ) {
+			Huff_offsetReceive( msgHuff.decompressor.tree, &ch, data + start, &treeBit );
+			if ( Huff_tableReceive( &msgHuffTable, data + start, offsets[i+1] - start, &tableBit ) != ch
+				|| tableBit != treeBit ) {
+				mismatches++;
+				break;
+			}
+			if ( ch >= HMAX ) {
+				break;
+			}
+			symbols[numSymbols++] = ch;
+		}
+
+		Com_Memset( treeOut, 0xaa, MAX_MSGLEN + HUFFBENCH_PAD );
+		Com_Memset( tableOut, 0xaa, MAX_MSGLEN + HUFFBENCH_PAD );
+		treeBit = tableBit = 0;
+		for ( j = symbolStart[i] ; j < numSymbols ; j++ ) {
+			Huff_offsetTransmit( &msgHuff.compressor, symbols[j], treeOut, &treeBit );
+			Huff_tableTransmit( &msgHuffTable, symbols[j], tableOut, &tableBit );
+		}
+		if ( tableBit != treeBit || memcmp( treeOut, tableOut, MAX_MSGLEN + HUFFBENCH_PAD ) ) {
+			mismatches++;
+		}
+	}
+	symbolStart[numPackets] = numSymbols;
+
+	Com_Memset( msec, 0, sizeof( msec ) );
+	check = 0;
+	for ( round = 0 ; round < HUFFBENCH_ROUNDS ; round++ ) {
+		start = Sys_Milliseconds();
+		for ( i = 0 ; i < numPackets ; i++ ) {
+			for ( j = symbolStart[i], bit = 0 ; j < symbolStart[i+1] ; j++ ) {
+				Huff_offsetReceive( msgHuff.decompressor.tree, &ch, data + offsets[i], &bit );
+				check += ch;
+			}
+		}
+		msec[0] += Sys_Milliseconds() - start;
+
+		start = Sys_Milliseconds();
+		for ( i = 0 ; i < numPackets ; i++ ) {
+			for ( j = symbolStart[i], bit = 0 ; j < symbolStart[i+1] ; j++ ) {
+				check -= Huff_tableReceive( &msgHuffTable, data + offsets[i], offsets[i+1] - offsets[i], &bit );
+			}
+		}
+		msec[1] += Sys_Milliseconds() - start;
+
+		start = Sys_Milliseconds();
+		for ( i = 0 ; i < numPackets ; i++ ) {
+			for ( j = symbolStart[i], bit = 0 ; j < symbolStart[i+1] ; j++ ) {
+				Huff_offsetTransmit( &msgHuff.compressor, symbols[j], treeOut, &bit );
+			}
+		}
+		msec[2] += Sys_Milliseconds() - start;
+
+		start = Sys_Milliseconds();
+		for ( i = 0 ; i < numPackets ; i++ ) {
+			for ( j = symbolStart[i], bit = 0 ; j < symbolStart[i+1] ; j++ ) {
+				Huff_tableTransmit( &msgHuffTable, symbols[j], tableOut, &bit );
+			}
+		}
+		msec[3] += Sys_Milliseconds() - start;
+	}
+	if ( check ) {
+		mismatches++;
+	}
+
+	Com_Printf( "%i packets, %i bytes, %i symbols, %i rounds\n", numPackets, numBytes, numSymbols, HUFFBENCH_ROUNDS );
+	Com_Printf( "decode: %5i msec tree, %5i msec table (%.2fx)\n", msec[0], msec[1], msec[1] ? msec[0] / (float)msec[1] : 0.0f );
+	Com_Printf( "encode: %5i msec tree, %5i msec table (%.2fx)\n", msec[2], msec[3], msec[3] ? msec[2] / (float)msec[3] : 0.0f );
+	if ( mismatches ) {
+		Com_Printf( S_COLOR_RED "FAILED: %i packets came out differently\n", mismatches );
+	}
+
+	Hunk_FreeTempMemory( tableOut );
+	Hunk_FreeTempMemory( treeOut );
+	Hunk_FreeTempMemory( symbolStart );
+	Hunk_FreeTempMemory( symbols );
+	Hunk_FreeTempMemory( offsets );
+	Hunk_FreeTempMemory( data );
+}
+
+/*
+==============================================================================
+
+			DELTA TESTS
+
+The batched delta writers must put the same bits on the wire as the
+reference, and read back to the state they were given
+==============================================================================
+*/
+
+#define	DELTATEST_STATES		2000
+#define	DELTATEST_BUFFER		( MAX_MSGLEN / 4 )
+
+#define	DELTABENCH_SNAPSHOTS	1024
+#define	DELTABENCH_ENTITIES		16384
+#define	DELTABENCH_ROUNDS		20
+#define	DELTABENCH_SYNTH_FRAMES	96
+#define	DELTABENCH_SYNTH_ENTS	160
+
+/*
+=================
+MSG_DeltaRandomField
+
+Gives a random field a value that survives the trip, so no -0 or NaN
+floats and nothing wider than the field
+=================
+*/
+static void MSG_DeltaRandomField( void *state, netField_t *fields, int numFields, int *seed ) {
+	netField_t	*field;
+	floatint_t	fi;
+	int			bits, value;
+
+	field = &fields[MSG_HuffRand( seed ) % numFields];
+	value = Q_rand( seed );
+
+	if ( field->bits == 0 ) {
+		switch ( MSG_HuffRand( seed ) & 3 ) {
+		case 0:
+			fi.f = 0.0f;
+			break;
+		case 1:
+			// either side of the small integer range
+			fi.f = (float)( MSG_HuffRand( seed ) % ( 2 << FLOAT_INT_BITS ) - ( 1 << FLOAT_INT_BITS ) );
+			break;
+		case 2:
+			fi.f = ( MSG_HuffRand( seed ) - 32768 ) / 64.0f;
+			break;
+		default:
+			fi.f = (float)value;
+			break;
+		}
+		value = fi.i;
+	} else {
+		bits = abs( field->bits );
+		if ( bits != 32 ) {
+			value &= ( 1 << bits ) - 1;
+			if ( field->bits < 0 && ( value & ( 1 << ( bits - 1 ) ) ) ) {
+				value |= ~( ( 1 << bits ) - 1 );
+			}
+		}
+	}
+	*(int *)( (byte *)state + field->offset ) = value;
+}
+
+/*
+=================
+MSG_DeltaRandomArrays
+
+Changes an element of one of the playerState_t arrays
+=================
+*/
+static void MSG_DeltaRandomArrays( playerState_t *ps, int *seed ) {
+	int		r;
+
+	r = MSG_HuffRand( seed );
+	switch ( r % 12 ) {
+	case 0:		ps->stats[r % MAX_STATS] = (short)Q_rand( seed ); break;
+	case 1:		ps->lockonData[r % MAX_LOCKED_STATS] = (short)Q_rand( seed ); break;
+	case 2:		ps->persistant[r % MAX_PERSISTANT] = (short)Q_rand( seed ); break;
+	case 3:		ps->currentSkill[r % MAX_WEAPONS] = (short)Q_rand( seed ); break;
+	case 4:		ps->powerups[r % MAX_POWERUPS] = (short)Q_rand( seed ); break;
+	case 5:		ps->timers[r % MAX_TIMERS] = (short)Q_rand( seed ); break;
+	case 6:		ps->cooldownTimers[r % MAX_COOLDOWN] = (short)Q_rand( seed ); break;
+	case 7:		ps->sequenceTimers[r % MAX_SEQUENCE] = (short)Q_rand( seed ); break;
+	case 8:		ps->measureTimers[r % MAX_MEASURES] = (short)Q_rand( seed ); break;
+	case 9:		ps->powerLevel[r % MAX_POWERSTATS] = (short)Q_rand( seed ); break;
+	case 10:	ps->baseStats[r % MAX_BASESTATS] = ( MSG_HuffRand( seed ) - 32768 ) / 16.0f; break;
+	default:	ps->buffers[r % MAX_RBUFFERS] = ( MSG_HuffRand( seed ) - 32768 ) / 16.0f; break;
+	}
+}
+
+/*
+=================
+MSG_DeltaSame
+
+Whether two messages hold the same bits, and would go out the same
+=================
+*/
+static qboolean MSG_DeltaSame( msg_t *a, msg_t *b ) {
+	return a->bit == b->bit && a->cursize == b->cursize && a->overflowed == b->overflowed
+		&& !memcmp( a->data, b->data, a->cursize );
+}
+
+/*
+=================
+MSG_DeltaTestEntity
+
+Writes a delta both ways, and reads it back when it fits
+=================
+*/
+static qboolean MSG_DeltaTestEntity( entityState_t *from, entityState_t *to, qboolean force,
+									 int prefix, int maxsize, byte *data[2] ) {
+	msg_t			msg[2];
+	entityState_t	out;
+	int				i, number;
+
+	for ( i = 0 ; i < 2 ; i++ ) {
+		Com_Memset( data[i], 0xaa, DELTATEST_BUFFER );
+		MSG_Init( &msg[i], data[i], maxsize );
+		MSG_WriteBits( &msg[i], prefix, 1 + prefix % 7 );
+		msgDeltaReference = ( i == 1 );
+		MSG_WriteDeltaEntity( &msg[i], from, to, force );
+	}
+	msgDeltaReference = qfalse;
+
+	if ( !MSG_DeltaSame( &msg[0], &msg[1] ) ) {
+		return qfalse;
+	}
+	if ( msg[0].overflowed || msg[0].bit == 1 + prefix % 7 ) {
+		return qtrue;
+	}
+
+	MSG_BeginReading( &msg[0] );
+	MSG_ReadBits( &msg[0], 1 + prefix % 7 );
+	number = MSG_ReadBits( &msg[0], GENTITYNUM_BITS );
+	MSG_ReadDeltaEntity( &msg[0], from, &out, number );
+	if ( !to ) {
+		return out.number == MAX_GENTITIES - 1;
+	}
+	return !memcmp( &out, to, sizeof( out ) );
+}
+
+/*
+=================
+MSG_DeltaTestPlayer
+=================
+*/
+static qboolean MSG_DeltaTestPlayer( playerState_t *from, playerState_t *to, int prefix, int maxsize, byte *data[2] ) {
+	msg_t			msg[2];
+	playerState_t	out;
+	int				i;
+
+	for ( i = 0 ; i < 2 ; i++ ) {
+		Com_Memset( data[i], 0xaa, DELTATEST_BUFFER );
+		MSG_Init( &msg[i], data[i], maxsize );
+		MSG_WriteBits( &msg[i], prefix, 1 + prefix % 7 );
+		msgDeltaReference = ( i == 1 );
+		MSG_WriteDeltaPlayerstate( &msg[i], from, to );
+	}
+	msgDeltaReference = qfalse;
+
+	if ( !MSG_DeltaSame( &msg[0], &msg[1] ) ) {
+		return qfalse;
+	}
+	if ( msg[0].overflowed ) {
+		return qtrue;
+	}
+
+	MSG_BeginReading( &msg[0] );
+	MSG_ReadBits( &msg[0], 1 + prefix % 7 );
+	MSG_ReadDeltaPlayerstate( &msg[0], from, &out );
+	return !memcmp( &out, to, sizeof( out ) );
+}
+
+/*
+=================
+MSG_DeltaTest_f
+
+Deltas random states both ways, some into messages too small for
+them, and checks the bits match and read back to the same state
+=================
+*/
+void MSG_DeltaTest_f( void ) {
+	entityState_t	*entFrom, *entTo;
+	playerState_t	*psFrom, *psTo;
+	byte			*data[2];
+	int				startSeed, seed, i, j, changes, prefix, maxsize;
+	int				entFailed, psFailed;
+	qboolean		force;
+
+	if ( !msgInit ) {
+		MSG_initHuffman();
+	}
+	// the readers log through it, and dedicated servers don't have one
+	if ( !cl_shownet ) {
+		cl_shownet = Cvar_Get( "cl_shownet", "0", CVAR_TEMP );
+	}
+
+	startSeed = seed = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : Sys_Milliseconds();
+	entFrom = Z_Malloc( sizeof( *entFrom ) * 2 );
+	entTo = entFrom + 1;
+	psFrom = Z_Malloc( sizeof( *psFrom ) * 2 );
+	psTo = psFrom + 1;
+	data[0] = Z_Malloc( DELTATEST_BUFFER );
+	data[1] = Z_Malloc( DELTATEST_BUFFER );
+
+	entFailed = psFailed = 0;
+	for ( i = 0 ; i < DELTATEST_STATES ; i++ ) {
+		prefix = MSG_HuffRand( &seed );
+		// every so often, overflow somewhere in the middle
+		maxsize = ( i & 7 ) ? DELTATEST_BUFFER / 2 : 8 + MSG_HuffRand( &seed ) % 256;
+
+		Com_Memset( entFrom, 0, sizeof( *entFrom ) );
+		for ( j = 0 ; j < 40 ; j++ ) {
+			MSG_DeltaRandomField( entFrom, entityStateFields, ARRAY_LEN( entityStateFields ), &seed );
+		}
+		entFrom->number = MSG_HuffRand( &seed ) % ( MAX_GENTITIES - 1 );
+		*entTo = *entFrom;
+		changes = ( i & 15 ) ? MSG_HuffRand( &seed ) % 8 : 200;
+		for ( j = 0 ; j < changes ; j++ ) {
+			MSG_DeltaRandomField( entTo, entityStateFields, ARRAY_LEN( entityStateFields ), &seed );
+		}
+		force = MSG_HuffRand( &seed ) & 1;
+
+		if ( !MSG_DeltaTestEntity( entFrom, ( i % 10 ) ? entTo : NULL, force, prefix, maxsize, data ) ) {
+			if ( entFailed++ < 5 ) {
+				Com_Printf( "FAILED: entity delta %i with %i changes\n", i, changes );
+			}
+		}
+
+		Com_Memset( psFrom, 0, sizeof( *psFrom ) );
+		for ( j = 0 ; j < 40 ; j++ ) {
+			MSG_DeltaRandomField( psFrom, playerStateFields, ARRAY_LEN( playerStateFields ), &seed );
+			MSG_DeltaRandomArrays( psFrom, &seed );
+		}
+		*psTo = *psFrom;
+		for ( j = 0 ; j < changes ; j++ ) {
+			MSG_DeltaRandomField( psTo, playerStateFields, ARRAY_LEN( playerStateFields ), &seed );
+			if ( j & 1 ) {
+				MSG_DeltaRandomArrays( psTo, &seed );
+			}
+		}
+
+		if ( !MSG_DeltaTestPlayer( ( i % 10 ) ? psFrom : NULL, ( i % 10 ) ? psTo : psFrom, prefix, maxsize, data ) ) {
+			if ( psFailed++ < 5 ) {
+				Com_Printf( "FAILED: playerstate delta %i with %i changes\n", i, changes );
+			}
+		}
+	}
+
+	Com_Printf( "%i of %i entity and %i of %i playerstate deltas matched and round tripped (seed %i)\n",
+		DELTATEST_STATES - entFailed, DELTATEST_STATES, DELTATEST_STATES - psFailed, DELTATEST_STATES, startSeed );
+
+	Z_Free( data[1] );
+	Z_Free( data[0] );
+	Z_Free( psFrom );
+	Z_Free( entFrom );
+}
+
+typedef struct {
+	int				messageNum;
+	int				base;			// the snapshot this one is a delta from, or -1
+	int				firstEntity;
+	int				numEntities;
+	int				startBit;		// where the recording has the playerstate and entities
+	int				endBit;
+	playerState_t	ps;
+} deltaSnapshot_t;
+
+typedef struct {
+	deltaSnapshot_t	*snapshots;
+	int				numSnapshots;
+	entityState_t	*entities;
+	int				numEntities;
+	entityState_t	*baselines;
+	int				recent[PACKET_BACKUP];	// snapshot of each message, or -1
+	byte			*scratch;
+	int				recorded;		// re-encoded to the bits in the recording
+	int				compared;
+} deltaBench_t;
+
+/*
+=================
+MSG_DeltaBenchEncode
+
+The playerstate and entities of a snapshot, as SV_WriteSnapshotToClient
+and SV_EmitPacketEntities write them
+=================
+*/
+static void MSG_DeltaBenchEncode( deltaBench_t *bench, deltaSnapshot_t *snap, msg_t *msg ) {
+	deltaSnapshot_t	*old;
+	entityState_t	*oldent, *newent;
+	int				oldindex, newindex, oldnum, newnum, oldCount;
+
+	old = snap->base >= 0 ? &bench->snapshots[snap->base] : NULL;
+	oldCount = old ? old->numEntities : 0;
+
+	MSG_WriteDeltaPlayerstate( msg, old ? &old->ps : NULL, &snap->ps );
+
+	oldent = newent = NULL;
+	oldindex = newindex = 0;
+	while ( newindex < snap->numEntities || oldindex < oldCount ) {
+		if ( newindex >= snap->numEntities ) {
+			newnum = 9999;
+		} else {
+			newent = &bench->entities[snap->firstEntity + newindex];
+			newnum = newent->number;
+		}
+		if ( oldindex >= oldCount ) {
+			oldnum = 9999;
+		} else {
+			oldent = &bench->entities[old->firstEntity + oldindex];
+			oldnum = oldent->number;
+		}
+
+		if ( newnum == oldnum ) {
+			MSG_WriteDeltaEntity( msg, oldent, newent, qfalse );
+			oldindex++;
+			newindex++;
+		} else if ( newnum < oldnum ) {
+			MSG_WriteDeltaEntity( msg, &bench->baselines[newnum], newent, qtrue );
+			newindex++;
+		} else {
+			MSG_WriteDeltaEntity( msg, oldent, NULL, qtrue );
+			oldindex++;
+		}
+	}
+
+	MSG_WriteBits( msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );
+}
+
+/*
+=================
+MSG_DeltaBenchEntity
+
+Adds an entity to the snapshot being parsed, read from the message
+or copied over when msg is NULL
+=================
+*/
+static void MSG_DeltaBenchEntity( deltaBench_t *bench, deltaSnapshot_t *snap, msg_t *msg, int number, entityState_t *from ) {
+	entityState_t	*state;
+
+	state = &bench->entities[bench->numEntities];
+	if ( msg ) {
+		MSG_ReadDeltaEntity( msg, from, state, number );
+	} else {
+		*state = *from;
+	}
+	if ( state->number == MAX_GENTITIES - 1 ) {
+		return;		// removed
+	}
+	bench->numEntities++;
+	snap->numEntities++;
+}
+
+/*
+=================
+MSG_DeltaBenchSnapshot
+
+Parses a recorded snapshot as CL_ParseSnapshot does, then writes it
+again to see that it comes out as it was recorded
+=================
+*/
+static qboolean MSG_DeltaBenchSnapshot( deltaBench_t *bench, msg_t *msg, int messageNum ) {
+	deltaSnapshot_t	*snap, *old;
+	byte			areamask[MAX_MAP_AREA_BYTES];
+	msg_t			scratch;
+	int				deltaNum, len, index, oldindex, oldnum, newnum;
+
+	if ( bench->numSnapshots == DELTABENCH_SNAPSHOTS || bench->numEntities + MAX_GENTITIES > DELTABENCH_ENTITIES ) {
+		return qfalse;
+	}
+	snap = &bench->snapshots[bench->numSnapshots];
+	snap->messageNum = messageNum;
+
+	MSG_ReadLong( msg );		// server time
+	deltaNum = MSG_ReadByte( msg );
+	MSG_ReadByte( msg );		// snap flags
+
+	old = NULL;
+	snap->base = -1;
+	if ( deltaNum ) {
+		index = bench->recent[( messageNum - deltaNum ) & PACKET_MASK];
+		if ( index < 0 || bench->snapshots[index].messageNum != messageNum - deltaNum ) {
+			return qfalse;		// the rest of the message can't be followed
+		}
+		old = &bench->snapshots[index];
+		snap->base = index;
+	}
+
+	len = MSG_ReadByte( msg );
+	if ( len > sizeof( areamask ) ) {
+		return qfalse;
+	}
+	MSG_ReadData( msg, areamask, len );
+
+	snap->startBit = msg->bit;
+	MSG_ReadDeltaPlayerstate( msg, old ? &old->ps : NULL, &snap->ps );
+
+	// as CL_ParsePacketEntities
+	snap->firstEntity = bench->numEntities;
+	snap->numEntities = 0;
+	oldindex = 0;
+	oldnum = ( old && old->numEntities ) ? bench->entities[old->firstEntity].number : 99999;
+	while ( 1 ) {
+		newnum = MSG_ReadBits( msg, GENTITYNUM_BITS );
+		if ( newnum == MAX_GENTITIES - 1 ) {
+			break;
+		}
+		if ( msg->readcount > msg->cursize ) {
+			return qfalse;
+		}
+
+		while ( oldnum < newnum ) {
+			MSG_DeltaBenchEntity( bench, snap, NULL, oldnum, &bench->entities[old->firstEntity + oldindex] );
+			oldindex++;
+			oldnum = oldindex < old->numEntities ? bench->entities[old->firstEntity + oldindex].number : 99999;
+		}
+		if ( oldnum == newnum ) {
+			MSG_DeltaBenchEntity( bench, snap, msg, newnum, &bench->entities[old->firstEntity + oldindex] );
+			oldindex++;
+			oldnum = oldindex < old->numEntities ? bench->entities[old->firstEntity + oldindex].number : 99999;
+		} else {
+			MSG_DeltaBenchEntity( bench, snap, msg, newnum, &bench->baselines[newnum] );
+		}
+	}
+	while ( oldnum != 99999 ) {
+		MSG_DeltaBenchEntity( bench, snap, NULL, oldnum, &bench->entities[old->firstEntity + oldindex] );
+		oldindex++;
+		oldnum = oldindex < old->numEntities ? bench->entities[old->firstEntity + oldindex].number : 99999;
+	}
+	snap->endBit = msg->bit;
+
+	bench->recent[messageNum & PACKET_MASK] = bench->numSnapshots;
+	bench->numSnapshots++;
+
+	// write it again over the same bits
+	Com_Memcpy( bench->scratch, msg->data, ( snap->startBit >> 3 ) + 1 );
+	MSG_Init( &scratch, bench->scratch, MAX_MSGLEN );
+	scratch.bit = snap->startBit;
+	scratch.cursize = ( snap->startBit >> 3 ) + 1;
+	MSG_DeltaBenchEncode( bench, snap, &scratch );
+
+	bench->compared++;
+	if ( scratch.bit == snap->endBit ) {
+		for ( len = snap->startBit ; len < snap->endBit ; len++ ) {
+			if ( ( ( scratch.data[len >> 3] ^ msg->data[len >> 3] ) >> ( len & 7 ) ) & 1 ) {
+				break;
+			}
+		}
+		if ( len == snap->endBit ) {
+			bench->recorded++;
+		}
+	}
+	return qtrue;
+}
+
+/*
+=================
+MSG_DeltaBenchGamestate
+
+Keeps the baselines of a recorded gamestate, as CL_ParseGamestate
+=================
+*/
+static qboolean MSG_DeltaBenchGamestate( deltaBench_t *bench, msg_t *msg ) {
+	entityState_t	nullstate;
+	int				i, cmd, newnum;
+
+	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+	MSG_ReadLong( msg );		// server command sequence
+	while ( 1 ) {
+		cmd = MSG_ReadByte( msg );
+		if ( cmd == svc_EOF ) {
+			break;
+		}
+		if ( msg->readcount > msg->cursize ) {
+			return qfalse;
+		}
+		if ( cmd == svc_configstring ) {
+			MSG_ReadShort( msg );
+			MSG_ReadBigString( msg );
+		} else if ( cmd == svc_baseline ) {
+			newnum = MSG_ReadBits( msg, GENTITYNUM_BITS );
+			if ( newnum < 0 || newnum >= MAX_GENTITIES ) {
+				return qfalse;
+			}
+			MSG_ReadDeltaEntity( msg, &nullstate, &bench->baselines[newnum], newnum );
+		} else {
+			return qfalse;
+		}
+	}
+	MSG_ReadLong( msg );		// client number
+	MSG_ReadLong( msg );		// checksum feed
+
+	for ( i = 0 ; i < PACKET_BACKUP ; i++ ) {
+		bench->recent[i] = -1;
+	}
+	return qtrue;
+}
+
+/*
+=================
+MSG_DeltaBenchAddDemo
+
+Collects the snapshots of a demo, until there is no more room
+=================
+*/
+static void MSG_DeltaBenchAddDemo( deltaBench_t *bench, const char *name ) {
+	fileHandle_t	f;
+	msg_t			msg;
+	byte			*data;
+	int				header[2], cmd;
+
+	FS_FOpenFileRead( name, &f, qtrue );
+	if ( !f ) {
+		Com_Printf( "Couldn't open %s\n", name );
+		return;
+	}
+
+	data = Z_Malloc( MAX_MSGLEN );
+	Com_Memset( bench->baselines, 0, MAX_GENTITIES * sizeof( *bench->baselines ) );
+	for ( cmd = 0 ; cmd < PACKET_BACKUP ; cmd++ ) {
+		bench->recent[cmd] = -1;
+	}
+
+	while ( FS_Read( header, sizeof( header ), f ) == sizeof( header ) ) {
+		MSG_Init( &msg, data, MAX_MSGLEN );
+		msg.cursize = LittleLong( header[1] );
+		if ( msg.cursize <= 0 || msg.cursize > MAX_MSGLEN || FS_Read( data, msg.cursize, f ) != msg.cursize ) {
+			break;
+		}
+
+		// as CL_ParseServerMessage, leaving out what doesn't touch snapshots
+		MSG_Bitstream( &msg );
+		MSG_ReadLong( &msg );		// reliable acknowledge
+		while ( msg.readcount <= msg.cursize ) {
+			cmd = MSG_ReadByte( &msg );
+			if ( cmd == svc_EOF ) {
+				break;
+			} else if ( cmd == svc_serverCommand ) {
+				MSG_ReadLong( &msg );
+				MSG_ReadString( &msg );
+			} else if ( cmd == svc_gamestate ) {
+				if ( !MSG_DeltaBenchGamestate( bench, &msg ) ) {
+					break;
+				}
+			} else if ( cmd == svc_snapshot ) {
+				if ( !MSG_DeltaBenchSnapshot( bench, &msg, LittleLong( header[0] ) ) ) {
+					break;
+				}
+			} else if ( cmd != svc_nop ) {
+				break;		// downloads and voip
+			}
+		}
+		if ( bench->numSnapshots == DELTABENCH_SNAPSHOTS ) {
+			break;
+		}
+	}
+
+	Z_Free( data );
+	FS_FCloseFile( f );
+}
+
+/*
+=================
+MSG_DeltaBenchSynthetic
+
+A server's worth of entities moving about, coming and going, for
+when there are no demos to read
+=================
+*/
+static void MSG_DeltaBenchSynthetic( deltaBench_t *bench ) {
+	entityState_t	*current;
+	deltaSnapshot_t	*snap;
+	qboolean		present[DELTABENCH_SYNTH_ENTS];
+	int				seed, i, j, n;
+
+	current = Z_Malloc( DELTABENCH_SYNTH_ENTS * sizeof( *current ) );
+	seed = 0;
+
+	for ( i = 0 ; i < DELTABENCH_SYNTH_ENTS ; i++ ) {
+		Com_Memset( &bench->baselines[i], 0, sizeof( bench->baselines[i] ) );
+		for ( j = 0 ; j < 8 ; j++ ) {
+			MSG_DeltaRandomField( &bench->baselines[i], entityStateFields, ARRAY_LEN( entityStateFields ), &seed );
+		}
+		bench->baselines[i].number = i;
+		present[i] = qfalse;
+	}
+
+	for ( i = 0 ; i < DELTABENCH_SYNTH_FRAMES ; i++ ) {
+		snap = &bench->snapshots[bench->numSnapshots];
+		snap->messageNum = i;
+		snap->base = i - 1;
+		snap->startBit = snap->endBit = 0;
+		if ( i ) {
+			snap->ps = snap[-1].ps;
+		} else {
+			Com_Memset( &snap->ps, 0, sizeof( snap->ps ) );
+		}
+		for ( j = MSG_HuffRand( &seed ) % 8 ; j >= 0 ; j-- ) {
+			MSG_DeltaRandomField( &snap->ps, playerStateFields, ARRAY_LEN( playerStateFields ), &seed );
+		}
+		if ( MSG_HuffRand( &seed ) & 1 ) {
+			MSG_DeltaRandomArrays( &snap->ps, &seed );
+		}
+
+		snap->firstEntity = bench->numEntities;
+		snap->numEntities = 0;
+		for ( n = 0 ; n < DELTABENCH_SYNTH_ENTS ; n++ ) {
+			if ( !present[n] ) {
+				if ( MSG_HuffRand( &seed ) % 100 >= 90 ) {
+					continue;
+				}
+				present[n] = qtrue;
+				current[n] = bench->baselines[n];
+			} else if ( MSG_HuffRand( &seed ) % 100 < 2 ) {
+				present[n] = qfalse;
+				continue;
+			}
+			if ( MSG_HuffRand( &seed ) % 100 < 30 ) {
+				for ( j = 1 + MSG_HuffRand( &seed ) % 4 ; j > 0 ; j-- ) {
+					MSG_DeltaRandomField( &current[n], entityStateFields, ARRAY_LEN( entityStateFields ), &seed );
+				}
+			}
+			bench->entities[bench->numEntities++] = current[n];
+			snap->numEntities++;
+		}
+		bench->numSnapshots++;
+	}
+
+	Z_Free( current );
+}
+
+/*
+=================
+MSG_DeltaBench_f
+
+Writes the playerstate and entity deltas of every snapshot in the given
+demos, or in all the demos when none are given, the reference way and
+the batched way, as the server would for one client
+=================
+*/
+void MSG_DeltaBench_f( void ) {
+	deltaBench_t	bench;
+	msg_t			msg[2];
+	byte			*data[2];
+	char			**demos;
+	int				numDemos, i, round, mode, start, bytes, mismatches;
+	int				msec[2];
+
+	if ( !msgInit ) {
+		MSG_initHuffman();
+	}
+	if ( !cl_shownet ) {
+		cl_shownet = Cvar_Get( "cl_shownet", "0", CVAR_TEMP );
+	}
+
+	Com_Memset( &bench, 0, sizeof( bench ) );
+	bench.snapshots = Hunk_AllocateTempMemory( DELTABENCH_SNAPSHOTS * sizeof( *bench.snapshots ) );
+	bench.entities = Hunk_AllocateTempMemory( DELTABENCH_ENTITIES * sizeof( *bench.entities ) );
+	bench.baselines = Hunk_AllocateTempMemory( MAX_GENTITIES * sizeof( *bench.baselines ) );
+	bench.scratch = Hunk_AllocateTempMemory( MAX_MSGLEN );
+	data[0] = Hunk_AllocateTempMemory( MAX_MSGLEN );
+	data[1] = Hunk_AllocateTempMemory( MAX_MSGLEN );
+
+	// each demo starts with a gamestate of its own, so only the
+	// last one's baselines are kept and deltas can't cross demos
+	if ( Cmd_Argc() > 1 ) {
+		for ( i = 1 ; i < Cmd_Argc() && !bench.numSnapshots ; i++ ) {
+			MSG_DeltaBenchAddDemo( &bench, va( "demos/%s", Cmd_Argv( i ) ) );
+		}
+	} else {
+		demos = FS_ListFiles( "demos", "", &numDemos );
+		for ( i = 0 ; i < numDemos && !bench.numSnapshots ; i++ ) {
+			if ( strstr( demos[i], "." DEMOEXT ) ) {
+				MSG_DeltaBenchAddDemo( &bench, va( "demos/%s", demos[i] ) );
+			}
+		}
+		FS_FreeFileList( demos );
+	}
+	if ( !bench.numSnapshots ) {
+		Com_Printf( "No demo snapshots, using synthetic ones\n" );
+		MSG_DeltaBenchSynthetic( &bench );
+	}
+
+	// both ways must agree on every bit
+	bytes = mismatches = 0;
+	for ( i = 0 ; i < bench.numSnapshots ; i++ ) {
+		for ( mode = 0 ; mode < 2 ; mode++ ) {
+			MSG_Init( &msg[mode], data[mode], MAX_MSGLEN );
+			msgDeltaReference = ( mode == 0 );
+			MSG_DeltaBenchEncode( &bench, &bench.snapshots[i], &msg[mode] );
+		}
+		msgDeltaReference = qfalse;
+		if ( !MSG_DeltaSame( &msg[0], &msg[1] ) ) {
+			mismatches++;
+		}
+		bytes += msg[1].cursize;
+	}
+
+	msec[0] = msec[1] = 0;
+	for ( round = 0 ; round < DELTABENCH_ROUNDS ; round++ ) {
+		for ( mode = 0 ; mode < 2 ; mode++ ) {
+			msgDeltaReference = ( mode == 0 );
+			start = Sys_Milliseconds();
+			for ( i = 0 ; i < bench.numSnapshots ; i++ ) {
+				MSG_Init( &msg[mode], data[mode], MAX_MSGLEN );
+				MSG_DeltaBenchEncode( &bench, &bench.snapshots[i], &msg[mode] );
+			}
+			msec[mode] += Sys_Milliseconds() - start;
+		}
+	}
+	msgDeltaReference = qfalse;
+
+	Com_Printf( "%i snapshots, %.1f entities and %i bytes each, %i rounds\n", bench.numSnapshots,
+		bench.numEntities / (float)bench.numSnapshots, bytes / bench.numSnapshots, DELTABENCH_ROUNDS );
+	Com_Printf( "reference: %5i msec, %.2f usec a client snapshot\n", msec[0],
+		msec[0] * 1000.0f / ( bench.numSnapshots * DELTABENCH_ROUNDS ) );
+	Com_Printf( "batched:   %5i msec, %.2f usec a client snapshot (%.2fx)\n", msec[1],
+		msec[1] * 1000.0f / ( bench.numSnapshots * DELTABENCH_ROUNDS ), msec[1] ? msec[0] / (float)msec[1] : 0.0f );
+	if ( bench.compared ) {
+		Com_Printf( "%i of %i snapshots wrote the same bits as the recording\n", bench.recorded, bench.compared );
+	}
+	if ( mismatches ) {
+		Com_Printf( S_COLOR_RED "FAILED: %i snapshots written differently\n", mismatches );
+	}
+
+	Hunk_FreeTempMemory( data[1] );
+	Hunk_FreeTempMemory( data[0] );
+	Hunk_FreeTempMemory( bench.scratch );
+	Hunk_FreeTempMemory( bench.baselines );
+	Hunk_FreeTempMemory( bench.entities );
+	Hunk_FreeTempMemory( bench.snapshots );
+}
@@ -111,6 +111,10 @@ void MSG_ReadDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct pl
 
 
 void MSG_ReportChangeVectors_f( void );
+void MSG_HuffTest_f( void );
+void MSG_HuffBench_f( void );
+void MSG_DeltaTest_f( void );
+void MSG_DeltaBench_f( void );
 
 //============================================================================
 
@@ -352,6 +356,7 @@ void	VM_Clear(void);
 void	VM_Forced_Unload_Start(void);
 void	VM_Forced_Unload_Done(void);
 vm_t	*VM_Restart(vm_t *vm, qboolean unpure);
+qboolean	VM_IsNative( vm_t *vm );
 
 intptr_t		QDECL VM_Call( vm_t *vm, int callNum, ... );
 
@@ -608,6 +613,10 @@ char	**FS_ListFiles( const char *directory, const char *extension, int *numfiles
 // if extension is "/", only subdirectories will be returned
 // the returned files will not include any directories or /
 
+char	**FS_ListPakFiles( const char *pakName, const char *extension, int *numfiles );
+// pakName is the pk3 without path or extension, the returned names
+// are full paths inside it
+
 void	FS_FreeFileList( char **list );
 
 qboolean FS_FileExists( const char *file );
@@ -642,6 +651,10 @@ long		FS_FOpenFileRead( const char *qpath, fileHandle_t *file, qboolean uniqueFI
 int		FS_FileIsInPAK(const char *filename, int *pChecksum );
 // returns 1 if a file is in the PAK file, otherwise -1
 
+int		FS_PakFileCRC( const char *qpath, int *crc );
+// returns 1 and the crc32 of the pk3 entry the file would be read from,
+// 0 if it would be read from a directory, -1 if it doesn't exist
+
 int		FS_Write( const void *buffer, int len, fileHandle_t f );
 
 int		FS_Read2( void *buffer, int len, fileHandle_t f );
@@ -666,6 +679,18 @@ void	FS_ForceFlush( fileHandle_t f );
 void	FS_FreeFile( void *buffer );
 // frees the memory returned by FS_ReadFile
 
+long	FS_ReadFileView( const char *qpath, void **buffer );
+// like FS_ReadFile, but large loose files and large files stored
+// uncompressed in a pk3 are mapped instead of copied to the hunk, so
+// there is no trailing 0.  Writes to the buffer stay private to it.
+
+void	FS_ReleaseView( void *buffer );
+// frees the buffer returned by FS_ReadFileView
+
+void	FS_ReleaseViews( void );
+// frees every buffer still held from FS_ReadFileView, used when
+// an error drop abandons a load before it released its views
+
 void	FS_WriteFile( const char *qpath, const void *buffer, int size );
 // writes a complete file, creating any subdirectories needed
 
@@ -714,6 +739,9 @@ void FS_PureServerSetLoadedPaks( const char *pakSums, const char *pakNames );
 // separated checksums will be checked for files, with the
 // sole exception of .cfg files.
 
+qboolean FS_PureServerActive( void );
+// qtrue while the loaded pk3s are restricted to a pure server's
+
 qboolean FS_CheckDirTraversal(const char *checkdir);
 qboolean FS_idPak(char *pak, char *base, int numPaks);
 qboolean FS_ComparePaks( char *neededpaks, int len, qboolean dlstring );
@@ -732,6 +760,53 @@ qboolean FS_Which(const char *filename, void *searchPath);
 /*
 ==============================================================
 
+JOBS
+
+Jobs are run by the com_jobThreads worker threads and by any
+thread waiting on a counter. A job must not touch anything
+another job of the same batch may be writing, and must not
+call into the VMs.  The zone allocator is locked, so jobs may
+use Z_Malloc and Z_Free.
+==============================================================
+*/
+
+#define	MAX_JOB_THREADS		16
+
+typedef void (*jobFunc_t)( void *data, int index );
+
+typedef struct {
+	volatile int	value;		// number of unfinished jobs, clear to 0 before use
+} jobCounter_t;
+
+void Job_Init( void );
+void Job_Shutdown( void );
+
+int Job_NumThreads( void );
+// number of worker threads, not counting the ones waiting on counters
+
+void Job_Add( jobFunc_t function, void *data, int index, jobCounter_t *counter, jobCounter_t *waitFor );
+// queues function( data, index ), increasing counter until it is done.
+// If waitFor is given, the job won't start before its count reaches zero,
+// so all the jobs waitFor counts must have been added before.
+
+void Job_Wait( jobCounter_t *counter );
+// runs queued jobs until the count reaches zero
+
+void Job_ParallelFor( jobFunc_t function, void *data, int count, int batch );
+// calls function( data, index ) for every index below count, batch
+// indexes per job, and returns when they are all done.  If batch is 0
+// the work is split into a few jobs per thread.
+
+void Job_Lock( volatile int *lock );
+void Job_Unlock( volatile int *lock );
+// spin lock around short critical sections, the int starts out 0
+
+void Job_MemoryBarrier( void );
+// full fence, for lock free queues between threads
+
+/*
+==============================================================
+
 Edit fields and command line history/completion
 
 ==============================================================
@@ -846,6 +921,7 @@ extern	cvar_t	*com_maxfpsUnfocused;
 extern	cvar_t	*com_minimized;
 extern	cvar_t	*com_maxfpsMinimized;
 extern	cvar_t	*com_altivec;
+extern	qboolean	com_haveSSE2;
 extern	cvar_t	*com_basegame;
 extern	cvar_t	*com_homepath;
 
@@ -1106,10 +1182,20 @@ char *Sys_ConsoleInput(void);
 
 char **Sys_ListFiles( const char *directory, const char *extension, char *filter, int *numfiles, qboolean wantsubs );
 void	Sys_FreeFileList( char **list );
+void	*Sys_MapFile( const char *path, long offset, long length, void **base, long *baseLength );
+void	Sys_UnmapFile( void *base, long baseLength );
 void	Sys_Sleep(int msec);
 
 qboolean Sys_LowPhysicalMemory( void );
 
+void	*Sys_CreateThread( void (*function)( void *arg ), void *arg );
+void	Sys_JoinThread( void *thread );
+void	*Sys_CreateSemaphore( void );
+void	Sys_DestroySemaphore( void *semaphore );
+void	Sys_SemaphoreWait( void *semaphore );
+void	Sys_SemaphorePost( void *semaphore );
+int		Sys_ProcessorCount( void );
+
 void Sys_SetEnv(const char *name, const char *value);
 
 typedef enum
@@ -1169,6 +1255,26 @@ typedef struct {
 	huff_t		decompressor;
 } huffman_t;
 
+/* A static tree can be flattened into tables: the encoder writes each
+ * code in one go, and the decoder resolves up to HUFF_LOOKUP_BITS bits
+ * with a single lookup, walking the tree only for the rare longer codes */
+
+#define HUFF_LOOKUP_BITS	11
+#define HUFF_LOOKUP_SIZE	(1<<HUFF_LOOKUP_BITS)
+
+typedef struct {
+	short		symbol;		/* INTERNAL_NODE when the code is longer than the lookup */
+	short		length;		/* bits consumed */
+} huffLookup_t;
+
+typedef struct {
+	huff_t*		huff;
+	unsigned	code[HMAX];				/* first bit sent in the lowest bit */
+	byte		length[HMAX];			/* 0 when the code doesn't fit in a word */
+	huffLookup_t	lookup[HUFF_LOOKUP_SIZE];	/* indexed by the next bits, first in the lowest bit */
+	node_t*		lookupNode[HUFF_LOOKUP_SIZE];	/* where a longer code carries on */
+} huffTable_t;
+
 void	Huff_Compress(msg_t *buf, int offset);
 void	Huff_Decompress(msg_t *buf, int offset);
 void	Huff_Init(huffman_t *huff);
@@ -1179,6 +1285,11 @@ void	Huff_offsetReceive (node_t *node, int *ch, byte *fin, int *offset);
 void	Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset);
 void	Huff_putBit( int bit, byte *fout, int *offset);
 int		Huff_getBit( byte *fout, int *offset);
+void	Huff_putBits( unsigned value, int bits, byte *fout, int *offset );
+int		Huff_getBits( const byte *fin, int size, int bits, int *offset );
+void	Huff_BuildTable( huffTable_t *table, huff_t *huff );
+void	Huff_tableTransmit( const huffTable_t *table, int ch, byte *fout, int *offset );
+int		Huff_tableReceive( const huffTable_t *table, const byte *fin, int size, int *offset );
 
 // don't use if you don't know what you're doing.
 int		Huff_getBloc(void);
@@ -346,6 +346,10 @@ extern uLong ZEXPORT unzGetOffset (unzFile file);
 /* Set the current file offset */
 extern int ZEXPORT unzSetOffset (unzFile file, uLong pos);
 
+/* Get the position of the opened current file's data in the zipfile,
+   0 if no file is opened */
+extern uLong ZEXPORT unzGetCurrentFileZStreamPos (unzFile file);
+
 
 
 #ifdef __cplusplus
@@ -135,6 +135,32 @@ vmSymbol_t *VM_ValueToFunctionSymbol( vm_t *vm, int value ) {
 }
 
 
+/*
+===============
+VM_ProfileFunction
+
+The profile counts of the function starting at this code offset
+===============
+*/
+vmProfileFunction_t *VM_ProfileFunction( vm_t *vm, int entry ) {
+	int		low, high, mid;
+
+	low = 0;
+	high = vm->numProfileFunctions - 1;
+	while ( low <= high ) {
+		mid = ( low + high ) >> 1;
+		if ( vm->profileFunctions[mid].entry < entry ) {
+			low = mid + 1;
+		} else if ( vm->profileFunctions[mid].entry > entry ) {
+			high = mid - 1;
+		} else {
+			return &vm->profileFunctions[mid];
+		}
+	}
+	return NULL;
+}
+
+
 /*
 ===============
 VM_SymbolToValue
@@ -707,6 +733,10 @@ void VM_Free( vm_t *vm ) {
 	if(vm->destroy)
 		vm->destroy(vm);
 
+	if ( vm->profileFunctions ) {
+		Z_Free( vm->profileFunctions );
+	}
+
 	if ( vm->dllHandle ) {
 		Sys_UnloadDll( vm->dllHandle );
 		Com_Memset( vm, 0, sizeof( *vm ) );
@@ -743,6 +773,17 @@ void VM_Forced_Unload_Done(void) {
 	forced_unload = 0;
 }
 
+/*
+==============
+VM_IsNative
+
+Only native modules can hand function pointers to the engine
+==============
+*/
+qboolean VM_IsNative( vm_t *vm ) {
+	return vm && vm->dllHandle;
+}
+
 void *VM_ArgPtr( intptr_t intValue ) {
 	if ( !intValue ) {
 		return NULL;
@@ -873,15 +914,15 @@ intptr_t QDECL VM_Call( vm_t *vm, int callnum, ... )
 //=================================================================
 
 static int QDECL VM_ProfileSort( const void *a, const void *b ) {
-	vmSymbol_t	*sa, *sb;
+	vmProfileFunction_t	*fa, *fb;
 
-	sa = *(vmSymbol_t **)a;
-	sb = *(vmSymbol_t **)b;
+	fa = *(vmProfileFunction_t **)a;
+	fb = *(vmProfileFunction_t **)b;
 
-	if ( sa->profileCount < sb->profileCount ) {
+	if ( fa->self < fb->self ) {
 		return -1;
 	}
-	if ( sa->profileCount > sb->profileCount ) {
+	if ( fa->self > fb->self ) {
 		return 1;
 	}
 	return 0;
@@ -889,51 +930,141 @@ static int QDECL VM_ProfileSort( const void *a, const void *b ) {
 
 /*
 ==============
-VM_VmProfile_f
+VM_ProfileStart
 
+Finds the functions of an interpreted vm and starts counting the
+instructions executed in them
 ==============
 */
-void VM_VmProfile_f( void ) {
-	vm_t		*vm;
-	vmSymbol_t	**sorted, *sym;
-	int			i;
-	double		total;
+static void VM_ProfileStart( vm_t *vm ) {
+	int		*codeBase;
+	int		i, count;
 
-	if ( !lastVM ) {
+	if ( vm->dllHandle || vm->compiled ) {
+		Com_Printf( "%s is %s, only interpreted vms can be profiled\n",
+			vm->name, vm->dllHandle ? "native" : "compiled" );
 		return;
 	}
 
-	vm = lastVM;
+	if ( !vm->profileFunctions ) {
+		// every function starts with an OP_ENTER
+		codeBase = (int *)vm->codeBase;
+		count = 0;
+		for ( i = 0 ; i < vm->instructionCount ; i++ ) {
+			if ( codeBase[vm->instructionPointers[i]] == OP_ENTER ) {
+				count++;
+			}
+		}
 
-	if ( !vm->numSymbols ) {
-		return;
+		vm->profileFunctions = Z_Malloc( count * sizeof( *vm->profileFunctions ) );
+		vm->numProfileFunctions = count;
+		count = 0;
+		for ( i = 0 ; i < vm->instructionCount ; i++ ) {
+			if ( codeBase[vm->instructionPointers[i]] == OP_ENTER ) {
+				vm->profileFunctions[count++].entry = vm->instructionPointers[i];
+			}
+		}
+	} else {
+		for ( i = 0 ; i < vm->numProfileFunctions ; i++ ) {
+			vm->profileFunctions[i].self = 0;
+			vm->profileFunctions[i].total = 0;
+		}
 	}
 
-	sorted = Z_Malloc( vm->numSymbols * sizeof( *sorted ) );
-	sorted[0] = vm->symbols;
-	total = sorted[0]->profileCount;
-	for ( i = 1 ; i < vm->numSymbols ; i++ ) {
-		sorted[i] = sorted[i-1]->next;
-		total += sorted[i]->profileCount;
-	}
+	vm->profiling = qtrue;
+	Com_Printf( "profiling %i functions of %s\n", vm->numProfileFunctions, vm->name );
+}
 
-	qsort( sorted, vm->numSymbols, sizeof( *sorted ), VM_ProfileSort );
+/*
+==============
+VM_ProfileReport
 
-	for ( i = 0 ; i < vm->numSymbols ; i++ ) {
-		int		perc;
+Lists the functions by the instructions executed in them, the hottest
+last, and starts the counts over
+==============
+*/
+static void VM_ProfileReport( vm_t *vm ) {
+	vmProfileFunction_t	**sorted, *func;
+	double	total;
+	int		i, count;
 
-		sym = sorted[i];
+	sorted = Z_Malloc( vm->numProfileFunctions * sizeof( *sorted ) );
+	total = 0;
+	count = 0;
+	for ( i = 0 ; i < vm->numProfileFunctions ; i++ ) {
+		func = &vm->profileFunctions[i];
+		if ( func->self ) {
+			sorted[count++] = func;
+			total += func->self;
+		}
+	}
 
-		perc = 100 * (float) sym->profileCount / total;
-		Com_Printf( "%2i%% %9i %s\n", perc, sym->profileCount, sym->symName );
-		sym->profileCount = 0;
+	qsort( sorted, count, sizeof( *sorted ), VM_ProfileSort );
+
+	Com_Printf( "%s:\n  self %%       self  total %%      total function\n", vm->name );
+	for ( i = 0 ; i < count ; i++ ) {
+		func = sorted[i];
+		Com_Printf( "%6.2f%% %10.0f %6.2f%% %10.0f %s\n",
+			100 * func->self / total, (double)func->self,
+			100 * func->total / total, (double)func->total,
+			vm->symbols ? VM_ValueToSymbol( vm, func->entry ) : va( "code offset %i", func->entry ) );
+		func->self = 0;
+		func->total = 0;
 	}
 
-	Com_Printf("    %9.0f total\n", total );
+	Com_Printf( "        %10.0f instructions in %i functions\n", total, count );
+	if ( !vm->symbols ) {
+		Com_Printf( "no symbols, set developer 1 before the vm loads to name the functions\n" );
+	}
 
 	Z_Free( sorted );
 }
 
+/*
+==============
+VM_VmProfile_f
+
+vmprofile start [vm]: count the instructions of an interpreted vm
+vmprofile stop: stop counting
+vmprofile: list what has been counted since the last time
+==============
+*/
+void VM_VmProfile_f( void ) {
+	vm_t	*vm;
+	int		i;
+
+	if ( !Q_stricmp( Cmd_Argv( 1 ), "start" ) ) {
+		vm = lastVM;
+		if ( Cmd_Argc() > 2 ) {
+			vm = NULL;
+			for ( i = 0 ; i < MAX_VM ; i++ ) {
+				if ( vmTable[i].name[0] && !Q_stricmp( vmTable[i].name, Cmd_Argv( 2 ) ) ) {
+					vm = &vmTable[i];
+				}
+			}
+		}
+		if ( !vm ) {
+			Com_Printf( "usage: vmprofile start [vm name from vminfo]\n" );
+			return;
+		}
+		VM_ProfileStart( vm );
+		return;
+	}
+
+	if ( !Q_stricmp( Cmd_Argv( 1 ), "stop" ) ) {
+		for ( i = 0 ; i < MAX_VM ; i++ ) {
+			vmTable[i].profiling = qfalse;
+		}
+		return;
+	}
+
+	for ( i = 0 ; i < MAX_VM ; i++ ) {
+		if ( vmTable[i].profileFunctions ) {
+			VM_ProfileReport( &vmTable[i] );
+		}
+	}
+}
+
 /*
 ==============
 VM_VmInfo_f
@@ -958,7 +1089,7 @@ void VM_VmInfo_f( void ) {
 		if ( vm->compiled ) {
 			Com_Printf( "compiled on load\n" );
 		} else {
-			Com_Printf( "interpreted\n" );
+			Com_Printf( "interpreted, %i superinstructions\n", vm->numFusedInstructions );
 		}
 		Com_Printf( "    code length : %7i\n", vm->codeLength );
 		Com_Printf( "    table length: %7i\n", vm->instructionCount*4 );
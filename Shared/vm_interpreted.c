@@ -108,10 +108,93 @@ static char	*opnames[256] = {
 	"OP_MULF",
 
 	"OP_CVIF",
-	"OP_CVFI"
+	"OP_CVFI",
+
+	//-------------------
+
+	"OP_LOCAL_LOAD4",
+	"OP_LOCAL_CONST_STORE4",
+	"OP_CONST_LOAD4",
+	"OP_CONST_ADD",
+	"OP_CONST_JUMP",
+	"OP_CONST_CALL",
+
+	"OP_CONST_EQ",
+	"OP_CONST_NE",
+
+	"OP_CONST_LTI",
+	"OP_CONST_LEI",
+	"OP_CONST_GTI",
+	"OP_CONST_GEI",
+
+	"OP_CONST_LTU",
+	"OP_CONST_LEU",
+	"OP_CONST_GTU",
+	"OP_CONST_GEU",
+
+	"OP_CONST_EQF",
+	"OP_CONST_NEF",
+
+	"OP_CONST_LTF",
+	"OP_CONST_LEF",
+	"OP_CONST_GTF",
+	"OP_CONST_GEF"
 };
 #endif
 
+// superinstructions stand in for the first instruction of a common
+// sequence and do the work of all of it.  The rest of the sequence keeps
+// its place in the code, so every code offset stays where it was
+typedef enum {
+	OP_LOCAL_LOAD4 = OP_CVFI + 1,	// LOCAL, LOAD4
+	OP_LOCAL_CONST_STORE4,			// LOCAL, CONST, STORE4
+	OP_CONST_LOAD4,					// CONST, LOAD4
+	OP_CONST_ADD,					// CONST, ADD
+	OP_CONST_JUMP,					// CONST, JUMP
+	OP_CONST_CALL,					// CONST, CALL of a vm function
+
+	OP_CONST_EQ,					// CONST, then a compare, in the same order
+	OP_CONST_NE,
+
+	OP_CONST_LTI,
+	OP_CONST_LEI,
+	OP_CONST_GTI,
+	OP_CONST_GEI,
+
+	OP_CONST_LTU,
+	OP_CONST_LEU,
+	OP_CONST_GTU,
+	OP_CONST_GEU,
+
+	OP_CONST_EQF,
+	OP_CONST_NEF,
+
+	OP_CONST_LTF,
+	OP_CONST_LEF,
+	OP_CONST_GTF,
+	OP_CONST_GEF
+} superOpcode_t;
+
+// with gcc, each handler jumps through a table straight to the handler of
+// the next instruction, rather than going back through the switch
+#if defined( __GNUC__ ) && !defined( DEBUG_VM )
+#define	VM_THREADED		1
+#define	VM_CASE( op )	case op: op##_label
+#else
+#define	VM_THREADED		0
+#define	VM_CASE( op )	case op
+#endif
+
+#define	MAX_PROFILE_DEPTH	64
+
+// the calls the interpreter is in, for charging callers with their callees
+typedef struct {
+	int					depth;
+	vmProfileFunction_t	*function[MAX_PROFILE_DEPTH];
+	int64_t				start[MAX_PROFILE_DEPTH];
+	qboolean			recursive[MAX_PROFILE_DEPTH];
+} vmProfileStack_t;
+
 #if idppc
 
 //FIXME: these, um... look the same to me
@@ -141,6 +224,13 @@ static ID_INLINE unsigned int __lwbrx(register void *addr,
     }
 #endif
 
+static ID_INLINE float VM_IntToFloat( int i ) {
+	floatint_t	fi;
+
+	fi.i = i;
+	return fi.f;
+}
+
 char *VM_Indent( vm_t *vm ) {
 	static char	*string = "                                        ";
 	if ( vm->callLevel > 20 ) {
@@ -162,6 +252,112 @@ void VM_StackTrace( vm_t *vm, int programCounter, int programStack ) {
 }
 
 
+/*
+====================
+VM_FuseInstructions
+
+Puts superinstructions in place of common sequences, where nothing jumps
+into the middle of them.  That can only be known when the qvm lists the
+targets of its jump tables
+====================
+*/
+static void VM_FuseInstructions( vm_t *vm ) {
+	int		*codeBase;
+	byte	*jused;
+	int		i, j, pc, op, value, fused;
+	int		next[2];
+
+	if ( !vm->jumpTableTargets ) {
+		return;
+	}
+
+	codeBase = (int *)vm->codeBase;
+	jused = Z_Malloc( vm->codeLength );
+
+	// find everything that can be jumped to
+	for ( i = 0 ; i < vm->numJumpTableTargets ; i++ ) {
+		value = *(int *)( vm->jumpTableTargets + i * sizeof( int ) );
+		if ( value >= 0 && value < vm->instructionCount ) {
+			jused[vm->instructionPointers[value]] = 1;
+		}
+	}
+	for ( i = 0 ; i < vm->instructionCount ; i++ ) {
+		pc = vm->instructionPointers[i];
+		op = codeBase[pc];
+
+		if ( op >= OP_EQ && op <= OP_GEF ) {
+			if ( (unsigned)codeBase[pc + 1] < vm->codeLength ) {
+				jused[codeBase[pc + 1]] = 1;
+			}
+		} else if ( op == OP_ENTER ) {
+			jused[pc] = 1;
+		} else if ( op == OP_CALL ) {
+			// the return address
+			if ( i + 1 < vm->instructionCount ) {
+				jused[vm->instructionPointers[i + 1]] = 1;
+			}
+		} else if ( op == OP_CONST && i + 1 < vm->instructionCount ) {
+			value = codeBase[pc + 1];
+			op = codeBase[vm->instructionPointers[i + 1]];
+			if ( ( op == OP_JUMP || op == OP_CALL ) && value >= 0 && value < vm->instructionCount ) {
+				jused[vm->instructionPointers[value]] = 1;
+			}
+		}
+	}
+
+	for ( i = 0 ; i < vm->instructionCount ; i++ ) {
+		pc = vm->instructionPointers[i];
+		op = codeBase[pc];
+		if ( op != OP_LOCAL && op != OP_CONST ) {
+			continue;
+		}
+
+		// the instructions that follow, up to the first one jumped to
+		for ( j = 0 ; j < 2 ; j++ ) {
+			next[j] = -1;
+			if ( i + 1 + j < vm->instructionCount && !jused[vm->instructionPointers[i + 1 + j]]
+				&& ( j == 0 || next[0] != -1 ) ) {
+				next[j] = codeBase[vm->instructionPointers[i + 1 + j]];
+			}
+		}
+
+		value = codeBase[pc + 1];
+		fused = 0;
+		if ( op == OP_LOCAL ) {
+			if ( next[0] == OP_CONST && next[1] == OP_STORE4 ) {
+				codeBase[pc] = OP_LOCAL_CONST_STORE4;
+				fused = 2;
+			} else if ( next[0] == OP_LOAD4 ) {
+				codeBase[pc] = OP_LOCAL_LOAD4;
+				fused = 1;
+			}
+		} else if ( next[0] >= OP_EQ && next[0] <= OP_GEF ) {
+			codeBase[pc] = OP_CONST_EQ + next[0] - OP_EQ;
+			fused = 1;
+		} else if ( next[0] == OP_LOAD4 ) {
+			codeBase[pc] = OP_CONST_LOAD4;
+			fused = 1;
+		} else if ( next[0] == OP_ADD ) {
+			codeBase[pc] = OP_CONST_ADD;
+			fused = 1;
+		} else if ( next[0] == OP_JUMP && value >= 0 && value < vm->instructionCount ) {
+			codeBase[pc] = OP_CONST_JUMP;
+			fused = 1;
+		} else if ( next[0] == OP_CALL && value >= 0 && value < vm->instructionCount ) {
+			// system calls are negative, and left alone
+			codeBase[pc] = OP_CONST_CALL;
+			fused = 1;
+		}
+
+		if ( fused ) {
+			vm->numFusedInstructions++;
+			i += fused;
+		}
+	}
+
+	Z_Free( jused );
+}
+
 /*
 ====================
 VM_PrepareInterpreter
@@ -287,6 +483,66 @@ void VM_PrepareInterpreter( vm_t *vm, vmHeader_t *header ) {
 		}
 
 	}
+
+	VM_FuseInstructions( vm );
+}
+
+/*
+====================
+VM_ProfileInstruction
+
+Counts an instruction against the function it is in, and keeps track of
+the calls so that every function is also charged for what it calls
+====================
+*/
+static void VM_ProfileInstruction( vm_t *vm, vmProfileStack_t *stack, int opcode, int programCounter ) {
+	vmProfileFunction_t	*func;
+	int		count, i;
+
+	if ( opcode == OP_ENTER ) {
+		if ( stack->depth < MAX_PROFILE_DEPTH ) {
+			func = VM_ProfileFunction( vm, programCounter );
+			stack->function[stack->depth] = func;
+			stack->start[stack->depth] = vm->profileInstructions;
+
+			// recursion is already in the total of the outer call
+			stack->recursive[stack->depth] = qfalse;
+			for ( i = 0 ; i < stack->depth ; i++ ) {
+				if ( stack->function[i] == func ) {
+					stack->recursive[stack->depth] = qtrue;
+				}
+			}
+		}
+		stack->depth++;
+	}
+
+	// superinstructions count as what they replaced
+	if ( opcode == OP_LOCAL_CONST_STORE4 ) {
+		count = 3;
+	} else if ( opcode > OP_CVFI ) {
+		count = 2;
+	} else {
+		count = 1;
+	}
+	vm->profileInstructions += count;
+
+	if ( !stack->depth ) {
+		return;
+	}
+	func = stack->function[MIN( stack->depth, MAX_PROFILE_DEPTH ) - 1];
+	if ( func ) {
+		func->self += count;
+	}
+
+	if ( opcode == OP_LEAVE ) {
+		stack->depth--;
+		if ( stack->depth < MAX_PROFILE_DEPTH ) {
+			func = stack->function[stack->depth];
+			if ( func && !stack->recursive[stack->depth] ) {
+				func->total += vm->profileInstructions - stack->start[stack->depth];
+			}
+		}
+	}
 }
 
 /*
@@ -326,8 +582,103 @@ int	VM_CallInterpreted( vm_t *vm, int *args ) {
 	int		*codeImage;
 	int		v1;
 	int		dataMask;
-#ifdef DEBUG_VM
-	vmSymbol_t	*profileSymbol;
+	qboolean	profiling;
+	vmProfileStack_t	profileStack;
+#if VM_THREADED
+	static const void * const handlers[256] = {
+		// like the switch, anything unknown is skipped
+		[0 ... 255] = &&nextInstruction,
+
+		[OP_BREAK] = &&OP_BREAK_label,
+		[OP_ENTER] = &&OP_ENTER_label,
+		[OP_LEAVE] = &&OP_LEAVE_label,
+		[OP_CALL] = &&OP_CALL_label,
+		[OP_PUSH] = &&OP_PUSH_label,
+		[OP_POP] = &&OP_POP_label,
+		[OP_CONST] = &&OP_CONST_label,
+		[OP_LOCAL] = &&OP_LOCAL_label,
+		[OP_JUMP] = &&OP_JUMP_label,
+
+		[OP_EQ] = &&OP_EQ_label,
+		[OP_NE] = &&OP_NE_label,
+		[OP_LTI] = &&OP_LTI_label,
+		[OP_LEI] = &&OP_LEI_label,
+		[OP_GTI] = &&OP_GTI_label,
+		[OP_GEI] = &&OP_GEI_label,
+		[OP_LTU] = &&OP_LTU_label,
+		[OP_LEU] = &&OP_LEU_label,
+		[OP_GTU] = &&OP_GTU_label,
+		[OP_GEU] = &&OP_GEU_label,
+		[OP_EQF] = &&OP_EQF_label,
+		[OP_NEF] = &&OP_NEF_label,
+		[OP_LTF] = &&OP_LTF_label,
+		[OP_LEF] = &&OP_LEF_label,
+		[OP_GTF] = &&OP_GTF_label,
+		[OP_GEF] = &&OP_GEF_label,
+
+		[OP_LOAD1] = &&OP_LOAD1_label,
+		[OP_LOAD2] = &&OP_LOAD2_label,
+		[OP_LOAD4] = &&OP_LOAD4_label,
+		[OP_STORE1] = &&OP_STORE1_label,
+		[OP_STORE2] = &&OP_STORE2_label,
+		[OP_STORE4] = &&OP_STORE4_label,
+		[OP_ARG] = &&OP_ARG_label,
+		[OP_BLOCK_COPY] = &&OP_BLOCK_COPY_label,
+
+		[OP_SEX8] = &&OP_SEX8_label,
+		[OP_SEX16] = &&OP_SEX16_label,
+		[OP_NEGI] = &&OP_NEGI_label,
+		[OP_ADD] = &&OP_ADD_label,
+		[OP_SUB] = &&OP_SUB_label,
+		[OP_DIVI] = &&OP_DIVI_label,
+		[OP_DIVU] = &&OP_DIVU_label,
+		[OP_MODI] = &&OP_MODI_label,
+		[OP_MODU] = &&OP_MODU_label,
+		[OP_MULI] = &&OP_MULI_label,
+		[OP_MULU] = &&OP_MULU_label,
+		[OP_BAND] = &&OP_BAND_label,
+		[OP_BOR] = &&OP_BOR_label,
+		[OP_BXOR] = &&OP_BXOR_label,
+		[OP_BCOM] = &&OP_BCOM_label,
+		[OP_LSH] = &&OP_LSH_label,
+		[OP_RSHI] = &&OP_RSHI_label,
+		[OP_RSHU] = &&OP_RSHU_label,
+		[OP_NEGF] = &&OP_NEGF_label,
+		[OP_ADDF] = &&OP_ADDF_label,
+		[OP_SUBF] = &&OP_SUBF_label,
+		[OP_DIVF] = &&OP_DIVF_label,
+		[OP_MULF] = &&OP_MULF_label,
+		[OP_CVIF] = &&OP_CVIF_label,
+		[OP_CVFI] = &&OP_CVFI_label,
+
+		[OP_LOCAL_LOAD4] = &&OP_LOCAL_LOAD4_label,
+		[OP_LOCAL_CONST_STORE4] = &&OP_LOCAL_CONST_STORE4_label,
+		[OP_CONST_LOAD4] = &&OP_CONST_LOAD4_label,
+		[OP_CONST_ADD] = &&OP_CONST_ADD_label,
+		[OP_CONST_JUMP] = &&OP_CONST_JUMP_label,
+		[OP_CONST_CALL] = &&OP_CONST_CALL_label,
+		[OP_CONST_EQ] = &&OP_CONST_EQ_label,
+		[OP_CONST_NE] = &&OP_CONST_NE_label,
+		[OP_CONST_LTI] = &&OP_CONST_LTI_label,
+		[OP_CONST_LEI] = &&OP_CONST_LEI_label,
+		[OP_CONST_GTI] = &&OP_CONST_GTI_label,
+		[OP_CONST_GEI] = &&OP_CONST_GEI_label,
+		[OP_CONST_LTU] = &&OP_CONST_LTU_label,
+		[OP_CONST_LEU] = &&OP_CONST_LEU_label,
+		[OP_CONST_GTU] = &&OP_CONST_GTU_label,
+		[OP_CONST_GEU] = &&OP_CONST_GEU_label,
+		[OP_CONST_EQF] = &&OP_CONST_EQF_label,
+		[OP_CONST_NEF] = &&OP_CONST_NEF_label,
+		[OP_CONST_LTF] = &&OP_CONST_LTF_label,
+		[OP_CONST_LEF] = &&OP_CONST_LEF_label,
+		[OP_CONST_GTF] = &&OP_CONST_GTF_label,
+		[OP_CONST_GEF] = &&OP_CONST_GEF_label
+	};
+	// while profiling, every instruction is counted on the way
+	static const void * const profileHandlers[256] = {
+		[0 ... 255] = &&profileInstruction
+	};
+	const void * const	*dispatch;
 #endif
 
 	// interpret the code
@@ -337,9 +688,13 @@ int	VM_CallInterpreted( vm_t *vm, int *args ) {
 	programStack = stackOnEntry = vm->programStack;
 
 #ifdef DEBUG_VM
-	profileSymbol = VM_ValueToFunctionSymbol( vm, 0 );
 	// uncomment this for debugging breakpoints
 	vm->breakFunction = 0;
+#endif
+	profiling = vm->profiling;
+	profileStack.depth = 0;
+#if VM_THREADED
+	dispatch = profiling ? profileHandlers : handlers;
 #endif
 	// set up the stack frame 
 
@@ -406,27 +761,38 @@ nextInstruction2:
 		if ( vm_debugLevel > 1 ) {
 			Com_Printf( "%s %s\n", DEBUGSTR, opnames[opcode] );
 		}
-		profileSymbol->profileCount++;
 #endif
 		opcode = codeImage[ programCounter++ ];
 
+#if VM_THREADED
+		goto *dispatch[ opcode & 0xff ];
+
+profileInstruction:
+		VM_ProfileInstruction( vm, &profileStack, opcode, programCounter - 1 );
+		goto *handlers[ opcode & 0xff ];
+#else
+		if ( profiling ) {
+			VM_ProfileInstruction( vm, &profileStack, opcode, programCounter - 1 );
+		}
+#endif
+
 		switch ( opcode ) {
 #ifdef DEBUG_VM
 		default:
 			Com_Error( ERR_DROP, "Bad VM instruction" );  // this should be scanned on load!
 			return 0;
 #endif
-		case OP_BREAK:
+		VM_CASE( OP_BREAK ):
 			vm->breakCount++;
 			goto nextInstruction2;
-		case OP_CONST:
+		VM_CASE( OP_CONST ):
 			opStackOfs++;
 			r1 = r0;
 			r0 = opStack[opStackOfs] = r2;
 			
 			programCounter += 1;
 			goto nextInstruction2;
-		case OP_LOCAL:
+		VM_CASE( OP_LOCAL ):
 			opStackOfs++;
 			r1 = r0;
 			r0 = opStack[opStackOfs] = r2+programStack;
@@ -434,7 +800,7 @@ nextInstruction2:
 			programCounter += 1;
 			goto nextInstruction2;
 
-		case OP_LOAD4:
+		VM_CASE( OP_LOAD4 ):
 #ifdef DEBUG_VM
 			if(opStack[opStackOfs] & 3)
 			{
@@ -444,40 +810,40 @@ nextInstruction2:
 #endif
 			r0 = opStack[opStackOfs] = *(int *) &image[r0 & dataMask & ~3 ];
 			goto nextInstruction2;
-		case OP_LOAD2:
+		VM_CASE( OP_LOAD2 ):
 			r0 = opStack[opStackOfs] = *(unsigned short *)&image[ r0&dataMask&~1 ];
 			goto nextInstruction2;
-		case OP_LOAD1:
+		VM_CASE( OP_LOAD1 ):
 			r0 = opStack[opStackOfs] = image[ r0&dataMask ];
 			goto nextInstruction2;
 
-		case OP_STORE4:
+		VM_CASE( OP_STORE4 ):
 			*(int *)&image[ r1&(dataMask & ~3) ] = r0;
 			opStackOfs -= 2;
 			goto nextInstruction;
-		case OP_STORE2:
+		VM_CASE( OP_STORE2 ):
 			*(short *)&image[ r1&(dataMask & ~1) ] = r0;
 			opStackOfs -= 2;
 			goto nextInstruction;
-		case OP_STORE1:
+		VM_CASE( OP_STORE1 ):
 			image[ r1&dataMask ] = r0;
 			opStackOfs -= 2;
 			goto nextInstruction;
 
-		case OP_ARG:
+		VM_CASE( OP_ARG ):
 			// single byte offset from programStack
 			*(int *)&image[ (codeImage[programCounter] + programStack)&dataMask&~3 ] = r0;
 			opStackOfs--;
 			programCounter += 1;
 			goto nextInstruction;
 
-		case OP_BLOCK_COPY:
+		VM_CASE( OP_BLOCK_COPY ):
 			VM_BlockCopy(r1, r0, r2);
 			programCounter += 1;
 			opStackOfs -= 2;
 			goto nextInstruction;
 
-		case OP_CALL:
+		VM_CASE( OP_CALL ):
 			// save current program counter
 			*(int *)&image[ programStack ] = programCounter;
 			
@@ -546,17 +912,14 @@ nextInstruction2:
 			goto nextInstruction;
 
 		// push and pop are only needed for discarded or bad function return values
-		case OP_PUSH:
+		VM_CASE( OP_PUSH ):
 			opStackOfs++;
 			goto nextInstruction;
-		case OP_POP:
+		VM_CASE( OP_POP ):
 			opStackOfs--;
 			goto nextInstruction;
 
-		case OP_ENTER:
-#ifdef DEBUG_VM
-			profileSymbol = VM_ValueToFunctionSymbol( vm, programCounter );
-#endif
+		VM_CASE( OP_ENTER ):
 			// get size of stack frame
 			v1 = r2;
 
@@ -577,7 +940,7 @@ nextInstruction2:
 			}
 #endif
 			goto nextInstruction;
-		case OP_LEAVE:
+		VM_CASE( OP_LEAVE ):
 			// remove our stack frame
 			v1 = r2;
 
@@ -586,7 +949,6 @@ nextInstruction2:
 			// grab the saved program counter
 			programCounter = *(int *)&image[ programStack ];
 #ifdef DEBUG_VM
-			profileSymbol = VM_ValueToFunctionSymbol( vm, programCounter );
 			if ( vm_debugLevel ) {
 //				vm->callLevel--;
 				Com_Printf( "%s<--- %s\n", DEBUGSTR, VM_ValueToSymbol( vm, programCounter ) );
@@ -607,7 +969,7 @@ nextInstruction2:
 		===================================================================
 		*/
 
-		case OP_JUMP:
+		VM_CASE( OP_JUMP ):
 			if ( (unsigned)r0 >= vm->instructionCount )
 			{
 				Com_Error( ERR_DROP, "VM program counter out of range in OP_JUMP" );
@@ -619,7 +981,7 @@ nextInstruction2:
 			opStackOfs--;
 			goto nextInstruction;
 
-		case OP_EQ:
+		VM_CASE( OP_EQ ):
 			opStackOfs -= 2;
 			if ( r1 == r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -629,7 +991,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_NE:
+		VM_CASE( OP_NE ):
 			opStackOfs -= 2;
 			if ( r1 != r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -639,7 +1001,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LTI:
+		VM_CASE( OP_LTI ):
 			opStackOfs -= 2;
 			if ( r1 < r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -649,7 +1011,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LEI:
+		VM_CASE( OP_LEI ):
 			opStackOfs -= 2;
 			if ( r1 <= r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -659,7 +1021,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GTI:
+		VM_CASE( OP_GTI ):
 			opStackOfs -= 2;
 			if ( r1 > r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -669,7 +1031,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GEI:
+		VM_CASE( OP_GEI ):
 			opStackOfs -= 2;
 			if ( r1 >= r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -679,7 +1041,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LTU:
+		VM_CASE( OP_LTU ):
 			opStackOfs -= 2;
 			if ( ((unsigned)r1) < ((unsigned)r0) ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -689,7 +1051,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LEU:
+		VM_CASE( OP_LEU ):
 			opStackOfs -= 2;
 			if ( ((unsigned)r1) <= ((unsigned)r0) ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -699,7 +1061,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GTU:
+		VM_CASE( OP_GTU ):
 			opStackOfs -= 2;
 			if ( ((unsigned)r1) > ((unsigned)r0) ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -709,7 +1071,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GEU:
+		VM_CASE( OP_GEU ):
 			opStackOfs -= 2;
 			if ( ((unsigned)r1) >= ((unsigned)r0) ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -719,7 +1081,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_EQF:
+		VM_CASE( OP_EQF ):
 			opStackOfs -= 2;
 			
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] == ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -731,7 +1093,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_NEF:
+		VM_CASE( OP_NEF ):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] != ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -743,7 +1105,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LTF:
+		VM_CASE( OP_LTF ):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] < ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -755,7 +1117,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LEF:
+		VM_CASE( OP_LEF ):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) ((uint8_t) (opStackOfs + 1))] <= ((float *) opStack)[(uint8_t) ((uint8_t) (opStackOfs + 2))])
@@ -767,7 +1129,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GTF:
+		VM_CASE( OP_GTF ):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] > ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -779,7 +1141,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GEF:
+		VM_CASE( OP_GEF ):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] >= ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -794,103 +1156,182 @@ nextInstruction2:
 
 		//===================================================================
 
-		case OP_NEGI:
+		VM_CASE( OP_NEGI ):
 			opStack[opStackOfs] = -r0;
 			goto nextInstruction;
-		case OP_ADD:
+		VM_CASE( OP_ADD ):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 + r0;
 			goto nextInstruction;
-		case OP_SUB:
+		VM_CASE( OP_SUB ):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 - r0;
 			goto nextInstruction;
-		case OP_DIVI:
+		VM_CASE( OP_DIVI ):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 / r0;
 			goto nextInstruction;
-		case OP_DIVU:
+		VM_CASE( OP_DIVU ):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) / ((unsigned) r0);
 			goto nextInstruction;
-		case OP_MODI:
+		VM_CASE( OP_MODI ):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 % r0;
 			goto nextInstruction;
-		case OP_MODU:
+		VM_CASE( OP_MODU ):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) % ((unsigned) r0);
 			goto nextInstruction;
-		case OP_MULI:
+		VM_CASE( OP_MULI ):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 * r0;
 			goto nextInstruction;
-		case OP_MULU:
+		VM_CASE( OP_MULU ):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) * ((unsigned) r0);
 			goto nextInstruction;
 
-		case OP_BAND:
+		VM_CASE( OP_BAND ):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) & ((unsigned) r0);
 			goto nextInstruction;
-		case OP_BOR:
+		VM_CASE( OP_BOR ):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) | ((unsigned) r0);
 			goto nextInstruction;
-		case OP_BXOR:
+		VM_CASE( OP_BXOR ):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) ^ ((unsigned) r0);
 			goto nextInstruction;
-		case OP_BCOM:
+		VM_CASE( OP_BCOM ):
 			opStack[opStackOfs] = ~((unsigned) r0);
 			goto nextInstruction;
 
-		case OP_LSH:
+		VM_CASE( OP_LSH ):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 << r0;
 			goto nextInstruction;
-		case OP_RSHI:
+		VM_CASE( OP_RSHI ):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 >> r0;
 			goto nextInstruction;
-		case OP_RSHU:
+		VM_CASE( OP_RSHU ):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) >> r0;
 			goto nextInstruction;
 
-		case OP_NEGF:
+		VM_CASE( OP_NEGF ):
 			((float *) opStack)[opStackOfs] =  -((float *) opStack)[opStackOfs];
 			goto nextInstruction;
-		case OP_ADDF:
+		VM_CASE( OP_ADDF ):
 			opStackOfs--;
 			((float *) opStack)[opStackOfs] = ((float *) opStack)[opStackOfs] + ((float *) opStack)[(uint8_t) (opStackOfs + 1)];
 			goto nextInstruction;
-		case OP_SUBF:
+		VM_CASE( OP_SUBF ):
 			opStackOfs--;
 			((float *) opStack)[opStackOfs] = ((float *) opStack)[opStackOfs] - ((float *) opStack)[(uint8_t) (opStackOfs + 1)];
 			goto nextInstruction;
-		case OP_DIVF:
+		VM_CASE( OP_DIVF ):
 			opStackOfs--;
 			((float *) opStack)[opStackOfs] = ((float *) opStack)[opStackOfs] / ((float *) opStack)[(uint8_t) (opStackOfs + 1)];
 			goto nextInstruction;
-		case OP_MULF:
+		VM_CASE( OP_MULF ):
 			opStackOfs--;
 			((float *) opStack)[opStackOfs] = ((float *) opStack)[opStackOfs] * ((float *) opStack)[(uint8_t) (opStackOfs + 1)];
 			goto nextInstruction;
 
-		case OP_CVIF:
+		VM_CASE( OP_CVIF ):
 			((float *) opStack)[opStackOfs] = (float) opStack[opStackOfs];
 			goto nextInstruction;
-		case OP_CVFI:
+		VM_CASE( OP_CVFI ):
 			opStack[opStackOfs] = Q_ftol(((float *) opStack)[opStackOfs]);
 			goto nextInstruction;
-		case OP_SEX8:
+		VM_CASE( OP_SEX8 ):
 			opStack[opStackOfs] = (signed char) opStack[opStackOfs];
 			goto nextInstruction;
-		case OP_SEX16:
+		VM_CASE( OP_SEX16 ):
 			opStack[opStackOfs] = (short) opStack[opStackOfs];
 			goto nextInstruction;
+
+		/*
+		===================================================================
+		SUPERINSTRUCTIONS
+		===================================================================
+		*/
+
+		VM_CASE( OP_LOCAL_LOAD4 ):
+			opStackOfs++;
+			r1 = r0;
+			r0 = opStack[opStackOfs] = *(int *)&image[ (r2 + programStack) & dataMask & ~3 ];
+			programCounter += 2;
+			goto nextInstruction2;
+		VM_CASE( OP_LOCAL_CONST_STORE4 ):
+			*(int *)&image[ (r2 + programStack) & dataMask & ~3 ] = codeImage[programCounter + 2];
+			programCounter += 4;
+			goto nextInstruction2;
+		VM_CASE( OP_CONST_LOAD4 ):
+			opStackOfs++;
+			r1 = r0;
+			r0 = opStack[opStackOfs] = *(int *)&image[ r2 & dataMask & ~3 ];
+			programCounter += 2;
+			goto nextInstruction2;
+		VM_CASE( OP_CONST_ADD ):
+			r0 = opStack[opStackOfs] = r0 + r2;
+			programCounter += 2;
+			goto nextInstruction2;
+
+		// the targets were checked when these were fused
+		VM_CASE( OP_CONST_JUMP ):
+			programCounter = vm->instructionPointers[ r2 ];
+			goto nextInstruction2;
+		VM_CASE( OP_CONST_CALL ):
+			*(int *)&image[ programStack ] = programCounter + 2;
+			programCounter = vm->instructionPointers[ r2 ];
+			goto nextInstruction2;
+
+// compares the top of the stack with the constant and branches on it
+#define	CONST_BRANCH( cond ) \
+			opStackOfs--; \
+			if ( cond ) { \
+				programCounter = codeImage[programCounter + 2]; \
+			} else { \
+				programCounter += 3; \
+			} \
+			goto nextInstruction
+
+		VM_CASE( OP_CONST_EQ ):
+			CONST_BRANCH( r0 == r2 );
+		VM_CASE( OP_CONST_NE ):
+			CONST_BRANCH( r0 != r2 );
+		VM_CASE( OP_CONST_LTI ):
+			CONST_BRANCH( r0 < r2 );
+		VM_CASE( OP_CONST_LEI ):
+			CONST_BRANCH( r0 <= r2 );
+		VM_CASE( OP_CONST_GTI ):
+			CONST_BRANCH( r0 > r2 );
+		VM_CASE( OP_CONST_GEI ):
+			CONST_BRANCH( r0 >= r2 );
+		VM_CASE( OP_CONST_LTU ):
+			CONST_BRANCH( ((unsigned)r0) < ((unsigned)r2) );
+		VM_CASE( OP_CONST_LEU ):
+			CONST_BRANCH( ((unsigned)r0) <= ((unsigned)r2) );
+		VM_CASE( OP_CONST_GTU ):
+			CONST_BRANCH( ((unsigned)r0) > ((unsigned)r2) );
+		VM_CASE( OP_CONST_GEU ):
+			CONST_BRANCH( ((unsigned)r0) >= ((unsigned)r2) );
+		VM_CASE( OP_CONST_EQF ):
+			CONST_BRANCH( VM_IntToFloat( r0 ) == VM_IntToFloat( r2 ) );
+		VM_CASE( OP_CONST_NEF ):
+			CONST_BRANCH( VM_IntToFloat( r0 ) != VM_IntToFloat( r2 ) );
+		VM_CASE( OP_CONST_LTF ):
+			CONST_BRANCH( VM_IntToFloat( r0 ) < VM_IntToFloat( r2 ) );
+		VM_CASE( OP_CONST_LEF ):
+			CONST_BRANCH( VM_IntToFloat( r0 ) <= VM_IntToFloat( r2 ) );
+		VM_CASE( OP_CONST_GTF ):
+			CONST_BRANCH( VM_IntToFloat( r0 ) > VM_IntToFloat( r2 ) );
+		VM_CASE( OP_CONST_GEF ):
+			CONST_BRANCH( VM_IntToFloat( r0 ) >= VM_IntToFloat( r2 ) );
 		}
 	}
 
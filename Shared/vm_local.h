@@ -126,10 +126,15 @@ typedef int	vmptr_t;
 typedef struct vmSymbol_s {
 	struct vmSymbol_s	*next;
 	int		symValue;
-	int		profileCount;
 	char	symName[1];		// variable sized
 } vmSymbol_t;
 
+typedef struct {
+	int			entry;			// code offset of the OP_ENTER
+	int64_t		self;			// instructions executed in the function
+	int64_t		total;			// and in everything it called
+} vmProfileFunction_t;
+
 #define	VM_OFFSET_PROGRAM_STACK		0
 #define	VM_OFFSET_SYSTEM_CALL		4
 
@@ -174,6 +179,14 @@ struct vm_s {
 
 	byte		*jumpTableTargets;
 	int			numJumpTableTargets;
+
+	// for profiling interpreted modules
+	qboolean	profiling;
+	int64_t		profileInstructions;
+	vmProfileFunction_t	*profileFunctions;	// sorted by entry
+	int			numProfileFunctions;
+
+	int			numFusedInstructions;
 };
 
 
@@ -187,6 +200,7 @@ void VM_PrepareInterpreter( vm_t *vm, vmHeader_t *header );
 int	VM_CallInterpreted( vm_t *vm, int *args );
 
 vmSymbol_t *VM_ValueToFunctionSymbol( vm_t *vm, int value );
+vmProfileFunction_t *VM_ProfileFunction( vm_t *vm, int entry );
 int VM_SymbolToValue( vm_t *vm, const char *symbol );
 const char *VM_ValueToSymbol( vm_t *vm, int value );
 void VM_LogSyscalls( int *args );